@@ -272,8 +272,14 @@ UA_STATIC_ASSERT(sizeof(bool) == 1, cannot_overlay_integers_with_large_bool);
  * -----------------
  * Atomic operations that synchronize across processor cores (for
  * multithreading). Only the inline-functions defined next are used. Replace
- * with architecture-specific operations if necessary. */
-#ifndef UA_ENABLE_MULTITHREADING
+ * with architecture-specific operations if necessary. The PubSub publisher
+ * threads and the asynchronous history ingestion also require them. */
+#if defined(UA_ENABLE_MULTITHREADING) || defined(UA_ENABLE_PUBSUB_PUBLISHER_THREADS) || \
+    defined(UA_ENABLE_HISTORIZING_ASYNC)
+# define UA_ATOMIC_OPERATIONS
+#endif
+
+#ifndef UA_ATOMIC_OPERATIONS
 # define UA_atomic_sync()
 #else
 # ifdef _MSC_VER /* Visual Studio */
@@ -285,7 +291,7 @@ UA_STATIC_ASSERT(sizeof(bool) == 1, cannot_overlay_integers_with_large_bool);
 
 static UA_INLINE void *
 UA_atomic_xchg(void * volatile * addr, void *newptr) {
-#ifndef UA_ENABLE_MULTITHREADING
+#ifndef UA_ATOMIC_OPERATIONS
     void *old = *addr;
     *addr = newptr;
     return old;
@@ -300,7 +306,7 @@ UA_atomic_xchg(void * volatile * addr, void *newptr) {
 
 static UA_INLINE void *
 UA_atomic_cmpxchg(void * volatile * addr, void *expected, void *newptr) {
-#ifndef UA_ENABLE_MULTITHREADING
+#ifndef UA_ATOMIC_OPERATIONS
     void *old = *addr;
     if(old == expected) {
         *addr = newptr;
@@ -315,9 +321,27 @@ UA_atomic_cmpxchg(void * volatile * addr, void *expected, void *newptr) {
 #endif
 }
 
+static UA_INLINE size_t
+UA_atomic_cmpxchgSize(volatile size_t *addr, size_t expected, size_t newval) {
+#ifndef UA_ATOMIC_OPERATIONS
+    size_t old = *addr;
+    if(old == expected) {
+        *addr = newval;
+    }
+    return old;
+#else
+    # ifdef _MSC_VER /* Visual Studio */
+    return (size_t)_InterlockedCompareExchangePointer((void * volatile *)addr,
+                                                      (void*)newval, (void*)expected);
+# else /* GCC/Clang */
+    return __sync_val_compare_and_swap(addr, expected, newval);
+# endif
+#endif
+}
+
 static UA_INLINE uint32_t
 UA_atomic_addUInt32(volatile uint32_t *addr, uint32_t increase) {
-#ifndef UA_ENABLE_MULTITHREADING
+#ifndef UA_ATOMIC_OPERATIONS
     *addr += increase;
     return *addr;
 #else
@@ -331,7 +355,7 @@ UA_atomic_addUInt32(volatile uint32_t *addr, uint32_t increase) {
 
 static UA_INLINE size_t
 UA_atomic_addSize(volatile size_t *addr, size_t increase) {
-#ifndef UA_ENABLE_MULTITHREADING
+#ifndef UA_ATOMIC_OPERATIONS
     *addr += increase;
     return *addr;
 #else
@@ -345,7 +369,7 @@ UA_atomic_addSize(volatile size_t *addr, size_t increase) {
 
 static UA_INLINE uint32_t
 UA_atomic_subUInt32(volatile uint32_t *addr, uint32_t decrease) {
-#ifndef UA_ENABLE_MULTITHREADING
+#ifndef UA_ATOMIC_OPERATIONS
     *addr -= decrease;
     return *addr;
 #else
@@ -359,7 +383,7 @@ UA_atomic_subUInt32(volatile uint32_t *addr, uint32_t decrease) {
 
 static UA_INLINE size_t
 UA_atomic_subSize(volatile size_t *addr, size_t decrease) {
-#ifndef UA_ENABLE_MULTITHREADING
+#ifndef UA_ATOMIC_OPERATIONS
     *addr -= decrease;
     return *addr;
 #else
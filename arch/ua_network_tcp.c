@@ -20,6 +20,111 @@
 #define MSG_NOSIGNAL 0
 #endif
 
+/***************/
+/* Buffer Pool */
+/***************/
+
+/* The server connections take their send and receive buffers from a pool of
+ * fixed-size buffers that is shared by all connections of the network layer.
+ * This avoids a malloc/free pair per chunk. The free buffers are held in an
+ * array of slots. Buffers are taken and returned by atomically swapping the
+ * slot content. This is lock-free and (unlike a linked free list) not prone to
+ * the ABA problem. */
+
+#ifndef UA_NETWORK_TCP_BUFFERPOOL_SIZE
+# define UA_NETWORK_TCP_BUFFERPOOL_SIZE 16
+#endif
+
+/* Align the buffers to cache lines */
+#define BUFFERPOOL_ALIGNMENT 64
+
+/* Stored directly in front of the (aligned) buffer data */
+typedef struct {
+    void *memory;    /* The allocated memory block */
+    size_t capacity; /* Usable bytes of the buffer */
+} BufferPoolItem;
+
+typedef struct {
+    size_t bufferSize;
+    void * volatile slots[UA_NETWORK_TCP_BUFFERPOOL_SIZE];
+    volatile size_t hits;
+    volatile size_t misses;
+} BufferPool;
+
+static BufferPoolItem *
+BufferPool_item(UA_Byte *data) {
+    return (BufferPoolItem*)(uintptr_t)(data - sizeof(BufferPoolItem));
+}
+
+static UA_Byte *
+BufferPool_allocData(size_t capacity) {
+    void *memory = UA_malloc(sizeof(BufferPoolItem) + BUFFERPOOL_ALIGNMENT - 1 + capacity);
+    if(!memory)
+        return NULL;
+    uintptr_t data = (uintptr_t)memory + sizeof(BufferPoolItem);
+    data = (data + BUFFERPOOL_ALIGNMENT - 1) & ~(uintptr_t)(BUFFERPOOL_ALIGNMENT - 1);
+    BufferPoolItem *item = BufferPool_item((UA_Byte*)data);
+    item->memory = memory;
+    item->capacity = capacity;
+    return (UA_Byte*)data;
+}
+
+static UA_StatusCode
+BufferPool_acquire(BufferPool *pool, size_t length, UA_ByteString *buf) {
+    /* Take a free buffer from the pool */
+    if(length <= pool->bufferSize) {
+        for(size_t i = 0; i < UA_NETWORK_TCP_BUFFERPOOL_SIZE; i++) {
+            if(!pool->slots[i])
+                continue;
+            UA_Byte *data = (UA_Byte*)UA_atomic_xchg(&pool->slots[i], NULL);
+            if(!data)
+                continue;
+            UA_atomic_addSize(&pool->hits, 1);
+            buf->data = data;
+            buf->length = length;
+            return UA_STATUSCODE_GOOD;
+        }
+    }
+
+    /* Allocate a new buffer. Oversized buffers are not returned to the pool. */
+    UA_atomic_addSize(&pool->misses, 1);
+    buf->data = BufferPool_allocData(length > pool->bufferSize ? length : pool->bufferSize);
+    if(!buf->data) {
+        buf->length = 0;
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    buf->length = length;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+BufferPool_release(BufferPool *pool, UA_ByteString *buf) {
+    if(!buf->data)
+        return;
+    BufferPoolItem *item = BufferPool_item(buf->data);
+    if(item->capacity == pool->bufferSize) {
+        for(size_t i = 0; i < UA_NETWORK_TCP_BUFFERPOOL_SIZE; i++) {
+            if(pool->slots[i])
+                continue;
+            if(UA_atomic_cmpxchg(&pool->slots[i], NULL, buf->data) == NULL)
+                goto done;
+        }
+    }
+    UA_free(item->memory); /* The pool is full */
+ done:
+    buf->data = NULL;
+    buf->length = 0;
+}
+
+static void
+BufferPool_clear(BufferPool *pool) {
+    for(size_t i = 0; i < UA_NETWORK_TCP_BUFFERPOOL_SIZE; i++) {
+        UA_Byte *data = (UA_Byte*)UA_atomic_xchg(&pool->slots[i], NULL);
+        if(data)
+            UA_free(BufferPool_item(data)->memory);
+    }
+}
+
 /****************************/
 /* Generic Socket Functions */
 /****************************/
@@ -44,12 +149,11 @@ connection_releaserecvbuffer(UA_Connection *connection,
     UA_ByteString_deleteMembers(buf);
 }
 
+/* Send the full buffer. The buffer is not freed. */
 static UA_StatusCode
-connection_write(UA_Connection *connection, UA_ByteString *buf) {
-    if(connection->state == UA_CONNECTION_CLOSED) {
-        UA_ByteString_deleteMembers(buf);
+connection_sendAll(UA_Connection *connection, const UA_ByteString *buf) {
+    if(connection->state == UA_CONNECTION_CLOSED)
         return UA_STATUSCODE_BADCONNECTIONCLOSED;
-    }
 
     /* Prevent OS signals when sending to a closed socket */
     int flags = 0;
@@ -66,21 +170,33 @@ connection_write(UA_Connection *connection, UA_ByteString *buf) {
                      bytes_to_send, flags);
             if(n < 0 && UA_ERRNO != UA_INTERRUPTED && UA_ERRNO != UA_AGAIN) {
                 connection->close(connection);
-                UA_ByteString_deleteMembers(buf);
                 return UA_STATUSCODE_BADCONNECTIONCLOSED;
             }
         } while(n < 0);
         nWritten += (size_t)n;
     } while(nWritten < buf->length);
+    return UA_STATUSCODE_GOOD;
+}
 
-    /* Free the buffer */
+static UA_StatusCode
+connection_write(UA_Connection *connection, UA_ByteString *buf) {
+    UA_StatusCode retval = connection_sendAll(connection, buf);
     UA_ByteString_deleteMembers(buf);
-    return UA_STATUSCODE_GOOD;
+    return retval;
+}
+
+/* Without a buffer pool, the receive buffer is allocated with malloc */
+static void
+connection_freeRecvBuffer(BufferPool *pool, UA_ByteString *buf) {
+    if(pool)
+        BufferPool_release(pool, buf);
+    else
+        UA_ByteString_deleteMembers(buf);
 }
 
 static UA_StatusCode
-connection_recv(UA_Connection *connection, UA_ByteString *response,
-                UA_UInt32 timeout) {
+connection_recvPooled(UA_Connection *connection, UA_ByteString *response,
+                      UA_UInt32 timeout, BufferPool *pool) {
     if(connection->state == UA_CONNECTION_CLOSED)
         return UA_STATUSCODE_BADCONNECTIONCLOSED;
 
@@ -111,10 +227,17 @@ connection_recv(UA_Connection *connection, UA_ByteString *response,
         }
     }
 
-    response->data = (UA_Byte*)UA_malloc(connection->config.recvBufferSize);
-    if(!response->data) {
-        response->length = 0;
-        return UA_STATUSCODE_BADOUTOFMEMORY; /* not enough memory retry */
+    if(pool) {
+        UA_StatusCode retval =
+            BufferPool_acquire(pool, connection->config.recvBufferSize, response);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval; /* not enough memory retry */
+    } else {
+        response->data = (UA_Byte*)UA_malloc(connection->config.recvBufferSize);
+        if(!response->data) {
+            response->length = 0;
+            return UA_STATUSCODE_BADOUTOFMEMORY; /* not enough memory retry */
+        }
     }
 
     size_t offset = connection->incompleteChunk.length;
@@ -126,14 +249,14 @@ connection_recv(UA_Connection *connection, UA_ByteString *response,
 
     /* The remote side closed the connection */
     if(ret == 0) {
-        UA_ByteString_deleteMembers(response);
+        connection_freeRecvBuffer(pool, response);
         connection->close(connection);
         return UA_STATUSCODE_BADCONNECTIONCLOSED;
     }
 
     /* Error case */
     if(ret < 0) {
-        UA_ByteString_deleteMembers(response);
+        connection_freeRecvBuffer(pool, response);
         if(UA_ERRNO == UA_INTERRUPTED || (timeout > 0) ?
            false : (UA_ERRNO == UA_EAGAIN || UA_ERRNO == UA_WOULDBLOCK))
             return UA_STATUSCODE_GOOD; /* statuscode_good but no data -> retry */
@@ -151,6 +274,12 @@ connection_recv(UA_Connection *connection, UA_ByteString *response,
     return UA_STATUSCODE_GOOD;
 }
 
+static UA_StatusCode
+connection_recv(UA_Connection *connection, UA_ByteString *response,
+                UA_UInt32 timeout) {
+    return connection_recvPooled(connection, response, timeout, NULL);
+}
+
 
 /***************************/
 /* Server NetworkLayer TCP */
@@ -171,8 +300,32 @@ typedef struct {
     UA_SOCKET serverSockets[FD_SETSIZE];
     UA_UInt16 serverSocketsSize;
     LIST_HEAD(, ConnectionEntry) connections;
+    BufferPool pool;
 } ServerNetworkLayerTCP;
 
+static UA_StatusCode
+ServerNetworkLayerTCP_getSendBuffer(UA_Connection *connection,
+                                    size_t length, UA_ByteString *buf) {
+    if(length > connection->config.sendBufferSize)
+        return UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP*)connection->handle;
+    return BufferPool_acquire(&layer->pool, length, buf);
+}
+
+static void
+ServerNetworkLayerTCP_releaseBuffer(UA_Connection *connection,
+                                    UA_ByteString *buf) {
+    ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP*)connection->handle;
+    BufferPool_release(&layer->pool, buf);
+}
+
+static UA_StatusCode
+ServerNetworkLayerTCP_write(UA_Connection *connection, UA_ByteString *buf) {
+    UA_StatusCode retval = connection_sendAll(connection, buf);
+    ServerNetworkLayerTCP_releaseBuffer(connection, buf);
+    return retval;
+}
+
 static void
 ServerNetworkLayerTCP_freeConnection(UA_Connection *connection) {
     UA_Connection_deleteMembers(connection);
@@ -240,12 +393,12 @@ ServerNetworkLayerTCP_add(UA_ServerNetworkLayer *nl, ServerNetworkLayerTCP *laye
     c->sockfd = newsockfd;
     c->handle = layer;
     c->config = nl->localConnectionConfig;
-    c->send = connection_write;
+    c->send = ServerNetworkLayerTCP_write;
     c->close = ServerNetworkLayerTCP_close;
     c->free = ServerNetworkLayerTCP_freeConnection;
-    c->getSendBuffer = connection_getsendbuffer;
-    c->releaseSendBuffer = connection_releasesendbuffer;
-    c->releaseRecvBuffer = connection_releaserecvbuffer;
+    c->getSendBuffer = ServerNetworkLayerTCP_getSendBuffer;
+    c->releaseSendBuffer = ServerNetworkLayerTCP_releaseBuffer;
+    c->releaseRecvBuffer = ServerNetworkLayerTCP_releaseBuffer;
     c->state = UA_CONNECTION_OPENING;
     c->openingDate = UA_DateTime_nowMonotonic();
 
@@ -324,6 +477,13 @@ ServerNetworkLayerTCP_start(UA_ServerNetworkLayer *nl, const UA_String *customHo
 
     ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP *)nl->handle;
 
+    /* Pooled buffers are large enough for both sending and receiving. Sizes
+     * negotiated during the HEL/ACK handshake never exceed the local ones. */
+    BufferPool_clear(&layer->pool);
+    layer->pool.bufferSize = nl->localConnectionConfig.sendBufferSize;
+    if(nl->localConnectionConfig.recvBufferSize > layer->pool.bufferSize)
+        layer->pool.bufferSize = nl->localConnectionConfig.recvBufferSize;
+
     /* Get the discovery url from the hostname */
     UA_String du = UA_STRING_NULL;
     char discoveryUrlBuffer[256];
@@ -458,12 +618,13 @@ ServerNetworkLayerTCP_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
                     (int)(e->connection.sockfd));
 
         UA_ByteString buf = UA_BYTESTRING_NULL;
-        UA_StatusCode retval = connection_recv(&e->connection, &buf, 0);
+        UA_StatusCode retval =
+            connection_recvPooled(&e->connection, &buf, 0, &layer->pool);
 
         if(retval == UA_STATUSCODE_GOOD) {
             /* Process packets */
             UA_Server_processBinaryMessage(server, &e->connection, &buf);
-            connection_releaserecvbuffer(&e->connection, &buf);
+            ServerNetworkLayerTCP_releaseBuffer(&e->connection, &buf);
         } else if(retval == UA_STATUSCODE_BADCONNECTIONCLOSED) {
             /* The socket is shutdown but not closed */
             UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
@@ -517,10 +678,27 @@ ServerNetworkLayerTCP_deleteMembers(UA_ServerNetworkLayer *nl) {
         UA_free(e);
     }
 
-    /* Free the layer */
+    /* Free the buffers and the layer */
+    BufferPool_clear(&layer->pool);
     UA_free(layer);
 }
 
+void
+UA_ServerNetworkLayerTCP_getBufferPoolStatistics(const UA_ServerNetworkLayer *nl,
+                                                 UA_NetworkBufferPoolStatistics *stats) {
+    memset(stats, 0, sizeof(UA_NetworkBufferPoolStatistics));
+    const ServerNetworkLayerTCP *layer = (const ServerNetworkLayerTCP*)nl->handle;
+    if(!layer)
+        return;
+    stats->bufferSize = layer->pool.bufferSize;
+    stats->hits = layer->pool.hits;
+    stats->misses = layer->pool.misses;
+    for(size_t i = 0; i < UA_NETWORK_TCP_BUFFERPOOL_SIZE; i++) {
+        if(layer->pool.slots[i])
+            stats->available++;
+    }
+}
+
 UA_ServerNetworkLayer
 UA_ServerNetworkLayerTCP(UA_ConnectionConfig config, UA_UInt16 port,
                          const UA_Logger *logger) {
@@ -575,6 +753,7 @@ ClientNetworkLayerTCP_free(UA_Connection *connection) {
         if(tcpConnection->server)
           UA_freeaddrinfo(tcpConnection->server);
         UA_free(tcpConnection);
+        connection->handle = NULL;
     }
 }
 
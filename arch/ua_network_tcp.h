@@ -18,6 +18,21 @@ extern "C" {
 UA_ServerNetworkLayer UA_EXPORT
 UA_ServerNetworkLayerTCP(UA_ConnectionConfig conf, UA_UInt16 port, const UA_Logger *logger);
 
+/* The server connections of the TCP network layer share a pool of send and
+ * receive buffers. A miss means that a buffer had to be allocated because the
+ * pool was empty (or the requested buffer was larger than the pooled ones). */
+typedef struct {
+    size_t bufferSize; /* Size of the pooled buffers */
+    size_t hits;       /* Buffers taken from the pool */
+    size_t misses;     /* Buffers that had to be allocated */
+    size_t available;  /* Buffers currently held in the pool */
+} UA_NetworkBufferPoolStatistics;
+
+/* Only use with a network layer created by UA_ServerNetworkLayerTCP */
+void UA_EXPORT
+UA_ServerNetworkLayerTCP_getBufferPoolStatistics(const UA_ServerNetworkLayer *nl,
+                                                 UA_NetworkBufferPoolStatistics *stats);
+
 UA_Connection UA_EXPORT
 UA_ClientConnectionTCP(UA_ConnectionConfig conf, const char *endpointUrl,
                        const UA_UInt32 timeout, const UA_Logger *logger);
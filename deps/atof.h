@@ -0,0 +1,26 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ATOF_H
+#define ATOF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ua_types.h"
+
+/* Parses a JSON number (not null terminated) into the correctly rounded
+ * floating point value. Returns false if the input is no JSON number or has
+ * too many significant digits for the fast algorithms. The caller then falls
+ * back to strtod. */
+UA_Boolean atofDouble(const char *s, size_t size, UA_Double *result);
+UA_Boolean atofFloat(const char *s, size_t size, UA_Float *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATOF_H */
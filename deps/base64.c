@@ -27,6 +27,10 @@
 
   YWxsIHlvdXIgYmFzZSBhcmUgYmVsb25nIHRvIHVz
 
+  Altered for open62541: Encoding and decoding into caller-provided buffers
+  with SSSE3 kernels for long inputs. Unpadded and malformed input no longer
+  reads or writes out of bounds.
+
 */
 
 #include "base64.h"
@@ -66,114 +70,223 @@ static const unsigned char unb64[]={
     0,   0,   0,   0,   0,   0,
 }; // This array has 256 elements
 
-// Converts binary data of length=len to base64 characters.
-// Length of the resultant string is stored in flen
-// (you must pass pointer flen).
-char* UA_base64( const void* binaryData, int len, int *flen )
-{
-    const unsigned char* bin = (const unsigned char*) binaryData ;
-    char* res ;
+#if defined(__GNUC__) && defined(__SSSE3__)
+#define UA_BASE64_SSSE3
+#include <tmmintrin.h>
 
-    int rc = 0 ; // result counter
-    int byteNo ; // I need this after the loop
+/* Vectorized kernels after Wojciech Muła and Alfred Klomp. 12 bytes are
+ * encoded into 16 characters per round and vice versa. */
 
-    int modulusLen = len % 3 ;
-    int pad = ((modulusLen&1)<<1) + ((modulusLen&2)>>1) ; // 2 gives 1 and 1 gives 2, but 0 gives 0.
+static __m128i
+enc_reshuffle(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                           4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
 
-    *flen = 4*(len + pad)/3 ;
-    res = (char*) malloc( (size_t)(*flen + 1) ) ; // and one for the null
-    if( !res )
-    {
-        puts( "ERROR: base64 could not allocate enough memory." ) ;
-        puts( "I must stop because I could not get enough" ) ;
+static __m128i
+enc_translate(__m128i in) {
+    const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4,
+                                      -4, -4, -4, -4, -19, -16, 0, 0);
+    __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    __m128i mask = _mm_cmpgt_epi8(in, _mm_set1_epi8(25));
+    indices = _mm_sub_epi8(indices, mask);
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+}
+
+/* Returns false if the 16 characters contain a byte outside the alphabet
+ * (including padding). The scalar decoder then takes over. */
+static int
+dec_block(const unsigned char *in, unsigned char *out) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2F = _mm_set1_epi8(0x2f);
+
+    __m128i str = _mm_loadu_si128((const __m128i*)(const void*)in);
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2F);
+    const __m128i lo_nibbles = _mm_and_si128(str, mask_2F);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    if(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())))
         return 0;
+
+    const __m128i eq_2F = _mm_cmpeq_epi8(str, mask_2F);
+    const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2F, hi_nibbles));
+    str = _mm_add_epi8(str, roll);
+
+    const __m128i merge_ab_and_bc = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+    __m128i res = _mm_madd_epi16(merge_ab_and_bc, _mm_set1_epi32(0x00011000));
+    res = _mm_shuffle_epi8(res, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                              8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128((__m128i*)(void*)out, res);
+    return 1;
+}
+#endif
+
+size_t UA_base64_encodedLength(size_t len)
+{
+    return 4 * ((len + 2) / 3);
+}
+
+void UA_base64_encode(const unsigned char *bin, size_t len, unsigned char *res)
+{
+    size_t byteNo = 0;
+    size_t rc = 0;
+
+#ifdef UA_BASE64_SSSE3
+    /* Reads 16 bytes and uses 12 of them */
+    for( ; byteNo + 16 <= len ; byteNo += 12, rc += 16 )
+    {
+        __m128i str = _mm_loadu_si128((const __m128i*)(const void*)&bin[byteNo]);
+        str = enc_translate(enc_reshuffle(str));
+        _mm_storeu_si128((__m128i*)(void*)&res[rc], str);
     }
+#endif
 
-    for( byteNo = 0 ; byteNo <= len-3 ; byteNo+=3 )
+    for( ; byteNo + 3 <= len ; byteNo += 3 )
     {
         unsigned char BYTE0=bin[byteNo];
         unsigned char BYTE1=bin[byteNo+1];
         unsigned char BYTE2=bin[byteNo+2];
-        res[rc++]  = b64[ BYTE0 >> 2 ] ;
-        res[rc++]  = b64[ ((0x3&BYTE0)<<4) + (BYTE1 >> 4) ] ;
-        res[rc++]  = b64[ ((0x0f&BYTE1)<<2) + (BYTE2>>6) ] ;
-        res[rc++]  = b64[ 0x3f&BYTE2 ] ;
+        res[rc++]  = (unsigned char)b64[ BYTE0 >> 2 ] ;
+        res[rc++]  = (unsigned char)b64[ ((0x3&BYTE0)<<4) + (BYTE1 >> 4) ] ;
+        res[rc++]  = (unsigned char)b64[ ((0x0f&BYTE1)<<2) + (BYTE2>>6) ] ;
+        res[rc++]  = (unsigned char)b64[ 0x3f&BYTE2 ] ;
     }
 
-    if( pad==2 )
+    if( len - byteNo == 1 )
     {
-        res[rc++] = b64[ bin[byteNo] >> 2 ] ;
-        res[rc++] = b64[ (0x3&bin[byteNo])<<4 ] ;
+        res[rc++] = (unsigned char)b64[ bin[byteNo] >> 2 ] ;
+        res[rc++] = (unsigned char)b64[ (0x3&bin[byteNo])<<4 ] ;
         res[rc++] = '=';
         res[rc++] = '=';
     }
-    else if( pad==1 )
+    else if( len - byteNo == 2 )
     {
-        res[rc++]  = b64[ bin[byteNo] >> 2 ] ;
-        res[rc++]  = b64[ ((0x3&bin[byteNo])<<4)   +   (bin[byteNo+1] >> 4) ] ;
-        res[rc++]  = b64[ (0x0f&bin[byteNo+1])<<2 ] ;
+        res[rc++]  = (unsigned char)b64[ bin[byteNo] >> 2 ] ;
+        res[rc++]  = (unsigned char)b64[ ((0x3&bin[byteNo])<<4)   +   (bin[byteNo+1] >> 4) ] ;
+        res[rc++]  = (unsigned char)b64[ (0x0f&bin[byteNo+1])<<2 ] ;
         res[rc++] = '=';
     }
+}
 
-    res[rc]=0; // NULL TERMINATOR! ;)
-    return res ;
+/* Strip up to two padding characters */
+static size_t unpaddedLength(const unsigned char *ascii, size_t len)
+{
+    if( len > 0 && ascii[len-1] == '=' ) --len;
+    if( len > 0 && ascii[len-1] == '=' ) --len;
+    return len;
 }
 
-unsigned char* UA_unbase64( const char* ascii, int len, int *flen )
+size_t UA_base64_decodedLength(const unsigned char *ascii, size_t len)
 {
-    const unsigned char *safeAsciiPtr = (const unsigned char*)ascii ;
-    unsigned char *bin ;
-    int cb=0;
-    int charNo;
-    int pad = 0 ;
+    len = unpaddedLength(ascii, len);
+    size_t tail = len % 4;
+    return 3*(len/4) + (tail > 1 ? tail - 1 : 0);
+}
 
-    if( len < 2 ) { // 2 accesses below would be OOB.
-        // catch empty string, return NULL as result.
-        puts( "ERROR: You passed an invalid base64 string (too short). You get NULL back." ) ;
-        *flen=0;
-        return 0 ;
-    }
-    if( safeAsciiPtr[ len-1 ]=='=' )  ++pad ;
-    if( safeAsciiPtr[ len-2 ]=='=' )  ++pad ;
+size_t UA_base64_decode(const unsigned char *ascii, size_t len, unsigned char *bin)
+{
+    size_t cb = 0;
+    size_t charNo = 0;
+    len = unpaddedLength(ascii, len);
 
-    *flen = 3*len/4 - pad ;
-    bin = (unsigned char*)malloc( (size_t) (*flen) ) ;
-    if( !bin )
+#ifdef UA_BASE64_SSSE3
+    /* Writes 16 bytes and uses 12 of them. At least 24 remaining characters
+     * ensure that there is space for the excess. */
+    for( ; charNo + 24 <= len ; charNo += 16, cb += 12 )
     {
-        puts( "ERROR: unbase64 could not allocate enough memory." ) ;
-        puts( "I must stop because I could not get enough" ) ;
-        return 0;
+        if( !dec_block(&ascii[charNo], &bin[cb]) )
+            break;
     }
+#endif
 
-    for( charNo=0; charNo <= len - 4 - pad ; charNo+=4 )
+    /* Characters outside the alphabet are decoded as zero */
+    for( ; charNo + 4 <= len ; charNo += 4 )
     {
-        int A=unb64[safeAsciiPtr[charNo]];
-        int B=unb64[safeAsciiPtr[charNo+1]];
-        int C=unb64[safeAsciiPtr[charNo+2]];
-        int D=unb64[safeAsciiPtr[charNo+3]];
+        int A=unb64[ascii[charNo]];
+        int B=unb64[ascii[charNo+1]];
+        int C=unb64[ascii[charNo+2]];
+        int D=unb64[ascii[charNo+3]];
 
         bin[cb++] = (unsigned char)((A<<2) | (B>>4)) ;
         bin[cb++] = (unsigned char)((B<<4) | (C>>2)) ;
         bin[cb++] = (unsigned char)((C<<6) | (D)) ;
     }
 
-    if( pad==1 )
+    if( len - charNo == 3 )
     {
-        int A=unb64[safeAsciiPtr[charNo]];
-        int B=unb64[safeAsciiPtr[charNo+1]];
-        int C=unb64[safeAsciiPtr[charNo+2]];
+        int A=unb64[ascii[charNo]];
+        int B=unb64[ascii[charNo+1]];
+        int C=unb64[ascii[charNo+2]];
 
         bin[cb++] = (unsigned char)((A<<2) | (B>>4)) ;
         bin[cb++] = (unsigned char)((B<<4) | (C>>2)) ;
     }
-    else if( pad==2 )
+    else if( len - charNo == 2 )
     {
-        int A=unb64[safeAsciiPtr[charNo]];
-        int B=unb64[safeAsciiPtr[charNo+1]];
+        int A=unb64[ascii[charNo]];
+        int B=unb64[ascii[charNo+1]];
 
         bin[cb++] = (unsigned char)((A<<2) | (B>>4)) ;
     }
 
-    return bin ;
+    return cb;
+}
+
+// Converts binary data of length=len to base64 characters.
+// Length of the resultant string is stored in flen
+// (you must pass pointer flen).
+char* UA_base64( const void* binaryData, int len, int *flen )
+{
+    char* res ;
+
+    if( len < 0 )
+        return 0;
+
+    *flen = (int)UA_base64_encodedLength((size_t)len) ;
+    res = (char*) malloc( (size_t)(*flen + 1) ) ; // and one for the null
+    if( !res )
+    {
+        puts( "ERROR: base64 could not allocate enough memory." ) ;
+        puts( "I must stop because I could not get enough" ) ;
+        return 0;
+    }
+
+    UA_base64_encode((const unsigned char*)binaryData, (size_t)len, (unsigned char*)res);
+    res[*flen]=0; // NULL TERMINATOR! ;)
+    return res ;
 }
 
+unsigned char* UA_unbase64( const char* ascii, int len, int *flen )
+{
+    const unsigned char *safeAsciiPtr = (const unsigned char*)ascii ;
+    unsigned char *bin ;
+
+    if( len < 2 ) { // 2 accesses below would be OOB.
+        // catch empty string, return NULL as result.
+        puts( "ERROR: You passed an invalid base64 string (too short). You get NULL back." ) ;
+        *flen=0;
+        return 0 ;
+    }
+
+    *flen = (int)UA_base64_decodedLength(safeAsciiPtr, (size_t)len) ;
+    bin = (unsigned char*)malloc( (size_t) (*flen) ) ;
+    if( !bin )
+    {
+        puts( "ERROR: unbase64 could not allocate enough memory." ) ;
+        puts( "I must stop because I could not get enough" ) ;
+        return 0;
+    }
+
+    UA_base64_decode(safeAsciiPtr, (size_t)len, bin);
+    return bin ;
+}
@@ -35,6 +35,23 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
+/* Length of the padded base64 encoding */
+size_t UA_base64_encodedLength(size_t len);
+
+/* Writes UA_base64_encodedLength(len) characters to the output. No null
+ * terminator is appended. */
+void UA_base64_encode(const unsigned char *bin, size_t len, unsigned char *res);
+
+/* Length of the decoded data */
+size_t UA_base64_decodedLength(const unsigned char *ascii, size_t len);
+
+/* Writes UA_base64_decodedLength(ascii, len) bytes to the output and returns
+ * the number of bytes written. Characters outside the base64 alphabet are
+ * decoded as zero. */
+size_t UA_base64_decode(const unsigned char *ascii, size_t len, unsigned char *bin);
+
 char* UA_base64( const void* binaryData, int len, int *flen );
 
 unsigned char* UA_unbase64( const char* ascii, int len, int *flen );
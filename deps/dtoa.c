@@ -0,0 +1,339 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Shortest round-trip formatting of floating point numbers with the Grisu2
+ * algorithm from F. Loitsch, "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers", PLDI 2010. The output always parses back to the
+ * input. In rare cases it has one digit more than the shortest possible
+ * representation. */
+
+#include "dtoa.h"
+
+#include <string.h>
+
+typedef struct {
+    UA_UInt64 f;
+    int e;
+} DiyFp;
+
+/* 10^k for k = -348 + 8*i, normalized to a 64bit significand and rounded */
+static const DiyFp cachedPowers[87] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, {0xbaaee17fa23ebf76ULL, -1193}, {0x8b16fb203055ac76ULL, -1166},
+    {0xcf42894a5dce35eaULL, -1140}, {0x9a6bb0aa55653b2dULL, -1113}, {0xe61acf033d1a45dfULL, -1087},
+    {0xab70fe17c79ac6caULL, -1060}, {0xff77b1fcbebcdc4fULL, -1034}, {0xbe5691ef416bd60cULL, -1007},
+    {0x8dd01fad907ffc3cULL, -980}, {0xd3515c2831559a83ULL, -954}, {0x9d71ac8fada6c9b5ULL, -927},
+    {0xea9c227723ee8bcbULL, -901}, {0xaecc49914078536dULL, -874}, {0x823c12795db6ce57ULL, -847},
+    {0xc21094364dfb5637ULL, -821}, {0x9096ea6f3848984fULL, -794}, {0xd77485cb25823ac7ULL, -768},
+    {0xa086cfcd97bf97f4ULL, -741}, {0xef340a98172aace5ULL, -715}, {0xb23867fb2a35b28eULL, -688},
+    {0x84c8d4dfd2c63f3bULL, -661}, {0xc5dd44271ad3cdbaULL, -635}, {0x936b9fcebb25c996ULL, -608},
+    {0xdbac6c247d62a584ULL, -582}, {0xa3ab66580d5fdaf6ULL, -555}, {0xf3e2f893dec3f126ULL, -529},
+    {0xb5b5ada8aaff80b8ULL, -502}, {0x87625f056c7c4a8bULL, -475}, {0xc9bcff6034c13053ULL, -449},
+    {0x964e858c91ba2655ULL, -422}, {0xdff9772470297ebdULL, -396}, {0xa6dfbd9fb8e5b88fULL, -369},
+    {0xf8a95fcf88747d94ULL, -343}, {0xb94470938fa89bcfULL, -316}, {0x8a08f0f8bf0f156bULL, -289},
+    {0xcdb02555653131b6ULL, -263}, {0x993fe2c6d07b7facULL, -236}, {0xe45c10c42a2b3b06ULL, -210},
+    {0xaa242499697392d3ULL, -183}, {0xfd87b5f28300ca0eULL, -157}, {0xbce5086492111aebULL, -130},
+    {0x8cbccc096f5088ccULL, -103}, {0xd1b71758e219652cULL, -77}, {0x9c40000000000000ULL, -50},
+    {0xe8d4a51000000000ULL, -24}, {0xad78ebc5ac620000ULL, 3}, {0x813f3978f8940984ULL, 30},
+    {0xc097ce7bc90715b3ULL, 56}, {0x8f7e32ce7bea5c70ULL, 83}, {0xd5d238a4abe98068ULL, 109},
+    {0x9f4f2726179a2245ULL, 136}, {0xed63a231d4c4fb27ULL, 162}, {0xb0de65388cc8ada8ULL, 189},
+    {0x83c7088e1aab65dbULL, 216}, {0xc45d1df942711d9aULL, 242}, {0x924d692ca61be758ULL, 269},
+    {0xda01ee641a708deaULL, 295}, {0xa26da3999aef774aULL, 322}, {0xf209787bb47d6b85ULL, 348},
+    {0xb454e4a179dd1877ULL, 375}, {0x865b86925b9bc5c2ULL, 402}, {0xc83553c5c8965d3dULL, 428},
+    {0x952ab45cfa97a0b3ULL, 455}, {0xde469fbd99a05fe3ULL, 481}, {0xa59bc234db398c25ULL, 508},
+    {0xf6c69a72a3989f5cULL, 534}, {0xb7dcbf5354e9beceULL, 561}, {0x88fcf317f22241e2ULL, 588},
+    {0xcc20ce9bd35c78a5ULL, 614}, {0x98165af37b2153dfULL, 641}, {0xe2a0b5dc971f303aULL, 667},
+    {0xa8d9d1535ce3b396ULL, 694}, {0xfb9b7cd9a4a7443cULL, 720}, {0xbb764c4ca7a44410ULL, 747},
+    {0x8bab8eefb6409c1aULL, 774}, {0xd01fef10a657842cULL, 800}, {0x9b10a4e5e9913129ULL, 827},
+    {0xe7109bfba19c0c9dULL, 853}, {0xac2820d9623bf429ULL, 880}, {0x80444b5e7aa7cf85ULL, 907},
+    {0xbf21e44003acdd2dULL, 933}, {0x8e679c2f5e44ff8fULL, 960}, {0xd433179d9c8cb841ULL, 986},
+    {0x9e19db92b4e31ba9ULL, 1013}, {0xeb96bf6ebadf77d9ULL, 1039}, {0xaf87023b9bf0ee6bULL, 1066},
+};
+
+static const UA_UInt64 powersOfTen[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+    1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static DiyFp
+diyFpNormalize(DiyFp v) {
+#if defined(__GNUC__) || defined(__clang__)
+    int s = __builtin_clzll(v.f);
+    v.f <<= s;
+    v.e -= s;
+#else
+    while(!(v.f & 0x8000000000000000ULL)) {
+        v.f <<= 1;
+        v.e--;
+    }
+#endif
+    return v;
+}
+
+/* Multiply and keep the (rounded) upper 64 bits */
+static DiyFp
+diyFpMultiply(DiyFp a, DiyFp b) {
+    DiyFp r;
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 p = (unsigned __int128)a.f * b.f;
+    r.f = (UA_UInt64)(p >> 64);
+    if((UA_UInt64)p & 0x8000000000000000ULL)
+        r.f++; /* Round */
+#else
+    const UA_UInt64 M32 = 0xFFFFFFFFULL;
+    UA_UInt64 a1 = a.f >> 32, a0 = a.f & M32;
+    UA_UInt64 b1 = b.f >> 32, b0 = b.f & M32;
+    UA_UInt64 x = a1 * b1, y = a0 * b1, z = a1 * b0, w = a0 * b0;
+    UA_UInt64 tmp = (w >> 32) + (y & M32) + (z & M32);
+    tmp += 1ULL << 31; /* Round */
+    r.f = x + (y >> 32) + (z >> 32) + (tmp >> 32);
+#endif
+    r.e = a.e + b.e + 64;
+    return r;
+}
+
+/* The value v = f * 2^e and the boundaries to its neighbors. m- and m+ share
+ * the exponent of the normalized m+. */
+static void
+normalizedBoundaries(UA_UInt64 f, int e, UA_Boolean lowerCloser,
+                     DiyFp *minus, DiyFp *plus) {
+    DiyFp pl = {(f << 1) + 1, e - 1};
+    pl = diyFpNormalize(pl);
+    DiyFp mi;
+    if(lowerCloser) {
+        mi.f = (f << 2) - 1;
+        mi.e = e - 2;
+    } else {
+        mi.f = (f << 1) - 1;
+        mi.e = e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+}
+
+/* Find a cached power c = 10^-K such that the binary exponent of w * c is in
+ * [-60, -32] */
+static DiyFp
+getCachedPower(int e, int *K) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347; /* dk must be positive */
+    int k = (int)dk;
+    if(dk - k > 0.0)
+        k++;
+    unsigned index = (unsigned)(k >> 3) + 1;
+    *K = -(-348 + (int)index * 8);
+    return cachedPowers[index];
+}
+
+static void
+grisuRound(char *buffer, size_t len, UA_UInt64 delta, UA_UInt64 rest,
+           UA_UInt64 tenKappa, UA_UInt64 wp_w) {
+    while(rest < wp_w && delta - rest >= tenKappa &&
+          (rest + tenKappa < wp_w || wp_w - rest > rest + tenKappa - wp_w)) {
+        buffer[len - 1]--;
+        rest += tenKappa;
+    }
+}
+
+static int
+countDecimalDigits32(UA_UInt32 n) {
+    int d = 1;
+    while(d < 10 && n >= powersOfTen[d])
+        d++;
+    return d;
+}
+
+static void
+digitGen(DiyFp W, DiyFp Mp, UA_UInt64 delta, char *buffer, size_t *len, int *K) {
+    DiyFp one = {1ULL << -Mp.e, Mp.e};
+    UA_UInt64 wp_w = Mp.f - W.f;
+    UA_UInt32 p1 = (UA_UInt32)(Mp.f >> -one.e);
+    UA_UInt64 p2 = Mp.f & (one.f - 1);
+    int kappa = countDecimalDigits32(p1);
+    *len = 0;
+
+    /* Integral part */
+    while(kappa > 0) {
+        UA_UInt32 div = (UA_UInt32)powersOfTen[kappa - 1];
+        UA_UInt32 d = p1 / div;
+        p1 %= div;
+        if(d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        kappa--;
+        UA_UInt64 tmp = ((UA_UInt64)p1 << -one.e) + p2;
+        if(tmp <= delta) {
+            *K += kappa;
+            grisuRound(buffer, *len, delta, tmp, powersOfTen[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    /* Fractional part */
+    for(;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if(d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if(p2 < delta) {
+            *K += kappa;
+            int index = -kappa;
+            grisuRound(buffer, *len, delta, p2, one.f,
+                       wp_w * (index < 20 ? powersOfTen[index] : 0));
+            return;
+        }
+    }
+}
+
+static void
+grisu2(UA_UInt64 f, int e, UA_Boolean lowerCloser,
+       char *buffer, size_t *len, int *K) {
+    DiyFp v = {f, e};
+    DiyFp w_m, w_p;
+    normalizedBoundaries(f, e, lowerCloser, &w_m, &w_p);
+
+    DiyFp c_mk = getCachedPower(w_p.e, K);
+    DiyFp W = diyFpMultiply(diyFpNormalize(v), c_mk);
+    DiyFp Wp = diyFpMultiply(w_p, c_mk);
+    DiyFp Wm = diyFpMultiply(w_m, c_mk);
+    Wm.f++;
+    Wp.f--;
+    digitGen(W, Wp, Wp.f - Wm.f, buffer, len, K);
+}
+
+static size_t
+writeExponent(int K, char *buffer) {
+    char *start = buffer;
+    if(K < 0) {
+        *buffer++ = '-';
+        K = -K;
+    } else {
+        *buffer++ = '+';
+    }
+    if(K >= 100) {
+        *buffer++ = (char)('0' + K / 100);
+        K %= 100;
+        *buffer++ = (char)('0' + K / 10);
+        *buffer++ = (char)('0' + K % 10);
+    } else if(K >= 10) {
+        *buffer++ = (char)('0' + K / 10);
+        *buffer++ = (char)('0' + K % 10);
+    } else {
+        *buffer++ = (char)('0' + K);
+    }
+    return (size_t)(buffer - start);
+}
+
+/* The value is buffer[0..length) * 10^k. Format it like JavaScript does, as
+ * an integer, a decimal fraction or in scientific notation. */
+static size_t
+prettify(char *buffer, size_t length, int k) {
+    int len = (int)length;
+    int kk = len + k; /* 10^(kk-1) <= v < 10^kk */
+
+    if(len <= kk && kk <= 21) {
+        /* 1234e7 -> 12340000000 */
+        for(int i = len; i < kk; i++)
+            buffer[i] = '0';
+        return (size_t)kk;
+    }
+
+    if(0 < kk && kk <= 21) {
+        /* 1234e-2 -> 12.34 */
+        memmove(&buffer[kk + 1], &buffer[kk], (size_t)(len - kk));
+        buffer[kk] = '.';
+        return (size_t)(len + 1);
+    }
+
+    if(-6 < kk && kk <= 0) {
+        /* 1234e-6 -> 0.001234 */
+        int offset = 2 - kk;
+        memmove(&buffer[offset], &buffer[0], (size_t)len);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        for(int i = 2; i < offset; i++)
+            buffer[i] = '0';
+        return (size_t)(len + offset);
+    }
+
+    if(len == 1) {
+        /* 1e30 */
+        buffer[1] = 'e';
+        return 2 + writeExponent(kk - 1, &buffer[2]);
+    }
+
+    /* 1234e30 -> 1.234e+33 */
+    memmove(&buffer[2], &buffer[1], (size_t)(len - 1));
+    buffer[1] = '.';
+    buffer[len + 1] = 'e';
+    return (size_t)len + 2 + writeExponent(kk - 1, &buffer[len + 2]);
+}
+
+size_t
+dtoa(UA_Double d, char *buffer) {
+    UA_UInt64 bits;
+    memcpy(&bits, &d, sizeof(UA_UInt64));
+    size_t pos = 0;
+    if(bits & 0x8000000000000000ULL) {
+        buffer[pos++] = '-';
+        bits &= ~0x8000000000000000ULL;
+    }
+    if(bits == 0) {
+        buffer[pos++] = '0';
+        return pos;
+    }
+
+    const UA_UInt64 hiddenBit = 1ULL << 52;
+    UA_UInt64 biasedExp = bits >> 52;
+    UA_UInt64 f = bits & (hiddenBit - 1);
+    int e;
+    if(biasedExp != 0) {
+        f += hiddenBit;
+        e = (int)biasedExp - 1075;
+    } else {
+        e = -1074;
+    }
+
+    size_t len;
+    int K;
+    grisu2(f, e, f == hiddenBit && biasedExp > 1, &buffer[pos], &len, &K);
+    return pos + prettify(&buffer[pos], len, K);
+}
+
+size_t
+ftoa(UA_Float flt, char *buffer) {
+    UA_UInt32 bits;
+    memcpy(&bits, &flt, sizeof(UA_UInt32));
+    size_t pos = 0;
+    if(bits & 0x80000000U) {
+        buffer[pos++] = '-';
+        bits &= ~0x80000000U;
+    }
+    if(bits == 0) {
+        buffer[pos++] = '0';
+        return pos;
+    }
+
+    const UA_UInt32 hiddenBit = 1U << 23;
+    UA_UInt32 biasedExp = bits >> 23;
+    UA_UInt32 f = bits & (hiddenBit - 1);
+    int e;
+    if(biasedExp != 0) {
+        f += hiddenBit;
+        e = (int)biasedExp - 150;
+    } else {
+        e = -149;
+    }
+
+    size_t len;
+    int K;
+    grisu2(f, e, f == hiddenBit && biasedExp > 1, &buffer[pos], &len, &K);
+    return pos + prettify(&buffer[pos], len, K);
+}
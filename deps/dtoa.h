@@ -0,0 +1,28 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef DTOA_H
+#define DTOA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ua_types.h"
+
+/* Maximum length of the output of dtoa and ftoa */
+#define UA_DTOA_MAXLENGTH 32
+
+/* Writes the shortest decimal representation of a finite floating point
+ * number that parses back to the same value (Grisu2). The output is not null
+ * terminated. Returns the number of characters written. */
+size_t dtoa(UA_Double d, char *buffer);
+size_t ftoa(UA_Float f, char *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DTOA_H */
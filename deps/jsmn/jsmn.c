@@ -1,4 +1,5 @@
 #include "jsmn.h"
+#include "../string_scan.h"
 
 #define JSMN_STRICT
 
@@ -93,7 +94,15 @@ static int jsmn_parse_string(jsmn_parser *parser, const char *js,
 
 	/* Skip starting quote */
 	for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
-		char c = js[parser->pos];
+		char c;
+
+		/* Skip ahead to the next quote, backslash or null byte */
+		parser->pos += (unsigned int)json_scanStringEnd(&js[parser->pos], len - parser->pos);
+		if (parser->pos >= len)
+			break;
+		c = js[parser->pos];
+		if (c == '\0')
+			break;
 
 		/* Quote: end of string */
 		if (c == '\"') {
@@ -0,0 +1,201 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "string_scan.h"
+#include "string_escape.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+# define UA_SCAN_SSE2
+# include <emmintrin.h>
+# if defined(__AVX2__)
+#  define UA_SCAN_AVX2
+#  include <immintrin.h>
+# endif
+#endif
+
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+/* Nonzero if one of the bytes of x is zero / less than n (n <= 128). Used to
+ * skip words without a match. The exact position is then found bytewise. */
+#define HASZERO(x) (((x) - ONES) & ~(x) & HIGHS)
+#define HASLESS(x, n) (((x) - ONES * (n)) & ~(x) & HIGHS)
+
+static UA_INLINE UA_UInt64
+loadWord(const char *s) {
+    UA_UInt64 w;
+    memcpy(&w, s, sizeof(UA_UInt64));
+    return w;
+}
+
+static UA_INLINE UA_Boolean
+isEscape(char c) {
+    return (c == '"' || c == '\\' || (unsigned char)c < 0x20);
+}
+
+static UA_INLINE UA_Boolean
+isStringEnd(char c) {
+    return (c == '"' || c == '\\' || c == 0);
+}
+
+#ifdef UA_SCAN_AVX2
+static UA_INLINE UA_UInt32
+escapeMask32(const char *s) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(const void*)s);
+    __m256i q = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+    __m256i b = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'));
+    __m256i c = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1F)), v);
+    return (UA_UInt32)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(q, b), c));
+}
+
+static UA_INLINE UA_UInt32
+stringEndMask32(const char *s) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(const void*)s);
+    __m256i q = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+    __m256i b = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'));
+    __m256i z = _mm256_cmpeq_epi8(v, _mm256_setzero_si256());
+    return (UA_UInt32)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(q, b), z));
+}
+
+static UA_INLINE UA_UInt32
+nonAsciiMask32(const char *s) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(const void*)s);
+    return (UA_UInt32)_mm256_movemask_epi8(v);
+}
+#endif
+
+#ifdef UA_SCAN_SSE2
+static UA_INLINE UA_UInt32
+escapeMask16(const char *s) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(const void*)s);
+    __m128i q = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+    __m128i b = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+    __m128i c = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v);
+    return (UA_UInt32)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(q, b), c));
+}
+
+static UA_INLINE UA_UInt32
+stringEndMask16(const char *s) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(const void*)s);
+    __m128i q = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+    __m128i b = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+    __m128i z = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+    return (UA_UInt32)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(q, b), z));
+}
+
+static UA_INLINE UA_UInt32
+nonAsciiMask16(const char *s) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(const void*)s);
+    return (UA_UInt32)_mm_movemask_epi8(v);
+}
+#endif
+
+size_t
+json_scanEscape(const char *s, size_t length) {
+    size_t i = 0;
+#ifdef UA_SCAN_AVX2
+    for(; i + 32 <= length; i += 32) {
+        UA_UInt32 m = escapeMask32(&s[i]);
+        if(m)
+            return i + (size_t)__builtin_ctz(m);
+    }
+#endif
+#ifdef UA_SCAN_SSE2
+    for(; i + 16 <= length; i += 16) {
+        UA_UInt32 m = escapeMask16(&s[i]);
+        if(m)
+            return i + (size_t)__builtin_ctz(m);
+    }
+#else
+    for(; i + 8 <= length; i += 8) {
+        UA_UInt64 w = loadWord(&s[i]);
+        if(HASZERO(w ^ (ONES * '"')) | HASZERO(w ^ (ONES * '\\')) | HASLESS(w, 0x20))
+            break;
+    }
+#endif
+    for(; i < length; i++) {
+        if(isEscape(s[i]))
+            return i;
+    }
+    return length;
+}
+
+size_t
+json_scanStringEnd(const char *s, size_t length) {
+    size_t i = 0;
+#ifdef UA_SCAN_AVX2
+    for(; i + 32 <= length; i += 32) {
+        UA_UInt32 m = stringEndMask32(&s[i]);
+        if(m)
+            return i + (size_t)__builtin_ctz(m);
+    }
+#endif
+#ifdef UA_SCAN_SSE2
+    for(; i + 16 <= length; i += 16) {
+        UA_UInt32 m = stringEndMask16(&s[i]);
+        if(m)
+            return i + (size_t)__builtin_ctz(m);
+    }
+#else
+    for(; i + 8 <= length; i += 8) {
+        UA_UInt64 w = loadWord(&s[i]);
+        if(HASZERO(w ^ (ONES * '"')) | HASZERO(w ^ (ONES * '\\')) | HASZERO(w))
+            break;
+    }
+#endif
+    for(; i < length; i++) {
+        if(isStringEnd(s[i]))
+            return i;
+    }
+    return length;
+}
+
+/* Returns the offset of the first byte that is not ASCII */
+static size_t
+scanAscii(const char *s, size_t length) {
+    size_t i = 0;
+#ifdef UA_SCAN_AVX2
+    for(; i + 32 <= length; i += 32) {
+        UA_UInt32 m = nonAsciiMask32(&s[i]);
+        if(m)
+            return i + (size_t)__builtin_ctz(m);
+    }
+#endif
+#ifdef UA_SCAN_SSE2
+    for(; i + 16 <= length; i += 16) {
+        UA_UInt32 m = nonAsciiMask16(&s[i]);
+        if(m)
+            return i + (size_t)__builtin_ctz(m);
+    }
+#else
+    for(; i + 8 <= length; i += 8) {
+        if(loadWord(&s[i]) & HIGHS)
+            break;
+    }
+#endif
+    for(; i < length; i++) {
+        if((unsigned char)s[i] >= 0x80)
+            return i;
+    }
+    return length;
+}
+
+UA_Boolean
+utf8_validate(const char *s, size_t length) {
+    size_t i = 0;
+    while(i < length) {
+        /* Skip ASCII runs in bulk */
+        i += scanAscii(&s[i], length - i);
+        if(i == length)
+            break;
+
+        /* Multi-byte sequence */
+        size_t count = utf8_check_first(s[i]);
+        if(count == 0 || count > length - i || !utf8_check_full(&s[i], count, NULL))
+            return false;
+        i += count;
+    }
+    return true;
+}
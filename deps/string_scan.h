@@ -0,0 +1,36 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef STRING_SCAN_H
+#define STRING_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ua_types.h"
+
+/* The scanners process 32 (AVX2) or 16 (SSE2) bytes at once when the compiler
+ * targets these instruction sets. Otherwise eight bytes are tested at once in
+ * a 64bit word. */
+
+/* Returns the offset of the first character that must be escaped in a JSON
+ * string (quotation mark, backslash or control character) or length if there
+ * is none. */
+size_t json_scanEscape(const char *s, size_t length);
+
+/* Returns the offset of the first quotation mark, backslash or null byte or
+ * length if there is none. */
+size_t json_scanStringEnd(const char *s, size_t length);
+
+/* Tests whether the string is valid UTF-8. Overlong encodings, surrogate
+ * halves and code points above U+10FFFF are rejected. */
+UA_Boolean utf8_validate(const char *s, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRING_SCAN_H */
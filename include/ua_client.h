@@ -534,6 +534,46 @@ UA_Client_removeCallback(UA_Client *client, UA_UInt64 callbackId);
 #define UA_Client_removeRepeatedCallback(client, callbackId) \
     UA_Client_removeCallback(client, callbackId)
 
+#ifdef UA_ENABLE_CLIENT_GROUP
+
+/**
+ * Client Groups
+ * -------------
+ * A client group services many clients from a single thread. The sockets of
+ * all clients in the group are registered in one epoll set (Linux only). An
+ * iteration of the group does the same work for every client as
+ * ``UA_Client_run_iterate(client, 0)``, but waits for the network events of
+ * all clients at once. Only the clients with received data are read from.
+ *
+ * The clients are connected and used as usual, e.g. with
+ * ``UA_Client_connect_async`` and the asynchronous service calls. A client must
+ * be removed from the group before it is deleted. Clients can be removed from
+ * within callbacks of the group iteration. */
+
+struct UA_ClientGroup;
+typedef struct UA_ClientGroup UA_ClientGroup;
+
+UA_ClientGroup UA_EXPORT *
+UA_ClientGroup_new(void);
+
+/* Deletes the group. The clients in the group are not deleted. */
+void UA_EXPORT
+UA_ClientGroup_delete(UA_ClientGroup *group);
+
+UA_StatusCode UA_EXPORT
+UA_ClientGroup_add(UA_ClientGroup *group, UA_Client *client);
+
+UA_StatusCode UA_EXPORT
+UA_ClientGroup_remove(UA_ClientGroup *group, UA_Client *client);
+
+/* Process the timed callbacks and network events of all clients in the group.
+ * Waits at most timeout milliseconds for network events. The wait is shortened
+ * to the next timed callback of a client. */
+UA_StatusCode UA_EXPORT
+UA_ClientGroup_run_iterate(UA_ClientGroup *group, UA_UInt16 timeout);
+
+#endif
+
 /**
  * .. toctree::
  *
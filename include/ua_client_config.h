@@ -83,6 +83,11 @@ typedef struct {
 
     void *clientContext;
 
+    /* Window of async requests that can be in flight at the same time. Sending
+     * an async request fails with UA_STATUSCODE_BADTOOMANYOPERATIONS when the
+     * window is full. PublishRequests are not counted. 0 -> unlimited */
+    UA_UInt32 maxPipelinedRequests;
+
 #ifdef UA_ENABLE_SUBSCRIPTIONS
     /* Number of PublishResponse queued up in the server */
     UA_UInt16 outStandingPublishRequests;
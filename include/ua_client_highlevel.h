@@ -212,6 +212,69 @@ UA_Client_readUserExecutableAttribute(UA_Client *client, const UA_NodeId nodeId,
                                      &UA_TYPES[UA_TYPES_BOOLEAN]);
 }
 
+/* Read many attributes with several pipelined ReadRequests. The items are split
+ * into requests of at most nodesPerRequest items (0 -> a single request). All
+ * requests are sent before the responses are awaited, limited by the window of
+ * maxPipelinedRequests in the client configuration. So the round-trip time is
+ * paid only once for a window of requests.
+ *
+ * The results array with nodesToReadSize entries is allocated by the caller.
+ * The DataValues are returned in the order of nodesToRead. If a request fails,
+ * its items get the StatusCode of the request. */
+UA_StatusCode UA_EXPORT
+UA_Client_readPipelined(UA_Client *client, const UA_ReadValueId *nodesToRead,
+                        size_t nodesToReadSize, size_t nodesPerRequest,
+                        UA_TimestampsToReturn timestampsToReturn,
+                        UA_DataValue *results);
+
+/**
+ * Read Planner
+ * ^^^^^^^^^^^^
+ * A read plan collects many reads and executes them with as few ReadRequests
+ * as possible. The reads are coalesced into requests that respect the
+ * ``MaxNodesPerRead`` OperationLimit of the server and the maximum message
+ * size negotiated for the connection. The requests are sent pipelined (see
+ * ``UA_Client_readPipelined``) and the results are scattered back to the
+ * registered reads.
+ *
+ * The requests are encoded once when the plan is prepared. A plan can be
+ * executed repeatedly, e.g. for cyclic polling from a repeated callback. Only
+ * the RequestHeader is encoded for every execution. */
+
+struct UA_ClientReadPlan;
+typedef struct UA_ClientReadPlan UA_ClientReadPlan;
+
+UA_ClientReadPlan UA_EXPORT *
+UA_ClientReadPlan_new(UA_TimestampsToReturn timestampsToReturn);
+
+void UA_EXPORT
+UA_ClientReadPlan_delete(UA_ClientReadPlan *plan);
+
+/* Register a read. The index of its result is returned in resultIndex (can be
+ * NULL). Adding a read discards the prepared requests. */
+UA_StatusCode UA_EXPORT
+UA_ClientReadPlan_add(UA_ClientReadPlan *plan, const UA_NodeId nodeId,
+                      UA_AttributeId attributeId, size_t *resultIndex);
+
+/* Read the OperationLimits of the server and prepare the encoded requests.
+ * Done automatically before the first execution. Prepare again after
+ * connecting to a different server. */
+UA_StatusCode UA_EXPORT
+UA_ClientReadPlan_prepare(UA_ClientReadPlan *plan, UA_Client *client);
+
+/* Execute all reads of the plan. Returns when all responses have arrived. */
+UA_StatusCode UA_EXPORT
+UA_ClientReadPlan_execute(UA_ClientReadPlan *plan, UA_Client *client);
+
+/* The result of the last execution. Valid until the next execution. Returns
+ * NULL if the index is out of range. */
+const UA_DataValue UA_EXPORT *
+UA_ClientReadPlan_getResult(const UA_ClientReadPlan *plan, size_t resultIndex);
+
+/* Number of prepared ReadRequests */
+size_t UA_EXPORT
+UA_ClientReadPlan_getRequestsSize(const UA_ClientReadPlan *plan);
+
 /**
  * Historical Access
  * ^^^^^^^^^^^^^^^^^
@@ -73,8 +73,28 @@ struct UA_HistoryDatabase {
                UA_HistoryReadResponse *response,
                UA_HistoryData * const * const historyData);
 
+    /* This function is called if a history read is requested with
+     * ReadProcessedDetails. Setting it to NULL will result in a response with
+     * statuscode UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED.
+     *
+     * The parameters are the same as for readRaw. The service checked that
+     * historyReadDetails contains one aggregate per node to read. */
+    void
+    (*readProcessed)(UA_Server *server,
+                     void *hdbContext,
+                     const UA_NodeId *sessionId,
+                     void *sessionContext,
+                     const UA_RequestHeader *requestHeader,
+                     const UA_ReadProcessedDetails *historyReadDetails,
+                     UA_TimestampsToReturn timestampsToReturn,
+                     UA_Boolean releaseContinuationPoints,
+                     size_t nodesToReadSize,
+                     const UA_HistoryReadValueId *nodesToRead,
+                     UA_HistoryReadResponse *response,
+                     UA_HistoryData * const * const historyData);
+
     /* Add more function pointer here.
-     * For example for read_event, read_modified, read_processed, read_at_time */
+     * For example for read_event, read_modified, read_at_time */
 };
 
 _UA_END_DECLS
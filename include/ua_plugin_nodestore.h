@@ -72,6 +72,16 @@ typedef struct {
     UA_Boolean isInverse;
     size_t targetIdsSize;
     UA_ExpandedNodeId *targetIds;
+
+    /* Members specific to open62541. They are owned by UA_Node_addReference,
+     * UA_Node_deleteReference and UA_Node_copy. Long lists of targets get a
+     * hash index. Every slot contains the position of a target in targetIds
+     * plus one (zero for empty slots). Code that sets targetIds directly
+     * leaves the capacity and the index zeroed. They are rebuilt when the
+     * targets are changed with the above functions. */
+    size_t targetIdsCapacity;
+    size_t targetIdsIndexSize; /* Power of two or zero */
+    size_t *targetIdsIndex;
 } UA_NodeReferenceKind;
 
 #define UA_NODE_BASEATTRIBUTES                  \
@@ -27,7 +27,7 @@ _UA_BEGIN_DECLS
  * 'Connection' -> OPC UA standard 'highlevel' perspective,
  * 'Channel' -> open62541 implementation 'lowlevel' perspective. A channel can be assigned with different
  * network implementations like UDP, MQTT, AMQP. The channel provides basis services
- * like send, regist, unregist, receive, close.
+ * like send, sendBatch, regist, unregist, receive, receiveBatch, close.
  */
 
 typedef enum {
@@ -57,6 +57,11 @@ struct UA_PubSubChannel {
     UA_StatusCode (*send)(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
                           const UA_ByteString *buf);
 
+    /* Sending out several messages at once. The messages are sent in order.
+     * Optional, NULL if the implementation sends every message with send. */
+    UA_StatusCode (*sendBatch)(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+                               const UA_ByteString *bufs, size_t bufsSize);
+
     /* Register to an specified message source, e.g. multicast group or topic */
     UA_StatusCode (*regist)(UA_PubSubChannel * channel, UA_ExtensionObject *transportSettings);
 
@@ -67,6 +72,16 @@ struct UA_PubSubChannel {
     UA_StatusCode (*receive)(UA_PubSubChannel * channel, UA_ByteString *,
                              UA_ExtensionObject *transportSettings, UA_UInt32 timeout);
 
+    /* Receiving several messages at once. On input, messagesSize is the number
+     * of provided buffers and the length of a buffer is its capacity. On
+     * output, messagesSize is the number of received messages. Waits at most
+     * timeout usec for the first message and does not block if the timeout is
+     * zero. Optional, NULL if the implementation receives every message with
+     * receive. */
+    UA_StatusCode (*receiveBatch)(UA_PubSubChannel *channel, UA_ByteString *messages,
+                                  size_t *messagesSize, UA_ExtensionObject *transportSettings,
+                                  UA_UInt32 timeout);
+
     /* Closing the connection and implicit free of the channel structures. */
     UA_StatusCode (*close)(UA_PubSubChannel *channel);
 };
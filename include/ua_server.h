@@ -1197,6 +1197,163 @@ UA_Server_addMethodNode_finish(UA_Server *server, const UA_NodeId nodeId,
 
 #endif
 
+/**
+ * Bulk Loading
+ * ^^^^^^^^^^^^
+ * Large address spaces (e.g. generated from a plant model) are loaded in a
+ * bulk-load transaction. The nodes and references are staged first and
+ * committed to the nodestore together:
+ *
+ *  - The type checks are made once per distinct type definition and reference
+ *    type. Variables are checked against the DataType of the VariableType only
+ *    when it differs from the DataType of the previous instance.
+ *  - Both directions of all references are computed in one pass. Staged nodes
+ *    get their references before they are inserted. Nodes that exist already
+ *    are copied and replaced once for all their new references.
+ *  - DataTypes and ReferenceTypes are committed first, then ObjectTypes and
+ *    VariableTypes and then all other nodes. So instances may use types that
+ *    are staged in the same bulk load.
+ *
+ * The checks are the same as for UA_Server_addNode_begin, but values are not
+ * converted to the DataType of the variable. Unlike _finish, the mandatory
+ * children of the type definition are not instantiated. The bulk load needs to
+ * contain the complete hierarchy of the instances (as a nodeset does). The
+ * constructors are called after all nodes are committed.
+ *
+ * A node that fails the checks is not committed, and neither are the staged
+ * nodes below it. This includes a node whose NodeId exists already. The staged
+ * nodes below it are not added to the existing node. The other nodes are
+ * committed nonetheless. */
+
+typedef struct UA_BulkLoad UA_BulkLoad;
+
+UA_StatusCode UA_EXPORT
+UA_Server_bulkLoad_begin(UA_Server *server, UA_BulkLoad **bulkLoad);
+
+/* Stages a node. The arguments are the same as for UA_Server_addNode_begin.
+ * The requested NodeId must not be null. An error is returned if the node
+ * cannot be created. The checks against other nodes are made during the
+ * commit. */
+UA_StatusCode UA_EXPORT
+UA_BulkLoad_addNode(UA_BulkLoad *bulkLoad, const UA_NodeClass nodeClass,
+                    const UA_NodeId requestedNewNodeId,
+                    const UA_NodeId parentNodeId,
+                    const UA_NodeId referenceTypeId,
+                    const UA_QualifiedName browseName,
+                    const UA_NodeId typeDefinition,
+                    const void *attr, const UA_DataType *attributeType,
+                    void *nodeContext);
+
+/* Stages an additional reference. Both ends may be staged or exist already. */
+UA_StatusCode UA_EXPORT
+UA_BulkLoad_addReference(UA_BulkLoad *bulkLoad, const UA_NodeId sourceId,
+                         const UA_NodeId refTypeId,
+                         const UA_ExpandedNodeId targetId, UA_Boolean isForward);
+
+/* Commits the staged nodes and references and deletes the bulk load. If
+ * results is not NULL, it is set to an array with the status of every staged
+ * node followed by the status of every staged reference, in the order they
+ * were added. The first failure is returned. */
+UA_StatusCode UA_EXPORT
+UA_BulkLoad_commit(UA_BulkLoad *bulkLoad, size_t *resultsSize,
+                   UA_StatusCode **results);
+
+/* Discards the bulk load without changing the nodestore */
+void UA_EXPORT
+UA_BulkLoad_delete(UA_BulkLoad *bulkLoad);
+
+/**
+ * Node Tables
+ * ^^^^^^^^^^^
+ * The nodeset compiler generates a node table with the ``open62541_table``
+ * backend. The nodes and references are static const arrays that are loaded
+ * in one bulk load. Strings and values are taken from a pool of bytes that is
+ * shared by all nodes of the table. Equal strings are pooled only once.
+ *
+ * - Strings in the pool are encoded as in the binary protocol (Int32 length
+ *   and UTF-8 characters). They are not copied when the nodes are staged.
+ * - Values are encoded as in the binary protocol without the ExtensionObject
+ *   wrapper. Arrays are encoded as consecutive elements.
+ * - Namespace indices in the table and in the encoded values refer to the
+ *   namespaces of the table. They are replaced with the namespace indices of
+ *   the server during the load.
+ *
+ * Positions in the pool that are not set are ``UA_NODETABLE_NONE``. */
+
+#define UA_NODETABLE_NONE 0xffffffff
+
+/* Node flags for the boolean attributes */
+#define UA_NODETABLE_ISABSTRACT 0x01
+#define UA_NODETABLE_SYMMETRIC 0x02
+#define UA_NODETABLE_HISTORIZING 0x04
+#define UA_NODETABLE_EXECUTABLE 0x08
+#define UA_NODETABLE_USEREXECUTABLE 0x10
+#define UA_NODETABLE_CONTAINSNOLOOPS 0x20
+
+typedef struct {
+    UA_UInt16 namespaceIndex; /* Index in the namespaces of the table */
+    UA_Byte identifierType;   /* UA_NODEIDTYPE_NUMERIC or _STRING */
+    UA_UInt32 identifier;     /* Numeric identifier or position of the string */
+} UA_NodeTableId;
+
+typedef struct {
+    const UA_DataType *valueType; /* NULL if the variable has no value */
+    UA_NodeTableId dataType;
+    UA_Int32 valueRank;
+    UA_UInt32 arrayDimensions;    /* valueRank UInt32 in the pool */
+    UA_Int32 valueSize;           /* -1 for a scalar, else the array length */
+    UA_UInt32 value;              /* _NONE for a default-initialized scalar */
+    UA_Double minimumSamplingInterval;
+    UA_Byte accessLevel;
+    UA_Byte userAccessLevel;
+} UA_NodeTableVariable;
+
+typedef struct {
+    UA_NodeClass nodeClass;
+    UA_Byte flags;
+    UA_Byte eventNotifier;
+    UA_NodeTableId nodeId;
+    UA_NodeTableId parentNodeId;
+    UA_NodeTableId referenceTypeId;
+    UA_NodeTableId typeDefinition;
+    UA_UInt16 browseNameNamespace;
+    UA_UInt32 browseName;
+    UA_UInt32 displayNameLocale;
+    UA_UInt32 displayNameText;
+    UA_UInt32 descriptionLocale;
+    UA_UInt32 descriptionText;
+    UA_UInt32 inverseName;        /* Only for ReferenceTypes */
+    UA_UInt32 writeMask;
+    UA_UInt32 userWriteMask;
+    UA_UInt32 variable;           /* Index in the variables for Variables and
+                                   * VariableTypes. Otherwise _NONE. */
+} UA_NodeTableNode;
+
+typedef struct {
+    UA_NodeTableId source;
+    UA_NodeTableId referenceType;
+    UA_NodeTableId target;
+    UA_Boolean isForward;
+} UA_NodeTableReference;
+
+typedef struct {
+    size_t namespacesSize;
+    const UA_UInt32 *namespaces;  /* Positions of the namespace uris */
+    size_t nodesSize;
+    const UA_NodeTableNode *nodes;
+    size_t variablesSize;
+    const UA_NodeTableVariable *variables;
+    size_t referencesSize;
+    const UA_NodeTableReference *references;
+    size_t poolSize;
+    const UA_Byte *pool;
+} UA_NodeTable;
+
+/* Adds the namespaces of the table to the server and loads the nodes and
+ * references in one bulk load. The first failure is returned. */
+UA_StatusCode UA_EXPORT
+UA_Server_loadNodeTable(UA_Server *server, const UA_NodeTable *table);
+
 /* Deletes a node and optionally all references leading to the node. */
 UA_StatusCode UA_EXPORT
 UA_Server_deleteNode(UA_Server *server, const UA_NodeId nodeId,
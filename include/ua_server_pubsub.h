@@ -58,8 +58,12 @@ _UA_BEGIN_DECLS
  *   |        |                   +------------------+                                     |
  *   |        |                                                                            |
  *   |        |         +----------------+                                                 | r
- *   |        +---------> UA_ReaderGroup |                                                 | e
+ *   |        +---------> UA_ReaderGroup |  UA_Server_addReaderGroup                       | e
  *   |                  +----------------+                                                 | f
+ *   |                       |                                                             |
+ *   |                       |    +------------------+                                     |
+ *   |                       +----> UA_DataSetReader |  UA_Server_addDataSetReader         |
+ *   |                            +------------------+                                     |
  *   |                                                                                     |
  *   |       +---------------------------+                                                 |
  *   +-------> UA_PubSubPublishedDataSet |  UA_Server_addPublishedDataSet                <-+
@@ -79,6 +83,8 @@ _UA_BEGIN_DECLS
  *  Compile the human-readable name of the StatusCodes into the binary. Disabled by default.
  * **UA_ENABLE_PUBSUB_INFORMATIONMODEL**
  *  Enable the information model representation of the PubSub configuration. For more details take a look at the following section `PubSub Information Model Representation`. Disabled by default.
+ * **UA_ENABLE_PUBSUB_PUBLISHER_THREADS**
+ *  Enable WriterGroups that publish from a dedicated thread with absolute deadlines instead of the server timer. Linux only. Disabled by default.
  *
  * PubSub Information Model Representation
  * ----------------------------------------
@@ -132,7 +138,7 @@ UA_Server_getPubSubConnectionConfig(UA_Server *server,
                                     UA_PubSubConnectionConfig *config);
 
 /* Remove Connection, identified by the NodeId. Deletion of Connection
- * removes all contained WriterGroups and Writers. */
+ * removes all contained WriterGroups, ReaderGroups, Writers and Readers. */
 UA_StatusCode UA_EXPORT
 UA_Server_removePubSubConnection(UA_Server *server, const UA_NodeId connection);
 
@@ -222,11 +228,43 @@ UA_Server_removePublishedDataSet(UA_Server *server, const UA_NodeId pds);
  * DataSetField has additional parameters for the publishing, sampling and error
  * handling process. */
 
+/* The value of a DataSetField can be sampled directly from application memory
+ * instead of reading the published variable through the server. The DataValue
+ * is owned by the application and must stay valid while the field exists. The
+ * content must be updated in place, i.e. the data of the variant must not be
+ * reallocated.
+ *
+ * If the application updates the value from a different thread, the optional
+ * sequence counter is used as a seqlock. Every update is wrapped in
+ * UA_DataSetFieldExternalValue_beginUpdate and
+ * UA_DataSetFieldExternalValue_endUpdate. The publisher samples again if the
+ * value was updated in the meantime. Like all atomic operations in the SDK, the
+ * memory barriers require UA_ENABLE_MULTITHREADING or
+ * UA_ENABLE_PUBSUB_PUBLISHER_THREADS. */
+typedef struct {
+    UA_Boolean enabled;
+    UA_DataValue *value;
+    volatile UA_UInt32 *sequenceCounter;
+} UA_DataSetFieldExternalValue;
+
+static UA_INLINE void
+UA_DataSetFieldExternalValue_beginUpdate(volatile UA_UInt32 *sequenceCounter) {
+    UA_atomic_addUInt32(sequenceCounter, 1); /* Odd during the update */
+    UA_atomic_sync();
+}
+
+static UA_INLINE void
+UA_DataSetFieldExternalValue_endUpdate(volatile UA_UInt32 *sequenceCounter) {
+    UA_atomic_sync();
+    UA_atomic_addUInt32(sequenceCounter, 1);
+}
+
 typedef struct{
     UA_ConfigurationVersionDataType configurationVersion;
     UA_String fieldNameAlias;
     UA_Boolean promotedField;
     UA_PublishedVariableDataType publishParameters;
+    UA_DataSetFieldExternalValue externalValue;
 } UA_DataSetVariableConfig;
 
 typedef enum {
@@ -280,6 +318,23 @@ typedef enum {
     UA_PUBSUB_ENCODING_UADP
 } UA_PubSubEncodingType;
 
+typedef enum {
+    UA_PUBSUB_RT_NONE = 0,
+    UA_PUBSUB_RT_FIXED_SIZE = 1
+} UA_PubSubRTLevel;
+
+typedef enum {
+    UA_PUBSUB_CLOCK_MONOTONIC = 0,
+    UA_PUBSUB_CLOCK_TAI = 1
+} UA_PubSubClock;
+
+typedef struct {
+    UA_Boolean enabled;
+    UA_PubSubClock clock;   /* Clock of the publishing deadlines */
+    UA_Int32 priority;      /* SCHED_FIFO priority. 0 keeps the default
+                             * scheduling of the server process. */
+} UA_WriterGroupThreadConfig;
+
 typedef struct {
     UA_String name;
     UA_Boolean enabled;
@@ -297,6 +352,18 @@ typedef struct {
     /* non std. config parameter. maximum count of embedded DataSetMessage in
      * one NetworkMessage */
     UA_UInt16 maxEncapsulatedDataSetMessageCount;
+
+    /* non std. config parameter. With UA_PUBSUB_RT_FIXED_SIZE, the
+     * NetworkMessages are encoded once into a template. Every publish cycle
+     * only patches the sequence numbers, timestamps and field values in place.
+     * The template is rebuilt when the configuration changes or when the
+     * encoded size of a field value differs from the template. Only UADP
+     * messages without promoted fields are frozen. DeltaFrames are not sent. */
+    UA_PubSubRTLevel rtLevel;
+
+    /* non std. config parameter. Publish from a dedicated thread instead of
+     * the server timer. See the section on publisher threads below. */
+    UA_WriterGroupThreadConfig publisherThread;
 } UA_WriterGroupConfig;
 
 void UA_EXPORT
@@ -320,6 +387,39 @@ UA_Server_updateWriterGroupConfig(UA_Server *server, UA_NodeId writerGroupIdenti
 UA_StatusCode UA_EXPORT
 UA_Server_removeWriterGroup(UA_Server *server, const UA_NodeId writerGroup);
 
+/**
+ * Publisher Threads
+ * ^^^^^^^^^^^^^^^^^
+ * By default, the WriterGroups publish from a repeated callback of the server
+ * timer. The cycle time then jitters with everything else that is processed
+ * in ``UA_Server_run_iterate``. With UA_ENABLE_PUBSUB_PUBLISHER_THREADS, a
+ * WriterGroup can publish from its own thread instead. The thread sleeps until
+ * the absolute deadline of the next cycle on the configured clock. Deadlines
+ * that are missed because a cycle overran are skipped, not caught up.
+ *
+ * The publisher thread does not access the information model. All
+ * DataSetFields published by the WriterGroup must sample an external value
+ * with a sequence counter (see the section on DataSetFields). Cycles where
+ * this is not the case are skipped. Changes of the PubSub configuration are
+ * serialized with the publish cycles. The publisher threads keep running until the
+ * WriterGroup is removed, also while the server main loop is not iterated. */
+
+typedef struct {
+    UA_UInt64 cycles;             /* Publish cycles, including skipped ones */
+    UA_UInt64 missedDeadlines;    /* Deadlines skipped after an overrun */
+    UA_UInt64 skippedCycles;      /* Cycles without a thread-safe DataSet */
+    UA_Int64 minWakeupLatency;    /* Wake-up after the deadline in ns */
+    UA_Int64 maxWakeupLatency;
+    UA_Int64 totalWakeupLatency;
+    UA_Int64 maxCycleTime;        /* Deadline to end of the cycle in ns */
+} UA_WriterGroupThreadStatistics;
+
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+UA_StatusCode UA_EXPORT
+UA_Server_getWriterGroupThreadStatistics(UA_Server *server, const UA_NodeId writerGroup,
+                                         UA_WriterGroupThreadStatistics *statistics);
+#endif
+
 /**
  * .. _dsw:
  *
@@ -365,6 +465,103 @@ UA_Server_getDataSetWriterConfig(UA_Server *server, const UA_NodeId dsw,
 UA_StatusCode UA_EXPORT
 UA_Server_removeDataSetWriter(UA_Server *server, const UA_NodeId dsw);
 
+/**
+ * ReaderGroup
+ * -----------
+ * ReaderGroups are created within a PubSubConnection and are the counterpart
+ * of the WriterGroups. The ReaderGroup registers the connection at its message
+ * source, e.g. joins the multicast group, and receives the NetworkMessages in
+ * every subscribing interval. The messages are handed to the contained
+ * :ref:`dsr`. */
+
+typedef struct {
+    UA_String name;
+    UA_Duration subscribingInterval;
+
+    /* non std. config parameter. Upper bound for the NetworkMessages that are
+     * received and processed in one subscribing interval. Zero selects a
+     * default value. */
+    UA_UInt32 maxMessagesPerInterval;
+} UA_ReaderGroupConfig;
+
+void UA_EXPORT
+UA_ReaderGroupConfig_deleteMembers(UA_ReaderGroupConfig *readerGroupConfig);
+
+/* Add a new ReaderGroup to an existing Connection */
+UA_StatusCode UA_EXPORT
+UA_Server_addReaderGroup(UA_Server *server, const UA_NodeId connection,
+                         const UA_ReaderGroupConfig *readerGroupConfig,
+                         UA_NodeId *readerGroupIdentifier);
+
+/* Returns a deep copy of the config */
+UA_StatusCode UA_EXPORT
+UA_Server_getReaderGroupConfig(UA_Server *server, const UA_NodeId readerGroup,
+                               UA_ReaderGroupConfig *config);
+
+/* Remove the ReaderGroup and all contained DataSetReaders */
+UA_StatusCode UA_EXPORT
+UA_Server_removeReaderGroup(UA_Server *server, const UA_NodeId readerGroup);
+
+/**
+ * .. _dsr:
+ *
+ * DataSetReader
+ * -------------
+ * A DataSetReader selects the DataSetMessages of one DataSetWriter from the
+ * received NetworkMessages and writes the fields into the target variables.
+ * The NetworkMessages are filtered by the PublisherId, the WriterGroupId and
+ * the DataSetWriterId from the message headers. The payload of a message is
+ * only decoded if a DataSetReader of the ReaderGroup matches. */
+
+/* The field with the same index in the DataSetMessage is written into the
+ * target variable. With an enabled external value, the field is written
+ * directly into application memory instead of the information model. The
+ * DataValue must contain a scalar of the field type. The update is wrapped in
+ * UA_DataSetFieldExternalValue_beginUpdate and
+ * UA_DataSetFieldExternalValue_endUpdate if the sequence counter is set. */
+typedef struct {
+    UA_NodeId targetNodeId;
+    UA_DataSetFieldExternalValue externalValue;
+} UA_DataSetReaderTarget;
+
+typedef struct {
+    UA_String name;
+    /* An empty variant matches every PublisherId. Otherwise a scalar of the
+     * type UInt32 or String. */
+    UA_Variant publisherId;
+    UA_UInt16 writerGroupId;   /* Zero matches every WriterGroup */
+    UA_UInt16 dataSetWriterId; /* Zero matches every DataSetWriter */
+    size_t targetVariablesSize;
+    UA_DataSetReaderTarget *targetVariables;
+
+    /* non std. config parameter. With UA_PUBSUB_RT_FIXED_SIZE, the layout of
+     * received NetworkMessages with scalar fields of a fixed encoded size is
+     * learned once. Only unsecured KeyFrames with Variant field encoding and
+     * without promoted fields, NetworkMessage timestamps and group sequence
+     * numbers are learned. Messages with the same layout are not decoded. The field
+     * values are read from the precomputed offsets and written into the
+     * targets. A message that deviates from the layout is decoded regularly
+     * and the layout is learned again. */
+    UA_PubSubRTLevel rtLevel;
+} UA_DataSetReaderConfig;
+
+void UA_EXPORT
+UA_DataSetReaderConfig_deleteMembers(UA_DataSetReaderConfig *dataSetReaderConfig);
+
+/* Add a new DataSetReader to an existing ReaderGroup */
+UA_StatusCode UA_EXPORT
+UA_Server_addDataSetReader(UA_Server *server, const UA_NodeId readerGroup,
+                           const UA_DataSetReaderConfig *dataSetReaderConfig,
+                           UA_NodeId *readerIdentifier);
+
+/* Returns a deep copy of the config */
+UA_StatusCode UA_EXPORT
+UA_Server_getDataSetReaderConfig(UA_Server *server, const UA_NodeId dsr,
+                                 UA_DataSetReaderConfig *config);
+
+UA_StatusCode UA_EXPORT
+UA_Server_removeDataSetReader(UA_Server *server, const UA_NodeId dsr);
+
 #endif /* UA_ENABLE_PUBSUB */
     
 _UA_END_DECLS
@@ -55,6 +55,12 @@ UA_StatusCode UA_EXPORT
 UA_parseEndpointUrlEthernet(const UA_String *endpointUrl, UA_String *target,
                             UA_UInt16 *vid, UA_Byte *pcp);
 
+/* Convert the given byte string to a positive number in the given base.
+ * Returns the number of valid digits. Stops if a non-digit char is found and
+ * returns the number of digits up to that point. */
+size_t UA_EXPORT
+UA_readNumberWithBase(UA_Byte *buf, size_t buflen, UA_UInt32 *number, UA_Byte base);
+
 /**
  * Convenience macros for complex types
  * ------------------------------------ */
@@ -0,0 +1,766 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ua_historydatabackend_async.h"
+
+#ifdef UA_ENABLE_HISTORIZING_ASYNC /* conditional compilation */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define UA_ASYNC_DEFAULT_QUEUESIZE 4096
+#define UA_ASYNC_DEFAULT_BATCHSIZE 256
+#define UA_ASYNC_DEFAULT_FLUSHINTERVAL 10 /* in ms */
+
+typedef struct {
+    UA_NodeId nodeId;
+    UA_UInt32 hash;
+    size_t handle; /* Creation order. Groups the samples of a batch. */
+} UA_AsyncSeries;
+
+/* Cell of the bounded multi-producer single-consumer queue. The cell is free
+ * for the enqueue position p if sequence == p. It holds the sample for the
+ * dequeue position p if sequence == p + 1. */
+typedef struct {
+    volatile size_t sequence;
+    UA_Server *server;
+    UA_AsyncSeries *series;
+    UA_Boolean historizing;
+    UA_DataValue value;
+} UA_AsyncCell;
+
+typedef struct {
+    UA_Server *server;
+    UA_AsyncSeries *series;
+    UA_Boolean historizing;
+    size_t order;
+    UA_DataValue value;
+} UA_AsyncSample;
+
+typedef struct {
+    UA_HistoryDataBackend backend;
+    UA_HistoryIngestionConfig config;
+
+    /* Queue */
+    UA_AsyncCell *cells;
+    size_t mask;
+    volatile size_t enqueuePos;
+    volatile size_t dequeuePos; /* Written by the consumer only */
+
+    /* Hash index of the written nodes with linear probing. The series are not
+     * removed before the backend is deleted. So the queue can point to them. */
+    pthread_mutex_t seriesLock;
+    UA_AsyncSeries **slots;
+    size_t slotsSize;
+    size_t seriesCount;
+
+    /* The consumer holds the (recursive) lock while it dequeues and applies a
+     * batch. All access to the wrapped backend is serialized with it. */
+    pthread_mutex_t lock;
+    UA_AsyncSample *batch;
+
+    pthread_t thread;
+    pthread_mutex_t wakeLock;
+    pthread_cond_t wake;
+    UA_Boolean stop; /* Protected by the wakeLock */
+
+    /* Counted by the writers with atomic operations */
+    volatile size_t enqueued;
+    volatile size_t discarded;
+
+    /* Protected by the lock */
+    size_t applied;
+    size_t failed;
+    size_t batches;
+    size_t flushes;
+    size_t maxQueued;
+} UA_AsyncContext;
+
+/**************/
+/* Node Index */
+/**************/
+
+static UA_AsyncSeries *
+findSeries_backend_async(const UA_AsyncContext *ctx, const UA_NodeId *nodeId,
+                         UA_UInt32 hash) {
+    size_t mask = ctx->slotsSize - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        UA_AsyncSeries *s = ctx->slots[i];
+        if (!s)
+            return NULL;
+        if (s->hash == hash && UA_NodeId_equal(&s->nodeId, nodeId))
+            return s;
+    }
+}
+
+static void
+insertSlot_backend_async(UA_AsyncSeries **slots, size_t slotsSize, UA_AsyncSeries *s) {
+    size_t mask = slotsSize - 1;
+    size_t i = s->hash & mask;
+    while (slots[i])
+        i = (i + 1) & mask;
+    slots[i] = s;
+}
+
+static UA_AsyncSeries *
+addSeries_backend_async(UA_AsyncContext *ctx, const UA_NodeId *nodeId, UA_UInt32 hash) {
+    if ((ctx->seriesCount + 1) * 2 > ctx->slotsSize) {
+        size_t slotsSize = ctx->slotsSize * 2;
+        UA_AsyncSeries **slots = (UA_AsyncSeries**)
+            UA_calloc(slotsSize, sizeof(UA_AsyncSeries*));
+        if (!slots)
+            return NULL;
+        for (size_t i = 0; i < ctx->slotsSize; ++i) {
+            if (ctx->slots[i])
+                insertSlot_backend_async(slots, slotsSize, ctx->slots[i]);
+        }
+        UA_free(ctx->slots);
+        ctx->slots = slots;
+        ctx->slotsSize = slotsSize;
+    }
+    UA_AsyncSeries *s = (UA_AsyncSeries*)UA_calloc(1, sizeof(UA_AsyncSeries));
+    if (!s)
+        return NULL;
+    if (UA_NodeId_copy(nodeId, &s->nodeId) != UA_STATUSCODE_GOOD) {
+        UA_free(s);
+        return NULL;
+    }
+    s->hash = hash;
+    s->handle = ctx->seriesCount;
+    insertSlot_backend_async(ctx->slots, ctx->slotsSize, s);
+    ++ctx->seriesCount;
+    return s;
+}
+
+static UA_AsyncSeries *
+getSeries_backend_async(UA_AsyncContext *ctx, const UA_NodeId *nodeId) {
+    UA_UInt32 hash = UA_NodeId_hash(nodeId);
+    pthread_mutex_lock(&ctx->seriesLock);
+    UA_AsyncSeries *s = findSeries_backend_async(ctx, nodeId, hash);
+    if (!s)
+        s = addSeries_backend_async(ctx, nodeId, hash);
+    pthread_mutex_unlock(&ctx->seriesLock);
+    return s;
+}
+
+/*********/
+/* Queue */
+/*********/
+
+static size_t
+queued_backend_async(UA_AsyncContext *ctx) {
+    size_t dequeuePos = UA_atomic_addSize(&ctx->dequeuePos, 0);
+    return UA_atomic_addSize(&ctx->enqueuePos, 0) - dequeuePos;
+}
+
+/* Moves the value into the queue. Returns false if the queue is full. Several
+ * writers reserve positions with compare-and-swap. The sample is published
+ * by setting the sequence number of the cell afterwards. The atomic operations
+ * are full barriers. */
+static UA_Boolean
+enqueue_backend_async(UA_AsyncContext *ctx, UA_Server *server, UA_AsyncSeries *series,
+                      UA_Boolean historizing, const UA_DataValue *value,
+                      size_t *queued) {
+    size_t pos = UA_atomic_addSize(&ctx->enqueuePos, 0);
+    UA_AsyncCell *cell;
+    for (;;) {
+        cell = &ctx->cells[pos & ctx->mask];
+        size_t sequence = UA_atomic_addSize(&cell->sequence, 0);
+        if (sequence == pos) {
+            size_t old = UA_atomic_cmpxchgSize(&ctx->enqueuePos, pos, pos + 1);
+            if (old == pos)
+                break;
+            pos = old;
+        } else if (sequence < pos) {
+            /* The cell still holds the sample from the previous round */
+            return false;
+        } else {
+            pos = UA_atomic_addSize(&ctx->enqueuePos, 0);
+        }
+    }
+    cell->server = server;
+    cell->series = series;
+    cell->historizing = historizing;
+    cell->value = *value;
+    UA_atomic_cmpxchgSize(&cell->sequence, pos, pos + 1);
+    *queued = pos + 1 - UA_atomic_addSize(&ctx->dequeuePos, 0);
+    return true;
+}
+
+/* Takes up to batchSize published samples from the queue. The lock must be
+ * held. */
+static size_t
+dequeue_backend_async(UA_AsyncContext *ctx) {
+    size_t n = 0;
+    size_t pos = UA_atomic_addSize(&ctx->dequeuePos, 0);
+    while (n < ctx->config.batchSize) {
+        UA_AsyncCell *cell = &ctx->cells[pos & ctx->mask];
+        if (UA_atomic_addSize(&cell->sequence, 0) != pos + 1)
+            break;
+        UA_AsyncSample *s = &ctx->batch[n];
+        s->server = cell->server;
+        s->series = cell->series;
+        s->historizing = cell->historizing;
+        s->order = n;
+        s->value = cell->value;
+        UA_atomic_cmpxchgSize(&cell->sequence, pos + 1, pos + ctx->mask + 1);
+        ++pos;
+        UA_atomic_addSize(&ctx->dequeuePos, 1);
+        ++n;
+    }
+    return n;
+}
+
+static UA_DateTime
+timestamp_backend_async(const UA_DataValue *value) {
+    return value->hasSourceTimestamp ? value->sourceTimestamp : value->serverTimestamp;
+}
+
+/* Sort by node, timestamp and queue order */
+static int
+compareSample_backend_async(const void *a, const void *b) {
+    const UA_AsyncSample *sa = (const UA_AsyncSample*)a;
+    const UA_AsyncSample *sb = (const UA_AsyncSample*)b;
+    if (sa->series->handle != sb->series->handle)
+        return (sa->series->handle < sb->series->handle) ? -1 : 1;
+    UA_DateTime ta = timestamp_backend_async(&sa->value);
+    UA_DateTime tb = timestamp_backend_async(&sb->value);
+    if (ta != tb)
+        return (ta < tb) ? -1 : 1;
+    if (sa->order != sb->order)
+        return (sa->order < sb->order) ? -1 : 1;
+    return 0;
+}
+
+/* Applies one batch to the wrapped backend. Returns the number of samples. */
+static size_t
+applyBatch_backend_async(UA_AsyncContext *ctx, UA_Boolean byWriter) {
+    pthread_mutex_lock(&ctx->lock);
+    size_t queued = queued_backend_async(ctx);
+    if (queued > ctx->maxQueued)
+        ctx->maxQueued = queued;
+    size_t n = dequeue_backend_async(ctx);
+    if (n > 0) {
+        qsort(ctx->batch, n, sizeof(UA_AsyncSample), compareSample_backend_async);
+        for (size_t i = 0; i < n; ++i) {
+            UA_AsyncSample *s = &ctx->batch[i];
+            UA_StatusCode retval =
+                ctx->backend.serverSetHistoryData(s->server, ctx->backend.context,
+                                                  NULL, NULL, &s->series->nodeId,
+                                                  s->historizing, &s->value);
+            if (retval == UA_STATUSCODE_GOOD)
+                ++ctx->applied;
+            else
+                ++ctx->failed;
+            UA_DataValue_deleteMembers(&s->value);
+        }
+        ++ctx->batches;
+        if (byWriter)
+            ++ctx->flushes;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return n;
+}
+
+/* Applies the samples that were queued before the call */
+static void
+flush_backend_async(UA_AsyncContext *ctx) {
+    size_t end = UA_atomic_addSize(&ctx->enqueuePos, 0);
+    while (UA_atomic_addSize(&ctx->dequeuePos, 0) < end) {
+        if (applyBatch_backend_async(ctx, false) == 0)
+            sched_yield(); /* A writer has not yet published its sample */
+    }
+}
+
+static void *
+thread_backend_async(void *data) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)data;
+    pthread_mutex_lock(&ctx->wakeLock);
+    while (!ctx->stop) {
+        if (queued_backend_async(ctx) < ctx->config.batchSize) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            long nsec = ts.tv_nsec + (long)(ctx->config.flushInterval % 1000) * 1000000L;
+            ts.tv_sec += (time_t)(ctx->config.flushInterval / 1000) + (time_t)(nsec / 1000000000L);
+            ts.tv_nsec = nsec % 1000000000L;
+            pthread_cond_timedwait(&ctx->wake, &ctx->wakeLock, &ts);
+            if (ctx->stop)
+                break;
+        }
+        pthread_mutex_unlock(&ctx->wakeLock);
+        while (applyBatch_backend_async(ctx, false) == ctx->config.batchSize) {}
+        pthread_mutex_lock(&ctx->wakeLock);
+    }
+    pthread_mutex_unlock(&ctx->wakeLock);
+    return NULL;
+}
+
+/***********/
+/* Backend */
+/***********/
+
+static UA_StatusCode
+serverSetHistoryData_backend_async(UA_Server *server,
+                                   void *context,
+                                   const UA_NodeId *sessionId,
+                                   void *sessionContext,
+                                   const UA_NodeId *nodeId,
+                                   UA_Boolean historizing,
+                                   const UA_DataValue *value) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    UA_AsyncSeries *series = getSeries_backend_async(ctx, nodeId);
+    if (!series)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    UA_DataValue copy;
+    UA_StatusCode retval = UA_DataValue_copy(value, &copy);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* The wrapped backend would take the time of the insertion. Take the time
+     * of the write instead. */
+    if (!copy.hasSourceTimestamp && !copy.hasServerTimestamp) {
+        copy.hasServerTimestamp = true;
+        copy.serverTimestamp = UA_DateTime_now();
+    }
+
+    size_t queued;
+    while (!enqueue_backend_async(ctx, server, series, historizing, &copy, &queued)) {
+        if (ctx->config.overflow != UA_HISTORYINGESTIONOVERFLOW_FLUSH) {
+            UA_DataValue_deleteMembers(&copy);
+            UA_atomic_addSize(&ctx->discarded, 1);
+            return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        }
+        if (applyBatch_backend_async(ctx, true) == 0)
+            sched_yield();
+    }
+    UA_atomic_addSize(&ctx->enqueued, 1);
+
+    /* Wake the background thread once a full batch is ready */
+    if (queued == ctx->config.batchSize) {
+        pthread_mutex_lock(&ctx->wakeLock);
+        pthread_cond_signal(&ctx->wake);
+        pthread_mutex_unlock(&ctx->wakeLock);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+lock_backend_async(UA_Server *server, void *context) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    pthread_mutex_lock(&ctx->lock);
+    flush_backend_async(ctx);
+    if (ctx->backend.lock)
+        ctx->backend.lock(server, ctx->backend.context);
+}
+
+static void
+unlock_backend_async(UA_Server *server, void *context) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    if (ctx->backend.unlock)
+        ctx->backend.unlock(server, ctx->backend.context);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+/* The other functions are forwarded to the wrapped backend under the lock */
+
+static UA_StatusCode
+getHistoryData_backend_async(UA_Server *server,
+                             const UA_NodeId *sessionId,
+                             void *sessionContext,
+                             const UA_HistoryDataBackend *backend,
+                             const UA_DateTime start,
+                             const UA_DateTime end,
+                             const UA_NodeId *nodeId,
+                             size_t maxSizePerResponse,
+                             UA_UInt32 numValuesPerNode,
+                             UA_Boolean returnBounds,
+                             UA_TimestampsToReturn timestampsToReturn,
+                             UA_NumericRange range,
+                             UA_Boolean releaseContinuationPoints,
+                             const UA_ByteString *continuationPoint,
+                             UA_ByteString *outContinuationPoint,
+                             UA_HistoryData *result) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)backend->context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    UA_StatusCode retval =
+        b->getHistoryData(server, sessionId, sessionContext, b, start, end, nodeId,
+                          maxSizePerResponse, numValuesPerNode, returnBounds,
+                          timestampsToReturn, range, releaseContinuationPoints,
+                          continuationPoint, outContinuationPoint, result);
+    pthread_mutex_unlock(&ctx->lock);
+    return retval;
+}
+
+static size_t
+getDateTimeMatch_backend_async(UA_Server *server,
+                               void *context,
+                               const UA_NodeId *sessionId,
+                               void *sessionContext,
+                               const UA_NodeId *nodeId,
+                               const UA_DateTime timestamp,
+                               const MatchStrategy strategy) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    size_t result = b->getDateTimeMatch(server, b->context, sessionId, sessionContext,
+                                        nodeId, timestamp, strategy);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+static size_t
+getEnd_backend_async(UA_Server *server,
+                     void *context,
+                     const UA_NodeId *sessionId,
+                     void *sessionContext,
+                     const UA_NodeId *nodeId) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    size_t result = b->getEnd(server, b->context, sessionId, sessionContext, nodeId);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+static size_t
+lastIndex_backend_async(UA_Server *server,
+                        void *context,
+                        const UA_NodeId *sessionId,
+                        void *sessionContext,
+                        const UA_NodeId *nodeId) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    size_t result = b->lastIndex(server, b->context, sessionId, sessionContext, nodeId);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+static size_t
+firstIndex_backend_async(UA_Server *server,
+                         void *context,
+                         const UA_NodeId *sessionId,
+                         void *sessionContext,
+                         const UA_NodeId *nodeId) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    size_t result = b->firstIndex(server, b->context, sessionId, sessionContext, nodeId);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+static size_t
+resultSize_backend_async(UA_Server *server,
+                         void *context,
+                         const UA_NodeId *sessionId,
+                         void *sessionContext,
+                         const UA_NodeId *nodeId,
+                         size_t startIndex,
+                         size_t endIndex) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    size_t result = b->resultSize(server, b->context, sessionId, sessionContext, nodeId,
+                                  startIndex, endIndex);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+static UA_StatusCode
+copyDataValues_backend_async(UA_Server *server,
+                             void *context,
+                             const UA_NodeId *sessionId,
+                             void *sessionContext,
+                             const UA_NodeId *nodeId,
+                             size_t startIndex,
+                             size_t endIndex,
+                             UA_Boolean reverse,
+                             size_t maxValues,
+                             UA_NumericRange range,
+                             UA_Boolean releaseContinuationPoints,
+                             const UA_ByteString *continuationPoint,
+                             UA_ByteString *outContinuationPoint,
+                             size_t *providedValues,
+                             UA_DataValue *values) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    UA_StatusCode retval =
+        b->copyDataValues(server, b->context, sessionId, sessionContext, nodeId,
+                          startIndex, endIndex, reverse, maxValues, range,
+                          releaseContinuationPoints, continuationPoint,
+                          outContinuationPoint, providedValues, values);
+    pthread_mutex_unlock(&ctx->lock);
+    return retval;
+}
+
+/* The value is only stable while the lock of the backend is held */
+static const UA_DataValue*
+getDataValue_backend_async(UA_Server *server,
+                           void *context,
+                           const UA_NodeId *sessionId,
+                           void *sessionContext,
+                           const UA_NodeId *nodeId,
+                           size_t index) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    const UA_DataValue *result =
+        b->getDataValue(server, b->context, sessionId, sessionContext, nodeId, index);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+static UA_Boolean
+boundSupported_backend_async(UA_Server *server,
+                             void *context,
+                             const UA_NodeId *sessionId,
+                             void *sessionContext,
+                             const UA_NodeId *nodeId) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    UA_Boolean result = b->boundSupported(server, b->context, sessionId,
+                                          sessionContext, nodeId);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+static UA_Boolean
+timestampsToReturnSupported_backend_async(UA_Server *server,
+                                          void *context,
+                                          const UA_NodeId *sessionId,
+                                          void *sessionContext,
+                                          const UA_NodeId *nodeId,
+                                          const UA_TimestampsToReturn timestampsToReturn) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    UA_Boolean result =
+        b->timestampsToReturnSupported(server, b->context, sessionId, sessionContext,
+                                       nodeId, timestampsToReturn);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+static UA_StatusCode
+getSummary_backend_async(UA_Server *server,
+                         void *context,
+                         const UA_NodeId *sessionId,
+                         void *sessionContext,
+                         const UA_NodeId *nodeId,
+                         UA_DateTime start,
+                         UA_DateTime end,
+                         UA_HistoryDataSummary *summary) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    UA_StatusCode retval = b->getSummary(server, b->context, sessionId, sessionContext,
+                                         nodeId, start, end, summary);
+    pthread_mutex_unlock(&ctx->lock);
+    return retval;
+}
+
+static UA_StatusCode
+getCursor_backend_async(UA_Server *server,
+                        void *context,
+                        const UA_NodeId *sessionId,
+                        void *sessionContext,
+                        const UA_NodeId *nodeId,
+                        size_t index,
+                        UA_HistoryDataCursor *cursor) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    UA_StatusCode retval = b->getCursor(server, b->context, sessionId, sessionContext,
+                                        nodeId, index, cursor);
+    pthread_mutex_unlock(&ctx->lock);
+    return retval;
+}
+
+static UA_StatusCode
+readCursor_backend_async(UA_Server *server,
+                         void *context,
+                         const UA_NodeId *sessionId,
+                         void *sessionContext,
+                         const UA_NodeId *nodeId,
+                         UA_HistoryDataCursor *cursor,
+                         UA_Boolean reverse,
+                         size_t maxValues,
+                         UA_HistoryDataCursorCallback callback,
+                         void *callbackContext,
+                         size_t *providedValues) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)context;
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    pthread_mutex_lock(&ctx->lock);
+    UA_StatusCode retval = b->readCursor(server, b->context, sessionId, sessionContext,
+                                         nodeId, cursor, reverse, maxValues, callback,
+                                         callbackContext, providedValues);
+    pthread_mutex_unlock(&ctx->lock);
+    return retval;
+}
+
+static void
+UA_AsyncContext_delete(UA_AsyncContext *ctx) {
+    for (size_t i = 0; i < ctx->slotsSize; ++i) {
+        if (!ctx->slots[i])
+            continue;
+        UA_NodeId_deleteMembers(&ctx->slots[i]->nodeId);
+        UA_free(ctx->slots[i]);
+    }
+    UA_free(ctx->slots);
+    UA_free(ctx->batch);
+    UA_free(ctx->cells);
+    pthread_cond_destroy(&ctx->wake);
+    pthread_mutex_destroy(&ctx->wakeLock);
+    pthread_mutex_destroy(&ctx->lock);
+    pthread_mutex_destroy(&ctx->seriesLock);
+    UA_free(ctx);
+}
+
+static void
+deleteMembers_backend_async(UA_HistoryDataBackend *backend) {
+    if (backend == NULL || backend->context == NULL)
+        return;
+    UA_AsyncContext *ctx = (UA_AsyncContext*)backend->context;
+    pthread_mutex_lock(&ctx->wakeLock);
+    ctx->stop = true;
+    pthread_cond_signal(&ctx->wake);
+    pthread_mutex_unlock(&ctx->wakeLock);
+    pthread_join(ctx->thread, NULL);
+    flush_backend_async(ctx);
+    UA_AsyncContext_delete(ctx);
+    backend->context = NULL;
+}
+
+static UA_AsyncContext *
+UA_AsyncContext_new(const UA_HistoryIngestionConfig *config) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)UA_calloc(1, sizeof(UA_AsyncContext));
+    if (!ctx)
+        return NULL;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&ctx->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_init(&ctx->seriesLock, NULL);
+    pthread_mutex_init(&ctx->wakeLock, NULL);
+    pthread_cond_init(&ctx->wake, NULL);
+
+    ctx->config.queueSize = UA_ASYNC_DEFAULT_QUEUESIZE;
+    ctx->config.batchSize = UA_ASYNC_DEFAULT_BATCHSIZE;
+    ctx->config.flushInterval = UA_ASYNC_DEFAULT_FLUSHINTERVAL;
+    ctx->config.overflow = UA_HISTORYINGESTIONOVERFLOW_DISCARD;
+    if (config) {
+        if (config->queueSize > 0)
+            ctx->config.queueSize = config->queueSize;
+        if (config->batchSize > 0)
+            ctx->config.batchSize = config->batchSize;
+        if (config->flushInterval > 0)
+            ctx->config.flushInterval = config->flushInterval;
+        ctx->config.overflow = config->overflow;
+    }
+    size_t queueSize = 2;
+    while (queueSize < ctx->config.queueSize)
+        queueSize *= 2;
+    ctx->config.queueSize = queueSize;
+    if (ctx->config.batchSize > queueSize)
+        ctx->config.batchSize = queueSize;
+    ctx->mask = queueSize - 1;
+
+    ctx->slotsSize = 16;
+    ctx->slots = (UA_AsyncSeries**)UA_calloc(ctx->slotsSize, sizeof(UA_AsyncSeries*));
+    ctx->cells = (UA_AsyncCell*)UA_calloc(queueSize, sizeof(UA_AsyncCell));
+    ctx->batch = (UA_AsyncSample*)UA_calloc(ctx->config.batchSize, sizeof(UA_AsyncSample));
+    if (!ctx->slots || !ctx->cells || !ctx->batch) {
+        UA_AsyncContext_delete(ctx);
+        return NULL;
+    }
+    for (size_t i = 0; i < queueSize; ++i)
+        ctx->cells[i].sequence = i;
+    return ctx;
+}
+
+UA_HistoryDataBackend
+UA_HistoryDataBackend_Async(UA_HistoryDataBackend backend,
+                            const UA_HistoryIngestionConfig *config) {
+    UA_HistoryDataBackend result;
+    memset(&result, 0, sizeof(UA_HistoryDataBackend));
+    if (!backend.serverSetHistoryData)
+        return result;
+    UA_AsyncContext *ctx = UA_AsyncContext_new(config);
+    if (!ctx)
+        return result;
+    ctx->backend = backend;
+    if (pthread_create(&ctx->thread, NULL, thread_backend_async, ctx) != 0) {
+        UA_AsyncContext_delete(ctx);
+        return result;
+    }
+
+    result.serverSetHistoryData = &serverSetHistoryData_backend_async;
+    if (backend.getHistoryData)
+        result.getHistoryData = &getHistoryData_backend_async;
+    if (backend.getDataValue) {
+        result.resultSize = &resultSize_backend_async;
+        result.getEnd = &getEnd_backend_async;
+        result.lastIndex = &lastIndex_backend_async;
+        result.firstIndex = &firstIndex_backend_async;
+        result.getDateTimeMatch = &getDateTimeMatch_backend_async;
+        result.copyDataValues = &copyDataValues_backend_async;
+        result.getDataValue = &getDataValue_backend_async;
+    }
+    result.boundSupported = &boundSupported_backend_async;
+    result.timestampsToReturnSupported = &timestampsToReturnSupported_backend_async;
+    if (backend.getSummary)
+        result.getSummary = &getSummary_backend_async;
+    if (backend.getCursor && backend.readCursor) {
+        result.getCursor = &getCursor_backend_async;
+        result.readCursor = &readCursor_backend_async;
+    }
+    result.lock = &lock_backend_async;
+    result.unlock = &unlock_backend_async;
+    result.deleteMembers = &deleteMembers_backend_async;
+    result.context = ctx;
+    return result;
+}
+
+void
+UA_HistoryDataBackend_Async_flush(UA_HistoryDataBackend *backend) {
+    if (backend->context)
+        flush_backend_async((UA_AsyncContext*)backend->context);
+}
+
+UA_StatusCode
+UA_HistoryDataBackend_Async_getStatistics(const UA_HistoryDataBackend *backend,
+                                          UA_HistoryIngestionStatistics *statistics) {
+    UA_AsyncContext *ctx = (UA_AsyncContext*)backend->context;
+    if (!ctx)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    pthread_mutex_lock(&ctx->lock);
+    statistics->enqueued = UA_atomic_addSize(&ctx->enqueued, 0);
+    statistics->discarded = UA_atomic_addSize(&ctx->discarded, 0);
+    statistics->applied = ctx->applied;
+    statistics->failed = ctx->failed;
+    statistics->batches = ctx->batches;
+    statistics->flushes = ctx->flushes;
+    statistics->maxQueued = ctx->maxQueued;
+    pthread_mutex_unlock(&ctx->lock);
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_HistoryDataBackend_Async_deleteMembers(UA_HistoryDataBackend *backend) {
+    deleteMembers_backend_async(backend);
+    memset(backend, 0, sizeof(UA_HistoryDataBackend));
+}
+
+#endif /* UA_ENABLE_HISTORIZING_ASYNC */
@@ -0,0 +1,83 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UA_HISTORYDATABACKEND_ASYNC_H_
+#define UA_HISTORYDATABACKEND_ASYNC_H_
+
+#include "ua_plugin_history_data_backend.h"
+
+_UA_BEGIN_DECLS
+
+typedef enum {
+    UA_HISTORYINGESTIONOVERFLOW_DISCARD = 0, /* Samples that do not fit into the
+                                                queue are dropped and counted. */
+    UA_HISTORYINGESTIONOVERFLOW_FLUSH = 1    /* The writer applies a batch of
+                                                queued samples itself. */
+} UA_HistoryIngestionOverflow;
+
+typedef struct {
+    size_t queueSize;        /* Maximum number of queued samples. Rounded up to a
+                              * power of two. */
+    size_t batchSize;        /* Maximum number of samples applied at once. The
+                              * background thread is woken up when this many
+                              * samples are queued. */
+    UA_UInt32 flushInterval; /* The background thread applies the queued
+                              * samples at least this often (in ms). */
+    UA_HistoryIngestionOverflow overflow;
+} UA_HistoryIngestionConfig;
+
+typedef struct {
+    size_t enqueued;   /* Samples added to the queue */
+    size_t discarded;  /* Samples dropped because the queue was full */
+    size_t applied;    /* Samples written to the wrapped backend */
+    size_t failed;     /* Samples rejected by the wrapped backend */
+    size_t batches;    /* Batches written to the wrapped backend */
+    size_t flushes;    /* Batches applied by a writer because the queue was full */
+    size_t maxQueued;  /* Most samples seen in the queue by the consumer */
+} UA_HistoryIngestionStatistics;
+
+/* Backend that decouples the insertion of samples into another backend from
+ * the writer. serverSetHistoryData copies the sample into a bounded lock-free
+ * queue and returns. Several threads may write at the same time. A background
+ * thread takes batches from the queue, sorts them by node and timestamp and
+ * inserts them into the wrapped backend. So the wrapped backend mostly sees
+ * appends of consecutive samples of the same node.
+ *
+ * The node of a sample is recorded as a handle into an index of the nodes
+ * that were written. The session of the writer is not passed on to the wrapped
+ * backend. serverSetHistoryData of the wrapped backend must not call the
+ * server, since it is called from the background thread.
+ *
+ * All other functions are forwarded to the wrapped backend under a lock. When
+ * the history database reads a node, the queued samples are applied first.
+ * Use UA_HistoryDataBackend_Async_flush before the low level API is used
+ * directly. To keep precomputed summaries, wrap the rollup backend (and not
+ * the other way around).
+ *
+ * The wrapped backend is not deleted with the asynchronous backend. If config
+ * is NULL, a queue of 4096 samples, batches of 256 samples, a flush interval
+ * of 10ms and UA_HISTORYINGESTIONOVERFLOW_DISCARD are used. Zero sizes and
+ * intervals in the config are replaced by these defaults as well. The context
+ * of the returned backend is NULL if the background thread cannot be
+ * started. */
+UA_HistoryDataBackend UA_EXPORT
+UA_HistoryDataBackend_Async(UA_HistoryDataBackend backend,
+                            const UA_HistoryIngestionConfig *config);
+
+/* Applies all queued samples to the wrapped backend */
+void UA_EXPORT
+UA_HistoryDataBackend_Async_flush(UA_HistoryDataBackend *backend);
+
+UA_StatusCode UA_EXPORT
+UA_HistoryDataBackend_Async_getStatistics(const UA_HistoryDataBackend *backend,
+                                          UA_HistoryIngestionStatistics *statistics);
+
+/* Stops the background thread and applies the remaining samples */
+void UA_EXPORT
+UA_HistoryDataBackend_Async_deleteMembers(UA_HistoryDataBackend *backend);
+
+_UA_END_DECLS
+
+#endif /* UA_HISTORYDATABACKEND_ASYNC_H_ */
@@ -0,0 +1,1131 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ua_historydatabackend_compressed.h"
+#include <string.h>
+
+#define UA_COMPRESSED_BLOCKSIZE 256
+
+/* Upper bound for the encoded bits of one sample */
+#define UA_COMPRESSED_MAXSAMPLEBITS 256
+
+#define UA_COMPRESSED_HASVALUE 0x01
+#define UA_COMPRESSED_HASSTATUS 0x02
+#define UA_COMPRESSED_HASSOURCETIMESTAMP 0x04
+#define UA_COMPRESSED_HASSERVERTIMESTAMP 0x08
+
+#define UA_COMPRESSED_NOWINDOW 0xff
+
+/* The value is the raw memory of the numeric type in the first bytes */
+typedef struct {
+    UA_DateTime time;
+    UA_UInt64 value;
+    UA_Int64 serverOffset; /* Server timestamp minus time */
+    UA_StatusCode status;
+    UA_Byte flags;
+} UA_CompressedSample;
+
+/* State of the encoder (and decoder) after a sample */
+typedef struct {
+    UA_DateTime time;
+    UA_Int64 delta;
+    UA_UInt64 value;
+    UA_Int64 serverOffset;
+    UA_StatusCode status;
+    UA_Byte flags;
+    UA_Byte leading; /* Window of the meaningful XOR bits */
+    UA_Byte trailing;
+} UA_CompressedState;
+
+typedef struct {
+    size_t firstIndex;
+    size_t count;
+    UA_DateTime minTime;
+    UA_DateTime maxTime;
+    UA_Byte *data;
+    size_t bits;
+    size_t capacity; /* In bytes */
+    UA_CompressedState state; /* To append to the block */
+} UA_CompressedBlock;
+
+typedef struct {
+    UA_NodeId nodeId;
+    UA_UInt32 hash;
+    size_t count;
+    UA_UInt64 version; /* Changed with every modification */
+
+    /* Compressed numeric samples */
+    const UA_DataType *type;
+    UA_CompressedBlock *blocks;
+    size_t blocksSize;
+
+    /* Sorted DataValues if the series is not numeric */
+    UA_Boolean generic;
+    UA_DateTime *times;
+    UA_DataValue *dataValues;
+    size_t capacity;
+} UA_CompressedSeries;
+
+typedef struct {
+    /* Hash index with linear probing. At most half of the slots are used. */
+    UA_CompressedSeries **slots;
+    size_t slotsSize;
+    size_t seriesCount;
+    UA_DateTime maxAge;
+
+    /* The last decoded block */
+    const UA_CompressedSeries *cacheSeries;
+    UA_UInt64 cacheVersion;
+    size_t cacheBlock;
+    UA_CompressedSample cache[UA_COMPRESSED_BLOCKSIZE];
+
+    /* Returned by getDataValue. Points into the cache. */
+    UA_DataValue scratch;
+} UA_CompressedContext;
+
+/***************/
+/* Bit Streams */
+/***************/
+
+static UA_Byte
+leadingZeros_backend_compressed(UA_UInt64 x) {
+#ifdef __GNUC__
+    return (UA_Byte)__builtin_clzll(x);
+#else
+    UA_Byte n = 0;
+    while (!(x & 0x8000000000000000ULL)) {
+        x <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static UA_Byte
+trailingZeros_backend_compressed(UA_UInt64 x) {
+#ifdef __GNUC__
+    return (UA_Byte)__builtin_ctzll(x);
+#else
+    UA_Byte n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static UA_StatusCode
+reserveBits_backend_compressed(UA_CompressedBlock *b, size_t bits) {
+    size_t needed = (b->bits + bits + 7) / 8;
+    if (needed <= b->capacity)
+        return UA_STATUSCODE_GOOD;
+    size_t capacity = b->capacity > 0 ? b->capacity * 2 : 32;
+    while (capacity < needed)
+        capacity *= 2;
+    UA_Byte *data = (UA_Byte*)UA_realloc(b->data, capacity);
+    if (!data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memset(&data[b->capacity], 0, capacity - b->capacity);
+    b->data = data;
+    b->capacity = capacity;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Writes the lowest count bits of the value. The space is reserved. */
+static void
+writeBits_backend_compressed(UA_CompressedBlock *b, UA_UInt64 value, UA_Byte count) {
+    while (count > 0) {
+        UA_Byte offset = (UA_Byte)(b->bits % 8);
+        UA_Byte n = (UA_Byte)(8 - offset);
+        if (n > count)
+            n = count;
+        UA_Byte chunk = (UA_Byte)((value >> (count - n)) & ((1u << n) - 1));
+        b->data[b->bits / 8] |= (UA_Byte)(chunk << (8 - offset - n));
+        b->bits += n;
+        count = (UA_Byte)(count - n);
+    }
+}
+
+typedef struct {
+    const UA_Byte *data;
+    size_t pos;
+} UA_CompressedReader;
+
+static UA_UInt64
+readBits_backend_compressed(UA_CompressedReader *r, UA_Byte count) {
+    UA_UInt64 value = 0;
+    while (count > 0) {
+        UA_Byte offset = (UA_Byte)(r->pos % 8);
+        UA_Byte n = (UA_Byte)(8 - offset);
+        if (n > count)
+            n = count;
+        UA_Byte chunk = (UA_Byte)((r->data[r->pos / 8] >> (8 - offset - n)) & ((1u << n) - 1));
+        value = (value << n) | chunk;
+        r->pos += n;
+        count = (UA_Byte)(count - n);
+    }
+    return value;
+}
+
+/************/
+/* Encoding */
+/************/
+
+static void
+initState_backend_compressed(UA_CompressedState *state) {
+    memset(state, 0, sizeof(UA_CompressedState));
+    state->flags = UA_COMPRESSED_HASVALUE | UA_COMPRESSED_HASSOURCETIMESTAMP;
+    state->leading = UA_COMPRESSED_NOWINDOW;
+}
+
+/* Appends a sample with a timestamp not older than the last sample. The
+ * space is reserved. */
+static void
+encodeSample_backend_compressed(UA_CompressedBlock *b, const UA_CompressedSample *s) {
+    UA_CompressedState *st = &b->state;
+    if (b->count == 0) {
+        writeBits_backend_compressed(b, (UA_UInt64)s->time, 64);
+        writeBits_backend_compressed(b, s->value, 64);
+    } else {
+        /* Delta-of-delta of the timestamp. The deltas are not negative. The
+         * buckets are wider than in Gorilla since DateTime counts 100ns and
+         * the timestamps jitter by a few ms. */
+        UA_Int64 delta = s->time - st->time;
+        UA_Int64 dod = delta - st->delta;
+        if (dod == 0) {
+            writeBits_backend_compressed(b, 0x0, 1);
+        } else if (dod >= -255 && dod <= 256) {
+            writeBits_backend_compressed(b, 0x2, 2);
+            writeBits_backend_compressed(b, (UA_UInt64)(dod + 255), 9);
+        } else if (dod >= -524287 && dod <= 524288) {
+            writeBits_backend_compressed(b, 0x6, 3);
+            writeBits_backend_compressed(b, (UA_UInt64)(dod + 524287), 20);
+        } else if (dod >= -2147483647LL && dod <= 2147483648LL) {
+            writeBits_backend_compressed(b, 0xe, 4);
+            writeBits_backend_compressed(b, (UA_UInt64)(dod + 2147483647LL), 32);
+        } else {
+            writeBits_backend_compressed(b, 0xf, 4);
+            writeBits_backend_compressed(b, (UA_UInt64)dod, 64);
+        }
+        st->delta = delta;
+
+        /* XOR with the previous value */
+        UA_UInt64 x = s->value ^ st->value;
+        if (x == 0) {
+            writeBits_backend_compressed(b, 0x0, 1);
+        } else {
+            UA_Byte leading = leadingZeros_backend_compressed(x);
+            UA_Byte trailing = trailingZeros_backend_compressed(x);
+            if (st->leading != UA_COMPRESSED_NOWINDOW &&
+                leading >= st->leading && trailing >= st->trailing) {
+                /* Reuse the window */
+                writeBits_backend_compressed(b, 0x2, 2);
+                writeBits_backend_compressed(b, x >> st->trailing,
+                                             (UA_Byte)(64 - st->leading - st->trailing));
+            } else {
+                UA_Byte meaningful = (UA_Byte)(64 - leading - trailing);
+                writeBits_backend_compressed(b, 0x3, 2);
+                writeBits_backend_compressed(b, leading, 6);
+                writeBits_backend_compressed(b, (UA_UInt64)(meaningful - 1), 6);
+                writeBits_backend_compressed(b, x >> trailing, meaningful);
+                st->leading = leading;
+                st->trailing = trailing;
+            }
+        }
+    }
+
+    /* Flags, status and server timestamp */
+    if (s->flags == st->flags && s->status == st->status &&
+        s->serverOffset == st->serverOffset) {
+        writeBits_backend_compressed(b, 0x0, 1);
+    } else {
+        writeBits_backend_compressed(b, 0x1, 1);
+        writeBits_backend_compressed(b, s->flags, 4);
+        writeBits_backend_compressed(b, s->status, 32);
+        writeBits_backend_compressed(b, (UA_UInt64)s->serverOffset, 64);
+        st->flags = s->flags;
+        st->status = s->status;
+        st->serverOffset = s->serverOffset;
+    }
+
+    st->time = s->time;
+    st->value = s->value;
+    if (b->count == 0)
+        b->minTime = s->time;
+    b->maxTime = s->time;
+    ++b->count;
+}
+
+static void
+decodeSample_backend_compressed(UA_CompressedReader *r, UA_CompressedState *st,
+                                size_t i, UA_CompressedSample *s) {
+    if (i == 0) {
+        st->time = (UA_DateTime)readBits_backend_compressed(r, 64);
+        st->value = readBits_backend_compressed(r, 64);
+    } else {
+        UA_Int64 dod;
+        if (readBits_backend_compressed(r, 1) == 0)
+            dod = 0;
+        else if (readBits_backend_compressed(r, 1) == 0)
+            dod = (UA_Int64)readBits_backend_compressed(r, 9) - 255;
+        else if (readBits_backend_compressed(r, 1) == 0)
+            dod = (UA_Int64)readBits_backend_compressed(r, 20) - 524287;
+        else if (readBits_backend_compressed(r, 1) == 0)
+            dod = (UA_Int64)readBits_backend_compressed(r, 32) - 2147483647LL;
+        else
+            dod = (UA_Int64)readBits_backend_compressed(r, 64);
+        st->delta += dod;
+        st->time += st->delta;
+
+        if (readBits_backend_compressed(r, 1) != 0) {
+            if (readBits_backend_compressed(r, 1) != 0) {
+                st->leading = (UA_Byte)readBits_backend_compressed(r, 6);
+                UA_Byte meaningful = (UA_Byte)(readBits_backend_compressed(r, 6) + 1);
+                st->trailing = (UA_Byte)(64 - st->leading - meaningful);
+            }
+            UA_Byte meaningful = (UA_Byte)(64 - st->leading - st->trailing);
+            st->value ^= readBits_backend_compressed(r, meaningful) << st->trailing;
+        }
+    }
+
+    if (readBits_backend_compressed(r, 1) != 0) {
+        st->flags = (UA_Byte)readBits_backend_compressed(r, 4);
+        st->status = (UA_StatusCode)readBits_backend_compressed(r, 32);
+        st->serverOffset = (UA_Int64)readBits_backend_compressed(r, 64);
+    }
+
+    s->time = st->time;
+    s->value = st->value;
+    s->flags = st->flags;
+    s->status = st->status;
+    s->serverOffset = st->serverOffset;
+}
+
+static void
+decodeBlock_backend_compressed(const UA_CompressedBlock *b, UA_CompressedSample *samples) {
+    UA_CompressedReader r;
+    r.data = b->data;
+    r.pos = 0;
+    UA_CompressedState st;
+    initState_backend_compressed(&st);
+    for (size_t i = 0; i < b->count; ++i)
+        decodeSample_backend_compressed(&r, &st, i, &samples[i]);
+}
+
+/* Encodes the samples into an empty block */
+static UA_StatusCode
+encodeBlock_backend_compressed(UA_CompressedBlock *b, const UA_CompressedSample *samples,
+                               size_t count) {
+    UA_StatusCode retval =
+        reserveBits_backend_compressed(b, count * UA_COMPRESSED_MAXSAMPLEBITS);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    for (size_t i = 0; i < count; ++i)
+        encodeSample_backend_compressed(b, &samples[i]);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+initBlock_backend_compressed(UA_CompressedBlock *b, size_t firstIndex) {
+    memset(b, 0, sizeof(UA_CompressedBlock));
+    b->firstIndex = firstIndex;
+    initState_backend_compressed(&b->state);
+}
+
+/* Releases the unused capacity of a full block */
+static void
+shrinkBlock_backend_compressed(UA_CompressedBlock *b) {
+    size_t length = (b->bits + 7) / 8;
+    if (length == 0 || length == b->capacity)
+        return;
+    UA_Byte *data = (UA_Byte*)UA_realloc(b->data, length);
+    if (!data)
+        return;
+    b->data = data;
+    b->capacity = length;
+}
+
+/**********/
+/* Series */
+/**********/
+
+static void
+sampleToDataValue_backend_compressed(const UA_CompressedSeries *s,
+                                     UA_CompressedSample *sample, UA_DataValue *dv) {
+    UA_DataValue_init(dv);
+    if (sample->flags & UA_COMPRESSED_HASVALUE) {
+        UA_Variant_setScalar(&dv->value, &sample->value, s->type);
+        dv->hasValue = true;
+    }
+    if (sample->flags & UA_COMPRESSED_HASSTATUS) {
+        dv->status = sample->status;
+        dv->hasStatus = true;
+    }
+    if (sample->flags & UA_COMPRESSED_HASSOURCETIMESTAMP) {
+        dv->sourceTimestamp = sample->time;
+        dv->hasSourceTimestamp = true;
+    }
+    if (sample->flags & UA_COMPRESSED_HASSERVERTIMESTAMP) {
+        dv->serverTimestamp = sample->time + sample->serverOffset;
+        dv->hasServerTimestamp = true;
+    }
+}
+
+static UA_Boolean
+isNumeric_backend_compressed(const UA_CompressedSeries *s, const UA_DataValue *value) {
+    if (s->generic || value->hasSourcePicoseconds || value->hasServerPicoseconds)
+        return false;
+    if (!value->hasValue)
+        return true;
+    const UA_DataType *type = value->value.type;
+    if (!type || !UA_Variant_isScalar(&value->value) || !value->value.data)
+        return false;
+    if (!type->builtin || !type->pointerFree || type->memSize > sizeof(UA_UInt64))
+        return false;
+    return (!s->type || s->type == type);
+}
+
+/* Block that contains the sample with the index */
+static size_t
+blockAt_backend_compressed(const UA_CompressedSeries *s, size_t index) {
+    size_t min = 0;
+    size_t max = s->blocksSize;
+    while (min < max) {
+        size_t mid = min + (max - min) / 2;
+        if (s->blocks[mid].firstIndex <= index)
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    return min - 1;
+}
+
+static const UA_CompressedSample *
+getBlock_backend_compressed(UA_CompressedContext *ctx, const UA_CompressedSeries *s,
+                            size_t block) {
+    if (ctx->cacheSeries != s || ctx->cacheVersion != s->version ||
+        ctx->cacheBlock != block) {
+        decodeBlock_backend_compressed(&s->blocks[block], ctx->cache);
+        ctx->cacheSeries = s;
+        ctx->cacheVersion = s->version;
+        ctx->cacheBlock = block;
+    }
+    return ctx->cache;
+}
+
+static UA_Boolean
+isBefore_backend_compressed(UA_DateTime t, UA_DateTime timestamp, UA_Boolean after) {
+    return (t < timestamp || (after && t == timestamp));
+}
+
+/* Index of the first sample at (or after, if after is set) the timestamp */
+static size_t
+search_backend_compressed(UA_CompressedContext *ctx, const UA_CompressedSeries *s,
+                          UA_DateTime timestamp, UA_Boolean after) {
+    size_t min = 0;
+    size_t max = s->generic ? s->count : s->blocksSize;
+    while (min < max) {
+        size_t mid = min + (max - min) / 2;
+        UA_DateTime t = s->generic ? s->times[mid] : s->blocks[mid].maxTime;
+        if (isBefore_backend_compressed(t, timestamp, after))
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    if (s->generic)
+        return min;
+    if (min == s->blocksSize)
+        return s->count;
+
+    /* Search in the block */
+    const UA_CompressedBlock *b = &s->blocks[min];
+    const UA_CompressedSample *samples = getBlock_backend_compressed(ctx, s, min);
+    size_t low = 0;
+    size_t high = b->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (isBefore_backend_compressed(samples[mid].time, timestamp, after))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return b->firstIndex + low;
+}
+
+static UA_StatusCode
+convertToGeneric_backend_compressed(UA_CompressedContext *ctx, UA_CompressedSeries *s) {
+    size_t capacity = s->count > 8 ? s->count * 2 : 16;
+    UA_DateTime *times = (UA_DateTime*)UA_malloc(capacity * sizeof(UA_DateTime));
+    UA_DataValue *dataValues = (UA_DataValue*)UA_malloc(capacity * sizeof(UA_DataValue));
+    if (!times || !dataValues) {
+        UA_free(times);
+        UA_free(dataValues);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    size_t index = 0;
+    for (size_t i = 0; i < s->blocksSize; ++i) {
+        decodeBlock_backend_compressed(&s->blocks[i], ctx->cache);
+        for (size_t j = 0; j < s->blocks[i].count; ++j) {
+            UA_DataValue dv;
+            sampleToDataValue_backend_compressed(s, &ctx->cache[j], &dv);
+            times[index] = ctx->cache[j].time;
+            UA_StatusCode retval = UA_DataValue_copy(&dv, &dataValues[index]);
+            if (retval != UA_STATUSCODE_GOOD) {
+                for (size_t k = 0; k < index; ++k)
+                    UA_DataValue_deleteMembers(&dataValues[k]);
+                UA_free(times);
+                UA_free(dataValues);
+                ctx->cacheSeries = NULL;
+                return retval;
+            }
+            ++index;
+        }
+    }
+    ctx->cacheSeries = NULL;
+    for (size_t i = 0; i < s->blocksSize; ++i)
+        UA_free(s->blocks[i].data);
+    UA_free(s->blocks);
+    s->blocks = NULL;
+    s->blocksSize = 0;
+    s->type = NULL;
+    s->generic = true;
+    s->times = times;
+    s->dataValues = dataValues;
+    s->capacity = capacity;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+insertGeneric_backend_compressed(UA_CompressedContext *ctx, UA_CompressedSeries *s,
+                                 UA_DateTime timestamp, const UA_DataValue *value) {
+    if (s->count == s->capacity) {
+        size_t capacity = s->capacity > 0 ? s->capacity * 2 : 16;
+        UA_DateTime *times = (UA_DateTime*)
+            UA_realloc(s->times, capacity * sizeof(UA_DateTime));
+        if (!times)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        s->times = times;
+        UA_DataValue *dataValues = (UA_DataValue*)
+            UA_realloc(s->dataValues, capacity * sizeof(UA_DataValue));
+        if (!dataValues)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        s->dataValues = dataValues;
+        s->capacity = capacity;
+    }
+    UA_DataValue copy;
+    UA_StatusCode retval = UA_DataValue_copy(value, &copy);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    size_t pos = s->count;
+    if (pos > 0 && timestamp < s->times[pos - 1])
+        pos = search_backend_compressed(ctx, s, timestamp, true);
+    memmove(&s->times[pos + 1], &s->times[pos], (s->count - pos) * sizeof(UA_DateTime));
+    memmove(&s->dataValues[pos + 1], &s->dataValues[pos],
+            (s->count - pos) * sizeof(UA_DataValue));
+    s->times[pos] = timestamp;
+    s->dataValues[pos] = copy;
+    ++s->count;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+appendBlock_backend_compressed(UA_CompressedSeries *s, size_t pos) {
+    UA_CompressedBlock *blocks = (UA_CompressedBlock*)
+        UA_realloc(s->blocks, (s->blocksSize + 1) * sizeof(UA_CompressedBlock));
+    if (!blocks)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    s->blocks = blocks;
+    memmove(&blocks[pos + 1], &blocks[pos],
+            (s->blocksSize - pos) * sizeof(UA_CompressedBlock));
+    ++s->blocksSize;
+    initBlock_backend_compressed(&blocks[pos], 0);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Decodes the block, inserts the sample and encodes the block again. A full
+ * block is split in two halves. */
+static UA_StatusCode
+insertIntoBlock_backend_compressed(UA_CompressedSeries *s, size_t block,
+                                   const UA_CompressedSample *sample) {
+    UA_CompressedBlock *b = &s->blocks[block];
+    size_t count = b->count + 1;
+    UA_CompressedSample *samples = (UA_CompressedSample*)
+        UA_malloc(count * sizeof(UA_CompressedSample));
+    if (!samples)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    decodeBlock_backend_compressed(b, samples);
+    size_t pos = b->count;
+    while (pos > 0 && samples[pos - 1].time > sample->time) {
+        samples[pos] = samples[pos - 1];
+        --pos;
+    }
+    samples[pos] = *sample;
+
+    /* Encode into new blocks first, so that the old block stays valid if
+     * the memory runs out */
+    size_t split = (count > UA_COMPRESSED_BLOCKSIZE) ? count / 2 : count;
+    UA_CompressedBlock first, second;
+    initBlock_backend_compressed(&first, b->firstIndex);
+    initBlock_backend_compressed(&second, b->firstIndex + split);
+    UA_StatusCode retval = encodeBlock_backend_compressed(&first, samples, split);
+    if (retval == UA_STATUSCODE_GOOD && split < count)
+        retval = encodeBlock_backend_compressed(&second, &samples[split], count - split);
+    if (retval == UA_STATUSCODE_GOOD && split < count)
+        retval = appendBlock_backend_compressed(s, block + 1);
+    UA_free(samples);
+    if (retval != UA_STATUSCODE_GOOD) {
+        UA_free(first.data);
+        UA_free(second.data);
+        return retval;
+    }
+    b = &s->blocks[block];
+    UA_free(b->data);
+    if (split < count || block + 1 < s->blocksSize)
+        shrinkBlock_backend_compressed(&first);
+    *b = first;
+    if (split < count) {
+        if (block + 2 < s->blocksSize)
+            shrinkBlock_backend_compressed(&second);
+        s->blocks[block + 1] = second;
+    }
+    for (size_t i = block + 1; i < s->blocksSize; ++i)
+        s->blocks[i].firstIndex = s->blocks[i - 1].firstIndex + s->blocks[i - 1].count;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+insertCompressed_backend_compressed(UA_CompressedSeries *s, UA_DateTime timestamp,
+                                    const UA_DataValue *value) {
+    UA_CompressedSample sample;
+    memset(&sample, 0, sizeof(UA_CompressedSample));
+    sample.time = timestamp;
+    if (value->hasValue) {
+        s->type = value->value.type;
+        memcpy(&sample.value, value->value.data, s->type->memSize);
+        sample.flags |= UA_COMPRESSED_HASVALUE;
+    }
+    if (value->hasStatus) {
+        sample.status = value->status;
+        sample.flags |= UA_COMPRESSED_HASSTATUS;
+    }
+    if (value->hasSourceTimestamp)
+        sample.flags |= UA_COMPRESSED_HASSOURCETIMESTAMP;
+    if (value->hasServerTimestamp) {
+        sample.serverOffset = value->serverTimestamp - timestamp;
+        sample.flags |= UA_COMPRESSED_HASSERVERTIMESTAMP;
+    }
+
+    /* Out of order */
+    if (s->blocksSize > 0 && timestamp < s->blocks[s->blocksSize - 1].maxTime) {
+        size_t min = 0;
+        size_t max = s->blocksSize - 1;
+        while (min < max) {
+            size_t mid = min + (max - min) / 2;
+            if (s->blocks[mid].maxTime <= timestamp)
+                min = mid + 1;
+            else
+                max = mid;
+        }
+        return insertIntoBlock_backend_compressed(s, min, &sample);
+    }
+
+    /* Append. Start a new block if the last one is full. */
+    UA_StatusCode retval;
+    UA_CompressedBlock *last = s->blocksSize > 0 ? &s->blocks[s->blocksSize - 1] : NULL;
+    if (!last || last->count >= UA_COMPRESSED_BLOCKSIZE) {
+        retval = appendBlock_backend_compressed(s, s->blocksSize);
+        if (retval != UA_STATUSCODE_GOOD)
+            return retval;
+        last = &s->blocks[s->blocksSize - 1];
+        last->firstIndex = s->count;
+        if (s->blocksSize > 1)
+            shrinkBlock_backend_compressed(&s->blocks[s->blocksSize - 2]);
+    }
+    retval = reserveBits_backend_compressed(last, UA_COMPRESSED_MAXSAMPLEBITS);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    encodeSample_backend_compressed(last, &sample);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Removes whole blocks (or single DataValues) that are older than maxAge */
+static void
+removeOld_backend_compressed(const UA_CompressedContext *ctx, UA_CompressedSeries *s) {
+    if (ctx->maxAge <= 0 || s->count == 0)
+        return;
+    if (s->generic) {
+        UA_DateTime limit = s->times[s->count - 1] - ctx->maxAge;
+        size_t remove = 0;
+        while (remove < s->count && s->times[remove] < limit) {
+            UA_DataValue_deleteMembers(&s->dataValues[remove]);
+            ++remove;
+        }
+        if (remove == 0)
+            return;
+        s->count -= remove;
+        memmove(s->times, &s->times[remove], s->count * sizeof(UA_DateTime));
+        memmove(s->dataValues, &s->dataValues[remove], s->count * sizeof(UA_DataValue));
+        return;
+    }
+    UA_DateTime limit = s->blocks[s->blocksSize - 1].maxTime - ctx->maxAge;
+    size_t remove = 0;
+    size_t removedSamples = 0;
+    while (remove < s->blocksSize && s->blocks[remove].maxTime < limit) {
+        removedSamples += s->blocks[remove].count;
+        UA_free(s->blocks[remove].data);
+        ++remove;
+    }
+    if (remove == 0)
+        return;
+    s->blocksSize -= remove;
+    s->count -= removedSamples;
+    memmove(s->blocks, &s->blocks[remove], s->blocksSize * sizeof(UA_CompressedBlock));
+    for (size_t i = 0; i < s->blocksSize; ++i)
+        s->blocks[i].firstIndex -= removedSamples;
+}
+
+static UA_StatusCode
+insert_backend_compressed(UA_CompressedContext *ctx, UA_CompressedSeries *s,
+                          UA_DateTime timestamp, const UA_DataValue *value) {
+    UA_StatusCode retval;
+    if (!s->generic && !isNumeric_backend_compressed(s, value)) {
+        retval = convertToGeneric_backend_compressed(ctx, s);
+        if (retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+    if (s->generic)
+        retval = insertGeneric_backend_compressed(ctx, s, timestamp, value);
+    else
+        retval = insertCompressed_backend_compressed(s, timestamp, value);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    if (!s->generic)
+        ++s->count;
+    removeOld_backend_compressed(ctx, s);
+    ++s->version;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Returns a DataValue that is valid until the next call to the backend */
+static UA_DataValue *
+sampleAt_backend_compressed(UA_CompressedContext *ctx, const UA_CompressedSeries *s,
+                            size_t index) {
+    if (s->generic)
+        return &s->dataValues[index];
+    size_t block = blockAt_backend_compressed(s, index);
+    getBlock_backend_compressed(ctx, s, block);
+    sampleToDataValue_backend_compressed(s, &ctx->cache[index - s->blocks[block].firstIndex],
+                                         &ctx->scratch);
+    return &ctx->scratch;
+}
+
+static UA_DateTime
+timeAt_backend_compressed(UA_CompressedContext *ctx, const UA_CompressedSeries *s,
+                          size_t index) {
+    if (s->generic)
+        return s->times[index];
+    size_t block = blockAt_backend_compressed(s, index);
+    const UA_CompressedSample *samples = getBlock_backend_compressed(ctx, s, block);
+    return samples[index - s->blocks[block].firstIndex].time;
+}
+
+static void
+UA_CompressedSeries_delete(UA_CompressedSeries *s) {
+    for (size_t i = 0; i < s->blocksSize; ++i)
+        UA_free(s->blocks[i].data);
+    UA_free(s->blocks);
+    for (size_t i = 0; i < s->count && s->generic; ++i)
+        UA_DataValue_deleteMembers(&s->dataValues[i]);
+    UA_free(s->times);
+    UA_free(s->dataValues);
+    UA_NodeId_deleteMembers(&s->nodeId);
+    UA_free(s);
+}
+
+/**************/
+/* Hash Index */
+/**************/
+
+static UA_CompressedSeries *
+findSeries_backend_compressed(const UA_CompressedContext *ctx, const UA_NodeId *nodeId) {
+    if (ctx->slotsSize == 0)
+        return NULL;
+    UA_UInt32 hash = UA_NodeId_hash(nodeId);
+    size_t mask = ctx->slotsSize - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        UA_CompressedSeries *s = ctx->slots[i];
+        if (!s)
+            return NULL;
+        if (s->hash == hash && UA_NodeId_equal(&s->nodeId, nodeId))
+            return s;
+    }
+}
+
+static void
+insertSlot_backend_compressed(UA_CompressedSeries **slots, size_t slotsSize,
+                              UA_CompressedSeries *s) {
+    size_t mask = slotsSize - 1;
+    size_t i = s->hash & mask;
+    while (slots[i])
+        i = (i + 1) & mask;
+    slots[i] = s;
+}
+
+static UA_StatusCode
+growIndex_backend_compressed(UA_CompressedContext *ctx, size_t slotsSize) {
+    UA_CompressedSeries **slots = (UA_CompressedSeries**)
+        UA_calloc(slotsSize, sizeof(UA_CompressedSeries*));
+    if (!slots)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for (size_t i = 0; i < ctx->slotsSize; ++i) {
+        if (ctx->slots[i])
+            insertSlot_backend_compressed(slots, slotsSize, ctx->slots[i]);
+    }
+    UA_free(ctx->slots);
+    ctx->slots = slots;
+    ctx->slotsSize = slotsSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_CompressedSeries *
+addSeries_backend_compressed(UA_CompressedContext *ctx, const UA_NodeId *nodeId) {
+    if ((ctx->seriesCount + 1) * 2 > ctx->slotsSize) {
+        if (growIndex_backend_compressed(ctx, ctx->slotsSize * 2) != UA_STATUSCODE_GOOD)
+            return NULL;
+    }
+    UA_CompressedSeries *s = (UA_CompressedSeries*)UA_calloc(1, sizeof(UA_CompressedSeries));
+    if (!s)
+        return NULL;
+    if (UA_NodeId_copy(nodeId, &s->nodeId) != UA_STATUSCODE_GOOD) {
+        UA_free(s);
+        return NULL;
+    }
+    s->hash = UA_NodeId_hash(nodeId);
+    insertSlot_backend_compressed(ctx->slots, ctx->slotsSize, s);
+    ++ctx->seriesCount;
+    return s;
+}
+
+/***********/
+/* Backend */
+/***********/
+
+static UA_StatusCode
+serverSetHistoryData_backend_compressed(UA_Server *server,
+                                        void *context,
+                                        const UA_NodeId *sessionId,
+                                        void *sessionContext,
+                                        const UA_NodeId *nodeId,
+                                        UA_Boolean historizing,
+                                        const UA_DataValue *value) {
+    UA_CompressedContext *ctx = (UA_CompressedContext*)context;
+    UA_CompressedSeries *s = findSeries_backend_compressed(ctx, nodeId);
+    if (!s) {
+        s = addSeries_backend_compressed(ctx, nodeId);
+        if (!s)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    UA_DateTime timestamp;
+    if (value->hasSourceTimestamp) {
+        timestamp = value->sourceTimestamp;
+    } else if (value->hasServerTimestamp) {
+        timestamp = value->serverTimestamp;
+    } else {
+        timestamp = UA_DateTime_now();
+    }
+    return insert_backend_compressed(ctx, s, timestamp, value);
+}
+
+static size_t
+getEnd_backend_compressed(UA_Server *server,
+                          void *context,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId) {
+    const UA_CompressedSeries *s =
+        findSeries_backend_compressed((UA_CompressedContext*)context, nodeId);
+    return s ? s->count : 0;
+}
+
+static size_t
+lastIndex_backend_compressed(UA_Server *server,
+                             void *context,
+                             const UA_NodeId *sessionId,
+                             void *sessionContext,
+                             const UA_NodeId *nodeId) {
+    return getEnd_backend_compressed(server, context, sessionId,
+                                     sessionContext, nodeId) - 1;
+}
+
+static size_t
+firstIndex_backend_compressed(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId) {
+    return 0;
+}
+
+static size_t
+resultSize_backend_compressed(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId,
+                              size_t startIndex,
+                              size_t endIndex) {
+    size_t storeEnd = getEnd_backend_compressed(server, context, sessionId,
+                                                sessionContext, nodeId);
+    if (storeEnd == 0 || startIndex == storeEnd || endIndex == storeEnd)
+        return 0;
+    return endIndex - startIndex + 1;
+}
+
+static size_t
+getDateTimeMatch_backend_compressed(UA_Server *server,
+                                    void *context,
+                                    const UA_NodeId *sessionId,
+                                    void *sessionContext,
+                                    const UA_NodeId *nodeId,
+                                    const UA_DateTime timestamp,
+                                    const MatchStrategy strategy) {
+    UA_CompressedContext *ctx = (UA_CompressedContext*)context;
+    const UA_CompressedSeries *s = findSeries_backend_compressed(ctx, nodeId);
+    if (!s || s->count == 0)
+        return 0;
+    size_t current = search_backend_compressed(ctx, s, timestamp, false);
+    UA_Boolean equal = (current < s->count &&
+                        timeAt_backend_compressed(ctx, s, current) == timestamp);
+    switch (strategy) {
+    case MATCH_EQUAL:
+        return equal ? current : s->count;
+    case MATCH_AFTER:
+        return search_backend_compressed(ctx, s, timestamp, true);
+    case MATCH_EQUAL_OR_AFTER:
+        return current;
+    case MATCH_EQUAL_OR_BEFORE:
+        if (equal)
+            return current;
+        /* Fall through */
+    case MATCH_BEFORE:
+        return current > 0 ? current - 1 : s->count;
+    default:
+        break;
+    }
+    return s->count;
+}
+
+static UA_Boolean
+boundSupported_backend_compressed(UA_Server *server,
+                                  void *context,
+                                  const UA_NodeId *sessionId,
+                                  void *sessionContext,
+                                  const UA_NodeId *nodeId) {
+    return true;
+}
+
+static UA_Boolean
+timestampsToReturnSupported_backend_compressed(UA_Server *server,
+                                               void *context,
+                                               const UA_NodeId *sessionId,
+                                               void *sessionContext,
+                                               const UA_NodeId *nodeId,
+                                               const UA_TimestampsToReturn timestampsToReturn) {
+    UA_CompressedContext *ctx = (UA_CompressedContext*)context;
+    const UA_CompressedSeries *s = findSeries_backend_compressed(ctx, nodeId);
+    if (!s || s->count == 0)
+        return true;
+    const UA_DataValue *first = sampleAt_backend_compressed(ctx, s, 0);
+    if (timestampsToReturn == UA_TIMESTAMPSTORETURN_NEITHER
+            || timestampsToReturn == UA_TIMESTAMPSTORETURN_INVALID
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_SERVER
+                && !first->hasServerTimestamp)
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_SOURCE
+                && !first->hasSourceTimestamp)
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_BOTH
+                && !(first->hasSourceTimestamp && first->hasServerTimestamp))) {
+        return false;
+    }
+    return true;
+}
+
+/* The DataValue is valid until the next call to the backend */
+static const UA_DataValue*
+getDataValue_backend_compressed(UA_Server *server,
+                                void *context,
+                                const UA_NodeId *sessionId,
+                                void *sessionContext,
+                                const UA_NodeId *nodeId,
+                                size_t index) {
+    UA_CompressedContext *ctx = (UA_CompressedContext*)context;
+    const UA_CompressedSeries *s = findSeries_backend_compressed(ctx, nodeId);
+    if (!s || index >= s->count)
+        return NULL;
+    return sampleAt_backend_compressed(ctx, s, index);
+}
+
+static void
+copySample_backend_compressed(UA_CompressedContext *ctx, const UA_CompressedSeries *s,
+                              size_t index, const UA_NumericRange *range,
+                              UA_DataValue *dst) {
+    const UA_DataValue *dv = sampleAt_backend_compressed(ctx, s, index);
+    if (range->dimensionsSize == 0) {
+        UA_DataValue_copy(dv, dst);
+        return;
+    }
+    memcpy(dst, dv, sizeof(UA_DataValue));
+    UA_Variant_init(&dst->value);
+    if (dv->hasValue)
+        UA_Variant_copyRange(&dv->value, &dst->value, *range);
+}
+
+static UA_StatusCode
+copyDataValues_backend_compressed(UA_Server *server,
+                                  void *context,
+                                  const UA_NodeId *sessionId,
+                                  void *sessionContext,
+                                  const UA_NodeId *nodeId,
+                                  size_t startIndex,
+                                  size_t endIndex,
+                                  UA_Boolean reverse,
+                                  size_t maxValues,
+                                  UA_NumericRange range,
+                                  UA_Boolean releaseContinuationPoints,
+                                  const UA_ByteString *continuationPoint,
+                                  UA_ByteString *outContinuationPoint,
+                                  size_t *providedValues,
+                                  UA_DataValue *values) {
+    size_t skip = 0;
+    if (continuationPoint->length > 0) {
+        if (continuationPoint->length == sizeof(size_t)) {
+            memcpy(&skip, continuationPoint->data, sizeof(size_t));
+        } else {
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        }
+    }
+    UA_CompressedContext *ctx = (UA_CompressedContext*)context;
+    const UA_CompressedSeries *s = findSeries_backend_compressed(ctx, nodeId);
+    size_t storeEnd = s ? s->count : 0;
+    size_t index = startIndex;
+    size_t counter = 0;
+    size_t skipedValues = 0;
+    if (reverse) {
+        while (index >= endIndex && index < storeEnd && counter < maxValues) {
+            if (skipedValues++ >= skip) {
+                copySample_backend_compressed(ctx, s, index, &range, &values[counter]);
+                ++counter;
+            }
+            --index;
+        }
+    } else {
+        while (index <= endIndex && index < storeEnd && counter < maxValues) {
+            if (skipedValues++ >= skip) {
+                copySample_backend_compressed(ctx, s, index, &range, &values[counter]);
+                ++counter;
+            }
+            ++index;
+        }
+    }
+
+    if (providedValues)
+        *providedValues = counter;
+
+    if ((!reverse && (endIndex-startIndex-skip+1) > counter) ||
+        (reverse && (startIndex-endIndex-skip+1) > counter)) {
+        outContinuationPoint->data = (UA_Byte*)UA_malloc(sizeof(size_t));
+        if (!outContinuationPoint->data)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        outContinuationPoint->length = sizeof(size_t);
+        size_t next = skip + counter;
+        memcpy(outContinuationPoint->data, &next, sizeof(size_t));
+    }
+
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+UA_CompressedContext_delete(UA_CompressedContext *ctx) {
+    for (size_t i = 0; i < ctx->slotsSize; ++i) {
+        if (ctx->slots[i])
+            UA_CompressedSeries_delete(ctx->slots[i]);
+    }
+    UA_free(ctx->slots);
+    UA_free(ctx);
+}
+
+static void
+deleteMembers_backend_compressed(UA_HistoryDataBackend *backend) {
+    if (backend == NULL || backend->context == NULL)
+        return;
+    UA_CompressedContext_delete((UA_CompressedContext*)backend->context);
+    backend->context = NULL;
+}
+
+UA_HistoryDataBackend
+UA_HistoryDataBackend_Compressed(size_t initialNodeIdStoreSize, UA_DateTime maxAge) {
+    UA_HistoryDataBackend result;
+    memset(&result, 0, sizeof(UA_HistoryDataBackend));
+    UA_CompressedContext *ctx = (UA_CompressedContext*)
+        UA_calloc(1, sizeof(UA_CompressedContext));
+    if (!ctx)
+        return result;
+    ctx->maxAge = maxAge;
+
+    /* Size the index for the expected number of nodes */
+    size_t slotsSize = 16;
+    while (slotsSize < initialNodeIdStoreSize * 2)
+        slotsSize *= 2;
+    if (growIndex_backend_compressed(ctx, slotsSize) != UA_STATUSCODE_GOOD) {
+        UA_free(ctx);
+        return result;
+    }
+
+    result.serverSetHistoryData = &serverSetHistoryData_backend_compressed;
+    result.resultSize = &resultSize_backend_compressed;
+    result.getEnd = &getEnd_backend_compressed;
+    result.lastIndex = &lastIndex_backend_compressed;
+    result.firstIndex = &firstIndex_backend_compressed;
+    result.getDateTimeMatch = &getDateTimeMatch_backend_compressed;
+    result.copyDataValues = &copyDataValues_backend_compressed;
+    result.getDataValue = &getDataValue_backend_compressed;
+    result.boundSupported = &boundSupported_backend_compressed;
+    result.timestampsToReturnSupported = &timestampsToReturnSupported_backend_compressed;
+    result.deleteMembers = &deleteMembers_backend_compressed;
+    result.getHistoryData = NULL;
+    result.context = ctx;
+    return result;
+}
+
+void
+UA_HistoryDataBackend_Compressed_deleteMembers(UA_HistoryDataBackend *backend) {
+    deleteMembers_backend_compressed(backend);
+    memset(backend, 0, sizeof(UA_HistoryDataBackend));
+}
+
+size_t
+UA_HistoryDataBackend_Compressed_memoryUsage(const UA_HistoryDataBackend *backend) {
+    const UA_CompressedContext *ctx = (const UA_CompressedContext*)backend->context;
+    if (!ctx)
+        return 0;
+    size_t size = sizeof(UA_CompressedContext) +
+        ctx->slotsSize * sizeof(UA_CompressedSeries*);
+    for (size_t i = 0; i < ctx->slotsSize; ++i) {
+        const UA_CompressedSeries *s = ctx->slots[i];
+        if (!s)
+            continue;
+        size += sizeof(UA_CompressedSeries);
+        size += s->blocksSize * sizeof(UA_CompressedBlock);
+        for (size_t j = 0; j < s->blocksSize; ++j)
+            size += s->blocks[j].capacity;
+        size += s->capacity * (sizeof(UA_DateTime) + sizeof(UA_DataValue));
+        for (size_t j = 0; j < s->count && s->generic; ++j) {
+            const UA_Variant *v = &s->dataValues[j].value;
+            if (v->type && v->data > UA_EMPTY_ARRAY_SENTINEL)
+                size += v->type->memSize * (v->arrayLength > 0 ? v->arrayLength : 1);
+        }
+    }
+    return size;
+}
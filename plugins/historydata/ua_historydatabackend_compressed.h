@@ -0,0 +1,39 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UA_HISTORYDATABACKEND_COMPRESSED_H_
+#define UA_HISTORYDATABACKEND_COMPRESSED_H_
+
+#include "ua_plugin_history_data_backend.h"
+
+_UA_BEGIN_DECLS
+
+/* In-memory backend that compresses numeric series. Samples with a scalar
+ * numeric value (Boolean up to Double, DateTime and StatusCode) and without
+ * picoseconds are packed into blocks of up to 256 samples. Within a block the
+ * timestamps are stored as delta-of-deltas and the values as the XOR with the
+ * previous value (Gorilla encoding). Status codes, flags and server timestamps
+ * use a single bit while they do not change. A regular series with slowly
+ * changing values takes a few bytes per sample.
+ *
+ * Reads decode only the blocks that contain the requested samples. Samples
+ * that arrive out of order cause their block to be encoded again. A node that
+ * receives another kind of sample is converted once to store DataValues.
+ *
+ * If maxAge is not zero, blocks are removed once their newest sample is older
+ * than maxAge compared to the newest sample of the node. */
+UA_HistoryDataBackend UA_EXPORT
+UA_HistoryDataBackend_Compressed(size_t initialNodeIdStoreSize, UA_DateTime maxAge);
+
+void UA_EXPORT
+UA_HistoryDataBackend_Compressed_deleteMembers(UA_HistoryDataBackend *backend);
+
+/* Returns the number of bytes allocated for the stored samples */
+size_t UA_EXPORT
+UA_HistoryDataBackend_Compressed_memoryUsage(const UA_HistoryDataBackend *backend);
+
+_UA_END_DECLS
+
+#endif /* UA_HISTORYDATABACKEND_COMPRESSED_H_ */
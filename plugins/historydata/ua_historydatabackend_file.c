@@ -0,0 +1,1112 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ua_historydatabackend_file.h"
+#include "ua_types_encoding_binary.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Every n-th record of a sorted segment is in the sparse index */
+#define UA_HISTORYFILE_SPARSE 64
+
+/* Segments that stay mapped. The least recently used mapping is removed
+ * first. */
+#define UA_HISTORYFILE_MAXMAPPINGS 256
+
+#define UA_HISTORYFILE_DEFAULTDURATION (24 * 3600 * UA_DATETIME_SEC)
+
+/* Files start with a magic. A record is the timestamp (Int64), the length of
+ * the DataValue (UInt32) and the binary encoded DataValue. */
+#define UA_HISTORYFILE_MAGICSIZE 8
+#define UA_HISTORYFILE_RECORDHEADER 12
+
+static const UA_Byte historyFileSegmentMagic[UA_HISTORYFILE_MAGICSIZE] =
+    {'U', 'A', 'H', 'I', 'S', 'S', 'E', 'G'};
+static const UA_Byte historyFileCatalogMagic[UA_HISTORYFILE_MAGICSIZE] =
+    {'U', 'A', 'H', 'I', 'S', 'C', 'A', 'T'};
+
+typedef struct {
+    UA_DateTime time;
+    size_t offset;
+} UA_HistoryFileEntry;
+
+typedef struct {
+    UA_Int64 window; /* Start of the time window in multiples of the duration */
+    size_t firstIndex; /* Index of the first sample in the series */
+    size_t count;
+    UA_DateTime minTime;
+    UA_DateTime maxTime;
+    size_t fileSize; /* Length of the valid records */
+
+    /* All records of the file were appended in order. Then the sparse index
+     * contains every UA_HISTORYFILE_SPARSE-th record. Otherwise all records
+     * are sorted into the order array when the segment is read. */
+    UA_Boolean sorted;
+    UA_HistoryFileEntry *sparse;
+    size_t sparseSize;
+    size_t sparseCapacity;
+    UA_HistoryFileEntry *order;
+
+    UA_Byte *map;
+    size_t mapLength;
+    UA_UInt64 lastUse;
+} UA_HistoryFileSegment;
+
+typedef struct {
+    UA_NodeId nodeId;
+    UA_UInt32 hash;
+    UA_UInt32 id; /* Position in the catalog */
+    size_t count;
+    UA_HistoryFileSegment *segments; /* Sorted by the window */
+    size_t segmentsSize;
+
+    /* The segment that was written last stays open */
+    int appendFd;
+    UA_Int64 appendWindow;
+} UA_HistoryFileSeries;
+
+typedef struct {
+    char *directory;
+    UA_DateTime segmentDuration;
+    int catalogFd;
+    UA_HistoryFileSeries **series;
+    size_t seriesSize;
+    size_t mappedCount;
+    UA_UInt64 useCounter;
+    UA_DataValue scratch; /* Returned by getDataValue */
+} UA_HistoryFileContext;
+
+/***********/
+/* Helpers */
+/***********/
+
+static void
+writeUInt32_backend_file(UA_Byte *p, UA_UInt32 v) {
+    for (size_t i = 0; i < 4; ++i)
+        p[i] = (UA_Byte)(v >> (8 * i));
+}
+
+static UA_UInt32
+readUInt32_backend_file(const UA_Byte *p) {
+    UA_UInt32 v = 0;
+    for (size_t i = 0; i < 4; ++i)
+        v |= (UA_UInt32)p[i] << (8 * i);
+    return v;
+}
+
+static void
+writeUInt64_backend_file(UA_Byte *p, UA_UInt64 v) {
+    for (size_t i = 0; i < 8; ++i)
+        p[i] = (UA_Byte)(v >> (8 * i));
+}
+
+static UA_UInt64
+readUInt64_backend_file(const UA_Byte *p) {
+    UA_UInt64 v = 0;
+    for (size_t i = 0; i < 8; ++i)
+        v |= (UA_UInt64)p[i] << (8 * i);
+    return v;
+}
+
+static char *
+path_backend_file(const UA_HistoryFileContext *ctx, const char *name) {
+    size_t length = strlen(ctx->directory) + strlen(name) + 2;
+    char *path = (char*)UA_malloc(length);
+    if (path)
+        snprintf(path, length, "%s/%s", ctx->directory, name);
+    return path;
+}
+
+#define UA_HISTORYFILE_NAMESIZE 32
+
+static void
+segmentName_backend_file(const UA_HistoryFileSeries *series, UA_Int64 window,
+                         char name[UA_HISTORYFILE_NAMESIZE]) {
+    snprintf(name, UA_HISTORYFILE_NAMESIZE, "%08x_%016llx.seg",
+             (unsigned int)series->id, (unsigned long long)(UA_UInt64)window);
+}
+
+static int
+openSegment_backend_file(const UA_HistoryFileContext *ctx,
+                         const UA_HistoryFileSeries *series,
+                         UA_Int64 window, int flags) {
+    char name[UA_HISTORYFILE_NAMESIZE];
+    segmentName_backend_file(series, window, name);
+    char *path = path_backend_file(ctx, name);
+    if (!path)
+        return -1;
+    int fd = open(path, flags, 0644);
+    UA_free(path);
+    return fd;
+}
+
+static UA_StatusCode
+writeAll_backend_file(int fd, const UA_Byte *buf, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, buf, length);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        buf += n;
+        length -= (size_t)n;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_Int64
+window_backend_file(const UA_HistoryFileContext *ctx, UA_DateTime timestamp) {
+    UA_Int64 window = timestamp / ctx->segmentDuration;
+    if (timestamp < 0 && timestamp % ctx->segmentDuration != 0)
+        --window;
+    return window;
+}
+
+/************/
+/* Segments */
+/************/
+
+static UA_DateTime
+recordTime_backend_file(const UA_HistoryFileSegment *seg, size_t offset) {
+    return (UA_DateTime)readUInt64_backend_file(&seg->map[offset]);
+}
+
+static size_t
+recordEnd_backend_file(const UA_HistoryFileSegment *seg, size_t offset) {
+    return offset + UA_HISTORYFILE_RECORDHEADER +
+        readUInt32_backend_file(&seg->map[offset + 8]);
+}
+
+static void
+clearSegment_backend_file(UA_HistoryFileSegment *seg) {
+    if (seg->map)
+        munmap(seg->map, seg->mapLength);
+    UA_free(seg->sparse);
+    UA_free(seg->order);
+}
+
+static void
+unmap_backend_file(UA_HistoryFileContext *ctx, UA_HistoryFileSegment *seg) {
+    if (!seg->map)
+        return;
+    munmap(seg->map, seg->mapLength);
+    seg->map = NULL;
+    seg->mapLength = 0;
+    --ctx->mappedCount;
+}
+
+static void
+unmapLeastRecentlyUsed_backend_file(UA_HistoryFileContext *ctx) {
+    UA_HistoryFileSegment *oldest = NULL;
+    for (size_t i = 0; i < ctx->seriesSize; ++i) {
+        UA_HistoryFileSeries *series = ctx->series[i];
+        for (size_t j = 0; j < series->segmentsSize; ++j) {
+            UA_HistoryFileSegment *seg = &series->segments[j];
+            if (seg->map && (!oldest || seg->lastUse < oldest->lastUse))
+                oldest = seg;
+        }
+    }
+    if (oldest)
+        unmap_backend_file(ctx, oldest);
+}
+
+static UA_StatusCode
+map_backend_file(UA_HistoryFileContext *ctx, const UA_HistoryFileSeries *series,
+                 UA_HistoryFileSegment *seg) {
+    seg->lastUse = ++ctx->useCounter;
+    if (seg->map && seg->mapLength == seg->fileSize)
+        return UA_STATUSCODE_GOOD;
+
+    /* The file has grown */
+    unmap_backend_file(ctx, seg);
+    if (ctx->mappedCount >= UA_HISTORYFILE_MAXMAPPINGS)
+        unmapLeastRecentlyUsed_backend_file(ctx);
+
+    int fd = openSegment_backend_file(ctx, series, seg->window, O_RDONLY);
+    if (fd < 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    void *map = mmap(NULL, seg->fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    seg->map = (UA_Byte*)map;
+    seg->mapLength = seg->fileSize;
+    ++ctx->mappedCount;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Reserves the sparse index entry for the next record */
+static UA_StatusCode
+reserve_backend_file(UA_HistoryFileSegment *seg) {
+    if (!seg->sorted || seg->count % UA_HISTORYFILE_SPARSE != 0 ||
+        seg->sparseSize < seg->sparseCapacity)
+        return UA_STATUSCODE_GOOD;
+    size_t capacity = seg->sparseCapacity > 0 ? seg->sparseCapacity * 2 : 4;
+    UA_HistoryFileEntry *sparse = (UA_HistoryFileEntry*)
+        UA_realloc(seg->sparse, capacity * sizeof(UA_HistoryFileEntry));
+    if (!sparse)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    seg->sparse = sparse;
+    seg->sparseCapacity = capacity;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Adds a record at the end of the file. Call reserve_backend_file first. */
+static void
+addRecord_backend_file(UA_HistoryFileSegment *seg, size_t offset,
+                       size_t length, UA_DateTime timestamp) {
+    if (seg->sorted && seg->count > 0 && timestamp < seg->maxTime) {
+        seg->sorted = false;
+        UA_free(seg->sparse);
+        seg->sparse = NULL;
+        seg->sparseSize = 0;
+        seg->sparseCapacity = 0;
+    }
+    if (seg->sorted && seg->count % UA_HISTORYFILE_SPARSE == 0) {
+        seg->sparse[seg->sparseSize].time = timestamp;
+        seg->sparse[seg->sparseSize].offset = offset;
+        ++seg->sparseSize;
+    }
+    UA_free(seg->order);
+    seg->order = NULL;
+    if (seg->count == 0 || timestamp < seg->minTime)
+        seg->minTime = timestamp;
+    if (seg->count == 0 || timestamp > seg->maxTime)
+        seg->maxTime = timestamp;
+    ++seg->count;
+    seg->fileSize = offset + length;
+}
+
+static int
+compareEntries_backend_file(const void *a, const void *b) {
+    const UA_HistoryFileEntry *ea = (const UA_HistoryFileEntry*)a;
+    const UA_HistoryFileEntry *eb = (const UA_HistoryFileEntry*)b;
+    if (ea->time != eb->time)
+        return (ea->time < eb->time) ? -1 : 1;
+    /* Keep the order of insertion for equal timestamps */
+    if (ea->offset != eb->offset)
+        return (ea->offset < eb->offset) ? -1 : 1;
+    return 0;
+}
+
+/* Maps the segment and sorts the records if they were not appended in order */
+static UA_StatusCode
+prepare_backend_file(UA_HistoryFileContext *ctx, const UA_HistoryFileSeries *series,
+                     UA_HistoryFileSegment *seg) {
+    UA_StatusCode retval = map_backend_file(ctx, series, seg);
+    if (retval != UA_STATUSCODE_GOOD || seg->sorted || seg->order)
+        return retval;
+    seg->order = (UA_HistoryFileEntry*)UA_malloc(seg->count * sizeof(UA_HistoryFileEntry));
+    if (!seg->order)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    size_t offset = UA_HISTORYFILE_MAGICSIZE;
+    for (size_t i = 0; i < seg->count; ++i) {
+        seg->order[i].time = recordTime_backend_file(seg, offset);
+        seg->order[i].offset = offset;
+        offset = recordEnd_backend_file(seg, offset);
+    }
+    qsort(seg->order, seg->count, sizeof(UA_HistoryFileEntry),
+          compareEntries_backend_file);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Offset of the k-th sample in time order. The segment is prepared. */
+static size_t
+locate_backend_file(const UA_HistoryFileSegment *seg, size_t k) {
+    if (!seg->sorted)
+        return seg->order[k].offset;
+    size_t offset = seg->sparse[k / UA_HISTORYFILE_SPARSE].offset;
+    for (size_t i = k % UA_HISTORYFILE_SPARSE; i > 0; --i)
+        offset = recordEnd_backend_file(seg, offset);
+    return offset;
+}
+
+static UA_Boolean
+isBefore_backend_file(UA_DateTime t, UA_DateTime timestamp, UA_Boolean after) {
+    return (t < timestamp || (after && t == timestamp));
+}
+
+/* Number of samples in the prepared segment before (or up to, if after is
+ * set) the timestamp */
+static size_t
+segmentSearch_backend_file(const UA_HistoryFileSegment *seg,
+                           UA_DateTime timestamp, UA_Boolean after) {
+    const UA_HistoryFileEntry *entries = seg->sorted ? seg->sparse : seg->order;
+    size_t min = 0;
+    size_t max = seg->sorted ? seg->sparseSize : seg->count;
+    while (min < max) {
+        size_t mid = min + (max - min) / 2;
+        if (isBefore_backend_file(entries[mid].time, timestamp, after))
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    if (!seg->sorted || min == 0)
+        return min;
+
+    /* Scan the records of the sparse block */
+    size_t k = (min - 1) * UA_HISTORYFILE_SPARSE;
+    size_t offset = seg->sparse[min - 1].offset;
+    while (k < seg->count &&
+           isBefore_backend_file(recordTime_backend_file(seg, offset), timestamp, after)) {
+        ++k;
+        offset = recordEnd_backend_file(seg, offset);
+    }
+    return k;
+}
+
+/**********/
+/* Series */
+/**********/
+
+static UA_HistoryFileSeries *
+findSeries_backend_file(const UA_HistoryFileContext *ctx, const UA_NodeId *nodeId) {
+    UA_UInt32 hash = UA_NodeId_hash(nodeId);
+    for (size_t i = 0; i < ctx->seriesSize; ++i) {
+        UA_HistoryFileSeries *series = ctx->series[i];
+        if (series->hash == hash && UA_NodeId_equal(&series->nodeId, nodeId))
+            return series;
+    }
+    return NULL;
+}
+
+static UA_HistoryFileSeries *
+addSeries_backend_file(UA_HistoryFileContext *ctx, const UA_NodeId *nodeId) {
+    UA_HistoryFileSeries **list = (UA_HistoryFileSeries**)
+        UA_realloc(ctx->series, (ctx->seriesSize + 1) * sizeof(UA_HistoryFileSeries*));
+    if (!list)
+        return NULL;
+    ctx->series = list;
+    UA_HistoryFileSeries *series = (UA_HistoryFileSeries*)
+        UA_calloc(1, sizeof(UA_HistoryFileSeries));
+    if (!series)
+        return NULL;
+    if (UA_NodeId_copy(nodeId, &series->nodeId) != UA_STATUSCODE_GOOD) {
+        UA_free(series);
+        return NULL;
+    }
+    series->hash = UA_NodeId_hash(nodeId);
+    series->id = (UA_UInt32)ctx->seriesSize;
+    series->appendFd = -1;
+    ctx->series[ctx->seriesSize] = series;
+    ++ctx->seriesSize;
+    return series;
+}
+
+static void
+deleteSeries_backend_file(UA_HistoryFileSeries *series) {
+    if (series->appendFd >= 0)
+        close(series->appendFd);
+    for (size_t i = 0; i < series->segmentsSize; ++i)
+        clearSegment_backend_file(&series->segments[i]);
+    UA_free(series->segments);
+    UA_NodeId_deleteMembers(&series->nodeId);
+    UA_free(series);
+}
+
+/* The position in the catalog is the id of the series */
+static UA_HistoryFileSeries *
+createSeries_backend_file(UA_HistoryFileContext *ctx, const UA_NodeId *nodeId) {
+    size_t length = UA_calcSizeBinary(nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_Byte *buf = (UA_Byte*)UA_malloc(length + 4);
+    if (!buf)
+        return NULL;
+    writeUInt32_backend_file(buf, (UA_UInt32)length);
+    UA_Byte *pos = &buf[4];
+    const UA_Byte *end = &buf[length + 4];
+    UA_StatusCode retval = UA_encodeBinary(nodeId, &UA_TYPES[UA_TYPES_NODEID],
+                                           &pos, &end, NULL, NULL);
+    UA_HistoryFileSeries *series = NULL;
+    if (retval == UA_STATUSCODE_GOOD)
+        series = addSeries_backend_file(ctx, nodeId);
+    off_t catalogEnd = lseek(ctx->catalogFd, 0, SEEK_END);
+    if (series && catalogEnd >= 0 &&
+        writeAll_backend_file(ctx->catalogFd, buf, length + 4) != UA_STATUSCODE_GOOD) {
+        /* Remove a partially written entry */
+        if (ftruncate(ctx->catalogFd, catalogEnd) != 0) {
+            /* Nothing more to do */
+        }
+        --ctx->seriesSize;
+        deleteSeries_backend_file(series);
+        series = NULL;
+    }
+    UA_free(buf);
+    return series;
+}
+
+static void
+updateIndices_backend_file(UA_HistoryFileSeries *series) {
+    series->count = 0;
+    for (size_t i = 0; i < series->segmentsSize; ++i) {
+        series->segments[i].firstIndex = series->count;
+        series->count += series->segments[i].count;
+    }
+}
+
+/* Adds an empty segment. The file is created by the caller. */
+static UA_HistoryFileSegment *
+addSegment_backend_file(UA_HistoryFileSeries *series, UA_Int64 window) {
+    size_t pos = series->segmentsSize;
+    while (pos > 0 && series->segments[pos - 1].window > window)
+        --pos;
+    UA_HistoryFileSegment *segments = (UA_HistoryFileSegment*)
+        UA_realloc(series->segments, (series->segmentsSize + 1) * sizeof(UA_HistoryFileSegment));
+    if (!segments)
+        return NULL;
+    series->segments = segments;
+    memmove(&segments[pos + 1], &segments[pos],
+            (series->segmentsSize - pos) * sizeof(UA_HistoryFileSegment));
+    ++series->segmentsSize;
+    UA_HistoryFileSegment *seg = &segments[pos];
+    memset(seg, 0, sizeof(UA_HistoryFileSegment));
+    seg->window = window;
+    seg->sorted = true;
+    seg->fileSize = UA_HISTORYFILE_MAGICSIZE;
+    seg->firstIndex = (pos + 1 < series->segmentsSize) ?
+        segments[pos + 1].firstIndex : series->count;
+    return seg;
+}
+
+static UA_HistoryFileSegment *
+findSegment_backend_file(UA_HistoryFileSeries *series, UA_Int64 window) {
+    size_t min = 0;
+    size_t max = series->segmentsSize;
+    while (min < max) {
+        size_t mid = min + (max - min) / 2;
+        if (series->segments[mid].window == window)
+            return &series->segments[mid];
+        if (series->segments[mid].window < window)
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    return NULL;
+}
+
+/* Segment that contains the sample with the index */
+static UA_HistoryFileSegment *
+segmentAt_backend_file(UA_HistoryFileSeries *series, size_t index) {
+    size_t min = 0;
+    size_t max = series->segmentsSize;
+    while (min < max) {
+        size_t mid = min + (max - min) / 2;
+        if (series->segments[mid].firstIndex <= index)
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    return &series->segments[min - 1];
+}
+
+/* Index of the first sample at or after (after the timestamp, if after is
+ * set) the timestamp. Returns the number of samples if there is none. */
+static size_t
+search_backend_file(UA_HistoryFileContext *ctx, UA_HistoryFileSeries *series,
+                    UA_DateTime timestamp, UA_Boolean after) {
+    /* The windows do not overlap. Empty segments are compared by the start of
+     * their window. */
+    size_t min = 0;
+    size_t max = series->segmentsSize;
+    while (min < max) {
+        size_t mid = min + (max - min) / 2;
+        const UA_HistoryFileSegment *seg = &series->segments[mid];
+        UA_DateTime last = seg->count > 0 ? seg->maxTime :
+            seg->window * ctx->segmentDuration;
+        if (isBefore_backend_file(last, timestamp, after))
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    if (min == series->segmentsSize)
+        return series->count;
+    UA_HistoryFileSegment *seg = &series->segments[min];
+    if (prepare_backend_file(ctx, series, seg) != UA_STATUSCODE_GOOD)
+        return series->count;
+    return seg->firstIndex + segmentSearch_backend_file(seg, timestamp, after);
+}
+
+static UA_StatusCode
+decodeSample_backend_file(UA_HistoryFileContext *ctx, UA_HistoryFileSeries *series,
+                          size_t index, UA_DataValue *dst) {
+    UA_HistoryFileSegment *seg = segmentAt_backend_file(series, index);
+    UA_StatusCode retval = prepare_backend_file(ctx, series, seg);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    size_t offset = locate_backend_file(seg, index - seg->firstIndex);
+    UA_ByteString record;
+    record.data = seg->map;
+    record.length = recordEnd_backend_file(seg, offset);
+    offset += UA_HISTORYFILE_RECORDHEADER;
+    return UA_decodeBinary(&record, &offset, dst, &UA_TYPES[UA_TYPES_DATAVALUE], NULL);
+}
+
+static UA_StatusCode
+append_backend_file(UA_HistoryFileContext *ctx, UA_HistoryFileSeries *series,
+                    UA_DateTime timestamp, const UA_DataValue *value) {
+    size_t length = UA_calcSizeBinary(value, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    if (length == 0)
+        return UA_STATUSCODE_BADENCODINGERROR;
+    if (length > UA_UINT32_MAX)
+        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    UA_Byte *buf = (UA_Byte*)UA_malloc(length + UA_HISTORYFILE_RECORDHEADER);
+    if (!buf)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    writeUInt64_backend_file(buf, (UA_UInt64)timestamp);
+    writeUInt32_backend_file(&buf[8], (UA_UInt32)length);
+    UA_Byte *pos = &buf[UA_HISTORYFILE_RECORDHEADER];
+    const UA_Byte *end = &buf[length + UA_HISTORYFILE_RECORDHEADER];
+    UA_StatusCode retval = UA_encodeBinary(value, &UA_TYPES[UA_TYPES_DATAVALUE],
+                                           &pos, &end, NULL, NULL);
+    if (retval != UA_STATUSCODE_GOOD) {
+        UA_free(buf);
+        return retval;
+    }
+
+    /* Get the segment */
+    UA_Int64 window = window_backend_file(ctx, timestamp);
+    UA_HistoryFileSegment *seg = findSegment_backend_file(series, window);
+    if (!seg) {
+        int fd = openSegment_backend_file(ctx, series, window,
+                                          O_WRONLY | O_CREAT | O_TRUNC | O_APPEND);
+        if (fd < 0) {
+            UA_free(buf);
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        retval = writeAll_backend_file(fd, historyFileSegmentMagic, UA_HISTORYFILE_MAGICSIZE);
+        if (retval == UA_STATUSCODE_GOOD) {
+            seg = addSegment_backend_file(series, window);
+            if (!seg)
+                retval = UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        if (retval != UA_STATUSCODE_GOOD) {
+            close(fd);
+            UA_free(buf);
+            return retval;
+        }
+        if (series->appendFd >= 0)
+            close(series->appendFd);
+        series->appendFd = fd;
+        series->appendWindow = window;
+    } else if (series->appendFd < 0 || series->appendWindow != window) {
+        if (series->appendFd >= 0)
+            close(series->appendFd);
+        series->appendFd = openSegment_backend_file(ctx, series, window,
+                                                    O_WRONLY | O_APPEND);
+        series->appendWindow = window;
+        if (series->appendFd < 0) {
+            UA_free(buf);
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+    }
+
+    /* Write the record */
+    retval = reserve_backend_file(seg);
+    if (retval == UA_STATUSCODE_GOOD)
+        retval = writeAll_backend_file(series->appendFd, buf,
+                                       length + UA_HISTORYFILE_RECORDHEADER);
+    UA_free(buf);
+    if (retval != UA_STATUSCODE_GOOD) {
+        /* Remove a partially written record */
+        if (ftruncate(series->appendFd, (off_t)seg->fileSize) != 0)
+            retval = UA_STATUSCODE_BADINTERNALERROR;
+        return retval;
+    }
+    addRecord_backend_file(seg, seg->fileSize, length + UA_HISTORYFILE_RECORDHEADER,
+                           timestamp);
+
+    /* Move the later segments */
+    for (UA_HistoryFileSegment *s = seg + 1;
+         s < &series->segments[series->segmentsSize]; ++s)
+        ++s->firstIndex;
+    ++series->count;
+    return UA_STATUSCODE_GOOD;
+}
+
+/***********/
+/* Loading */
+/***********/
+
+static UA_StatusCode
+readFile_backend_file(int fd, UA_ByteString *content) {
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    UA_StatusCode retval = UA_ByteString_allocBuffer(content, (size_t)st.st_size);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    size_t done = 0;
+    while (done < content->length) {
+        ssize_t n = pread(fd, &content->data[done], content->length - done, (off_t)done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            UA_ByteString_deleteMembers(content);
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        done += (size_t)n;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+loadCatalog_backend_file(UA_HistoryFileContext *ctx) {
+    char *path = path_backend_file(ctx, "series");
+    if (!path)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    ctx->catalogFd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    UA_free(path);
+    if (ctx->catalogFd < 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    UA_ByteString content;
+    UA_StatusCode retval = readFile_backend_file(ctx->catalogFd, &content);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    if (content.length == 0) {
+        UA_ByteString_deleteMembers(&content);
+        return writeAll_backend_file(ctx->catalogFd, historyFileCatalogMagic,
+                                     UA_HISTORYFILE_MAGICSIZE);
+    }
+    if (content.length < UA_HISTORYFILE_MAGICSIZE ||
+        memcmp(content.data, historyFileCatalogMagic, UA_HISTORYFILE_MAGICSIZE) != 0) {
+        UA_ByteString_deleteMembers(&content);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+
+    size_t pos = UA_HISTORYFILE_MAGICSIZE;
+    while (pos + 4 <= content.length) {
+        size_t length = readUInt32_backend_file(&content.data[pos]);
+        if (length > content.length - pos - 4)
+            break;
+        UA_ByteString record;
+        record.data = content.data;
+        record.length = pos + 4 + length;
+        size_t offset = pos + 4;
+        UA_NodeId nodeId;
+        if (UA_decodeBinary(&record, &offset, &nodeId, &UA_TYPES[UA_TYPES_NODEID],
+                            NULL) != UA_STATUSCODE_GOOD)
+            break;
+        UA_HistoryFileSeries *series = addSeries_backend_file(ctx, &nodeId);
+        UA_NodeId_deleteMembers(&nodeId);
+        if (!series) {
+            retval = UA_STATUSCODE_BADOUTOFMEMORY;
+            break;
+        }
+        pos += 4 + length;
+    }
+
+    /* Cut off an incomplete entry */
+    if (retval == UA_STATUSCODE_GOOD && pos < content.length &&
+        ftruncate(ctx->catalogFd, (off_t)pos) != 0)
+        retval = UA_STATUSCODE_BADINTERNALERROR;
+    UA_ByteString_deleteMembers(&content);
+    return retval;
+}
+
+static UA_StatusCode
+loadSegment_backend_file(UA_HistoryFileContext *ctx, UA_HistoryFileSeries *series,
+                         UA_Int64 window) {
+    int fd = openSegment_backend_file(ctx, series, window, O_RDWR);
+    if (fd < 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < UA_HISTORYFILE_MAGICSIZE) {
+        close(fd);
+        return UA_STATUSCODE_GOOD; /* Ignore the file */
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    UA_Byte *data = (UA_Byte*)map;
+    if (memcmp(data, historyFileSegmentMagic, UA_HISTORYFILE_MAGICSIZE) != 0) {
+        munmap(map, size);
+        close(fd);
+        return UA_STATUSCODE_GOOD;
+    }
+
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    UA_HistoryFileSegment *seg = addSegment_backend_file(series, window);
+    if (!seg)
+        retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    size_t pos = UA_HISTORYFILE_MAGICSIZE;
+    while (retval == UA_STATUSCODE_GOOD && pos + UA_HISTORYFILE_RECORDHEADER <= size) {
+        size_t length = readUInt32_backend_file(&data[pos + 8]);
+        if (length > size - pos - UA_HISTORYFILE_RECORDHEADER)
+            break;
+        retval = reserve_backend_file(seg);
+        if (retval != UA_STATUSCODE_GOOD)
+            break;
+        addRecord_backend_file(seg, pos, length + UA_HISTORYFILE_RECORDHEADER,
+                               (UA_DateTime)readUInt64_backend_file(&data[pos]));
+        pos += length + UA_HISTORYFILE_RECORDHEADER;
+    }
+    munmap(map, size);
+
+    /* Cut off an incomplete record */
+    if (retval == UA_STATUSCODE_GOOD && pos < size && ftruncate(fd, (off_t)pos) != 0)
+        retval = UA_STATUSCODE_BADINTERNALERROR;
+    close(fd);
+    return retval;
+}
+
+static UA_StatusCode
+loadSegments_backend_file(UA_HistoryFileContext *ctx) {
+    DIR *dir = opendir(ctx->directory);
+    if (!dir)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    struct dirent *entry;
+    while (retval == UA_STATUSCODE_GOOD && (entry = readdir(dir)) != NULL) {
+        unsigned int id;
+        unsigned long long window;
+        if (sscanf(entry->d_name, "%8x_%16llx.seg", &id, &window) != 2 ||
+            id >= ctx->seriesSize)
+            continue;
+        UA_HistoryFileSeries *series = ctx->series[id];
+        char name[UA_HISTORYFILE_NAMESIZE];
+        segmentName_backend_file(series, (UA_Int64)window, name);
+        if (strcmp(name, entry->d_name) != 0)
+            continue;
+        retval = loadSegment_backend_file(ctx, series, (UA_Int64)window);
+    }
+    closedir(dir);
+    for (size_t i = 0; i < ctx->seriesSize; ++i)
+        updateIndices_backend_file(ctx->series[i]);
+    return retval;
+}
+
+static void
+UA_HistoryFileContext_delete(UA_HistoryFileContext *ctx) {
+    for (size_t i = 0; i < ctx->seriesSize; ++i)
+        deleteSeries_backend_file(ctx->series[i]);
+    UA_free(ctx->series);
+    if (ctx->catalogFd >= 0)
+        close(ctx->catalogFd);
+    UA_DataValue_deleteMembers(&ctx->scratch);
+    UA_free(ctx->directory);
+    UA_free(ctx);
+}
+
+/***********/
+/* Backend */
+/***********/
+
+static UA_StatusCode
+serverSetHistoryData_backend_file(UA_Server *server,
+                                  void *context,
+                                  const UA_NodeId *sessionId,
+                                  void *sessionContext,
+                                  const UA_NodeId *nodeId,
+                                  UA_Boolean historizing,
+                                  const UA_DataValue *value) {
+    UA_HistoryFileContext *ctx = (UA_HistoryFileContext*)context;
+    UA_HistoryFileSeries *series = findSeries_backend_file(ctx, nodeId);
+    if (!series) {
+        series = createSeries_backend_file(ctx, nodeId);
+        if (!series)
+            return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    UA_DateTime timestamp;
+    if (value->hasSourceTimestamp) {
+        timestamp = value->sourceTimestamp;
+    } else if (value->hasServerTimestamp) {
+        timestamp = value->serverTimestamp;
+    } else {
+        timestamp = UA_DateTime_now();
+    }
+    return append_backend_file(ctx, series, timestamp, value);
+}
+
+static size_t
+getEnd_backend_file(UA_Server *server,
+                    void *context,
+                    const UA_NodeId *sessionId,
+                    void *sessionContext,
+                    const UA_NodeId *nodeId) {
+    const UA_HistoryFileSeries *series =
+        findSeries_backend_file((UA_HistoryFileContext*)context, nodeId);
+    return series ? series->count : 0;
+}
+
+static size_t
+lastIndex_backend_file(UA_Server *server,
+                       void *context,
+                       const UA_NodeId *sessionId,
+                       void *sessionContext,
+                       const UA_NodeId *nodeId) {
+    return getEnd_backend_file(server, context, sessionId, sessionContext, nodeId) - 1;
+}
+
+static size_t
+firstIndex_backend_file(UA_Server *server,
+                        void *context,
+                        const UA_NodeId *sessionId,
+                        void *sessionContext,
+                        const UA_NodeId *nodeId) {
+    return 0;
+}
+
+static size_t
+resultSize_backend_file(UA_Server *server,
+                        void *context,
+                        const UA_NodeId *sessionId,
+                        void *sessionContext,
+                        const UA_NodeId *nodeId,
+                        size_t startIndex,
+                        size_t endIndex) {
+    size_t storeEnd = getEnd_backend_file(server, context, sessionId,
+                                          sessionContext, nodeId);
+    if (storeEnd == 0 || startIndex == storeEnd || endIndex == storeEnd)
+        return 0;
+    return endIndex - startIndex + 1;
+}
+
+static size_t
+getDateTimeMatch_backend_file(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId,
+                              const UA_DateTime timestamp,
+                              const MatchStrategy strategy) {
+    UA_HistoryFileContext *ctx = (UA_HistoryFileContext*)context;
+    UA_HistoryFileSeries *series = findSeries_backend_file(ctx, nodeId);
+    if (!series || series->count == 0)
+        return 0;
+    size_t current = search_backend_file(ctx, series, timestamp, false);
+    UA_Boolean equal = false;
+    if (current < series->count) {
+        UA_HistoryFileSegment *seg = segmentAt_backend_file(series, current);
+        if (prepare_backend_file(ctx, series, seg) != UA_STATUSCODE_GOOD)
+            return series->count;
+        size_t offset = locate_backend_file(seg, current - seg->firstIndex);
+        equal = (recordTime_backend_file(seg, offset) == timestamp);
+    }
+    switch (strategy) {
+    case MATCH_EQUAL:
+        return equal ? current : series->count;
+    case MATCH_AFTER:
+        return search_backend_file(ctx, series, timestamp, true);
+    case MATCH_EQUAL_OR_AFTER:
+        return current;
+    case MATCH_EQUAL_OR_BEFORE:
+        if (equal)
+            return current;
+        /* Fall through */
+    case MATCH_BEFORE:
+        return current > 0 ? current - 1 : series->count;
+    default:
+        break;
+    }
+    return series->count;
+}
+
+static UA_Boolean
+boundSupported_backend_file(UA_Server *server,
+                            void *context,
+                            const UA_NodeId *sessionId,
+                            void *sessionContext,
+                            const UA_NodeId *nodeId) {
+    return true;
+}
+
+/* The DataValue is valid until the next call to the backend */
+static const UA_DataValue*
+getDataValue_backend_file(UA_Server *server,
+                          void *context,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId,
+                          size_t index) {
+    UA_HistoryFileContext *ctx = (UA_HistoryFileContext*)context;
+    UA_DataValue_deleteMembers(&ctx->scratch);
+    UA_HistoryFileSeries *series = findSeries_backend_file(ctx, nodeId);
+    if (!series || index >= series->count)
+        return NULL;
+    if (decodeSample_backend_file(ctx, series, index, &ctx->scratch) != UA_STATUSCODE_GOOD)
+        return NULL;
+    return &ctx->scratch;
+}
+
+static UA_Boolean
+timestampsToReturnSupported_backend_file(UA_Server *server,
+                                         void *context,
+                                         const UA_NodeId *sessionId,
+                                         void *sessionContext,
+                                         const UA_NodeId *nodeId,
+                                         const UA_TimestampsToReturn timestampsToReturn) {
+    const UA_DataValue *first =
+        getDataValue_backend_file(server, context, sessionId, sessionContext, nodeId, 0);
+    if (!first)
+        return true;
+    if (timestampsToReturn == UA_TIMESTAMPSTORETURN_NEITHER
+            || timestampsToReturn == UA_TIMESTAMPSTORETURN_INVALID
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_SERVER
+                && !first->hasServerTimestamp)
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_SOURCE
+                && !first->hasSourceTimestamp)
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_BOTH
+                && !(first->hasSourceTimestamp && first->hasServerTimestamp))) {
+        return false;
+    }
+    return true;
+}
+
+static void
+copySample_backend_file(UA_HistoryFileContext *ctx, UA_HistoryFileSeries *series,
+                        size_t index, const UA_NumericRange *range, UA_DataValue *dst) {
+    UA_StatusCode retval;
+    if (range->dimensionsSize == 0) {
+        retval = decodeSample_backend_file(ctx, series, index, dst);
+    } else {
+        UA_DataValue dv;
+        retval = decodeSample_backend_file(ctx, series, index, &dv);
+        if (retval == UA_STATUSCODE_GOOD) {
+            memcpy(dst, &dv, sizeof(UA_DataValue));
+            UA_Variant_init(&dst->value);
+            if (dv.hasValue)
+                UA_Variant_copyRange(&dv.value, &dst->value, *range);
+            UA_DataValue_deleteMembers(&dv);
+        }
+    }
+    if (retval != UA_STATUSCODE_GOOD) {
+        UA_DataValue_init(dst);
+        dst->hasStatus = true;
+        dst->status = retval;
+    }
+}
+
+static UA_StatusCode
+copyDataValues_backend_file(UA_Server *server,
+                            void *context,
+                            const UA_NodeId *sessionId,
+                            void *sessionContext,
+                            const UA_NodeId *nodeId,
+                            size_t startIndex,
+                            size_t endIndex,
+                            UA_Boolean reverse,
+                            size_t maxValues,
+                            UA_NumericRange range,
+                            UA_Boolean releaseContinuationPoints,
+                            const UA_ByteString *continuationPoint,
+                            UA_ByteString *outContinuationPoint,
+                            size_t *providedValues,
+                            UA_DataValue *values) {
+    size_t skip = 0;
+    if (continuationPoint->length > 0) {
+        if (continuationPoint->length == sizeof(size_t)) {
+            memcpy(&skip, continuationPoint->data, sizeof(size_t));
+        } else {
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        }
+    }
+    UA_HistoryFileContext *ctx = (UA_HistoryFileContext*)context;
+    UA_HistoryFileSeries *series = findSeries_backend_file(ctx, nodeId);
+    size_t storeEnd = series ? series->count : 0;
+    size_t index = startIndex;
+    size_t counter = 0;
+    size_t skipedValues = 0;
+    if (reverse) {
+        while (index >= endIndex && index < storeEnd && counter < maxValues) {
+            if (skipedValues++ >= skip) {
+                copySample_backend_file(ctx, series, index, &range, &values[counter]);
+                ++counter;
+            }
+            --index;
+        }
+    } else {
+        while (index <= endIndex && index < storeEnd && counter < maxValues) {
+            if (skipedValues++ >= skip) {
+                copySample_backend_file(ctx, series, index, &range, &values[counter]);
+                ++counter;
+            }
+            ++index;
+        }
+    }
+
+    if (providedValues)
+        *providedValues = counter;
+
+    if ((!reverse && (endIndex-startIndex-skip+1) > counter) ||
+        (reverse && (startIndex-endIndex-skip+1) > counter)) {
+        outContinuationPoint->data = (UA_Byte*)UA_malloc(sizeof(size_t));
+        if (!outContinuationPoint->data)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        outContinuationPoint->length = sizeof(size_t);
+        size_t next = skip + counter;
+        memcpy(outContinuationPoint->data, &next, sizeof(size_t));
+    }
+
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+deleteMembers_backend_file(UA_HistoryDataBackend *backend) {
+    if (backend == NULL || backend->context == NULL)
+        return;
+    UA_HistoryFileContext_delete((UA_HistoryFileContext*)backend->context);
+    backend->context = NULL;
+}
+
+UA_HistoryDataBackend
+UA_HistoryDataBackend_File(const char *directory, UA_DateTime segmentDuration) {
+    UA_HistoryDataBackend result;
+    memset(&result, 0, sizeof(UA_HistoryDataBackend));
+    if (!directory)
+        return result;
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+        return result;
+    UA_HistoryFileContext *ctx = (UA_HistoryFileContext*)
+        UA_calloc(1, sizeof(UA_HistoryFileContext));
+    if (!ctx)
+        return result;
+    ctx->catalogFd = -1;
+    ctx->segmentDuration = segmentDuration > 0 ?
+        segmentDuration : UA_HISTORYFILE_DEFAULTDURATION;
+    size_t length = strlen(directory) + 1;
+    ctx->directory = (char*)UA_malloc(length);
+    if (!ctx->directory) {
+        UA_HistoryFileContext_delete(ctx);
+        return result;
+    }
+    memcpy(ctx->directory, directory, length);
+    if (loadCatalog_backend_file(ctx) != UA_STATUSCODE_GOOD ||
+        loadSegments_backend_file(ctx) != UA_STATUSCODE_GOOD) {
+        UA_HistoryFileContext_delete(ctx);
+        return result;
+    }
+
+    result.serverSetHistoryData = &serverSetHistoryData_backend_file;
+    result.resultSize = &resultSize_backend_file;
+    result.getEnd = &getEnd_backend_file;
+    result.lastIndex = &lastIndex_backend_file;
+    result.firstIndex = &firstIndex_backend_file;
+    result.getDateTimeMatch = &getDateTimeMatch_backend_file;
+    result.copyDataValues = &copyDataValues_backend_file;
+    result.getDataValue = &getDataValue_backend_file;
+    result.boundSupported = &boundSupported_backend_file;
+    result.timestampsToReturnSupported = &timestampsToReturnSupported_backend_file;
+    result.deleteMembers = &deleteMembers_backend_file;
+    result.getHistoryData = NULL;
+    result.context = ctx;
+    return result;
+}
+
+void
+UA_HistoryDataBackend_File_deleteMembers(UA_HistoryDataBackend *backend) {
+    deleteMembers_backend_file(backend);
+    memset(backend, 0, sizeof(UA_HistoryDataBackend));
+}
@@ -0,0 +1,38 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UA_HISTORYDATABACKEND_FILE_H_
+#define UA_HISTORYDATABACKEND_FILE_H_
+
+#include "ua_plugin_history_data_backend.h"
+
+_UA_BEGIN_DECLS
+
+/* Persistent backend that stores the samples in a directory. Every node has
+ * append-only segment files, one per time window of segmentDuration (one day
+ * if zero). A sample is a record with the timestamp and the binary encoded
+ * DataValue. The file "series" lists the NodeIds of the nodes.
+ *
+ * Existing files in the directory are loaded when the backend is created. The
+ * directory is created if it does not exist. A record that was not written
+ * completely (e.g. after a crash) is cut off.
+ *
+ * Only an index with every 64th record of a segment is kept in memory.
+ * Segments are mapped into memory for reading, so that a HistoryRead decodes
+ * only the requested samples directly from the page cache. Segments with
+ * samples that arrived out of order are sorted in memory when they are read.
+ *
+ * Values of non-standard DataTypes are returned as ExtensionObjects.
+ *
+ * Returns a backend with a NULL context if the directory cannot be used. */
+UA_HistoryDataBackend UA_EXPORT
+UA_HistoryDataBackend_File(const char *directory, UA_DateTime segmentDuration);
+
+void UA_EXPORT
+UA_HistoryDataBackend_File_deleteMembers(UA_HistoryDataBackend *backend);
+
+_UA_END_DECLS
+
+#endif /* UA_HISTORYDATABACKEND_FILE_H_ */
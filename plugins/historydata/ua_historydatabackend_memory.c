@@ -25,6 +25,7 @@ typedef struct {
     UA_DataValueMemoryStoreItem **dataStore;
     size_t storeEnd;
     size_t storeSize;
+    UA_UInt64 generation; /* Incremented when samples are moved by an insert */
 } UA_NodeIdStoreContextItem_backend_memory;
 
 static void
@@ -79,6 +80,7 @@ getNewNodeIdContext_backend_memory(UA_MemoryStoreContext* context,
     item->dataStore = store;
     item->storeSize = ctx->initialStoreSize;
     item->storeEnd = 0;
+    item->generation = 0;
     ++ctx->storeEnd;
     return item;
 }
@@ -221,6 +223,7 @@ serverSetHistoryData_backend_memory(UA_Server *server,
                                                    timestamp,
                                                    MATCH_EQUAL_OR_AFTER);
     if (item->storeEnd > 0 && index < item->storeEnd) {
+        ++item->generation;
         memmove(&item->dataStore[index+1], &item->dataStore[index], sizeof(UA_DataValueMemoryStoreItem*) * (item->storeEnd - index));
     }
     item->dataStore[index] = newItem;
@@ -385,6 +388,73 @@ copyDataValues_backend_memory(UA_Server *server,
     return UA_STATUSCODE_GOOD;
 }
 
+static UA_StatusCode
+getCursor_backend_memory(UA_Server *server,
+                         void *context,
+                         const UA_NodeId *sessionId,
+                         void *sessionContext,
+                         const UA_NodeId *nodeId,
+                         size_t index,
+                         UA_HistoryDataCursor *cursor) {
+    const UA_NodeIdStoreContextItem_backend_memory* item = getNodeIdStoreContextItem_backend_memory((UA_MemoryStoreContext*)context, server, nodeId);
+    if (!item)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    cursor->position = index;
+    cursor->generation = item->generation;
+    cursor->timestamp = 0;
+    if (index < item->storeEnd)
+        cursor->timestamp = item->dataStore[index]->timestamp;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* The position of the cursor is the index of the next sample. Appended
+ * samples keep the indices. Otherwise the generation changes and the index is
+ * searched with the timestamp. */
+static UA_StatusCode
+readCursor_backend_memory(UA_Server *server,
+                          void *context,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId,
+                          UA_HistoryDataCursor *cursor,
+                          UA_Boolean reverse,
+                          size_t maxValues,
+                          UA_HistoryDataCursorCallback callback,
+                          void *callbackContext,
+                          size_t *providedValues) {
+    const UA_NodeIdStoreContextItem_backend_memory* item = getNodeIdStoreContextItem_backend_memory((UA_MemoryStoreContext*)context, server, nodeId);
+    if (!item)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    size_t index = (size_t)cursor->position;
+    if (cursor->generation != item->generation)
+        index = getDateTimeMatch_backend_memory(server, context, sessionId, sessionContext, nodeId,
+                                                cursor->timestamp,
+                                                reverse ? MATCH_EQUAL_OR_BEFORE : MATCH_EQUAL_OR_AFTER);
+    size_t counter = 0;
+    UA_DateTime last = cursor->timestamp;
+    /* The index wraps around after the first sample in reverse order */
+    while (counter < maxValues && index < item->storeEnd) {
+        if (!callback(callbackContext, &item->dataStore[index]->value))
+            break;
+        last = item->dataStore[index]->timestamp;
+        ++counter;
+        if (reverse)
+            --index;
+        else
+            ++index;
+    }
+
+    cursor->position = index;
+    cursor->generation = item->generation;
+    if (index < item->storeEnd)
+        cursor->timestamp = item->dataStore[index]->timestamp;
+    else if (counter > 0)
+        cursor->timestamp = reverse ? last - 1 : last + 1;
+    if (providedValues)
+        *providedValues = counter;
+    return UA_STATUSCODE_GOOD;
+}
+
 static void
 deleteMembers_backend_memory(UA_HistoryDataBackend *backend)
 {
@@ -420,6 +490,8 @@ UA_HistoryDataBackend_Memory(size_t initialNodeIdStoreSize, size_t initialDataSt
     result.getDataValue = &getDataValue_backend_memory;
     result.boundSupported = &boundSupported_backend_memory;
     result.timestampsToReturnSupported = &timestampsToReturnSupported_backend_memory;
+    result.getCursor = &getCursor_backend_memory;
+    result.readCursor = &readCursor_backend_memory;
     result.deleteMembers = deleteMembers_backend_memory;
     result.getHistoryData = NULL;
     result.context = ctx;
@@ -0,0 +1,780 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ua_historydatabackend_memoryring.h"
+#include <string.h>
+
+#define UA_MEMORYRING_INITIALCAPACITY 16
+
+/* Flags of the columnar samples */
+#define UA_MEMORYRING_HASVALUE 0x01
+#define UA_MEMORYRING_HASSTATUS 0x02
+#define UA_MEMORYRING_HASSOURCETIMESTAMP 0x04
+#define UA_MEMORYRING_HASSERVERTIMESTAMP 0x08
+
+typedef struct {
+    UA_NodeId nodeId;
+    UA_UInt32 hash;
+
+    /* Ring buffer. The oldest sample (index 0 for the HistoryRead API) is at
+     * position start. */
+    size_t capacity;
+    size_t start;
+    size_t count;
+
+    /* Cursors store the index plus the number of removed samples. So they
+     * remain valid when old samples are removed. Inserting a sample in front
+     * of other samples changes the generation. */
+    UA_UInt64 removed;
+    UA_UInt64 generation;
+
+    /* Generic series store DataValues. Otherwise all samples with a value
+     * have the same type. */
+    UA_Boolean generic;
+    const UA_DataType *type;
+
+    /* The columns share one allocation */
+    void *block;
+    UA_DateTime *timestamps; /* Sorting key */
+    UA_DateTime *serverTimestamps;
+    UA_UInt64 *values; /* Raw value in the first type->memSize bytes */
+    UA_StatusCode *status;
+    UA_Byte *flags;
+    UA_DataValue *dataValues; /* Only for generic series */
+} UA_MemoryRingSeries;
+
+typedef struct {
+    /* Hash index with linear probing. At most half of the slots are used. */
+    UA_MemoryRingSeries **slots;
+    size_t slotsSize; /* Power of two */
+    size_t seriesCount;
+
+    size_t maxValuesPerNode;
+    UA_DateTime maxAge;
+
+    /* Returned by getDataValue. Points into the storage. */
+    UA_DataValue scratch;
+} UA_MemoryRingContext;
+
+/**********/
+/* Series */
+/**********/
+
+static size_t
+position_backend_memoryring(const UA_MemoryRingSeries *s, size_t index) {
+    size_t p = s->start + index;
+    return (p >= s->capacity) ? p - s->capacity : p;
+}
+
+static size_t
+sampleSize_backend_memoryring(UA_Boolean generic) {
+    if (generic)
+        return sizeof(UA_DateTime) + sizeof(UA_DataValue);
+    return 2 * sizeof(UA_DateTime) + sizeof(UA_UInt64) +
+        sizeof(UA_StatusCode) + sizeof(UA_Byte);
+}
+
+/* Points the columns into the block. The columns are ordered by alignment. */
+static void
+setColumns_backend_memoryring(UA_MemoryRingSeries *s, void *block, size_t capacity) {
+    UA_Byte *p = (UA_Byte*)block;
+    s->block = block;
+    s->capacity = capacity;
+    s->start = 0;
+    s->timestamps = (UA_DateTime*)(void*)p;
+    p += capacity * sizeof(UA_DateTime);
+    if (s->generic) {
+        s->dataValues = (UA_DataValue*)(void*)p;
+        s->serverTimestamps = NULL;
+        s->values = NULL;
+        s->status = NULL;
+        s->flags = NULL;
+        return;
+    }
+    s->dataValues = NULL;
+    s->serverTimestamps = (UA_DateTime*)(void*)p;
+    p += capacity * sizeof(UA_DateTime);
+    s->values = (UA_UInt64*)(void*)p;
+    p += capacity * sizeof(UA_UInt64);
+    s->status = (UA_StatusCode*)(void*)p;
+    p += capacity * sizeof(UA_StatusCode);
+    s->flags = p;
+}
+
+static void
+moveSample_backend_memoryring(UA_MemoryRingSeries *dst, size_t dstPos,
+                              const UA_MemoryRingSeries *src, size_t srcPos) {
+    dst->timestamps[dstPos] = src->timestamps[srcPos];
+    if (src->generic) {
+        dst->dataValues[dstPos] = src->dataValues[srcPos];
+        return;
+    }
+    dst->serverTimestamps[dstPos] = src->serverTimestamps[srcPos];
+    dst->values[dstPos] = src->values[srcPos];
+    dst->status[dstPos] = src->status[srcPos];
+    dst->flags[dstPos] = src->flags[srcPos];
+}
+
+/* Fills a DataValue that points into the storage */
+static void
+peekSample_backend_memoryring(const UA_MemoryRingSeries *s, size_t pos,
+                              UA_DataValue *dv) {
+    if (s->generic) {
+        *dv = s->dataValues[pos];
+        return;
+    }
+    UA_DataValue_init(dv);
+    UA_Byte f = s->flags[pos];
+    if (f & UA_MEMORYRING_HASVALUE) {
+        UA_Variant_setScalar(&dv->value, &s->values[pos], s->type);
+        dv->hasValue = true;
+    }
+    if (f & UA_MEMORYRING_HASSTATUS) {
+        dv->status = s->status[pos];
+        dv->hasStatus = true;
+    }
+    if (f & UA_MEMORYRING_HASSOURCETIMESTAMP) {
+        dv->sourceTimestamp = s->timestamps[pos];
+        dv->hasSourceTimestamp = true;
+    }
+    if (f & UA_MEMORYRING_HASSERVERTIMESTAMP) {
+        dv->serverTimestamp = s->serverTimestamps[pos];
+        dv->hasServerTimestamp = true;
+    }
+}
+
+/* Stores the sample in columns. The value was checked with isColumnar. */
+static void
+storeSample_backend_memoryring(UA_MemoryRingSeries *s, size_t pos,
+                               UA_DateTime timestamp, const UA_DataValue *value) {
+    UA_Byte f = 0;
+    s->timestamps[pos] = timestamp;
+    s->values[pos] = 0;
+    if (value->hasValue) {
+        memcpy(&s->values[pos], value->value.data, s->type->memSize);
+        f |= UA_MEMORYRING_HASVALUE;
+    }
+    s->status[pos] = UA_STATUSCODE_GOOD;
+    if (value->hasStatus) {
+        s->status[pos] = value->status;
+        f |= UA_MEMORYRING_HASSTATUS;
+    }
+    if (value->hasSourceTimestamp)
+        f |= UA_MEMORYRING_HASSOURCETIMESTAMP;
+    s->serverTimestamps[pos] = 0;
+    if (value->hasServerTimestamp) {
+        s->serverTimestamps[pos] = value->serverTimestamp;
+        f |= UA_MEMORYRING_HASSERVERTIMESTAMP;
+    }
+    s->flags[pos] = f;
+}
+
+static UA_Boolean
+isColumnar_backend_memoryring(const UA_MemoryRingSeries *s, const UA_DataValue *value) {
+    if (s->generic || value->hasSourcePicoseconds || value->hasServerPicoseconds)
+        return false;
+    if (!value->hasValue)
+        return true;
+    const UA_DataType *type = value->value.type;
+    if (!type || !UA_Variant_isScalar(&value->value) || !value->value.data)
+        return false;
+    if (!type->builtin || !type->pointerFree || type->memSize > sizeof(UA_UInt64))
+        return false;
+    return (!s->type || s->type == type);
+}
+
+static UA_StatusCode
+resize_backend_memoryring(UA_MemoryRingSeries *s, size_t capacity) {
+    void *block = UA_malloc(capacity * sampleSize_backend_memoryring(s->generic));
+    if (!block)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_MemoryRingSeries n = *s;
+    setColumns_backend_memoryring(&n, block, capacity);
+    for (size_t i = 0; i < s->count; ++i)
+        moveSample_backend_memoryring(&n, i, s, position_backend_memoryring(s, i));
+    UA_free(s->block);
+    *s = n;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Converts the columns to DataValues. Done once when the first sample arrives
+ * that cannot be stored in the columns. */
+static UA_StatusCode
+convertToGeneric_backend_memoryring(UA_MemoryRingSeries *s) {
+    size_t capacity = s->capacity > 0 ? s->capacity : UA_MEMORYRING_INITIALCAPACITY;
+    void *block = UA_malloc(capacity * sampleSize_backend_memoryring(true));
+    if (!block)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_MemoryRingSeries n = *s;
+    n.generic = true;
+    n.type = NULL;
+    setColumns_backend_memoryring(&n, block, capacity);
+    for (size_t i = 0; i < s->count; ++i) {
+        size_t pos = position_backend_memoryring(s, i);
+        UA_DataValue dv;
+        peekSample_backend_memoryring(s, pos, &dv);
+        n.timestamps[i] = s->timestamps[pos];
+        UA_StatusCode retval = UA_DataValue_copy(&dv, &n.dataValues[i]);
+        if (retval != UA_STATUSCODE_GOOD) {
+            for (size_t j = 0; j < i; ++j)
+                UA_DataValue_deleteMembers(&n.dataValues[j]);
+            UA_free(block);
+            return retval;
+        }
+    }
+    UA_free(s->block);
+    *s = n;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+removeOldest_backend_memoryring(UA_MemoryRingSeries *s) {
+    if (s->generic)
+        UA_DataValue_deleteMembers(&s->dataValues[s->start]);
+    s->start = position_backend_memoryring(s, 1);
+    --s->count;
+    ++s->removed;
+}
+
+/* Index of the first sample with a timestamp >= (or > if after is set) the
+ * given timestamp. */
+static size_t
+search_backend_memoryring(const UA_MemoryRingSeries *s, UA_DateTime timestamp,
+                          UA_Boolean after) {
+    size_t min = 0;
+    size_t max = s->count;
+    while (min < max) {
+        size_t mid = min + (max - min) / 2;
+        UA_DateTime t = s->timestamps[position_backend_memoryring(s, mid)];
+        if (t < timestamp || (after && t == timestamp))
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    return min;
+}
+
+static UA_StatusCode
+insert_backend_memoryring(const UA_MemoryRingContext *ctx, UA_MemoryRingSeries *s,
+                          UA_DateTime timestamp, const UA_DataValue *value) {
+    UA_StatusCode retval;
+    if (!s->generic && !isColumnar_backend_memoryring(s, value)) {
+        retval = convertToGeneric_backend_memoryring(s);
+        if (retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+
+    /* Samples in order are appended. Samples with the same timestamp are
+     * kept in the order of insertion. */
+    size_t index = s->count;
+    if (s->count > 0 &&
+        timestamp < s->timestamps[position_backend_memoryring(s, s->count - 1)])
+        index = search_backend_memoryring(s, timestamp, true);
+
+    if (s->count == s->capacity) {
+        if (ctx->maxValuesPerNode == 0 || s->capacity < ctx->maxValuesPerNode) {
+            size_t capacity = s->capacity * 2;
+            if (capacity == 0)
+                capacity = UA_MEMORYRING_INITIALCAPACITY;
+            if (ctx->maxValuesPerNode > 0 && capacity > ctx->maxValuesPerNode)
+                capacity = ctx->maxValuesPerNode;
+            retval = resize_backend_memoryring(s, capacity);
+            if (retval != UA_STATUSCODE_GOOD)
+                return retval;
+        } else {
+            /* The new sample would be removed right away */
+            if (index == 0)
+                return UA_STATUSCODE_GOOD;
+            removeOldest_backend_memoryring(s);
+            --index;
+        }
+    }
+
+    /* Copy the DataValue before the storage is modified */
+    UA_DataValue copy;
+    if (s->generic) {
+        retval = UA_DataValue_copy(value, &copy);
+        if (retval != UA_STATUSCODE_GOOD)
+            return retval;
+    } else if (value->hasValue && !s->type) {
+        s->type = value->value.type;
+    }
+
+    if (index < s->count)
+        ++s->generation;
+    for (size_t i = s->count; i > index; --i)
+        moveSample_backend_memoryring(s, position_backend_memoryring(s, i),
+                                      s, position_backend_memoryring(s, i - 1));
+    size_t pos = position_backend_memoryring(s, index);
+    if (s->generic) {
+        s->timestamps[pos] = timestamp;
+        s->dataValues[pos] = copy;
+    } else {
+        storeSample_backend_memoryring(s, pos, timestamp, value);
+    }
+    ++s->count;
+
+    /* Remove samples that are too old */
+    if (ctx->maxAge > 0) {
+        UA_DateTime newest = s->timestamps[position_backend_memoryring(s, s->count - 1)];
+        while (s->count > 0 && s->timestamps[s->start] < newest - ctx->maxAge)
+            removeOldest_backend_memoryring(s);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+UA_MemoryRingSeries_delete(UA_MemoryRingSeries *s) {
+    if (s->generic) {
+        for (size_t i = 0; i < s->count; ++i)
+            UA_DataValue_deleteMembers(&s->dataValues[position_backend_memoryring(s, i)]);
+    }
+    UA_free(s->block);
+    UA_NodeId_deleteMembers(&s->nodeId);
+    UA_free(s);
+}
+
+/**************/
+/* Hash Index */
+/**************/
+
+static UA_MemoryRingSeries *
+findSeries_backend_memoryring(const UA_MemoryRingContext *ctx, const UA_NodeId *nodeId) {
+    if (ctx->slotsSize == 0)
+        return NULL;
+    UA_UInt32 hash = UA_NodeId_hash(nodeId);
+    size_t mask = ctx->slotsSize - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        UA_MemoryRingSeries *s = ctx->slots[i];
+        if (!s)
+            return NULL;
+        if (s->hash == hash && UA_NodeId_equal(&s->nodeId, nodeId))
+            return s;
+    }
+}
+
+static void
+insertSlot_backend_memoryring(UA_MemoryRingSeries **slots, size_t slotsSize,
+                              UA_MemoryRingSeries *s) {
+    size_t mask = slotsSize - 1;
+    size_t i = s->hash & mask;
+    while (slots[i])
+        i = (i + 1) & mask;
+    slots[i] = s;
+}
+
+static UA_StatusCode
+growIndex_backend_memoryring(UA_MemoryRingContext *ctx, size_t slotsSize) {
+    UA_MemoryRingSeries **slots = (UA_MemoryRingSeries**)
+        UA_calloc(slotsSize, sizeof(UA_MemoryRingSeries*));
+    if (!slots)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for (size_t i = 0; i < ctx->slotsSize; ++i) {
+        if (ctx->slots[i])
+            insertSlot_backend_memoryring(slots, slotsSize, ctx->slots[i]);
+    }
+    UA_free(ctx->slots);
+    ctx->slots = slots;
+    ctx->slotsSize = slotsSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_MemoryRingSeries *
+addSeries_backend_memoryring(UA_MemoryRingContext *ctx, const UA_NodeId *nodeId) {
+    if ((ctx->seriesCount + 1) * 2 > ctx->slotsSize) {
+        size_t slotsSize = ctx->slotsSize > 0 ? ctx->slotsSize * 2 : 16;
+        if (growIndex_backend_memoryring(ctx, slotsSize) != UA_STATUSCODE_GOOD)
+            return NULL;
+    }
+    UA_MemoryRingSeries *s = (UA_MemoryRingSeries*)UA_calloc(1, sizeof(UA_MemoryRingSeries));
+    if (!s)
+        return NULL;
+    if (UA_NodeId_copy(nodeId, &s->nodeId) != UA_STATUSCODE_GOOD) {
+        UA_free(s);
+        return NULL;
+    }
+    s->hash = UA_NodeId_hash(nodeId);
+    insertSlot_backend_memoryring(ctx->slots, ctx->slotsSize, s);
+    ++ctx->seriesCount;
+    return s;
+}
+
+/***********/
+/* Backend */
+/***********/
+
+static UA_StatusCode
+serverSetHistoryData_backend_memoryring(UA_Server *server,
+                                        void *context,
+                                        const UA_NodeId *sessionId,
+                                        void *sessionContext,
+                                        const UA_NodeId *nodeId,
+                                        UA_Boolean historizing,
+                                        const UA_DataValue *value) {
+    UA_MemoryRingContext *ctx = (UA_MemoryRingContext*)context;
+    UA_MemoryRingSeries *s = findSeries_backend_memoryring(ctx, nodeId);
+    if (!s) {
+        s = addSeries_backend_memoryring(ctx, nodeId);
+        if (!s)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    UA_DateTime timestamp;
+    if (value->hasSourceTimestamp) {
+        timestamp = value->sourceTimestamp;
+    } else if (value->hasServerTimestamp) {
+        timestamp = value->serverTimestamp;
+    } else {
+        timestamp = UA_DateTime_now();
+    }
+    return insert_backend_memoryring(ctx, s, timestamp, value);
+}
+
+static size_t
+getEnd_backend_memoryring(UA_Server *server,
+                          void *context,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId) {
+    const UA_MemoryRingSeries *s =
+        findSeries_backend_memoryring((UA_MemoryRingContext*)context, nodeId);
+    return s ? s->count : 0;
+}
+
+static size_t
+lastIndex_backend_memoryring(UA_Server *server,
+                             void *context,
+                             const UA_NodeId *sessionId,
+                             void *sessionContext,
+                             const UA_NodeId *nodeId) {
+    return getEnd_backend_memoryring(server, context, sessionId,
+                                     sessionContext, nodeId) - 1;
+}
+
+static size_t
+firstIndex_backend_memoryring(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId) {
+    return 0;
+}
+
+static size_t
+resultSize_backend_memoryring(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId,
+                              size_t startIndex,
+                              size_t endIndex) {
+    size_t storeEnd = getEnd_backend_memoryring(server, context, sessionId,
+                                                sessionContext, nodeId);
+    if (storeEnd == 0 || startIndex == storeEnd || endIndex == storeEnd)
+        return 0;
+    return endIndex - startIndex + 1;
+}
+
+static size_t
+getDateTimeMatch_backend_memoryring(UA_Server *server,
+                                    void *context,
+                                    const UA_NodeId *sessionId,
+                                    void *sessionContext,
+                                    const UA_NodeId *nodeId,
+                                    const UA_DateTime timestamp,
+                                    const MatchStrategy strategy) {
+    const UA_MemoryRingSeries *s =
+        findSeries_backend_memoryring((UA_MemoryRingContext*)context, nodeId);
+    if (!s || s->count == 0)
+        return 0;
+    size_t current = search_backend_memoryring(s, timestamp, false);
+    UA_Boolean equal = (current < s->count &&
+                        s->timestamps[position_backend_memoryring(s, current)] == timestamp);
+    switch (strategy) {
+    case MATCH_EQUAL:
+        return equal ? current : s->count;
+    case MATCH_AFTER:
+        return search_backend_memoryring(s, timestamp, true);
+    case MATCH_EQUAL_OR_AFTER:
+        return current;
+    case MATCH_EQUAL_OR_BEFORE:
+        if (equal)
+            return current;
+        /* Fall through */
+    case MATCH_BEFORE:
+        return current > 0 ? current - 1 : s->count;
+    default:
+        break;
+    }
+    return s->count;
+}
+
+static UA_Boolean
+boundSupported_backend_memoryring(UA_Server *server,
+                                  void *context,
+                                  const UA_NodeId *sessionId,
+                                  void *sessionContext,
+                                  const UA_NodeId *nodeId) {
+    return true;
+}
+
+static UA_Boolean
+timestampsToReturnSupported_backend_memoryring(UA_Server *server,
+                                               void *context,
+                                               const UA_NodeId *sessionId,
+                                               void *sessionContext,
+                                               const UA_NodeId *nodeId,
+                                               const UA_TimestampsToReturn timestampsToReturn) {
+    const UA_MemoryRingSeries *s =
+        findSeries_backend_memoryring((UA_MemoryRingContext*)context, nodeId);
+    if (!s || s->count == 0)
+        return true;
+    UA_DataValue first;
+    peekSample_backend_memoryring(s, s->start, &first);
+    if (timestampsToReturn == UA_TIMESTAMPSTORETURN_NEITHER
+            || timestampsToReturn == UA_TIMESTAMPSTORETURN_INVALID
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_SERVER
+                && !first.hasServerTimestamp)
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_SOURCE
+                && !first.hasSourceTimestamp)
+            || (timestampsToReturn == UA_TIMESTAMPSTORETURN_BOTH
+                && !(first.hasSourceTimestamp && first.hasServerTimestamp))) {
+        return false;
+    }
+    return true;
+}
+
+/* The DataValue is valid until the next call to the backend */
+static const UA_DataValue*
+getDataValue_backend_memoryring(UA_Server *server,
+                                void *context,
+                                const UA_NodeId *sessionId,
+                                void *sessionContext,
+                                const UA_NodeId *nodeId,
+                                size_t index) {
+    UA_MemoryRingContext *ctx = (UA_MemoryRingContext*)context;
+    const UA_MemoryRingSeries *s = findSeries_backend_memoryring(ctx, nodeId);
+    if (!s || index >= s->count)
+        return NULL;
+    peekSample_backend_memoryring(s, position_backend_memoryring(s, index), &ctx->scratch);
+    return &ctx->scratch;
+}
+
+static void
+copySample_backend_memoryring(const UA_MemoryRingSeries *s, size_t index,
+                              const UA_NumericRange *range, UA_DataValue *dst) {
+    UA_DataValue dv;
+    peekSample_backend_memoryring(s, position_backend_memoryring(s, index), &dv);
+    if (range->dimensionsSize == 0) {
+        UA_DataValue_copy(&dv, dst);
+        return;
+    }
+    memcpy(dst, &dv, sizeof(UA_DataValue));
+    UA_Variant_init(&dst->value);
+    if (dv.hasValue)
+        UA_Variant_copyRange(&dv.value, &dst->value, *range);
+}
+
+static UA_StatusCode
+copyDataValues_backend_memoryring(UA_Server *server,
+                                  void *context,
+                                  const UA_NodeId *sessionId,
+                                  void *sessionContext,
+                                  const UA_NodeId *nodeId,
+                                  size_t startIndex,
+                                  size_t endIndex,
+                                  UA_Boolean reverse,
+                                  size_t maxValues,
+                                  UA_NumericRange range,
+                                  UA_Boolean releaseContinuationPoints,
+                                  const UA_ByteString *continuationPoint,
+                                  UA_ByteString *outContinuationPoint,
+                                  size_t *providedValues,
+                                  UA_DataValue *values) {
+    size_t skip = 0;
+    if (continuationPoint->length > 0) {
+        if (continuationPoint->length == sizeof(size_t)) {
+            memcpy(&skip, continuationPoint->data, sizeof(size_t));
+        } else {
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        }
+    }
+    const UA_MemoryRingSeries *s =
+        findSeries_backend_memoryring((UA_MemoryRingContext*)context, nodeId);
+    size_t storeEnd = s ? s->count : 0;
+    size_t index = startIndex;
+    size_t counter = 0;
+    size_t skipedValues = 0;
+    if (reverse) {
+        while (index >= endIndex && index < storeEnd && counter < maxValues) {
+            if (skipedValues++ >= skip) {
+                copySample_backend_memoryring(s, index, &range, &values[counter]);
+                ++counter;
+            }
+            --index;
+        }
+    } else {
+        while (index <= endIndex && index < storeEnd && counter < maxValues) {
+            if (skipedValues++ >= skip) {
+                copySample_backend_memoryring(s, index, &range, &values[counter]);
+                ++counter;
+            }
+            ++index;
+        }
+    }
+
+    if (providedValues)
+        *providedValues = counter;
+
+    if ((!reverse && (endIndex-startIndex-skip+1) > counter) ||
+        (reverse && (startIndex-endIndex-skip+1) > counter)) {
+        outContinuationPoint->data = (UA_Byte*)UA_malloc(sizeof(size_t));
+        if (!outContinuationPoint->data)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        outContinuationPoint->length = sizeof(size_t);
+        size_t next = skip + counter;
+        memcpy(outContinuationPoint->data, &next, sizeof(size_t));
+    }
+
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+getCursor_backend_memoryring(UA_Server *server,
+                             void *context,
+                             const UA_NodeId *sessionId,
+                             void *sessionContext,
+                             const UA_NodeId *nodeId,
+                             size_t index,
+                             UA_HistoryDataCursor *cursor) {
+    const UA_MemoryRingSeries *s =
+        findSeries_backend_memoryring((UA_MemoryRingContext*)context, nodeId);
+    memset(cursor, 0, sizeof(UA_HistoryDataCursor));
+    if (!s)
+        return UA_STATUSCODE_GOOD;
+    cursor->position = s->removed + index;
+    cursor->generation = s->generation;
+    if (index < s->count)
+        cursor->timestamp = s->timestamps[position_backend_memoryring(s, index)];
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+readCursor_backend_memoryring(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId,
+                              UA_HistoryDataCursor *cursor,
+                              UA_Boolean reverse,
+                              size_t maxValues,
+                              UA_HistoryDataCursorCallback callback,
+                              void *callbackContext,
+                              size_t *providedValues) {
+    if (providedValues)
+        *providedValues = 0;
+    const UA_MemoryRingSeries *s =
+        findSeries_backend_memoryring((UA_MemoryRingContext*)context, nodeId);
+    if (!s)
+        return UA_STATUSCODE_GOOD;
+
+    /* The index wraps around after the first sample in reverse order */
+    size_t index;
+    if (cursor->generation != s->generation)
+        index = search_backend_memoryring(s, cursor->timestamp, reverse) -
+            (reverse ? 1 : 0);
+    else if (cursor->position < s->removed)
+        index = reverse ? s->count : 0; /* The sample was removed */
+    else
+        index = (size_t)(cursor->position - s->removed);
+
+    size_t counter = 0;
+    UA_DateTime last = cursor->timestamp;
+    UA_DataValue dv;
+    while (counter < maxValues && index < s->count) {
+        size_t pos = position_backend_memoryring(s, index);
+        peekSample_backend_memoryring(s, pos, &dv);
+        if (!callback(callbackContext, &dv))
+            break;
+        last = s->timestamps[pos];
+        ++counter;
+        if (reverse)
+            --index;
+        else
+            ++index;
+    }
+
+    cursor->position = s->removed + index;
+    cursor->generation = s->generation;
+    if (index < s->count)
+        cursor->timestamp = s->timestamps[position_backend_memoryring(s, index)];
+    else if (counter > 0)
+        cursor->timestamp = reverse ? last - 1 : last + 1;
+    if (providedValues)
+        *providedValues = counter;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+UA_MemoryRingContext_delete(UA_MemoryRingContext *ctx) {
+    for (size_t i = 0; i < ctx->slotsSize; ++i) {
+        if (ctx->slots[i])
+            UA_MemoryRingSeries_delete(ctx->slots[i]);
+    }
+    UA_free(ctx->slots);
+    UA_free(ctx);
+}
+
+static void
+deleteMembers_backend_memoryring(UA_HistoryDataBackend *backend) {
+    if (backend == NULL || backend->context == NULL)
+        return;
+    UA_MemoryRingContext_delete((UA_MemoryRingContext*)backend->context);
+    backend->context = NULL;
+}
+
+UA_HistoryDataBackend
+UA_HistoryDataBackend_MemoryRing(size_t initialNodeIdStoreSize,
+                                 size_t maxValuesPerNode, UA_DateTime maxAge) {
+    UA_HistoryDataBackend result;
+    memset(&result, 0, sizeof(UA_HistoryDataBackend));
+    UA_MemoryRingContext *ctx = (UA_MemoryRingContext*)
+        UA_calloc(1, sizeof(UA_MemoryRingContext));
+    if (!ctx)
+        return result;
+    ctx->maxValuesPerNode = maxValuesPerNode;
+    ctx->maxAge = maxAge;
+
+    /* Size the index for the expected number of nodes */
+    size_t slotsSize = 16;
+    while (slotsSize < initialNodeIdStoreSize * 2)
+        slotsSize *= 2;
+    if (growIndex_backend_memoryring(ctx, slotsSize) != UA_STATUSCODE_GOOD) {
+        UA_free(ctx);
+        return result;
+    }
+
+    result.serverSetHistoryData = &serverSetHistoryData_backend_memoryring;
+    result.resultSize = &resultSize_backend_memoryring;
+    result.getEnd = &getEnd_backend_memoryring;
+    result.lastIndex = &lastIndex_backend_memoryring;
+    result.firstIndex = &firstIndex_backend_memoryring;
+    result.getDateTimeMatch = &getDateTimeMatch_backend_memoryring;
+    result.copyDataValues = &copyDataValues_backend_memoryring;
+    result.getDataValue = &getDataValue_backend_memoryring;
+    result.boundSupported = &boundSupported_backend_memoryring;
+    result.timestampsToReturnSupported = &timestampsToReturnSupported_backend_memoryring;
+    result.getCursor = &getCursor_backend_memoryring;
+    result.readCursor = &readCursor_backend_memoryring;
+    result.deleteMembers = &deleteMembers_backend_memoryring;
+    result.getHistoryData = NULL;
+    result.context = ctx;
+    return result;
+}
+
+void
+UA_HistoryDataBackend_MemoryRing_deleteMembers(UA_HistoryDataBackend *backend) {
+    deleteMembers_backend_memoryring(backend);
+    memset(backend, 0, sizeof(UA_HistoryDataBackend));
+}
@@ -0,0 +1,36 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UA_HISTORYDATABACKEND_MEMORYRING_H_
+#define UA_HISTORYDATABACKEND_MEMORYRING_H_
+
+#include "ua_plugin_history_data_backend.h"
+
+_UA_BEGIN_DECLS
+
+/* In-memory backend with a ring buffer per node. The nodes are found with a
+ * hash index. Samples with a scalar numeric value (Boolean up to Double,
+ * DateTime and StatusCode) and without picoseconds are stored in columns
+ * (timestamps, status and the raw values). Other samples are stored as
+ * DataValues. A series that receives such a sample is converted once.
+ *
+ * Samples that arrive in order are appended in O(1). The ring grows up to
+ * maxValuesPerNode entries. Then the oldest sample is overwritten. Samples
+ * older than maxAge compared to the newest sample of the node are removed as
+ * well. Zero disables the respective limit.
+ *
+ * The indices of the low level HistoryRead API count from the oldest retained
+ * sample. Continuation points can skip samples if the ring wraps around
+ * between two requests. */
+UA_HistoryDataBackend UA_EXPORT
+UA_HistoryDataBackend_MemoryRing(size_t initialNodeIdStoreSize,
+                                 size_t maxValuesPerNode, UA_DateTime maxAge);
+
+void UA_EXPORT
+UA_HistoryDataBackend_MemoryRing_deleteMembers(UA_HistoryDataBackend *backend);
+
+_UA_END_DECLS
+
+#endif /* UA_HISTORYDATABACKEND_MEMORYRING_H_ */
@@ -0,0 +1,514 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ua_historydatabackend_rollup.h"
+#include "ua_historydatasummary.h"
+#include <string.h>
+
+#define UA_ROLLUP_MINUTE (60 * UA_DATETIME_SEC)
+#define UA_ROLLUP_HOUR (60 * UA_ROLLUP_MINUTE)
+
+typedef struct {
+    UA_DateTime start;
+    UA_HistoryDataSummary summary;
+} UA_RollupBucket;
+
+/* Buckets sorted by their start time. Only buckets with samples exist. */
+typedef struct {
+    UA_RollupBucket *buckets;
+    size_t size;
+    size_t capacity;
+} UA_RollupLevel;
+
+typedef struct {
+    UA_NodeId nodeId;
+    UA_RollupLevel minutes;
+    UA_RollupLevel hours;
+} UA_RollupSeries;
+
+typedef struct {
+    UA_HistoryDataBackend backend;
+    UA_RollupSeries **series;
+    size_t seriesSize;
+    size_t seriesCapacity;
+} UA_RollupContext;
+
+static UA_DateTime
+floorTime_backend_rollup(UA_DateTime time, UA_DateTime width) {
+    UA_DateTime r = time % width;
+    if (r < 0)
+        r += width;
+    return time - r;
+}
+
+/* Index of the first bucket that starts at or after the time */
+static size_t
+lowerBound_backend_rollup(const UA_RollupLevel *level, UA_DateTime time) {
+    size_t lo = 0;
+    size_t hi = level->size;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (level->buckets[mid].start < time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static UA_RollupBucket *
+getBucket_backend_rollup(UA_RollupLevel *level, UA_DateTime start) {
+    /* Most samples go to the newest bucket */
+    size_t index = level->size;
+    if (level->size > 0 && level->buckets[level->size - 1].start == start)
+        return &level->buckets[level->size - 1];
+    if (level->size > 0 && level->buckets[level->size - 1].start > start) {
+        index = lowerBound_backend_rollup(level, start);
+        if (level->buckets[index].start == start)
+            return &level->buckets[index];
+    }
+
+    if (level->size >= level->capacity) {
+        size_t newCapacity = level->capacity == 0 ? 16 : level->capacity * 2;
+        UA_RollupBucket *buckets = (UA_RollupBucket*)
+            UA_realloc(level->buckets, newCapacity * sizeof(UA_RollupBucket));
+        if (!buckets)
+            return NULL;
+        level->buckets = buckets;
+        level->capacity = newCapacity;
+    }
+    if (index < level->size)
+        memmove(&level->buckets[index + 1], &level->buckets[index],
+                (level->size - index) * sizeof(UA_RollupBucket));
+    ++level->size;
+    level->buckets[index].start = start;
+    UA_HistoryDataSummary_init(&level->buckets[index].summary);
+    return &level->buckets[index];
+}
+
+/* Merges the buckets in [start, end) into the summary */
+static void
+mergeBuckets_backend_rollup(const UA_RollupLevel *level, UA_DateTime start,
+                            UA_DateTime end, UA_HistoryDataSummary *summary) {
+    for (size_t i = lowerBound_backend_rollup(level, start);
+         i < level->size && level->buckets[i].start < end; ++i)
+        UA_HistoryDataSummary_merge(summary, &level->buckets[i].summary);
+}
+
+static UA_StatusCode
+addSample_backend_rollup(UA_RollupContext *ctx, UA_RollupSeries *series,
+                         UA_Server *server, const UA_NodeId *sessionId,
+                         void *sessionContext, UA_DateTime time, UA_Double v) {
+    UA_HistoryDataSummary sample;
+    sample.count = 1;
+    sample.sum = v;
+    sample.m2 = 0.0;
+    sample.min = v;
+    sample.minTime = time;
+    sample.max = v;
+    sample.maxTime = time;
+    sample.first = v;
+    sample.firstTime = time;
+    sample.last = v;
+    sample.lastTime = time;
+    sample.area = 0.0;
+
+    UA_DateTime minute = floorTime_backend_rollup(time, UA_ROLLUP_MINUTE);
+    UA_RollupBucket *bucket = getBucket_backend_rollup(&series->minutes, minute);
+    if (!bucket)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_Boolean inOrder = (bucket->summary.count == 0 ||
+                          time > bucket->summary.lastTime);
+    if (inOrder) {
+        UA_HistoryDataSummary_merge(&bucket->summary, &sample);
+    } else {
+        /* The samples of the minute are read again in their new order */
+        UA_StatusCode retval =
+            UA_HistoryDataSummary_read(server, sessionId, sessionContext, &ctx->backend,
+                                       &series->nodeId, minute, minute + UA_ROLLUP_MINUTE,
+                                       &bucket->summary);
+        if (retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+
+    UA_DateTime hour = floorTime_backend_rollup(time, UA_ROLLUP_HOUR);
+    bucket = getBucket_backend_rollup(&series->hours, hour);
+    if (!bucket)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    if (bucket->summary.count == 0 || time > bucket->summary.lastTime) {
+        UA_HistoryDataSummary_merge(&bucket->summary, &sample);
+    } else {
+        UA_HistoryDataSummary_init(&bucket->summary);
+        mergeBuckets_backend_rollup(&series->minutes, hour, hour + UA_ROLLUP_HOUR,
+                                    &bucket->summary);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+UA_RollupSeries_delete(UA_RollupSeries *series) {
+    UA_NodeId_deleteMembers(&series->nodeId);
+    UA_free(series->minutes.buckets);
+    UA_free(series->hours.buckets);
+    UA_free(series);
+}
+
+/* Returns the series of a node. A new series is built from the samples that
+ * are already stored in the wrapped backend. */
+static UA_RollupSeries *
+getSeries_backend_rollup(UA_RollupContext *ctx, UA_Server *server,
+                         const UA_NodeId *sessionId, void *sessionContext,
+                         const UA_NodeId *nodeId, UA_Boolean *created) {
+    *created = false;
+    for (size_t i = 0; i < ctx->seriesSize; ++i) {
+        if (UA_NodeId_equal(&ctx->series[i]->nodeId, nodeId))
+            return ctx->series[i];
+    }
+
+    if (ctx->seriesSize >= ctx->seriesCapacity) {
+        size_t newCapacity = ctx->seriesCapacity == 0 ? 4 : ctx->seriesCapacity * 2;
+        UA_RollupSeries **series = (UA_RollupSeries**)
+            UA_realloc(ctx->series, newCapacity * sizeof(UA_RollupSeries*));
+        if (!series)
+            return NULL;
+        ctx->series = series;
+        ctx->seriesCapacity = newCapacity;
+    }
+    UA_RollupSeries *s = (UA_RollupSeries*)UA_calloc(1, sizeof(UA_RollupSeries));
+    if (!s)
+        return NULL;
+    if (UA_NodeId_copy(nodeId, &s->nodeId) != UA_STATUSCODE_GOOD) {
+        UA_free(s);
+        return NULL;
+    }
+
+    const UA_HistoryDataBackend *b = &ctx->backend;
+    size_t storeEnd = b->getEnd(server, b->context, sessionId, sessionContext, nodeId);
+    if (storeEnd > 0) {
+        size_t index = b->firstIndex(server, b->context, sessionId, sessionContext, nodeId);
+        for (; index < storeEnd; ++index) {
+            const UA_DataValue *value =
+                b->getDataValue(server, b->context, sessionId, sessionContext, nodeId, index);
+            UA_DateTime time;
+            UA_Double v;
+            if (!value || !UA_HistoryDataSummary_sample(value, &time, &v))
+                continue;
+            if (addSample_backend_rollup(ctx, s, server, sessionId, sessionContext,
+                                         time, v) != UA_STATUSCODE_GOOD) {
+                UA_RollupSeries_delete(s);
+                return NULL;
+            }
+        }
+    }
+
+    ctx->series[ctx->seriesSize] = s;
+    ++ctx->seriesSize;
+    *created = true;
+    return s;
+}
+
+static UA_StatusCode
+serverSetHistoryData_backend_rollup(UA_Server *server,
+                                    void *context,
+                                    const UA_NodeId *sessionId,
+                                    void *sessionContext,
+                                    const UA_NodeId *nodeId,
+                                    UA_Boolean historizing,
+                                    const UA_DataValue *value) {
+    UA_RollupContext *ctx = (UA_RollupContext*)context;
+    UA_StatusCode retval =
+        ctx->backend.serverSetHistoryData(server, ctx->backend.context, sessionId,
+                                          sessionContext, nodeId, historizing, value);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* A new series already contains the sample */
+    UA_Boolean created;
+    UA_RollupSeries *series = getSeries_backend_rollup(ctx, server, sessionId,
+                                                       sessionContext, nodeId, &created);
+    if (!series)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_DateTime time;
+    UA_Double v;
+    if (created || !UA_HistoryDataSummary_sample(value, &time, &v))
+        return UA_STATUSCODE_GOOD;
+    return addSample_backend_rollup(ctx, series, server, sessionId, sessionContext, time, v);
+}
+
+static UA_StatusCode
+getSummary_backend_rollup(UA_Server *server,
+                          void *context,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId,
+                          UA_DateTime start,
+                          UA_DateTime end,
+                          UA_HistoryDataSummary *summary) {
+    UA_RollupContext *ctx = (UA_RollupContext*)context;
+    UA_HistoryDataSummary_init(summary);
+    if (end <= start)
+        return UA_STATUSCODE_GOOD;
+
+    /* Only the samples before the first and after the last whole minute are
+     * read from the wrapped backend */
+    UA_DateTime first = floorTime_backend_rollup(start, UA_ROLLUP_MINUTE);
+    if (first < start)
+        first += UA_ROLLUP_MINUTE;
+    UA_DateTime last = floorTime_backend_rollup(end, UA_ROLLUP_MINUTE);
+    if (first >= last)
+        return UA_HistoryDataSummary_read(server, sessionId, sessionContext, &ctx->backend,
+                                          nodeId, start, end, summary);
+
+    UA_Boolean created;
+    const UA_RollupSeries *series = getSeries_backend_rollup(ctx, server, sessionId,
+                                                             sessionContext, nodeId, &created);
+    if (!series)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    UA_StatusCode retval =
+        UA_HistoryDataSummary_read(server, sessionId, sessionContext, &ctx->backend,
+                                   nodeId, start, first, summary);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* Use the hourly summary where the hour is covered completely */
+    const UA_RollupLevel *minutes = &series->minutes;
+    const UA_RollupLevel *hours = &series->hours;
+    size_t i = lowerBound_backend_rollup(minutes, first);
+    size_t h = 0;
+    while (i < minutes->size && minutes->buckets[i].start < last) {
+        UA_DateTime hour = floorTime_backend_rollup(minutes->buckets[i].start, UA_ROLLUP_HOUR);
+        if (hour < first || hour + UA_ROLLUP_HOUR > last) {
+            UA_HistoryDataSummary_merge(summary, &minutes->buckets[i].summary);
+            ++i;
+            continue;
+        }
+        if (h >= hours->size || hours->buckets[h].start != hour)
+            h = lowerBound_backend_rollup(hours, hour);
+        if (h < hours->size && hours->buckets[h].start == hour)
+            UA_HistoryDataSummary_merge(summary, &hours->buckets[h].summary);
+        while (i < minutes->size && minutes->buckets[i].start < hour + UA_ROLLUP_HOUR)
+            ++i;
+    }
+
+    UA_HistoryDataSummary edge;
+    retval = UA_HistoryDataSummary_read(server, sessionId, sessionContext, &ctx->backend,
+                                        nodeId, last, end, &edge);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_HistoryDataSummary_merge(summary, &edge);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* The low level API is forwarded to the wrapped backend */
+
+static size_t
+getDateTimeMatch_backend_rollup(UA_Server *server,
+                                void *context,
+                                const UA_NodeId *sessionId,
+                                void *sessionContext,
+                                const UA_NodeId *nodeId,
+                                const UA_DateTime timestamp,
+                                const MatchStrategy strategy) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->getDateTimeMatch(server, b->context, sessionId, sessionContext,
+                               nodeId, timestamp, strategy);
+}
+
+static size_t
+getEnd_backend_rollup(UA_Server *server,
+                      void *context,
+                      const UA_NodeId *sessionId,
+                      void *sessionContext,
+                      const UA_NodeId *nodeId) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->getEnd(server, b->context, sessionId, sessionContext, nodeId);
+}
+
+static size_t
+lastIndex_backend_rollup(UA_Server *server,
+                         void *context,
+                         const UA_NodeId *sessionId,
+                         void *sessionContext,
+                         const UA_NodeId *nodeId) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->lastIndex(server, b->context, sessionId, sessionContext, nodeId);
+}
+
+static size_t
+firstIndex_backend_rollup(UA_Server *server,
+                          void *context,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->firstIndex(server, b->context, sessionId, sessionContext, nodeId);
+}
+
+static size_t
+resultSize_backend_rollup(UA_Server *server,
+                          void *context,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId,
+                          size_t startIndex,
+                          size_t endIndex) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->resultSize(server, b->context, sessionId, sessionContext, nodeId,
+                         startIndex, endIndex);
+}
+
+static UA_StatusCode
+copyDataValues_backend_rollup(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId,
+                              size_t startIndex,
+                              size_t endIndex,
+                              UA_Boolean reverse,
+                              size_t maxValues,
+                              UA_NumericRange range,
+                              UA_Boolean releaseContinuationPoints,
+                              const UA_ByteString *continuationPoint,
+                              UA_ByteString *outContinuationPoint,
+                              size_t *providedValues,
+                              UA_DataValue *values) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->copyDataValues(server, b->context, sessionId, sessionContext, nodeId,
+                             startIndex, endIndex, reverse, maxValues, range,
+                             releaseContinuationPoints, continuationPoint,
+                             outContinuationPoint, providedValues, values);
+}
+
+static const UA_DataValue*
+getDataValue_backend_rollup(UA_Server *server,
+                            void *context,
+                            const UA_NodeId *sessionId,
+                            void *sessionContext,
+                            const UA_NodeId *nodeId,
+                            size_t index) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->getDataValue(server, b->context, sessionId, sessionContext, nodeId, index);
+}
+
+static UA_Boolean
+boundSupported_backend_rollup(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->boundSupported(server, b->context, sessionId, sessionContext, nodeId);
+}
+
+static UA_Boolean
+timestampsToReturnSupported_backend_rollup(UA_Server *server,
+                                           void *context,
+                                           const UA_NodeId *sessionId,
+                                           void *sessionContext,
+                                           const UA_NodeId *nodeId,
+                                           const UA_TimestampsToReturn timestampsToReturn) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->timestampsToReturnSupported(server, b->context, sessionId, sessionContext,
+                                          nodeId, timestampsToReturn);
+}
+
+static UA_StatusCode
+getCursor_backend_rollup(UA_Server *server,
+                         void *context,
+                         const UA_NodeId *sessionId,
+                         void *sessionContext,
+                         const UA_NodeId *nodeId,
+                         size_t index,
+                         UA_HistoryDataCursor *cursor) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->getCursor(server, b->context, sessionId, sessionContext, nodeId,
+                        index, cursor);
+}
+
+static UA_StatusCode
+readCursor_backend_rollup(UA_Server *server,
+                          void *context,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId,
+                          UA_HistoryDataCursor *cursor,
+                          UA_Boolean reverse,
+                          size_t maxValues,
+                          UA_HistoryDataCursorCallback callback,
+                          void *callbackContext,
+                          size_t *providedValues) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    return b->readCursor(server, b->context, sessionId, sessionContext, nodeId,
+                         cursor, reverse, maxValues, callback, callbackContext,
+                         providedValues);
+}
+
+static void
+lock_backend_rollup(UA_Server *server, void *context) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    b->lock(server, b->context);
+}
+
+static void
+unlock_backend_rollup(UA_Server *server, void *context) {
+    const UA_HistoryDataBackend *b = &((UA_RollupContext*)context)->backend;
+    b->unlock(server, b->context);
+}
+
+static void
+deleteMembers_backend_rollup(UA_HistoryDataBackend *backend) {
+    if (backend == NULL || backend->context == NULL)
+        return;
+    UA_RollupContext *ctx = (UA_RollupContext*)backend->context;
+    for (size_t i = 0; i < ctx->seriesSize; ++i)
+        UA_RollupSeries_delete(ctx->series[i]);
+    UA_free(ctx->series);
+    UA_free(ctx);
+    backend->context = NULL;
+}
+
+UA_HistoryDataBackend
+UA_HistoryDataBackend_Rollup(UA_HistoryDataBackend backend) {
+    UA_HistoryDataBackend result;
+    memset(&result, 0, sizeof(UA_HistoryDataBackend));
+    if (!backend.getDataValue || !backend.serverSetHistoryData)
+        return result;
+    UA_RollupContext *ctx = (UA_RollupContext*)UA_calloc(1, sizeof(UA_RollupContext));
+    if (!ctx)
+        return result;
+    ctx->backend = backend;
+
+    result.serverSetHistoryData = &serverSetHistoryData_backend_rollup;
+    result.resultSize = &resultSize_backend_rollup;
+    result.getEnd = &getEnd_backend_rollup;
+    result.lastIndex = &lastIndex_backend_rollup;
+    result.firstIndex = &firstIndex_backend_rollup;
+    result.getDateTimeMatch = &getDateTimeMatch_backend_rollup;
+    result.copyDataValues = &copyDataValues_backend_rollup;
+    result.getDataValue = &getDataValue_backend_rollup;
+    result.boundSupported = &boundSupported_backend_rollup;
+    result.timestampsToReturnSupported = &timestampsToReturnSupported_backend_rollup;
+    result.getSummary = &getSummary_backend_rollup;
+    if (backend.lock && backend.unlock) {
+        result.lock = &lock_backend_rollup;
+        result.unlock = &unlock_backend_rollup;
+    }
+    if (backend.getCursor && backend.readCursor) {
+        result.getCursor = &getCursor_backend_rollup;
+        result.readCursor = &readCursor_backend_rollup;
+    }
+    result.deleteMembers = &deleteMembers_backend_rollup;
+    result.getHistoryData = NULL;
+    result.context = ctx;
+    return result;
+}
+
+void
+UA_HistoryDataBackend_Rollup_deleteMembers(UA_HistoryDataBackend *backend) {
+    deleteMembers_backend_rollup(backend);
+    memset(backend, 0, sizeof(UA_HistoryDataBackend));
+}
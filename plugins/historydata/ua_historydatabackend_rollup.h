@@ -0,0 +1,37 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UA_HISTORYDATABACKEND_ROLLUP_H_
+#define UA_HISTORYDATABACKEND_ROLLUP_H_
+
+#include "ua_plugin_history_data_backend.h"
+
+_UA_BEGIN_DECLS
+
+/* Backend that adds precomputed summaries to another backend. The samples are
+ * stored in the wrapped backend. Additionally, the summary of the Good numeric
+ * samples of every minute and every hour is updated when a sample is inserted.
+ * ReadProcessed requests use the hourly and minutely summaries for the whole
+ * minutes of a processing interval and read only the samples at the edges. So
+ * a trend over a year is computed from about 9000 hourly summaries.
+ *
+ * The summaries of a node are built from the samples in the wrapped backend
+ * when the node is accessed for the first time. Afterwards, samples that
+ * arrive in order update the summaries in O(1). A sample that is older than
+ * the newest sample of its minute recomputes the summary of the minute.
+ * Samples that the wrapped backend drops by itself (e.g. a ring buffer) remain
+ * in the summaries.
+ *
+ * The wrapped backend must implement the low level API. It is not deleted
+ * with the rollup backend. */
+UA_HistoryDataBackend UA_EXPORT
+UA_HistoryDataBackend_Rollup(UA_HistoryDataBackend backend);
+
+void UA_EXPORT
+UA_HistoryDataBackend_Rollup_deleteMembers(UA_HistoryDataBackend *backend);
+
+_UA_END_DECLS
+
+#endif /* UA_HISTORYDATABACKEND_ROLLUP_H_ */
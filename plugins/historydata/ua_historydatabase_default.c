@@ -6,7 +6,10 @@
  */
 
 #include "ua_historydatabase_default.h"
+#include "ua_historydatasummary.h"
+#include "ua_server_config.h"
 #include <limits.h>
+#include <math.h>
 
 typedef struct {
     UA_HistoryDataGathering gathering;
@@ -289,6 +292,267 @@ getHistoryData_service_default(const UA_HistoryDataBackend* backend,
     return UA_STATUSCODE_GOOD;
 }
 
+/* Continuation point of a ReadRaw request that is read with a cursor. It
+ * contains the whole state of the request, so nothing is kept in the server. */
+typedef struct {
+    UA_HistoryDataCursor cursor;
+    UA_UInt64 valuesLeft;      /* Samples of the range that were not returned */
+    UA_DateTime lastTimestamp; /* Timestamp of the LAST bound */
+    UA_Boolean addLast;        /* The LAST bound was not returned */
+    UA_Boolean reverse;
+} UA_HistoryDataCursorPoint_default;
+
+typedef struct {
+    UA_DataValue *values;
+    size_t valuesSize;
+    size_t maxValues;
+    UA_NumericRange range;
+    size_t encodedSize;
+    size_t maxEncodedSize; /* 0 = unbounded */
+    UA_Boolean full;
+    UA_StatusCode retval;
+} UA_HistoryDataStream_default;
+
+/* The smallest message size that the server accepts */
+static size_t
+maxMessageSize_service_default(UA_Server *server) {
+    UA_ServerConfig *config = UA_Server_getConfig(server);
+    size_t maxSize = 0;
+    for (size_t i = 0; i < config->networkLayersSize; ++i) {
+        size_t size = config->networkLayers[i].localConnectionConfig.maxMessageSize;
+        if (size > 0 && (maxSize == 0 || size < maxSize))
+            maxSize = size;
+    }
+    return maxSize;
+}
+
+/* Estimates the encoded size of a DataValue. The binary encoding is not
+ * available for plugins. The estimate is exact for the timestamps, numeric
+ * values and strings. Structures are counted with their size in memory. */
+static size_t
+encodedSize_service_default(const UA_DataValue *value) {
+    size_t size = 25; /* Mask, status code, timestamps and picoseconds */
+    const UA_Variant *v = &value->value;
+    if (!value->hasValue || !v->type)
+        return size;
+    size_t length = 1;
+    ++size; /* Encoding mask of the variant */
+    if (!UA_Variant_isScalar(v)) {
+        length = v->arrayLength;
+        size += 4 + 4 * (v->arrayDimensionsSize + 1);
+    }
+    if (v->type == &UA_TYPES[UA_TYPES_STRING] ||
+        v->type == &UA_TYPES[UA_TYPES_BYTESTRING] ||
+        v->type == &UA_TYPES[UA_TYPES_XMLELEMENT]) {
+        const UA_String *strings = (const UA_String*)v->data;
+        for (size_t i = 0; i < length; ++i)
+            size += 4 + strings[i].length;
+        return size;
+    }
+    return size + length * v->type->memSize;
+}
+
+/* Moves the value into the result if it fits. The first value is always
+ * added, so the request makes progress. */
+static UA_Boolean
+append_service_default(UA_HistoryDataStream_default *stream, UA_DataValue *value) {
+    if (stream->full || stream->valuesSize >= stream->maxValues)
+        return false;
+    if (stream->maxEncodedSize > 0) {
+        size_t size = encodedSize_service_default(value);
+        if (stream->valuesSize > 0 && stream->encodedSize + size > stream->maxEncodedSize) {
+            stream->full = true;
+            return false;
+        }
+        stream->encodedSize += size;
+    }
+    stream->values[stream->valuesSize] = *value;
+    ++stream->valuesSize;
+    return true;
+}
+
+static UA_Boolean
+appendBound_service_default(UA_HistoryDataStream_default *stream, UA_DateTime timestamp) {
+    UA_DataValue bound;
+    UA_DataValue_init(&bound);
+    bound.hasStatus = true;
+    bound.status = UA_STATUSCODE_BADBOUNDNOTFOUND;
+    bound.hasSourceTimestamp = true;
+    bound.sourceTimestamp = timestamp;
+    return append_service_default(stream, &bound);
+}
+
+/* Copies a sample from the storage of the backend into the result */
+static UA_Boolean
+appendSample_service_default(void *context, const UA_DataValue *value) {
+    UA_HistoryDataStream_default *stream = (UA_HistoryDataStream_default*)context;
+    if (stream->full || stream->valuesSize >= stream->maxValues)
+        return false;
+    UA_DataValue copy;
+    if (stream->range.dimensionsSize > 0) {
+        memcpy(&copy, value, sizeof(UA_DataValue));
+        UA_Variant_init(&copy.value);
+        if (value->hasValue)
+            UA_Variant_copyRange(&value->value, &copy.value, stream->range);
+    } else {
+        stream->retval = UA_DataValue_copy(value, &copy);
+        if (stream->retval != UA_STATUSCODE_GOOD)
+            return false;
+    }
+    if (append_service_default(stream, &copy))
+        return true;
+    UA_DataValue_deleteMembers(&copy);
+    return false;
+}
+
+/* ReadRaw with the cursor of the backend. The samples are copied once from
+ * the storage into the result. The result is bounded by numValuesPerNode,
+ * maxSize and the maximum message size of the server. The continuation point
+ * stores the cursor, so a continuation does not search the range again. */
+static UA_StatusCode
+getHistoryDataCursor_service_default(const UA_HistoryDataBackend* backend,
+                                     const UA_DateTime start,
+                                     const UA_DateTime end,
+                                     UA_Server *server,
+                                     const UA_NodeId *sessionId,
+                                     void *sessionContext,
+                                     const UA_NodeId* nodeId,
+                                     size_t maxSize,
+                                     UA_UInt32 numValuesPerNode,
+                                     UA_Boolean returnBounds,
+                                     UA_NumericRange range,
+                                     UA_Boolean releaseContinuationPoints,
+                                     const UA_ByteString *continuationPoint,
+                                     UA_ByteString *outContinuationPoint,
+                                     size_t *resultSize,
+                                     UA_DataValue ** result)
+{
+    /* Nothing is allocated for a continuation point */
+    if (releaseContinuationPoints)
+        return UA_STATUSCODE_GOOD;
+
+    UA_HistoryDataCursorPoint_default cp;
+    UA_Boolean addFirst = false;
+    UA_StatusCode retval;
+    if (continuationPoint->length > 0) {
+        if (continuationPoint->length != sizeof(UA_HistoryDataCursorPoint_default))
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        memcpy(&cp, continuationPoint->data, sizeof(UA_HistoryDataCursorPoint_default));
+    } else {
+        memset(&cp, 0, sizeof(UA_HistoryDataCursorPoint_default));
+        size_t startIndex;
+        size_t endIndex;
+        size_t size = getResultSize_service_default(backend, server, sessionId, sessionContext,
+                                                    nodeId, start, end, 0, returnBounds,
+                                                    &startIndex, &endIndex, &addFirst,
+                                                    &cp.addLast, &cp.reverse);
+        size_t storeEnd = backend->getEnd(server, backend->context, sessionId, sessionContext, nodeId);
+        if (startIndex != storeEnd && endIndex != storeEnd)
+            cp.valuesLeft = size - addFirst - cp.addLast;
+        retval = backend->getCursor(server, backend->context, sessionId, sessionContext,
+                                    nodeId, startIndex, &cp.cursor);
+        if (retval != UA_STATUSCODE_GOOD)
+            return retval;
+
+        /* See OPC UA Part 11, Version 1.03, Page 5-6, Table 1, Mark a */
+        cp.lastTimestamp = end;
+        if (cp.addLast && (start == LLONG_MIN || end == LLONG_MIN) &&
+            storeEnd != backend->firstIndex(server, backend->context, sessionId, sessionContext, nodeId)) {
+            const UA_DataValue *last = backend->getDataValue(server, backend->context, sessionId,
+                                                             sessionContext, nodeId, endIndex);
+            if (last)
+                cp.lastTimestamp = last->sourceTimestamp +
+                    (start == LLONG_MIN ? -UA_DATETIME_SEC : UA_DATETIME_SEC);
+        }
+    }
+
+    UA_HistoryDataStream_default stream;
+    memset(&stream, 0, sizeof(UA_HistoryDataStream_default));
+    stream.range = range;
+    stream.maxEncodedSize = maxMessageSize_service_default(server);
+    stream.maxValues = (size_t)cp.valuesLeft + addFirst + cp.addLast;
+    if (stream.maxValues > maxSize)
+        stream.maxValues = maxSize;
+    if (numValuesPerNode > 0 && stream.maxValues > numValuesPerNode)
+        stream.maxValues = numValuesPerNode;
+    stream.values = (UA_DataValue*)UA_Array_new(stream.maxValues, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    if (!stream.values)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    if (addFirst)
+        appendBound_service_default(&stream, start == LLONG_MIN ? end : start);
+
+    if (cp.valuesLeft > 0 && stream.valuesSize < stream.maxValues) {
+        size_t maxValues = stream.maxValues - stream.valuesSize;
+        if (maxValues > cp.valuesLeft)
+            maxValues = (size_t)cp.valuesLeft;
+        size_t provided = 0;
+        retval = backend->readCursor(server, backend->context, sessionId, sessionContext,
+                                     nodeId, &cp.cursor, cp.reverse, maxValues,
+                                     appendSample_service_default, &stream, &provided);
+        if (retval == UA_STATUSCODE_GOOD)
+            retval = stream.retval;
+        if (retval != UA_STATUSCODE_GOOD) {
+            UA_Array_delete(stream.values, stream.valuesSize, &UA_TYPES[UA_TYPES_DATAVALUE]);
+            return retval;
+        }
+        /* Samples of the range were removed from the storage */
+        if (provided < maxValues && !stream.full)
+            cp.valuesLeft = 0;
+        else
+            cp.valuesLeft -= provided;
+    }
+
+    if (cp.addLast && cp.valuesLeft == 0 &&
+        appendBound_service_default(&stream, cp.lastTimestamp))
+        cp.addLast = false;
+
+    *result = stream.values;
+    *resultSize = stream.valuesSize;
+    if (cp.valuesLeft == 0 && !cp.addLast)
+        return UA_STATUSCODE_GOOD;
+    retval = UA_ByteString_allocBuffer(outContinuationPoint,
+                                       sizeof(UA_HistoryDataCursorPoint_default));
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+    memcpy(outContinuationPoint->data, &cp, sizeof(UA_HistoryDataCursorPoint_default));
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Returns the settings of a node that can be read historically */
+static const UA_HistorizingNodeIdSettings *
+getSetting_service_default(UA_Server *server,
+                           UA_HistoryDatabaseContext_default *ctx,
+                           const UA_NodeId *nodeId,
+                           UA_StatusCode *statusCode)
+{
+    UA_Byte accessLevel = 0;
+    UA_Server_readAccessLevel(server,
+                              *nodeId,
+                              &accessLevel);
+    if (!(accessLevel & UA_ACCESSLEVELMASK_HISTORYREAD)) {
+        *statusCode = UA_STATUSCODE_BADUSERACCESSDENIED;
+        return NULL;
+    }
+
+    UA_Boolean historizing = false;
+    UA_Server_readHistorizing(server,
+                              *nodeId,
+                              &historizing);
+    if (!historizing) {
+        *statusCode = UA_STATUSCODE_BADHISTORYOPERATIONINVALID;
+        return NULL;
+    }
+
+    const UA_HistorizingNodeIdSettings *setting = ctx->gathering.getHistorizingSetting(
+                server,
+                ctx->gathering.context,
+                nodeId);
+    if (!setting)
+        *statusCode = UA_STATUSCODE_BADHISTORYOPERATIONINVALID;
+    return setting;
+}
+
 static void
 readRaw_service_default(UA_Server *server,
                         void *context,
@@ -305,33 +569,11 @@ readRaw_service_default(UA_Server *server,
 {
     UA_HistoryDatabaseContext_default *ctx = (UA_HistoryDatabaseContext_default*)context;
     for (size_t i = 0; i < nodesToReadSize; ++i) {
-        UA_Byte accessLevel = 0;
-        UA_Server_readAccessLevel(server,
-                                  nodesToRead[i].nodeId,
-                                  &accessLevel);
-        if (!(accessLevel & UA_ACCESSLEVELMASK_HISTORYREAD)) {
-            response->results[i].statusCode = UA_STATUSCODE_BADUSERACCESSDENIED;
+        const UA_HistorizingNodeIdSettings *setting =
+            getSetting_service_default(server, ctx, &nodesToRead[i].nodeId,
+                                       &response->results[i].statusCode);
+        if (!setting)
             continue;
-        }
-
-        UA_Boolean historizing = false;
-        UA_Server_readHistorizing(server,
-                                  nodesToRead[i].nodeId,
-                                  &historizing);
-        if (!historizing) {
-            response->results[i].statusCode = UA_STATUSCODE_BADHISTORYOPERATIONINVALID;
-            continue;
-        }
-
-        const UA_HistorizingNodeIdSettings *setting = ctx->gathering.getHistorizingSetting(
-                    server,
-                    ctx->gathering.context,
-                    &nodesToRead[i].nodeId);
-
-        if (!setting) {
-            response->results[i].statusCode = UA_STATUSCODE_BADHISTORYOPERATIONINVALID;
-            continue;
-        }
 
         if (historyReadDetails->returnBounds && !setting->historizingBackend.boundSupported(
                     server,
@@ -365,6 +607,9 @@ readRaw_service_default(UA_Server *server,
             }
         }
 
+        const UA_HistoryDataBackend *backend = &setting->historizingBackend;
+        if (backend->lock)
+            backend->lock(server, backend->context);
         UA_StatusCode getHistoryDataStatusCode;
         if (setting->historizingBackend.getHistoryData) {
             getHistoryDataStatusCode = setting->historizingBackend.getHistoryData(
@@ -384,6 +629,24 @@ readRaw_service_default(UA_Server *server,
                         &nodesToRead[i].continuationPoint,
                         &response->results[i].continuationPoint,
                         historyData[i]);
+        } else if (backend->getCursor && backend->readCursor) {
+            getHistoryDataStatusCode = getHistoryDataCursor_service_default(
+                        backend,
+                        historyReadDetails->startTime,
+                        historyReadDetails->endTime,
+                        server,
+                        sessionId,
+                        sessionContext,
+                        &nodesToRead[i].nodeId,
+                        setting->maxHistoryDataResponseSize,
+                        historyReadDetails->numValuesPerNode,
+                        historyReadDetails->returnBounds,
+                        range,
+                        releaseContinuationPoints,
+                        &nodesToRead[i].continuationPoint,
+                        &response->results[i].continuationPoint,
+                        &historyData[i]->dataValuesSize,
+                        &historyData[i]->dataValues);
         } else {
             getHistoryDataStatusCode = getHistoryData_service_default(
                         &setting->historizingBackend,
@@ -404,6 +667,8 @@ readRaw_service_default(UA_Server *server,
                         &historyData[i]->dataValuesSize,
                         &historyData[i]->dataValues);
         }
+        if (backend->unlock)
+            backend->unlock(server, backend->context);
         if (getHistoryDataStatusCode != UA_STATUSCODE_GOOD) {
             response->results[i].statusCode = getHistoryDataStatusCode;
             continue;
@@ -413,6 +678,481 @@ readRaw_service_default(UA_Server *server,
     return;
 }
 
+/*************************/
+/* ReadProcessed Service */
+/*************************/
+
+/* Historian bits of the InfoType DataValue (Part 4, 7.34.1) */
+#define UA_HISTORIANBITS_CALCULATED 0x01
+#define UA_HISTORIANBITS_INTERPOLATED 0x02
+
+#define UA_STATUSCODE_GOODCALCULATED \
+    (UA_STATUSCODE_GOOD | UA_STATUSCODE_INFOTYPE_DATAVALUE | UA_HISTORIANBITS_CALCULATED)
+#define UA_STATUSCODE_UNCERTAINCALCULATED \
+    (UA_STATUSCODE_UNCERTAINDATASUBNORMAL | UA_STATUSCODE_INFOTYPE_DATAVALUE | \
+     UA_HISTORIANBITS_CALCULATED)
+
+/* The number of processing intervals is chosen by the client. The intervals
+ * computed for one request are limited even if neither the node setting nor
+ * the server configuration sets a limit. Further intervals are returned with a
+ * continuation point. */
+#define UA_HISTORY_MAXPROCESSEDVALUES 10000
+
+/* Encoded size of a processed DataValue with a Double value, status code and
+ * both timestamps */
+#define UA_HISTORY_PROCESSEDVALUESIZE 34
+
+/* The maximum number of processed values in one response */
+static size_t
+maxProcessedValues_service_default(UA_Server *server, size_t maxSize)
+{
+    size_t maxValues = UA_HISTORY_MAXPROCESSEDVALUES;
+    if (maxSize > 0 && maxSize < maxValues)
+        maxValues = maxSize;
+    UA_ServerConfig *config = UA_Server_getConfig(server);
+    if (config->maxReturnDataValues > 0 && config->maxReturnDataValues < maxValues)
+        maxValues = config->maxReturnDataValues;
+    size_t maxMessageSize = maxMessageSize_service_default(server);
+    if (maxMessageSize > 0 && maxMessageSize / UA_HISTORY_PROCESSEDVALUESIZE < maxValues)
+        maxValues = maxMessageSize / UA_HISTORY_PROCESSEDVALUESIZE;
+    if (maxValues == 0)
+        maxValues = 1;
+    return maxValues;
+}
+
+static UA_Boolean
+aggregateSupported_service_default(const UA_NodeId *aggregate)
+{
+    if (aggregate->namespaceIndex != 0 ||
+        aggregate->identifierType != UA_NODEIDTYPE_NUMERIC)
+        return false;
+    switch (aggregate->identifier.numeric) {
+    case UA_NS0ID_AGGREGATEFUNCTION_INTERPOLATIVE:
+    case UA_NS0ID_AGGREGATEFUNCTION_AVERAGE:
+    case UA_NS0ID_AGGREGATEFUNCTION_TIMEAVERAGE:
+    case UA_NS0ID_AGGREGATEFUNCTION_TOTAL:
+    case UA_NS0ID_AGGREGATEFUNCTION_MINIMUM:
+    case UA_NS0ID_AGGREGATEFUNCTION_MAXIMUM:
+    case UA_NS0ID_AGGREGATEFUNCTION_MINIMUMACTUALTIME:
+    case UA_NS0ID_AGGREGATEFUNCTION_MAXIMUMACTUALTIME:
+    case UA_NS0ID_AGGREGATEFUNCTION_RANGE:
+    case UA_NS0ID_AGGREGATEFUNCTION_COUNT:
+    case UA_NS0ID_AGGREGATEFUNCTION_START:
+    case UA_NS0ID_AGGREGATEFUNCTION_END:
+    case UA_NS0ID_AGGREGATEFUNCTION_DELTA:
+    case UA_NS0ID_AGGREGATEFUNCTION_STANDARDDEVIATIONSAMPLE:
+    case UA_NS0ID_AGGREGATEFUNCTION_STANDARDDEVIATIONPOPULATION:
+    case UA_NS0ID_AGGREGATEFUNCTION_VARIANCESAMPLE:
+    case UA_NS0ID_AGGREGATEFUNCTION_VARIANCEPOPULATION:
+        return true;
+    default:
+        return false;
+    }
+}
+
+typedef struct {
+    UA_DateTime time;
+    UA_Double value;
+} UA_HistoryDataPoint;
+
+/* Finds the closest summarized sample before the timestamp or at/after the
+ * timestamp. Samples with a bad status or a non-numeric value are skipped. */
+static UA_Boolean
+findBound_service_default(const UA_HistoryDataBackend *backend,
+                          UA_Server *server,
+                          const UA_NodeId *sessionId,
+                          void *sessionContext,
+                          const UA_NodeId *nodeId,
+                          UA_DateTime timestamp,
+                          UA_Boolean before,
+                          UA_HistoryDataPoint *point)
+{
+    size_t storeEnd = backend->getEnd(server, backend->context, sessionId, sessionContext, nodeId);
+    if (storeEnd == 0)
+        return false;
+    size_t firstIndex = backend->firstIndex(server, backend->context, sessionId, sessionContext, nodeId);
+    size_t index = backend->getDateTimeMatch(server, backend->context, sessionId, sessionContext, nodeId,
+                                             timestamp, before ? MATCH_BEFORE : MATCH_EQUAL_OR_AFTER);
+    while (index != storeEnd) {
+        const UA_DataValue *value = backend->getDataValue(server, backend->context, sessionId,
+                                                          sessionContext, nodeId, index);
+        if (value && UA_HistoryDataSummary_sample(value, &point->time, &point->value))
+            return true;
+        if (before) {
+            if (index == firstIndex)
+                break;
+            --index;
+        } else {
+            ++index;
+        }
+    }
+    return false;
+}
+
+static UA_Double
+interpolate_service_default(const UA_HistoryDataPoint *p0, const UA_HistoryDataPoint *p1,
+                            UA_DateTime time)
+{
+    if (p1->time == p0->time)
+        return p1->value;
+    return p0->value + (p1->value - p0->value) *
+        ((UA_Double)(time - p0->time) / (UA_Double)(p1->time - p0->time));
+}
+
+static UA_StatusCode
+interpolative_service_default(const UA_HistoryDataBackend *backend,
+                              UA_Server *server,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_NodeId *nodeId,
+                              UA_DateTime timestamp,
+                              UA_DataValue *result)
+{
+    UA_HistoryDataPoint prev, next;
+    UA_Boolean hasNext = findBound_service_default(backend, server, sessionId, sessionContext,
+                                                   nodeId, timestamp, false, &next);
+    UA_Double value;
+    if (hasNext && next.time == timestamp) {
+        value = next.value;
+        result->status = UA_STATUSCODE_GOOD;
+    } else if (findBound_service_default(backend, server, sessionId, sessionContext,
+                                         nodeId, timestamp, true, &prev)) {
+        if (hasNext) {
+            value = interpolate_service_default(&prev, &next, timestamp);
+            result->status = UA_STATUSCODE_GOOD | UA_STATUSCODE_INFOTYPE_DATAVALUE |
+                UA_HISTORIANBITS_INTERPOLATED;
+        } else {
+            /* Stepped extrapolation after the last sample */
+            value = prev.value;
+            result->status = UA_STATUSCODE_UNCERTAINDATASUBNORMAL |
+                UA_STATUSCODE_INFOTYPE_DATAVALUE | UA_HISTORIANBITS_INTERPOLATED;
+        }
+    } else {
+        result->status = UA_STATUSCODE_BADNODATA;
+        result->hasStatus = true;
+        return UA_STATUSCODE_GOOD;
+    }
+    result->hasStatus = true;
+    result->hasValue = true;
+    return UA_Variant_setScalarCopy(&result->value, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+}
+
+/* Area below the sloped interpolation of the samples in [start, end). The
+ * bounding samples before and after the interval are used to interpolate the
+ * values at the edges. Without bounding samples, the area ends at the first
+ * or last sample. covered is set to the duration in seconds of the area. */
+static UA_Boolean
+area_service_default(const UA_HistoryDataBackend *backend,
+                     UA_Server *server,
+                     const UA_NodeId *sessionId,
+                     void *sessionContext,
+                     const UA_NodeId *nodeId,
+                     UA_DateTime start,
+                     UA_DateTime end,
+                     const UA_HistoryDataSummary *summary,
+                     UA_Double *area,
+                     UA_Double *covered,
+                     UA_Boolean *complete)
+{
+    UA_HistoryDataPoint prev, next;
+    UA_Boolean hasPrev = findBound_service_default(backend, server, sessionId, sessionContext,
+                                                   nodeId, start, true, &prev);
+    UA_Boolean hasNext = findBound_service_default(backend, server, sessionId, sessionContext,
+                                                   nodeId, end, false, &next);
+    UA_HistoryDataPoint left, right;
+    if (summary->count > 0) {
+        UA_HistoryDataPoint first = {summary->firstTime, summary->first};
+        UA_HistoryDataPoint last = {summary->lastTime, summary->last};
+        *area = summary->area;
+        left = first;
+        right = last;
+        if (hasPrev) {
+            left.time = start;
+            left.value = interpolate_service_default(&prev, &first, start);
+            *area += (left.value + first.value) * 0.5 *
+                ((UA_Double)(first.time - start) / UA_DATETIME_SEC);
+        }
+        if (hasNext) {
+            right.time = end;
+            right.value = interpolate_service_default(&last, &next, end);
+            *area += (last.value + right.value) * 0.5 *
+                ((UA_Double)(end - last.time) / UA_DATETIME_SEC);
+        }
+    } else {
+        if (!hasPrev)
+            return false;
+        left.time = start;
+        right.time = start;
+        left.value = prev.value;
+        right.value = prev.value;
+        *area = 0.0;
+        if (hasNext) {
+            right.time = end;
+            left.value = interpolate_service_default(&prev, &next, start);
+            right.value = interpolate_service_default(&prev, &next, end);
+            *area = (left.value + right.value) * 0.5 *
+                ((UA_Double)(end - start) / UA_DATETIME_SEC);
+        }
+    }
+    *covered = (UA_Double)(right.time - left.time) / UA_DATETIME_SEC;
+    *complete = (left.time == start && right.time == end);
+    if (*covered <= 0.0)
+        *area = left.value; /* Single point */
+    return true;
+}
+
+/* Computes the aggregate of the interval [start, end). The result timestamp
+ * is set to the timestamp of the interval or of the selected sample. */
+static UA_StatusCode
+processInterval_service_default(const UA_HistoryDataBackend *backend,
+                                UA_Server *server,
+                                const UA_NodeId *sessionId,
+                                void *sessionContext,
+                                const UA_NodeId *nodeId,
+                                UA_UInt32 aggregate,
+                                UA_DateTime start,
+                                UA_DateTime end,
+                                UA_DateTime *timestamp,
+                                UA_DataValue *result)
+{
+    if (aggregate == UA_NS0ID_AGGREGATEFUNCTION_INTERPOLATIVE)
+        return interpolative_service_default(backend, server, sessionId, sessionContext,
+                                             nodeId, *timestamp, result);
+
+    /* Summarize the interval from the precomputed summaries of the backend or
+     * from the samples */
+    UA_HistoryDataSummary s;
+    UA_StatusCode retval;
+    if (backend->getSummary)
+        retval = backend->getSummary(server, backend->context, sessionId, sessionContext,
+                                     nodeId, start, end, &s);
+    else
+        retval = UA_HistoryDataSummary_read(server, sessionId, sessionContext, backend,
+                                            nodeId, start, end, &s);
+    if (retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    result->hasStatus = true;
+    result->status = UA_STATUSCODE_GOODCALCULATED;
+    if (aggregate == UA_NS0ID_AGGREGATEFUNCTION_COUNT) {
+        UA_Int32 count = (s.count > UA_INT32_MAX) ? UA_INT32_MAX : (UA_Int32)s.count;
+        result->hasValue = true;
+        return UA_Variant_setScalarCopy(&result->value, &count, &UA_TYPES[UA_TYPES_INT32]);
+    }
+
+    UA_Double value;
+    UA_Double n = (UA_Double)s.count;
+    if (aggregate == UA_NS0ID_AGGREGATEFUNCTION_TIMEAVERAGE ||
+        aggregate == UA_NS0ID_AGGREGATEFUNCTION_TOTAL) {
+        UA_Double area, covered;
+        UA_Boolean complete;
+        if (!area_service_default(backend, server, sessionId, sessionContext, nodeId,
+                                  start, end, &s, &area, &covered, &complete)) {
+            result->status = UA_STATUSCODE_BADNODATA;
+            return UA_STATUSCODE_GOOD;
+        }
+        if (covered <= 0.0) {
+            value = (aggregate == UA_NS0ID_AGGREGATEFUNCTION_TOTAL) ? 0.0 : area;
+            complete = false;
+        } else {
+            value = (aggregate == UA_NS0ID_AGGREGATEFUNCTION_TOTAL) ? area : area / covered;
+        }
+        if (!complete)
+            result->status = UA_STATUSCODE_UNCERTAINCALCULATED;
+    } else {
+        if (s.count == 0 ||
+            (s.count == 1 && (aggregate == UA_NS0ID_AGGREGATEFUNCTION_STANDARDDEVIATIONSAMPLE ||
+                              aggregate == UA_NS0ID_AGGREGATEFUNCTION_VARIANCESAMPLE))) {
+            result->status = UA_STATUSCODE_BADNODATA;
+            return UA_STATUSCODE_GOOD;
+        }
+        switch (aggregate) {
+        case UA_NS0ID_AGGREGATEFUNCTION_AVERAGE: value = s.sum / n; break;
+        case UA_NS0ID_AGGREGATEFUNCTION_MINIMUM: value = s.min; break;
+        case UA_NS0ID_AGGREGATEFUNCTION_MAXIMUM: value = s.max; break;
+        case UA_NS0ID_AGGREGATEFUNCTION_MINIMUMACTUALTIME:
+            value = s.min;
+            *timestamp = s.minTime;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_MAXIMUMACTUALTIME:
+            value = s.max;
+            *timestamp = s.maxTime;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_RANGE: value = s.max - s.min; break;
+        case UA_NS0ID_AGGREGATEFUNCTION_START:
+            value = s.first;
+            *timestamp = s.firstTime;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_END:
+            value = s.last;
+            *timestamp = s.lastTime;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_DELTA: value = s.last - s.first; break;
+        case UA_NS0ID_AGGREGATEFUNCTION_STANDARDDEVIATIONSAMPLE: value = sqrt(s.m2 / (n - 1)); break;
+        case UA_NS0ID_AGGREGATEFUNCTION_STANDARDDEVIATIONPOPULATION: value = sqrt(s.m2 / n); break;
+        case UA_NS0ID_AGGREGATEFUNCTION_VARIANCESAMPLE: value = s.m2 / (n - 1); break;
+        case UA_NS0ID_AGGREGATEFUNCTION_VARIANCEPOPULATION: value = s.m2 / n; break;
+        default: return UA_STATUSCODE_BADAGGREGATENOTSUPPORTED;
+        }
+    }
+    result->hasValue = true;
+    return UA_Variant_setScalarCopy(&result->value, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+}
+
+static UA_StatusCode
+getProcessedData_service_default(const UA_HistoryDataBackend *backend,
+                                 UA_Server *server,
+                                 const UA_NodeId *sessionId,
+                                 void *sessionContext,
+                                 const UA_NodeId *nodeId,
+                                 const UA_ReadProcessedDetails *details,
+                                 UA_UInt32 aggregate,
+                                 size_t maxSize,
+                                 UA_TimestampsToReturn timestampsToReturn,
+                                 const UA_ByteString *continuationPoint,
+                                 UA_ByteString *outContinuationPoint,
+                                 size_t *resultSize,
+                                 UA_DataValue **result)
+{
+    size_t skip = 0;
+    if (continuationPoint->length > 0) {
+        if (continuationPoint->length != sizeof(size_t))
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        memcpy(&skip, continuationPoint->data, sizeof(size_t));
+    }
+
+    /* Divide the time range into the processing intervals. The last interval
+     * can be shorter. */
+    UA_DateTime start = details->startTime;
+    UA_DateTime end = details->endTime;
+    if (start == end || !(details->processingInterval >= 0.0))
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_Boolean reverse = end < start;
+    UA_DateTime span = reverse ? start - end : end - start;
+    UA_DateTime interval = span;
+    if (details->processingInterval * UA_DATETIME_MSEC < (UA_Double)span)
+        interval = (UA_DateTime)(details->processingInterval * UA_DATETIME_MSEC);
+    if (interval <= 0)
+        interval = span;
+    size_t intervals = (size_t)(span / interval) + (span % interval != 0);
+    if (skip >= intervals)
+        return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+
+    size_t count = intervals - skip;
+    size_t maxValues = maxProcessedValues_service_default(server, maxSize);
+    if (count > maxValues)
+        count = maxValues;
+    UA_DataValue *values = (UA_DataValue*)UA_Array_new(count, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    if (!values)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    for (size_t i = 0; i < count; ++i) {
+        /* The timestamp of an interval is its boundary closer to startTime */
+        UA_DateTime offset = (UA_DateTime)(skip + i) * interval;
+        UA_DateTime intervalStart, intervalEnd, timestamp;
+        if (!reverse) {
+            intervalStart = start + offset;
+            intervalEnd = (end - intervalStart > interval) ? intervalStart + interval : end;
+            timestamp = intervalStart;
+        } else {
+            intervalEnd = start - offset;
+            intervalStart = (intervalEnd - end > interval) ? intervalEnd - interval : end;
+            timestamp = intervalEnd;
+        }
+        UA_StatusCode retval =
+            processInterval_service_default(backend, server, sessionId, sessionContext, nodeId,
+                                            aggregate, intervalStart, intervalEnd,
+                                            &timestamp, &values[i]);
+        if (retval != UA_STATUSCODE_GOOD) {
+            UA_Array_delete(values, count, &UA_TYPES[UA_TYPES_DATAVALUE]);
+            return retval;
+        }
+        if (timestampsToReturn == UA_TIMESTAMPSTORETURN_SOURCE ||
+            timestampsToReturn == UA_TIMESTAMPSTORETURN_BOTH) {
+            values[i].hasSourceTimestamp = true;
+            values[i].sourceTimestamp = timestamp;
+        }
+        if (timestampsToReturn == UA_TIMESTAMPSTORETURN_SERVER ||
+            timestampsToReturn == UA_TIMESTAMPSTORETURN_BOTH) {
+            values[i].hasServerTimestamp = true;
+            values[i].serverTimestamp = timestamp;
+        }
+    }
+
+    if (skip + count < intervals) {
+        if (UA_ByteString_allocBuffer(outContinuationPoint, sizeof(size_t)) != UA_STATUSCODE_GOOD) {
+            UA_Array_delete(values, count, &UA_TYPES[UA_TYPES_DATAVALUE]);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        size_t next = skip + count;
+        memcpy(outContinuationPoint->data, &next, sizeof(size_t));
+    }
+    *result = values;
+    *resultSize = count;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+readProcessed_service_default(UA_Server *server,
+                              void *context,
+                              const UA_NodeId *sessionId,
+                              void *sessionContext,
+                              const UA_RequestHeader *requestHeader,
+                              const UA_ReadProcessedDetails *historyReadDetails,
+                              UA_TimestampsToReturn timestampsToReturn,
+                              UA_Boolean releaseContinuationPoints,
+                              size_t nodesToReadSize,
+                              const UA_HistoryReadValueId *nodesToRead,
+                              UA_HistoryReadResponse *response,
+                              UA_HistoryData * const * const historyData)
+{
+    UA_HistoryDatabaseContext_default *ctx = (UA_HistoryDatabaseContext_default*)context;
+    for (size_t i = 0; i < nodesToReadSize; ++i) {
+        const UA_HistorizingNodeIdSettings *setting =
+            getSetting_service_default(server, ctx, &nodesToRead[i].nodeId,
+                                       &response->results[i].statusCode);
+        if (!setting)
+            continue;
+
+        /* The aggregates are computed with the low level API */
+        const UA_HistoryDataBackend *backend = &setting->historizingBackend;
+        if (!backend->getDataValue) {
+            response->results[i].statusCode = UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
+            continue;
+        }
+
+        const UA_NodeId *aggregate = &historyReadDetails->aggregateType[i];
+        if (!aggregateSupported_service_default(aggregate)) {
+            response->results[i].statusCode = UA_STATUSCODE_BADAGGREGATENOTSUPPORTED;
+            continue;
+        }
+
+        /* Nothing is kept for a continuation point */
+        if (releaseContinuationPoints)
+            continue;
+
+        if (backend->lock)
+            backend->lock(server, backend->context);
+        response->results[i].statusCode = getProcessedData_service_default(
+                    backend,
+                    server,
+                    sessionId,
+                    sessionContext,
+                    &nodesToRead[i].nodeId,
+                    historyReadDetails,
+                    aggregate->identifier.numeric,
+                    setting->maxHistoryDataResponseSize,
+                    timestampsToReturn,
+                    &nodesToRead[i].continuationPoint,
+                    &response->results[i].continuationPoint,
+                    &historyData[i]->dataValuesSize,
+                    &historyData[i]->dataValues);
+        if (backend->unlock)
+            backend->unlock(server, backend->context);
+    }
+    response->responseHeader.serviceResult = UA_STATUSCODE_GOOD;
+}
+
 static void
 setValue_service_default(UA_Server *server,
                          void *context,
@@ -447,12 +1187,14 @@ UA_HistoryDatabase
 UA_HistoryDatabase_default(UA_HistoryDataGathering gathering)
 {
     UA_HistoryDatabase hdb;
+    memset(&hdb, 0, sizeof(UA_HistoryDatabase));
     UA_HistoryDatabaseContext_default *context =
             (UA_HistoryDatabaseContext_default*)
             UA_calloc(1, sizeof(UA_HistoryDatabaseContext_default));
     context->gathering = gathering;
     hdb.context = context;
     hdb.readRaw = &readRaw_service_default;
+    hdb.readProcessed = &readProcessed_service_default;
     hdb.setValue = &setValue_service_default;
     hdb.deleteMembers = &deleteMembers_service_default;
     return hdb;
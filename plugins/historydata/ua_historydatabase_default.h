@@ -14,6 +14,20 @@
 
 _UA_BEGIN_DECLS
 
+/* The default HistoryDatabase reads raw and processed historical data from
+ * the backends of the gathering. The following aggregates are computed for
+ * ReadProcessed: Interpolative, Average, TimeAverage, Total, Minimum, Maximum,
+ * MinimumActualTime, MaximumActualTime, Range, Count, Start, End, Delta and
+ * the sample and population variants of StandardDeviation and Variance.
+ *
+ * Only samples with a Good status and a numeric scalar value are used.
+ * Interpolative, TimeAverage and Total interpolate linearly between the
+ * samples. The AggregateConfiguration of the request is not evaluated.
+ *
+ * A ReadProcessed response holds at most 10000 intervals. The limit is lowered
+ * by the maxHistoryDataResponseSize of the node, the maxReturnDataValues of the
+ * server and the maximum message size of the network layers. The remaining
+ * intervals are returned with a continuation point. */
 UA_HistoryDatabase UA_EXPORT
 UA_HistoryDatabase_default(UA_HistoryDataGathering gathering);
 
@@ -0,0 +1,378 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ua_historydatasummary.h"
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+# define UA_SUMMARY_SSE2
+# include <emmintrin.h>
+# if defined(__AVX__)
+#  define UA_SUMMARY_AVX
+#  include <immintrin.h>
+# endif
+#endif
+
+/* Number of samples that are collected before the kernels run */
+#define UA_SUMMARY_CHUNKSIZE 256
+
+/***********/
+/* Kernels */
+/***********/
+
+/* The kernels work on contiguous arrays of values (and times in seconds
+ * relative to the first sample). They use independent accumulators, so that
+ * the result can differ from a sequential loop by rounding. */
+
+static UA_Double
+sum_summary(const UA_Double *v, size_t n) {
+    size_t i = 0;
+    UA_Double s = 0.0;
+#if defined(UA_SUMMARY_AVX)
+    __m256d a0 = _mm256_setzero_pd();
+    __m256d a1 = _mm256_setzero_pd();
+    for(; i + 8 <= n; i += 8) {
+        a0 = _mm256_add_pd(a0, _mm256_loadu_pd(&v[i]));
+        a1 = _mm256_add_pd(a1, _mm256_loadu_pd(&v[i+4]));
+    }
+    UA_Double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(a0, a1));
+    s = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(UA_SUMMARY_SSE2)
+    __m128d a0 = _mm_setzero_pd();
+    __m128d a1 = _mm_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+        a0 = _mm_add_pd(a0, _mm_loadu_pd(&v[i]));
+        a1 = _mm_add_pd(a1, _mm_loadu_pd(&v[i+2]));
+    }
+    UA_Double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(a0, a1));
+    s = lanes[0] + lanes[1];
+#else
+    UA_Double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for(; i + 4 <= n; i += 4) {
+        s0 += v[i];
+        s1 += v[i+1];
+        s2 += v[i+2];
+        s3 += v[i+3];
+    }
+    s = (s0 + s1) + (s2 + s3);
+#endif
+    for(; i < n; ++i)
+        s += v[i];
+    return s;
+}
+
+/* Sum of the squared deviations from the mean */
+static UA_Double
+squaredDeviation_summary(const UA_Double *v, size_t n, UA_Double mean) {
+    size_t i = 0;
+    UA_Double s = 0.0;
+#if defined(UA_SUMMARY_AVX)
+    __m256d m = _mm256_set1_pd(mean);
+    __m256d a0 = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(&v[i]), m);
+        a0 = _mm256_add_pd(a0, _mm256_mul_pd(d, d));
+    }
+    UA_Double lanes[4];
+    _mm256_storeu_pd(lanes, a0);
+    s = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(UA_SUMMARY_SSE2)
+    __m128d m = _mm_set1_pd(mean);
+    __m128d a0 = _mm_setzero_pd();
+    for(; i + 2 <= n; i += 2) {
+        __m128d d = _mm_sub_pd(_mm_loadu_pd(&v[i]), m);
+        a0 = _mm_add_pd(a0, _mm_mul_pd(d, d));
+    }
+    UA_Double lanes[2];
+    _mm_storeu_pd(lanes, a0);
+    s = lanes[0] + lanes[1];
+#endif
+    for(; i < n; ++i) {
+        UA_Double d = v[i] - mean;
+        s += d * d;
+    }
+    return s;
+}
+
+static void
+minMax_summary(const UA_Double *v, size_t n, UA_Double *min, UA_Double *max) {
+    size_t i = 0;
+    UA_Double mn = v[0];
+    UA_Double mx = v[0];
+#if defined(UA_SUMMARY_AVX)
+    if(n >= 4) {
+        __m256d vmin = _mm256_loadu_pd(v);
+        __m256d vmax = vmin;
+        for(i = 4; i + 4 <= n; i += 4) {
+            __m256d x = _mm256_loadu_pd(&v[i]);
+            vmin = _mm256_min_pd(vmin, x);
+            vmax = _mm256_max_pd(vmax, x);
+        }
+        UA_Double lanes[4];
+        _mm256_storeu_pd(lanes, vmin);
+        for(size_t j = 0; j < 4; ++j)
+            mn = (lanes[j] < mn) ? lanes[j] : mn;
+        _mm256_storeu_pd(lanes, vmax);
+        for(size_t j = 0; j < 4; ++j)
+            mx = (lanes[j] > mx) ? lanes[j] : mx;
+    }
+#elif defined(UA_SUMMARY_SSE2)
+    if(n >= 2) {
+        __m128d vmin = _mm_loadu_pd(v);
+        __m128d vmax = vmin;
+        for(i = 2; i + 2 <= n; i += 2) {
+            __m128d x = _mm_loadu_pd(&v[i]);
+            vmin = _mm_min_pd(vmin, x);
+            vmax = _mm_max_pd(vmax, x);
+        }
+        UA_Double lanes[2];
+        _mm_storeu_pd(lanes, vmin);
+        mn = (lanes[0] < lanes[1]) ? lanes[0] : lanes[1];
+        _mm_storeu_pd(lanes, vmax);
+        mx = (lanes[0] > lanes[1]) ? lanes[0] : lanes[1];
+    }
+#endif
+    for(; i < n; ++i) {
+        mn = (v[i] < mn) ? v[i] : mn;
+        mx = (v[i] > mx) ? v[i] : mx;
+    }
+    *min = mn;
+    *max = mx;
+}
+
+/* Twice the area of the trapezoids between consecutive samples */
+static UA_Double
+doubleArea_summary(const UA_Double *v, const UA_Double *t, size_t n) {
+    size_t i = 0;
+    UA_Double s = 0.0;
+#if defined(UA_SUMMARY_AVX)
+    __m256d a0 = _mm256_setzero_pd();
+    for(; i + 5 <= n; i += 4) {
+        __m256d h = _mm256_add_pd(_mm256_loadu_pd(&v[i]), _mm256_loadu_pd(&v[i+1]));
+        __m256d w = _mm256_sub_pd(_mm256_loadu_pd(&t[i+1]), _mm256_loadu_pd(&t[i]));
+        a0 = _mm256_add_pd(a0, _mm256_mul_pd(h, w));
+    }
+    UA_Double lanes[4];
+    _mm256_storeu_pd(lanes, a0);
+    s = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(UA_SUMMARY_SSE2)
+    __m128d a0 = _mm_setzero_pd();
+    for(; i + 3 <= n; i += 2) {
+        __m128d h = _mm_add_pd(_mm_loadu_pd(&v[i]), _mm_loadu_pd(&v[i+1]));
+        __m128d w = _mm_sub_pd(_mm_loadu_pd(&t[i+1]), _mm_loadu_pd(&t[i]));
+        a0 = _mm_add_pd(a0, _mm_mul_pd(h, w));
+    }
+    UA_Double lanes[2];
+    _mm_storeu_pd(lanes, a0);
+    s = lanes[0] + lanes[1];
+#endif
+    for(; i + 1 < n; ++i)
+        s += (v[i] + v[i+1]) * (t[i+1] - t[i]);
+    return s;
+}
+
+/*************/
+/* Summaries */
+/*************/
+
+void
+UA_HistoryDataSummary_init(UA_HistoryDataSummary *summary) {
+    memset(summary, 0, sizeof(UA_HistoryDataSummary));
+}
+
+void
+UA_HistoryDataSummary_merge(UA_HistoryDataSummary *summary,
+                            const UA_HistoryDataSummary *next) {
+    if(next->count == 0)
+        return;
+    if(summary->count == 0) {
+        *summary = *next;
+        return;
+    }
+
+    /* Combine the squared deviations of both parts (Chan et al.) */
+    UA_Double n1 = (UA_Double)summary->count;
+    UA_Double n2 = (UA_Double)next->count;
+    UA_Double delta = next->sum / n2 - summary->sum / n1;
+    summary->m2 += next->m2 + delta * delta * (n1 * n2 / (n1 + n2));
+    summary->sum += next->sum;
+    summary->count += next->count;
+
+    if(next->min < summary->min) {
+        summary->min = next->min;
+        summary->minTime = next->minTime;
+    }
+    if(next->max > summary->max) {
+        summary->max = next->max;
+        summary->maxTime = next->maxTime;
+    }
+
+    /* Connect the last sample with the first sample of the next part */
+    summary->area += next->area + (summary->last + next->first) * 0.5 *
+        ((UA_Double)(next->firstTime - summary->lastTime) / UA_DATETIME_SEC);
+    summary->last = next->last;
+    summary->lastTime = next->lastTime;
+}
+
+UA_Boolean
+UA_HistoryDataSummary_sample(const UA_DataValue *value, UA_DateTime *time,
+                             UA_Double *v) {
+    if(!value->hasValue || !UA_Variant_isScalar(&value->value))
+        return false;
+    if(value->hasStatus && (value->status >> 30) != 0)
+        return false;
+
+    const UA_DataType *type = value->value.type;
+    if(type->typeIndex >= UA_TYPES_COUNT || type != &UA_TYPES[type->typeIndex])
+        return false;
+    const void *data = value->value.data;
+    switch(type->typeIndex) {
+    case UA_TYPES_BOOLEAN: *v = *(const UA_Boolean*)data ? 1.0 : 0.0; break;
+    case UA_TYPES_SBYTE: *v = (UA_Double)*(const UA_SByte*)data; break;
+    case UA_TYPES_BYTE: *v = (UA_Double)*(const UA_Byte*)data; break;
+    case UA_TYPES_INT16: *v = (UA_Double)*(const UA_Int16*)data; break;
+    case UA_TYPES_UINT16: *v = (UA_Double)*(const UA_UInt16*)data; break;
+    case UA_TYPES_INT32: *v = (UA_Double)*(const UA_Int32*)data; break;
+    case UA_TYPES_UINT32: *v = (UA_Double)*(const UA_UInt32*)data; break;
+    case UA_TYPES_INT64: *v = (UA_Double)*(const UA_Int64*)data; break;
+    case UA_TYPES_UINT64: *v = (UA_Double)*(const UA_UInt64*)data; break;
+    case UA_TYPES_FLOAT: *v = (UA_Double)*(const UA_Float*)data; break;
+    case UA_TYPES_DOUBLE: *v = *(const UA_Double*)data; break;
+    default: return false;
+    }
+
+    if(value->hasSourceTimestamp)
+        *time = value->sourceTimestamp;
+    else if(value->hasServerTimestamp)
+        *time = value->serverTimestamp;
+    else
+        return false;
+    return true;
+}
+
+typedef struct {
+    size_t count;
+    UA_DateTime base;
+    UA_Double values[UA_SUMMARY_CHUNKSIZE];
+    UA_Double times[UA_SUMMARY_CHUNKSIZE]; /* Seconds after base */
+    UA_DateTime timestamps[UA_SUMMARY_CHUNKSIZE];
+} UA_HistoryDataSummaryChunk;
+
+static void
+flushChunk_summary(UA_HistoryDataSummaryChunk *chunk, UA_HistoryDataSummary *summary) {
+    size_t n = chunk->count;
+    if(n == 0)
+        return;
+    const UA_Double *v = chunk->values;
+
+    UA_HistoryDataSummary s;
+    s.count = n;
+    s.sum = sum_summary(v, n);
+    s.m2 = squaredDeviation_summary(v, n, s.sum / (UA_Double)n);
+    minMax_summary(v, n, &s.min, &s.max);
+    s.minTime = chunk->timestamps[0];
+    s.maxTime = chunk->timestamps[0];
+    size_t i = 0;
+    for(; i < n; ++i) {
+        if(v[i] == s.min) {
+            s.minTime = chunk->timestamps[i];
+            break;
+        }
+    }
+    for(i = 0; i < n; ++i) {
+        if(v[i] == s.max) {
+            s.maxTime = chunk->timestamps[i];
+            break;
+        }
+    }
+    s.first = v[0];
+    s.firstTime = chunk->timestamps[0];
+    s.last = v[n-1];
+    s.lastTime = chunk->timestamps[n-1];
+    s.area = doubleArea_summary(v, chunk->times, n) * 0.5;
+
+    UA_HistoryDataSummary_merge(summary, &s);
+    chunk->count = 0;
+}
+
+static UA_DateTime
+sampleTime_summary(const UA_DataValue *value) {
+    if(value->hasSourceTimestamp)
+        return value->sourceTimestamp;
+    return value->serverTimestamp;
+}
+
+UA_StatusCode
+UA_HistoryDataSummary_read(UA_Server *server,
+                           const UA_NodeId *sessionId,
+                           void *sessionContext,
+                           const UA_HistoryDataBackend *backend,
+                           const UA_NodeId *nodeId,
+                           UA_DateTime start,
+                           UA_DateTime end,
+                           UA_HistoryDataSummary *summary) {
+    UA_HistoryDataSummary_init(summary);
+    if(!backend->getDataValue || !backend->getDateTimeMatch || !backend->getEnd)
+        return UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
+    if(end <= start)
+        return UA_STATUSCODE_GOOD;
+
+    size_t storeEnd = backend->getEnd(server, backend->context, sessionId,
+                                      sessionContext, nodeId);
+    if(storeEnd == 0)
+        return UA_STATUSCODE_GOOD;
+    size_t firstIndex = backend->firstIndex(server, backend->context, sessionId,
+                                            sessionContext, nodeId);
+    size_t first = backend->getDateTimeMatch(server, backend->context, sessionId,
+                                             sessionContext, nodeId, start,
+                                             MATCH_EQUAL_OR_AFTER);
+    size_t last = backend->getDateTimeMatch(server, backend->context, sessionId,
+                                            sessionContext, nodeId, end,
+                                            MATCH_BEFORE);
+    if(first == storeEnd || last == storeEnd || last < first)
+        return UA_STATUSCODE_GOOD;
+
+    /* The match can be any of several samples with the same timestamp */
+    while(first > firstIndex) {
+        const UA_DataValue *dv = backend->getDataValue(server, backend->context, sessionId,
+                                                       sessionContext, nodeId, first - 1);
+        if(!dv || sampleTime_summary(dv) < start)
+            break;
+        --first;
+    }
+    while(last + 1 < storeEnd) {
+        const UA_DataValue *dv = backend->getDataValue(server, backend->context, sessionId,
+                                                       sessionContext, nodeId, last + 1);
+        if(!dv || sampleTime_summary(dv) >= end)
+            break;
+        ++last;
+    }
+
+    UA_HistoryDataSummaryChunk *chunk = (UA_HistoryDataSummaryChunk*)
+        UA_malloc(sizeof(UA_HistoryDataSummaryChunk));
+    if(!chunk)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    chunk->count = 0;
+    for(size_t i = first; i <= last; ++i) {
+        const UA_DataValue *dv = backend->getDataValue(server, backend->context, sessionId,
+                                                       sessionContext, nodeId, i);
+        UA_DateTime time;
+        UA_Double v;
+        if(!dv || !UA_HistoryDataSummary_sample(dv, &time, &v))
+            continue;
+        if(chunk->count == 0)
+            chunk->base = time;
+        chunk->values[chunk->count] = v;
+        chunk->times[chunk->count] = (UA_Double)(time - chunk->base) / UA_DATETIME_SEC;
+        chunk->timestamps[chunk->count] = time;
+        if(++chunk->count == UA_SUMMARY_CHUNKSIZE)
+            flushChunk_summary(chunk, summary);
+    }
+    flushChunk_summary(chunk, summary);
+    UA_free(chunk);
+    return UA_STATUSCODE_GOOD;
+}
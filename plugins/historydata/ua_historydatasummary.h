@@ -0,0 +1,48 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UA_HISTORYDATASUMMARY_H_
+#define UA_HISTORYDATASUMMARY_H_
+
+#include "ua_plugin_history_data_backend.h"
+
+_UA_BEGIN_DECLS
+
+/* Helper functions for UA_HistoryDataSummary. The summaries of consecutive
+ * time ranges can be merged. So a backend can maintain the summaries of fixed
+ * time buckets and combine them for any time range. */
+
+void UA_EXPORT
+UA_HistoryDataSummary_init(UA_HistoryDataSummary *summary);
+
+/* Adds the summary of a time range that follows the time range of summary */
+void UA_EXPORT
+UA_HistoryDataSummary_merge(UA_HistoryDataSummary *summary,
+                            const UA_HistoryDataSummary *next);
+
+/* Returns true if the sample is summarized (Good status and a numeric scalar
+ * value). The time is the source timestamp or the server timestamp if the
+ * source timestamp is not set. */
+UA_Boolean UA_EXPORT
+UA_HistoryDataSummary_sample(const UA_DataValue *value, UA_DateTime *time,
+                             UA_Double *v);
+
+/* Summarizes the samples in [start, end) with the low level API of the
+ * backend. The values are collected in arrays and processed with SIMD
+ * instructions if the compiler targets SSE2 or AVX. The getSummary function
+ * of the backend is not used. */
+UA_StatusCode UA_EXPORT
+UA_HistoryDataSummary_read(UA_Server *server,
+                           const UA_NodeId *sessionId,
+                           void *sessionContext,
+                           const UA_HistoryDataBackend *backend,
+                           const UA_NodeId *nodeId,
+                           UA_DateTime start,
+                           UA_DateTime end,
+                           UA_HistoryDataSummary *summary);
+
+_UA_END_DECLS
+
+#endif /* UA_HISTORYDATASUMMARY_H_ */
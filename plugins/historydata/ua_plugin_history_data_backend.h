@@ -25,6 +25,39 @@ typedef enum {
                              that is earlier in time from the provided timestamp. */
 } MatchStrategy;
 
+/* Summary of the samples of a node within a time range. Only samples with a
+ * Good status and a numeric scalar value are summarized. */
+typedef struct {
+    size_t count;          /* Number of samples */
+    UA_Double sum;
+    UA_Double m2;          /* Sum of the squared deviations from the mean */
+    UA_Double min;
+    UA_DateTime minTime;   /* First occurrence of the minimum */
+    UA_Double max;
+    UA_DateTime maxTime;   /* First occurrence of the maximum */
+    UA_Double first;
+    UA_DateTime firstTime;
+    UA_Double last;
+    UA_DateTime lastTime;
+    UA_Double area;        /* Integral of the linear interpolation between the
+                              first and the last sample in value * seconds */
+} UA_HistoryDataSummary;
+
+/* Position of a reader in the samples of a node. The backend defines the
+ * meaning of the fields. The cursor is stored in continuation points, so it
+ * must not point to memory. */
+typedef struct {
+    UA_UInt64 position;
+    UA_UInt64 generation;  /* Changes when the positions become invalid */
+    UA_DateTime timestamp; /* Used to find the position again */
+} UA_HistoryDataCursor;
+
+/* Receives the samples read with a cursor. The value points into the storage
+ * of the backend and is only valid during the call. Return false to stop the
+ * reading. The sample is then not consumed. */
+typedef UA_Boolean
+(*UA_HistoryDataCursorCallback)(void *callbackContext, const UA_DataValue *value);
+
 typedef struct UA_HistoryDataBackend UA_HistoryDataBackend;
 
 struct UA_HistoryDataBackend {
@@ -255,6 +288,90 @@ struct UA_HistoryDataBackend {
                                    void *sessionContext,
                                    const UA_NodeId *nodeId,
                                    const UA_TimestampsToReturn timestampsToReturn);
+
+    /* This function is optional. It summarizes the samples of a node with a
+     * source timestamp within [start, end). Backends that maintain precomputed
+     * summaries use it to answer ReadProcessed requests without reading every
+     * sample. If it is NULL, the samples are read with the low level API.
+     *
+     * server is the server the node lives in.
+     * hdbContext is the context of the UA_HistoryDataBackend.
+     * sessionId and sessionContext identify the session that wants to read historical data.
+     * nodeId is the node id of the node that shall be summarized.
+     * start and end limit the time range.
+     * summary is the summary of the samples in the time range. */
+    UA_StatusCode
+    (*getSummary)(UA_Server *server,
+                  void *hdbContext,
+                  const UA_NodeId *sessionId,
+                  void *sessionContext,
+                  const UA_NodeId *nodeId,
+                  UA_DateTime start,
+                  UA_DateTime end,
+                  UA_HistoryDataSummary *summary);
+
+    /* These functions are optional. The history database calls lock before it
+     * reads a node with the getHistoryData, getSummary or low level API and
+     * unlock afterwards. Backends that are written from another thread use
+     * them to keep the indices and the values returned by getDataValue stable
+     * in between.
+     *
+     * server is the server the node lives in.
+     * hdbContext is the context of the UA_HistoryDataBackend. */
+    void
+    (*lock)(UA_Server *server,
+            void *hdbContext);
+
+    void
+    (*unlock)(UA_Server *server,
+              void *hdbContext);
+
+    /* These functions are optional and extend the low level API. If both are
+     * set, the history database streams the samples of a ReadRaw request from
+     * the storage into the response and stores the cursor in the continuation
+     * point. A continuation then resumes without searching the samples again.
+     *
+     * getCursor returns a cursor to the sample at index.
+     *
+     * readCursor passes up to maxValues consecutive samples to the callback,
+     * beginning with the sample at the cursor and going back in time if
+     * reverse is set. Afterwards the cursor points to the next sample that was
+     * not consumed. Samples that are inserted or removed behind the cursor
+     * must not move it. If the position of the cursor became invalid (e.g.
+     * because a sample was inserted in front of it), the backend finds the
+     * next sample with the timestamp of the cursor.
+     *
+     * server is the server the node lives in.
+     * hdbContext is the context of the UA_HistoryDataBackend.
+     * sessionId and sessionContext identify the session that wants to read historical data.
+     * nodeId is the node id of the node that is read.
+     * index is the index of the sample the cursor shall point to.
+     * cursor is the position of the reader.
+     * reverse determines if the samples are read in reverse order.
+     * maxValues is the maximal number of samples passed to the callback.
+     * callback and callbackContext receive the samples.
+     * providedValues contains the number of consumed samples. */
+    UA_StatusCode
+    (*getCursor)(UA_Server *server,
+                 void *hdbContext,
+                 const UA_NodeId *sessionId,
+                 void *sessionContext,
+                 const UA_NodeId *nodeId,
+                 size_t index,
+                 UA_HistoryDataCursor *cursor);
+
+    UA_StatusCode
+    (*readCursor)(UA_Server *server,
+                  void *hdbContext,
+                  const UA_NodeId *sessionId,
+                  void *sessionContext,
+                  const UA_NodeId *nodeId,
+                  UA_HistoryDataCursor *cursor,
+                  UA_Boolean reverse,
+                  size_t maxValues,
+                  UA_HistoryDataCursorCallback callback,
+                  void *callbackContext,
+                  size_t *providedValues);
 };
 
 _UA_END_DECLS
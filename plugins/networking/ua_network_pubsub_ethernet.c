@@ -11,14 +11,33 @@
 
 #include <netinet/ether.h>
 #include <linux/if_packet.h>
+#include <sys/mman.h>
 
 #include "ua_network_pubsub_ethernet.h"
-#include "ua_util_internal.h"
 
 #ifndef ETHERTYPE_UADP
 #define ETHERTYPE_UADP  0xb62c
 #endif
 
+#define UA_ETH_VLANTAG_LEN 4
+
+/* Geometry of the PACKET_MMAP rings. The RX and the TX ring have the same
+ * size. The block size must be a multiple of the page size. */
+#ifndef UA_ETH_RING_BLOCKSIZE
+# define UA_ETH_RING_BLOCKSIZE (1 << 16)
+#endif
+#ifndef UA_ETH_RING_BLOCKNR
+# define UA_ETH_RING_BLOCKNR 16
+#endif
+#define UA_ETH_RING_FRAMESIZE 2048
+/* Milliseconds until a partially filled RX block is handed to userspace */
+#define UA_ETH_RING_RETIRETIMEOUT 1
+
+/* Offset of the frame data in a TX ring slot. Same as TPACKET3_HDRLEN -
+ * sizeof(struct sockaddr_ll) without the sign conversion in TPACKET_ALIGN. */
+#define UA_ETH_RING_TXDATA \
+    ((sizeof(struct tpacket3_hdr) + TPACKET_ALIGNMENT - 1) & ~(size_t)(TPACKET_ALIGNMENT - 1))
+
 /* Ethernet network layer specific internal data */
 typedef struct {
     int ifindex;
@@ -26,6 +45,15 @@ typedef struct {
     UA_Byte prio;
     UA_Byte ifAddress[ETH_ALEN];
     UA_Byte targetAddress[ETH_ALEN];
+
+    /* TPACKET_V3 rings mapped into memory. NULL if the plain socket is used.
+     * The RX ring is followed by the TX ring. */
+    UA_Byte *ring;
+    size_t ringSize;
+    size_t rxBlock;                  /* Next RX block to read */
+    struct tpacket3_hdr *rxPacket;   /* Next packet in the RX block or NULL */
+    UA_UInt32 rxPacketsLeft;
+    size_t txFrame;                  /* Next TX frame to write */
 } UA_PubSubChannelDataEthernet;
 
 /*
@@ -69,7 +97,52 @@ UA_parseHardwareAddress(UA_String* target, UA_Byte* destinationMac) {
 }
 
 /**
- * Open communication socket based on the connectionConfig.
+ * Set up the TPACKET_V3 RX and TX rings and map them into memory. Frames are
+ * then exchanged with the kernel through the shared memory. Only one system
+ * call is needed to send a batch of frames and none for receiving frames from
+ * a filled block.
+ *
+ * @return UA_STATUSCODE_GOOD on success
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_openRings(int sockFd, UA_PubSubChannelDataEthernet *channelDataEthernet) {
+    int version = TPACKET_V3;
+    if(UA_setsockopt(sockFd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    /* Discard malformed frames in the TX ring instead of blocking the ring */
+    int loss = 1;
+    if(UA_setsockopt(sockFd, SOL_PACKET, PACKET_LOSS, &loss, sizeof(loss)) < 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = UA_ETH_RING_BLOCKSIZE;
+    req.tp_block_nr = UA_ETH_RING_BLOCKNR;
+    req.tp_frame_size = UA_ETH_RING_FRAMESIZE;
+    req.tp_frame_nr = (UA_ETH_RING_BLOCKSIZE / UA_ETH_RING_FRAMESIZE) * UA_ETH_RING_BLOCKNR;
+    req.tp_retire_blk_tov = UA_ETH_RING_RETIRETIMEOUT;
+    if(UA_setsockopt(sockFd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    /* The TX ring is frame-based and takes no block options */
+    req.tp_retire_blk_tov = 0;
+    if(UA_setsockopt(sockFd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    size_t ringSize = 2 * (size_t)UA_ETH_RING_BLOCKSIZE * UA_ETH_RING_BLOCKNR;
+    void *ring = mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, sockFd, 0);
+    if(ring == MAP_FAILED)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    channelDataEthernet->ring = (UA_Byte*)ring;
+    channelDataEthernet->ringSize = ringSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * Open communication socket based on the connectionConfig. Protocol specific
+ * parameters are provided within the connectionConfig as KeyValuePair.
+ * Currently supported options: "packetmmap" (use TPACKET_V3 rings)
  *
  * @return ref to created channel, NULL on error
  */
@@ -122,6 +195,20 @@ UA_PubSubChannelEthernet_open(const UA_PubSubConnectionConfig *connectionConfig)
         return NULL;
     }
 
+    /* iterate over the given KeyValuePair parameters */
+    UA_Boolean packetMmap = false;
+    UA_String packetMmapParam = UA_STRING("packetmmap");
+    for(size_t i = 0; i < connectionConfig->connectionPropertiesSize; i++) {
+        UA_KeyValuePair *property = &connectionConfig->connectionProperties[i];
+        if(UA_String_equal(&property->key.name, &packetMmapParam)) {
+            if(UA_Variant_hasScalarType(&property->value, &UA_TYPES[UA_TYPES_BOOLEAN]))
+                packetMmap = *(UA_Boolean*)property->value.data;
+        } else {
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                           "PubSub Connection creation. Unknown connection parameter.");
+        }
+    }
+
     /* generate a new Pub/Sub channel and open a related socket */
     UA_PubSubChannel *newChannel = (UA_PubSubChannel*)UA_calloc(1, sizeof(UA_PubSubChannel));
     if(!newChannel) {
@@ -156,8 +243,10 @@ UA_PubSubChannelEthernet_open(const UA_PubSubConnectionConfig *connectionConfig)
     /* get interface index */
     struct ifreq ifreq;
     memset(&ifreq, 0, sizeof(struct ifreq));
-    strncpy(ifreq.ifr_name, (char*)address->networkInterface.data,
-            UA_MIN(address->networkInterface.length, sizeof(ifreq.ifr_name)-1));
+    size_t ifNameLen = address->networkInterface.length;
+    if(ifNameLen > sizeof(ifreq.ifr_name) - 1)
+        ifNameLen = sizeof(ifreq.ifr_name) - 1;
+    strncpy(ifreq.ifr_name, (char*)address->networkInterface.data, ifNameLen);
 
     if(ioctl(sockFd, SIOCGIFINDEX, &ifreq) < 0) {
         UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
@@ -180,6 +269,18 @@ UA_PubSubChannelEthernet_open(const UA_PubSubConnectionConfig *connectionConfig)
     }
     memcpy(channelDataEthernet->ifAddress, &ifreq.ifr_hwaddr.sa_data, ETH_ALEN);
 
+    /* map the rings before the socket is bound to receive frames */
+    if(packetMmap &&
+       UA_PubSubChannelEthernet_openRings(sockFd, channelDataEthernet) != UA_STATUSCODE_GOOD) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+            "PubSub connection creation failed. Cannot set up the packet rings. %s",
+            strerror(errno));
+        UA_close(sockFd);
+        UA_free(channelDataEthernet);
+        UA_free(newChannel);
+        return NULL;
+    }
+
     /* bind the socket to interface and ethertype */
     struct sockaddr_ll sll = { 0 };
     sll.sll_family = AF_PACKET;
@@ -189,6 +290,8 @@ UA_PubSubChannelEthernet_open(const UA_PubSubConnectionConfig *connectionConfig)
     if(UA_bind(sockFd, (struct sockaddr*)&sll, sizeof(sll)) < 0) {
         UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
             "PubSub connection creation failed. Cannot bind socket.");
+        if(channelDataEthernet->ring)
+            munmap(channelDataEthernet->ring, channelDataEthernet->ringSize);
         UA_close(sockFd);
         UA_free(channelDataEthernet);
         UA_free(newChannel);
@@ -276,26 +379,14 @@ UA_PubSubChannelEthernet_unregist(UA_PubSubChannel *channel,
 }
 
 /**
- * Send messages to the connection defined address
+ * Write the ethernet header (with the VLAN tag if configured) for a frame to
+ * the connection defined address.
  *
- * @return UA_STATUSCODE_GOOD if success
+ * @return length of the header
  */
-static UA_StatusCode
-UA_PubSubChannelEthernet_send(UA_PubSubChannel *channel,
-                              UA_ExtensionObject *transportSettings,
-                              const UA_ByteString *buf) {
-    UA_PubSubChannelDataEthernet *channelDataEthernet =
-        (UA_PubSubChannelDataEthernet *) channel->handle;
-
-    /* Allocate a buffer for the ethernet data which contains the ethernet
-     * header (without VLAN tag), the VLAN tag and the OPC-UA/Ethernet data. */
-    char *bufSend, *ptrCur;
-    size_t lenBuf;
-    struct ether_header* ethHdr;
-
-    lenBuf = sizeof(*ethHdr) + 4 + buf->length;
-    bufSend = (char*) UA_malloc(lenBuf);
-    ethHdr = (struct ether_header*) bufSend;
+static size_t
+writeEthernetHeader(UA_PubSubChannelDataEthernet *channelDataEthernet, UA_Byte *buf) {
+    struct ether_header* ethHdr = (struct ether_header*) buf;
 
     /* Set (own) source MAC address */
     memcpy(ethHdr->ether_shost, channelDataEthernet->ifAddress, ETH_ALEN);
@@ -305,27 +396,50 @@ UA_PubSubChannelEthernet_send(UA_PubSubChannel *channel,
 
     /* Set ethertype */
     /* Either VLAN or Ethernet */
-    ptrCur = bufSend + sizeof(*ethHdr);
     if(channelDataEthernet->vid == 0) {
         ethHdr->ether_type = htons(ETHERTYPE_UADP);
-        lenBuf -= 4;  /* no VLAN tag */
-    } else {
-        ethHdr->ether_type = htons(ETHERTYPE_VLAN);
-        /* set VLAN ID */
-        UA_UInt16 vlanTag;
-        vlanTag = (UA_UInt16) (channelDataEthernet->vid + (channelDataEthernet->prio << 13));
-        *((UA_UInt16 *) ptrCur) = htons(vlanTag);
-        ptrCur += sizeof(UA_UInt16);
-        /* set Ethernet */
-        *((UA_UInt16 *) ptrCur) = htons(ETHERTYPE_UADP);
-        ptrCur += sizeof(UA_UInt16);
+        return sizeof(*ethHdr);
     }
 
+    ethHdr->ether_type = htons(ETHERTYPE_VLAN);
+    UA_Byte *ptrCur = buf + sizeof(*ethHdr);
+    /* set VLAN ID */
+    UA_UInt16 vlanTag;
+    vlanTag = (UA_UInt16) (channelDataEthernet->vid + (channelDataEthernet->prio << 13));
+    vlanTag = htons(vlanTag);
+    memcpy(ptrCur, &vlanTag, sizeof(UA_UInt16));
+    ptrCur += sizeof(UA_UInt16);
+    /* set Ethernet */
+    UA_UInt16 etherType = htons(ETHERTYPE_UADP);
+    memcpy(ptrCur, &etherType, sizeof(UA_UInt16));
+    return sizeof(*ethHdr) + UA_ETH_VLANTAG_LEN;
+}
+
+/**
+ * Send messages to the connection defined address
+ *
+ * @return UA_STATUSCODE_GOOD if success
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_send(UA_PubSubChannel *channel,
+                              UA_ExtensionObject *transportSettings,
+                              const UA_ByteString *buf) {
+    UA_PubSubChannelDataEthernet *channelDataEthernet =
+        (UA_PubSubChannelDataEthernet *) channel->handle;
+
+    /* Allocate a buffer for the ethernet data which contains the ethernet
+     * header (without VLAN tag), the VLAN tag and the OPC-UA/Ethernet data. */
+    size_t lenBuf = sizeof(struct ether_header) + UA_ETH_VLANTAG_LEN + buf->length;
+    UA_Byte *bufSend = (UA_Byte*) UA_malloc(lenBuf);
+    if(!bufSend)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    size_t lenHdr = writeEthernetHeader(channelDataEthernet, bufSend);
+
     /* copy payload of ethernet message */
-    memcpy(ptrCur, buf->data, buf->length);
+    memcpy(&bufSend[lenHdr], buf->data, buf->length);
 
     ssize_t rc;
-    rc = UA_send(channel->sockfd, bufSend, lenBuf, 0);
+    rc = UA_send(channel->sockfd, (char*)bufSend, lenHdr + buf->length, 0);
     if(rc  < 0) {
         UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
             "PubSub connection send failed. Send message failed.");
@@ -337,6 +451,76 @@ UA_PubSubChannelEthernet_send(UA_PubSubChannel *channel,
     return UA_STATUSCODE_GOOD;
 }
 
+static struct tpacket3_hdr *
+txRingFrame(UA_PubSubChannelDataEthernet *channelDataEthernet, size_t frame) {
+    return (struct tpacket3_hdr*)&channelDataEthernet->ring[channelDataEthernet->ringSize / 2 +
+                                                              frame * UA_ETH_RING_FRAMESIZE];
+}
+
+/**
+ * Write the messages into the TX ring and notify the kernel once. If the ring
+ * is full, the kernel is notified and we wait until the frames are sent.
+ *
+ * @return UA_STATUSCODE_GOOD if all messages were handed to the kernel
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_sendBatchRing(UA_PubSubChannel *channel,
+                                       UA_ExtensionObject *transportSettings,
+                                       const UA_ByteString *bufs, size_t bufsSize) {
+    UA_PubSubChannelDataEthernet *channelDataEthernet =
+        (UA_PubSubChannelDataEthernet *) channel->handle;
+    const size_t frameNr = (channelDataEthernet->ringSize / 2) / UA_ETH_RING_FRAMESIZE;
+    const size_t maxFrameLen = UA_ETH_RING_FRAMESIZE - UA_ETH_RING_TXDATA;
+
+    for(size_t i = 0; i < bufsSize; i++) {
+        size_t lenHdr = sizeof(struct ether_header);
+        if(channelDataEthernet->vid != 0)
+            lenHdr += UA_ETH_VLANTAG_LEN;
+        if(lenHdr + bufs[i].length > maxFrameLen) {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                "PubSub connection send failed. Message too large for the packet ring.");
+            return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+        }
+
+        /* Wait until the kernel has sent out the frame in this slot */
+        struct tpacket3_hdr *hdr = txRingFrame(channelDataEthernet, channelDataEthernet->txFrame);
+        if(hdr->tp_status != TP_STATUS_AVAILABLE) {
+            if(UA_send(channel->sockfd, NULL, 0, 0) < 0 ||
+               hdr->tp_status != TP_STATUS_AVAILABLE) {
+                UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                    "PubSub connection send failed. The packet ring is full.");
+                return UA_STATUSCODE_BADINTERNALERROR;
+            }
+        }
+
+        /* Write the frame into the ring */
+        UA_Byte *frame = (UA_Byte*)hdr + UA_ETH_RING_TXDATA;
+        writeEthernetHeader(channelDataEthernet, frame);
+        memcpy(&frame[lenHdr], bufs[i].data, bufs[i].length);
+        hdr->tp_len = (UA_UInt32)(lenHdr + bufs[i].length);
+        hdr->tp_next_offset = 0;
+        __sync_synchronize();
+        hdr->tp_status = TP_STATUS_SEND_REQUEST;
+        channelDataEthernet->txFrame = (channelDataEthernet->txFrame + 1) % frameNr;
+    }
+
+    /* Hand all written frames to the kernel at once */
+    if(UA_send(channel->sockfd, NULL, 0, MSG_DONTWAIT) < 0 &&
+       errno != EAGAIN && errno != EWOULDBLOCK) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+            "PubSub connection send failed. Send message failed.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+UA_PubSubChannelEthernet_sendRing(UA_PubSubChannel *channel,
+                                  UA_ExtensionObject *transportSettings,
+                                  const UA_ByteString *buf) {
+    return UA_PubSubChannelEthernet_sendBatchRing(channel, transportSettings, buf, 1);
+}
+
 /**
  * Receive messages.
  *
@@ -405,6 +589,91 @@ UA_PubSubChannelEthernet_receive(UA_PubSubChannel *channel, UA_ByteString *messa
     return UA_STATUSCODE_GOOD;
 }
 
+static struct tpacket_block_desc *
+rxRingBlock(UA_PubSubChannelDataEthernet *channelDataEthernet, size_t block) {
+    return (struct tpacket_block_desc*)
+        &channelDataEthernet->ring[block * UA_ETH_RING_BLOCKSIZE];
+}
+
+/**
+ * Receive messages from the RX ring. The packets of a block are read in order.
+ * The block is returned to the kernel after its last packet was read.
+ *
+ * @param timeout in usec -> wait for a filled block, or block if 0
+ * @return
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_receiveRing(UA_PubSubChannel *channel, UA_ByteString *message,
+                                     UA_ExtensionObject *transportSettings, UA_UInt32 timeout) {
+    UA_PubSubChannelDataEthernet *channelDataEthernet =
+        (UA_PubSubChannelDataEthernet *) channel->handle;
+    const size_t blockNr = (channelDataEthernet->ringSize / 2) / UA_ETH_RING_BLOCKSIZE;
+
+    /* Wait until the kernel hands over the next block */
+    struct tpacket_block_desc *block =
+        rxRingBlock(channelDataEthernet, channelDataEthernet->rxBlock);
+    if(!(block->hdr.bh1.block_status & TP_STATUS_USER)) {
+        fd_set fdset;
+        FD_ZERO(&fdset);
+        UA_fd_set(channel->sockfd, &fdset);
+        struct timeval tmptv = {(long int)(timeout / 1000000),
+                                (long int)(timeout % 1000000)};
+        int resultsize = UA_select(channel->sockfd+1, &fdset, NULL, NULL,
+                                   timeout > 0 ? &tmptv : NULL);
+        if(resultsize == -1) {
+            message->length = 0;
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        if(resultsize == 0 || !(block->hdr.bh1.block_status & TP_STATUS_USER)) {
+            message->length = 0;
+            return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+        }
+    }
+    __sync_synchronize();
+
+    if(!channelDataEthernet->rxPacket) {
+        channelDataEthernet->rxPacket = (struct tpacket3_hdr*)
+            ((UA_Byte*)block + block->hdr.bh1.offset_to_first_pkt);
+        channelDataEthernet->rxPacketsLeft = block->hdr.bh1.num_pkts;
+    }
+
+    /* Take the next packet that matches our target */
+    UA_StatusCode retval = UA_STATUSCODE_GOODNODATA;
+    while(channelDataEthernet->rxPacketsLeft > 0 && retval != UA_STATUSCODE_GOOD) {
+        struct tpacket3_hdr *packet = channelDataEthernet->rxPacket;
+        UA_Byte *frame = (UA_Byte*)packet + packet->tp_mac;
+        size_t frameLen = packet->tp_snaplen;
+        channelDataEthernet->rxPacket = (struct tpacket3_hdr*)
+            ((UA_Byte*)packet + packet->tp_next_offset);
+        channelDataEthernet->rxPacketsLeft--;
+
+        struct ether_header *ethHdr = (struct ether_header*)frame;
+        if(frameLen < sizeof(*ethHdr) ||
+           memcmp(ethHdr->ether_dhost, channelDataEthernet->targetAddress, ETH_ALEN) != 0)
+            continue;
+
+        /* The VLAN tag is usually stripped into tp_vlan_tci */
+        size_t lenHdr = sizeof(*ethHdr);
+        if(ethHdr->ether_type == htons(ETHERTYPE_VLAN))
+            lenHdr += UA_ETH_VLANTAG_LEN;
+        if(frameLen < lenHdr || frameLen - lenHdr > message->length)
+            continue;
+
+        message->length = frameLen - lenHdr;
+        memcpy(message->data, &frame[lenHdr], message->length);
+        retval = UA_STATUSCODE_GOOD;
+    }
+
+    /* Return the block to the kernel */
+    if(channelDataEthernet->rxPacketsLeft == 0) {
+        channelDataEthernet->rxPacket = NULL;
+        __sync_synchronize();
+        block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        channelDataEthernet->rxBlock = (channelDataEthernet->rxBlock + 1) % blockNr;
+    }
+    return retval;
+}
+
 /**
  * Close channel and free the channel data.
  *
@@ -412,6 +681,10 @@ UA_PubSubChannelEthernet_receive(UA_PubSubChannel *channel, UA_ByteString *messa
  */
 static UA_StatusCode
 UA_PubSubChannelEthernet_close(UA_PubSubChannel *channel) {
+    UA_PubSubChannelDataEthernet *channelDataEthernet =
+        (UA_PubSubChannelDataEthernet *) channel->handle;
+    if(channelDataEthernet->ring)
+        munmap(channelDataEthernet->ring, channelDataEthernet->ringSize);
     UA_close(channel->sockfd);
     UA_free(channel->handle);
     UA_free(channel);
@@ -431,8 +704,16 @@ TransportLayerEthernet_addChannel(UA_PubSubConnectionConfig *connectionConfig) {
     if(pubSubChannel) {
         pubSubChannel->regist = UA_PubSubChannelEthernet_regist;
         pubSubChannel->unregist = UA_PubSubChannelEthernet_unregist;
-        pubSubChannel->send = UA_PubSubChannelEthernet_send;
-        pubSubChannel->receive = UA_PubSubChannelEthernet_receive;
+        UA_PubSubChannelDataEthernet *channelDataEthernet =
+            (UA_PubSubChannelDataEthernet *) pubSubChannel->handle;
+        if(channelDataEthernet->ring) {
+            pubSubChannel->send = UA_PubSubChannelEthernet_sendRing;
+            pubSubChannel->sendBatch = UA_PubSubChannelEthernet_sendBatchRing;
+            pubSubChannel->receive = UA_PubSubChannelEthernet_receiveRing;
+        } else {
+            pubSubChannel->send = UA_PubSubChannelEthernet_send;
+            pubSubChannel->receive = UA_PubSubChannelEthernet_receive;
+        }
         pubSubChannel->close = UA_PubSubChannelEthernet_close;
         pubSubChannel->connectionConfig = connectionConfig;
     }
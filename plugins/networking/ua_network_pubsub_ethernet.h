@@ -11,6 +11,9 @@
 
 _UA_BEGIN_DECLS
 
+/* Connections of the Ethernet transport layer accept the connection property
+ * "packetmmap" (Boolean). If set, frames are exchanged with the kernel through
+ * memory-mapped TPACKET_V3 rings instead of a system call per frame. */
 UA_PubSubTransportLayer UA_EXPORT
 UA_PubSubTransportLayerEthernet(void);
 
@@ -11,6 +11,16 @@
 #include "ua_util.h"
 #include "ua_log_stdout.h"
 
+#ifdef __linux__
+# include <sys/syscall.h>
+# ifdef SYS_sendmmsg
+#  define UA_PUBSUB_UDPMC_SENDMMSG
+# endif
+# ifdef SYS_recvmmsg
+#  define UA_PUBSUB_UDPMC_RECVMMSG
+# endif
+#endif
+
 //UDP multicast network layer specific internal data
 typedef struct {
     int ai_family;                        //Protocol family for socket.  IPv4/IPv6
@@ -358,6 +368,65 @@ UA_PubSubChannelUDPMC_send(UA_PubSubChannel *channel, UA_ExtensionObject *transp
     return UA_STATUSCODE_GOOD;
 }
 
+#if defined(UA_PUBSUB_UDPMC_SENDMMSG) || defined(UA_PUBSUB_UDPMC_RECVMMSG)
+/* Maximum number of messages handed to the kernel with one sendmmsg or
+ * recvmmsg call */
+#define UA_PUBSUB_UDPMC_MAXBATCH 64
+
+/* Layout of struct mmsghdr. The libc declares it only with _GNU_SOURCE. */
+typedef struct {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+} UA_PubSubMMsgHdr;
+#endif
+
+#ifdef UA_PUBSUB_UDPMC_SENDMMSG
+
+/**
+ * Send several messages with one system call per UA_PUBSUB_UDPMC_MAXBATCH
+ * messages. The message buffers are not copied.
+ *
+ * @return UA_STATUSCODE_GOOD if all messages were sent
+ */
+static UA_StatusCode
+UA_PubSubChannelUDPMC_sendBatch(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettigns,
+                                const UA_ByteString *bufs, size_t bufsSize) {
+    UA_PubSubChannelDataUDPMC *channelConfigUDPMC = (UA_PubSubChannelDataUDPMC *) channel->handle;
+    if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_PUB_SUB)){
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed. Invalid state.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    UA_PubSubMMsgHdr msgs[UA_PUBSUB_UDPMC_MAXBATCH];
+    struct iovec iovs[UA_PUBSUB_UDPMC_MAXBATCH];
+    size_t sent = 0;
+    while(sent < bufsSize) {
+        unsigned int batchSize = UA_PUBSUB_UDPMC_MAXBATCH;
+        if(bufsSize - sent < UA_PUBSUB_UDPMC_MAXBATCH)
+            batchSize = (unsigned int)(bufsSize - sent);
+        memset(msgs, 0, sizeof(UA_PubSubMMsgHdr) * batchSize);
+        for(unsigned int i = 0; i < batchSize; i++) {
+            iovs[i].iov_base = bufs[sent + i].data;
+            iovs[i].iov_len = bufs[sent + i].length;
+            msgs[i].msg_hdr.msg_name = channelConfigUDPMC->ai_addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        /* Datagrams are sent completely or not at all. Continue after the
+         * last message the kernel accepted. */
+        long n = syscall(SYS_sendmmsg, channel->sockfd, msgs, batchSize, 0);
+        if(n < 0 && UA_ERRNO == UA_INTERRUPTED)
+            continue;
+        if(n <= 0) {
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed.");
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        sent += (size_t)n;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+#endif
+
 /**
  * Receive messages. The regist function should be called before.
  *
@@ -406,6 +475,97 @@ UA_PubSubChannelUDPMC_receive(UA_PubSubChannel *channel, UA_ByteString *message,
     return UA_STATUSCODE_GOOD;
 }
 
+#ifdef UA_PUBSUB_UDPMC_RECVMMSG
+/**
+ * Receive the queued messages with one system call per UA_PUBSUB_UDPMC_MAXBATCH
+ * messages. The regist function should be called before.
+ *
+ * @param timeout in usec to wait for the first message. Does not block if zero.
+ * @return UA_STATUSCODE_GOODNONCRITICALTIMEOUT if no message was received
+ */
+static UA_StatusCode
+UA_PubSubChannelUDPMC_receiveBatch(UA_PubSubChannel *channel, UA_ByteString *messages,
+                                   size_t *messagesSize, UA_ExtensionObject *transportSettigns,
+                                   UA_UInt32 timeout) {
+    size_t capacity = *messagesSize;
+    *messagesSize = 0;
+    if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_PUB_SUB)) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection receive failed. Invalid state.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    if(timeout > 0) {
+        fd_set fdset;
+        FD_ZERO(&fdset);
+        UA_fd_set(channel->sockfd, &fdset);
+        struct timeval tmptv = {(long int)(timeout / 1000000),
+                                (long int)(timeout % 1000000)};
+        int resultsize = UA_select(channel->sockfd+1, &fdset, NULL,
+                                NULL, &tmptv);
+        if(resultsize == 0)
+            return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+        if(resultsize == -1)
+            return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    UA_PubSubMMsgHdr msgs[UA_PUBSUB_UDPMC_MAXBATCH];
+    struct iovec iovs[UA_PUBSUB_UDPMC_MAXBATCH];
+    while(*messagesSize < capacity) {
+        unsigned int batchSize = UA_PUBSUB_UDPMC_MAXBATCH;
+        if(capacity - *messagesSize < UA_PUBSUB_UDPMC_MAXBATCH)
+            batchSize = (unsigned int)(capacity - *messagesSize);
+        UA_ByteString *bufs = &messages[*messagesSize];
+        memset(msgs, 0, sizeof(UA_PubSubMMsgHdr) * batchSize);
+        for(unsigned int i = 0; i < batchSize; i++) {
+            iovs[i].iov_base = bufs[i].data;
+            iovs[i].iov_len = bufs[i].length;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        long n = syscall(SYS_recvmmsg, channel->sockfd, msgs, batchSize,
+                         MSG_DONTWAIT, NULL);
+        if(n < 0 && UA_ERRNO == UA_INTERRUPTED)
+            continue;
+        if(n < 0 && UA_ERRNO != UA_EAGAIN && UA_ERRNO != UA_WOULDBLOCK) {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                         "PubSub Connection receive failed: %s", strerror(UA_ERRNO));
+            if(*messagesSize == 0)
+                return UA_STATUSCODE_BADINTERNALERROR;
+            break; /* Hand out the messages received so far */
+        }
+        if(n <= 0)
+            break; /* The socket queue is empty */
+
+        /* Drop messages that did not fit into the buffer. The buffers of the
+         * remaining messages are moved to the front. */
+        size_t kept = 0;
+        for(long i = 0; i < n; i++) {
+            if(msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                               "PubSub Connection dropped a message larger "
+                               "than the receive buffer of %lu bytes",
+                               (unsigned long)iovs[i].iov_len);
+                continue;
+            }
+            if(kept != (size_t)i) {
+                UA_ByteString tmp = bufs[kept];
+                bufs[kept] = bufs[i];
+                bufs[i] = tmp;
+            }
+            bufs[kept].length = msgs[i].msg_len;
+            kept++;
+        }
+        *messagesSize += kept;
+        if((unsigned int)n < batchSize)
+            break;
+    }
+
+    if(*messagesSize == 0)
+        return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+    return UA_STATUSCODE_GOOD;
+}
+#endif
+
 /**
  * Close channel and free the channel data.
  *
@@ -440,7 +600,13 @@ TransportLayerUDPMC_addChannel(UA_PubSubConnectionConfig *connectionConfig) {
         pubSubChannel->regist = UA_PubSubChannelUDPMC_regist;
         pubSubChannel->unregist = UA_PubSubChannelUDPMC_unregist;
         pubSubChannel->send = UA_PubSubChannelUDPMC_send;
+#ifdef UA_PUBSUB_UDPMC_SENDMMSG
+        pubSubChannel->sendBatch = UA_PubSubChannelUDPMC_sendBatch;
+#endif
         pubSubChannel->receive = UA_PubSubChannelUDPMC_receive;
+#ifdef UA_PUBSUB_UDPMC_RECVMMSG
+        pubSubChannel->receiveBatch = UA_PubSubChannelUDPMC_receiveBatch;
+#endif
         pubSubChannel->close = UA_PubSubChannelUDPMC_close;
         pubSubChannel->connectionConfig = connectionConfig;
     }
@@ -0,0 +1,909 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#include "ua_plugin_network.h"
+#include "ua_log_stdout.h"
+#include "ua_util.h"
+#include "open62541_queue.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <time.h>
+
+#include "ua_network_tcp_iouring.h"
+
+/* Number of entries in the submission queue */
+#ifndef UA_IOURING_ENTRIES
+# define UA_IOURING_ENTRIES 256
+#endif
+
+/* Number of provided receive buffers (power of two) */
+#ifndef UA_IOURING_RECVBUFFERS
+# define UA_IOURING_RECVBUFFERS 64
+#endif
+
+#define UA_IOURING_BUFFERGROUP 0
+#define UA_IOURING_MAXSERVERSOCKETS 16
+
+#define MAXBACKLOG     100
+#define NOHELLOTIMEOUT 120000 /* timeout in ms before close the connection
+                               * if server does not receive Hello Message */
+
+/* The operation is encoded in the lower bits of the user_data of a submission.
+ * The upper bits point to the connection or the send request. For accepts, the
+ * upper bits contain the index of the server socket. */
+#define OP_ACCEPT 0
+#define OP_RECV   1
+#define OP_SEND   2
+#define OP_CANCEL 3
+#define OP_MASK   3
+
+struct IOUringConnection;
+
+typedef struct SendRequest {
+    SIMPLEQ_ENTRY(SendRequest) next;
+    struct IOUringConnection *conn;
+    UA_ByteString buf;
+} SendRequest;
+
+typedef struct IOUringConnection {
+    UA_Connection connection;
+    LIST_ENTRY(IOUringConnection) pointers; /* In the open or closing list */
+    SLIST_ENTRY(IOUringConnection) flushPointers;
+    SIMPLEQ_HEAD(, SendRequest) sendQueue;  /* Not yet submitted */
+    size_t sendsInFlight;
+    UA_Boolean recvArmed;
+    UA_Boolean flushPending;
+} IOUringConnection;
+
+typedef struct {
+    UA_SOCKET sockfd;
+    UA_Boolean acceptArmed;
+} ServerSocket;
+
+typedef struct {
+    const UA_Logger *logger;
+    UA_UInt16 port;
+    UA_Boolean running;
+
+    /* The ring */
+    int ringfd;
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqArray;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned sqLocalTail;
+    unsigned sqToSubmit;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe *cqes;
+
+    /* Provided receive buffers */
+    struct io_uring_buf_ring *bufRing;
+    size_t bufRingSize;
+    UA_Byte *bufMemory;
+    size_t bufSize;
+    UA_UInt16 bufTail;
+
+    ServerSocket serverSockets[UA_IOURING_MAXSERVERSOCKETS];
+    size_t serverSocketsSize;
+
+    LIST_HEAD(, IOUringConnection) connections;
+    LIST_HEAD(, IOUringConnection) closing;
+    SLIST_HEAD(, IOUringConnection) flushList;
+    UA_DateTime nextHelloCheck;
+} ServerNetworkLayerIOUring;
+
+/******************/
+/* Ring Handling  */
+/******************/
+
+static int
+io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int
+io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete,
+               unsigned flags, void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete,
+                        flags, arg, argsz);
+}
+
+static int
+io_uring_register(int fd, unsigned opcode, void *arg, unsigned nrArgs) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+/* Submit the prepared entries. Optionally wait for a completion. */
+static void
+submit(ServerNetworkLayerIOUring *layer, UA_UInt16 timeout) {
+    unsigned flags = 0;
+    unsigned minComplete = 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    void *argp = NULL;
+    size_t argsz = 0;
+
+    /* Wait only if no completion is pending */
+    if(timeout > 0 &&
+       __atomic_load_n(layer->cqTail, __ATOMIC_ACQUIRE) == *layer->cqHead) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (__u64)(uintptr_t)&ts;
+        argp = &arg;
+        argsz = sizeof(arg);
+        minComplete = 1;
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    }
+
+    if(layer->sqToSubmit == 0 && minComplete == 0)
+        return;
+
+    int ret = io_uring_enter(layer->ringfd, layer->sqToSubmit,
+                             minComplete, flags, argp, argsz);
+    /* Timeouts and interrupts are expected */
+    if(ret < 0 && errno != ETIME && errno != EINTR &&
+       errno != EAGAIN && errno != EBUSY)
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                           "io_uring_enter failed with %s", errno_str));
+
+    /* The kernel advances the head for every consumed entry */
+    layer->sqToSubmit = layer->sqLocalTail -
+        __atomic_load_n(layer->sqHead, __ATOMIC_ACQUIRE);
+}
+
+static struct io_uring_sqe *
+getSqe(ServerNetworkLayerIOUring *layer) {
+    unsigned head = __atomic_load_n(layer->sqHead, __ATOMIC_ACQUIRE);
+    if(layer->sqLocalTail - head >= layer->sqEntries) {
+        /* The submission queue is full. Submit first. */
+        submit(layer, 0);
+        head = __atomic_load_n(layer->sqHead, __ATOMIC_ACQUIRE);
+        if(layer->sqLocalTail - head >= layer->sqEntries)
+            return NULL;
+    }
+    unsigned index = layer->sqLocalTail & layer->sqMask;
+    struct io_uring_sqe *sqe = &layer->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    layer->sqArray[index] = index;
+    layer->sqLocalTail++;
+    layer->sqToSubmit++;
+    __atomic_store_n(layer->sqTail, layer->sqLocalTail, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+static unsigned
+freeSqes(ServerNetworkLayerIOUring *layer) {
+    unsigned head = __atomic_load_n(layer->sqHead, __ATOMIC_ACQUIRE);
+    return layer->sqEntries - (layer->sqLocalTail - head);
+}
+
+/* Return a provided buffer to the kernel */
+static void
+recycleBuffer(ServerNetworkLayerIOUring *layer, UA_UInt16 bid) {
+    struct io_uring_buf *buf =
+        &layer->bufRing->bufs[layer->bufTail & (UA_IOURING_RECVBUFFERS - 1)];
+    buf->addr = (__u64)(uintptr_t)&layer->bufMemory[bid * layer->bufSize];
+    buf->len = (__u32)layer->bufSize;
+    buf->bid = bid;
+    layer->bufTail++;
+    __atomic_store_n(&layer->bufRing->tail, layer->bufTail, __ATOMIC_RELEASE);
+}
+
+static void
+IOUring_cleanup(ServerNetworkLayerIOUring *layer) {
+    if(layer->ringfd >= 0)
+        close(layer->ringfd);
+    layer->ringfd = -1;
+    if(layer->sqes)
+        munmap(layer->sqes, layer->sqesSize);
+    if(layer->cqRing && layer->cqRing != layer->sqRing)
+        munmap(layer->cqRing, layer->cqRingSize);
+    if(layer->sqRing)
+        munmap(layer->sqRing, layer->sqRingSize);
+    if(layer->bufRing)
+        munmap(layer->bufRing, layer->bufRingSize);
+    if(layer->bufMemory)
+        munmap(layer->bufMemory, layer->bufSize * UA_IOURING_RECVBUFFERS);
+    layer->sqes = NULL;
+    layer->cqRing = NULL;
+    layer->sqRing = NULL;
+    layer->bufRing = NULL;
+    layer->bufMemory = NULL;
+}
+
+static UA_StatusCode
+IOUring_init(ServerNetworkLayerIOUring *layer, size_t bufSize) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    layer->ringfd = io_uring_setup(UA_IOURING_ENTRIES, &p);
+    if(layer->ringfd < 0) {
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_ERROR(layer->logger, UA_LOGCATEGORY_NETWORK,
+                         "Could not set up the io_uring: %s", errno_str));
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    if(!(p.features & IORING_FEAT_SINGLE_MMAP) ||
+       !(p.features & IORING_FEAT_EXT_ARG) ||
+       !(p.features & IORING_FEAT_NODROP)) {
+        UA_LOG_ERROR(layer->logger, UA_LOGCATEGORY_NETWORK,
+                     "The kernel lacks required io_uring features");
+        IOUring_cleanup(layer);
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+    }
+
+    /* Map the submission and completion queue (single mapping) */
+    layer->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    layer->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(layer->cqRingSize > layer->sqRingSize)
+        layer->sqRingSize = layer->cqRingSize;
+    layer->cqRingSize = layer->sqRingSize;
+    layer->sqRing = mmap(NULL, layer->sqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, layer->ringfd, IORING_OFF_SQ_RING);
+    if(layer->sqRing == MAP_FAILED) {
+        layer->sqRing = NULL;
+        IOUring_cleanup(layer);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    layer->cqRing = layer->sqRing;
+
+    layer->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    layer->sqes = (struct io_uring_sqe*)
+        mmap(NULL, layer->sqesSize, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, layer->ringfd, IORING_OFF_SQES);
+    if(layer->sqes == MAP_FAILED) {
+        layer->sqes = NULL;
+        IOUring_cleanup(layer);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    UA_Byte *sq = (UA_Byte*)layer->sqRing;
+    layer->sqHead = (unsigned*)(uintptr_t)(sq + p.sq_off.head);
+    layer->sqTail = (unsigned*)(uintptr_t)(sq + p.sq_off.tail);
+    layer->sqArray = (unsigned*)(uintptr_t)(sq + p.sq_off.array);
+    layer->sqMask = *(unsigned*)(uintptr_t)(sq + p.sq_off.ring_mask);
+    layer->sqEntries = *(unsigned*)(uintptr_t)(sq + p.sq_off.ring_entries);
+    layer->sqLocalTail = *layer->sqTail;
+    layer->sqToSubmit = 0;
+
+    UA_Byte *cq = (UA_Byte*)layer->cqRing;
+    layer->cqHead = (unsigned*)(uintptr_t)(cq + p.cq_off.head);
+    layer->cqTail = (unsigned*)(uintptr_t)(cq + p.cq_off.tail);
+    layer->cqMask = *(unsigned*)(uintptr_t)(cq + p.cq_off.ring_mask);
+    layer->cqes = (struct io_uring_cqe*)(uintptr_t)(cq + p.cq_off.cqes);
+
+    /* Set up and register the ring of provided receive buffers */
+    layer->bufSize = bufSize;
+    layer->bufRingSize = UA_IOURING_RECVBUFFERS * sizeof(struct io_uring_buf);
+    layer->bufRing = (struct io_uring_buf_ring*)
+        mmap(NULL, layer->bufRingSize, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(layer->bufRing == MAP_FAILED) {
+        layer->bufRing = NULL;
+        IOUring_cleanup(layer);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    layer->bufMemory = (UA_Byte*)
+        mmap(NULL, bufSize * UA_IOURING_RECVBUFFERS, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(layer->bufMemory == MAP_FAILED) {
+        layer->bufMemory = NULL;
+        IOUring_cleanup(layer);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (__u64)(uintptr_t)layer->bufRing;
+    reg.ring_entries = UA_IOURING_RECVBUFFERS;
+    reg.bgid = UA_IOURING_BUFFERGROUP;
+    if(io_uring_register(layer->ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_ERROR(layer->logger, UA_LOGCATEGORY_NETWORK,
+                         "Could not register the io_uring receive buffers: %s",
+                         errno_str));
+        IOUring_cleanup(layer);
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+    }
+    layer->bufTail = 0;
+    for(UA_UInt16 i = 0; i < UA_IOURING_RECVBUFFERS; i++)
+        recycleBuffer(layer, i);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*************************/
+/* Submission Operations */
+/*************************/
+
+static void
+armAccept(ServerNetworkLayerIOUring *layer, size_t index) {
+    struct io_uring_sqe *sqe = getSqe(layer);
+    if(!sqe)
+        return; /* Retried in the next iteration */
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = layer->serverSockets[index].sockfd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = ((__u64)index << 2) | OP_ACCEPT;
+    layer->serverSockets[index].acceptArmed = true;
+}
+
+static void
+armRecv(ServerNetworkLayerIOUring *layer, IOUringConnection *conn) {
+    struct io_uring_sqe *sqe = getSqe(layer);
+    if(!sqe) {
+        conn->connection.close(&conn->connection);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->connection.sockfd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = UA_IOURING_BUFFERGROUP;
+    sqe->user_data = (__u64)(uintptr_t)conn | OP_RECV;
+    conn->recvArmed = true;
+}
+
+static void
+cancelOperation(ServerNetworkLayerIOUring *layer, __u64 userData) {
+    struct io_uring_sqe *sqe = getSqe(layer);
+    if(!sqe)
+        return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = OP_CANCEL;
+}
+
+/* Submit the queued sends of a connection as one chain of linked operations.
+ * The kernel executes them in order. Only one chain per connection is in
+ * flight at any time. */
+static void
+submitSendChain(ServerNetworkLayerIOUring *layer, IOUringConnection *conn) {
+    struct io_uring_sqe *last = NULL;
+    while(!SIMPLEQ_EMPTY(&conn->sendQueue)) {
+        /* Do not let the chain span several submissions */
+        if(freeSqes(layer) == 0) {
+            if(last)
+                break;
+            submit(layer, 0);
+            if(freeSqes(layer) == 0)
+                break;
+        }
+        SendRequest *req = SIMPLEQ_FIRST(&conn->sendQueue);
+        struct io_uring_sqe *sqe = getSqe(layer);
+        if(!sqe)
+            break;
+        SIMPLEQ_REMOVE_HEAD(&conn->sendQueue, next);
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn->connection.sockfd;
+        sqe->addr = (__u64)(uintptr_t)req->buf.data;
+        sqe->len = (__u32)req->buf.length;
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->user_data = (__u64)(uintptr_t)req | OP_SEND;
+        if(last)
+            last->flags |= IOSQE_IO_LINK;
+        last = sqe;
+        conn->sendsInFlight++;
+    }
+}
+
+static void
+flushSends(ServerNetworkLayerIOUring *layer) {
+    while(!SLIST_EMPTY(&layer->flushList)) {
+        IOUringConnection *conn = SLIST_FIRST(&layer->flushList);
+        SLIST_REMOVE_HEAD(&layer->flushList, flushPointers);
+        conn->flushPending = false;
+        if(conn->connection.state != UA_CONNECTION_CLOSED &&
+           conn->sendsInFlight == 0)
+            submitSendChain(layer, conn);
+    }
+}
+
+static void
+scheduleFlush(ServerNetworkLayerIOUring *layer, IOUringConnection *conn) {
+    if(conn->flushPending || conn->sendsInFlight > 0 ||
+       SIMPLEQ_EMPTY(&conn->sendQueue))
+        return;
+    conn->flushPending = true;
+    SLIST_INSERT_HEAD(&layer->flushList, conn, flushPointers);
+}
+
+/************************/
+/* Connection Callbacks */
+/************************/
+
+static UA_StatusCode
+IOUring_getSendBuffer(UA_Connection *connection, size_t length, UA_ByteString *buf) {
+    if(length > connection->config.sendBufferSize)
+        return UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    return UA_ByteString_allocBuffer(buf, length);
+}
+
+static void
+IOUring_releaseBuffer(UA_Connection *connection, UA_ByteString *buf) {
+    UA_ByteString_deleteMembers(buf);
+}
+
+/* The buffer is handed over to the send request and freed upon completion */
+static UA_StatusCode
+IOUring_send(UA_Connection *connection, UA_ByteString *buf) {
+    if(connection->state == UA_CONNECTION_CLOSED) {
+        UA_ByteString_deleteMembers(buf);
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    }
+    SendRequest *req = (SendRequest*)UA_malloc(sizeof(SendRequest));
+    if(!req) {
+        UA_ByteString_deleteMembers(buf);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    IOUringConnection *conn = (IOUringConnection*)connection;
+    req->conn = conn;
+    req->buf = *buf;
+    *buf = UA_BYTESTRING_NULL;
+    SIMPLEQ_INSERT_TAIL(&conn->sendQueue, req, next);
+    scheduleFlush((ServerNetworkLayerIOUring*)connection->handle, conn);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* This performs only 'shutdown'. The connection is removed once all pending
+ * operations have completed. */
+static void
+IOUring_close(UA_Connection *connection) {
+    if(connection->state == UA_CONNECTION_CLOSED)
+        return;
+    ServerNetworkLayerIOUring *layer = (ServerNetworkLayerIOUring*)connection->handle;
+    IOUringConnection *conn = (IOUringConnection*)connection;
+    shutdown(connection->sockfd, SHUT_RDWR);
+    connection->state = UA_CONNECTION_CLOSED;
+    if(conn->recvArmed)
+        cancelOperation(layer, (__u64)(uintptr_t)conn | OP_RECV);
+    LIST_REMOVE(conn, pointers);
+    LIST_INSERT_HEAD(&layer->closing, conn, pointers);
+}
+
+static void
+IOUring_freeConnection(UA_Connection *connection) {
+    IOUringConnection *conn = (IOUringConnection*)connection;
+    SendRequest *req, *req_tmp;
+    SIMPLEQ_FOREACH_SAFE(req, &conn->sendQueue, next, req_tmp) {
+        UA_ByteString_deleteMembers(&req->buf);
+        UA_free(req);
+    }
+    UA_Connection_deleteMembers(connection);
+    UA_free(conn);
+}
+
+static void
+addConnection(ServerNetworkLayerIOUring *layer, UA_ServerNetworkLayer *nl,
+              UA_SOCKET newsockfd) {
+    /* Do not merge packets on the socket (disable Nagle's algorithm) */
+    int dummy = 1;
+    if(UA_setsockopt(newsockfd, IPPROTO_TCP, TCP_NODELAY,
+                     (const char *)&dummy, sizeof(dummy)) < 0) {
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_ERROR(layer->logger, UA_LOGCATEGORY_NETWORK,
+                         "Cannot set socket option TCP_NODELAY. Error: %s",
+                         errno_str));
+        UA_close(newsockfd);
+        return;
+    }
+
+    IOUringConnection *conn = (IOUringConnection*)UA_calloc(1, sizeof(IOUringConnection));
+    if(!conn) {
+        UA_close(newsockfd);
+        return;
+    }
+
+    UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                "Connection %i | New connection over TCP (io_uring)",
+                (int)newsockfd);
+
+    UA_Connection *c = &conn->connection;
+    c->sockfd = newsockfd;
+    c->handle = layer;
+    c->config = nl->localConnectionConfig;
+    c->send = IOUring_send;
+    c->close = IOUring_close;
+    c->free = IOUring_freeConnection;
+    c->getSendBuffer = IOUring_getSendBuffer;
+    c->releaseSendBuffer = IOUring_releaseBuffer;
+    c->releaseRecvBuffer = IOUring_releaseBuffer;
+    c->state = UA_CONNECTION_OPENING;
+    c->openingDate = UA_DateTime_nowMonotonic();
+    SIMPLEQ_INIT(&conn->sendQueue);
+
+    LIST_INSERT_HEAD(&layer->connections, conn, pointers);
+    armRecv(layer, conn);
+}
+
+/* Remove closed connections without pending operations */
+static void
+reapClosedConnections(ServerNetworkLayerIOUring *layer, UA_Server *server) {
+    IOUringConnection *conn, *conn_tmp;
+    LIST_FOREACH_SAFE(conn, &layer->closing, pointers, conn_tmp) {
+        if(conn->recvArmed || conn->sendsInFlight > 0 || conn->flushPending)
+            continue;
+        UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                    "Connection %i | Closed", (int)conn->connection.sockfd);
+        LIST_REMOVE(conn, pointers);
+        UA_close(conn->connection.sockfd);
+        UA_Server_removeConnection(server, &conn->connection);
+    }
+}
+
+/**************************/
+/* Completion Processing */
+/**************************/
+
+static void
+processRecv(ServerNetworkLayerIOUring *layer, UA_Server *server,
+            IOUringConnection *conn, const struct io_uring_cqe *cqe) {
+    UA_Connection *c = &conn->connection;
+    if(cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+        UA_UInt16 bid = (UA_UInt16)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        UA_ByteString msg;
+        msg.data = &layer->bufMemory[bid * layer->bufSize];
+        msg.length = (size_t)cqe->res;
+        if(c->state != UA_CONNECTION_CLOSED) {
+            if(c->incompleteChunk.length == 0) {
+                /* Process directly from the provided buffer */
+                UA_Server_processBinaryMessage(server, c, &msg);
+            } else {
+                /* Prepend the last incomplete chunk */
+                UA_ByteString full;
+                if(UA_ByteString_allocBuffer(&full, c->incompleteChunk.length +
+                                             msg.length) == UA_STATUSCODE_GOOD) {
+                    memcpy(full.data, c->incompleteChunk.data, c->incompleteChunk.length);
+                    memcpy(&full.data[c->incompleteChunk.length], msg.data, msg.length);
+                    UA_ByteString_deleteMembers(&c->incompleteChunk);
+                    UA_Server_processBinaryMessage(server, c, &full);
+                    UA_ByteString_deleteMembers(&full);
+                } else {
+                    c->close(c);
+                }
+            }
+        }
+        recycleBuffer(layer, bid);
+    } else if(cqe->res == 0) {
+        /* The remote side closed the connection */
+        c->close(c);
+    } else if(cqe->res != -ENOBUFS) {
+        c->close(c);
+    }
+
+    /* The multishot receive has terminated. Rearm unless closed. With ENOBUFS,
+     * all buffers were in use. They have been recycled in the meantime. */
+    if(!(cqe->flags & IORING_CQE_F_MORE)) {
+        conn->recvArmed = false;
+        if(c->state != UA_CONNECTION_CLOSED)
+            armRecv(layer, conn);
+    }
+}
+
+static void
+processSend(ServerNetworkLayerIOUring *layer, SendRequest *req,
+            const struct io_uring_cqe *cqe) {
+    IOUringConnection *conn = req->conn;
+    conn->sendsInFlight--;
+
+    /* With MSG_WAITALL, a short send only happens for errors. A failed send
+     * cancels the subsequent sends in the chain (-ECANCELED). */
+    if(cqe->res < 0 || (size_t)cqe->res < req->buf.length)
+        conn->connection.close(&conn->connection);
+
+    UA_ByteString_deleteMembers(&req->buf);
+    UA_free(req);
+
+    if(conn->connection.state != UA_CONNECTION_CLOSED)
+        scheduleFlush(layer, conn);
+}
+
+static void
+processAccept(ServerNetworkLayerIOUring *layer, UA_ServerNetworkLayer *nl,
+              size_t index, const struct io_uring_cqe *cqe) {
+    if(cqe->res >= 0) {
+        if(layer->running)
+            addConnection(layer, nl, (UA_SOCKET)cqe->res);
+        else
+            UA_close((UA_SOCKET)cqe->res);
+    } else if(layer->running && cqe->res != -ECANCELED) {
+        UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                       "Accept on server socket %i failed with %s",
+                       (int)layer->serverSockets[index].sockfd, strerror(-cqe->res));
+    }
+
+    if(!(cqe->flags & IORING_CQE_F_MORE)) {
+        layer->serverSockets[index].acceptArmed = false;
+        if(layer->running)
+            armAccept(layer, index);
+    }
+}
+
+static void
+processCompletions(UA_ServerNetworkLayer *nl, UA_Server *server) {
+    ServerNetworkLayerIOUring *layer = (ServerNetworkLayerIOUring*)nl->handle;
+    unsigned head = *layer->cqHead;
+    while(head != __atomic_load_n(layer->cqTail, __ATOMIC_ACQUIRE)) {
+        /* Copy the entry and release the slot before processing */
+        struct io_uring_cqe cqe = layer->cqes[head & layer->cqMask];
+        head++;
+        __atomic_store_n(layer->cqHead, head, __ATOMIC_RELEASE);
+
+        void *ptr = (void*)(uintptr_t)(cqe.user_data & ~(__u64)OP_MASK);
+        switch(cqe.user_data & OP_MASK) {
+        case OP_ACCEPT:
+            processAccept(layer, nl, (size_t)(cqe.user_data >> 2), &cqe);
+            break;
+        case OP_RECV:
+            processRecv(layer, server, (IOUringConnection*)ptr, &cqe);
+            break;
+        case OP_SEND:
+            processSend(layer, (SendRequest*)ptr, &cqe);
+            break;
+        default:
+            break; /* Cancel operations */
+        }
+    }
+}
+
+/*****************/
+/* Network Layer */
+/*****************/
+
+static void
+addServerSocket(ServerNetworkLayerIOUring *layer, struct addrinfo *ai) {
+    UA_SOCKET newsock = UA_socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if(newsock == UA_INVALID_SOCKET) {
+        UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                       "Error opening the server socket");
+        return;
+    }
+
+    int optval = 1;
+    if(ai->ai_family == AF_INET6 &&
+       UA_setsockopt(newsock, IPPROTO_IPV6, IPV6_V6ONLY,
+                     (const char*)&optval, sizeof(optval)) == -1) {
+        UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                       "Could not set an IPv6 socket to IPv6 only");
+        UA_close(newsock);
+        return;
+    }
+    if(UA_setsockopt(newsock, SOL_SOCKET, SO_REUSEADDR,
+                     (const char *)&optval, sizeof(optval)) == -1) {
+        UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                       "Could not make the socket reusable");
+        UA_close(newsock);
+        return;
+    }
+
+    if(UA_bind(newsock, ai->ai_addr, (socklen_t)ai->ai_addrlen) < 0) {
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                           "Error binding a server socket: %s", errno_str));
+        UA_close(newsock);
+        return;
+    }
+
+    if(UA_listen(newsock, MAXBACKLOG) < 0) {
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                           "Error listening on server socket: %s", errno_str));
+        UA_close(newsock);
+        return;
+    }
+
+    layer->serverSockets[layer->serverSocketsSize].sockfd = newsock;
+    layer->serverSockets[layer->serverSocketsSize].acceptArmed = false;
+    layer->serverSocketsSize++;
+}
+
+static UA_StatusCode
+ServerNetworkLayerIOUring_start(UA_ServerNetworkLayer *nl,
+                                const UA_String *customHostname) {
+    UA_initialize_architecture_network();
+
+    ServerNetworkLayerIOUring *layer = (ServerNetworkLayerIOUring*)nl->handle;
+
+    /* Every provided buffer can hold a full chunk */
+    UA_StatusCode retval =
+        IOUring_init(layer, nl->localConnectionConfig.recvBufferSize);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* Get the discovery url from the hostname */
+    UA_String du = UA_STRING_NULL;
+    char discoveryUrlBuffer[256];
+    char hostnameBuffer[256];
+    if(customHostname->length) {
+        du.length = (size_t)UA_snprintf(discoveryUrlBuffer, 255, "opc.tcp://%.*s:%d/",
+                                        (int)customHostname->length,
+                                        customHostname->data, layer->port);
+        du.data = (UA_Byte*)discoveryUrlBuffer;
+    } else if(UA_gethostname(hostnameBuffer, 255) == 0) {
+        du.length = (size_t)UA_snprintf(discoveryUrlBuffer, 255, "opc.tcp://%s:%d/",
+                                        hostnameBuffer, layer->port);
+        du.data = (UA_Byte*)discoveryUrlBuffer;
+    } else {
+        UA_LOG_ERROR(layer->logger, UA_LOGCATEGORY_NETWORK, "Could not get the hostname");
+    }
+    UA_String_copy(&du, &nl->discoveryUrl);
+
+    /* Get addrinfo of the server and create server sockets */
+    char portno[6];
+    UA_snprintf(portno, 6, "%d", layer->port);
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    hints.ai_protocol = IPPROTO_TCP;
+    if(UA_getaddrinfo(NULL, portno, &hints, &res) != 0) {
+        IOUring_cleanup(layer);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    struct addrinfo *ai = res;
+    for(layer->serverSocketsSize = 0;
+        layer->serverSocketsSize < UA_IOURING_MAXSERVERSOCKETS && ai != NULL;
+        ai = ai->ai_next)
+        addServerSocket(layer, ai);
+    UA_freeaddrinfo(res);
+
+    /* Arm the multishot accepts */
+    layer->running = true;
+    for(size_t i = 0; i < layer->serverSocketsSize; i++)
+        armAccept(layer, i);
+    submit(layer, 0);
+
+    UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                "TCP network layer (io_uring) listening on %.*s",
+                (int)nl->discoveryUrl.length, nl->discoveryUrl.data);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+ServerNetworkLayerIOUring_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
+                                 UA_UInt16 timeout) {
+    ServerNetworkLayerIOUring *layer = (ServerNetworkLayerIOUring*)nl->handle;
+    if(layer->ringfd < 0)
+        return UA_STATUSCODE_GOOD;
+
+    /* Submit everything prepared since the last iteration and wait for
+     * completions. Then process all completions in a batch. */
+    flushSends(layer);
+    submit(layer, timeout);
+    processCompletions(nl, server);
+
+    /* Close connections that did not send a Hello message. Checked once per
+     * second to not traverse all connections in every iteration. */
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    if(now >= layer->nextHelloCheck) {
+        layer->nextHelloCheck = now + UA_DATETIME_SEC;
+        IOUringConnection *conn, *conn_tmp;
+        LIST_FOREACH_SAFE(conn, &layer->connections, pointers, conn_tmp) {
+            if(conn->connection.state == UA_CONNECTION_OPENING &&
+               now > conn->connection.openingDate + (NOHELLOTIMEOUT * UA_DATETIME_MSEC)) {
+                UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                            "Connection %i | Closed by the server (no Hello Message)",
+                            (int)conn->connection.sockfd);
+                conn->connection.close(&conn->connection);
+            }
+        }
+    }
+
+    /* Send out the responses generated during processing right away */
+    flushSends(layer);
+    submit(layer, 0);
+
+    reapClosedConnections(layer, server);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_Boolean
+hasPendingOperations(ServerNetworkLayerIOUring *layer) {
+    if(!LIST_EMPTY(&layer->connections) || !LIST_EMPTY(&layer->closing))
+        return true;
+    for(size_t i = 0; i < layer->serverSocketsSize; i++) {
+        if(layer->serverSockets[i].acceptArmed)
+            return true;
+    }
+    return false;
+}
+
+static void
+ServerNetworkLayerIOUring_stop(UA_ServerNetworkLayer *nl, UA_Server *server) {
+    ServerNetworkLayerIOUring *layer = (ServerNetworkLayerIOUring*)nl->handle;
+    UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                "Shutting down the TCP network layer (io_uring)");
+    if(layer->ringfd < 0)
+        return;
+
+    /* Stop accepting and close the open connections */
+    layer->running = false;
+    for(size_t i = 0; i < layer->serverSocketsSize; i++) {
+        UA_shutdown(layer->serverSockets[i].sockfd, 2);
+        if(layer->serverSockets[i].acceptArmed)
+            cancelOperation(layer, ((__u64)i << 2) | OP_ACCEPT);
+    }
+    IOUringConnection *conn, *conn_tmp;
+    LIST_FOREACH_SAFE(conn, &layer->connections, pointers, conn_tmp)
+        conn->connection.close(&conn->connection);
+
+    /* Process the completions until all operations have terminated */
+    for(size_t i = 0; i < 100 && hasPendingOperations(layer); i++)
+        ServerNetworkLayerIOUring_listen(nl, server, 10);
+
+    for(size_t i = 0; i < layer->serverSocketsSize; i++)
+        UA_close(layer->serverSockets[i].sockfd);
+    layer->serverSocketsSize = 0;
+
+    UA_deinitialize_architecture_network();
+}
+
+/* run only when the server is stopped */
+static void
+ServerNetworkLayerIOUring_deleteMembers(UA_ServerNetworkLayer *nl) {
+    ServerNetworkLayerIOUring *layer = (ServerNetworkLayerIOUring*)nl->handle;
+    UA_String_deleteMembers(&nl->discoveryUrl);
+
+    /* Closing the ring terminates the remaining operations. Then hard-close and
+     * remove remaining connections. */
+    IOUring_cleanup(layer);
+    IOUringConnection *conn, *conn_tmp;
+    LIST_FOREACH_SAFE(conn, &layer->connections, pointers, conn_tmp) {
+        LIST_REMOVE(conn, pointers);
+        UA_close(conn->connection.sockfd);
+        IOUring_freeConnection(&conn->connection);
+    }
+    LIST_FOREACH_SAFE(conn, &layer->closing, pointers, conn_tmp) {
+        LIST_REMOVE(conn, pointers);
+        UA_close(conn->connection.sockfd);
+        IOUring_freeConnection(&conn->connection);
+    }
+
+    UA_free(layer);
+}
+
+UA_ServerNetworkLayer
+UA_ServerNetworkLayerIOUring(UA_ConnectionConfig config, UA_UInt16 port,
+                             const UA_Logger *logger) {
+    UA_ServerNetworkLayer nl;
+    memset(&nl, 0, sizeof(UA_ServerNetworkLayer));
+    nl.deleteMembers = ServerNetworkLayerIOUring_deleteMembers;
+    nl.localConnectionConfig = config;
+    nl.start = ServerNetworkLayerIOUring_start;
+    nl.listen = ServerNetworkLayerIOUring_listen;
+    nl.stop = ServerNetworkLayerIOUring_stop;
+    nl.handle = NULL;
+
+    ServerNetworkLayerIOUring *layer = (ServerNetworkLayerIOUring*)
+        UA_calloc(1, sizeof(ServerNetworkLayerIOUring));
+    if(!layer)
+        return nl;
+    nl.handle = layer;
+
+    layer->logger = logger;
+    layer->port = port;
+    layer->ringfd = -1;
+    LIST_INIT(&layer->connections);
+    LIST_INIT(&layer->closing);
+    SLIST_INIT(&layer->flushList);
+    return nl;
+}
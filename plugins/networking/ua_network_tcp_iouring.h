@@ -0,0 +1,26 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#ifndef UA_NETWORK_TCP_IOURING_H_
+#define UA_NETWORK_TCP_IOURING_H_
+
+#include "ua_server.h"
+#include "ua_plugin_log.h"
+
+_UA_BEGIN_DECLS
+
+/* A TCP server network layer for Linux (kernel >= 6.0) based on io_uring.
+ * Accepts and receives are multishot operations that stay armed. Received data
+ * is placed into a ring of provided buffers by the kernel. Outgoing chunks of a
+ * connection are submitted as linked send operations. All completions of one
+ * listen iteration are processed in a batch with a single system call.
+ *
+ * The network layer can be used in place of UA_ServerNetworkLayerTCP. */
+UA_ServerNetworkLayer UA_EXPORT
+UA_ServerNetworkLayerIOUring(UA_ConnectionConfig config, UA_UInt16 port,
+                             const UA_Logger *logger);
+
+_UA_END_DECLS
+
+#endif /* UA_NETWORK_TCP_IOURING_H_ */
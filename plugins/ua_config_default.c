@@ -767,6 +767,7 @@ const UA_ClientConfig UA_ClientConfig_default = {
 
     NULL, /* .inactivityCallback */
     NULL, /* .clientContext */
+    0,    /* .maxPipelinedRequests, 0 -> unlimited */
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS
     10,  /* .outStandingPublishRequests */
@@ -0,0 +1,850 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#include "ua_nodestore_snapshot.h"
+#include "ua_server_config.h"
+#include "ua_types_encoding_binary.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef UA_ENABLE_MULTITHREADING
+#include <pthread.h>
+#define SNAPSHOT_LOCK(SNAPSHOT) pthread_mutex_lock(&(SNAPSHOT)->mutex)
+#define SNAPSHOT_UNLOCK(SNAPSHOT) pthread_mutex_unlock(&(SNAPSHOT)->mutex)
+#else
+#define SNAPSHOT_LOCK(SNAPSHOT)
+#define SNAPSHOT_UNLOCK(SNAPSHOT)
+#endif
+
+/* The file starts with a header:
+ *
+ * - Magic (8 Bytes)
+ * - Format version (UInt32)
+ * - Library version (String)
+ * - Compiled features that change namespace zero (UInt32)
+ * - Application version (String)
+ * - Number of nodes (UInt64)
+ * - Offset of the index (UInt64)
+ * - Number of slots in the index (UInt64, power of two)
+ *
+ * Then follow the binary encoded nodes. Every node starts with its NodeId and
+ * NodeClass. The index is a linearly probed hash table of the NodeIds. Every
+ * slot contains the offset of a node plus one (UInt64, zero for empty
+ * slots). */
+#define UA_SNAPSHOT_MAGICSIZE 8
+#define UA_SNAPSHOT_FORMAT 1
+
+static const UA_Byte snapshotMagic[UA_SNAPSHOT_MAGICSIZE] =
+    {'U', 'A', 'S', 'N', 'A', 'P', 'S', 'H'};
+
+static UA_UInt32
+snapshotFeatures(void) {
+    UA_UInt32 features = 0;
+#ifdef UA_GENERATED_NAMESPACE_ZERO
+    features |= 1u << 0;
+#endif
+#ifdef UA_ENABLE_METHODCALLS
+    features |= 1u << 1;
+#endif
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    features |= 1u << 2;
+#endif
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    features |= 1u << 3;
+#endif
+#ifdef UA_ENABLE_HISTORIZING
+    features |= 1u << 4;
+#endif
+#ifdef UA_ENABLE_DA
+    features |= 1u << 5;
+#endif
+#ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL
+    features |= 1u << 6;
+#endif
+#ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL_METHODS
+    features |= 1u << 7;
+#endif
+    return features;
+}
+
+/* UA_NodeId_hash of consecutive numeric NodeIds differs only in the upper
+ * bits. Mix the hash before it is used as the position in the index. */
+static size_t
+snapshotHomeSlot(const UA_NodeId *id, size_t slots) {
+    UA_UInt32 h = UA_NodeId_hash(id);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return (size_t)h & (slots - 1);
+}
+
+/**********/
+/* Writer */
+/**********/
+
+typedef struct {
+    UA_Byte *data;
+    size_t length;
+    size_t pos;
+    UA_StatusCode status;
+} SnapshotBuffer;
+
+static void
+snapshotPut(SnapshotBuffer *b, const void *p, const UA_DataType *type) {
+    if(b->status != UA_STATUSCODE_GOOD)
+        return;
+    size_t size = UA_calcSizeBinary(p, type);
+    if(b->pos + size > b->length) {
+        size_t newLength = (b->length > 0) ? b->length : 1024;
+        while(b->pos + size > newLength)
+            newLength *= 2;
+        UA_Byte *data = (UA_Byte*)UA_realloc(b->data, newLength);
+        if(!data) {
+            b->status = UA_STATUSCODE_BADOUTOFMEMORY;
+            return;
+        }
+        b->data = data;
+        b->length = newLength;
+    }
+    UA_Byte *pos = &b->data[b->pos];
+    const UA_Byte *end = &b->data[b->length];
+    b->status = UA_encodeBinary(p, type, &pos, &end, NULL, NULL);
+    b->pos = (size_t)(pos - b->data);
+}
+
+static void
+snapshotPutCount(SnapshotBuffer *b, size_t count) {
+    UA_UInt32 c = (UA_UInt32)count;
+    if(count > UA_UINT32_MAX)
+        b->status = UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    snapshotPut(b, &c, &UA_TYPES[UA_TYPES_UINT32]);
+}
+
+static void
+encodeHeader(SnapshotBuffer *b, const UA_String *version, UA_UInt64 nodesSize,
+             UA_UInt64 indexOffset, UA_UInt64 indexSlots) {
+    for(size_t i = 0; i < UA_SNAPSHOT_MAGICSIZE; i++)
+        snapshotPut(b, &snapshotMagic[i], &UA_TYPES[UA_TYPES_BYTE]);
+    UA_UInt32 format = UA_SNAPSHOT_FORMAT;
+    snapshotPut(b, &format, &UA_TYPES[UA_TYPES_UINT32]);
+    UA_String library = UA_STRING(UA_OPEN62541_VER_COMMIT);
+    snapshotPut(b, &library, &UA_TYPES[UA_TYPES_STRING]);
+    UA_UInt32 features = snapshotFeatures();
+    snapshotPut(b, &features, &UA_TYPES[UA_TYPES_UINT32]);
+    snapshotPut(b, version, &UA_TYPES[UA_TYPES_STRING]);
+    snapshotPut(b, &nodesSize, &UA_TYPES[UA_TYPES_UINT64]);
+    snapshotPut(b, &indexOffset, &UA_TYPES[UA_TYPES_UINT64]);
+    snapshotPut(b, &indexSlots, &UA_TYPES[UA_TYPES_UINT64]);
+}
+
+static void
+encodeVariableAttributes(SnapshotBuffer *b, const UA_NodeId *dataType,
+                         UA_Int32 valueRank, size_t arrayDimensionsSize,
+                         const UA_UInt32 *arrayDimensions,
+                         const UA_DataValue *value) {
+    snapshotPut(b, dataType, &UA_TYPES[UA_TYPES_NODEID]);
+    snapshotPut(b, &valueRank, &UA_TYPES[UA_TYPES_INT32]);
+    snapshotPutCount(b, arrayDimensionsSize);
+    for(size_t i = 0; i < arrayDimensionsSize; i++)
+        snapshotPut(b, &arrayDimensions[i], &UA_TYPES[UA_TYPES_UINT32]);
+    snapshotPut(b, value, &UA_TYPES[UA_TYPES_DATAVALUE]);
+}
+
+/* The value is the current value of variables and variable types */
+static void
+encodeNode(SnapshotBuffer *b, const UA_Node *node, const UA_DataValue *value) {
+    snapshotPut(b, &node->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+    snapshotPut(b, &node->nodeClass, &UA_TYPES[UA_TYPES_NODECLASS]);
+    snapshotPut(b, &node->browseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+    snapshotPut(b, &node->displayName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    snapshotPut(b, &node->description, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    snapshotPut(b, &node->writeMask, &UA_TYPES[UA_TYPES_UINT32]);
+
+    snapshotPutCount(b, node->referencesSize);
+    for(size_t i = 0; i < node->referencesSize; i++) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        snapshotPut(b, &rk->referenceTypeId, &UA_TYPES[UA_TYPES_NODEID]);
+        snapshotPut(b, &rk->isInverse, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        snapshotPutCount(b, rk->targetIdsSize);
+        for(size_t j = 0; j < rk->targetIdsSize; j++)
+            snapshotPut(b, &rk->targetIds[j], &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+    }
+
+    switch(node->nodeClass) {
+    case UA_NODECLASS_VARIABLE: {
+        const UA_VariableNode *vn = (const UA_VariableNode*)node;
+        encodeVariableAttributes(b, &vn->dataType, vn->valueRank,
+                                 vn->arrayDimensionsSize, vn->arrayDimensions, value);
+        snapshotPut(b, &vn->accessLevel, &UA_TYPES[UA_TYPES_BYTE]);
+        snapshotPut(b, &vn->minimumSamplingInterval, &UA_TYPES[UA_TYPES_DOUBLE]);
+        snapshotPut(b, &vn->historizing, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    case UA_NODECLASS_VARIABLETYPE: {
+        const UA_VariableTypeNode *vtn = (const UA_VariableTypeNode*)node;
+        encodeVariableAttributes(b, &vtn->dataType, vtn->valueRank,
+                                 vtn->arrayDimensionsSize, vtn->arrayDimensions, value);
+        snapshotPut(b, &vtn->isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    case UA_NODECLASS_METHOD:
+        snapshotPut(b, &((const UA_MethodNode*)node)->executable,
+                    &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_OBJECT:
+        snapshotPut(b, &((const UA_ObjectNode*)node)->eventNotifier,
+                    &UA_TYPES[UA_TYPES_BYTE]);
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        snapshotPut(b, &((const UA_ObjectTypeNode*)node)->isAbstract,
+                    &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_REFERENCETYPE: {
+        const UA_ReferenceTypeNode *rtn = (const UA_ReferenceTypeNode*)node;
+        snapshotPut(b, &rtn->isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        snapshotPut(b, &rtn->symmetric, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        snapshotPut(b, &rtn->inverseName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        break;
+    }
+    case UA_NODECLASS_DATATYPE:
+        snapshotPut(b, &((const UA_DataTypeNode*)node)->isAbstract,
+                    &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_VIEW: {
+        const UA_ViewNode *vn = (const UA_ViewNode*)node;
+        snapshotPut(b, &vn->eventNotifier, &UA_TYPES[UA_TYPES_BYTE]);
+        snapshotPut(b, &vn->containsNoLoops, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    default:
+        b->status = UA_STATUSCODE_BADINTERNALERROR;
+        break;
+    }
+}
+
+typedef struct {
+    UA_NodeId *ids;
+    size_t size;
+    size_t capacity;
+    UA_StatusCode status;
+} SnapshotNodeIds;
+
+static void
+collectNodeId(void *visitorContext, const UA_Node *node) {
+    SnapshotNodeIds *c = (SnapshotNodeIds*)visitorContext;
+    if(c->status != UA_STATUSCODE_GOOD)
+        return;
+    if(c->size == c->capacity) {
+        size_t newCapacity = (c->capacity > 0) ? c->capacity * 2 : 1024;
+        UA_NodeId *ids = (UA_NodeId*)
+            UA_realloc(c->ids, newCapacity * sizeof(UA_NodeId));
+        if(!ids) {
+            c->status = UA_STATUSCODE_BADOUTOFMEMORY;
+            return;
+        }
+        c->ids = ids;
+        c->capacity = newCapacity;
+    }
+    c->status = UA_NodeId_copy(&node->nodeId, &c->ids[c->size]);
+    if(c->status == UA_STATUSCODE_GOOD)
+        c->size++;
+}
+
+static UA_StatusCode
+writeBuffer(FILE *f, SnapshotBuffer *b, UA_UInt64 *written) {
+    if(b->status != UA_STATUSCODE_GOOD)
+        return b->status;
+    if(b->pos > 0 && fwrite(b->data, 1, b->pos, f) != b->pos)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    *written += b->pos;
+    b->pos = 0;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Encodes the node and writes it at the current end of the file */
+static UA_StatusCode
+writeNode(UA_Server *server, UA_Nodestore *ns, FILE *f, SnapshotBuffer *b,
+          const UA_NodeId *id, UA_UInt64 *written) {
+    const UA_Node *node = ns->getNode(ns->context, id);
+    if(!node)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+
+    /* Data sources are stored with their current value */
+    UA_DataValue value;
+    UA_DataValue_init(&value);
+    const UA_DataValue *v = &value;
+    if(node->nodeClass == UA_NODECLASS_VARIABLE ||
+       node->nodeClass == UA_NODECLASS_VARIABLETYPE) {
+        const UA_VariableNode *vn = (const UA_VariableNode*)node;
+        if(vn->valueSource == UA_VALUESOURCE_DATA) {
+            v = &vn->value.data.value;
+        } else {
+            UA_ReadValueId rvi;
+            UA_ReadValueId_init(&rvi);
+            rvi.nodeId = *id;
+            rvi.attributeId = UA_ATTRIBUTEID_VALUE;
+            value = UA_Server_read(server, &rvi, UA_TIMESTAMPSTORETURN_NEITHER);
+        }
+    }
+
+    encodeNode(b, node, v);
+    ns->releaseNode(ns->context, node);
+    UA_DataValue_deleteMembers(&value);
+    return writeBuffer(f, b, written);
+}
+
+UA_StatusCode
+UA_Nodestore_writeSnapshot(UA_Server *server, const char *path,
+                           const UA_String version) {
+    UA_Nodestore *ns = &UA_Server_getConfig(server)->nodestore;
+
+    /* Collect the NodeIds first. The nodes are encoded outside of iterate. */
+    SnapshotNodeIds c;
+    memset(&c, 0, sizeof(SnapshotNodeIds));
+    ns->iterate(ns->context, &c, collectNodeId);
+    UA_StatusCode retval = c.status;
+
+    /* The index has at least twice as many slots as there are nodes */
+    size_t slots = 16;
+    while(slots < 2 * c.size)
+        slots *= 2;
+    UA_UInt64 *index = NULL;
+    if(retval == UA_STATUSCODE_GOOD) {
+        index = (UA_UInt64*)UA_calloc(slots, sizeof(UA_UInt64));
+        if(!index)
+            retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    /* Write to a temporary file that replaces the snapshot when it is
+     * complete */
+    size_t pathLen = strlen(path);
+    char *tmpPath = (char*)UA_malloc(pathLen + 5);
+    FILE *f = NULL;
+    if(tmpPath) {
+        memcpy(tmpPath, path, pathLen);
+        memcpy(&tmpPath[pathLen], ".tmp", 5);
+        if(retval == UA_STATUSCODE_GOOD) {
+            f = fopen(tmpPath, "wb");
+            if(!f)
+                retval = UA_STATUSCODE_BADINTERNALERROR;
+        }
+    } else {
+        retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    /* The header is written again with the final sizes at the end */
+    SnapshotBuffer b;
+    memset(&b, 0, sizeof(SnapshotBuffer));
+    UA_UInt64 written = 0;
+    if(retval == UA_STATUSCODE_GOOD) {
+        encodeHeader(&b, &version, 0, 0, 0);
+        retval = writeBuffer(f, &b, &written);
+    }
+
+    /* Write the nodes. Nodes that were removed in the meantime are
+     * skipped. */
+    size_t nodesSize = 0;
+    for(size_t i = 0; i < c.size && retval == UA_STATUSCODE_GOOD; i++) {
+        UA_UInt64 offset = written;
+        retval = writeNode(server, ns, f, &b, &c.ids[i], &written);
+        if(retval == UA_STATUSCODE_BADNODEIDUNKNOWN) {
+            retval = UA_STATUSCODE_GOOD;
+            continue;
+        }
+        size_t slot = snapshotHomeSlot(&c.ids[i], slots);
+        while(index[slot] != 0)
+            slot = (slot + 1) & (slots - 1);
+        index[slot] = offset + 1;
+        nodesSize++;
+    }
+
+    /* Write the index and the final header */
+    UA_UInt64 indexOffset = written;
+    for(size_t i = 0; i < slots && retval == UA_STATUSCODE_GOOD; i++) {
+        snapshotPut(&b, &index[i], &UA_TYPES[UA_TYPES_UINT64]);
+        if(b.pos >= 65536 || i == slots - 1)
+            retval = writeBuffer(f, &b, &written);
+    }
+    if(retval == UA_STATUSCODE_GOOD) {
+        encodeHeader(&b, &version, nodesSize, indexOffset, slots);
+        if(fseek(f, 0, SEEK_SET) != 0)
+            retval = UA_STATUSCODE_BADINTERNALERROR;
+        else
+            retval = writeBuffer(f, &b, &written);
+    }
+
+    if(f && fclose(f) != 0 && retval == UA_STATUSCODE_GOOD)
+        retval = UA_STATUSCODE_BADINTERNALERROR;
+    if(tmpPath) {
+        if(retval == UA_STATUSCODE_GOOD && rename(tmpPath, path) != 0)
+            retval = UA_STATUSCODE_BADINTERNALERROR;
+        if(retval != UA_STATUSCODE_GOOD)
+            remove(tmpPath);
+        UA_free(tmpPath);
+    }
+    UA_free(b.data);
+    UA_free(index);
+    for(size_t i = 0; i < c.size; i++)
+        UA_NodeId_deleteMembers(&c.ids[i]);
+    UA_free(c.ids);
+    return retval;
+}
+
+/*************/
+/* Nodestore */
+/*************/
+
+typedef struct {
+    UA_Nodestore inner;
+    const UA_DataTypeArray *customTypes;
+
+    /* The mapped file */
+    UA_ByteString map;
+    size_t indexOffset;
+    size_t indexSlots;
+
+    /* Nodes of the snapshot that were moved into the inner nodestore. They
+     * are not taken from the snapshot again, also after they were removed. */
+    UA_Byte *taken;
+    size_t remaining;
+
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_t mutex;
+#endif
+} SnapshotNodestore;
+
+typedef struct {
+    const UA_ByteString *src;
+    size_t offset;
+    const UA_DataTypeArray *customTypes;
+    UA_StatusCode status;
+} SnapshotReader;
+
+static void
+snapshotGet(SnapshotReader *r, void *dst, const UA_DataType *type) {
+    if(r->status != UA_STATUSCODE_GOOD) {
+        UA_init(dst, type);
+        return;
+    }
+    r->status = UA_decodeBinary(r->src, &r->offset, dst, type, r->customTypes);
+}
+
+static size_t
+snapshotGetCount(SnapshotReader *r) {
+    UA_UInt32 count = 0;
+    snapshotGet(r, &count, &UA_TYPES[UA_TYPES_UINT32]);
+    /* Every element takes at least one byte */
+    if(r->status == UA_STATUSCODE_GOOD && count > r->src->length - r->offset)
+        r->status = UA_STATUSCODE_BADDECODINGERROR;
+    return (r->status == UA_STATUSCODE_GOOD) ? count : 0;
+}
+
+static UA_UInt64
+indexSlot(const SnapshotNodestore *ss, size_t slot) {
+    UA_UInt64 entry = 0;
+    size_t offset = ss->indexOffset + slot * 8;
+    if(UA_decodeBinary(&ss->map, &offset, &entry,
+                       &UA_TYPES[UA_TYPES_UINT64], NULL) != UA_STATUSCODE_GOOD)
+        return 0;
+    return entry;
+}
+
+/* Returns the slot of the node in the index or indexSlots */
+static size_t
+findSnapshotNode(const SnapshotNodestore *ss, const UA_NodeId *id) {
+    size_t slot = snapshotHomeSlot(id, ss->indexSlots);
+    for(size_t i = 0; i < ss->indexSlots; i++) {
+        UA_UInt64 entry = indexSlot(ss, slot);
+        if(entry == 0)
+            break;
+        UA_NodeId nodeId;
+        size_t offset = (size_t)entry - 1;
+        if(UA_decodeBinary(&ss->map, &offset, &nodeId, &UA_TYPES[UA_TYPES_NODEID],
+                           NULL) == UA_STATUSCODE_GOOD) {
+            UA_Boolean found = UA_NodeId_equal(&nodeId, id);
+            UA_NodeId_deleteMembers(&nodeId);
+            if(found)
+                return slot;
+        }
+        slot = (slot + 1) & (ss->indexSlots - 1);
+    }
+    return ss->indexSlots;
+}
+
+static void
+decodeVariableAttributes(SnapshotReader *r, UA_NodeId *dataType,
+                         UA_Int32 *valueRank, size_t *arrayDimensionsSize,
+                         UA_UInt32 **arrayDimensions, UA_DataValue *value) {
+    snapshotGet(r, dataType, &UA_TYPES[UA_TYPES_NODEID]);
+    snapshotGet(r, valueRank, &UA_TYPES[UA_TYPES_INT32]);
+    size_t dims = snapshotGetCount(r);
+    if(dims > 0) {
+        *arrayDimensions = (UA_UInt32*)UA_Array_new(dims, &UA_TYPES[UA_TYPES_UINT32]);
+        if(!*arrayDimensions) {
+            r->status = UA_STATUSCODE_BADOUTOFMEMORY;
+            return;
+        }
+        *arrayDimensionsSize = dims;
+        for(size_t i = 0; i < dims; i++)
+            snapshotGet(r, &(*arrayDimensions)[i], &UA_TYPES[UA_TYPES_UINT32]);
+    }
+    snapshotGet(r, value, &UA_TYPES[UA_TYPES_DATAVALUE]);
+}
+
+static UA_StatusCode
+decodeReferences(SnapshotReader *r, UA_Node *node) {
+    size_t kinds = snapshotGetCount(r);
+    for(size_t i = 0; i < kinds && r->status == UA_STATUSCODE_GOOD; i++) {
+        UA_AddReferencesItem item;
+        UA_AddReferencesItem_init(&item);
+        UA_Boolean isInverse = false;
+        snapshotGet(r, &item.referenceTypeId, &UA_TYPES[UA_TYPES_NODEID]);
+        snapshotGet(r, &isInverse, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        item.isForward = !isInverse;
+        size_t targets = snapshotGetCount(r);
+        for(size_t j = 0; j < targets && r->status == UA_STATUSCODE_GOOD; j++) {
+            snapshotGet(r, &item.targetNodeId, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+            if(r->status == UA_STATUSCODE_GOOD)
+                r->status = UA_Node_addReference(node, &item);
+            UA_ExpandedNodeId_deleteMembers(&item.targetNodeId);
+        }
+        UA_NodeId_deleteMembers(&item.referenceTypeId);
+    }
+    return r->status;
+}
+
+static UA_StatusCode
+decodeNode(const SnapshotNodestore *ss, size_t offset, UA_Node **outNode) {
+    SnapshotReader r = {&ss->map, offset, ss->customTypes, UA_STATUSCODE_GOOD};
+    UA_NodeId id;
+    UA_NodeClass nodeClass = UA_NODECLASS_UNSPECIFIED;
+    snapshotGet(&r, &id, &UA_TYPES[UA_TYPES_NODEID]);
+    snapshotGet(&r, &nodeClass, &UA_TYPES[UA_TYPES_NODECLASS]);
+    if(r.status != UA_STATUSCODE_GOOD) {
+        UA_NodeId_deleteMembers(&id);
+        return r.status;
+    }
+
+    UA_Node *node = ss->inner.newNode(ss->inner.context, nodeClass);
+    if(!node) {
+        UA_NodeId_deleteMembers(&id);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    node->nodeId = id;
+    snapshotGet(&r, &node->browseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+    snapshotGet(&r, &node->displayName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    snapshotGet(&r, &node->description, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    snapshotGet(&r, &node->writeMask, &UA_TYPES[UA_TYPES_UINT32]);
+    decodeReferences(&r, node);
+
+    switch(nodeClass) {
+    case UA_NODECLASS_VARIABLE: {
+        UA_VariableNode *vn = (UA_VariableNode*)node;
+        vn->valueSource = UA_VALUESOURCE_DATA;
+        decodeVariableAttributes(&r, &vn->dataType, &vn->valueRank,
+                                 &vn->arrayDimensionsSize, &vn->arrayDimensions,
+                                 &vn->value.data.value);
+        snapshotGet(&r, &vn->accessLevel, &UA_TYPES[UA_TYPES_BYTE]);
+        snapshotGet(&r, &vn->minimumSamplingInterval, &UA_TYPES[UA_TYPES_DOUBLE]);
+        snapshotGet(&r, &vn->historizing, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    case UA_NODECLASS_VARIABLETYPE: {
+        UA_VariableTypeNode *vtn = (UA_VariableTypeNode*)node;
+        vtn->valueSource = UA_VALUESOURCE_DATA;
+        decodeVariableAttributes(&r, &vtn->dataType, &vtn->valueRank,
+                                 &vtn->arrayDimensionsSize, &vtn->arrayDimensions,
+                                 &vtn->value.data.value);
+        snapshotGet(&r, &vtn->isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    case UA_NODECLASS_METHOD:
+        snapshotGet(&r, &((UA_MethodNode*)node)->executable,
+                    &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_OBJECT:
+        snapshotGet(&r, &((UA_ObjectNode*)node)->eventNotifier,
+                    &UA_TYPES[UA_TYPES_BYTE]);
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        snapshotGet(&r, &((UA_ObjectTypeNode*)node)->isAbstract,
+                    &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_REFERENCETYPE: {
+        UA_ReferenceTypeNode *rtn = (UA_ReferenceTypeNode*)node;
+        snapshotGet(&r, &rtn->isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        snapshotGet(&r, &rtn->symmetric, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        snapshotGet(&r, &rtn->inverseName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        break;
+    }
+    case UA_NODECLASS_DATATYPE:
+        snapshotGet(&r, &((UA_DataTypeNode*)node)->isAbstract,
+                    &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_VIEW: {
+        UA_ViewNode *vn = (UA_ViewNode*)node;
+        snapshotGet(&r, &vn->eventNotifier, &UA_TYPES[UA_TYPES_BYTE]);
+        snapshotGet(&r, &vn->containsNoLoops, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    default:
+        r.status = UA_STATUSCODE_BADDECODINGERROR;
+        break;
+    }
+
+    if(r.status != UA_STATUSCODE_GOOD) {
+        ss->inner.deleteNode(ss->inner.context, node);
+        return r.status;
+    }
+    *outNode = node;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Moves the node from the snapshot into the inner nodestore. Must be called
+ * inside the critical section. */
+static void
+materializeSlot(SnapshotNodestore *ss, size_t slot) {
+    if(ss->taken[slot])
+        return;
+    ss->taken[slot] = 1;
+    ss->remaining--;
+    UA_UInt64 entry = indexSlot(ss, slot);
+    UA_Node *node = NULL;
+    if(decodeNode(ss, (size_t)entry - 1, &node) != UA_STATUSCODE_GOOD)
+        return;
+    /* The inner nodestore deletes the node if it cannot be inserted */
+    ss->inner.insertNode(ss->inner.context, node, NULL);
+}
+
+static void
+materializeNode(SnapshotNodestore *ss, const UA_NodeId *id) {
+    if(ss->remaining == 0)
+        return;
+    size_t slot = findSnapshotNode(ss, id);
+    if(slot < ss->indexSlots)
+        materializeSlot(ss, slot);
+}
+
+static void
+materializeAll(SnapshotNodestore *ss) {
+    for(size_t slot = 0; slot < ss->indexSlots && ss->remaining > 0; slot++) {
+        if(indexSlot(ss, slot) != 0)
+            materializeSlot(ss, slot);
+    }
+}
+
+static UA_Node *
+Snapshot_newNode(void *context, UA_NodeClass nodeClass) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    return ss->inner.newNode(ss->inner.context, nodeClass);
+}
+
+static void
+Snapshot_deleteNode(void *context, UA_Node *node) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    ss->inner.deleteNode(ss->inner.context, node);
+}
+
+static const UA_Node *
+Snapshot_getNode(void *context, const UA_NodeId *nodeId) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    const UA_Node *node = ss->inner.getNode(ss->inner.context, nodeId);
+    if(node)
+        return node;
+    SNAPSHOT_LOCK(ss);
+    UA_Boolean materialized = (ss->remaining > 0);
+    materializeNode(ss, nodeId);
+    SNAPSHOT_UNLOCK(ss);
+    if(!materialized)
+        return NULL;
+    return ss->inner.getNode(ss->inner.context, nodeId);
+}
+
+static void
+Snapshot_releaseNode(void *context, const UA_Node *node) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    ss->inner.releaseNode(ss->inner.context, node);
+}
+
+static UA_StatusCode
+Snapshot_getNodeCopy(void *context, const UA_NodeId *nodeId,
+                     UA_Node **outNode) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    SNAPSHOT_LOCK(ss);
+    materializeNode(ss, nodeId);
+    SNAPSHOT_UNLOCK(ss);
+    return ss->inner.getNodeCopy(ss->inner.context, nodeId, outNode);
+}
+
+static UA_StatusCode
+Snapshot_insertNode(void *context, UA_Node *node, UA_NodeId *addedNodeId) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    SNAPSHOT_LOCK(ss);
+    if(node->nodeId.identifierType == UA_NODEIDTYPE_NUMERIC &&
+       node->nodeId.identifier.numeric == 0) {
+        /* Create a random nodeid that is used neither in the snapshot nor in
+         * the inner nodestore */
+        while(true) {
+            node->nodeId.identifier.numeric = UA_UInt32_random();
+            if(node->nodeId.identifier.numeric == 0 ||
+               findSnapshotNode(ss, &node->nodeId) < ss->indexSlots)
+                continue;
+            const UA_Node *existing = ss->inner.getNode(ss->inner.context, &node->nodeId);
+            if(!existing)
+                break;
+            ss->inner.releaseNode(ss->inner.context, existing);
+        }
+    } else {
+        /* The inner nodestore detects the duplicate */
+        materializeNode(ss, &node->nodeId);
+    }
+    UA_StatusCode retval = ss->inner.insertNode(ss->inner.context, node, addedNodeId);
+    SNAPSHOT_UNLOCK(ss);
+    return retval;
+}
+
+static UA_StatusCode
+Snapshot_replaceNode(void *context, UA_Node *node) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    return ss->inner.replaceNode(ss->inner.context, node);
+}
+
+static UA_StatusCode
+Snapshot_removeNode(void *context, const UA_NodeId *nodeId) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    SNAPSHOT_LOCK(ss);
+    materializeNode(ss, nodeId);
+    SNAPSHOT_UNLOCK(ss);
+    return ss->inner.removeNode(ss->inner.context, nodeId);
+}
+
+static void
+Snapshot_iterate(void *context, void *visitorContext,
+                 UA_NodestoreVisitor visitor) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    SNAPSHOT_LOCK(ss);
+    materializeAll(ss);
+    SNAPSHOT_UNLOCK(ss);
+    ss->inner.iterate(ss->inner.context, visitorContext, visitor);
+}
+
+static void
+Snapshot_delete(void *context) {
+    SnapshotNodestore *ss = (SnapshotNodestore*)context;
+    ss->inner.deleteNodestore(ss->inner.context);
+    munmap(ss->map.data, ss->map.length);
+    UA_free(ss->taken);
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_destroy(&ss->mutex);
+#endif
+    UA_free(ss);
+}
+
+/* Checks the header and returns the index position */
+static UA_StatusCode
+readHeader(const UA_ByteString *map, const UA_String *version,
+           UA_UInt64 *nodesSize, UA_UInt64 *indexOffset, UA_UInt64 *indexSlots) {
+    if(map->length < UA_SNAPSHOT_MAGICSIZE ||
+       memcmp(map->data, snapshotMagic, UA_SNAPSHOT_MAGICSIZE) != 0)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+
+    SnapshotReader r = {map, UA_SNAPSHOT_MAGICSIZE, NULL, UA_STATUSCODE_GOOD};
+    UA_UInt32 format = 0, features = 0;
+    UA_String library, appVersion;
+    snapshotGet(&r, &format, &UA_TYPES[UA_TYPES_UINT32]);
+    snapshotGet(&r, &library, &UA_TYPES[UA_TYPES_STRING]);
+    snapshotGet(&r, &features, &UA_TYPES[UA_TYPES_UINT32]);
+    snapshotGet(&r, &appVersion, &UA_TYPES[UA_TYPES_STRING]);
+    snapshotGet(&r, nodesSize, &UA_TYPES[UA_TYPES_UINT64]);
+    snapshotGet(&r, indexOffset, &UA_TYPES[UA_TYPES_UINT64]);
+    snapshotGet(&r, indexSlots, &UA_TYPES[UA_TYPES_UINT64]);
+
+    const UA_String currentLibrary = UA_STRING(UA_OPEN62541_VER_COMMIT);
+    UA_StatusCode retval = r.status;
+    if(retval == UA_STATUSCODE_GOOD &&
+       (format != UA_SNAPSHOT_FORMAT || features != snapshotFeatures() ||
+        !UA_String_equal(&library, &currentLibrary) ||
+        !UA_String_equal(&appVersion, version)))
+        retval = UA_STATUSCODE_BADNOTSUPPORTED;
+    UA_String_deleteMembers(&library);
+    UA_String_deleteMembers(&appVersion);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* The index is complete and a power of two */
+    if(*indexSlots == 0 || (*indexSlots & (*indexSlots - 1)) != 0 ||
+       *indexOffset > map->length || *indexSlots > (map->length - *indexOffset) / 8)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Nodestore_Snapshot(UA_Nodestore *ns, const char *path,
+                      const UA_String version,
+                      const UA_DataTypeArray *customTypes) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return (errno == ENOENT) ? UA_STATUSCODE_BADNOTFOUND :
+            UA_STATUSCODE_BADINTERNALERROR;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    UA_ByteString map;
+    map.length = (size_t)st.st_size;
+    void *data = mmap(NULL, map.length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    map.data = (UA_Byte*)data;
+
+    UA_UInt64 nodesSize = 0, indexOffset = 0, indexSlots = 0;
+    UA_StatusCode retval = readHeader(&map, &version, &nodesSize,
+                                      &indexOffset, &indexSlots);
+    if(retval != UA_STATUSCODE_GOOD) {
+        munmap(map.data, map.length);
+        return retval;
+    }
+
+    SnapshotNodestore *ss = (SnapshotNodestore*)UA_calloc(1, sizeof(SnapshotNodestore));
+    if(ss)
+        ss->taken = (UA_Byte*)UA_calloc((size_t)indexSlots, sizeof(UA_Byte));
+    if(!ss || !ss->taken) {
+        UA_free(ss);
+        munmap(map.data, map.length);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    ss->inner = *ns;
+    ss->customTypes = customTypes;
+    ss->map = map;
+    ss->indexOffset = (size_t)indexOffset;
+    ss->indexSlots = (size_t)indexSlots;
+    ss->remaining = (size_t)nodesSize;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_init(&ss->mutex, NULL);
+#endif
+
+    ns->context = ss;
+    ns->deleteNodestore = Snapshot_delete;
+    ns->inPlaceEditAllowed = ss->inner.inPlaceEditAllowed;
+    ns->newNode = Snapshot_newNode;
+    ns->deleteNode = Snapshot_deleteNode;
+    ns->getNode = Snapshot_getNode;
+    ns->releaseNode = Snapshot_releaseNode;
+    ns->getNodeCopy = Snapshot_getNodeCopy;
+    ns->insertNode = Snapshot_insertNode;
+    ns->replaceNode = Snapshot_replaceNode;
+    ns->removeNode = Snapshot_removeNode;
+    ns->iterate = Snapshot_iterate;
+    return UA_STATUSCODE_GOOD;
+}
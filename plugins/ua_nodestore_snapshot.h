@@ -0,0 +1,61 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#ifndef UA_NODESTORE_SNAPSHOT_H_
+#define UA_NODESTORE_SNAPSHOT_H_
+
+#include "ua_plugin_nodestore.h"
+#include "ua_server.h"
+
+_UA_BEGIN_DECLS
+
+/**
+ * Address Space Snapshots
+ * -----------------------
+ *
+ * A snapshot is a binary image of all nodes in the nodestore of a server.
+ * Building namespace zero and large generated nodesets node by node takes
+ * time. A server that starts from a snapshot adopts the nodes instead. The
+ * snapshot file is memory-mapped and a node is only decoded when it is
+ * accessed for the first time.
+ *
+ * The snapshot contains the attributes and references of the nodes. Function
+ * pointers and contexts are not part of the snapshot. So the value callbacks,
+ * data sources, method callbacks, node contexts and type lifecycles have to
+ * be set up again after the server was created. The current value of a
+ * variable with a data source is stored as a static value. The constructors
+ * of the nodes are not called when the nodes are materialized.
+ *
+ * The file contains the version of the library, the compiled features that
+ * change namespace zero and a version string of the application. The
+ * application version has to change whenever the information model of the
+ * application changes. */
+
+/* Writes all nodes of the server into the snapshot file. The file is written
+ * under a temporary name and renamed when it is complete. */
+UA_StatusCode UA_EXPORT
+UA_Nodestore_writeSnapshot(UA_Server *server, const char *path,
+                           const UA_String version);
+
+/* Wraps the nodestore with the snapshot in the file. Nodes are taken from the
+ * snapshot when they are not found in the wrapped nodestore. The wrapped
+ * nodestore must be empty and is deleted together with the snapshot
+ * nodestore. Create the server with the wrapped nodestore afterwards. Then
+ * namespace zero is not built again. Only the namespaces and the data sources
+ * of namespace zero are set up.
+ *
+ * Returns UA_STATUSCODE_BADNOTFOUND if the file does not exist and
+ * UA_STATUSCODE_BADNOTSUPPORTED if the snapshot was written by another
+ * version of the library or the application. Then the nodestore is not
+ * changed and the server is built in the normal way. The custom data types
+ * are used to decode the values of the variables (can be NULL). They have to
+ * outlive the nodestore. */
+UA_StatusCode UA_EXPORT
+UA_Nodestore_Snapshot(UA_Nodestore *ns, const char *path,
+                      const UA_String version,
+                      const UA_DataTypeArray *customTypes);
+
+_UA_END_DECLS
+
+#endif /* UA_NODESTORE_SNAPSHOT_H_ */
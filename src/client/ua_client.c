@@ -249,10 +249,43 @@ typedef struct {
     const UA_DataType *responseType;
 } SyncResponseDescription;
 
-/* For both synchronous and asynchronous service calls */
+/* Send the RequestHeader followed by the already encoded remainder of the
+ * request */
+static UA_StatusCode
+sendSymmetricMessageEncoded(UA_SecureChannel *channel, UA_UInt32 requestId,
+                            const UA_RequestHeader *rr, const UA_DataType *requestType,
+                            const UA_ByteString *encodedBody) {
+    if(!channel->connection)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    if(channel->connection->state == UA_CONNECTION_CLOSED)
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+
+    UA_MessageContext mc;
+    UA_StatusCode retval = UA_MessageContext_begin(&mc, channel, requestId,
+                                                   UA_MESSAGETYPE_MSG);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_NodeId typeId = UA_NODEID_NUMERIC(0, requestType->binaryEncodingId);
+    retval = UA_MessageContext_encode(&mc, &typeId, &UA_TYPES[UA_TYPES_NODEID]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = UA_MessageContext_encode(&mc, rr, &UA_TYPES[UA_TYPES_REQUESTHEADER]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = UA_MessageContext_encodeRaw(&mc, encodedBody);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    return UA_MessageContext_finish(&mc);
+}
+
+/* For both synchronous and asynchronous service calls. If encodedBody is set,
+ * then request points to the RequestHeader only and the remainder of the
+ * request is already encoded. */
 static UA_StatusCode
 sendSymmetricServiceRequest(UA_Client *client, const void *request,
-                            const UA_DataType *requestType, UA_UInt32 *requestId) {
+                            const UA_DataType *requestType,
+                            const UA_ByteString *encodedBody, UA_UInt32 *requestId) {
     /* Make sure we have a valid session */
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     /* FIXME: this is just a dirty workaround. We need to rework some of the sync and async processing
@@ -275,8 +308,12 @@ sendSymmetricServiceRequest(UA_Client *client, const void *request,
 
     if (client->channel.nextSecurityToken.tokenId != 0) // Change to the new security token if the secure channel has been renewed.
         UA_SecureChannel_revolveTokens(&client->channel);
-    retval = UA_SecureChannel_sendSymmetricMessage(&client->channel, rqId, UA_MESSAGETYPE_MSG,
-                                                   rr, requestType);
+    if(encodedBody)
+        retval = sendSymmetricMessageEncoded(&client->channel, rqId, rr,
+                                             requestType, encodedBody);
+    else
+        retval = UA_SecureChannel_sendSymmetricMessage(&client->channel, rqId,
+                                                       UA_MESSAGETYPE_MSG, rr, requestType);
     UA_NodeId_init(&rr->authenticationToken); /* Do not return the token to the user */
     if(retval != UA_STATUSCODE_GOOD)
         return retval;
@@ -288,19 +325,36 @@ sendSymmetricServiceRequest(UA_Client *client, const void *request,
 static const UA_NodeId
 serviceFaultId = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_SERVICEFAULT_ENCODING_DEFAULTBINARY}};
 
-/* Look for the async callback in the linked list, execute and delete it */
+static AsyncServiceCall *
+findAsyncService(UA_Client *client, UA_UInt32 requestId) {
+    AsyncServiceCall *ac;
+    LIST_FOREACH(ac, UA_CLIENT_ASYNCSERVICE_BUCKET(client, requestId), pointers) {
+        if(ac->requestId == requestId)
+            return ac;
+    }
+    return NULL;
+}
+
+void
+UA_Client_AsyncService_remove(UA_Client *client, AsyncServiceCall *ac) {
+    LIST_REMOVE(ac, pointers);
+    if(ac->pipelined)
+        client->pipelinedRequests--;
+}
+
+/* Look for the async callback in the hash table, execute and delete it */
 static UA_StatusCode
 processAsyncResponse(UA_Client *client, UA_UInt32 requestId, const UA_NodeId *responseTypeId,
                      const UA_ByteString *responseMessage, size_t *offset) {
     /* Find the callback */
-    AsyncServiceCall *ac;
-    LIST_FOREACH(ac, &client->asyncServiceCalls, pointers) {
-        if(ac->requestId == requestId)
-            break;
-    }
+    AsyncServiceCall *ac = findAsyncService(client, requestId);
     if(!ac)
         return UA_STATUSCODE_BADREQUESTHEADERINVALID;
 
+    /* Remove the callback before it is executed. The callback may send new
+     * requests into the freed slot of the pipeline or disconnect the client. */
+    UA_Client_AsyncService_remove(client, ac);
+
     /* Allocate the response */
     UA_STACKARRAY(UA_Byte, responseBuf, ac->responseType->memSize);
     void *response = (void*)(uintptr_t)&responseBuf[0]; /* workaround aliasing rules */
@@ -340,9 +394,6 @@ processAsyncResponse(UA_Client *client, UA_UInt32 requestId, const UA_NodeId *re
     if(ac->callback)
         ac->callback(client, ac->userdata, requestId, response);
     UA_deleteMembers(response, ac->responseType);
-
-    /* Remove the callback */
-    LIST_REMOVE(ac, pointers);
     UA_free(ac);
     return retval;
 }
@@ -487,7 +538,8 @@ __UA_Client_Service(UA_Client *client, const void *request,
 
     /* Send the request */
     UA_UInt32 requestId;
-    UA_StatusCode retval = sendSymmetricServiceRequest(client, request, requestType, &requestId);
+    UA_StatusCode retval = sendSymmetricServiceRequest(client, request, requestType,
+                                                       NULL, &requestId);
     if(retval != UA_STATUSCODE_GOOD) {
         if(retval == UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED)
             respHeader->serviceResult = UA_STATUSCODE_BADREQUESTTOOLARGE;
@@ -512,11 +564,11 @@ __UA_Client_Service(UA_Client *client, const void *request,
 
 UA_StatusCode
 receiveServiceResponseAsync(UA_Client *client, void *response,
-                             const UA_DataType *responseType) {
+                             const UA_DataType *responseType, UA_UInt32 timeout) {
     SyncResponseDescription rd = { client, false, 0, response, responseType };
 
     UA_StatusCode retval = UA_Connection_receiveChunksNonBlocking(
-            &client->connection, &rd, client_processChunk);
+            &client->connection, &rd, client_processChunk, timeout);
     UA_SecureChannel_processCompleteMessages(&client->channel, &rd, processServiceResponse);
     /*let client run when non critical timeout*/
     if(retval != UA_STATUSCODE_GOOD
@@ -530,14 +582,16 @@ receiveServiceResponseAsync(UA_Client *client, void *response,
 }
 
 UA_StatusCode
-receivePacketAsync(UA_Client *client) {
+receivePacketAsync(UA_Client *client, UA_UInt32 timeout) {
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     if (UA_Client_getState(client) == UA_CLIENTSTATE_DISCONNECTED ||
             UA_Client_getState(client) == UA_CLIENTSTATE_WAITING_FOR_ACK) {
-        retval = UA_Connection_receiveChunksNonBlocking(&client->connection, client, processACKResponseAsync);
+        retval = UA_Connection_receiveChunksNonBlocking(&client->connection, client,
+                                                        processACKResponseAsync, timeout);
     }
     else if(UA_Client_getState(client) == UA_CLIENTSTATE_CONNECTED) {
-        retval = UA_Connection_receiveChunksNonBlocking(&client->connection, client, processOPNResponseAsync);
+        retval = UA_Connection_receiveChunksNonBlocking(&client->connection, client,
+                                                        processOPNResponseAsync, timeout);
     }
     if(retval != UA_STATUSCODE_GOOD && retval != UA_STATUSCODE_GOODNONCRITICALTIMEOUT) {
         if(retval == UA_STATUSCODE_BADCONNECTIONCLOSED)
@@ -564,22 +618,43 @@ UA_Client_AsyncService_cancel(UA_Client *client, AsyncServiceCall *ac,
 }
 
 void UA_Client_AsyncService_removeAll(UA_Client *client, UA_StatusCode statusCode) {
-    AsyncServiceCall *ac, *ac_tmp;
-    LIST_FOREACH_SAFE(ac, &client->asyncServiceCalls, pointers, ac_tmp) {
-        LIST_REMOVE(ac, pointers);
-        UA_Client_AsyncService_cancel(client, ac, statusCode);
-        UA_free(ac);
+    for(size_t i = 0; i < UA_CLIENT_ASYNCSERVICE_BUCKETS; i++) {
+        AsyncServiceCall *ac;
+        while((ac = LIST_FIRST(&client->asyncServiceCalls[i]))) {
+            UA_Client_AsyncService_remove(client, ac);
+            UA_Client_AsyncService_cancel(client, ac, statusCode);
+            UA_free(ac);
+        }
     }
 }
 
 UA_StatusCode
-__UA_Client_AsyncServiceEx(UA_Client *client, const void *request,
-                           const UA_DataType *requestType,
-                           UA_ClientAsyncServiceCallback callback,
-                           const UA_DataType *responseType,
-                           void *userdata, UA_UInt32 *requestId,
-                           UA_UInt32 timeout) {
-    /* Prepare the entry for the linked list */
+UA_Client_AsyncService_cancelById(UA_Client *client, UA_UInt32 requestId,
+                                  UA_StatusCode statusCode) {
+    AsyncServiceCall *ac = findAsyncService(client, requestId);
+    if(!ac)
+        return UA_STATUSCODE_BADNOTFOUND;
+    UA_Client_AsyncService_remove(client, ac);
+    UA_Client_AsyncService_cancel(client, ac, statusCode);
+    UA_free(ac);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+asyncService(UA_Client *client, const void *request,
+             const UA_DataType *requestType, const UA_ByteString *encodedBody,
+             UA_ClientAsyncServiceCallback callback,
+             const UA_DataType *responseType,
+             void *userdata, UA_UInt32 *requestId, UA_UInt32 timeout) {
+    /* Backpressure if the window of pipelined requests is full. Publish
+     * requests are parked in the server and limited separately by
+     * outStandingPublishRequests. */
+    UA_Boolean pipelined = (requestType != &UA_TYPES[UA_TYPES_PUBLISHREQUEST]);
+    if(pipelined && client->config.maxPipelinedRequests > 0 &&
+       client->pipelinedRequests >= client->config.maxPipelinedRequests)
+        return UA_STATUSCODE_BADTOOMANYOPERATIONS;
+
+    /* Prepare the entry for the hash table */
     AsyncServiceCall *ac = (AsyncServiceCall*)UA_malloc(sizeof(AsyncServiceCall));
     if(!ac)
         return UA_STATUSCODE_BADOUTOFMEMORY;
@@ -587,9 +662,11 @@ __UA_Client_AsyncServiceEx(UA_Client *client, const void *request,
     ac->responseType = responseType;
     ac->userdata = userdata;
     ac->timeout = timeout;
+    ac->pipelined = pipelined;
 
     /* Call the service and set the requestId */
-    UA_StatusCode retval = sendSymmetricServiceRequest(client, request, requestType, &ac->requestId);
+    UA_StatusCode retval = sendSymmetricServiceRequest(client, request, requestType,
+                                                       encodedBody, &ac->requestId);
     if(retval != UA_STATUSCODE_GOOD) {
         UA_free(ac);
         return retval;
@@ -598,12 +675,36 @@ __UA_Client_AsyncServiceEx(UA_Client *client, const void *request,
     ac->start = UA_DateTime_nowMonotonic();
 
     /* Store the entry for async processing */
-    LIST_INSERT_HEAD(&client->asyncServiceCalls, ac, pointers);
+    LIST_INSERT_HEAD(UA_CLIENT_ASYNCSERVICE_BUCKET(client, ac->requestId), ac, pointers);
+    if(pipelined)
+        client->pipelinedRequests++;
     if(requestId)
         *requestId = ac->requestId;
     return UA_STATUSCODE_GOOD;
 }
 
+UA_StatusCode
+__UA_Client_AsyncServiceEx(UA_Client *client, const void *request,
+                           const UA_DataType *requestType,
+                           UA_ClientAsyncServiceCallback callback,
+                           const UA_DataType *responseType,
+                           void *userdata, UA_UInt32 *requestId,
+                           UA_UInt32 timeout) {
+    return asyncService(client, request, requestType, NULL, callback,
+                        responseType, userdata, requestId, timeout);
+}
+
+UA_StatusCode
+UA_Client_AsyncService_sendEncoded(UA_Client *client, UA_RequestHeader *requestHeader,
+                                   const UA_DataType *requestType,
+                                   const UA_ByteString *encodedBody,
+                                   UA_ClientAsyncServiceCallback callback,
+                                   const UA_DataType *responseType,
+                                   void *userdata, UA_UInt32 *requestId) {
+    return asyncService(client, requestHeader, requestType, encodedBody, callback,
+                        responseType, userdata, requestId, client->config.timeout);
+}
+
 UA_StatusCode
 __UA_Client_AsyncService(UA_Client *client, const void *request,
                          const UA_DataType *requestType,
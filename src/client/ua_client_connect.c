@@ -561,10 +561,14 @@ UA_Client_connectInternal(UA_Client *client, const char *endpointUrl,
     client->requestId = 0;
 
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    /* The previous connection of a reconnecting client */
+    if(client->connection.free)
+        client->connection.free(&client->connection);
     client->connection =
         client->config.connectionFunc(client->config.localConnectionConfig,
                                       endpointUrl, client->config.timeout,
                                       &client->config.logger);
+    client->connectionCount++;
     if(client->connection.state != UA_CONNECTION_OPENING) {
         retval = UA_STATUSCODE_BADCONNECTIONCLOSED;
         goto cleanup;
@@ -570,9 +570,13 @@ UA_Client_connect_async(UA_Client *client, const char *endpointUrl,
     client->requestId = 0;
 
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    /* The previous connection of a reconnecting client */
+    if(client->connection.free)
+        client->connection.free(&client->connection);
     client->connection = client->config.initConnectionFunc(
             client->config.localConnectionConfig, endpointUrl,
             client->config.timeout, &client->config.logger);
+    client->connectionCount++;
     if(client->connection.state != UA_CONNECTION_OPENING) {
         UA_LOG_TRACE(&client->config.logger, UA_LOGCATEGORY_CLIENT,
                      "Could not init async connection");
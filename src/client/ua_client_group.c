@@ -0,0 +1,216 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ua_client_internal.h"
+
+#ifdef UA_ENABLE_CLIENT_GROUP
+
+#include <sys/epoll.h>
+
+/* Maximum number of network events handled per iteration. Remaining events are
+ * reported again in the next iteration (level-triggered). */
+#define UA_CLIENTGROUP_MAXEVENTS 128
+
+typedef struct ClientGroupEntry {
+    LIST_ENTRY(ClientGroupEntry) pointers;
+    UA_Client *client; /* NULL if removed during an iteration */
+    UA_SOCKET fd;      /* The socket registered in the epoll set */
+    UA_UInt32 connectionCount; /* Connection of the registered socket */
+    UA_Boolean active; /* Network events are processed in this iteration */
+} ClientGroupEntry;
+
+struct UA_ClientGroup {
+    int epollfd;
+    LIST_HEAD(, ClientGroupEntry) entries;
+    UA_Boolean iterating;
+    UA_Boolean removed; /* Removed entries are freed after the iteration */
+};
+
+UA_ClientGroup *
+UA_ClientGroup_new(void) {
+    UA_ClientGroup *group = (UA_ClientGroup*)UA_calloc(1, sizeof(UA_ClientGroup));
+    if(!group)
+        return NULL;
+    group->epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if(group->epollfd < 0) {
+        UA_free(group);
+        return NULL;
+    }
+    LIST_INIT(&group->entries);
+    return group;
+}
+
+void
+UA_ClientGroup_delete(UA_ClientGroup *group) {
+    ClientGroupEntry *entry, *entry_tmp;
+    LIST_FOREACH_SAFE(entry, &group->entries, pointers, entry_tmp) {
+        LIST_REMOVE(entry, pointers);
+        UA_free(entry);
+    }
+    UA_close(group->epollfd);
+    UA_free(group);
+}
+
+static ClientGroupEntry *
+findEntry(UA_ClientGroup *group, const UA_Client *client) {
+    ClientGroupEntry *entry;
+    LIST_FOREACH(entry, &group->entries, pointers) {
+        if(entry->client == client)
+            return entry;
+    }
+    return NULL;
+}
+
+UA_StatusCode
+UA_ClientGroup_add(UA_ClientGroup *group, UA_Client *client) {
+    if(findEntry(group, client))
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    ClientGroupEntry *entry = (ClientGroupEntry*)UA_malloc(sizeof(ClientGroupEntry));
+    if(!entry)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    entry->client = client;
+    entry->fd = UA_INVALID_SOCKET;
+    entry->connectionCount = 0;
+    entry->active = false;
+    LIST_INSERT_HEAD(&group->entries, entry, pointers);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_ClientGroup_remove(UA_ClientGroup *group, UA_Client *client) {
+    ClientGroupEntry *entry = findEntry(group, client);
+    if(!entry)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    /* Sockets that were closed in the meantime are removed from the epoll set
+     * automatically */
+    UA_Connection *connection = &client->connection;
+    if(entry->fd != UA_INVALID_SOCKET && connection->sockfd == entry->fd &&
+       client->connectionCount == entry->connectionCount &&
+       connection->state == UA_CONNECTION_ESTABLISHED)
+        epoll_ctl(group->epollfd, EPOLL_CTL_DEL, entry->fd, NULL);
+
+    /* Events of the current iteration might still point to the entry */
+    if(group->iterating) {
+        entry->client = NULL;
+        entry->active = false;
+        group->removed = true;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    LIST_REMOVE(entry, pointers);
+    UA_free(entry);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Register the socket of the client if it changed. Only established
+ * connections are registered. Connections that are still opening are polled by
+ * the repeated callback of the client. The kernel hands out the lowest free
+ * socket number. So a client that reconnected between two iterations mostly
+ * gets the number of its closed socket back. Hence, the connection is also
+ * compared by its count. */
+static void
+updateRegistration(UA_ClientGroup *group, ClientGroupEntry *entry) {
+    UA_Client *client = entry->client;
+    UA_Connection *connection = &client->connection;
+    UA_SOCKET fd = UA_INVALID_SOCKET;
+    if(connection->state == UA_CONNECTION_ESTABLISHED)
+        fd = connection->sockfd;
+    if(fd == entry->fd && client->connectionCount == entry->connectionCount)
+        return;
+
+    /* The previous socket was closed and thereby left the epoll set */
+    entry->fd = UA_INVALID_SOCKET;
+    if(fd == UA_INVALID_SOCKET)
+        return;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(struct epoll_event));
+    event.events = EPOLLIN;
+    event.data.ptr = entry;
+    int res = epoll_ctl(group->epollfd, EPOLL_CTL_ADD, fd, &event);
+    if(res != 0 && UA_ERRNO == EEXIST)
+        res = epoll_ctl(group->epollfd, EPOLL_CTL_MOD, fd, &event);
+    if(res != 0) {
+        UA_LOG_WARNING(&client->config.logger, UA_LOGCATEGORY_NETWORK,
+                       "Connection %i | Could not add the socket to the "
+                       "client group: %s", (int)fd, strerror(UA_ERRNO));
+        return;
+    }
+    entry->fd = fd;
+    entry->connectionCount = client->connectionCount;
+}
+
+static void
+cleanupRemoved(UA_ClientGroup *group) {
+    ClientGroupEntry *entry, *entry_tmp;
+    LIST_FOREACH_SAFE(entry, &group->entries, pointers, entry_tmp) {
+        if(entry->client)
+            continue;
+        LIST_REMOVE(entry, pointers);
+        UA_free(entry);
+    }
+    group->removed = false;
+}
+
+UA_StatusCode
+UA_ClientGroup_run_iterate(UA_ClientGroup *group, UA_UInt16 timeout) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    group->iterating = true;
+
+    /* Timed callbacks and connection establishment of all clients */
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    UA_DateTime maxDate = now + (timeout * UA_DATETIME_MSEC);
+    ClientGroupEntry *entry;
+    LIST_FOREACH(entry, &group->entries, pointers) {
+        if(!entry->client)
+            continue;
+        UA_DateTime nextTimer = UA_INT64_MAX;
+        UA_StatusCode res = UA_Client_iterateBegin(entry->client, &nextTimer);
+        if(!entry->client)
+            continue;
+        entry->active = (res == UA_STATUSCODE_GOOD);
+        updateRegistration(group, entry);
+        if(nextTimer < maxDate)
+            maxDate = nextTimer;
+    }
+
+    /* Wait for network events of all clients at once. Round up to avoid
+     * spinning until the next timed callback is due. */
+    int waitMs = 0;
+    now = UA_DateTime_nowMonotonic();
+    if(maxDate > now)
+        waitMs = (int)((maxDate - now + (UA_DATETIME_MSEC - 1)) / UA_DATETIME_MSEC);
+    struct epoll_event events[UA_CLIENTGROUP_MAXEVENTS];
+    int eventsSize = epoll_wait(group->epollfd, events, UA_CLIENTGROUP_MAXEVENTS, waitMs);
+    if(eventsSize < 0) {
+        eventsSize = 0;
+        if(UA_ERRNO != EINTR)
+            retval = UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    /* Receive on the readable connections only. The socket does not need to
+     * be polled again. */
+    for(int i = 0; i < eventsSize; i++) {
+        entry = (ClientGroupEntry*)events[i].data.ptr;
+        if(!entry->client || !entry->active)
+            continue;
+        UA_Client_iterateReceive(entry->client, 0);
+    }
+
+    /* Inactivity, timeout checks and delayed callbacks */
+    LIST_FOREACH(entry, &group->entries, pointers) {
+        if(!entry->client || !entry->active)
+            continue;
+        entry->active = false;
+        UA_Client_iterateEnd(entry->client);
+    }
+
+    group->iterating = false;
+    if(group->removed)
+        cleanupRemoved(group);
+    return retval;
+}
+
+#endif /* UA_ENABLE_CLIENT_GROUP */
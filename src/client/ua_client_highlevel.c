@@ -15,6 +15,7 @@
 #include "ua_client_internal.h"
 #include "ua_client_highlevel.h"
 #include "ua_client_highlevel_async.h"
+#include "ua_types_encoding_binary.h"
 #include "ua_util.h"
 
 UA_StatusCode
@@ -459,6 +460,395 @@ UA_Client_readArrayDimensionsAttribute(UA_Client *client, const UA_NodeId nodeId
     return retval;
 }
 
+/*********************/
+/* Pipelined Reading */
+/*********************/
+
+typedef struct {
+    UA_DataValue *results;
+    size_t pending; /* Requests without a response */
+} PipelinedRead;
+
+typedef struct {
+    PipelinedRead *read;
+    size_t offset;
+    size_t size;
+    UA_UInt32 requestId;
+} PipelinedReadRequest;
+
+/* Sends the ReadRequest for the items of req */
+typedef UA_StatusCode
+(*PipelinedReadSend)(UA_Client *client, void *context, PipelinedReadRequest *req);
+
+static void
+pipelinedReadCallback(UA_Client *client, void *userdata,
+                      UA_UInt32 requestId, void *r) {
+    PipelinedReadRequest *req = (PipelinedReadRequest*)userdata;
+    UA_ReadResponse *response = (UA_ReadResponse*)r;
+    UA_StatusCode res = response->responseHeader.serviceResult;
+    if(res == UA_STATUSCODE_GOOD && response->resultsSize != req->size)
+        res = UA_STATUSCODE_BADUNEXPECTEDERROR;
+
+    /* Move the results out of the response */
+    for(size_t i = 0; i < req->size; i++) {
+        UA_DataValue *dv = &req->read->results[req->offset + i];
+        if(res != UA_STATUSCODE_GOOD) {
+            dv->hasStatus = true;
+            dv->status = res;
+            continue;
+        }
+        *dv = response->results[i];
+        UA_DataValue_init(&response->results[i]);
+    }
+    req->read->pending--;
+}
+
+/* Send the requests within the window of pipelined requests and process the
+ * responses until all requests are answered */
+static UA_StatusCode
+runPipelinedRead(UA_Client *client, UA_DataValue *results,
+                 PipelinedReadRequest *reqs, size_t requestsSize,
+                 PipelinedReadSend send, void *context) {
+    PipelinedRead read;
+    read.results = results;
+    read.pending = 0;
+
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    size_t sent = 0;
+    size_t lastPending = 0;
+    UA_DateTime maxDate = UA_DateTime_nowMonotonic() +
+        (client->config.timeout * UA_DATETIME_MSEC);
+    while(sent < requestsSize || read.pending > 0) {
+        /* Fill the window */
+        while(sent < requestsSize) {
+            reqs[sent].read = &read;
+            retval = send(client, context, &reqs[sent]);
+            if(retval == UA_STATUSCODE_BADTOOMANYOPERATIONS) {
+                retval = UA_STATUSCODE_GOOD;
+                break;
+            }
+            if(retval != UA_STATUSCODE_GOOD)
+                goto cleanup;
+            read.pending++;
+            sent++;
+        }
+
+        /* The timeout restarts whenever a response arrives */
+        UA_DateTime now = UA_DateTime_nowMonotonic();
+        if(read.pending < lastPending)
+            maxDate = now + (client->config.timeout * UA_DATETIME_MSEC);
+        lastPending = read.pending;
+        if(now >= maxDate) {
+            retval = UA_STATUSCODE_BADTIMEOUT;
+            goto cleanup;
+        }
+
+        /* Receive and process the next packet. If the window is occupied by
+         * other async requests, their responses make room. */
+        UA_UInt32 timeout = (UA_UInt32)(((maxDate - now) + (UA_DATETIME_MSEC - 1)) /
+                                        UA_DATETIME_MSEC);
+        retval = receiveServiceResponseAsync(client, NULL, NULL, timeout);
+        if(retval == UA_STATUSCODE_GOODNONCRITICALTIMEOUT)
+            retval = UA_STATUSCODE_GOOD;
+        if(retval != UA_STATUSCODE_GOOD)
+            goto cleanup;
+    }
+
+ cleanup:
+    /* Cancel the requests that are still pending. Their results get the
+     * StatusCode. Completed requests are no longer found. */
+    for(size_t i = 0; i < sent && read.pending > 0; i++)
+        UA_Client_AsyncService_cancelById(client, reqs[i].requestId, retval);
+    return retval;
+}
+
+typedef struct {
+    const UA_ReadValueId *nodesToRead;
+    UA_TimestampsToReturn timestampsToReturn;
+} ReadPipelinedContext;
+
+static UA_StatusCode
+sendReadPipelined(UA_Client *client, void *context, PipelinedReadRequest *req) {
+    ReadPipelinedContext *ctx = (ReadPipelinedContext*)context;
+    UA_ReadRequest request;
+    UA_ReadRequest_init(&request);
+    request.nodesToRead = (UA_ReadValueId*)(uintptr_t)&ctx->nodesToRead[req->offset];
+    request.nodesToReadSize = req->size;
+    request.timestampsToReturn = ctx->timestampsToReturn;
+    return __UA_Client_AsyncService(client, &request, &UA_TYPES[UA_TYPES_READREQUEST],
+                                    pipelinedReadCallback,
+                                    &UA_TYPES[UA_TYPES_READRESPONSE],
+                                    req, &req->requestId);
+}
+
+UA_StatusCode
+UA_Client_readPipelined(UA_Client *client, const UA_ReadValueId *nodesToRead,
+                        size_t nodesToReadSize, size_t nodesPerRequest,
+                        UA_TimestampsToReturn timestampsToReturn,
+                        UA_DataValue *results) {
+    if(client->state < UA_CLIENTSTATE_SECURECHANNEL)
+        return UA_STATUSCODE_BADSERVERNOTCONNECTED;
+    for(size_t i = 0; i < nodesToReadSize; i++)
+        UA_DataValue_init(&results[i]);
+    if(nodesToReadSize == 0)
+        return UA_STATUSCODE_GOOD;
+    if(nodesPerRequest == 0 || nodesPerRequest > nodesToReadSize)
+        nodesPerRequest = nodesToReadSize;
+
+    size_t requestsSize = (nodesToReadSize + nodesPerRequest - 1) / nodesPerRequest;
+    PipelinedReadRequest *reqs = (PipelinedReadRequest*)
+        UA_calloc(requestsSize, sizeof(PipelinedReadRequest));
+    if(!reqs)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(size_t i = 0; i < requestsSize; i++) {
+        reqs[i].offset = i * nodesPerRequest;
+        reqs[i].size = nodesToReadSize - reqs[i].offset;
+        if(reqs[i].size > nodesPerRequest)
+            reqs[i].size = nodesPerRequest;
+    }
+
+    ReadPipelinedContext ctx;
+    ctx.nodesToRead = nodesToRead;
+    ctx.timestampsToReturn = timestampsToReturn;
+    UA_StatusCode retval = runPipelinedRead(client, results, reqs, requestsSize,
+                                            sendReadPipelined, &ctx);
+    UA_free(reqs);
+    return retval;
+}
+
+/****************/
+/* Read Planner */
+/****************/
+
+/* Bytes reserved in every message for the chunk headers, the request type and
+ * the RequestHeader */
+#define UA_READPLAN_MESSAGEOVERHEAD 512
+
+struct UA_ClientReadPlan {
+    UA_TimestampsToReturn timestampsToReturn;
+    size_t itemsSize;
+    UA_ReadValueId *items;
+    UA_DataValue *results;
+
+    /* The ReadRequests are prepared once. Only the RequestHeader is encoded
+     * for every execution. */
+    UA_Boolean prepared;
+    size_t requestsSize;
+    PipelinedReadRequest *requests;
+    UA_ByteString *encodedRequests; /* Encoding after the RequestHeader */
+};
+
+UA_ClientReadPlan *
+UA_ClientReadPlan_new(UA_TimestampsToReturn timestampsToReturn) {
+    UA_ClientReadPlan *plan = (UA_ClientReadPlan*)UA_calloc(1, sizeof(UA_ClientReadPlan));
+    if(!plan)
+        return NULL;
+    plan->timestampsToReturn = timestampsToReturn;
+    return plan;
+}
+
+static void
+ReadPlan_clearRequests(UA_ClientReadPlan *plan) {
+    for(size_t i = 0; i < plan->requestsSize; i++)
+        UA_ByteString_deleteMembers(&plan->encodedRequests[i]);
+    UA_free(plan->encodedRequests);
+    UA_free(plan->requests);
+    plan->encodedRequests = NULL;
+    plan->requests = NULL;
+    plan->requestsSize = 0;
+    plan->prepared = false;
+}
+
+void
+UA_ClientReadPlan_delete(UA_ClientReadPlan *plan) {
+    ReadPlan_clearRequests(plan);
+    UA_Array_delete(plan->items, plan->itemsSize, &UA_TYPES[UA_TYPES_READVALUEID]);
+    UA_Array_delete(plan->results, plan->itemsSize, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    UA_free(plan);
+}
+
+UA_StatusCode
+UA_ClientReadPlan_add(UA_ClientReadPlan *plan, const UA_NodeId nodeId,
+                      UA_AttributeId attributeId, size_t *resultIndex) {
+    /* Grow the arrays */
+    size_t newSize = plan->itemsSize + 1;
+    UA_ReadValueId *items = (UA_ReadValueId*)
+        UA_realloc(plan->items, newSize * sizeof(UA_ReadValueId));
+    if(!items)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    plan->items = items;
+    UA_DataValue *results = (UA_DataValue*)
+        UA_realloc(plan->results, newSize * sizeof(UA_DataValue));
+    if(!results)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    plan->results = results;
+
+    UA_ReadValueId *item = &plan->items[plan->itemsSize];
+    UA_ReadValueId_init(item);
+    UA_StatusCode retval = UA_NodeId_copy(&nodeId, &item->nodeId);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    item->attributeId = attributeId;
+    UA_DataValue_init(&plan->results[plan->itemsSize]);
+    if(resultIndex)
+        *resultIndex = plan->itemsSize;
+    plan->itemsSize = newSize;
+
+    /* The requests need to be prepared again */
+    ReadPlan_clearRequests(plan);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Returns zero if the server does not announce the limit */
+static UA_UInt32
+readMaxNodesPerRead(UA_Client *client) {
+    UA_Variant val;
+    UA_StatusCode retval = UA_Client_readValueAttribute(client,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERCAPABILITIES_OPERATIONLIMITS_MAXNODESPERREAD),
+        &val);
+    if(retval != UA_STATUSCODE_GOOD)
+        return 0;
+    UA_UInt32 maxNodes = 0;
+    if(UA_Variant_hasScalarType(&val, &UA_TYPES[UA_TYPES_UINT32]))
+        maxNodes = *(UA_UInt32*)val.data;
+    UA_Variant_deleteMembers(&val);
+    return maxNodes;
+}
+
+/* Encode the request and keep only the part after the RequestHeader */
+static UA_StatusCode
+encodeReadRequestBody(UA_ClientReadPlan *plan, PipelinedReadRequest *req,
+                      UA_ByteString *encoded) {
+    UA_ReadRequest request;
+    UA_ReadRequest_init(&request);
+    request.nodesToRead = &plan->items[req->offset];
+    request.nodesToReadSize = req->size;
+    request.timestampsToReturn = plan->timestampsToReturn;
+
+    size_t headerSize = UA_calcSizeBinary(&request.requestHeader,
+                                          &UA_TYPES[UA_TYPES_REQUESTHEADER]);
+    size_t requestSize = UA_calcSizeBinary(&request, &UA_TYPES[UA_TYPES_READREQUEST]);
+    UA_StatusCode retval = UA_ByteString_allocBuffer(encoded, requestSize);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_Byte *bufPos = encoded->data;
+    const UA_Byte *bufEnd = &encoded->data[encoded->length];
+    retval = UA_encodeBinary(&request, &UA_TYPES[UA_TYPES_READREQUEST],
+                             &bufPos, &bufEnd, NULL, NULL);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_ByteString_deleteMembers(encoded);
+        return retval;
+    }
+    memmove(encoded->data, &encoded->data[headerSize], requestSize - headerSize);
+    encoded->length = requestSize - headerSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_ClientReadPlan_prepare(UA_ClientReadPlan *plan, UA_Client *client) {
+    if(client->state < UA_CLIENTSTATE_SECURECHANNEL)
+        return UA_STATUSCODE_BADSERVERNOTCONNECTED;
+    ReadPlan_clearRequests(plan);
+    if(plan->itemsSize == 0) {
+        plan->prepared = true;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    /* Limits of the server. The maximum message size was negotiated with the
+     * HEL/ACK handshake. A limit below the overhead still splits into one item
+     * per request. */
+    UA_UInt32 maxNodes = readMaxNodesPerRead(client);
+    size_t maxBodySize = 0;
+    UA_UInt32 maxMessageSize = client->connection.config.maxMessageSize;
+    if(maxMessageSize > UA_READPLAN_MESSAGEOVERHEAD)
+        maxBodySize = maxMessageSize - UA_READPLAN_MESSAGEOVERHEAD;
+    else if(maxMessageSize > 0)
+        maxBodySize = 1;
+
+    /* Split into requests. Every request holds at least one item. */
+    plan->requests = (PipelinedReadRequest*)
+        UA_calloc(plan->itemsSize, sizeof(PipelinedReadRequest));
+    if(!plan->requests)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    PipelinedReadRequest *req = NULL;
+    size_t bodySize = 0;
+    for(size_t i = 0; i < plan->itemsSize; i++) {
+        size_t itemSize = UA_calcSizeBinary(&plan->items[i],
+                                            &UA_TYPES[UA_TYPES_READVALUEID]);
+        if(!req || (maxNodes > 0 && req->size >= maxNodes) ||
+           (maxBodySize > 0 && bodySize + itemSize > maxBodySize)) {
+            req = &plan->requests[plan->requestsSize++];
+            req->offset = i;
+            bodySize = 0;
+        }
+        req->size++;
+        bodySize += itemSize;
+    }
+
+    /* Pre-encode the requests */
+    plan->encodedRequests = (UA_ByteString*)
+        UA_calloc(plan->requestsSize, sizeof(UA_ByteString));
+    if(!plan->encodedRequests) {
+        ReadPlan_clearRequests(plan);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    for(size_t i = 0; i < plan->requestsSize; i++) {
+        UA_StatusCode retval = encodeReadRequestBody(plan, &plan->requests[i],
+                                                     &plan->encodedRequests[i]);
+        if(retval != UA_STATUSCODE_GOOD) {
+            ReadPlan_clearRequests(plan);
+            return retval;
+        }
+    }
+
+    plan->prepared = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+sendReadPlanRequest(UA_Client *client, void *context, PipelinedReadRequest *req) {
+    UA_ClientReadPlan *plan = (UA_ClientReadPlan*)context;
+    UA_RequestHeader header;
+    UA_RequestHeader_init(&header);
+    size_t index = (size_t)(req - plan->requests);
+    return UA_Client_AsyncService_sendEncoded(client, &header,
+                                              &UA_TYPES[UA_TYPES_READREQUEST],
+                                              &plan->encodedRequests[index],
+                                              pipelinedReadCallback,
+                                              &UA_TYPES[UA_TYPES_READRESPONSE],
+                                              req, &req->requestId);
+}
+
+UA_StatusCode
+UA_ClientReadPlan_execute(UA_ClientReadPlan *plan, UA_Client *client) {
+    if(client->state < UA_CLIENTSTATE_SECURECHANNEL)
+        return UA_STATUSCODE_BADSERVERNOTCONNECTED;
+    if(!plan->prepared) {
+        UA_StatusCode retval = UA_ClientReadPlan_prepare(plan, client);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+
+    /* Clean up the results of the last execution */
+    for(size_t i = 0; i < plan->itemsSize; i++)
+        UA_DataValue_deleteMembers(&plan->results[i]);
+
+    return runPipelinedRead(client, plan->results, plan->requests,
+                            plan->requestsSize, sendReadPlanRequest, plan);
+}
+
+const UA_DataValue *
+UA_ClientReadPlan_getResult(const UA_ClientReadPlan *plan, size_t resultIndex) {
+    if(resultIndex >= plan->itemsSize)
+        return NULL;
+    return &plan->results[resultIndex];
+}
+
+size_t
+UA_ClientReadPlan_getRequestsSize(const UA_ClientReadPlan *plan) {
+    return plan->requestsSize;
+}
+
 /*********************/
 /* Historical Access */
 /*********************/
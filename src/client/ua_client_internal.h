@@ -107,11 +107,39 @@ typedef struct AsyncServiceCall {
     UA_DateTime start;
     UA_UInt32 timeout;
     void *responsedata;
+    UA_Boolean pipelined; /* Counts against maxPipelinedRequests */
 } AsyncServiceCall;
 
+/* The outstanding async service calls are stored in a hash table with the
+ * requestId as the key. RequestIds are assigned sequentially, so the calls are
+ * spread evenly over the buckets. Must be a power of two. */
+#define UA_CLIENT_ASYNCSERVICE_BUCKETS 128
+
+#define UA_CLIENT_ASYNCSERVICE_BUCKET(client, requestId) \
+    (&(client)->asyncServiceCalls[(requestId) & (UA_CLIENT_ASYNCSERVICE_BUCKETS - 1)])
+
+/* Remove the call from the hash table. The memory is not freed. */
+void UA_Client_AsyncService_remove(UA_Client *client, AsyncServiceCall *ac);
+
 void UA_Client_AsyncService_cancel(UA_Client *client, AsyncServiceCall *ac,
                                    UA_StatusCode statusCode);
 
+/* Send an async request whose content after the RequestHeader is already
+ * encoded. The RequestHeader is adjusted for every request. */
+UA_StatusCode
+UA_Client_AsyncService_sendEncoded(UA_Client *client, UA_RequestHeader *requestHeader,
+                                   const UA_DataType *requestType,
+                                   const UA_ByteString *encodedBody,
+                                   UA_ClientAsyncServiceCallback callback,
+                                   const UA_DataType *responseType,
+                                   void *userdata, UA_UInt32 *requestId);
+
+/* Cancel a single outstanding call. The callback is executed with the
+ * statusCode. Returns UA_STATUSCODE_BADNOTFOUND if the call is not pending. */
+UA_StatusCode
+UA_Client_AsyncService_cancelById(UA_Client *client, UA_UInt32 requestId,
+                                  UA_StatusCode statusCode);
+
 void UA_Client_AsyncService_removeAll(UA_Client *client, UA_StatusCode statusCode);
 
 typedef struct CustomCallback {
@@ -141,6 +169,7 @@ struct UA_Client {
 
     /* Connection */
     UA_Connection connection;
+    UA_UInt32 connectionCount; /* Incremented for every new connection */
     UA_String endpointUrl;
 
     /* SecureChannel */
@@ -163,7 +192,9 @@ struct UA_Client {
 
     /* Async Service */
     AsyncServiceCall asyncConnectCall;
-    LIST_HEAD(ListOfAsyncServiceCall, AsyncServiceCall) asyncServiceCalls;
+    LIST_HEAD(ListOfAsyncServiceCall, AsyncServiceCall)
+        asyncServiceCalls[UA_CLIENT_ASYNCSERVICE_BUCKETS];
+    size_t pipelinedRequests; /* Calls with the pipelined flag */
     /*When using highlevel functions these are the callbacks that can be accessed by the user*/
     LIST_HEAD(ListOfCustomCallback, CustomCallback) customCallbacks;
 
@@ -198,7 +229,7 @@ UA_Client_getEndpointsInternal(UA_Client *client,
 /* Receive and process messages until a synchronous message arrives or the
  * timout finishes */
 UA_StatusCode
-receivePacketAsync(UA_Client *client);
+receivePacketAsync(UA_Client *client, UA_UInt32 timeout);
 
 UA_StatusCode
 processACKResponseAsync(void *application, UA_Connection *connection,
@@ -218,11 +249,30 @@ receiveServiceResponse(UA_Client *client, void *response,
 
 UA_StatusCode
 receiveServiceResponseAsync(UA_Client *client, void *response,
-                             const UA_DataType *responseType);
+                             const UA_DataType *responseType, UA_UInt32 timeout);
 
 UA_StatusCode
 UA_Client_connect_iterate (UA_Client *client);
 
+/* The non-blocking iteration of UA_Client_run_iterate is split into three
+ * steps. That way, the network events of many clients can be awaited together
+ * (see UA_ClientGroup). */
+
+/* Background publishing, channel renewal, timed callbacks and connection
+ * establishment. The time of the next timed callback is returned in nextTimer
+ * (can be NULL). */
+UA_StatusCode
+UA_Client_iterateBegin(UA_Client *client, UA_DateTime *nextTimer);
+
+/* Receive and process (at most) one packet. The timeout (in ms) is zero when
+ * the connection is known to be readable. */
+UA_StatusCode
+UA_Client_iterateReceive(UA_Client *client, UA_UInt32 timeout);
+
+/* Inactivity and timeout checks, delayed callbacks */
+void
+UA_Client_iterateEnd(UA_Client *client);
+
 _UA_END_DECLS
 
 #endif /* UA_CLIENT_INTERNAL_H_ */
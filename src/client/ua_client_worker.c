@@ -11,15 +11,17 @@ asyncServiceTimeoutCheck(UA_Client *client) {
     UA_DateTime now = UA_DateTime_nowMonotonic();
 
     /* Timeout occurs, remove the callback */
-    AsyncServiceCall *ac, *ac_tmp;
-    LIST_FOREACH_SAFE(ac, &client->asyncServiceCalls, pointers, ac_tmp) {
-        if(!ac->timeout)
-           continue;
-
-        if(ac->start + (UA_DateTime)(ac->timeout * UA_DATETIME_MSEC) <= now) {
-            LIST_REMOVE(ac, pointers);
-            UA_Client_AsyncService_cancel(client, ac, UA_STATUSCODE_BADTIMEOUT);
-            UA_free(ac);
+    for(size_t i = 0; i < UA_CLIENT_ASYNCSERVICE_BUCKETS; i++) {
+        AsyncServiceCall *ac, *ac_tmp;
+        LIST_FOREACH_SAFE(ac, &client->asyncServiceCalls[i], pointers, ac_tmp) {
+            if(!ac->timeout)
+               continue;
+
+            if(ac->start + (UA_DateTime)(ac->timeout * UA_DATETIME_MSEC) <= now) {
+                UA_Client_AsyncService_remove(client, ac);
+                UA_Client_AsyncService_cancel(client, ac, UA_STATUSCODE_BADTIMEOUT);
+                UA_free(ac);
+            }
         }
     }
 }
@@ -64,6 +66,10 @@ UA_Client_backgroundConnectivity(UA_Client *client) {
                                                     (UA_ClientAsyncServiceCallback)backgroundConnectivityCallback,
                                                     &UA_TYPES[UA_TYPES_READRESPONSE], NULL, NULL);
 
+    /* The pipeline is full. The pending requests check the connectivity. */
+    if(retval == UA_STATUSCODE_BADTOOMANYOPERATIONS)
+        return UA_STATUSCODE_GOOD;
+
     client->pendingConnectivityCheck = true;
 
     return retval;
@@ -87,65 +93,92 @@ clientExecuteRepeatedCallback(UA_Client *client, UA_ApplicationCallback cb,
      * UA_WorkQueue_enqueue(&client->workQueue, cb, callbackApplication, data); */
 }
 
-UA_StatusCode UA_Client_run_iterate(UA_Client *client, UA_UInt16 timeout) {
-// TODO connectivity check & timeout features for the async implementation (timeout == 0)
-    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+UA_StatusCode
+UA_Client_iterateBegin(UA_Client *client, UA_DateTime *nextTimer) {
 #ifdef UA_ENABLE_SUBSCRIPTIONS
     UA_StatusCode retvalPublish = UA_Client_Subscriptions_backgroundPublish(client);
     if(client->state >= UA_CLIENTSTATE_SESSION && retvalPublish != UA_STATUSCODE_GOOD)
         return retvalPublish;
 #endif
-    /* Make sure we have an open channel */
 
     /************************************************************/
     /* FIXME: This is a dirty workaround */
     if(client->state >= UA_CLIENTSTATE_SECURECHANNEL)
-        retval = openSecureChannel(client, true);
+        openSecureChannel(client, true);
     /* FIXME: Will most likely break somewhere in the future */
     /************************************************************/
 
-    if(timeout) {
-        if(retval != UA_STATUSCODE_GOOD)
-            return retval;
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    UA_DateTime next = UA_Timer_process(&client->timer, now,
+                         (UA_TimerExecutionCallback)clientExecuteRepeatedCallback, client);
+    if(nextTimer)
+        *nextTimer = next;
 
-        retval = UA_Client_backgroundConnectivity(client);
-        if(retval != UA_STATUSCODE_GOOD)
-            return retval;
+    return UA_Client_connect_iterate(client);
+}
 
-        UA_DateTime maxDate = UA_DateTime_nowMonotonic() + (timeout * UA_DATETIME_MSEC);
-        retval = receiveServiceResponse(client, NULL, NULL, maxDate, NULL);
-        if(retval == UA_STATUSCODE_GOODNONCRITICALTIMEOUT)
-            retval = UA_STATUSCODE_GOOD;
-    }
+UA_StatusCode
+UA_Client_iterateReceive(UA_Client *client, UA_UInt32 timeout) {
+    UA_ClientState cs = UA_Client_getState(client);
+    if((cs == UA_CLIENTSTATE_SECURECHANNEL) || (cs == UA_CLIENTSTATE_SESSION))
+        return receiveServiceResponseAsync(client, NULL, NULL, timeout);
+    return receivePacketAsync(client, timeout);
+}
 
-    else{
-        UA_DateTime now = UA_DateTime_nowMonotonic();
-        UA_Timer_process(&client->timer, now,
-                         (UA_TimerExecutionCallback)clientExecuteRepeatedCallback, client);
+void
+UA_Client_iterateEnd(UA_Client *client) {
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    /* The inactivity check must be done after receiveServiceResponse*/
+    UA_Client_Subscriptions_backgroundPublishInactivityCheck(client);
+#endif
+    asyncServiceTimeoutCheck(client);
 
-        UA_ClientState cs = UA_Client_getState(client);
-        retval = UA_Client_connect_iterate(client);
+#ifndef UA_ENABLE_MULTITHREADING
+    /* Process delayed callbacks when all callbacks and network events are
+     * done */
+    UA_WorkQueue_manuallyProcessDelayed(&client->workQueue);
+#endif
+}
 
+UA_StatusCode UA_Client_run_iterate(UA_Client *client, UA_UInt16 timeout) {
+// TODO connectivity check & timeout features for the async implementation (timeout == 0)
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(!timeout) {
+        retval = UA_Client_iterateBegin(client, NULL);
         /* Connection failed, drop the rest */
         if(retval != UA_STATUSCODE_GOOD)
             return retval;
-        if((cs == UA_CLIENTSTATE_SECURECHANNEL) || (cs == UA_CLIENTSTATE_SESSION)) {
-            /* Check for new data */
-            retval = receiveServiceResponseAsync(client, NULL, NULL);
-        } else {
-            retval = receivePacketAsync(client);
-        }
+        retval = UA_Client_iterateReceive(client, 1);
+        UA_Client_iterateEnd(client);
+        return retval;
     }
+
 #ifdef UA_ENABLE_SUBSCRIPTIONS
-        /* The inactivity check must be done after receiveServiceResponse*/
-        UA_Client_Subscriptions_backgroundPublishInactivityCheck(client);
+    UA_StatusCode retvalPublish = UA_Client_Subscriptions_backgroundPublish(client);
+    if(client->state >= UA_CLIENTSTATE_SESSION && retvalPublish != UA_STATUSCODE_GOOD)
+        return retvalPublish;
 #endif
-        asyncServiceTimeoutCheck(client);
+    /* Make sure we have an open channel */
 
-#ifndef UA_ENABLE_MULTITHREADING
-        /* Process delayed callbacks when all callbacks and network events are
-         * done */
-        UA_WorkQueue_manuallyProcessDelayed(&client->workQueue);
-#endif
+    /************************************************************/
+    /* FIXME: This is a dirty workaround */
+    if(client->state >= UA_CLIENTSTATE_SECURECHANNEL)
+        retval = openSecureChannel(client, true);
+    /* FIXME: Will most likely break somewhere in the future */
+    /************************************************************/
+
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    retval = UA_Client_backgroundConnectivity(client);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_DateTime maxDate = UA_DateTime_nowMonotonic() + (timeout * UA_DATETIME_MSEC);
+    retval = receiveServiceResponse(client, NULL, NULL, maxDate, NULL);
+    if(retval == UA_STATUSCODE_GOODNONCRITICALTIMEOUT)
+        retval = UA_STATUSCODE_GOOD;
+
+    UA_Client_iterateEnd(client);
     return retval;
 }
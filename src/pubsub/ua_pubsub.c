@@ -8,6 +8,7 @@
 
 #include "server/ua_server_internal.h"
 #include "ua_types_encoding_binary.h"
+#include "ua_types_generated_encoding_binary.h"
 
 #ifdef UA_ENABLE_PUBSUB /* conditional compilation */
 
@@ -20,12 +21,18 @@
 #include "ua_pubsub_ns0.h"
 #endif
 
-#define UA_MAX_STACKBUF 512 /* Max size of network messages on the stack */
+#define UA_MAX_EXTERNALVALUE_RETRIES 1000 /* Retries to sample a consistent value */
 
 /* Forward declaration */
 static void
 UA_WriterGroup_deleteMembers(UA_Server *server, UA_WriterGroup *writerGroup);
 static void
+UA_WriterGroup_clearTemplates(UA_WriterGroup *writerGroup);
+static void
+invalidateTemplates(UA_Server *server);
+static void
+UA_WriterGroup_removePublishCallback(UA_Server *server, UA_WriterGroup *writerGroup);
+static void
 UA_DataSetField_deleteMembers(UA_DataSetField *field);
 
 /**********************************************/
@@ -107,6 +114,11 @@ UA_PubSubConnection_deleteMembers(UA_Server *server, UA_PubSubConnection *connec
     LIST_FOREACH_SAFE(writerGroup, &connection->writerGroups, listEntry, tmpWriterGroup){
         UA_Server_removeWriterGroup(server, writerGroup->identifier);
     }
+    //remove contained ReaderGroups
+    UA_ReaderGroup *readerGroup, *tmpReaderGroup;
+    LIST_FOREACH_SAFE(readerGroup, &connection->readerGroups, listEntry, tmpReaderGroup){
+        UA_Server_removeReaderGroup(server, readerGroup->identifier);
+    }
     UA_NodeId_deleteMembers(&connection->identifier);
     if(connection->channel){
         connection->channel->close(connection->channel);
@@ -114,13 +126,17 @@ UA_PubSubConnection_deleteMembers(UA_Server *server, UA_PubSubConnection *connec
     UA_free(connection->config);
 }
 
-UA_StatusCode
-UA_Server_addWriterGroup(UA_Server *server, const UA_NodeId connection,
-                         const UA_WriterGroupConfig *writerGroupConfig,
-                         UA_NodeId *writerGroupIdentifier) {
+static UA_StatusCode
+addWriterGroup(UA_Server *server, const UA_NodeId connection,
+               const UA_WriterGroupConfig *writerGroupConfig,
+               UA_NodeId *writerGroupIdentifier) {
     UA_StatusCode retVal = UA_STATUSCODE_GOOD;
     if(!writerGroupConfig)
         return UA_STATUSCODE_BADINVALIDARGUMENT;
+#ifndef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    if(writerGroupConfig->publisherThread.enabled)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+#endif
     //search the connection by the given connectionIdentifier
     UA_PubSubConnection *currentConnectionContext =
         UA_PubSubConnection_findConnectionbyId(server, connection);
@@ -150,7 +166,18 @@ UA_Server_addWriterGroup(UA_Server *server, const UA_NodeId connection,
 }
 
 UA_StatusCode
-UA_Server_removeWriterGroup(UA_Server *server, const UA_NodeId writerGroup){
+UA_Server_addWriterGroup(UA_Server *server, const UA_NodeId connection,
+                         const UA_WriterGroupConfig *writerGroupConfig,
+                         UA_NodeId *writerGroupIdentifier) {
+    UA_PUBSUB_LOCK(server);
+    UA_StatusCode retval =
+        addWriterGroup(server, connection, writerGroupConfig, writerGroupIdentifier);
+    UA_PUBSUB_UNLOCK(server);
+    return retval;
+}
+
+static UA_StatusCode
+removeWriterGroup(UA_Server *server, const UA_NodeId writerGroup){
     UA_WriterGroup *wg = UA_WriterGroup_findWGbyId(server, writerGroup);
     if(!wg)
         return UA_STATUSCODE_BADNOTFOUND;
@@ -161,7 +188,7 @@ UA_Server_removeWriterGroup(UA_Server *server, const UA_NodeId writerGroup){
         return UA_STATUSCODE_BADNOTFOUND;
 
     //unregister the publish callback
-    UA_PubSubManager_removeRepeatedPubSubCallback(server, wg->publishCallbackId);
+    UA_WriterGroup_removePublishCallback(server, wg);
 #ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL
     removeGroupRepresentation(server, wg);
 #endif
@@ -172,6 +199,19 @@ UA_Server_removeWriterGroup(UA_Server *server, const UA_NodeId writerGroup){
     return UA_STATUSCODE_GOOD;
 }
 
+UA_StatusCode
+UA_Server_removeWriterGroup(UA_Server *server, const UA_NodeId writerGroup) {
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    UA_WriterGroup *wg = UA_WriterGroup_findWGbyId(server, writerGroup);
+    if(wg)
+        UA_WriterGroup_stopPublisherThread(wg);
+#endif
+    UA_PUBSUB_LOCK(server);
+    UA_StatusCode retval = removeWriterGroup(server, writerGroup);
+    UA_PUBSUB_UNLOCK(server);
+    return retval;
+}
+
 /**********************************************/
 /*               PublishedDataSet             */
 /**********************************************/
@@ -265,10 +305,10 @@ UA_PublishedDataSet_deleteMembers(UA_Server *server, UA_PublishedDataSet *publis
     UA_NodeId_deleteMembers(&publishedDataSet->identifier);
 }
 
-UA_DataSetFieldResult
-UA_Server_addDataSetField(UA_Server *server, const UA_NodeId publishedDataSet,
-                          const UA_DataSetFieldConfig *fieldConfig,
-                          UA_NodeId *fieldIdentifier) {
+static UA_DataSetFieldResult
+addDataSetField(UA_Server *server, const UA_NodeId publishedDataSet,
+                const UA_DataSetFieldConfig *fieldConfig,
+                UA_NodeId *fieldIdentifier) {
     UA_StatusCode retVal = UA_STATUSCODE_GOOD;
 	UA_DataSetFieldResult result = {UA_STATUSCODE_BADINVALIDARGUMENT, {0, 0}};
     if(!fieldConfig)
@@ -285,6 +325,10 @@ UA_Server_addDataSetField(UA_Server *server, const UA_NodeId publishedDataSet,
         return result;
 	}
 
+    if(fieldConfig->field.variable.externalValue.enabled &&
+       !fieldConfig->field.variable.externalValue.value)
+        return result;
+
     UA_DataSetField *newField = (UA_DataSetField *) UA_calloc(1, sizeof(UA_DataSetField));
 	if(!newField){
 		result.result = UA_STATUSCODE_BADINTERNALERROR;
@@ -305,6 +349,7 @@ UA_Server_addDataSetField(UA_Server *server, const UA_NodeId publishedDataSet,
     if(newField->config.field.variable.promotedField)
         currentDataSet->promotedFieldsCount++;
     currentDataSet->fieldSize++;
+    invalidateTemplates(server);
 	result.result = retVal;
 	result.configurationVersion.majorVersion = currentDataSet->dataSetMetaData.configurationVersion.majorVersion;
 	result.configurationVersion.minorVersion = currentDataSet->dataSetMetaData.configurationVersion.minorVersion;
@@ -312,7 +357,18 @@ UA_Server_addDataSetField(UA_Server *server, const UA_NodeId publishedDataSet,
 }
 
 UA_DataSetFieldResult
-UA_Server_removeDataSetField(UA_Server *server, const UA_NodeId dsf) {
+UA_Server_addDataSetField(UA_Server *server, const UA_NodeId publishedDataSet,
+                          const UA_DataSetFieldConfig *fieldConfig,
+                          UA_NodeId *fieldIdentifier) {
+    UA_PUBSUB_LOCK(server);
+    UA_DataSetFieldResult result =
+        addDataSetField(server, publishedDataSet, fieldConfig, fieldIdentifier);
+    UA_PUBSUB_UNLOCK(server);
+    return result;
+}
+
+static UA_DataSetFieldResult
+removeDataSetField(UA_Server *server, const UA_NodeId dsf) {
     UA_DataSetField *currentField = UA_DataSetField_findDSFbyId(server, dsf);
     UA_DataSetFieldResult result = {UA_STATUSCODE_BADNOTFOUND, {0, 0}};
 	if(!currentField)
@@ -334,6 +390,7 @@ UA_Server_removeDataSetField(UA_Server *server, const UA_NodeId dsf) {
     UA_DataSetField_deleteMembers(currentField);
     LIST_REMOVE(currentField, listEntry);
     UA_free(currentField);
+    invalidateTemplates(server);
 
 	result.result = UA_STATUSCODE_GOOD;
 	result.configurationVersion.majorVersion = parentPublishedDataSet->dataSetMetaData.configurationVersion.majorVersion;
@@ -341,6 +398,14 @@ UA_Server_removeDataSetField(UA_Server *server, const UA_NodeId dsf) {
     return result;
 }
 
+UA_DataSetFieldResult
+UA_Server_removeDataSetField(UA_Server *server, const UA_NodeId dsf) {
+    UA_PUBSUB_LOCK(server);
+    UA_DataSetFieldResult result = removeDataSetField(server, dsf);
+    UA_PUBSUB_UNLOCK(server);
+    return result;
+}
+
 /**********************************************/
 /*               DataSetWriter                */
 /**********************************************/
@@ -465,19 +530,21 @@ UA_Server_getWriterGroupConfig(UA_Server *server, const UA_NodeId writerGroup,
     return retVal;
 }
 
-UA_StatusCode
-UA_Server_updateWriterGroupConfig(UA_Server *server, UA_NodeId writerGroupIdentifier,
-                                  const UA_WriterGroupConfig *config){
+static UA_StatusCode
+updateWriterGroupConfig(UA_Server *server, UA_NodeId writerGroupIdentifier,
+                        const UA_WriterGroupConfig *config){
     if(!config)
         return UA_STATUSCODE_BADINVALIDARGUMENT;
 
     UA_WriterGroup *currentWriterGroup = UA_WriterGroup_findWGbyId(server, writerGroupIdentifier);
     if(!currentWriterGroup)
         return UA_STATUSCODE_BADNOTFOUND;
+    UA_WriterGroup_clearTemplates(currentWriterGroup);
+    currentWriterGroup->config.rtLevel = config->rtLevel;
     //The update functionality will be extended during the next PubSub batches.
     //Currently is only a change of the publishing interval possible.
     if(currentWriterGroup->config.publishingInterval != config->publishingInterval) {
-        UA_PubSubManager_removeRepeatedPubSubCallback(server, currentWriterGroup->publishCallbackId);
+        UA_WriterGroup_removePublishCallback(server, currentWriterGroup);
         currentWriterGroup->config.publishingInterval = config->publishingInterval;
         UA_WriterGroup_addPublishCallback(server, currentWriterGroup);
     } else if(currentWriterGroup->config.priority != config->priority) {
@@ -487,6 +554,21 @@ UA_Server_updateWriterGroupConfig(UA_Server *server, UA_NodeId writerGroupIdenti
     return UA_STATUSCODE_GOOD;
 }
 
+UA_StatusCode
+UA_Server_updateWriterGroupConfig(UA_Server *server, UA_NodeId writerGroupIdentifier,
+                                  const UA_WriterGroupConfig *config){
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    /* The publisher thread is restarted with the new interval */
+    UA_WriterGroup *wg = UA_WriterGroup_findWGbyId(server, writerGroupIdentifier);
+    if(wg && config && wg->config.publishingInterval != config->publishingInterval)
+        UA_WriterGroup_stopPublisherThread(wg);
+#endif
+    UA_PUBSUB_LOCK(server);
+    UA_StatusCode retval = updateWriterGroupConfig(server, writerGroupIdentifier, config);
+    UA_PUBSUB_UNLOCK(server);
+    return retval;
+}
+
 UA_WriterGroup *
 UA_WriterGroup_findWGbyId(UA_Server *server, UA_NodeId identifier){
     for(size_t i = 0; i < server->pubSubManager.connectionsSize; i++){
@@ -512,8 +594,34 @@ UA_WriterGroupConfig_deleteMembers(UA_WriterGroupConfig *writerGroupConfig){
     UA_free(writerGroupConfig->groupProperties);
 }
 
+static void
+UA_WriterGroup_clearTemplates(UA_WriterGroup *writerGroup) {
+    for(size_t i = 0; i < writerGroup->templatesSize; i++) {
+        UA_ByteString_deleteMembers(&writerGroup->templates[i].buffer);
+        UA_free(writerGroup->templates[i].offsets);
+    }
+    UA_free(writerGroup->templates);
+    writerGroup->templates = NULL;
+    writerGroup->templatesSize = 0;
+}
+
+/* The frozen NetworkMessages point to the fields and writers */
+static void
+invalidateTemplates(UA_Server *server) {
+    for(size_t i = 0; i < server->pubSubManager.connectionsSize; i++) {
+        UA_WriterGroup *writerGroup;
+        LIST_FOREACH(writerGroup, &server->pubSubManager.connections[i].writerGroups, listEntry)
+            UA_WriterGroup_clearTemplates(writerGroup);
+    }
+}
+
 static void
 UA_WriterGroup_deleteMembers(UA_Server *server, UA_WriterGroup *writerGroup) {
+    UA_WriterGroup_clearTemplates(writerGroup);
+    for(size_t i = 0; i < writerGroup->sendBuffersSize; i++)
+        UA_ByteString_deleteMembers(&writerGroup->sendBuffers[i]);
+    UA_free(writerGroup->sendBuffers);
+    UA_free(writerGroup->sendQueue);
     UA_WriterGroupConfig_deleteMembers(&writerGroup->config);
     //delete WriterGroup
     //delete all writers. Therefore removeDataSetWriter is called from PublishedDataSet
@@ -525,11 +633,11 @@ UA_WriterGroup_deleteMembers(UA_Server *server, UA_WriterGroup *writerGroup) {
     UA_NodeId_deleteMembers(&writerGroup->identifier);
 }
 
-UA_StatusCode
-UA_Server_addDataSetWriter(UA_Server *server,
-                           const UA_NodeId writerGroup, const UA_NodeId dataSet,
-                           const UA_DataSetWriterConfig *dataSetWriterConfig,
-                           UA_NodeId *writerIdentifier) {
+static UA_StatusCode
+addDataSetWriter(UA_Server *server,
+                 const UA_NodeId writerGroup, const UA_NodeId dataSet,
+                 const UA_DataSetWriterConfig *dataSetWriterConfig,
+                 UA_NodeId *writerIdentifier) {
     UA_StatusCode retVal = UA_STATUSCODE_GOOD;
     if(!dataSetWriterConfig)
         return UA_STATUSCODE_BADINVALIDARGUMENT;
@@ -574,6 +682,7 @@ UA_Server_addDataSetWriter(UA_Server *server,
     //add the new writer to the group
     LIST_INSERT_HEAD(&wg->writers, newDataSetWriter, listEntry);
     wg->writersCount++;
+    UA_WriterGroup_clearTemplates(wg);
 #ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL
     addDataSetWriterRepresentation(server, newDataSetWriter);
 #endif
@@ -581,7 +690,19 @@ UA_Server_addDataSetWriter(UA_Server *server,
 }
 
 UA_StatusCode
-UA_Server_removeDataSetWriter(UA_Server *server, const UA_NodeId dsw){
+UA_Server_addDataSetWriter(UA_Server *server,
+                           const UA_NodeId writerGroup, const UA_NodeId dataSet,
+                           const UA_DataSetWriterConfig *dataSetWriterConfig,
+                           UA_NodeId *writerIdentifier) {
+    UA_PUBSUB_LOCK(server);
+    UA_StatusCode retval =
+        addDataSetWriter(server, writerGroup, dataSet, dataSetWriterConfig, writerIdentifier);
+    UA_PUBSUB_UNLOCK(server);
+    return retval;
+}
+
+static UA_StatusCode
+removeDataSetWriter(UA_Server *server, const UA_NodeId dsw){
     UA_DataSetWriter *dataSetWriter = UA_DataSetWriter_findDSWbyId(server, dsw);
     if(!dataSetWriter)
         return UA_STATUSCODE_BADNOTFOUND;
@@ -591,6 +712,7 @@ UA_Server_removeDataSetWriter(UA_Server *server, const UA_NodeId dsw){
         return UA_STATUSCODE_BADNOTFOUND;
 
     linkedWriterGroup->writersCount--;
+    UA_WriterGroup_clearTemplates(linkedWriterGroup);
 #ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL
     removeDataSetWriterRepresentation(server, dataSetWriter);
 #endif
@@ -602,6 +724,14 @@ UA_Server_removeDataSetWriter(UA_Server *server, const UA_NodeId dsw){
     return UA_STATUSCODE_GOOD;
 }
 
+UA_StatusCode
+UA_Server_removeDataSetWriter(UA_Server *server, const UA_NodeId dsw) {
+    UA_PUBSUB_LOCK(server);
+    UA_StatusCode retval = removeDataSetWriter(server, dsw);
+    UA_PUBSUB_UNLOCK(server);
+    return retval;
+}
+
 /**********************************************/
 /*                DataSetField                */
 /**********************************************/
@@ -670,53 +800,119 @@ UA_DataSetField_deleteMembers(UA_DataSetField *field) {
 /*               PublishValues handling                  */
 /*********************************************************/
 
+#ifdef UA_ENABLE_PUBSUB_DELTAFRAMES
+/* Fallback for types that contain pointers. Both values are encoded into a
+ * single buffer. */
+static UA_Boolean
+encodingChangedVariant(const UA_Variant *oldValue, const UA_Variant *newValue) {
+    size_t oldSize = UA_calcSizeBinary(oldValue, &UA_TYPES[UA_TYPES_VARIANT]);
+    size_t newSize = UA_calcSizeBinary(newValue, &UA_TYPES[UA_TYPES_VARIANT]);
+    if(oldSize != newSize)
+        return true;
+
+    /* Report a change if the comparison fails. Then the value is sent. */
+    UA_ByteString buf;
+    if(UA_ByteString_allocBuffer(&buf, oldSize + newSize) != UA_STATUSCODE_GOOD)
+        return true;
+    UA_Byte *bufPos = buf.data;
+    const UA_Byte *bufEnd = &buf.data[buf.length];
+    UA_Boolean changed = true;
+    if(UA_encodeBinary(oldValue, &UA_TYPES[UA_TYPES_VARIANT],
+                       &bufPos, &bufEnd, NULL, NULL) == UA_STATUSCODE_GOOD &&
+       UA_encodeBinary(newValue, &UA_TYPES[UA_TYPES_VARIANT],
+                       &bufPos, &bufEnd, NULL, NULL) == UA_STATUSCODE_GOOD)
+        changed = (memcmp(buf.data, &buf.data[oldSize], oldSize) != 0);
+    UA_ByteString_deleteMembers(&buf);
+    return changed;
+}
+
 /**
- * Compare two variants. Internally used for value change detection.
+ * Compare two variants in place. Internally used for value change detection.
+ * Values of pointer-free types are compared bytewise, strings memberwise.
  *
  * @return true if the value has changed
  */
-#ifdef UA_ENABLE_PUBSUB_DELTAFRAMES
 static UA_Boolean
-valueChangedVariant(UA_Variant *oldValue, UA_Variant *newValue){
-    if(! (oldValue && newValue))
-        return false;
+valueChangedVariant(const UA_Variant *oldValue, const UA_Variant *newValue) {
+    if(oldValue->type != newValue->type ||
+       oldValue->arrayLength != newValue->arrayLength ||
+       UA_Variant_isScalar(oldValue) != UA_Variant_isScalar(newValue) ||
+       oldValue->arrayDimensionsSize != newValue->arrayDimensionsSize)
+        return true;
+    if(oldValue->arrayDimensionsSize > 0 &&
+       memcmp(oldValue->arrayDimensions, newValue->arrayDimensions,
+              sizeof(UA_UInt32) * oldValue->arrayDimensionsSize) != 0)
+        return true;
 
-    UA_ByteString *oldValueEncoding = UA_ByteString_new(), *newValueEncoding = UA_ByteString_new();
-    size_t oldValueEncodingSize, newValueEncodingSize;
-    oldValueEncodingSize = UA_calcSizeBinary(oldValue, &UA_TYPES[UA_TYPES_VARIANT]);
-    newValueEncodingSize = UA_calcSizeBinary(newValue, &UA_TYPES[UA_TYPES_VARIANT]);
-    if((oldValueEncodingSize == 0) || (newValueEncodingSize == 0))
+    const UA_DataType *type = newValue->type;
+    size_t length = newValue->arrayLength;
+    if(UA_Variant_isScalar(newValue))
+        length = 1;
+    if(!type || length == 0)
+        return false; /* Both empty */
+
+    if(type->pointerFree)
+        return memcmp(oldValue->data, newValue->data, type->memSize * length) != 0;
+
+    if(type == &UA_TYPES[UA_TYPES_STRING] || type == &UA_TYPES[UA_TYPES_BYTESTRING] ||
+       type == &UA_TYPES[UA_TYPES_XMLELEMENT]) {
+        const UA_String *oldStrings = (const UA_String*)oldValue->data;
+        const UA_String *newStrings = (const UA_String*)newValue->data;
+        for(size_t i = 0; i < length; i++) {
+            if(!UA_String_equal(&oldStrings[i], &newStrings[i]))
+                return true;
+        }
         return false;
+    }
 
-    if(oldValueEncodingSize != newValueEncodingSize)
-        return true;
+    return encodingChangedVariant(oldValue, newValue);
+}
 
-    if(UA_ByteString_allocBuffer(oldValueEncoding, oldValueEncodingSize) != UA_STATUSCODE_GOOD)
-        return false;
+static UA_Boolean
+valueChangedDataValue(const UA_DataValue *oldValue, const UA_DataValue *newValue) {
+    if(oldValue->hasStatus != newValue->hasStatus ||
+       oldValue->status != newValue->status)
+        return true;
+    return valueChangedVariant(&oldValue->value, &newValue->value);
+}
 
-    if(UA_ByteString_allocBuffer(newValueEncoding, newValueEncodingSize) != UA_STATUSCODE_GOOD)
+/* The sequence counter of external values is incremented with every update.
+ * Unchanged counters skip sampling and comparing the value. */
+static UA_Boolean
+externalValueSequence(const UA_DataSetField *field, UA_UInt32 *sequence) {
+    const UA_DataSetFieldExternalValue *ev = &field->config.field.variable.externalValue;
+    if(!ev->enabled || !ev->sequenceCounter)
         return false;
+    *sequence = UA_atomic_addUInt32(ev->sequenceCounter, 0);
+    return true;
+}
+#endif
 
-    UA_Byte *bufPosOldValue = oldValueEncoding->data;
-    const UA_Byte *bufEndOldValue = &oldValueEncoding->data[oldValueEncoding->length];
-    UA_Byte *bufPosNewValue = newValueEncoding->data;
-    const UA_Byte *bufEndNewValue = &newValueEncoding->data[newValueEncoding->length];
-    if(UA_encodeBinary(oldValue, &UA_TYPES[UA_TYPES_VARIANT],
-                       &bufPosOldValue, &bufEndOldValue, NULL, NULL) != UA_STATUSCODE_GOOD){
-        return false;
+/* Copy the value from application memory. With a sequence counter, sample
+ * again if the value was updated in the meantime. */
+static void
+UA_PubSubDataSetField_sampleExternalValue(const UA_DataSetFieldExternalValue *ev,
+                                          UA_DataValue *value) {
+    if(!ev->sequenceCounter) {
+        UA_DataValue_copy(ev->value, value);
+        return;
     }
-    if(UA_encodeBinary(newValue, &UA_TYPES[UA_TYPES_VARIANT],
-                       &bufPosNewValue, &bufEndNewValue, NULL, NULL) != UA_STATUSCODE_GOOD){
-        return false;
+
+    for(size_t i = 0; i < UA_MAX_EXTERNALVALUE_RETRIES; i++) {
+        UA_UInt32 sequence = UA_atomic_addUInt32(ev->sequenceCounter, 0);
+        if(sequence & 1)
+            continue; /* Update in progress */
+        UA_DataValue_copy(ev->value, value);
+        UA_atomic_sync();
+        if(UA_atomic_addUInt32(ev->sequenceCounter, 0) == sequence)
+            return;
+        UA_DataValue_deleteMembers(value);
     }
-    oldValueEncoding->length = (uintptr_t)bufPosOldValue - (uintptr_t)oldValueEncoding->data;
-    newValueEncoding->length = (uintptr_t)bufPosNewValue - (uintptr_t)newValueEncoding->data;
-    UA_Boolean compareResult = !UA_ByteString_equal(oldValueEncoding, newValueEncoding);
-    UA_ByteString_delete(oldValueEncoding);
-    UA_ByteString_delete(newValueEncoding);
-    return compareResult;
+
+    UA_DataValue_init(value);
+    value->hasStatus = true;
+    value->status = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
 }
-#endif
 
 /**
  * Obtain the latest value for a specific DataSetField. This method is currently
@@ -725,6 +921,12 @@ valueChangedVariant(UA_Variant *oldValue, UA_Variant *newValue){
 static void
 UA_PubSubDataSetField_sampleValue(UA_Server *server, UA_DataSetField *field,
                                   UA_DataValue *value) {
+    if(field->config.field.variable.externalValue.enabled) {
+        UA_PubSubDataSetField_sampleExternalValue(&field->config.field.variable.externalValue,
+                                                  value);
+        return;
+    }
+
     /* Read the value */
     UA_ReadValueId rvid;
     UA_ReadValueId_init(&rvid);
@@ -734,6 +936,25 @@ UA_PubSubDataSetField_sampleValue(UA_Server *server, UA_DataSetField *field,
     *value = UA_Server_read(server, &rvid, UA_TIMESTAMPSTORETURN_BOTH);
 }
 
+/* Remove the content from the sampled value that is not configured for the
+ * DataSetMessage */
+static void
+UA_DataSetWriter_maskFieldValue(const UA_DataSetWriter *dataSetWriter, UA_DataValue *dfv) {
+    /* Deactivate statuscode? */
+    if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_STATUSCODE) == 0)
+        dfv->hasStatus = false;
+
+    /* Deactivate timestamps */
+    if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SOURCETIMESTAMP) == 0)
+        dfv->hasSourceTimestamp = false;
+    if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SOURCEPICOSECONDS) == 0)
+        dfv->hasSourcePicoseconds = false;
+    if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SERVERTIMESTAMP) == 0)
+        dfv->hasServerTimestamp = false;
+    if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SERVERPICOSECONDS) == 0)
+        dfv->hasServerPicoseconds = false;
+}
+
 static UA_StatusCode
 UA_PubSubDataSetWriter_generateKeyFrameMessage(UA_Server *server, UA_DataSetMessage *dataSetMessage,
                                                UA_DataSetWriter *dataSetWriter) {
@@ -770,23 +991,16 @@ UA_PubSubDataSetWriter_generateKeyFrameMessage(UA_Server *server, UA_DataSetMess
               &dataSetMessage->data.keyFrameData.fieldNames[counter]);
 #endif
 
+#ifdef UA_ENABLE_PUBSUB_DELTAFRAMES
+        /* Read the sequence counter before sampling. Concurrent updates are
+         * detected in the next DeltaFrame. */
+        externalValueSequence(dsf, &dataSetWriter->lastSamples[counter].sequence);
+#endif
+
         /* Sample the value */
         UA_DataValue *dfv = &dataSetMessage->data.keyFrameData.dataSetFields[counter];
         UA_PubSubDataSetField_sampleValue(server, dsf, dfv);
-
-        /* Deactivate statuscode? */
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_STATUSCODE) == 0)
-            dfv->hasStatus = false;
-
-        /* Deactivate timestamps */
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SOURCETIMESTAMP) == 0)
-            dfv->hasSourceTimestamp = false;
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SOURCEPICOSECONDS) == 0)
-            dfv->hasSourcePicoseconds = false;
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SERVERTIMESTAMP) == 0)
-            dfv->hasServerTimestamp = false;
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SERVERPICOSECONDS) == 0)
-            dfv->hasServerPicoseconds = false;
+        UA_DataSetWriter_maskFieldValue(dataSetWriter, dfv);
 
 #ifdef UA_ENABLE_PUBSUB_DELTAFRAMES
         /* Update lastValue store */
@@ -817,34 +1031,48 @@ UA_PubSubDataSetWriter_generateDeltaFrameMessage(UA_Server *server,
     UA_DataSetField *dsf;
     size_t counter = 0;
     LIST_FOREACH(dsf, &currentDataSet->fields, listEntry) {
+        UA_DataSetWriterSample *ls = &dataSetWriter->lastSamples[counter];
+        counter++;
+
+        /* The external value was not updated since the last sample */
+        UA_UInt32 sequence = 0;
+        if(externalValueSequence(dsf, &sequence) && sequence == ls->sequence) {
+            ls->valueChanged = false;
+            continue;
+        }
+
         /* Sample the value */
         UA_DataValue value;
         UA_DataValue_init(&value);
         UA_PubSubDataSetField_sampleValue(server, dsf, &value);
+        UA_DataSetWriter_maskFieldValue(dataSetWriter, &value);
+        ls->sequence = sequence;
 
         /* Check if the value has changed */
-        if(valueChangedVariant(&dataSetWriter->lastSamples[counter].value.value, &value.value)) {
-            /* increase fieldCount for current delta message */
-            dataSetMessage->data.deltaFrameData.fieldCount++;
-            dataSetWriter->lastSamples[counter].valueChanged = true;
-
-            /* Update last stored sample */
-            UA_DataValue_deleteMembers(&dataSetWriter->lastSamples[counter].value);
-            dataSetWriter->lastSamples[counter].value = value;
-        } else {
+        if(!valueChangedDataValue(&ls->value, &value)) {
             UA_DataValue_deleteMembers(&value);
-            dataSetWriter->lastSamples[counter].valueChanged = false;
+            ls->valueChanged = false;
+            continue;
         }
 
-        counter++;
+        /* increase fieldCount for current delta message */
+        dataSetMessage->data.deltaFrameData.fieldCount++;
+        ls->valueChanged = true;
+
+        /* Update last stored sample */
+        UA_DataValue_deleteMembers(&ls->value);
+        ls->value = value;
     }
 
     /* Allocate DeltaFrameFields */
+    if(dataSetMessage->data.deltaFrameData.fieldCount == 0)
+        return UA_STATUSCODE_GOOD;
     UA_DataSetMessage_DeltaFrameField *deltaFields = (UA_DataSetMessage_DeltaFrameField *)
             UA_calloc(dataSetMessage->data.deltaFrameData.fieldCount, sizeof(UA_DataSetMessage_DeltaFrameField));
     if(!deltaFields)
         return UA_STATUSCODE_BADOUTOFMEMORY;
 
+    /* Only the changed fields are encoded */
     dataSetMessage->data.deltaFrameData.deltaFrameFields = deltaFields;
     size_t currentDeltaField = 0;
     for(size_t i = 0; i < currentDataSet->fieldSize; i++) {
@@ -852,25 +1080,9 @@ UA_PubSubDataSetWriter_generateDeltaFrameMessage(UA_Server *server,
             continue;
 
         UA_DataSetMessage_DeltaFrameField *dff = &deltaFields[currentDeltaField];
-        
         dff->fieldIndex = (UA_UInt16) i;
         UA_DataValue_copy(&dataSetWriter->lastSamples[i].value, &dff->fieldValue);
         dataSetWriter->lastSamples[i].valueChanged = false;
-
-        /* Deactivate statuscode? */
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_STATUSCODE) == 0)
-            dff->fieldValue.hasStatus = false;
-
-        /* Deactivate timestamps? */
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SOURCETIMESTAMP) == 0)
-            dff->fieldValue.hasSourceTimestamp = false;
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SOURCEPICOSECONDS) == 0)
-            dff->fieldValue.hasServerPicoseconds = false;
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SERVERTIMESTAMP) == 0)
-            dff->fieldValue.hasServerTimestamp = false;
-        if((dataSetWriter->config.dataSetFieldContentMask & UA_DATASETFIELDCONTENTMASK_SERVERPICOSECONDS) == 0)
-            dff->fieldValue.hasServerPicoseconds = false;
-
         currentDeltaField++;
     }
     return UA_STATUSCODE_GOOD;
@@ -881,11 +1093,13 @@ UA_PubSubDataSetWriter_generateDeltaFrameMessage(UA_Server *server,
  * Generate a DataSetMessage for the given writer.
  *
  * @param dataSetWriter ptr to corresponding writer
+ * @param keyFrameOnly do not generate DeltaFrames
  * @return ptr to generated DataSetMessage
  */
 static UA_StatusCode
 UA_DataSetWriter_generateDataSetMessage(UA_Server *server, UA_DataSetMessage *dataSetMessage,
-                                        UA_DataSetWriter *dataSetWriter) {
+                                        UA_DataSetWriter *dataSetWriter,
+                                        UA_Boolean keyFrameOnly) {
     UA_PublishedDataSet *currentDataSet =
         UA_PublishedDataSet_findPDSbyId(server, dataSetWriter->connectedDataSet);
     if(!currentDataSet)
@@ -1043,7 +1257,7 @@ UA_DataSetWriter_generateDataSetMessage(UA_Server *server, UA_DataSetMessage *da
     /* The standard defines: if a PDS contains only one fields no delta messages
      * should be generated because they need more memory than a keyframe with 1
      * field. */
-    if(currentDataSet->fieldSize > 1 && dataSetWriter->deltaFrameCounter > 0 &&
+    if(!keyFrameOnly && currentDataSet->fieldSize > 1 && dataSetWriter->deltaFrameCounter > 0 &&
        dataSetWriter->deltaFrameCounter <= dataSetWriter->config.keyFrameCount) {
         UA_PubSubDataSetWriter_generateDeltaFrameMessage(server, dataSetMessage, dataSetWriter);
         dataSetWriter->deltaFrameCounter++;
@@ -1058,9 +1272,81 @@ UA_DataSetWriter_generateDataSetMessage(UA_Server *server, UA_DataSetMessage *da
     return UA_STATUSCODE_GOOD;
 }
 
+/* Make room for count more NetworkMessages in the send queue */
+static UA_StatusCode
+UA_WriterGroup_reserveSendQueue(UA_WriterGroup *writerGroup, size_t count) {
+    size_t required = writerGroup->sendQueueSize + count;
+    if(required <= writerGroup->sendBuffersSize)
+        return UA_STATUSCODE_GOOD;
+    size_t newSize = writerGroup->sendBuffersSize * 2;
+    if(newSize < required)
+        newSize = required;
+
+    UA_ByteString *buffers = (UA_ByteString*)
+        UA_realloc(writerGroup->sendBuffers, sizeof(UA_ByteString) * newSize);
+    if(!buffers)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    writerGroup->sendBuffers = buffers;
+    for(size_t i = writerGroup->sendBuffersSize; i < newSize; i++)
+        UA_ByteString_init(&buffers[i]);
+
+    UA_ByteString *queue = (UA_ByteString*)
+        UA_realloc(writerGroup->sendQueue, sizeof(UA_ByteString) * newSize);
+    if(!queue)
+        return UA_STATUSCODE_BADOUTOFMEMORY; /* The buffers are kept */
+    writerGroup->sendQueue = queue;
+    writerGroup->sendBuffersSize = newSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Queue a message of the given length. The returned message points into a
+ * reused send buffer of the WriterGroup. */
+static UA_ByteString *
+UA_WriterGroup_queueMessage(UA_WriterGroup *writerGroup, size_t length) {
+    if(UA_WriterGroup_reserveSendQueue(writerGroup, 1) != UA_STATUSCODE_GOOD)
+        return NULL;
+    UA_ByteString *buffer = &writerGroup->sendBuffers[writerGroup->sendQueueSize];
+    if(buffer->length < length) {
+        UA_Byte *data = (UA_Byte*)UA_realloc(buffer->data, length);
+        if(!data)
+            return NULL;
+        buffer->data = data;
+        buffer->length = length;
+    }
+    UA_ByteString *message = &writerGroup->sendQueue[writerGroup->sendQueueSize];
+    message->data = buffer->data;
+    message->length = length;
+    writerGroup->sendQueueSize++;
+    return message;
+}
+
+/* Send the queued messages with a single call to the channel if possible */
+static void
+UA_WriterGroup_sendQueue(UA_Server *server, UA_PubSubConnection *connection,
+                         UA_WriterGroup *writerGroup) {
+    if(writerGroup->sendQueueSize == 0)
+        return;
+    UA_PubSubChannel *channel = connection->channel;
+    if(channel->sendBatch) {
+        UA_StatusCode res = channel->sendBatch(channel, NULL, writerGroup->sendQueue,
+                                               writerGroup->sendQueueSize);
+        if(res != UA_STATUSCODE_GOOD)
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                           "PubSub Publish: Sending the NetworkMessages failed");
+    } else {
+        for(size_t i = 0; i < writerGroup->sendQueueSize; i++) {
+            UA_StatusCode res = channel->send(channel, NULL, &writerGroup->sendQueue[i]);
+            if(res != UA_STATUSCODE_GOOD)
+                UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                               "PubSub Publish: Sending a NetworkMessage failed");
+        }
+    }
+    writerGroup->sendQueueSize = 0;
+}
+
 static UA_StatusCode
-sendNetworkMessageJson(UA_PubSubConnection *connection, UA_DataSetMessage *dsm,
-                   UA_UInt16 *writerIds, UA_Byte dsmCount) {
+queueNetworkMessageJson(UA_WriterGroup *writerGroup, UA_DataSetMessage *dsm,
+                        UA_UInt16 *writerIds, UA_Byte dsmCount) {
    UA_StatusCode retval = UA_STATUSCODE_BADNOTSUPPORTED;
 #ifdef UA_ENABLE_JSON_ENCODING
     UA_NetworkMessage nm;
@@ -1073,93 +1359,306 @@ sendNetworkMessageJson(UA_PubSubConnection *connection, UA_DataSetMessage *dsm,
     nm.payloadHeader.dataSetPayloadHeader.dataSetWriterIds = writerIds;
     nm.payload.dataSetPayload.dataSetMessages = dsm;
 
-    /* Allocate the buffer. Allocate on the stack if the buffer is small. */
-    UA_ByteString buf;
-    size_t msgSize = UA_NetworkMessage_calcSizeJson(&nm, NULL, 0, NULL, 0, true);
-    size_t stackSize = 1;
-    if(msgSize <= UA_MAX_STACKBUF)
-        stackSize = msgSize;
-    UA_STACKARRAY(UA_Byte, stackBuf, stackSize);
-    buf.data = stackBuf;
-    buf.length = msgSize;
-    if(msgSize > UA_MAX_STACKBUF) {
-        retval = UA_ByteString_allocBuffer(&buf, msgSize);
-        if(retval != UA_STATUSCODE_GOOD)
-            return retval;
+    /* Encode directly into the next send buffer. The buffer grows during the
+     * encoding, so the size need not be computed in a separate pass. */
+    retval = UA_WriterGroup_reserveSendQueue(writerGroup, 1);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_ByteString *buffer = &writerGroup->sendBuffers[writerGroup->sendQueueSize];
+    size_t msgSize = 0;
+    retval = UA_NetworkMessage_encodeJsonBuffer(&nm, buffer, &msgSize,
+                                                NULL, 0, NULL, 0, true);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_ByteString *message = &writerGroup->sendQueue[writerGroup->sendQueueSize];
+    message->data = buffer->data;
+    message->length = msgSize;
+    writerGroup->sendQueueSize++;
+#endif
+    return retval;
+}
+
+/* The PublisherId and the WriterGroupId are sent so that subscribers can
+ * filter the NetworkMessage before decoding the payload */
+static void
+initNetworkMessage(UA_NetworkMessage *nm, const UA_PubSubConnection *connection,
+                   const UA_WriterGroup *writerGroup, UA_DataSetMessage *dsm,
+                   UA_UInt16 *writerIds, UA_UInt16 *dsmLengths, UA_Byte dsmCount) {
+    memset(nm, 0, sizeof(UA_NetworkMessage));
+    nm->version = 1;
+    nm->networkMessageType = UA_NETWORKMESSAGE_DATASET;
+    nm->payloadHeaderEnabled = true;
+
+    nm->publisherIdEnabled = true;
+    if(connection->config->publisherIdType == UA_PUBSUB_PUBLISHERID_STRING) {
+        nm->publisherIdType = UA_PUBLISHERDATATYPE_STRING;
+        nm->publisherId.publisherIdString = connection->config->publisherId.string;
+    } else {
+        nm->publisherIdType = UA_PUBLISHERDATATYPE_UINT32;
+        nm->publisherId.publisherIdUInt32 = connection->config->publisherId.numeric;
     }
+    nm->groupHeaderEnabled = true;
+    nm->groupHeader.writerGroupIdEnabled = true;
+    nm->groupHeader.writerGroupId = writerGroup->config.writerGroupId;
+
+    /* Compute the length of the dsm separately for the header */
+    for(UA_Byte i = 0; i < dsmCount; i++)
+        dsmLengths[i] = (UA_UInt16)UA_DataSetMessage_calcSizeBinary(&dsm[i]);
+
+    nm->payloadHeader.dataSetPayloadHeader.count = dsmCount;
+    nm->payloadHeader.dataSetPayloadHeader.dataSetWriterIds = writerIds;
+    nm->payload.dataSetPayload.sizes = dsmLengths;
+    nm->payload.dataSetPayload.dataSetMessages = dsm;
+}
+
+static UA_StatusCode
+queueNetworkMessage(UA_PubSubConnection *connection, UA_WriterGroup *writerGroup,
+                    UA_DataSetMessage *dsm, UA_UInt16 *writerIds, UA_Byte dsmCount) {
+    UA_NetworkMessage nm;
+    UA_STACKARRAY(UA_UInt16, dsmLengths, dsmCount);
+    initNetworkMessage(&nm, connection, writerGroup, dsm, writerIds, dsmLengths, dsmCount);
+
+    /* Get a buffer from the send queue */
+    size_t msgSize = UA_NetworkMessage_calcSizeBinary(&nm);
+    UA_ByteString *buf = UA_WriterGroup_queueMessage(writerGroup, msgSize);
+    if(!buf)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
 
     /* Encode the message */
-    UA_Byte *bufPos = buf.data;
+    UA_Byte *bufPos = buf->data;
     memset(bufPos, 0, msgSize);
-    const UA_Byte *bufEnd = &buf.data[buf.length];
-    retval = UA_NetworkMessage_encodeJson(&nm, &bufPos, &bufEnd, NULL, 0, NULL, 0, true);
-    if(retval != UA_STATUSCODE_GOOD) {
-        if(msgSize > UA_MAX_STACKBUF)
-            UA_ByteString_deleteMembers(&buf);
-        return retval;
+    const UA_Byte *bufEnd = &buf->data[buf->length];
+    UA_StatusCode retval = UA_NetworkMessage_encodeBinary(&nm, &bufPos, bufEnd);
+    if(retval != UA_STATUSCODE_GOOD)
+        writerGroup->sendQueueSize--;
+    return retval;
+}
+
+/* Record the position of the sequence number, the timestamp and the fields of
+ * an encoded KeyFrame DataSetMessage */
+static UA_StatusCode
+addTemplateOffsets(UA_Server *server, UA_NetworkMessageTemplate *tmpl,
+                   UA_DataSetMessage *dsm, UA_DataSetWriter *dsw, size_t pos) {
+    UA_PublishedDataSet *pds = UA_PublishedDataSet_findPDSbyId(server, dsw->connectedDataSet);
+    if(!pds || pds->fieldSize != dsm->data.keyFrameData.fieldCount)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    size_t sequenceNumberOffset, timestampOffset;
+    UA_DataSetMessageHeader_offsetsBinary(&dsm->header, &sequenceNumberOffset, &timestampOffset);
+    if(sequenceNumberOffset > 0) {
+        UA_NetworkMessageOffset *o = &tmpl->offsets[tmpl->offsetsSize++];
+        o->type = UA_NETWORKMESSAGE_OFFSET_SEQUENCENUMBER;
+        o->offset = pos + sequenceNumberOffset;
+        o->size = UA_UInt16_calcSizeBinary(&dsm->header.dataSetMessageSequenceNr);
+        o->writer = dsw;
+    }
+    if(timestampOffset > 0) {
+        UA_NetworkMessageOffset *o = &tmpl->offsets[tmpl->offsetsSize++];
+        o->type = UA_NETWORKMESSAGE_OFFSET_TIMESTAMP;
+        o->offset = pos + timestampOffset;
+        o->size = UA_DateTime_calcSizeBinary(&dsm->header.timestamp);
+        o->writer = dsw;
     }
 
-    /* Send the prepared messages */
-    retval = connection->channel->send(connection->channel, NULL, &buf);
-    if(msgSize > UA_MAX_STACKBUF)
-        UA_ByteString_deleteMembers(&buf);
-#endif
-    return retval;
+    /* The fields follow the header and the field count */
+    pos += UA_DataSetMessageHeader_calcSizeBinary(&dsm->header);
+    pos += UA_UInt16_calcSizeBinary(&dsm->data.keyFrameData.fieldCount);
+    size_t counter = 0;
+    UA_DataSetField *dsf;
+    LIST_FOREACH(dsf, &pds->fields, listEntry) {
+        UA_DataValue *dfv = &dsm->data.keyFrameData.dataSetFields[counter];
+        UA_NetworkMessageOffset *o = &tmpl->offsets[tmpl->offsetsSize++];
+        if(dsm->header.fieldEncoding == UA_FIELDENCODING_VARIANT) {
+            o->type = UA_NETWORKMESSAGE_OFFSET_FIELD_VARIANT;
+            o->size = UA_calcSizeBinary(&dfv->value, &UA_TYPES[UA_TYPES_VARIANT]);
+        } else {
+            o->type = UA_NETWORKMESSAGE_OFFSET_FIELD_DATAVALUE;
+            o->size = UA_calcSizeBinary(dfv, &UA_TYPES[UA_TYPES_DATAVALUE]);
+        }
+        o->offset = pos;
+        o->writer = dsw;
+        o->field = dsf;
+        pos += o->size;
+        counter++;
+    }
+    return UA_STATUSCODE_GOOD;
 }
 
+/* Encode the NetworkMessage into a new template of the WriterGroup. Only
+ * KeyFrames with Variant or DataValue field encoding can be frozen. */
 static UA_StatusCode
-sendNetworkMessage(UA_PubSubConnection *connection, UA_DataSetMessage *dsm,
-                   UA_UInt16 *writerIds, UA_Byte dsmCount) {
+freezeNetworkMessage(UA_Server *server, UA_PubSubConnection *connection,
+                     UA_WriterGroup *writerGroup, UA_DataSetMessage *dsm,
+                     UA_UInt16 *writerIds, UA_DataSetWriter **writers,
+                     UA_Byte dsmCount) {
     UA_NetworkMessage nm;
-    memset(&nm, 0, sizeof(UA_NetworkMessage));
-    nm.version = 1;
-    nm.networkMessageType = UA_NETWORKMESSAGE_DATASET;
-    nm.payloadHeaderEnabled = true;
-
-    /* Compute the length of the dsm separately for the header */
     UA_STACKARRAY(UA_UInt16, dsmLengths, dsmCount);
+    initNetworkMessage(&nm, connection, writerGroup, dsm, writerIds, dsmLengths, dsmCount);
+
+    /* Allocate the template */
+    size_t offsetsSize = 0;
     for(UA_Byte i = 0; i < dsmCount; i++)
-        dsmLengths[i] = (UA_UInt16)UA_DataSetMessage_calcSizeBinary(&dsm[i]);
+        offsetsSize += 2 + (size_t)dsm[i].data.keyFrameData.fieldCount;
+    UA_NetworkMessageTemplate tmpl;
+    memset(&tmpl, 0, sizeof(UA_NetworkMessageTemplate));
+    tmpl.offsets = (UA_NetworkMessageOffset*)
+        UA_calloc(offsetsSize, sizeof(UA_NetworkMessageOffset));
+    if(!tmpl.offsets)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode retval =
+        UA_ByteString_allocBuffer(&tmpl.buffer, UA_NetworkMessage_calcSizeBinary(&nm));
+    if(retval != UA_STATUSCODE_GOOD)
+        goto cleanup;
 
-    nm.payloadHeader.dataSetPayloadHeader.count = dsmCount;
-    nm.payloadHeader.dataSetPayloadHeader.dataSetWriterIds = writerIds;
-    nm.payload.dataSetPayload.sizes = dsmLengths;
-    nm.payload.dataSetPayload.dataSetMessages = dsm;
+    /* Encode the message */
+    UA_Byte *bufPos = tmpl.buffer.data;
+    memset(bufPos, 0, tmpl.buffer.length);
+    const UA_Byte *bufEnd = &tmpl.buffer.data[tmpl.buffer.length];
+    retval = UA_NetworkMessage_encodeBinary(&nm, &bufPos, bufEnd);
+    if(retval != UA_STATUSCODE_GOOD)
+        goto cleanup;
 
-    /* Allocate the buffer. Allocate on the stack if the buffer is small. */
-    UA_ByteString buf;
-    size_t msgSize = UA_NetworkMessage_calcSizeBinary(&nm);
-    size_t stackSize = 1;
-    if(msgSize <= UA_MAX_STACKBUF)
-        stackSize = msgSize;
-    UA_STACKARRAY(UA_Byte, stackBuf, stackSize);
-    buf.data = stackBuf;
-    buf.length = msgSize;
-    UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    if(msgSize > UA_MAX_STACKBUF) {
-        retval = UA_ByteString_allocBuffer(&buf, msgSize);
+    /* Without security, the DataSetMessages are at the end of the message */
+    size_t pos = tmpl.buffer.length;
+    for(UA_Byte i = 0; i < dsmCount; i++)
+        pos -= dsmLengths[i];
+    for(UA_Byte i = 0; i < dsmCount; i++) {
+        retval = addTemplateOffsets(server, &tmpl, &dsm[i], writers[i], pos);
         if(retval != UA_STATUSCODE_GOOD)
-            return retval;
+            goto cleanup;
+        pos += dsmLengths[i];
     }
-        
-    /* Encode the message */
-    UA_Byte *bufPos = buf.data;
-    memset(bufPos, 0, msgSize);
-    const UA_Byte *bufEnd = &buf.data[buf.length];
-    retval = UA_NetworkMessage_encodeBinary(&nm, &bufPos, bufEnd);
-    if(retval != UA_STATUSCODE_GOOD) {
-        if(msgSize > UA_MAX_STACKBUF)
-            UA_ByteString_deleteMembers(&buf);
+
+    /* Add to the WriterGroup */
+    UA_NetworkMessageTemplate *templates = (UA_NetworkMessageTemplate*)
+        UA_realloc(writerGroup->templates, sizeof(UA_NetworkMessageTemplate) *
+                   (writerGroup->templatesSize + 1));
+    if(!templates) {
+        retval = UA_STATUSCODE_BADOUTOFMEMORY;
+        goto cleanup;
+    }
+    writerGroup->templates = templates;
+    writerGroup->templates[writerGroup->templatesSize] = tmpl;
+    writerGroup->templatesSize++;
+    return UA_STATUSCODE_GOOD;
+
+ cleanup:
+    UA_ByteString_deleteMembers(&tmpl.buffer);
+    UA_free(tmpl.offsets);
+    return retval;
+}
+
+static UA_StatusCode
+encodeTemplateField(const UA_NetworkMessageOffset *o, const UA_DataValue *value,
+                    UA_Byte *bufPos) {
+    /* Shallow copy to apply the content mask */
+    UA_DataValue masked = *value;
+    UA_DataSetWriter_maskFieldValue(o->writer, &masked);
+    const void *src = &masked;
+    const UA_DataType *type = &UA_TYPES[UA_TYPES_DATAVALUE];
+    if(o->type == UA_NETWORKMESSAGE_OFFSET_FIELD_VARIANT) {
+        src = &masked.value;
+        type = &UA_TYPES[UA_TYPES_VARIANT];
+    }
+    if(UA_calcSizeBinary(src, type) != o->size)
+        return UA_STATUSCODE_BADENCODINGERROR;
+    const UA_Byte *bufEnd = &bufPos[o->size];
+    return UA_encodeBinary(src, type, &bufPos, &bufEnd, NULL, NULL);
+}
+
+/* External values are encoded directly from the application memory */
+static UA_StatusCode
+patchTemplateField(UA_Server *server, const UA_NetworkMessageOffset *o,
+                   UA_Byte *bufPos) {
+    const UA_DataSetFieldExternalValue *ev = &o->field->config.field.variable.externalValue;
+    if(!ev->enabled) {
+        UA_DataValue value;
+        UA_DataValue_init(&value);
+        UA_PubSubDataSetField_sampleValue(server, o->field, &value);
+        UA_StatusCode retval = encodeTemplateField(o, &value, bufPos);
+        UA_DataValue_deleteMembers(&value);
         return retval;
     }
 
-    /* Send the prepared messages */
-    retval = connection->channel->send(connection->channel, NULL, &buf);
-    if(msgSize > UA_MAX_STACKBUF)
-        UA_ByteString_deleteMembers(&buf);
+    if(!ev->sequenceCounter)
+        return encodeTemplateField(o, ev->value, bufPos);
+
+    for(size_t i = 0; i < UA_MAX_EXTERNALVALUE_RETRIES; i++) {
+        UA_UInt32 sequence = UA_atomic_addUInt32(ev->sequenceCounter, 0);
+        if(sequence & 1)
+            continue; /* Update in progress */
+        UA_StatusCode retval = encodeTemplateField(o, ev->value, bufPos);
+        UA_atomic_sync();
+        if(UA_atomic_addUInt32(ev->sequenceCounter, 0) == sequence)
+            return retval;
+    }
+    return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+}
+
+/* Patch the sequence numbers, timestamps and field values of the frozen
+ * NetworkMessages in place. Fails if the encoded size of a value changed. */
+static UA_StatusCode
+UA_WriterGroup_patchTemplates(UA_Server *server, UA_WriterGroup *writerGroup) {
+    UA_DateTime now = UA_DateTime_now();
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < writerGroup->templatesSize; i++) {
+        UA_NetworkMessageTemplate *tmpl = &writerGroup->templates[i];
+        for(size_t j = 0; j < tmpl->offsetsSize; j++) {
+            UA_NetworkMessageOffset *o = &tmpl->offsets[j];
+            UA_Byte *bufPos = &tmpl->buffer.data[o->offset];
+            const UA_Byte *bufEnd = &bufPos[o->size];
+            switch(o->type) {
+            case UA_NETWORKMESSAGE_OFFSET_SEQUENCENUMBER:
+                retval = UA_UInt16_encodeBinary(&o->writer->actualDataSetMessageSequenceCount,
+                                                &bufPos, bufEnd);
+                break;
+            case UA_NETWORKMESSAGE_OFFSET_TIMESTAMP:
+                retval = UA_DateTime_encodeBinary(&now, &bufPos, bufEnd);
+                break;
+            default:
+                retval = patchTemplateField(server, o, bufPos);
+                break;
+            }
+            if(retval != UA_STATUSCODE_GOOD)
+                return retval;
+        }
+    }
     return retval;
 }
 
+/* Queue the most recently frozen NetworkMessage. The template buffer is not
+ * copied. */
+static UA_StatusCode
+queueTemplate(UA_WriterGroup *writerGroup) {
+    UA_StatusCode retval = UA_WriterGroup_reserveSendQueue(writerGroup, 1);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    writerGroup->sendQueue[writerGroup->sendQueueSize++] =
+        writerGroup->templates[writerGroup->templatesSize - 1].buffer;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Patch and send the frozen NetworkMessages. Nothing is sent if the templates
+ * need to be rebuilt. */
+static UA_StatusCode
+UA_WriterGroup_publishTemplates(UA_Server *server, UA_PubSubConnection *connection,
+                                UA_WriterGroup *writerGroup) {
+    UA_StatusCode retval = UA_WriterGroup_patchTemplates(server, writerGroup);
+    retval |= UA_WriterGroup_reserveSendQueue(writerGroup, writerGroup->templatesSize);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    for(size_t i = 0; i < writerGroup->templatesSize; i++)
+        writerGroup->sendQueue[writerGroup->sendQueueSize++] = writerGroup->templates[i].buffer;
+    UA_WriterGroup_sendQueue(server, connection, writerGroup);
+
+    /* Set the sequence count. Automatically rolls over to zero */
+    UA_DataSetWriter *dsw;
+    LIST_FOREACH(dsw, &writerGroup->writers, listEntry)
+        dsw->actualDataSetMessageSequenceCount++;
+    return UA_STATUSCODE_GOOD;
+}
+
 /* This callback triggers the collection and publish of NetworkMessages and the
  * contained DataSetMessages. */
 void
@@ -1193,6 +1692,16 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
         return;
     }
 
+    /* Fixed-size WriterGroups only patch the frozen NetworkMessages. If this
+     * fails, the messages are generated regularly and frozen again. */
+    UA_Boolean freeze = (writerGroup->config.rtLevel == UA_PUBSUB_RT_FIXED_SIZE &&
+                         writerGroup->config.encodingMimeType == UA_PUBSUB_ENCODING_UADP);
+    if(freeze && writerGroup->templatesSize > 0) {
+        if(UA_WriterGroup_publishTemplates(server, connection, writerGroup) == UA_STATUSCODE_GOOD)
+            return;
+        UA_WriterGroup_clearTemplates(writerGroup);
+    }
+
     /* How many DSM can be sent in one NM? */
     UA_Byte maxDSM = (UA_Byte)writerGroup->config.maxEncapsulatedDataSetMessageCount;
     if(writerGroup->config.maxEncapsulatedDataSetMessageCount > UA_BYTE_MAX)
@@ -1207,6 +1716,7 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
     size_t dsmCount = 0;
     UA_DataSetWriter *dsw;
     UA_STACKARRAY(UA_UInt16, dsWriterIds, writerGroup->writersCount);
+    UA_STACKARRAY(UA_DataSetWriter*, dsWriters, writerGroup->writersCount);
     UA_STACKARRAY(UA_DataSetMessage, dsmStore, writerGroup->writersCount);
     LIST_FOREACH(dsw, &writerGroup->writers, listEntry) {
         /* Find the dataset */
@@ -1215,38 +1725,55 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
         if(!pds) {
             UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
                            "PubSub Publish: PublishedDataSet not found");
+            freeze = false;
             continue;
         }
 
         /* Generate the DSM */
         UA_StatusCode res =
-            UA_DataSetWriter_generateDataSetMessage(server, &dsmStore[dsmCount], dsw);
+            UA_DataSetWriter_generateDataSetMessage(server, &dsmStore[dsmCount], dsw, freeze);
         if(res != UA_STATUSCODE_GOOD) {
             UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
                            "PubSub Publish: DataSetMessage creation failed");
+            freeze = false;
             continue;
         }
 
+        /* Only the content of KeyFrames without promoted fields is patched */
+        if(pds->promotedFieldsCount > 0 ||
+           dsmStore[dsmCount].header.dataSetMessageType != UA_DATASETMESSAGE_DATAKEYFRAME ||
+           dsmStore[dsmCount].header.fieldEncoding == UA_FIELDENCODING_RAWDATA)
+            freeze = false;
+
         /* Send right away if there is only this DSM in a NM. If promoted fields
          * are contained in the PublishedDataSet, then this DSM must go into a
          * dedicated NM as well. */
         if(pds->promotedFieldsCount > 0 || maxDSM == 1) {
             if(writerGroup->config.encodingMimeType == UA_PUBSUB_ENCODING_UADP){
-                res = sendNetworkMessage(connection, &dsmStore[dsmCount],
-                                         &dsw->config.dataSetWriterId, 1);
+                if(freeze && freezeNetworkMessage(server, connection, writerGroup,
+                                                  &dsmStore[dsmCount],
+                                                  &dsw->config.dataSetWriterId,
+                                                  &dsw, 1) != UA_STATUSCODE_GOOD)
+                    freeze = false;
+                if(freeze)
+                    res = queueTemplate(writerGroup);
+                else
+                    res = queueNetworkMessage(connection, writerGroup, &dsmStore[dsmCount],
+                                              &dsw->config.dataSetWriterId, 1);
             }else if(writerGroup->config.encodingMimeType == UA_PUBSUB_ENCODING_JSON){
-                res = sendNetworkMessageJson(connection, &dsmStore[dsmCount],
-                                         &dsw->config.dataSetWriterId, 1);
+                res = queueNetworkMessageJson(writerGroup, &dsmStore[dsmCount],
+                                              &dsw->config.dataSetWriterId, 1);
             }
 
             if(res != UA_STATUSCODE_GOOD)
                 UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
-                               "PubSub Publish: Could not send a NetworkMessage");
+                               "PubSub Publish: Could not encode a NetworkMessage");
             UA_DataSetMessage_free(&dsmStore[dsmCount]);
             continue;
         }
 
         dsWriterIds[dsmCount] = dsw->config.dataSetWriterId;
+        dsWriters[dsmCount] = dsw;
         dsmCount++;
     }
 
@@ -1254,43 +1781,83 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
     size_t nmCount = (dsmCount / maxDSM) + ((dsmCount % maxDSM) == 0 ? 0 : 1);
     for(UA_UInt32 i = 0; i < nmCount; i++) {
         UA_Byte nmDsmCount = maxDSM;
-        if(i == nmCount - 1)
+        if(i == nmCount - 1 && (dsmCount % maxDSM) != 0)
             nmDsmCount = (UA_Byte)dsmCount % maxDSM;
 
         UA_StatusCode res3 = UA_STATUSCODE_GOOD;
         if(writerGroup->config.encodingMimeType == UA_PUBSUB_ENCODING_UADP){
-            res3 = sendNetworkMessage(connection, &dsmStore[i * maxDSM],
-                                                            &dsWriterIds[i * maxDSM], nmDsmCount);
+            if(freeze && freezeNetworkMessage(server, connection, writerGroup,
+                                              &dsmStore[i * maxDSM], &dsWriterIds[i * maxDSM],
+                                              &dsWriters[i * maxDSM],
+                                              nmDsmCount) != UA_STATUSCODE_GOOD)
+                freeze = false;
+            if(freeze)
+                res3 = queueTemplate(writerGroup);
+            else
+                res3 = queueNetworkMessage(connection, writerGroup, &dsmStore[i * maxDSM],
+                                           &dsWriterIds[i * maxDSM], nmDsmCount);
         }else if(writerGroup->config.encodingMimeType == UA_PUBSUB_ENCODING_JSON){
-            res3 = sendNetworkMessageJson(connection, &dsmStore[i * maxDSM],
-                                                            &dsWriterIds[i * maxDSM], nmDsmCount);
+            res3 = queueNetworkMessageJson(writerGroup, &dsmStore[i * maxDSM],
+                                           &dsWriterIds[i * maxDSM], nmDsmCount);
         }
 
         if(res3 != UA_STATUSCODE_GOOD)
             UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
-                           "PubSub Publish: Sending a NetworkMessage failed");
+                           "PubSub Publish: Could not encode a NetworkMessage");
     }
 
+    /* Send all NetworkMessages of the cycle at once. This has to happen before
+     * the templates are cleared. */
+    UA_WriterGroup_sendQueue(server, connection, writerGroup);
+
     /* Clean up DSM */
     for(size_t i = 0; i < dsmCount; i++)
         UA_DataSetMessage_free(&dsmStore[i]);
+
+    /* The templates are used only if all NetworkMessages could be frozen */
+    if(!freeze)
+        UA_WriterGroup_clearTemplates(writerGroup);
+}
+
+/* Publish from the server timer. A publisher thread might use the same
+ * channel. */
+static void
+UA_WriterGroup_timerCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
+    UA_PUBSUB_LOCK(server);
+    UA_WriterGroup_publishCallback(server, writerGroup);
+    UA_PUBSUB_UNLOCK(server);
 }
 
 /* Add new publishCallback. The first execution is triggered directly after
  * creation. */
 UA_StatusCode
 UA_WriterGroup_addPublishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    if(writerGroup->config.publisherThread.enabled)
+        return UA_WriterGroup_startPublisherThread(server, writerGroup);
+#endif
     UA_StatusCode retval =
             UA_PubSubManager_addRepeatedCallback(server,
-                                                 (UA_ServerCallback) UA_WriterGroup_publishCallback,
+                                                 (UA_ServerCallback) UA_WriterGroup_timerCallback,
                                                  writerGroup, writerGroup->config.publishingInterval,
                                                  &writerGroup->publishCallbackId);
     if(retval == UA_STATUSCODE_GOOD)
         writerGroup->publishCallbackIsRegistered = true;
 
     /* Run once after creation */
-    UA_WriterGroup_publishCallback(server, writerGroup);
+    UA_WriterGroup_timerCallback(server, writerGroup);
     return retval;
 }
 
+static void
+UA_WriterGroup_removePublishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    if(writerGroup->config.publisherThread.enabled) {
+        UA_WriterGroup_stopPublisherThread(writerGroup);
+        return;
+    }
+#endif
+    UA_PubSubManager_removeRepeatedPubSubCallback(server, writerGroup->publishCallbackId);
+}
+
 #endif /* UA_ENABLE_PUBSUB */
@@ -21,6 +21,12 @@ _UA_BEGIN_DECLS
 //forward declarations
 struct UA_WriterGroup;
 typedef struct UA_WriterGroup UA_WriterGroup;
+struct UA_ReaderGroup;
+typedef struct UA_ReaderGroup UA_ReaderGroup;
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+struct UA_WriterGroupThread;
+typedef struct UA_WriterGroupThread UA_WriterGroupThread;
+#endif
 
 /* The configuration structs (public part of PubSub entities) are defined in include/ua_plugin_pubsub.h */
 
@@ -53,6 +59,11 @@ typedef struct{
     UA_PubSubChannel *channel;
     UA_NodeId identifier;
     LIST_HEAD(UA_ListOfWriterGroup, UA_WriterGroup) writerGroups;
+    LIST_HEAD(UA_ListOfReaderGroup, UA_ReaderGroup) readerGroups;
+    UA_Boolean channelRegistered; /* regist was called for the first ReaderGroup */
+    /* Reused buffers for the messages of one receive call. The received
+     * messages are handed to all ReaderGroups of the connection. */
+    UA_ByteString *receiveBuffers;
 } UA_PubSubConnection;
 
 UA_StatusCode
@@ -72,6 +83,7 @@ UA_PubSubConnection_deleteMembers(UA_Server *server, UA_PubSubConnection *connec
 typedef struct UA_DataSetWriterSample{
     UA_Boolean valueChanged;
     UA_DataValue value;
+    UA_UInt32 sequence; /* Sequence counter of an external value */
 } UA_DataSetWriterSample;
 #endif
 
@@ -100,6 +112,28 @@ UA_DataSetWriter_findDSWbyId(UA_Server *server, UA_NodeId identifier);
 /*               WriterGroup                  */
 /**********************************************/
 
+typedef enum {
+    UA_NETWORKMESSAGE_OFFSET_SEQUENCENUMBER,
+    UA_NETWORKMESSAGE_OFFSET_TIMESTAMP,
+    UA_NETWORKMESSAGE_OFFSET_FIELD_VARIANT,
+    UA_NETWORKMESSAGE_OFFSET_FIELD_DATAVALUE
+} UA_NetworkMessageOffsetType;
+
+/* Position of dynamic content inside a pre-encoded NetworkMessage */
+typedef struct {
+    UA_NetworkMessageOffsetType type;
+    size_t offset;
+    size_t size;                /* Encoded size of the field */
+    UA_DataSetWriter *writer;
+    struct UA_DataSetField *field;
+} UA_NetworkMessageOffset;
+
+typedef struct {
+    UA_ByteString buffer;
+    size_t offsetsSize;
+    UA_NetworkMessageOffset *offsets;
+} UA_NetworkMessageTemplate;
+
 struct UA_WriterGroup{
     UA_WriterGroupConfig config;
     //internal fields
@@ -110,6 +144,19 @@ struct UA_WriterGroup{
     UA_UInt32 writersCount;
     UA_UInt64 publishCallbackId;
     UA_Boolean publishCallbackIsRegistered;
+    /* Pre-encoded NetworkMessages if the rtLevel is fixed-size */
+    size_t templatesSize;
+    UA_NetworkMessageTemplate *templates;
+    /* NetworkMessages of the current publish cycle. They are sent out
+     * together at the end of the cycle. The send buffers are reused. The
+     * length of a send buffer is its capacity. */
+    size_t sendQueueSize;
+    size_t sendBuffersSize;
+    UA_ByteString *sendBuffers;
+    UA_ByteString *sendQueue;
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    UA_WriterGroupThread *thread; /* Publishes instead of the server timer */
+#endif
 };
 
 UA_StatusCode
@@ -117,6 +164,17 @@ UA_WriterGroupConfig_copy(const UA_WriterGroupConfig *src, UA_WriterGroupConfig
 UA_WriterGroup *
 UA_WriterGroup_findWGbyId(UA_Server *server, UA_NodeId identifier);
 
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+/* The first cycle is published directly after the start */
+UA_StatusCode
+UA_WriterGroup_startPublisherThread(UA_Server *server, UA_WriterGroup *writerGroup);
+
+/* Stop and join the publisher thread. The caller must not hold the PubSub
+ * lock, since the thread might wait for it. */
+void
+UA_WriterGroup_stopPublisherThread(UA_WriterGroup *writerGroup);
+#endif
+
 /**********************************************/
 /*               DataSetField                 */
 /**********************************************/
@@ -137,6 +195,75 @@ UA_DataSetFieldConfig_copy(const UA_DataSetFieldConfig *src, UA_DataSetFieldConf
 UA_DataSetField *
 UA_DataSetField_findDSFbyId(UA_Server *server, UA_NodeId identifier);
 
+/**********************************************/
+/*              DataSetReader                 */
+/**********************************************/
+
+typedef struct UA_DataSetReader{
+    UA_DataSetReaderConfig config;
+    //internal fields
+    LIST_ENTRY(UA_DataSetReader) listEntry;
+    UA_NodeId identifier;
+    UA_NodeId linkedReaderGroup;
+} UA_DataSetReader;
+
+UA_StatusCode
+UA_DataSetReaderConfig_copy(const UA_DataSetReaderConfig *src, UA_DataSetReaderConfig *dst);
+UA_DataSetReader *
+UA_DataSetReader_findDSRbyId(UA_Server *server, UA_NodeId identifier);
+
+/**********************************************/
+/*               ReaderGroup                  */
+/**********************************************/
+
+/* Byte range inside a received NetworkMessage */
+typedef struct {
+    size_t offset;
+    size_t length;
+} UA_NetworkMessageRange;
+
+/* Position of an encoded scalar field value that is written into a target
+ * variable of a DataSetReader */
+typedef struct {
+    size_t offset;
+    const UA_DataType *type;
+    UA_DataSetReader *reader;
+    size_t targetIndex;
+} UA_NetworkMessageFieldOffset;
+
+/* Learned layout of received NetworkMessages. A message of the same length
+ * whose static ranges equal the learned message has the fields at the same
+ * offsets. */
+typedef struct {
+    UA_ByteString buffer;
+    size_t staticRangesSize;
+    UA_NetworkMessageRange *staticRanges;
+    size_t fieldsSize;
+    UA_NetworkMessageFieldOffset *fields;
+} UA_NetworkMessageLayout;
+
+struct UA_ReaderGroup{
+    UA_ReaderGroupConfig config;
+    //internal fields
+    LIST_ENTRY(UA_ReaderGroup) listEntry;
+    UA_NodeId identifier;
+    UA_NodeId linkedConnection;
+    LIST_HEAD(UA_ListOfDataSetReader, UA_DataSetReader) readers;
+    UA_UInt32 readersCount;
+    UA_UInt64 subscribeCallbackId;
+    UA_Boolean subscribeCallbackIsRegistered;
+    /* Layouts of the received messages for fixed-size DataSetReaders. The
+     * oldest layout is replaced when the cache is full. */
+    size_t layoutsSize;
+    size_t layoutsNext;
+    UA_NetworkMessageLayout *layouts;
+};
+
+UA_StatusCode
+UA_ReaderGroupConfig_copy(const UA_ReaderGroupConfig *src, UA_ReaderGroupConfig *dst);
+UA_ReaderGroup *
+UA_ReaderGroup_findRGbyId(UA_Server *server, UA_NodeId identifier);
+
 /*********************************************************/
 /*               PublishValues handling                  */
 /*********************************************************/
@@ -146,6 +273,20 @@ UA_WriterGroup_addPublishCallback(UA_Server *server, UA_WriterGroup *writerGroup
 void
 UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup);
 
+/*********************************************************/
+/*               SubscribeValues handling                */
+/*********************************************************/
+
+/* Hand a received NetworkMessage to the DataSetReaders of the ReaderGroup.
+ * Returns UA_STATUSCODE_GOODNODATA if no DataSetReader matched. */
+UA_StatusCode
+UA_ReaderGroup_processNetworkMessage(UA_Server *server, UA_ReaderGroup *readerGroup,
+                                     const UA_ByteString *message);
+/* Receives the queued NetworkMessages of the connection of the ReaderGroup and
+ * hands them to all ReaderGroups of that connection */
+void
+UA_ReaderGroup_subscribeCallback(UA_Server *server, UA_ReaderGroup *readerGroup);
+
 #endif /* UA_ENABLE_PUBSUB */
 
 _UA_END_DECLS
@@ -13,10 +13,10 @@
 
 #define UA_DATETIMESTAMP_2000 125911584000000000
 
-UA_StatusCode
-UA_Server_addPubSubConnection(UA_Server *server,
-                              const UA_PubSubConnectionConfig *connectionConfig,
-                              UA_NodeId *connectionIdentifier) {
+static UA_StatusCode
+addPubSubConnection(UA_Server *server,
+                    const UA_PubSubConnectionConfig *connectionConfig,
+                    UA_NodeId *connectionIdentifier) {
     /* Find the matching UA_PubSubTransportLayers */
     UA_PubSubTransportLayer *tl = NULL;
     for(size_t i = 0; i < server->config.pubsubTransportLayersSize; i++) {
@@ -68,11 +68,15 @@ UA_Server_addPubSubConnection(UA_Server *server,
     /* Initialize the new connection */
     memset(newConnection, 0, sizeof(UA_PubSubConnection));
     LIST_INIT(&newConnection->writerGroups);
+    LIST_INIT(&newConnection->readerGroups);
     //workaround - fixing issue with queue.h and realloc.
     for(size_t n = 0; n < server->pubSubManager.connectionsSize; n++){
         if(server->pubSubManager.connections[n].writerGroups.lh_first){
             server->pubSubManager.connections[n].writerGroups.lh_first->listEntry.le_prev = &server->pubSubManager.connections[n].writerGroups.lh_first;
         }
+        if(server->pubSubManager.connections[n].readerGroups.lh_first){
+            server->pubSubManager.connections[n].readerGroups.lh_first->listEntry.le_prev = &server->pubSubManager.connections[n].readerGroups.lh_first;
+        }
     }
     newConnection->config = tmpConnectionConfig;
 
@@ -103,7 +107,18 @@ UA_Server_addPubSubConnection(UA_Server *server,
 }
 
 UA_StatusCode
-UA_Server_removePubSubConnection(UA_Server *server, const UA_NodeId connection) {
+UA_Server_addPubSubConnection(UA_Server *server,
+                              const UA_PubSubConnectionConfig *connectionConfig,
+                              UA_NodeId *connectionIdentifier) {
+    UA_PUBSUB_LOCK(server);
+    UA_StatusCode retval =
+        addPubSubConnection(server, connectionConfig, connectionIdentifier);
+    UA_PUBSUB_UNLOCK(server);
+    return retval;
+}
+
+static UA_StatusCode
+removePubSubConnection(UA_Server *server, const UA_NodeId connection) {
     //search the identified Connection and store the Connection index
     size_t connectionIndex;
     UA_PubSubConnection *currentConnection = NULL;
@@ -143,14 +158,35 @@ UA_Server_removePubSubConnection(UA_Server *server, const UA_NodeId connection)
             if(server->pubSubManager.connections[n].writerGroups.lh_first){
                 server->pubSubManager.connections[n].writerGroups.lh_first->listEntry.le_prev = &server->pubSubManager.connections[n].writerGroups.lh_first;
             }
+            if(server->pubSubManager.connections[n].readerGroups.lh_first){
+                server->pubSubManager.connections[n].readerGroups.lh_first->listEntry.le_prev = &server->pubSubManager.connections[n].readerGroups.lh_first;
+            }
         }
     }
     return UA_STATUSCODE_GOOD;
 }
 
-UA_AddPublishedDataSetResult
-UA_Server_addPublishedDataSet(UA_Server *server, const UA_PublishedDataSetConfig *publishedDataSetConfig,
-                              UA_NodeId *pdsIdentifier) {
+UA_StatusCode
+UA_Server_removePubSubConnection(UA_Server *server, const UA_NodeId connection) {
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    /* Stop the publisher threads before the lock is taken */
+    UA_PubSubConnection *currentConnection =
+        UA_PubSubConnection_findConnectionbyId(server, connection);
+    if(currentConnection) {
+        UA_WriterGroup *writerGroup;
+        LIST_FOREACH(writerGroup, &currentConnection->writerGroups, listEntry)
+            UA_WriterGroup_stopPublisherThread(writerGroup);
+    }
+#endif
+    UA_PUBSUB_LOCK(server);
+    UA_StatusCode retval = removePubSubConnection(server, connection);
+    UA_PUBSUB_UNLOCK(server);
+    return retval;
+}
+
+static UA_AddPublishedDataSetResult
+addPublishedDataSet(UA_Server *server, const UA_PublishedDataSetConfig *publishedDataSetConfig,
+                    UA_NodeId *pdsIdentifier) {
     UA_AddPublishedDataSetResult result = {UA_STATUSCODE_BADINVALIDARGUMENT, 0, NULL, {0, 0}};
     if(!publishedDataSetConfig){
         UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
@@ -213,8 +249,18 @@ UA_Server_addPublishedDataSet(UA_Server *server, const UA_PublishedDataSetConfig
     return result;
 }
 
-UA_StatusCode
-UA_Server_removePublishedDataSet(UA_Server *server, const UA_NodeId pds) {
+UA_AddPublishedDataSetResult
+UA_Server_addPublishedDataSet(UA_Server *server, const UA_PublishedDataSetConfig *publishedDataSetConfig,
+                              UA_NodeId *pdsIdentifier) {
+    UA_PUBSUB_LOCK(server);
+    UA_AddPublishedDataSetResult result =
+        addPublishedDataSet(server, publishedDataSetConfig, pdsIdentifier);
+    UA_PUBSUB_UNLOCK(server);
+    return result;
+}
+
+static UA_StatusCode
+removePublishedDataSet(UA_Server *server, const UA_NodeId pds) {
     //search the identified PublishedDataSet and store the PDS index
     UA_PublishedDataSet *publishedDataSet = NULL;
     size_t publishedDataSetIndex;
@@ -269,6 +315,14 @@ UA_Server_removePublishedDataSet(UA_Server *server, const UA_NodeId pds) {
     return UA_STATUSCODE_GOOD;
 }
 
+UA_StatusCode
+UA_Server_removePublishedDataSet(UA_Server *server, const UA_NodeId pds) {
+    UA_PUBSUB_LOCK(server);
+    UA_StatusCode retval = removePublishedDataSet(server, pds);
+    UA_PUBSUB_UNLOCK(server);
+    return retval;
+}
+
 /* Calculate the time difference between current time and UTC (00:00) on January
  * 1, 2000. */
 UA_UInt32
@@ -287,6 +341,17 @@ UA_PubSubManager_generateUniqueNodeId(UA_Server *server, UA_NodeId *nodeId) {
     UA_NodeId_copy(&newNodeId, nodeId);
 }
 
+void
+UA_PubSubManager_init(UA_PubSubManager *pubSubManager) {
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&pubSubManager->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+#endif
+}
+
 /* Delete the current PubSub configuration including all nested members. This
  * action also delete the configured PubSub transport Layers. */
 void
@@ -303,6 +368,9 @@ UA_PubSubManager_delete(UA_Server *server, UA_PubSubManager *pubSubManager) {
     while(pubSubManager->publishedDataSetsSize > 0){
         UA_Server_removePublishedDataSet(server, pubSubManager->publishedDataSets[pubSubManager->publishedDataSetsSize-1].identifier);
     }
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    pthread_mutex_destroy(&pubSubManager->lock);
+#endif
 }
 
 /***********************************/
@@ -15,14 +15,34 @@ _UA_BEGIN_DECLS
 
 #ifdef UA_ENABLE_PUBSUB /* conditional compilation */
 
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+#include <pthread.h>
+#endif
+
 typedef struct UA_PubSubManager{
     //Connections and PublishedDataSets can exist alone (own lifecycle) -> top level components
     size_t connectionsSize;
     UA_PubSubConnection *connections;
     size_t publishedDataSetsSize;
     UA_PublishedDataSet *publishedDataSets;
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+    /* Serializes the configuration changes with the publisher threads.
+     * Recursive, since the API functions call each other. */
+    pthread_mutex_t lock;
+#endif
 } UA_PubSubManager;
 
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS
+# define UA_PUBSUB_LOCK(server) pthread_mutex_lock(&(server)->pubSubManager.lock)
+# define UA_PUBSUB_UNLOCK(server) pthread_mutex_unlock(&(server)->pubSubManager.lock)
+#else
+# define UA_PUBSUB_LOCK(server)
+# define UA_PUBSUB_UNLOCK(server)
+#endif
+
+void
+UA_PubSubManager_init(UA_PubSubManager *pubSubManager);
+
 void
 UA_PubSubManager_delete(UA_Server *server, UA_PubSubManager *pubSubManager);
 
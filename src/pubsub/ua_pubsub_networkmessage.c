@@ -336,9 +336,9 @@ UA_NetworkMessage_encodeBinary(const UA_NetworkMessage* src, UA_Byte **bufPos,
     return UA_STATUSCODE_GOOD;
 }
 
-static UA_StatusCode
-UA_NetworkMessage_decodeBinaryInternal(const UA_ByteString *src, size_t *offset,
-                                       UA_NetworkMessage* dst) {
+UA_StatusCode
+UA_NetworkMessage_decodeHeaders(const UA_ByteString *src, size_t *offset,
+                                UA_NetworkMessage* dst) {
     memset(dst, 0, sizeof(UA_NetworkMessage));
     UA_Byte v = 0;
     UA_StatusCode rv = UA_Byte_decodeBinary(src, offset, &v);
@@ -596,10 +596,16 @@ UA_NetworkMessage_decodeBinaryInternal(const UA_ByteString *src, size_t *offset,
         }
     }
 
-    // Payload
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_NetworkMessage_decodePayload(const UA_ByteString *src, size_t *offset,
+                                UA_NetworkMessage* dst) {
     if(dst->networkMessageType != UA_NETWORKMESSAGE_DATASET)
         return UA_STATUSCODE_BADNOTIMPLEMENTED;
 
+    UA_StatusCode rv = UA_STATUSCODE_GOOD;
     UA_Byte count = 1;
     if(dst->payloadHeaderEnabled) {
         count = dst->payloadHeader.dataSetPayloadHeader.count;
@@ -615,15 +621,21 @@ UA_NetworkMessage_decodeBinaryInternal(const UA_ByteString *src, size_t *offset,
 
     dst->payload.dataSetPayload.dataSetMessages = (UA_DataSetMessage*)
         UA_calloc(count, sizeof(UA_DataSetMessage));
+    if(!dst->payload.dataSetPayload.dataSetMessages)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
     for(UA_Byte i = 0; i < count; i++) {
         rv = UA_DataSetMessage_decodeBinary(src, offset, &(dst->payload.dataSetPayload.dataSetMessages[i]));
         if(rv != UA_STATUSCODE_GOOD)
             return rv;
     }
 
-    if(rv != UA_STATUSCODE_GOOD)
-        return rv;
+    return UA_STATUSCODE_GOOD;
+}
 
+UA_StatusCode
+UA_NetworkMessage_decodeFooters(const UA_ByteString *src, size_t *offset,
+                                UA_NetworkMessage* dst) {
+    UA_StatusCode rv = UA_STATUSCODE_GOOD;
     if(dst->securityEnabled) {
         // SecurityFooter
         if(dst->securityHeader.securityFooterEnabled && (dst->securityHeader.securityFooterSize > 0)) {
@@ -651,7 +663,11 @@ UA_NetworkMessage_decodeBinaryInternal(const UA_ByteString *src, size_t *offset,
 
 UA_StatusCode
 UA_NetworkMessage_decodeBinary(const UA_ByteString *src, size_t *offset, UA_NetworkMessage* dst) {
-    UA_StatusCode retval = UA_NetworkMessage_decodeBinaryInternal(src, offset, dst);
+    UA_StatusCode retval = UA_NetworkMessage_decodeHeaders(src, offset, dst);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_NetworkMessage_decodePayload(src, offset, dst);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_NetworkMessage_decodeFooters(src, offset, dst);
 
     if(retval != UA_STATUSCODE_GOOD)
         UA_NetworkMessage_deleteMembers(dst);
@@ -1080,6 +1096,25 @@ UA_DataSetMessageHeader_calcSizeBinary(const UA_DataSetMessageHeader* p) {
     return size;
 }
 
+void
+UA_DataSetMessageHeader_offsetsBinary(const UA_DataSetMessageHeader* p,
+                                      size_t *sequenceNumberOffset,
+                                      size_t *timestampOffset) {
+    size_t size = 1; // DataSetMessage Type + Flags
+    if(UA_DataSetMessageHeader_DataSetFlags2Enabled(p))
+        size++;
+
+    *sequenceNumberOffset = 0;
+    if(p->dataSetMessageSequenceNrEnabled) {
+        *sequenceNumberOffset = size;
+        size += UA_UInt16_calcSizeBinary(&p->dataSetMessageSequenceNr);
+    }
+
+    *timestampOffset = 0;
+    if(p->timestampEnabled)
+        *timestampOffset = size;
+}
+
 UA_StatusCode
 UA_DataSetMessage_encodeBinary(const UA_DataSetMessage* src, UA_Byte **bufPos,
                                const UA_Byte *bufEnd) {
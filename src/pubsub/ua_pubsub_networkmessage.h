@@ -64,6 +64,13 @@ UA_DataSetMessageHeader_decodeBinary(const UA_ByteString *src, size_t *offset,
 size_t
 UA_DataSetMessageHeader_calcSizeBinary(const UA_DataSetMessageHeader* p);
 
+/* Offsets of the sequence number and the timestamp relative to the start of
+ * the encoded header. The offset is zero if the content is not enabled. */
+void
+UA_DataSetMessageHeader_offsetsBinary(const UA_DataSetMessageHeader* p,
+                                      size_t *sequenceNumberOffset,
+                                      size_t *timestampOffset);
+
 /**
  * DataSetMessage
  * ^^^^^^^^^^^^^^ */
@@ -210,6 +217,21 @@ UA_StatusCode
 UA_NetworkMessage_decodeBinary(const UA_ByteString *src, size_t *offset,
                                UA_NetworkMessage* dst);
 
+/* The decoding in three steps lets a subscriber drop a message after the
+ * headers, before the payload is decoded. The message is cleaned up with
+ * UA_NetworkMessage_deleteMembers also if a step fails. */
+UA_StatusCode
+UA_NetworkMessage_decodeHeaders(const UA_ByteString *src, size_t *offset,
+                                UA_NetworkMessage* dst);
+
+UA_StatusCode
+UA_NetworkMessage_decodePayload(const UA_ByteString *src, size_t *offset,
+                                UA_NetworkMessage* dst);
+
+UA_StatusCode
+UA_NetworkMessage_decodeFooters(const UA_ByteString *src, size_t *offset,
+                                UA_NetworkMessage* dst);
+
 size_t
 UA_NetworkMessage_calcSizeBinary(const UA_NetworkMessage* p);
 
@@ -229,6 +251,14 @@ UA_NetworkMessage_encodeJson(const UA_NetworkMessage *src,
                              size_t namespaceSize, UA_String *serverUris,
                              size_t serverUriSize, UA_Boolean useReversible);
 
+/* Encodes into a buffer that is grown as needed. See UA_encodeJsonBuffer. */
+UA_StatusCode
+UA_NetworkMessage_encodeJsonBuffer(const UA_NetworkMessage *src,
+                                   UA_ByteString *buffer, size_t *encodedLength,
+                                   UA_String *namespaces, size_t namespaceSize,
+                                   UA_String *serverUris, size_t serverUriSize,
+                                   UA_Boolean useReversible);
+
 size_t
 UA_NetworkMessage_calcSizeJson(const UA_NetworkMessage *src,
                                UA_String *namespaces, size_t namespaceSize,
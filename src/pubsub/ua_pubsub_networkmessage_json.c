@@ -230,6 +230,29 @@ UA_NetworkMessage_encodeJson(const UA_NetworkMessage *src,
     return ret;
 }
 
+UA_StatusCode
+UA_NetworkMessage_encodeJsonBuffer(const UA_NetworkMessage *src,
+                                   UA_ByteString *buffer, size_t *encodedLength,
+                                   UA_String *namespaces, size_t namespaceSize,
+                                   UA_String *serverUris, size_t serverUriSize,
+                                   UA_Boolean useReversible) {
+    /* Set up the context */
+    CtxJson ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.pos = buffer->data;
+    ctx.end = &buffer->data[buffer->length];
+    ctx.namespaces = namespaces;
+    ctx.namespacesSize = namespaceSize;
+    ctx.serverUris = serverUris;
+    ctx.serverUrisSize = serverUriSize;
+    ctx.useReversible = useReversible;
+    ctx.growBuffer = buffer;
+
+    status ret = UA_NetworkMessage_encodeJson_internal(src, &ctx);
+    *encodedLength = (size_t)(ctx.pos - buffer->data);
+    return ret;
+}
+
 size_t
 UA_NetworkMessage_calcSizeJson(const UA_NetworkMessage *src,
                                UA_String *namespaces, size_t namespaceSize,
@@ -523,13 +546,9 @@ status UA_NetworkMessage_decodeJson(UA_NetworkMessage *dst, UA_ByteString *src){
     memset(&ctx, 0, sizeof(CtxJson));
     ParseCtx parseCtx;
     memset(&parseCtx, 0, sizeof(ParseCtx));
-    parseCtx.tokenArray = (jsmntok_t*)malloc(sizeof(jsmntok_t) * TOKENCOUNT);
-    memset(parseCtx.tokenArray, 0, sizeof(jsmntok_t) * TOKENCOUNT);
     status ret = tokenize(&parseCtx, &ctx, src);
-    if(ret != UA_STATUSCODE_GOOD){
-        return ret;
-    }
-    ret = NetworkMessage_decodeJsonInternal(dst, &ctx, &parseCtx);
-    free(parseCtx.tokenArray);
+    if(ret == UA_STATUSCODE_GOOD)
+        ret = NetworkMessage_decodeJsonInternal(dst, &ctx, &parseCtx);
+    deleteTokens(&parseCtx);
     return ret;
 }
@@ -0,0 +1,813 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "server/ua_server_internal.h"
+#include "ua_types_encoding_binary.h"
+
+#ifdef UA_ENABLE_PUBSUB /* conditional compilation */
+
+#include "ua_server_pubsub.h"
+#include "ua_pubsub.h"
+#include "ua_pubsub_manager.h"
+#include "ua_pubsub_networkmessage.h"
+
+#define UA_PUBSUB_RECEIVEBATCH 16             /* Messages per receive call */
+#define UA_PUBSUB_RECEIVEBUFFERSIZE 8192      /* Capacity of a receive buffer */
+#define UA_PUBSUB_MAXMESSAGESPERINTERVAL 1024 /* Default if not configured */
+#define UA_PUBSUB_MAXLAYOUTS 8                /* Learned layouts per ReaderGroup */
+
+/* Forward declaration */
+static void
+UA_ReaderGroup_clearLayouts(UA_ReaderGroup *readerGroup);
+static void
+UA_DataSetReader_delete(UA_DataSetReader *dataSetReader);
+
+/**********************************************/
+/*               ReaderGroup                  */
+/**********************************************/
+
+UA_StatusCode
+UA_ReaderGroupConfig_copy(const UA_ReaderGroupConfig *src,
+                          UA_ReaderGroupConfig *dst) {
+    memcpy(dst, src, sizeof(UA_ReaderGroupConfig));
+    return UA_String_copy(&src->name, &dst->name);
+}
+
+void
+UA_ReaderGroupConfig_deleteMembers(UA_ReaderGroupConfig *readerGroupConfig) {
+    UA_String_deleteMembers(&readerGroupConfig->name);
+}
+
+UA_StatusCode
+UA_Server_getReaderGroupConfig(UA_Server *server, const UA_NodeId readerGroup,
+                               UA_ReaderGroupConfig *config) {
+    if(!config)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_ReaderGroup *currentReaderGroup = UA_ReaderGroup_findRGbyId(server, readerGroup);
+    if(!currentReaderGroup)
+        return UA_STATUSCODE_BADNOTFOUND;
+    return UA_ReaderGroupConfig_copy(&currentReaderGroup->config, config);
+}
+
+UA_ReaderGroup *
+UA_ReaderGroup_findRGbyId(UA_Server *server, UA_NodeId identifier) {
+    for(size_t i = 0; i < server->pubSubManager.connectionsSize; i++) {
+        UA_ReaderGroup *readerGroup;
+        LIST_FOREACH(readerGroup, &server->pubSubManager.connections[i].readerGroups, listEntry) {
+            if(UA_NodeId_equal(&identifier, &readerGroup->identifier))
+                return readerGroup;
+        }
+    }
+    return NULL;
+}
+
+static void
+UA_ReaderGroup_deleteMembers(UA_ReaderGroup *readerGroup) {
+    UA_ReaderGroupConfig_deleteMembers(&readerGroup->config);
+    UA_DataSetReader *dataSetReader, *tmpDataSetReader;
+    LIST_FOREACH_SAFE(dataSetReader, &readerGroup->readers, listEntry, tmpDataSetReader) {
+        LIST_REMOVE(dataSetReader, listEntry);
+        UA_DataSetReader_delete(dataSetReader);
+    }
+    UA_ReaderGroup_clearLayouts(readerGroup);
+    UA_NodeId_deleteMembers(&readerGroup->linkedConnection);
+    UA_NodeId_deleteMembers(&readerGroup->identifier);
+}
+
+static void
+UA_PubSubConnection_clearReceiveBuffers(UA_PubSubConnection *connection) {
+    if(!connection->receiveBuffers)
+        return;
+    for(size_t i = 0; i < UA_PUBSUB_RECEIVEBATCH; i++)
+        UA_ByteString_deleteMembers(&connection->receiveBuffers[i]);
+    UA_free(connection->receiveBuffers);
+    connection->receiveBuffers = NULL;
+}
+
+/* The ReaderGroups of a connection share the receive buffers */
+static UA_StatusCode
+UA_PubSubConnection_allocReceiveBuffers(UA_PubSubConnection *connection) {
+    if(connection->receiveBuffers)
+        return UA_STATUSCODE_GOOD;
+    connection->receiveBuffers = (UA_ByteString *)
+        UA_calloc(UA_PUBSUB_RECEIVEBATCH, sizeof(UA_ByteString));
+    if(!connection->receiveBuffers)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < UA_PUBSUB_RECEIVEBATCH && retval == UA_STATUSCODE_GOOD; i++)
+        retval = UA_ByteString_allocBuffer(&connection->receiveBuffers[i],
+                                           UA_PUBSUB_RECEIVEBUFFERSIZE);
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_PubSubConnection_clearReceiveBuffers(connection);
+    return retval;
+}
+
+UA_StatusCode
+UA_Server_addReaderGroup(UA_Server *server, const UA_NodeId connection,
+                         const UA_ReaderGroupConfig *readerGroupConfig,
+                         UA_NodeId *readerGroupIdentifier) {
+    if(!readerGroupConfig || readerGroupConfig->subscribingInterval <= 0.0)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_PubSubConnection *currentConnectionContext =
+        UA_PubSubConnection_findConnectionbyId(server, connection);
+    if(!currentConnectionContext || !currentConnectionContext->channel)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    /* Register at the message source once for all ReaderGroups */
+    UA_PubSubChannel *channel = currentConnectionContext->channel;
+    if(!currentConnectionContext->channelRegistered) {
+        UA_StatusCode retval = channel->regist(channel, NULL);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                         "ReaderGroup creation failed. Could not register the connection.");
+            return retval;
+        }
+        currentConnectionContext->channelRegistered = true;
+    }
+
+    UA_ReaderGroup *newReaderGroup = (UA_ReaderGroup *) UA_calloc(1, sizeof(UA_ReaderGroup));
+    if(!newReaderGroup)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    LIST_INIT(&newReaderGroup->readers);
+    UA_StatusCode retval = UA_ReaderGroupConfig_copy(readerGroupConfig, &newReaderGroup->config);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_PubSubConnection_allocReceiveBuffers(currentConnectionContext);
+
+    UA_PubSubManager_generateUniqueNodeId(server, &newReaderGroup->identifier);
+    newReaderGroup->linkedConnection = currentConnectionContext->identifier;
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_PubSubManager_addRepeatedCallback(server,
+                                                      (UA_ServerCallback) UA_ReaderGroup_subscribeCallback,
+                                                      newReaderGroup, readerGroupConfig->subscribingInterval,
+                                                      &newReaderGroup->subscribeCallbackId);
+    if(retval != UA_STATUSCODE_GOOD) {
+        if(LIST_EMPTY(&currentConnectionContext->readerGroups))
+            UA_PubSubConnection_clearReceiveBuffers(currentConnectionContext);
+        UA_ReaderGroup_deleteMembers(newReaderGroup);
+        UA_free(newReaderGroup);
+        return retval;
+    }
+    newReaderGroup->subscribeCallbackIsRegistered = true;
+
+    if(readerGroupIdentifier)
+        UA_NodeId_copy(&newReaderGroup->identifier, readerGroupIdentifier);
+    LIST_INSERT_HEAD(&currentConnectionContext->readerGroups, newReaderGroup, listEntry);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_removeReaderGroup(UA_Server *server, const UA_NodeId readerGroup) {
+    UA_ReaderGroup *rg = UA_ReaderGroup_findRGbyId(server, readerGroup);
+    if(!rg)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    //unregister the subscribe callback
+    if(rg->subscribeCallbackIsRegistered)
+        UA_PubSubManager_removeRepeatedPubSubCallback(server, rg->subscribeCallbackId);
+
+    /* The last ReaderGroup of the connection releases the receive buffers */
+    UA_PubSubConnection *connection =
+        UA_PubSubConnection_findConnectionbyId(server, rg->linkedConnection);
+    LIST_REMOVE(rg, listEntry);
+    if(connection && LIST_EMPTY(&connection->readerGroups))
+        UA_PubSubConnection_clearReceiveBuffers(connection);
+    UA_ReaderGroup_deleteMembers(rg);
+    UA_free(rg);
+    return UA_STATUSCODE_GOOD;
+}
+
+/**********************************************/
+/*              DataSetReader                 */
+/**********************************************/
+
+UA_StatusCode
+UA_DataSetReaderConfig_copy(const UA_DataSetReaderConfig *src,
+                            UA_DataSetReaderConfig *dst) {
+    memcpy(dst, src, sizeof(UA_DataSetReaderConfig));
+    dst->targetVariables = NULL;
+    dst->targetVariablesSize = 0;
+    UA_StatusCode retVal = UA_String_copy(&src->name, &dst->name);
+    retVal |= UA_Variant_copy(&src->publisherId, &dst->publisherId);
+    if(src->targetVariablesSize > 0) {
+        dst->targetVariables = (UA_DataSetReaderTarget *)
+            UA_calloc(src->targetVariablesSize, sizeof(UA_DataSetReaderTarget));
+        if(!dst->targetVariables)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        dst->targetVariablesSize = src->targetVariablesSize;
+        for(size_t i = 0; i < src->targetVariablesSize; i++) {
+            /* The external values are owned by the application */
+            dst->targetVariables[i].externalValue = src->targetVariables[i].externalValue;
+            retVal |= UA_NodeId_copy(&src->targetVariables[i].targetNodeId,
+                                     &dst->targetVariables[i].targetNodeId);
+        }
+    }
+    return retVal;
+}
+
+void
+UA_DataSetReaderConfig_deleteMembers(UA_DataSetReaderConfig *dataSetReaderConfig) {
+    UA_String_deleteMembers(&dataSetReaderConfig->name);
+    UA_Variant_deleteMembers(&dataSetReaderConfig->publisherId);
+    for(size_t i = 0; i < dataSetReaderConfig->targetVariablesSize; i++)
+        UA_NodeId_deleteMembers(&dataSetReaderConfig->targetVariables[i].targetNodeId);
+    UA_free(dataSetReaderConfig->targetVariables);
+    dataSetReaderConfig->targetVariables = NULL;
+    dataSetReaderConfig->targetVariablesSize = 0;
+}
+
+UA_StatusCode
+UA_Server_getDataSetReaderConfig(UA_Server *server, const UA_NodeId dsr,
+                                 UA_DataSetReaderConfig *config) {
+    if(!config)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_DataSetReader *currentDataSetReader = UA_DataSetReader_findDSRbyId(server, dsr);
+    if(!currentDataSetReader)
+        return UA_STATUSCODE_BADNOTFOUND;
+    return UA_DataSetReaderConfig_copy(&currentDataSetReader->config, config);
+}
+
+UA_DataSetReader *
+UA_DataSetReader_findDSRbyId(UA_Server *server, UA_NodeId identifier) {
+    for(size_t i = 0; i < server->pubSubManager.connectionsSize; i++) {
+        UA_ReaderGroup *readerGroup;
+        LIST_FOREACH(readerGroup, &server->pubSubManager.connections[i].readerGroups, listEntry) {
+            UA_DataSetReader *dataSetReader;
+            LIST_FOREACH(dataSetReader, &readerGroup->readers, listEntry) {
+                if(UA_NodeId_equal(&identifier, &dataSetReader->identifier))
+                    return dataSetReader;
+            }
+        }
+    }
+    return NULL;
+}
+
+UA_StatusCode
+UA_Server_addDataSetReader(UA_Server *server, const UA_NodeId readerGroup,
+                           const UA_DataSetReaderConfig *dataSetReaderConfig,
+                           UA_NodeId *readerIdentifier) {
+    if(!dataSetReaderConfig)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    const UA_Variant *publisherId = &dataSetReaderConfig->publisherId;
+    if(!UA_Variant_isEmpty(publisherId) &&
+       !UA_Variant_hasScalarType(publisherId, &UA_TYPES[UA_TYPES_UINT32]) &&
+       !UA_Variant_hasScalarType(publisherId, &UA_TYPES[UA_TYPES_STRING]))
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    UA_ReaderGroup *rg = UA_ReaderGroup_findRGbyId(server, readerGroup);
+    if(!rg)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    UA_DataSetReader *newDataSetReader = (UA_DataSetReader *) UA_calloc(1, sizeof(UA_DataSetReader));
+    if(!newDataSetReader)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode retVal = UA_DataSetReaderConfig_copy(dataSetReaderConfig, &newDataSetReader->config);
+    if(retVal != UA_STATUSCODE_GOOD) {
+        UA_DataSetReaderConfig_deleteMembers(&newDataSetReader->config);
+        UA_free(newDataSetReader);
+        return retVal;
+    }
+
+    newDataSetReader->linkedReaderGroup = rg->identifier;
+    UA_PubSubManager_generateUniqueNodeId(server, &newDataSetReader->identifier);
+    if(readerIdentifier != NULL)
+        UA_NodeId_copy(&newDataSetReader->identifier, readerIdentifier);
+    LIST_INSERT_HEAD(&rg->readers, newDataSetReader, listEntry);
+    rg->readersCount++;
+    UA_ReaderGroup_clearLayouts(rg);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_removeDataSetReader(UA_Server *server, const UA_NodeId dsr) {
+    UA_DataSetReader *dataSetReader = UA_DataSetReader_findDSRbyId(server, dsr);
+    if(!dataSetReader)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    UA_ReaderGroup *linkedReaderGroup =
+        UA_ReaderGroup_findRGbyId(server, dataSetReader->linkedReaderGroup);
+    if(!linkedReaderGroup)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    /* The layouts point to the DataSetReaders */
+    linkedReaderGroup->readersCount--;
+    UA_ReaderGroup_clearLayouts(linkedReaderGroup);
+
+    LIST_REMOVE(dataSetReader, listEntry);
+    UA_DataSetReader_delete(dataSetReader);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+UA_DataSetReader_delete(UA_DataSetReader *dataSetReader) {
+    UA_DataSetReaderConfig_deleteMembers(&dataSetReader->config);
+    UA_NodeId_deleteMembers(&dataSetReader->identifier);
+    UA_NodeId_deleteMembers(&dataSetReader->linkedReaderGroup);
+    UA_free(dataSetReader);
+}
+
+/**********************************************/
+/*               Message filter               */
+/**********************************************/
+
+static UA_Boolean
+publisherIdMatches(const UA_Variant *publisherId, const UA_NetworkMessage *nm) {
+    if(UA_Variant_isEmpty(publisherId))
+        return true;
+    if(!nm->publisherIdEnabled)
+        return false;
+
+    if(publisherId->type == &UA_TYPES[UA_TYPES_STRING]) {
+        return (nm->publisherIdType == UA_PUBLISHERDATATYPE_STRING &&
+                UA_String_equal((const UA_String*)publisherId->data,
+                                &nm->publisherId.publisherIdString));
+    }
+
+    UA_UInt64 id;
+    switch(nm->publisherIdType) {
+    case UA_PUBLISHERDATATYPE_BYTE:
+        id = nm->publisherId.publisherIdByte;
+        break;
+    case UA_PUBLISHERDATATYPE_UINT16:
+        id = nm->publisherId.publisherIdUInt16;
+        break;
+    case UA_PUBLISHERDATATYPE_UINT32:
+        id = nm->publisherId.publisherIdUInt32;
+        break;
+    case UA_PUBLISHERDATATYPE_UINT64:
+        id = nm->publisherId.publisherIdUInt64;
+        break;
+    default:
+        return false;
+    }
+    return id == *(const UA_UInt32*)publisherId->data;
+}
+
+/* Filter on the NetworkMessage headers */
+static UA_Boolean
+headerMatches(const UA_DataSetReader *dsr, const UA_NetworkMessage *nm) {
+    if(!publisherIdMatches(&dsr->config.publisherId, nm))
+        return false;
+    if(dsr->config.writerGroupId == 0)
+        return true;
+    return (nm->groupHeaderEnabled && nm->groupHeader.writerGroupIdEnabled &&
+            nm->groupHeader.writerGroupId == dsr->config.writerGroupId);
+}
+
+/* The DataSetWriterIds are only known with the payload header */
+static UA_Boolean
+dataSetMessageMatches(const UA_DataSetReader *dsr, const UA_NetworkMessage *nm,
+                      size_t dsmIndex) {
+    if(dsr->config.dataSetWriterId == 0)
+        return true;
+    if(!nm->payloadHeaderEnabled ||
+       dsmIndex >= nm->payloadHeader.dataSetPayloadHeader.count)
+        return false;
+    return (nm->payloadHeader.dataSetPayloadHeader.dataSetWriterIds[dsmIndex] ==
+            dsr->config.dataSetWriterId);
+}
+
+static UA_Boolean
+anyDataSetMessageMatches(const UA_DataSetReader *dsr, const UA_NetworkMessage *nm) {
+    if(!headerMatches(dsr, nm))
+        return false;
+    size_t count = 1;
+    if(nm->payloadHeaderEnabled)
+        count = nm->payloadHeader.dataSetPayloadHeader.count;
+    for(size_t i = 0; i < count; i++) {
+        if(dataSetMessageMatches(dsr, nm, i))
+            return true;
+    }
+    return false;
+}
+
+/**********************************************/
+/*               Target update                */
+/**********************************************/
+
+/* Write a decoded field value into the target of the DataSetReader */
+static UA_StatusCode
+writeTarget(UA_Server *server, UA_DataSetReader *dsr, size_t targetIndex,
+            const UA_Variant *value) {
+    if(targetIndex >= dsr->config.targetVariablesSize)
+        return UA_STATUSCODE_GOOD; /* The field is not mapped */
+
+    UA_DataSetReaderTarget *target = &dsr->config.targetVariables[targetIndex];
+    if(!target->externalValue.enabled)
+        return UA_Server_writeValue(server, target->targetNodeId, *value);
+
+    /* Update the application memory in place */
+    UA_DataValue *ev = target->externalValue.value;
+    if(!value->type || !value->type->pointerFree || !UA_Variant_isScalar(value) ||
+       !ev || !UA_Variant_hasScalarType(&ev->value, value->type))
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+    volatile UA_UInt32 *sequenceCounter = target->externalValue.sequenceCounter;
+    if(sequenceCounter)
+        UA_DataSetFieldExternalValue_beginUpdate(sequenceCounter);
+    memcpy(ev->value.data, value->data, value->type->memSize);
+    ev->hasValue = true;
+    if(sequenceCounter)
+        UA_DataSetFieldExternalValue_endUpdate(sequenceCounter);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+applyDataSetMessage(UA_Server *server, UA_DataSetReader *dsr,
+                    const UA_DataSetMessage *dsm) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(dsm->header.dataSetMessageType == UA_DATASETMESSAGE_DATAKEYFRAME) {
+        const UA_DataSetMessage_DataKeyFrameData *kf = &dsm->data.keyFrameData;
+        if(!kf->dataSetFields)
+            return;
+        for(size_t i = 0; i < kf->fieldCount; i++) {
+            if(kf->dataSetFields[i].hasValue)
+                retval |= writeTarget(server, dsr, i, &kf->dataSetFields[i].value);
+        }
+    } else if(dsm->header.dataSetMessageType == UA_DATASETMESSAGE_DATADELTAFRAME) {
+        const UA_DataSetMessage_DataDeltaFrameData *df = &dsm->data.deltaFrameData;
+        if(!df->deltaFrameFields)
+            return;
+        for(size_t i = 0; i < df->fieldCount; i++) {
+            if(df->deltaFrameFields[i].fieldValue.hasValue)
+                retval |= writeTarget(server, dsr, df->deltaFrameFields[i].fieldIndex,
+                                      &df->deltaFrameFields[i].fieldValue.value);
+        }
+    }
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_LOG_DEBUG(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                     "PubSub Subscribe: Could not write all fields of a DataSetMessage");
+}
+
+/**********************************************/
+/*               Fixed layouts                */
+/**********************************************/
+
+static void
+UA_NetworkMessageLayout_deleteMembers(UA_NetworkMessageLayout *layout) {
+    UA_ByteString_deleteMembers(&layout->buffer);
+    UA_free(layout->staticRanges);
+    UA_free(layout->fields);
+    memset(layout, 0, sizeof(UA_NetworkMessageLayout));
+}
+
+static void
+UA_ReaderGroup_clearLayouts(UA_ReaderGroup *readerGroup) {
+    for(size_t i = 0; i < readerGroup->layoutsSize; i++)
+        UA_NetworkMessageLayout_deleteMembers(&readerGroup->layouts[i]);
+    UA_free(readerGroup->layouts);
+    readerGroup->layouts = NULL;
+    readerGroup->layoutsSize = 0;
+    readerGroup->layoutsNext = 0;
+}
+
+/* Largest pointer-free builtin type */
+typedef union {
+    UA_Guid guid;
+    UA_Int64 int64;
+    UA_Double dbl;
+} UA_FieldScratch;
+
+/* Values of a fixed encoded size. The Variant encoding of such a scalar is the
+ * encoding byte followed by the value. */
+static UA_Boolean
+isFixedSizeScalar(const UA_Variant *v) {
+    return (v->type && v->type->pointerFree && v->type->builtin &&
+            v->type->typeIndex < UA_TYPES_COUNT &&
+            v->type == &UA_TYPES[v->type->typeIndex] &&
+            v->type->memSize <= sizeof(UA_FieldScratch) &&
+            UA_Variant_isScalar(v) && v->arrayDimensionsSize == 0);
+}
+
+typedef struct {
+    UA_NetworkMessageLayout layout;
+    size_t cursor;   /* End of the last dynamic range */
+    size_t rangesCapacity;
+    size_t fieldsCapacity;
+} UA_LayoutBuilder;
+
+/* The dynamic ranges are added in ascending order. The bytes in between are
+ * static. */
+static void
+addDynamicRange(UA_LayoutBuilder *b, size_t offset, size_t length) {
+    if(offset > b->cursor) {
+        UA_NetworkMessageRange *r = &b->layout.staticRanges[b->layout.staticRangesSize++];
+        r->offset = b->cursor;
+        r->length = offset - b->cursor;
+    }
+    b->cursor = offset + length;
+}
+
+static UA_Boolean
+learnableHeaders(const UA_NetworkMessage *nm) {
+    return (!nm->securityEnabled && !nm->timestampEnabled && !nm->picosecondsEnabled &&
+            !nm->promotedFieldsEnabled && !nm->chunkMessage &&
+            !nm->groupHeader.sequenceNumberEnabled &&
+            !nm->groupHeader.networkMessageNumberEnabled);
+}
+
+/* Add the ranges and field offsets of a matched KeyFrame at position pos */
+static UA_StatusCode
+learnDataSetMessage(UA_ReaderGroup *rg, UA_LayoutBuilder *b, const UA_NetworkMessage *nm,
+                    size_t dsmIndex, size_t pos, size_t dsmLength) {
+    const UA_DataSetMessage *dsm = &nm->payload.dataSetPayload.dataSetMessages[dsmIndex];
+    if(!dsm->header.dataSetMessageValid ||
+       dsm->header.dataSetMessageType != UA_DATASETMESSAGE_DATAKEYFRAME ||
+       dsm->header.fieldEncoding != UA_FIELDENCODING_VARIANT ||
+       dsm->header.statusEnabled || dsm->header.picoSecondsIncluded)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+
+    size_t end = pos + dsmLength;
+    size_t sequenceNumberOffset, timestampOffset;
+    UA_DataSetMessageHeader_offsetsBinary(&dsm->header, &sequenceNumberOffset, &timestampOffset);
+    if(sequenceNumberOffset > 0)
+        addDynamicRange(b, pos + sequenceNumberOffset, sizeof(UA_UInt16));
+    if(timestampOffset > 0)
+        addDynamicRange(b, pos + timestampOffset, sizeof(UA_DateTime));
+
+    pos += UA_DataSetMessageHeader_calcSizeBinary(&dsm->header);
+    pos += sizeof(UA_UInt16); /* field count */
+    const UA_DataSetMessage_DataKeyFrameData *kf = &dsm->data.keyFrameData;
+    for(size_t i = 0; i < kf->fieldCount; i++) {
+        const UA_Variant *v = &kf->dataSetFields[i].value;
+        if(!isFixedSizeScalar(v))
+            return UA_STATUSCODE_BADNOTSUPPORTED;
+        size_t size = UA_calcSizeBinary(v->data, v->type);
+        pos++; /* encoding byte */
+        addDynamicRange(b, pos, size);
+
+        UA_DataSetReader *dsr;
+        LIST_FOREACH(dsr, &rg->readers, listEntry) {
+            if(i >= dsr->config.targetVariablesSize || !headerMatches(dsr, nm) ||
+               !dataSetMessageMatches(dsr, nm, dsmIndex))
+                continue;
+            if(b->layout.fieldsSize >= b->fieldsCapacity)
+                return UA_STATUSCODE_BADINTERNALERROR;
+            UA_NetworkMessageFieldOffset *o = &b->layout.fields[b->layout.fieldsSize++];
+            o->offset = pos;
+            o->type = v->type;
+            o->reader = dsr;
+            o->targetIndex = i;
+        }
+        pos += size;
+    }
+    return (pos == end) ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADDECODINGERROR;
+}
+
+/* Learn the layout of a message that was decoded completely. The payload
+ * starts at payloadOffset. Only if all matched DataSetReaders are fixed-size. */
+static UA_StatusCode
+learnLayout(UA_ReaderGroup *rg, const UA_ByteString *message,
+            const UA_NetworkMessage *nm, size_t payloadOffset) {
+    if(!learnableHeaders(nm))
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+
+    size_t count = 1;
+    if(nm->payloadHeaderEnabled)
+        count = nm->payloadHeader.dataSetPayloadHeader.count;
+    if(count == 0)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+
+    /* Worst case sizes */
+    UA_LayoutBuilder b;
+    memset(&b, 0, sizeof(UA_LayoutBuilder));
+    b.rangesCapacity = 1;
+    for(size_t i = 0; i < count; i++) {
+        size_t fieldCount = nm->payload.dataSetPayload.dataSetMessages[i].data.keyFrameData.fieldCount;
+        b.rangesCapacity += 2 + fieldCount;
+        UA_DataSetReader *dsr;
+        LIST_FOREACH(dsr, &rg->readers, listEntry) {
+            if(!headerMatches(dsr, nm) || !dataSetMessageMatches(dsr, nm, i))
+                continue;
+            if(dsr->config.rtLevel != UA_PUBSUB_RT_FIXED_SIZE)
+                return UA_STATUSCODE_BADNOTSUPPORTED;
+            b.fieldsCapacity += fieldCount;
+        }
+    }
+
+    b.layout.staticRanges = (UA_NetworkMessageRange*)
+        UA_calloc(b.rangesCapacity + 2, sizeof(UA_NetworkMessageRange));
+    if(b.fieldsCapacity > 0)
+        b.layout.fields = (UA_NetworkMessageFieldOffset*)
+            UA_calloc(b.fieldsCapacity, sizeof(UA_NetworkMessageFieldOffset));
+    UA_StatusCode retval = UA_ByteString_copy(message, &b.layout.buffer);
+    if(!b.layout.staticRanges || (b.fieldsCapacity > 0 && !b.layout.fields))
+        retval = UA_STATUSCODE_BADOUTOFMEMORY;
+
+    /* Without security, the DataSetMessages follow the sizes array and end
+     * with the message */
+    size_t pos = payloadOffset;
+    if(count > 1)
+        pos += count * sizeof(UA_UInt16);
+    for(size_t i = 0; i < count && retval == UA_STATUSCODE_GOOD; i++) {
+        size_t dsmLength = message->length - pos;
+        if(count > 1)
+            dsmLength = nm->payload.dataSetPayload.sizes[i];
+        if(pos + dsmLength > message->length) {
+            retval = UA_STATUSCODE_BADDECODINGERROR;
+            break;
+        }
+
+        UA_Boolean matched = false;
+        UA_DataSetReader *dsr;
+        LIST_FOREACH(dsr, &rg->readers, listEntry) {
+            if(headerMatches(dsr, nm) && dataSetMessageMatches(dsr, nm, i))
+                matched = true;
+        }
+        if(matched)
+            retval = learnDataSetMessage(rg, &b, nm, i, pos, dsmLength);
+        else
+            addDynamicRange(&b, pos, dsmLength); /* Other DataSetWriters */
+        pos += dsmLength;
+    }
+    if(retval == UA_STATUSCODE_GOOD && pos != message->length)
+        retval = UA_STATUSCODE_BADDECODINGERROR;
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NetworkMessageLayout_deleteMembers(&b.layout);
+        return retval;
+    }
+    addDynamicRange(&b, message->length, 0);
+
+    /* Add to the cache. Replace the oldest layout if full. */
+    if(!rg->layouts) {
+        rg->layouts = (UA_NetworkMessageLayout*)
+            UA_calloc(UA_PUBSUB_MAXLAYOUTS, sizeof(UA_NetworkMessageLayout));
+        if(!rg->layouts) {
+            UA_NetworkMessageLayout_deleteMembers(&b.layout);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+    }
+    if(rg->layoutsSize < UA_PUBSUB_MAXLAYOUTS) {
+        rg->layouts[rg->layoutsSize++] = b.layout;
+        return UA_STATUSCODE_GOOD;
+    }
+    UA_NetworkMessageLayout_deleteMembers(&rg->layouts[rg->layoutsNext]);
+    rg->layouts[rg->layoutsNext] = b.layout;
+    rg->layoutsNext = (rg->layoutsNext + 1) % UA_PUBSUB_MAXLAYOUTS;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_Boolean
+layoutMatches(const UA_NetworkMessageLayout *layout, const UA_ByteString *message) {
+    if(layout->buffer.length != message->length)
+        return false;
+    for(size_t i = 0; i < layout->staticRangesSize; i++) {
+        const UA_NetworkMessageRange *r = &layout->staticRanges[i];
+        if(memcmp(&layout->buffer.data[r->offset], &message->data[r->offset], r->length) != 0)
+            return false;
+    }
+    return true;
+}
+
+/* Decode the fields at the learned offsets. Nothing else is decoded. */
+static void
+applyLayout(UA_Server *server, const UA_NetworkMessageLayout *layout,
+            const UA_ByteString *message) {
+    UA_FieldScratch scratch;
+    UA_Variant value;
+    for(size_t i = 0; i < layout->fieldsSize; i++) {
+        const UA_NetworkMessageFieldOffset *o = &layout->fields[i];
+        size_t offset = o->offset;
+        UA_StatusCode retval = UA_decodeBinary(message, &offset, &scratch, o->type, NULL);
+        if(retval != UA_STATUSCODE_GOOD)
+            continue;
+        UA_Variant_setScalar(&value, &scratch, o->type);
+        retval = writeTarget(server, o->reader, o->targetIndex, &value);
+        if(retval != UA_STATUSCODE_GOOD)
+            UA_LOG_DEBUG(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                         "PubSub Subscribe: Could not write a field");
+    }
+}
+
+/**********************************************/
+/*               Subscribe                    */
+/**********************************************/
+
+UA_StatusCode
+UA_ReaderGroup_processNetworkMessage(UA_Server *server, UA_ReaderGroup *readerGroup,
+                                     const UA_ByteString *message) {
+    /* Fast path for learned layouts */
+    for(size_t i = 0; i < readerGroup->layoutsSize; i++) {
+        if(layoutMatches(&readerGroup->layouts[i], message)) {
+            applyLayout(server, &readerGroup->layouts[i], message);
+            return UA_STATUSCODE_GOOD;
+        }
+    }
+
+    /* Filter on the headers before the payload is decoded */
+    UA_NetworkMessage nm;
+    size_t offset = 0;
+    UA_StatusCode retval = UA_NetworkMessage_decodeHeaders(message, &offset, &nm);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NetworkMessage_deleteMembers(&nm);
+        return retval;
+    }
+    UA_Boolean matched = false;
+    UA_DataSetReader *dsr;
+    LIST_FOREACH(dsr, &readerGroup->readers, listEntry) {
+        if(anyDataSetMessageMatches(dsr, &nm)) {
+            matched = true;
+            break;
+        }
+    }
+    if(!matched) {
+        UA_NetworkMessage_deleteMembers(&nm);
+        return UA_STATUSCODE_GOODNODATA;
+    }
+
+    /* Decode the payload */
+    size_t payloadOffset = offset;
+    retval = UA_NetworkMessage_decodePayload(message, &offset, &nm);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_NetworkMessage_decodeFooters(message, &offset, &nm);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NetworkMessage_deleteMembers(&nm);
+        return retval;
+    }
+
+    /* Write into the targets */
+    size_t count = 1;
+    if(nm.payloadHeaderEnabled)
+        count = nm.payloadHeader.dataSetPayloadHeader.count;
+    for(size_t i = 0; i < count; i++) {
+        LIST_FOREACH(dsr, &readerGroup->readers, listEntry) {
+            if(headerMatches(dsr, &nm) && dataSetMessageMatches(dsr, &nm, i))
+                applyDataSetMessage(server, dsr, &nm.payload.dataSetPayload.dataSetMessages[i]);
+        }
+    }
+
+    /* Messages with the same layout skip the decoding from now on */
+    learnLayout(readerGroup, message, &nm, payloadOffset);
+    UA_NetworkMessage_deleteMembers(&nm);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Receive into the buffers of the connection without blocking. Channels
+ * without batch support receive one message at a time. */
+static size_t
+UA_PubSubConnection_receive(UA_PubSubConnection *connection, size_t maxMessages) {
+    UA_PubSubChannel *channel = connection->channel;
+    UA_ByteString *bufs = connection->receiveBuffers;
+    for(size_t i = 0; i < maxMessages; i++)
+        bufs[i].length = UA_PUBSUB_RECEIVEBUFFERSIZE;
+
+    if(channel->receiveBatch) {
+        size_t received = maxMessages;
+        UA_StatusCode retval = channel->receiveBatch(channel, bufs, &received, NULL, 0);
+        return (retval == UA_STATUSCODE_GOOD) ? received : 0;
+    }
+
+    size_t received = 0;
+    for(; received < maxMessages; received++) {
+        UA_StatusCode retval = channel->receive(channel, &bufs[received], NULL, 1);
+        if(retval != UA_STATUSCODE_GOOD || bufs[received].length == 0)
+            break;
+    }
+    return received;
+}
+
+/* This callback receives the queued NetworkMessages of the connection and
+ * hands them to the DataSetReaders of all ReaderGroups on that connection.
+ * Otherwise a ReaderGroup would drain the messages meant for its siblings. */
+void
+UA_ReaderGroup_subscribeCallback(UA_Server *server, UA_ReaderGroup *readerGroup) {
+    if(!readerGroup)
+        return;
+
+    UA_PubSubConnection *connection =
+        UA_PubSubConnection_findConnectionbyId(server, readerGroup->linkedConnection);
+    if(!connection || !connection->channel || !connection->receiveBuffers) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "Subscribe failed. PubSubConnection invalid.");
+        return;
+    }
+
+    size_t maxMessages = readerGroup->config.maxMessagesPerInterval;
+    if(maxMessages == 0)
+        maxMessages = UA_PUBSUB_MAXMESSAGESPERINTERVAL;
+    size_t processed = 0;
+    while(processed < maxMessages) {
+        size_t batchSize = maxMessages - processed;
+        if(batchSize > UA_PUBSUB_RECEIVEBATCH)
+            batchSize = UA_PUBSUB_RECEIVEBATCH;
+        size_t received = UA_PubSubConnection_receive(connection, batchSize);
+        for(size_t i = 0; i < received; i++) {
+            UA_ReaderGroup *rg;
+            LIST_FOREACH(rg, &connection->readerGroups, listEntry) {
+                if(rg->readersCount == 0)
+                    continue;
+                UA_StatusCode retval =
+                    UA_ReaderGroup_processNetworkMessage(server, rg,
+                                                         &connection->receiveBuffers[i]);
+                if(retval != UA_STATUSCODE_GOOD && retval != UA_STATUSCODE_GOODNODATA)
+                    UA_LOG_DEBUG(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                                 "PubSub Subscribe: Could not decode a NetworkMessage");
+            }
+        }
+        processed += received;
+        if(received < batchSize)
+            break; /* No more messages queued */
+    }
+}
+
+#endif /* UA_ENABLE_PUBSUB */
@@ -0,0 +1,224 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "server/ua_server_internal.h"
+
+#ifdef UA_ENABLE_PUBSUB_PUBLISHER_THREADS /* conditional compilation */
+
+#include "ua_pubsub.h"
+#include "ua_pubsub_manager.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define UA_NSEC_PER_SEC 1000000000LL
+
+/* The stop flag is checked at least this often (in ns) while the thread sleeps
+ * until the next deadline */
+#define UA_PUBLISHERTHREAD_MAXSLEEP 100000000LL
+
+struct UA_WriterGroupThread {
+    pthread_t thread;
+    UA_Server *server;
+    UA_WriterGroup *writerGroup;
+    clockid_t clock;
+    UA_Int64 interval; /* in ns */
+    volatile UA_UInt32 stop; /* Accessed with the atomic operations */
+    UA_Boolean warnedSkipped;
+    UA_WriterGroupThreadStatistics statistics; /* Protected by the PubSub lock */
+};
+
+static UA_Int64
+getTime(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (UA_Int64)ts.tv_sec * UA_NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* Sleep until the absolute deadline. Returns false if the thread shall stop. */
+static UA_Boolean
+sleepUntil(UA_WriterGroupThread *t, UA_Int64 deadline) {
+    while(UA_atomic_addUInt32(&t->stop, 0) == 0) {
+        UA_Int64 wakeup = getTime(t->clock) + UA_PUBLISHERTHREAD_MAXSLEEP;
+        UA_Boolean last = (deadline <= wakeup);
+        if(last)
+            wakeup = deadline;
+        struct timespec ts;
+        ts.tv_sec = (time_t)(wakeup / UA_NSEC_PER_SEC);
+        ts.tv_nsec = (long)(wakeup % UA_NSEC_PER_SEC);
+        int err = clock_nanosleep(t->clock, TIMER_ABSTIME, &ts, NULL);
+        if(err != 0 && err != EINTR)
+            return false;
+        if(err == 0 && last)
+            return true;
+    }
+    return false;
+}
+
+/* The publisher thread must not read the information model concurrently to the
+ * server. Only external values with a sequence counter can be sampled. */
+static UA_Boolean
+isThreadSafe(UA_Server *server, UA_WriterGroup *writerGroup) {
+    UA_DataSetWriter *dsw;
+    LIST_FOREACH(dsw, &writerGroup->writers, listEntry) {
+        UA_PublishedDataSet *pds =
+            UA_PublishedDataSet_findPDSbyId(server, dsw->connectedDataSet);
+        if(!pds)
+            continue;
+        UA_DataSetField *dsf;
+        LIST_FOREACH(dsf, &pds->fields, listEntry) {
+            const UA_DataSetFieldExternalValue *ev =
+                &dsf->config.field.variable.externalValue;
+            if(!ev->enabled || !ev->sequenceCounter)
+                return false;
+        }
+    }
+    return true;
+}
+
+static void
+updateStatistics(UA_WriterGroupThreadStatistics *s, UA_Int64 latency, UA_Int64 cycleTime) {
+    if(s->cycles == 0 || latency < s->minWakeupLatency)
+        s->minWakeupLatency = latency;
+    if(s->cycles == 0 || latency > s->maxWakeupLatency)
+        s->maxWakeupLatency = latency;
+    if(cycleTime > s->maxCycleTime)
+        s->maxCycleTime = cycleTime;
+    s->totalWakeupLatency += latency;
+    s->cycles++;
+}
+
+static void *
+publisherThreadLoop(void *data) {
+    UA_WriterGroupThread *t = (UA_WriterGroupThread*)data;
+    UA_Server *server = t->server;
+    UA_Int64 deadline = getTime(t->clock);
+    while(sleepUntil(t, deadline)) {
+        UA_Int64 wakeup = getTime(t->clock);
+        UA_PUBSUB_LOCK(server);
+        UA_WriterGroupThreadStatistics *s = &t->statistics;
+        if(isThreadSafe(server, t->writerGroup)) {
+            UA_WriterGroup_publishCallback(server, t->writerGroup);
+        } else {
+            s->skippedCycles++;
+            if(!t->warnedSkipped)
+                UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                               "PubSub publisher thread: Cycle skipped. All DataSetFields "
+                               "must use an external value with a sequence counter.");
+            t->warnedSkipped = true;
+        }
+        UA_Int64 end = getTime(t->clock);
+        updateStatistics(s, wakeup - deadline, end - deadline);
+
+        /* Skip the deadlines that passed during an overrun */
+        deadline += t->interval;
+        if(deadline <= end) {
+            UA_Int64 missed = (end - deadline) / t->interval + 1;
+            deadline += missed * t->interval;
+            s->missedDeadlines += (UA_UInt64)missed;
+        }
+        UA_PUBSUB_UNLOCK(server);
+    }
+    return NULL;
+}
+
+UA_StatusCode
+UA_WriterGroup_startPublisherThread(UA_Server *server, UA_WriterGroup *writerGroup) {
+    if(writerGroup->thread)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    const UA_WriterGroupThreadConfig *tc = &writerGroup->config.publisherThread;
+    clockid_t clock;
+    switch(tc->clock) {
+    case UA_PUBSUB_CLOCK_MONOTONIC:
+        clock = CLOCK_MONOTONIC;
+        break;
+    case UA_PUBSUB_CLOCK_TAI:
+        clock = CLOCK_TAI;
+        break;
+    default:
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+    struct timespec ts;
+    if(clock_gettime(clock, &ts) != 0)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+
+    UA_Int64 interval = (UA_Int64)(writerGroup->config.publishingInterval * 1000000.0);
+    if(interval <= 0)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if(tc->priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(struct sched_param));
+        param.sched_priority = tc->priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        if(pthread_attr_setschedparam(&attr, &param) != 0) {
+            pthread_attr_destroy(&attr);
+            return UA_STATUSCODE_BADINVALIDARGUMENT;
+        }
+    }
+
+    UA_WriterGroupThread *t = (UA_WriterGroupThread*)
+        UA_calloc(1, sizeof(UA_WriterGroupThread));
+    if(!t) {
+        pthread_attr_destroy(&attr);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    t->server = server;
+    t->writerGroup = writerGroup;
+    t->clock = clock;
+    t->interval = interval;
+
+    int err = pthread_create(&t->thread, &attr, publisherThreadLoop, t);
+    if(err == EPERM && tc->priority > 0) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "PubSub publisher thread: No permission for the real-time "
+                       "priority. Using the default scheduling.");
+        err = pthread_create(&t->thread, NULL, publisherThreadLoop, t);
+    }
+    pthread_attr_destroy(&attr);
+    if(err != 0) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                     "PubSub publisher thread: Could not create the thread.");
+        UA_free(t);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    writerGroup->thread = t;
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_WriterGroup_stopPublisherThread(UA_WriterGroup *writerGroup) {
+    UA_WriterGroupThread *t = writerGroup->thread;
+    if(!t)
+        return;
+    UA_atomic_addUInt32(&t->stop, 1);
+    pthread_join(t->thread, NULL);
+    UA_free(t);
+    writerGroup->thread = NULL;
+}
+
+UA_StatusCode
+UA_Server_getWriterGroupThreadStatistics(UA_Server *server, const UA_NodeId writerGroup,
+                                         UA_WriterGroupThreadStatistics *statistics) {
+    if(!statistics)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_WriterGroup *wg = UA_WriterGroup_findWGbyId(server, writerGroup);
+    if(!wg)
+        return UA_STATUSCODE_BADNOTFOUND;
+    if(!wg->thread)
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    UA_PUBSUB_LOCK(server);
+    *statistics = wg->thread->statistics;
+    UA_PUBSUB_UNLOCK(server);
+    return UA_STATUSCODE_GOOD;
+}
+
+#endif /* UA_ENABLE_PUBSUB_PUBLISHER_THREADS */
@@ -184,6 +184,20 @@ UA_Node_copy(const UA_Node *src, UA_Node *dst) {
             if(retval != UA_STATUSCODE_GOOD)
                 break;
             drefs->targetIdsSize = srefs->targetIdsSize;
+            drefs->targetIdsCapacity = srefs->targetIdsSize;
+
+            /* The targets keep their positions. Copy the index. */
+            if(!srefs->targetIdsIndex)
+                continue;
+            drefs->targetIdsIndex = (size_t*)
+                UA_malloc(srefs->targetIdsIndexSize * sizeof(size_t));
+            if(!drefs->targetIdsIndex) {
+                retval = UA_STATUSCODE_BADOUTOFMEMORY;
+                break;
+            }
+            memcpy(drefs->targetIdsIndex, srefs->targetIdsIndex,
+                   srefs->targetIdsIndexSize * sizeof(size_t));
+            drefs->targetIdsIndexSize = srefs->targetIdsIndexSize;
         }
         if(retval != UA_STATUSCODE_GOOD) {
             UA_Node_deleteMembers(dst);
@@ -483,26 +497,169 @@ UA_Node_setAttributes(UA_Node *node, const void *attributes,
 /* Manage References */
 /*********************/
 
+/* Lists with at least this many targets get a hash index over the NodeIds of
+ * the targets. Shorter lists are searched linearly. */
+#define UA_REFERENCETARGETS_INDEXTHRESHOLD 16
+
+/* Consecutive numeric NodeIds have neighbouring hashes. Mix the bits, so that
+ * they do not form long clusters in the linearly probed index. */
+static size_t
+targetHomeSlot(const UA_NodeReferenceKind *refs, const UA_NodeId *targetId) {
+    UA_UInt32 h = UA_NodeId_hash(targetId);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h & (refs->targetIdsIndexSize - 1);
+}
+
+/* Returns the index slot that contains the position */
+static size_t
+targetSlot(const UA_NodeReferenceKind *refs, size_t pos) {
+    size_t mask = refs->targetIdsIndexSize - 1;
+    size_t slot = targetHomeSlot(refs, &refs->targetIds[pos].nodeId);
+    while(refs->targetIdsIndex[slot] != pos + 1)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+/* The index must have a free slot */
+static void
+indexTarget(UA_NodeReferenceKind *refs, size_t pos) {
+    size_t mask = refs->targetIdsIndexSize - 1;
+    size_t slot = targetHomeSlot(refs, &refs->targetIds[pos].nodeId);
+    while(refs->targetIdsIndex[slot] != 0)
+        slot = (slot + 1) & mask;
+    refs->targetIdsIndex[slot] = pos + 1;
+}
+
+/* Removes the position from the index. The following entries of the probe
+ * sequence are moved up, so that lookups need no tombstones. */
+static void
+unindexTarget(UA_NodeReferenceKind *refs, size_t pos) {
+    size_t mask = refs->targetIdsIndexSize - 1;
+    size_t gap = targetSlot(refs, pos);
+    for(size_t j = (gap + 1) & mask; refs->targetIdsIndex[j] != 0; j = (j + 1) & mask) {
+        size_t home = targetHomeSlot(refs, &refs->targetIds[refs->targetIdsIndex[j] - 1].nodeId);
+        /* The entry stays if its home slot lies cyclically in (gap, j] */
+        if(gap < j ? (home > gap && home <= j) : (home > gap || home <= j))
+            continue;
+        refs->targetIdsIndex[gap] = refs->targetIdsIndex[j];
+        gap = j;
+    }
+    refs->targetIdsIndex[gap] = 0;
+}
+
+/* Builds the index with room for twice the current targets. If this fails,
+ * the index is removed and the targets are searched linearly. */
+static void
+rebuildTargetIndex(UA_NodeReferenceKind *refs) {
+    UA_free(refs->targetIdsIndex);
+    refs->targetIdsIndexSize = 32;
+    while(refs->targetIdsIndexSize < refs->targetIdsSize * 4)
+        refs->targetIdsIndexSize <<= 1;
+    refs->targetIdsIndex = (size_t*)UA_calloc(refs->targetIdsIndexSize, sizeof(size_t));
+    if(!refs->targetIdsIndex) {
+        refs->targetIdsIndexSize = 0;
+        return;
+    }
+    for(size_t i = 0; i < refs->targetIdsSize; ++i)
+        indexTarget(refs, i);
+}
+
+/* Returns the position of a target with the NodeId (and the complete
+ * ExpandedNodeId if exact is set) or targetIdsSize */
+static size_t
+findTarget(const UA_NodeReferenceKind *refs, const UA_NodeId *targetId,
+           const UA_ExpandedNodeId *exact) {
+    if(!refs->targetIdsIndex) {
+        for(size_t i = 0; i < refs->targetIdsSize; ++i) {
+            if(exact ? UA_ExpandedNodeId_equal(&refs->targetIds[i], exact) :
+               UA_NodeId_equal(&refs->targetIds[i].nodeId, targetId))
+                return i;
+        }
+        return refs->targetIdsSize;
+    }
+
+    size_t mask = refs->targetIdsIndexSize - 1;
+    for(size_t slot = targetHomeSlot(refs, targetId); refs->targetIdsIndex[slot] != 0;
+        slot = (slot + 1) & mask) {
+        const UA_ExpandedNodeId *target = &refs->targetIds[refs->targetIdsIndex[slot] - 1];
+        if(exact ? UA_ExpandedNodeId_equal(target, exact) :
+           UA_NodeId_equal(&target->nodeId, targetId))
+            return refs->targetIdsIndex[slot] - 1;
+    }
+    return refs->targetIdsSize;
+}
+
+/* Targets that were set without UA_Node_addReference have no index */
+static void
+checkTargetIndex(UA_NodeReferenceKind *refs) {
+    if(!refs->targetIdsIndex && refs->targetIdsSize >= UA_REFERENCETARGETS_INDEXTHRESHOLD)
+        rebuildTargetIndex(refs);
+}
+
+size_t
+UA_NodeReferenceKind_findTarget(const UA_NodeReferenceKind *refs,
+                                const UA_NodeId *targetId) {
+    return findTarget(refs, targetId, NULL);
+}
+
 static UA_StatusCode
 addReferenceTarget(UA_NodeReferenceKind *refs, const UA_ExpandedNodeId *target) {
-    UA_ExpandedNodeId *targets =
-        (UA_ExpandedNodeId*) UA_realloc(refs->targetIds,
-                                        sizeof(UA_ExpandedNodeId) * (refs->targetIdsSize+1));
-    if(!targets)
-        return UA_STATUSCODE_BADOUTOFMEMORY;
+    /* Grow the array geometrically. Targets that were set without
+     * UA_Node_addReference have no capacity. */
+    if(refs->targetIdsSize >= refs->targetIdsCapacity) {
+        size_t capacity = refs->targetIdsCapacity;
+        if(capacity < refs->targetIdsSize)
+            capacity = refs->targetIdsSize;
+        capacity *= 2;
+        if(capacity == 0)
+            capacity = 1;
+        UA_ExpandedNodeId *targets =
+            (UA_ExpandedNodeId*) UA_realloc(refs->targetIds,
+                                            sizeof(UA_ExpandedNodeId) * capacity);
+        if(!targets)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        refs->targetIds = targets;
+        refs->targetIdsCapacity = capacity;
+    }
 
-    refs->targetIds = targets;
     UA_StatusCode retval =
         UA_ExpandedNodeId_copy(target, &refs->targetIds[refs->targetIdsSize]);
-
-    if(retval == UA_STATUSCODE_GOOD) {
-        refs->targetIdsSize++;
-    } else if(refs->targetIdsSize == 0) {
-        /* We had zero references before (realloc was a malloc) */
-        UA_free(refs->targetIds);
-        refs->targetIds = NULL;
+    if(retval != UA_STATUSCODE_GOOD) {
+        if(refs->targetIdsSize == 0) {
+            /* We had zero references before (realloc was a malloc) */
+            UA_free(refs->targetIds);
+            refs->targetIds = NULL;
+            refs->targetIdsCapacity = 0;
+        }
+        return retval;
     }
-    return retval;
+    refs->targetIdsSize++;
+
+    /* At most half of the index slots are used */
+    if(refs->targetIdsIndex && refs->targetIdsSize * 2 <= refs->targetIdsIndexSize)
+        indexTarget(refs, refs->targetIdsSize - 1);
+    else if(refs->targetIdsSize >= UA_REFERENCETARGETS_INDEXTHRESHOLD)
+        rebuildTargetIndex(refs);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Moves the last target into the gap */
+static void
+removeReferenceTarget(UA_NodeReferenceKind *refs, size_t pos) {
+    if(refs->targetIdsIndex)
+        unindexTarget(refs, pos);
+    UA_ExpandedNodeId_deleteMembers(&refs->targetIds[pos]);
+    refs->targetIdsSize--;
+    size_t last = refs->targetIdsSize;
+    if(pos == last)
+        return;
+    if(refs->targetIdsIndex)
+        refs->targetIdsIndex[targetSlot(refs, last)] = pos + 1;
+    refs->targetIds[pos] = refs->targetIds[last];
 }
 
 static UA_StatusCode
@@ -544,12 +701,10 @@ UA_Node_addReference(UA_Node *node, const UA_AddReferencesItem *item) {
         }
     }
     if(existingRefs != NULL) {
-        for(size_t i = 0; i < existingRefs->targetIdsSize; i++) {
-            if(UA_ExpandedNodeId_equal(&existingRefs->targetIds[i],
-                                       &item->targetNodeId)) {
-                return UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED;
-            }
-        }
+        checkTargetIndex(existingRefs);
+        if(findTarget(existingRefs, &item->targetNodeId.nodeId,
+                      &item->targetNodeId) < existingRefs->targetIdsSize)
+            return UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED;
         return addReferenceTarget(existingRefs, &item->targetNodeId);
     }
     return addReferenceKind(node, item);
@@ -564,41 +719,35 @@ UA_Node_deleteReference(UA_Node *node, const UA_DeleteReferencesItem *item) {
         if(!UA_NodeId_equal(&item->referenceTypeId, &refs->referenceTypeId))
             continue;
 
-        for(size_t j = refs->targetIdsSize; j > 0; --j) {
-            UA_ExpandedNodeId *target = &refs->targetIds[j-1];
-            if(!UA_NodeId_equal(&item->targetNodeId.nodeId, &target->nodeId))
-                continue;
+        checkTargetIndex(refs);
+        size_t j = findTarget(refs, &item->targetNodeId.nodeId, NULL);
+        if(j == refs->targetIdsSize)
+            continue;
 
-            /* Ok, delete the reference */
-            UA_ExpandedNodeId_deleteMembers(target);
-            refs->targetIdsSize--;
-
-            /* One matching target remaining */
-            if(refs->targetIdsSize > 0) {
-                if(j-1 != refs->targetIdsSize) // avoid valgrind error: Source
-                                               // and destination overlap in
-                                               // memcpy
-                    *target = refs->targetIds[refs->targetIdsSize];
-                return UA_STATUSCODE_GOOD;
-            }
+        /* Ok, delete the reference */
+        removeReferenceTarget(refs, j);
 
-            /* No target for the ReferenceType remaining. Remove entry. */
-            UA_free(refs->targetIds);
-            UA_NodeId_deleteMembers(&refs->referenceTypeId);
-            node->referencesSize--;
-            if(node->referencesSize > 0) {
-                if(i-1 != node->referencesSize) // avoid valgrind error: Source
-                                                // and destination overlap in
-                                                // memcpy
-                    node->references[i-1] = node->references[node->referencesSize];
-                return UA_STATUSCODE_GOOD;
-            }
+        /* One matching target remaining */
+        if(refs->targetIdsSize > 0)
+            return UA_STATUSCODE_GOOD;
 
-            /* No remaining references of any ReferenceType */
-            UA_free(node->references);
-            node->references = NULL;
+        /* No target for the ReferenceType remaining. Remove entry. */
+        UA_free(refs->targetIds);
+        UA_free(refs->targetIdsIndex);
+        UA_NodeId_deleteMembers(&refs->referenceTypeId);
+        node->referencesSize--;
+        if(node->referencesSize > 0) {
+            if(i-1 != node->referencesSize) // avoid valgrind error: Source
+                                            // and destination overlap in
+                                            // memcpy
+                node->references[i-1] = node->references[node->referencesSize];
             return UA_STATUSCODE_GOOD;
         }
+
+        /* No remaining references of any ReferenceType */
+        UA_free(node->references);
+        node->references = NULL;
+        return UA_STATUSCODE_GOOD;
     }
     return UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED;
 }
@@ -626,6 +775,7 @@ UA_Node_deleteReferencesSubset(UA_Node *node, size_t referencesSkipSize,
 
         /* Remove references */
         UA_Array_delete(refs->targetIds, refs->targetIdsSize, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+        UA_free(refs->targetIdsIndex);
         UA_NodeId_deleteMembers(&refs->referenceTypeId);
         node->referencesSize--;
 
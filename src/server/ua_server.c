@@ -214,6 +214,10 @@ UA_Server_new(const UA_ServerConfig *config) {
 
     UA_WorkQueue_init(&server->workQueue);
 
+#ifdef UA_ENABLE_PUBSUB
+    UA_PubSubManager_init(&server->pubSubManager);
+#endif
+
     /* Initialize the adminSession */
     UA_Session_init(&server->adminSession);
     server->adminSession.sessionId.identifierType = UA_NODEIDTYPE_GUID;
@@ -122,6 +122,12 @@ struct UA_Server {
 void UA_Node_deleteReferencesSubset(UA_Node *node, size_t referencesSkipSize,
                                     UA_NodeId* referencesSkip);
 
+/* Returns the position of a target with the NodeId in the list of reference
+ * targets or targetIdsSize if there is none. Long lists are searched with the
+ * hash index. */
+size_t UA_NodeReferenceKind_findTarget(const UA_NodeReferenceKind *refs,
+                                       const UA_NodeId *targetId);
+
 /* Calls the callback with the node retrieved from the nodestore on top of the
  * stack. Either a copy or the original node for in-situ editing. Depends on
  * multithreading and the nodestore.*/
@@ -0,0 +1,345 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ua_server_internal.h"
+#include "ua_types_encoding_binary.h"
+
+/**************/
+/* Node Table */
+/**************/
+
+/* The pool is not aligned. Read little-endian byte by byte. */
+static UA_UInt32
+poolUInt32(const UA_NodeTable *table, size_t pos) {
+    const UA_Byte *p = &table->pool[pos];
+    return (UA_UInt32)p[0] | ((UA_UInt32)p[1] << 8) |
+        ((UA_UInt32)p[2] << 16) | ((UA_UInt32)p[3] << 24);
+}
+
+/* Returns a view on the string in the pool. The string is not copied. */
+static UA_String
+poolString(const UA_NodeTable *table, UA_UInt32 pos) {
+    UA_String s = UA_STRING_NULL;
+    if(pos == UA_NODETABLE_NONE || (size_t)pos + 4 > table->poolSize)
+        return s;
+    size_t length = poolUInt32(table, pos);
+    if((size_t)pos + 4 + length > table->poolSize || length == 0)
+        return s;
+    s.length = length;
+    s.data = (UA_Byte*)(uintptr_t)&table->pool[pos + 4];
+    return s;
+}
+
+static UA_LocalizedText
+poolLocalizedText(const UA_NodeTable *table, UA_UInt32 locale, UA_UInt32 text) {
+    UA_LocalizedText lt;
+    lt.locale = poolString(table, locale);
+    lt.text = poolString(table, text);
+    return lt;
+}
+
+static UA_UInt16
+mapNamespace(UA_UInt16 index, const UA_UInt16 *ns, size_t nsSize) {
+    return (index < nsSize) ? ns[index] : index;
+}
+
+static UA_NodeId
+tableNodeId(const UA_NodeTable *table, const UA_UInt16 *ns,
+            const UA_NodeTableId *id) {
+    UA_NodeId nodeId;
+    nodeId.namespaceIndex = mapNamespace(id->namespaceIndex, ns, table->namespacesSize);
+    if(id->identifierType == UA_NODEIDTYPE_STRING) {
+        nodeId.identifierType = UA_NODEIDTYPE_STRING;
+        nodeId.identifier.string = poolString(table, id->identifier);
+    } else {
+        nodeId.identifierType = UA_NODEIDTYPE_NUMERIC;
+        nodeId.identifier.numeric = id->identifier;
+    }
+    return nodeId;
+}
+
+/* Replace the namespace indices of the table in a decoded value. Values inside
+ * ExtensionObjects, Variants and DataValues are not changed. */
+static void
+remapValue(void *p, const UA_DataType *type, const UA_UInt16 *ns, size_t nsSize) {
+    if(type == &UA_TYPES[UA_TYPES_NODEID]) {
+        UA_NodeId *id = (UA_NodeId*)p;
+        id->namespaceIndex = mapNamespace(id->namespaceIndex, ns, nsSize);
+        return;
+    }
+    if(type == &UA_TYPES[UA_TYPES_EXPANDEDNODEID]) {
+        UA_ExpandedNodeId *id = (UA_ExpandedNodeId*)p;
+        id->nodeId.namespaceIndex = mapNamespace(id->nodeId.namespaceIndex, ns, nsSize);
+        return;
+    }
+    if(type == &UA_TYPES[UA_TYPES_QUALIFIEDNAME]) {
+        UA_QualifiedName *qn = (UA_QualifiedName*)p;
+        qn->namespaceIndex = mapNamespace(qn->namespaceIndex, ns, nsSize);
+        return;
+    }
+    if(type->builtin || type->pointerFree)
+        return;
+
+    uintptr_t ptr = (uintptr_t)p;
+    const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+    for(size_t i = 0; i < type->membersSize; ++i) {
+        const UA_DataTypeMember *member = &type->members[i];
+        const UA_DataType *membertype = &typelists[!member->namespaceZero][member->memberTypeIndex];
+        ptr += member->padding;
+        if(!member->isArray) {
+            remapValue((void*)ptr, membertype, ns, nsSize);
+            ptr += membertype->memSize;
+            continue;
+        }
+        size_t size = *(size_t*)ptr;
+        ptr += sizeof(size_t);
+        uintptr_t elem = (uintptr_t)*(void**)ptr;
+        for(size_t j = 0; j < size; ++j)
+            remapValue((void*)(elem + (j * membertype->memSize)), membertype, ns, nsSize);
+        ptr += sizeof(void*);
+    }
+}
+
+static UA_StatusCode
+decodeTableValue(UA_Server *server, const UA_NodeTable *table, const UA_UInt16 *ns,
+                 const UA_NodeTableVariable *tv, UA_Variant *value) {
+    const UA_DataType *type = tv->valueType;
+    if(!type)
+        return UA_STATUSCODE_GOOD;
+
+    size_t size = (tv->valueSize < 0) ? 1 : (size_t)tv->valueSize;
+    void *data;
+    if(tv->valueSize < 0)
+        data = UA_new(type);
+    else
+        data = UA_Array_new(size, type);
+    if(!data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    /* No encoded value. Keep the default-initialized scalar or the empty
+     * array. */
+    if(tv->value == UA_NODETABLE_NONE)
+        size = 0;
+
+    UA_ByteString src = {table->poolSize, (UA_Byte*)(uintptr_t)table->pool};
+    size_t offset = tv->value;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    uintptr_t ptr = (uintptr_t)data;
+    for(size_t i = 0; i < size && retval == UA_STATUSCODE_GOOD; ++i) {
+        retval = UA_decodeBinary(&src, &offset, (void*)ptr, type,
+                                 server->config.customDataTypes);
+        remapValue((void*)ptr, type, ns, table->namespacesSize);
+        ptr += type->memSize;
+    }
+
+    if(tv->valueSize < 0)
+        UA_Variant_setScalar(value, data, type);
+    else
+        UA_Variant_setArray(value, data, (size_t)tv->valueSize, type);
+    return retval;
+}
+
+/* Decodes the variable attributes that are common to Variables and
+ * VariableTypes. The value and the array dimensions are allocated. */
+static UA_StatusCode
+stageTableVariable(UA_Server *server, const UA_NodeTable *table, const UA_UInt16 *ns,
+                   const UA_NodeTableVariable *tv, UA_VariableAttributes *attr) {
+    attr->dataType = tableNodeId(table, ns, &tv->dataType);
+    attr->valueRank = tv->valueRank;
+    attr->accessLevel = tv->accessLevel;
+    attr->userAccessLevel = tv->userAccessLevel;
+    attr->minimumSamplingInterval = tv->minimumSamplingInterval;
+
+    if(tv->valueRank > 0 && tv->arrayDimensions != UA_NODETABLE_NONE) {
+        size_t dims = (size_t)tv->valueRank;
+        if((size_t)tv->arrayDimensions + (dims * 4) > table->poolSize)
+            return UA_STATUSCODE_BADINTERNALERROR;
+        attr->arrayDimensions = (UA_UInt32*)
+            UA_Array_new(dims, &UA_TYPES[UA_TYPES_UINT32]);
+        if(!attr->arrayDimensions)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        attr->arrayDimensionsSize = dims;
+        for(size_t i = 0; i < dims; ++i)
+            attr->arrayDimensions[i] = poolUInt32(table, tv->arrayDimensions + (i * 4));
+    }
+
+    UA_StatusCode retval = decodeTableValue(server, table, ns, tv, &attr->value);
+    if(retval != UA_STATUSCODE_GOOD || tv->valueRank < 2 || tv->valueSize < 0)
+        return retval;
+
+    /* Multi-dimensional arrays need the dimensions in the variant as well */
+    size_t total = 1;
+    for(size_t i = 0; i < attr->arrayDimensionsSize; ++i)
+        total *= attr->arrayDimensions[i];
+    if(attr->arrayDimensionsSize == 0 || total != attr->value.arrayLength)
+        return UA_STATUSCODE_GOOD;
+    retval = UA_Array_copy(attr->arrayDimensions, attr->arrayDimensionsSize,
+                           (void**)&attr->value.arrayDimensions,
+                           &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval == UA_STATUSCODE_GOOD)
+        attr->value.arrayDimensionsSize = attr->arrayDimensionsSize;
+    return retval;
+}
+
+static UA_StatusCode
+stageTableNode(UA_Server *server, UA_BulkLoad *bl, const UA_NodeTable *table,
+               const UA_UInt16 *ns, const UA_NodeTableNode *tn) {
+    /* All attribute structures begin with the fields of UA_NodeAttributes */
+    union {
+        UA_NodeAttributes node;
+        UA_ObjectAttributes object;
+        UA_VariableAttributes variable;
+        UA_VariableTypeAttributes variableType;
+        UA_MethodAttributes method;
+        UA_ObjectTypeAttributes objectType;
+        UA_ReferenceTypeAttributes referenceType;
+        UA_DataTypeAttributes dataType;
+        UA_ViewAttributes view;
+    } attr;
+    const UA_DataType *attributeType;
+    UA_Boolean isAbstract = (tn->flags & UA_NODETABLE_ISABSTRACT) != 0;
+
+    switch(tn->nodeClass) {
+    case UA_NODECLASS_OBJECT:
+        attr.object = UA_ObjectAttributes_default;
+        attr.object.eventNotifier = tn->eventNotifier;
+        attributeType = &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES];
+        break;
+    case UA_NODECLASS_VARIABLE:
+        attr.variable = UA_VariableAttributes_default;
+        attr.variable.historizing = (tn->flags & UA_NODETABLE_HISTORIZING) != 0;
+        attributeType = &UA_TYPES[UA_TYPES_VARIABLEATTRIBUTES];
+        break;
+    case UA_NODECLASS_VARIABLETYPE:
+        attr.variableType = UA_VariableTypeAttributes_default;
+        attr.variableType.isAbstract = isAbstract;
+        attributeType = &UA_TYPES[UA_TYPES_VARIABLETYPEATTRIBUTES];
+        break;
+    case UA_NODECLASS_METHOD:
+        attr.method = UA_MethodAttributes_default;
+        attr.method.executable = (tn->flags & UA_NODETABLE_EXECUTABLE) != 0;
+        attr.method.userExecutable = (tn->flags & UA_NODETABLE_USEREXECUTABLE) != 0;
+        attributeType = &UA_TYPES[UA_TYPES_METHODATTRIBUTES];
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        attr.objectType = UA_ObjectTypeAttributes_default;
+        attr.objectType.isAbstract = isAbstract;
+        attributeType = &UA_TYPES[UA_TYPES_OBJECTTYPEATTRIBUTES];
+        break;
+    case UA_NODECLASS_REFERENCETYPE:
+        attr.referenceType = UA_ReferenceTypeAttributes_default;
+        attr.referenceType.isAbstract = isAbstract;
+        attr.referenceType.symmetric = (tn->flags & UA_NODETABLE_SYMMETRIC) != 0;
+        attr.referenceType.inverseName =
+            poolLocalizedText(table, UA_NODETABLE_NONE, tn->inverseName);
+        attributeType = &UA_TYPES[UA_TYPES_REFERENCETYPEATTRIBUTES];
+        break;
+    case UA_NODECLASS_DATATYPE:
+        attr.dataType = UA_DataTypeAttributes_default;
+        attr.dataType.isAbstract = isAbstract;
+        attributeType = &UA_TYPES[UA_TYPES_DATATYPEATTRIBUTES];
+        break;
+    case UA_NODECLASS_VIEW:
+        attr.view = UA_ViewAttributes_default;
+        attr.view.containsNoLoops = (tn->flags & UA_NODETABLE_CONTAINSNOLOOPS) != 0;
+        attr.view.eventNotifier = tn->eventNotifier;
+        attributeType = &UA_TYPES[UA_TYPES_VIEWATTRIBUTES];
+        break;
+    default:
+        return UA_STATUSCODE_BADNODECLASSINVALID;
+    }
+
+    attr.node.displayName =
+        poolLocalizedText(table, tn->displayNameLocale, tn->displayNameText);
+#ifdef UA_ENABLE_NODESET_COMPILER_DESCRIPTIONS
+    attr.node.description =
+        poolLocalizedText(table, tn->descriptionLocale, tn->descriptionText);
+#endif
+    attr.node.writeMask = tn->writeMask;
+    attr.node.userWriteMask = tn->userWriteMask;
+
+    /* The strings point into the pool. Only the decoded value and the array
+     * dimensions in vAttr are owned. */
+    UA_VariableAttributes vAttr;
+    UA_VariableAttributes_init(&vAttr);
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(tn->nodeClass == UA_NODECLASS_VARIABLE ||
+       tn->nodeClass == UA_NODECLASS_VARIABLETYPE) {
+        if(tn->variable >= table->variablesSize)
+            return UA_STATUSCODE_BADINTERNALERROR;
+        retval = stageTableVariable(server, table, ns,
+                                    &table->variables[tn->variable], &vAttr);
+    }
+    if(tn->nodeClass == UA_NODECLASS_VARIABLE) {
+        attr.variable.value = vAttr.value;
+        attr.variable.dataType = vAttr.dataType;
+        attr.variable.valueRank = vAttr.valueRank;
+        attr.variable.arrayDimensionsSize = vAttr.arrayDimensionsSize;
+        attr.variable.arrayDimensions = vAttr.arrayDimensions;
+        attr.variable.accessLevel = vAttr.accessLevel;
+        attr.variable.userAccessLevel = vAttr.userAccessLevel;
+        attr.variable.minimumSamplingInterval = vAttr.minimumSamplingInterval;
+    } else if(tn->nodeClass == UA_NODECLASS_VARIABLETYPE) {
+        attr.variableType.value = vAttr.value;
+        attr.variableType.dataType = vAttr.dataType;
+        attr.variableType.valueRank = vAttr.valueRank;
+        attr.variableType.arrayDimensionsSize = vAttr.arrayDimensionsSize;
+        attr.variableType.arrayDimensions = vAttr.arrayDimensions;
+    }
+
+    UA_QualifiedName browseName;
+    browseName.namespaceIndex =
+        mapNamespace(tn->browseNameNamespace, ns, table->namespacesSize);
+    browseName.name = poolString(table, tn->browseName);
+
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_BulkLoad_addNode(bl, tn->nodeClass,
+                                     tableNodeId(table, ns, &tn->nodeId),
+                                     tableNodeId(table, ns, &tn->parentNodeId),
+                                     tableNodeId(table, ns, &tn->referenceTypeId),
+                                     browseName,
+                                     tableNodeId(table, ns, &tn->typeDefinition),
+                                     &attr, attributeType, NULL);
+    UA_Variant_deleteMembers(&vAttr.value);
+    UA_Array_delete(vAttr.arrayDimensions, vAttr.arrayDimensionsSize,
+                    &UA_TYPES[UA_TYPES_UINT32]);
+    return retval;
+}
+
+UA_StatusCode
+UA_Server_loadNodeTable(UA_Server *server, const UA_NodeTable *table) {
+    /* Use the namespace indices of the server */
+    UA_UInt16 *ns = (UA_UInt16*)UA_malloc(sizeof(UA_UInt16) * (table->namespacesSize + 1));
+    if(!ns)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(size_t i = 0; i < table->namespacesSize; ++i)
+        ns[i] = addNamespace(server, poolString(table, table->namespaces[i]));
+
+    UA_BulkLoad *bl;
+    UA_StatusCode retval = UA_Server_bulkLoad_begin(server, &bl);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_free(ns);
+        return retval;
+    }
+
+    for(size_t i = 0; i < table->nodesSize && retval == UA_STATUSCODE_GOOD; ++i)
+        retval = stageTableNode(server, bl, table, ns, &table->nodes[i]);
+
+    for(size_t i = 0; i < table->referencesSize && retval == UA_STATUSCODE_GOOD; ++i) {
+        const UA_NodeTableReference *tr = &table->references[i];
+        UA_ExpandedNodeId target;
+        UA_ExpandedNodeId_init(&target);
+        target.nodeId = tableNodeId(table, ns, &tr->target);
+        retval = UA_BulkLoad_addReference(bl, tableNodeId(table, ns, &tr->source),
+                                          tableNodeId(table, ns, &tr->referenceType),
+                                          target, tr->isForward);
+    }
+    UA_free(ns);
+
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_BulkLoad_delete(bl);
+        return retval;
+    }
+    return UA_BulkLoad_commit(bl, NULL, NULL);
+}
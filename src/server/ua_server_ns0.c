@@ -562,27 +562,62 @@ UA_Server_minimalServerObject(UA_Server *server) {
 }
 #endif
 
+/* The nodestore already contains the address space (e.g. from a snapshot).
+ * Register the namespaces stored in the NamespaceArray variable. */
+static UA_StatusCode
+restoreNamespaces(UA_Server *server) {
+    const UA_NodeId nsArrayId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_NAMESPACEARRAY);
+    const UA_VariableNode *vn = (const UA_VariableNode*)
+        UA_Nodestore_get(server, &nsArrayId);
+    if(!vn)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    const UA_Variant *v = &vn->value.data.value.value;
+    if(vn->nodeClass != UA_NODECLASS_VARIABLE ||
+       vn->valueSource != UA_VALUESOURCE_DATA ||
+       !UA_Variant_hasArrayType(v, &UA_TYPES[UA_TYPES_STRING])) {
+        retval = UA_STATUSCODE_BADTYPEMISMATCH;
+    } else {
+        const UA_String *namespaces = (const UA_String*)v->data;
+        for(size_t i = 2; i < v->arrayLength; ++i)
+            addNamespace(server, namespaces[i]);
+    }
+    UA_Nodestore_release(server, (const UA_Node*)vn);
+    return retval;
+}
+
 /* Initialize the nodeset 0 by using the generated code of the nodeset compiler.
  * This also initialized the data sources for various variables, such as for
  * example server time. */
 UA_StatusCode
 UA_Server_initNS0(UA_Server *server) {
-
-    /* Initialize base nodes which are always required an cannot be created
-     * through the NS compiler */
-    server->bootstrapNS0 = true;
-    UA_StatusCode retVal = UA_Server_createNS0_base(server);
-    server->bootstrapNS0 = false;
-    if(retVal != UA_STATUSCODE_GOOD)
-        return retVal;
+    UA_StatusCode retVal;
+
+    /* Namespace 0 was already built if the nodestore was created from a
+     * snapshot. Then only the data sources and variables are set up. */
+    const UA_NodeId serverId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    const UA_Node *serverNode = UA_Nodestore_get(server, &serverId);
+    UA_Boolean restored = (serverNode != NULL);
+    if(restored) {
+        UA_Nodestore_release(server, serverNode);
+        retVal = restoreNamespaces(server);
+    } else {
+        /* Initialize base nodes which are always required an cannot be
+         * created through the NS compiler */
+        server->bootstrapNS0 = true;
+        retVal = UA_Server_createNS0_base(server);
+        server->bootstrapNS0 = false;
+        if(retVal != UA_STATUSCODE_GOOD)
+            return retVal;
 
 #ifdef UA_GENERATED_NAMESPACE_ZERO
-    /* Load nodes and references generated from the XML ns0 definition */
-    retVal = ua_namespace0(server);
+        /* Load nodes and references generated from the XML ns0 definition */
+        retVal = ua_namespace0(server);
 #else
-    /* Create a minimal server object */
-    retVal = UA_Server_minimalServerObject(server);
+        /* Create a minimal server object */
+        retVal = UA_Server_minimalServerObject(server);
 #endif
+    }
 
     if(retVal != UA_STATUSCODE_GOOD) {
         UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
@@ -840,14 +875,16 @@ UA_Server_initNS0(UA_Server *server) {
      * directly, but need to create a subtype. This is already posted on the OPC Foundation bug tracker under the
      * following link for clarification: https://opcfoundation-onlineapplications.org/mantis/view.php?id=4206 */
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-    UA_ObjectTypeAttributes overflowAttr = UA_ObjectTypeAttributes_default;
-    overflowAttr.description = UA_LOCALIZEDTEXT("en-US", "A simple event for indicating a queue overflow.");
-    overflowAttr.displayName = UA_LOCALIZEDTEXT("en-US", "SimpleOverflowEventType");
-    UA_Server_addObjectTypeNode(server, UA_NODEID_NUMERIC(0, UA_NS0ID_SIMPLEOVERFLOWEVENTTYPE),
-                                UA_NODEID_NUMERIC(0, UA_NS0ID_EVENTQUEUEOVERFLOWEVENTTYPE),
-                                UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
-                                UA_QUALIFIEDNAME(0, "SimpleOverflowEventType"),
-                                overflowAttr, NULL, NULL);
+    if(!restored) {
+        UA_ObjectTypeAttributes overflowAttr = UA_ObjectTypeAttributes_default;
+        overflowAttr.description = UA_LOCALIZEDTEXT("en-US", "A simple event for indicating a queue overflow.");
+        overflowAttr.displayName = UA_LOCALIZEDTEXT("en-US", "SimpleOverflowEventType");
+        UA_Server_addObjectTypeNode(server, UA_NODEID_NUMERIC(0, UA_NS0ID_SIMPLEOVERFLOWEVENTTYPE),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_EVENTQUEUEOVERFLOWEVENTTYPE),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                    UA_QUALIFIEDNAME(0, "SimpleOverflowEventType"),
+                                    overflowAttr, NULL, NULL);
+    }
 #endif
 
     if(retVal != UA_STATUSCODE_GOOD) {
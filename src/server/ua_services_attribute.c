@@ -1445,21 +1445,27 @@ Service_HistoryRead(UA_Server *server, UA_Session *session,
         return;
     }
 
-    if(request->historyReadDetails.content.decoded.type != &UA_TYPES[UA_TYPES_READRAWMODIFIEDDETAILS]) {
+    UA_ReadRawModifiedDetails *details = NULL;
+    UA_ReadProcessedDetails *processedDetails = NULL;
+    const UA_DataType *detailsType = request->historyReadDetails.content.decoded.type;
+    if(detailsType == &UA_TYPES[UA_TYPES_READRAWMODIFIEDDETAILS]) {
+        /* History read with ReadRawModifiedDetails */
+        details = (UA_ReadRawModifiedDetails*)request->historyReadDetails.content.decoded.data;
+        if(details->isReadModified) {
+            // TODO add server->config.historyReadService.read_modified
+            response->responseHeader.serviceResult = UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
+            return;
+        }
+    } else if(detailsType == &UA_TYPES[UA_TYPES_READPROCESSEDDETAILS]) {
+        /* History read with ReadProcessedDetails */
+        processedDetails = (UA_ReadProcessedDetails*)
+            request->historyReadDetails.content.decoded.data;
+    } else {
         /* TODO handle more request->historyReadDetails.content.decoded.type types */
         response->responseHeader.serviceResult = UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
         return;
     }
 
-    /* History read with ReadRawModifiedDetails */
-    UA_ReadRawModifiedDetails * details = (UA_ReadRawModifiedDetails*)
-        request->historyReadDetails.content.decoded.data;
-    if(details->isReadModified) {
-        // TODO add server->config.historyReadService.read_modified
-        response->responseHeader.serviceResult = UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
-        return;
-    }
-
     /* Something to do? */
     if(request->nodesToReadSize == 0) {
         response->responseHeader.serviceResult = UA_STATUSCODE_BADNOTHINGTODO;
@@ -1473,8 +1479,16 @@ Service_HistoryRead(UA_Server *server, UA_Session *session,
         return;
     }
 
+    /* One aggregate is requested for every node */
+    if(processedDetails &&
+       processedDetails->aggregateTypeSize != request->nodesToReadSize) {
+        response->responseHeader.serviceResult = UA_STATUSCODE_BADAGGREGATELISTMISMATCH;
+        return;
+    }
+
     /* The history database is not configured */
-    if(!server->config.historyDatabase.readRaw) {
+    if((details && !server->config.historyDatabase.readRaw) ||
+       (processedDetails && !server->config.historyDatabase.readProcessed)) {
         response->responseHeader.serviceResult = UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
         return;
     }
@@ -1505,13 +1519,22 @@ Service_HistoryRead(UA_Server *server, UA_Session *session,
         response->results[i].historyData.content.decoded.data = data;
         historyData[i] = data;
     }
-    server->config.historyDatabase.readRaw(server, server->config.historyDatabase.context,
-                                           &session->sessionId, session->sessionHandle,
-                                           &request->requestHeader, details,
-                                           request->timestampsToReturn,
-                                           request->releaseContinuationPoints,
-                                           request->nodesToReadSize, request->nodesToRead,
-                                           response, historyData);
+    if(details)
+        server->config.historyDatabase.readRaw(server, server->config.historyDatabase.context,
+                                               &session->sessionId, session->sessionHandle,
+                                               &request->requestHeader, details,
+                                               request->timestampsToReturn,
+                                               request->releaseContinuationPoints,
+                                               request->nodesToReadSize, request->nodesToRead,
+                                               response, historyData);
+    else
+        server->config.historyDatabase.readProcessed(server, server->config.historyDatabase.context,
+                                                     &session->sessionId, session->sessionHandle,
+                                                     &request->requestHeader, processedDetails,
+                                                     request->timestampsToReturn,
+                                                     request->releaseContinuationPoints,
+                                                     request->nodesToReadSize, request->nodesToRead,
+                                                     response, historyData);
     UA_free(historyData);
 }
 #endif
@@ -150,12 +150,7 @@ callWithMethodAndObject(UA_Server *server, UA_Session *session,
         if(!isNodeInTree(&server->config.nodestore, &rk->referenceTypeId,
                          &hasComponentNodeId, &hasSubTypeNodeId, 1))
             continue;
-        for(size_t j = 0; j < rk->targetIdsSize; ++j) {
-            if(UA_NodeId_equal(&rk->targetIds[j].nodeId, &request->methodId)) {
-                found = true;
-                break;
-            }
-        }
+        found = UA_NodeReferenceKind_findTarget(rk, &request->methodId) < rk->targetIdsSize;
     }
     if(!found) {
         result->statusCode = UA_STATUSCODE_BADMETHODINVALID;
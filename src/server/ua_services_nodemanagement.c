@@ -371,11 +371,9 @@ isMandatoryChild(UA_Server *server, UA_Session *session,
             continue;
         if(refs->isInverse)
             continue;
-        for(size_t j = 0; j < refs->targetIdsSize; ++j) {
-            if(UA_NodeId_equal(&mandatoryId, &refs->targetIds[j].nodeId)) {
-                UA_Nodestore_release(server, child);
-                return true;
-            }
+        if(UA_NodeReferenceKind_findTarget(refs, &mandatoryId) < refs->targetIdsSize) {
+            UA_Nodestore_release(server, child);
+            return true;
         }
     }
 
@@ -620,6 +618,31 @@ removeDeconstructedNode(UA_Server *server, UA_Session *session,
 
 static const UA_NodeId hasSubtype = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_HASSUBTYPE}};
 
+/* Test if the type definition has the right node class */
+static UA_Boolean
+typeMatchesNodeClass(UA_NodeClass nodeClass, UA_NodeClass typeNodeClass) {
+    switch(nodeClass) {
+        case UA_NODECLASS_DATATYPE:
+            return typeNodeClass == UA_NODECLASS_DATATYPE;
+        case UA_NODECLASS_METHOD:
+            return typeNodeClass == UA_NODECLASS_METHOD;
+        case UA_NODECLASS_OBJECT:
+            return typeNodeClass == UA_NODECLASS_OBJECTTYPE;
+        case UA_NODECLASS_OBJECTTYPE:
+            return typeNodeClass == UA_NODECLASS_OBJECTTYPE;
+        case UA_NODECLASS_REFERENCETYPE:
+            return typeNodeClass == UA_NODECLASS_REFERENCETYPE;
+        case UA_NODECLASS_VARIABLE:
+            return typeNodeClass == UA_NODECLASS_VARIABLETYPE;
+        case UA_NODECLASS_VARIABLETYPE:
+            return typeNodeClass == UA_NODECLASS_VARIABLETYPE;
+        case UA_NODECLASS_VIEW:
+            return typeNodeClass == UA_NODECLASS_VIEW;
+        default:
+            return false;
+    }
+}
+
 UA_StatusCode
 AddNode_addRefs(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
                 const UA_NodeId *parentNodeId, const UA_NodeId *referenceTypeId,
@@ -684,36 +707,7 @@ AddNode_addRefs(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
             goto cleanup;
         }
 
-        UA_Boolean typeOk = false;
-        switch(node->nodeClass) {
-            case UA_NODECLASS_DATATYPE:
-                typeOk = type->nodeClass == UA_NODECLASS_DATATYPE;
-                break;
-            case UA_NODECLASS_METHOD:
-                typeOk = type->nodeClass == UA_NODECLASS_METHOD;
-                break;
-            case UA_NODECLASS_OBJECT:
-                typeOk = type->nodeClass == UA_NODECLASS_OBJECTTYPE;
-                break;
-            case UA_NODECLASS_OBJECTTYPE:
-                typeOk = type->nodeClass == UA_NODECLASS_OBJECTTYPE;
-                break;
-            case UA_NODECLASS_REFERENCETYPE:
-                typeOk = type->nodeClass == UA_NODECLASS_REFERENCETYPE;
-                break;
-            case UA_NODECLASS_VARIABLE:
-                typeOk = type->nodeClass == UA_NODECLASS_VARIABLETYPE;
-                break;
-            case UA_NODECLASS_VARIABLETYPE:
-                typeOk = type->nodeClass == UA_NODECLASS_VARIABLETYPE;
-                break;
-            case UA_NODECLASS_VIEW:
-                typeOk = type->nodeClass == UA_NODECLASS_VIEW;
-                break;
-            default:
-                typeOk = false;
-        }
-        if(!typeOk) {
+        if(!typeMatchesNodeClass(node->nodeClass, type->nodeClass)) {
             UA_LOG_NODEID_WRAP(nodeId, UA_LOG_INFO_SESSION(&server->config.logger, session,
                                 "AddNodes: Type for %.*s does not match node class",
                                 (int)nodeIdStr.length, nodeIdStr.data));
@@ -1785,3 +1779,894 @@ UA_Server_setNodeTypeLifecycle(UA_Server *server, UA_NodeId nodeId,
                               (UA_EditNodeCallback)setNodeTypeLifecycle,
                               &lifecycle);
 }
+
+/*************/
+/* Bulk Load */
+/*************/
+
+/* The staged nodes are committed in phases. Every phase is validated, wired
+ * and inserted completely before the next phase starts. So the nodestore
+ * contains the DataTypes and ReferenceTypes when the ObjectTypes and
+ * VariableTypes are checked. And it contains all types when the instances are
+ * checked. */
+#define UA_BULKLOAD_PHASES 3
+
+typedef struct {
+    UA_Node *node; /* NULL after the node was inserted */
+    UA_NodeId nodeId;
+    UA_NodeId parentNodeId;
+    UA_NodeId referenceTypeId;
+    UA_NodeId typeDefinitionId;
+    UA_StatusCode status;
+    UA_Byte phase;
+    UA_Boolean construct; /* Call the constructors after the commit */
+} UA_BulkLoadNode;
+
+typedef struct {
+    UA_NodeId sourceId;
+    UA_NodeId referenceTypeId;
+    UA_NodeId targetId;
+    UA_Boolean isForward;
+    UA_StatusCode status;
+    UA_Byte phase;
+} UA_BulkLoadReference;
+
+struct UA_BulkLoad {
+    UA_Server *server;
+    UA_BulkLoadNode *nodes;
+    size_t nodesSize;
+    size_t nodesCapacity;
+    UA_BulkLoadReference *refs;
+    size_t refsSize;
+    size_t refsCapacity;
+};
+
+static UA_Byte
+bulkLoadPhase(UA_NodeClass nodeClass) {
+    switch(nodeClass) {
+    case UA_NODECLASS_DATATYPE:
+    case UA_NODECLASS_REFERENCETYPE:
+        return 0;
+    case UA_NODECLASS_OBJECTTYPE:
+    case UA_NODECLASS_VARIABLETYPE:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
+UA_StatusCode
+UA_Server_bulkLoad_begin(UA_Server *server, UA_BulkLoad **bulkLoad) {
+    UA_BulkLoad *bl = (UA_BulkLoad*)UA_calloc(1, sizeof(UA_BulkLoad));
+    if(!bl)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    bl->server = server;
+    *bulkLoad = bl;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+deleteBulkNode(UA_Server *server, UA_BulkLoadNode *bn) {
+    if(bn->node)
+        UA_Nodestore_delete(server, bn->node);
+    UA_NodeId_deleteMembers(&bn->nodeId);
+    UA_NodeId_deleteMembers(&bn->parentNodeId);
+    UA_NodeId_deleteMembers(&bn->referenceTypeId);
+    UA_NodeId_deleteMembers(&bn->typeDefinitionId);
+}
+
+static void
+deleteBulkReference(UA_BulkLoadReference *br) {
+    UA_NodeId_deleteMembers(&br->sourceId);
+    UA_NodeId_deleteMembers(&br->referenceTypeId);
+    UA_NodeId_deleteMembers(&br->targetId);
+}
+
+void
+UA_BulkLoad_delete(UA_BulkLoad *bl) {
+    for(size_t i = 0; i < bl->nodesSize; ++i)
+        deleteBulkNode(bl->server, &bl->nodes[i]);
+    for(size_t i = 0; i < bl->refsSize; ++i)
+        deleteBulkReference(&bl->refs[i]);
+    UA_free(bl->nodes);
+    UA_free(bl->refs);
+    UA_free(bl);
+}
+
+UA_StatusCode
+UA_BulkLoad_addNode(UA_BulkLoad *bl, const UA_NodeClass nodeClass,
+                    const UA_NodeId requestedNewNodeId,
+                    const UA_NodeId parentNodeId,
+                    const UA_NodeId referenceTypeId,
+                    const UA_QualifiedName browseName,
+                    const UA_NodeId typeDefinition,
+                    const void *attr, const UA_DataType *attributeType,
+                    void *nodeContext) {
+    UA_Server *server = bl->server;
+
+    /* The NodeIds are needed to wire the references before the commit */
+    if(UA_NodeId_isNull(&requestedNewNodeId) ||
+       requestedNewNodeId.namespaceIndex >= server->namespacesSize)
+        return UA_STATUSCODE_BADNODEIDINVALID;
+
+    if(bl->nodesSize >= bl->nodesCapacity) {
+        size_t capacity = bl->nodesCapacity * 2;
+        if(capacity == 0)
+            capacity = 64;
+        UA_BulkLoadNode *nodes = (UA_BulkLoadNode*)
+            UA_realloc(bl->nodes, capacity * sizeof(UA_BulkLoadNode));
+        if(!nodes)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        bl->nodes = nodes;
+        bl->nodesCapacity = capacity;
+    }
+
+    /* Create the node */
+    UA_BulkLoadNode *bn = &bl->nodes[bl->nodesSize];
+    memset(bn, 0, sizeof(UA_BulkLoadNode));
+    bn->node = UA_Nodestore_new(server, nodeClass);
+    if(!bn->node)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    bn->node->context = nodeContext;
+    bn->phase = bulkLoadPhase(nodeClass);
+    UA_StatusCode retval = UA_NodeId_copy(&requestedNewNodeId, &bn->node->nodeId);
+    retval |= UA_QualifiedName_copy(&browseName, &bn->node->browseName);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_Node_setAttributes(bn->node, attr, attributeType);
+    retval |= UA_NodeId_copy(&requestedNewNodeId, &bn->nodeId);
+    retval |= UA_NodeId_copy(&parentNodeId, &bn->parentNodeId);
+    retval |= UA_NodeId_copy(&referenceTypeId, &bn->referenceTypeId);
+    retval |= UA_NodeId_copy(&typeDefinition, &bn->typeDefinitionId);
+    if(retval != UA_STATUSCODE_GOOD) {
+        deleteBulkNode(server, bn);
+        return retval;
+    }
+    bl->nodesSize++;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_BulkLoad_addReference(UA_BulkLoad *bl, const UA_NodeId sourceId,
+                         const UA_NodeId refTypeId,
+                         const UA_ExpandedNodeId targetId, UA_Boolean isForward) {
+    /* Currently no expandednodeids are allowed */
+    if(targetId.serverIndex > 0 || targetId.namespaceUri.length > 0)
+        return UA_STATUSCODE_BADNOTIMPLEMENTED;
+
+    if(bl->refsSize >= bl->refsCapacity) {
+        size_t capacity = bl->refsCapacity * 2;
+        if(capacity == 0)
+            capacity = 64;
+        UA_BulkLoadReference *refs = (UA_BulkLoadReference*)
+            UA_realloc(bl->refs, capacity * sizeof(UA_BulkLoadReference));
+        if(!refs)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        bl->refs = refs;
+        bl->refsCapacity = capacity;
+    }
+
+    UA_BulkLoadReference *br = &bl->refs[bl->refsSize];
+    memset(br, 0, sizeof(UA_BulkLoadReference));
+    br->isForward = isForward;
+    UA_StatusCode retval = UA_NodeId_copy(&sourceId, &br->sourceId);
+    retval |= UA_NodeId_copy(&refTypeId, &br->referenceTypeId);
+    retval |= UA_NodeId_copy(&targetId.nodeId, &br->targetId);
+    if(retval != UA_STATUSCODE_GOOD) {
+        deleteBulkReference(br);
+        return retval;
+    }
+    bl->refsSize++;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* A node that was looked up during the validation of a phase. The checks that
+ * only depend on the node are cached here. So they run once per distinct type
+ * and ReferenceType. */
+typedef struct {
+    const UA_Node *node;
+    UA_Boolean held;              /* Release the node at the end of the phase */
+    UA_Boolean referenceChecked;
+    UA_StatusCode referenceStatus;
+    UA_Boolean dataTypeChecked;   /* The last DataType checked against the */
+    UA_Boolean dataTypeOk;        /* VariableType. Siblings mostly share the */
+    UA_NodeId dataType;           /* same DataType. */
+} UA_BulkLoadType;
+
+/* One direction of a reference to a node that is not part of the current
+ * phase. The node is edited once for all references. */
+typedef struct {
+    UA_UInt32 hash;
+    UA_AddReferencesItem item; /* Shallow; points into the bulk load */
+    size_t dependsOn;          /* Staged node at the other end + 1 */
+    size_t reference;          /* Staged reference + 1 */
+} UA_BulkLoadExternal;
+
+typedef struct {
+    UA_Server *server;
+    UA_Session *session;
+    UA_BulkLoad *bl;
+    UA_Byte phase;
+
+    /* NodeId -> position of the staged node + 1 */
+    size_t *index;
+    size_t indexSize;
+
+    /* NodeId -> position in types + 1 */
+    UA_BulkLoadType *types;
+    size_t typesSize;
+    size_t typesCapacity;
+    size_t *typesIndex;
+    size_t typesIndexSize;
+
+    UA_BulkLoadExternal *externals;
+    size_t externalsSize;
+    size_t externalsCapacity;
+
+    /* Reference types for the check of instances of abstract types */
+    UA_NodeId *parentTypeHierarchy;
+    size_t parentTypeHierarchySize;
+} UA_BulkLoadCommit;
+
+/* Sequential numeric NodeIds have sequential hashes. Scramble them for the
+ * linearly probed power-of-two tables. */
+static size_t
+bulkLoadSlot(const UA_NodeId *id, size_t tableSize) {
+    UA_UInt32 h = UA_NodeId_hash(id);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h & (tableSize - 1);
+}
+
+static size_t
+findStaged(const UA_BulkLoadCommit *bc, const UA_NodeId *id) {
+    size_t mask = bc->indexSize - 1;
+    for(size_t slot = bulkLoadSlot(id, bc->indexSize); bc->index[slot] != 0;
+        slot = (slot + 1) & mask) {
+        if(UA_NodeId_equal(&bc->bl->nodes[bc->index[slot] - 1].nodeId, id))
+            return bc->index[slot];
+    }
+    return 0;
+}
+
+/* Index the staged nodes. NodeIds that are staged twice or exist already are
+ * rejected. Nodes that exist already remain in the index with their failed
+ * status. Otherwise the staged nodes below them would be added to the existing
+ * node. */
+static UA_StatusCode
+indexStaged(UA_BulkLoadCommit *bc) {
+    bc->indexSize = 64;
+    while(bc->indexSize < bc->bl->nodesSize * 2)
+        bc->indexSize <<= 1;
+    bc->index = (size_t*)UA_calloc(bc->indexSize, sizeof(size_t));
+    if(!bc->index)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    size_t mask = bc->indexSize - 1;
+    for(size_t i = 0; i < bc->bl->nodesSize; ++i) {
+        UA_BulkLoadNode *bn = &bc->bl->nodes[i];
+        if(findStaged(bc, &bn->nodeId) != 0) {
+            bn->status = UA_STATUSCODE_BADNODEIDEXISTS;
+            continue;
+        }
+        const UA_Node *existing = UA_Nodestore_get(bc->server, &bn->nodeId);
+        if(existing) {
+            UA_Nodestore_release(bc->server, existing);
+            bn->status = UA_STATUSCODE_BADNODEIDEXISTS;
+        }
+        size_t slot = bulkLoadSlot(&bn->nodeId, bc->indexSize);
+        while(bc->index[slot] != 0)
+            slot = (slot + 1) & mask;
+        bc->index[slot] = i + 1;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Returns the node from the current phase or from the nodestore. Staged nodes
+ * that failed or belong to a later phase are not found. */
+static const UA_Node *
+getBulkNode(UA_BulkLoadCommit *bc, const UA_NodeId *id, UA_Boolean *held) {
+    *held = false;
+    size_t staged = findStaged(bc, id);
+    if(staged != 0) {
+        const UA_BulkLoadNode *bn = &bc->bl->nodes[staged - 1];
+        if(bn->status != UA_STATUSCODE_GOOD || bn->phase > bc->phase)
+            return NULL;
+        if(bn->phase == bc->phase)
+            return bn->node;
+        /* Inserted in an earlier phase */
+    }
+    const UA_Node *node = UA_Nodestore_get(bc->server, id);
+    *held = (node != NULL);
+    return node;
+}
+
+static UA_Boolean
+bulkNodeExists(UA_BulkLoadCommit *bc, const UA_NodeId *id) {
+    UA_Boolean held;
+    const UA_Node *node = getBulkNode(bc, id, &held);
+    if(held)
+        UA_Nodestore_release(bc->server, node);
+    return (node != NULL);
+}
+
+static UA_BulkLoadType *
+getBulkType(UA_BulkLoadCommit *bc, const UA_NodeId *id) {
+    if(bc->typesIndexSize > 0) {
+        size_t mask = bc->typesIndexSize - 1;
+        for(size_t slot = bulkLoadSlot(id, bc->typesIndexSize); bc->typesIndex[slot] != 0;
+            slot = (slot + 1) & mask) {
+            UA_BulkLoadType *bt = &bc->types[bc->typesIndex[slot] - 1];
+            if(UA_NodeId_equal(&bt->node->nodeId, id))
+                return bt;
+        }
+    }
+
+    /* Missing nodes are not cached. They are an error anyway. */
+    UA_Boolean held;
+    const UA_Node *node = getBulkNode(bc, id, &held);
+    if(!node)
+        return NULL;
+
+    /* Grow the table and rebuild the index */
+    if(bc->typesSize >= bc->typesCapacity) {
+        size_t capacity = bc->typesCapacity * 2;
+        if(capacity == 0)
+            capacity = 16;
+        UA_BulkLoadType *types = (UA_BulkLoadType*)
+            UA_realloc(bc->types, capacity * sizeof(UA_BulkLoadType));
+        size_t *typesIndex = (size_t*)UA_calloc(capacity * 2, sizeof(size_t));
+        if(types)
+            bc->types = types;
+        if(!types || !typesIndex) {
+            UA_free(typesIndex);
+            if(held)
+                UA_Nodestore_release(bc->server, node);
+            return NULL;
+        }
+        UA_free(bc->typesIndex);
+        bc->typesIndex = typesIndex;
+        bc->typesIndexSize = capacity * 2;
+        bc->typesCapacity = capacity;
+        for(size_t i = 0; i < bc->typesSize; ++i) {
+            size_t slot = bulkLoadSlot(&bc->types[i].node->nodeId, bc->typesIndexSize);
+            while(bc->typesIndex[slot] != 0)
+                slot = (slot + 1) & (bc->typesIndexSize - 1);
+            bc->typesIndex[slot] = i + 1;
+        }
+    }
+
+    UA_BulkLoadType *bt = &bc->types[bc->typesSize];
+    memset(bt, 0, sizeof(UA_BulkLoadType));
+    bt->node = node;
+    bt->held = held;
+    size_t slot = bulkLoadSlot(id, bc->typesIndexSize);
+    while(bc->typesIndex[slot] != 0)
+        slot = (slot + 1) & (bc->typesIndexSize - 1);
+    bc->typesIndex[slot] = ++bc->typesSize;
+    return bt;
+}
+
+/* The cached nodes become stale when the phase is written to the nodestore */
+static void
+clearBulkTypes(UA_BulkLoadCommit *bc) {
+    for(size_t i = 0; i < bc->typesSize; ++i) {
+        if(bc->types[i].held)
+            UA_Nodestore_release(bc->server, bc->types[i].node);
+        UA_NodeId_deleteMembers(&bc->types[i].dataType);
+    }
+    bc->typesSize = 0;
+    if(bc->typesIndex)
+        memset(bc->typesIndex, 0, bc->typesIndexSize * sizeof(size_t));
+}
+
+/* The ReferenceType must exist, must not be abstract and must be
+ * hierarchical */
+static UA_StatusCode
+checkBulkParentReferenceType(UA_BulkLoadCommit *bc, const UA_NodeId *referenceTypeId) {
+    UA_BulkLoadType *bt = getBulkType(bc, referenceTypeId);
+    if(!bt || bt->node->nodeClass != UA_NODECLASS_REFERENCETYPE)
+        return UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
+    if(bt->referenceChecked)
+        return bt->referenceStatus;
+    bt->referenceChecked = true;
+    if(((const UA_ReferenceTypeNode*)bt->node)->isAbstract)
+        bt->referenceStatus = UA_STATUSCODE_BADREFERENCENOTALLOWED;
+    else if(!isNodeInTree(&bc->server->config.nodestore, referenceTypeId,
+                          &hierarchicalReferences, &subtypeId, 1))
+        bt->referenceStatus = UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
+    else
+        bt->referenceStatus = UA_STATUSCODE_GOOD;
+    return bt->referenceStatus;
+}
+
+/* Instances of abstract types are only allowed below a type definition. Staged
+ * ancestors are followed until a type node or a node in the nodestore is
+ * found. */
+static UA_Boolean
+bulkBelowTypeDefinition(UA_BulkLoadCommit *bc, const UA_BulkLoadNode *bn) {
+    if(!bc->parentTypeHierarchy &&
+       getTypesHierarchy(&bc->server->config.nodestore, parentReferences,
+                         UA_PARENT_REFERENCES_COUNT, &bc->parentTypeHierarchy,
+                         &bc->parentTypeHierarchySize, true) != UA_STATUSCODE_GOOD)
+        return false;
+
+    const UA_NodeId *parentId = &bn->parentNodeId;
+    for(size_t i = 0; i < bc->bl->nodesSize; ++i) {
+        size_t staged = findStaged(bc, parentId);
+        if(staged == 0 || bc->bl->nodes[staged - 1].phase < bc->phase)
+            break;
+        const UA_BulkLoadNode *parent = &bc->bl->nodes[staged - 1];
+        if(parent->phase > bc->phase)
+            return false;
+        parentId = &parent->parentNodeId;
+    }
+
+    /* Objects and variables in the type hierarchy */
+    if(isNodeInTree(&bc->server->config.nodestore, parentId, &baseObjectType,
+                    bc->parentTypeHierarchy, bc->parentTypeHierarchySize))
+        return true;
+    return (bn->node->nodeClass == UA_NODECLASS_VARIABLE &&
+            isNodeInTree(&bc->server->config.nodestore, parentId, &baseDataVariableType,
+                         bc->parentTypeHierarchy, bc->parentTypeHierarchySize));
+}
+
+/* Use the attributes of the VariableType where they are missing and check the
+ * constraints of the type. Unlike UA_Server_addNode_finish, values of a
+ * mismatching type are not converted. */
+static UA_StatusCode
+typeCheckBulkVariable(UA_BulkLoadCommit *bc, UA_VariableNode *node,
+                      UA_BulkLoadType *bt) {
+    const UA_VariableTypeNode *vt = (const UA_VariableTypeNode*)bt->node;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    UA_DataValue *value = &node->value.data.value;
+    if(!value->value.type && vt->valueSource == UA_VALUESOURCE_DATA &&
+       vt->value.data.value.value.type) {
+        retval = UA_Variant_copy(&vt->value.data.value.value, &value->value);
+        value->hasValue = (retval == UA_STATUSCODE_GOOD);
+    }
+    if(retval == UA_STATUSCODE_GOOD && UA_NodeId_isNull(&node->dataType))
+        retval = UA_NodeId_copy(&vt->dataType, &node->dataType);
+    if(retval == UA_STATUSCODE_GOOD && node->arrayDimensionsSize == 0 &&
+       vt->arrayDimensionsSize > 0) {
+        retval = UA_Array_copy(vt->arrayDimensions, vt->arrayDimensionsSize,
+                               (void**)&node->arrayDimensions, &UA_TYPES[UA_TYPES_UINT32]);
+        if(retval == UA_STATUSCODE_GOOD)
+            node->arrayDimensionsSize = vt->arrayDimensionsSize;
+    }
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    if(!bt->dataTypeChecked || !UA_NodeId_equal(&bt->dataType, &node->dataType)) {
+        UA_NodeId_deleteMembers(&bt->dataType);
+        bt->dataTypeChecked = false;
+        retval = UA_NodeId_copy(&node->dataType, &bt->dataType);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+        bt->dataTypeChecked = true;
+        bt->dataTypeOk = compatibleDataType(bc->server, &node->dataType,
+                                            &vt->dataType, false);
+    }
+    if(!bt->dataTypeOk ||
+       !compatibleValueRankArrayDimensions(bc->server, bc->session, node->valueRank,
+                                           node->arrayDimensionsSize) ||
+       !compatibleValueRanks(node->valueRank, vt->valueRank) ||
+       !compatibleArrayDimensions(vt->arrayDimensionsSize, vt->arrayDimensions,
+                                  node->arrayDimensionsSize, node->arrayDimensions))
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+
+    if(value->value.type &&
+       !compatibleValue(bc->server, bc->session, &node->dataType, node->valueRank,
+                        node->arrayDimensionsSize, node->arrayDimensions,
+                        &value->value, NULL))
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* The same checks as in AddNode_addRefs and AddNode_finish. Staged parents and
+ * types are assumed to be valid. This is verified afterwards. */
+static UA_StatusCode
+checkBulkNode(UA_BulkLoadCommit *bc, UA_BulkLoadNode *bn) {
+    UA_Node *node = bn->node;
+    UA_BulkLoadType *type = NULL;
+    UA_StatusCode retval;
+
+    if(bn->phase < 2) {
+        /* Type nodes have a HasSubtype reference to the supertype of the same
+         * node class. The supertype is the type definition. */
+        if(UA_NodeId_isNull(&bn->referenceTypeId))
+            bn->referenceTypeId = subtypeId;
+        UA_NodeId_deleteMembers(&bn->typeDefinitionId);
+        type = getBulkType(bc, &bn->parentNodeId);
+        if(!type)
+            return UA_STATUSCODE_BADPARENTNODEIDINVALID;
+        if(!UA_NodeId_equal(&bn->referenceTypeId, &subtypeId))
+            return UA_STATUSCODE_BADREFERENCENOTALLOWED;
+        if(type->node->nodeClass != node->nodeClass)
+            return UA_STATUSCODE_BADPARENTNODEIDINVALID;
+    } else {
+        /* Objects and Variables do not need a parent */
+        if(!(node->nodeClass == UA_NODECLASS_OBJECT ||
+             node->nodeClass == UA_NODECLASS_VARIABLE) ||
+           !UA_NodeId_isNull(&bn->parentNodeId) ||
+           !UA_NodeId_isNull(&bn->referenceTypeId)) {
+            if(!bulkNodeExists(bc, &bn->parentNodeId))
+                return UA_STATUSCODE_BADPARENTNODEIDINVALID;
+            retval = checkBulkParentReferenceType(bc, &bn->referenceTypeId);
+            if(retval != UA_STATUSCODE_GOOD)
+                return retval;
+        }
+
+        /* Replace empty typeDefinition with the most permissive default */
+        if(UA_NodeId_isNull(&bn->typeDefinitionId)) {
+            if(node->nodeClass == UA_NODECLASS_VARIABLE)
+                bn->typeDefinitionId = baseDataVariableType;
+            else if(node->nodeClass == UA_NODECLASS_OBJECT)
+                bn->typeDefinitionId = baseObjectType;
+        }
+
+        if(!UA_NodeId_isNull(&bn->typeDefinitionId)) {
+            type = getBulkType(bc, &bn->typeDefinitionId);
+            if(!type || !typeMatchesNodeClass(node->nodeClass, type->node->nodeClass))
+                return UA_STATUSCODE_BADTYPEDEFINITIONINVALID;
+            UA_Boolean isAbstract = false;
+            if(node->nodeClass == UA_NODECLASS_OBJECT)
+                isAbstract = ((const UA_ObjectTypeNode*)type->node)->isAbstract;
+            else if(node->nodeClass == UA_NODECLASS_VARIABLE)
+                isAbstract = ((const UA_VariableTypeNode*)type->node)->isAbstract;
+            if(isAbstract && !bulkBelowTypeDefinition(bc, bn))
+                return UA_STATUSCODE_BADTYPEDEFINITIONINVALID;
+        }
+    }
+
+    if(node->nodeClass == UA_NODECLASS_VARIABLE ||
+       node->nodeClass == UA_NODECLASS_VARIABLETYPE) {
+        retval = typeCheckBulkVariable(bc, (UA_VariableNode*)node, type);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+
+    /* Without constructors, the node context is already set */
+    const UA_NodeTypeLifecycle *lifecycle = NULL;
+    if(node->nodeClass == UA_NODECLASS_OBJECT)
+        lifecycle = &((const UA_ObjectTypeNode*)type->node)->lifecycle;
+    else if(node->nodeClass == UA_NODECLASS_VARIABLE)
+        lifecycle = &((const UA_VariableTypeNode*)type->node)->lifecycle;
+    bn->construct = (bc->server->config.nodeLifecycle.constructor != NULL ||
+                     (lifecycle && lifecycle->constructor));
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_Boolean
+bulkStagedFailed(const UA_BulkLoadCommit *bc, const UA_NodeId *id) {
+    size_t staged = findStaged(bc, id);
+    return (staged != 0 && bc->bl->nodes[staged - 1].status != UA_STATUSCODE_GOOD);
+}
+
+static void
+checkBulkPhase(UA_BulkLoadCommit *bc) {
+    UA_BulkLoad *bl = bc->bl;
+    for(size_t i = 0; i < bl->nodesSize; ++i) {
+        UA_BulkLoadNode *bn = &bl->nodes[i];
+        if(bn->phase == bc->phase && bn->status == UA_STATUSCODE_GOOD)
+            bn->status = checkBulkNode(bc, bn);
+    }
+
+    /* Nodes below a staged node that failed (or with a failed type) fail as
+     * well. Usually the parents are staged before the children and the first
+     * pass finds all of them. */
+    UA_Boolean changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t i = 0; i < bl->nodesSize; ++i) {
+            UA_BulkLoadNode *bn = &bl->nodes[i];
+            if(bn->phase != bc->phase || bn->status != UA_STATUSCODE_GOOD)
+                continue;
+            if(bulkStagedFailed(bc, &bn->parentNodeId))
+                bn->status = UA_STATUSCODE_BADPARENTNODEIDINVALID;
+            else if(bulkStagedFailed(bc, &bn->typeDefinitionId))
+                bn->status = UA_STATUSCODE_BADTYPEDEFINITIONINVALID;
+            else
+                continue;
+            changed = true;
+        }
+    }
+
+    /* Check the additional references */
+    for(size_t i = 0; i < bl->refsSize; ++i) {
+        UA_BulkLoadReference *br = &bl->refs[i];
+        if(br->phase != bc->phase)
+            continue;
+        UA_BulkLoadType *rt = getBulkType(bc, &br->referenceTypeId);
+        if(!rt || rt->node->nodeClass != UA_NODECLASS_REFERENCETYPE)
+            br->status = UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
+        else if(!bulkNodeExists(bc, &br->sourceId))
+            br->status = UA_STATUSCODE_BADSOURCENODEIDINVALID;
+        else if(!bulkNodeExists(bc, &br->targetId))
+            br->status = UA_STATUSCODE_BADTARGETNODEIDINVALID;
+    }
+}
+
+/* Add one direction of a reference. Nodes of the current phase are edited
+ * directly. The references to all other nodes are collected. */
+static UA_StatusCode
+addBulkReference(UA_BulkLoadCommit *bc, const UA_NodeId *sourceId,
+                 const UA_NodeId *referenceTypeId, const UA_NodeId *targetId,
+                 UA_Boolean isForward, size_t reference) {
+    UA_AddReferencesItem item;
+    UA_AddReferencesItem_init(&item);
+    item.sourceNodeId = *sourceId;
+    item.referenceTypeId = *referenceTypeId;
+    item.isForward = isForward;
+    item.targetNodeId.nodeId = *targetId;
+
+    size_t staged = findStaged(bc, sourceId);
+    if(staged != 0 && bc->bl->nodes[staged - 1].phase == bc->phase) {
+        UA_StatusCode retval = UA_Node_addReference(bc->bl->nodes[staged - 1].node, &item);
+        if(retval == UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED)
+            retval = UA_STATUSCODE_GOOD;
+        return retval;
+    }
+
+    if(bc->externalsSize >= bc->externalsCapacity) {
+        size_t capacity = bc->externalsCapacity * 2;
+        if(capacity == 0)
+            capacity = 64;
+        UA_BulkLoadExternal *externals = (UA_BulkLoadExternal*)
+            UA_realloc(bc->externals, capacity * sizeof(UA_BulkLoadExternal));
+        if(!externals)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        bc->externals = externals;
+        bc->externalsCapacity = capacity;
+    }
+    UA_BulkLoadExternal *ext = &bc->externals[bc->externalsSize++];
+    ext->hash = UA_NodeId_hash(sourceId);
+    ext->item = item;
+    ext->reference = reference;
+    ext->dependsOn = findStaged(bc, targetId);
+    if(ext->dependsOn != 0 && bc->bl->nodes[ext->dependsOn - 1].phase != bc->phase)
+        ext->dependsOn = 0;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+addBulkReferences(UA_BulkLoadCommit *bc, const UA_NodeId *sourceId,
+                  const UA_NodeId *referenceTypeId, const UA_NodeId *targetId,
+                  UA_Boolean isForward, size_t reference) {
+    UA_StatusCode retval = addBulkReference(bc, sourceId, referenceTypeId,
+                                            targetId, isForward, reference);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    return addBulkReference(bc, targetId, referenceTypeId, sourceId,
+                            !isForward, reference);
+}
+
+static void
+wireBulkPhase(UA_BulkLoadCommit *bc) {
+    UA_BulkLoad *bl = bc->bl;
+    for(size_t i = 0; i < bl->nodesSize; ++i) {
+        UA_BulkLoadNode *bn = &bl->nodes[i];
+        if(bn->phase != bc->phase || bn->status != UA_STATUSCODE_GOOD)
+            continue;
+        if(!UA_NodeId_isNull(&bn->parentNodeId))
+            bn->status = addBulkReferences(bc, &bn->nodeId, &bn->referenceTypeId,
+                                           &bn->parentNodeId, false, 0);
+        if(bn->status == UA_STATUSCODE_GOOD &&
+           (bn->node->nodeClass == UA_NODECLASS_OBJECT ||
+            bn->node->nodeClass == UA_NODECLASS_VARIABLE))
+            bn->status = addBulkReferences(bc, &bn->nodeId, &hasTypeDefinition,
+                                           &bn->typeDefinitionId, true, 0);
+    }
+    for(size_t i = 0; i < bl->refsSize; ++i) {
+        UA_BulkLoadReference *br = &bl->refs[i];
+        if(br->phase == bc->phase && br->status == UA_STATUSCODE_GOOD)
+            br->status = addBulkReferences(bc, &br->sourceId, &br->referenceTypeId,
+                                           &br->targetId, br->isForward, i + 1);
+    }
+}
+
+/* Sort the references so that the references of a node are adjacent */
+static int
+compareBulkExternals(const void *a, const void *b) {
+    const UA_BulkLoadExternal *ea = (const UA_BulkLoadExternal*)a;
+    const UA_BulkLoadExternal *eb = (const UA_BulkLoadExternal*)b;
+    if(ea->hash != eb->hash)
+        return (ea->hash < eb->hash) ? -1 : 1;
+    const UA_NodeId *na = &ea->item.sourceNodeId;
+    const UA_NodeId *nb = &eb->item.sourceNodeId;
+    if(na->namespaceIndex != nb->namespaceIndex)
+        return (na->namespaceIndex < nb->namespaceIndex) ? -1 : 1;
+    if(na->identifierType != nb->identifierType)
+        return (na->identifierType < nb->identifierType) ? -1 : 1;
+    switch(na->identifierType) {
+    case UA_NODEIDTYPE_NUMERIC:
+        if(na->identifier.numeric == nb->identifier.numeric)
+            return 0;
+        return (na->identifier.numeric < nb->identifier.numeric) ? -1 : 1;
+    case UA_NODEIDTYPE_GUID:
+        return memcmp(&na->identifier.guid, &nb->identifier.guid, sizeof(UA_Guid));
+    default:
+        if(na->identifier.string.length != nb->identifier.string.length)
+            return (na->identifier.string.length < nb->identifier.string.length) ? -1 : 1;
+        if(na->identifier.string.length == 0)
+            return 0;
+        return memcmp(na->identifier.string.data, nb->identifier.string.data,
+                      na->identifier.string.length);
+    }
+}
+
+/* Edit every node outside the phase once for all its new references */
+static void
+applyBulkExternals(UA_BulkLoadCommit *bc) {
+    UA_BulkLoad *bl = bc->bl;
+    qsort(bc->externals, bc->externalsSize, sizeof(UA_BulkLoadExternal),
+          compareBulkExternals);
+    size_t end;
+    for(size_t i = 0; i < bc->externalsSize; i = end) {
+        const UA_NodeId *nodeId = &bc->externals[i].item.sourceNodeId;
+        for(end = i + 1; end < bc->externalsSize; ++end) {
+            if(!UA_NodeId_equal(&bc->externals[end].item.sourceNodeId, nodeId))
+                break;
+        }
+
+        UA_Node *node = NULL;
+        UA_StatusCode res = UA_Nodestore_getCopy(bc->server, nodeId, &node);
+        UA_Boolean changed = false;
+        for(size_t j = i; j < end; ++j) {
+            UA_BulkLoadExternal *ext = &bc->externals[j];
+            if(ext->dependsOn != 0 &&
+               bl->nodes[ext->dependsOn - 1].status != UA_STATUSCODE_GOOD)
+                continue;
+            if(ext->reference != 0 &&
+               bl->refs[ext->reference - 1].status != UA_STATUSCODE_GOOD)
+                continue;
+            UA_StatusCode retval = res;
+            if(retval == UA_STATUSCODE_GOOD)
+                retval = UA_Node_addReference(node, &ext->item);
+            if(retval == UA_STATUSCODE_GOOD)
+                changed = true;
+            else if(retval == UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED)
+                retval = UA_STATUSCODE_GOOD;
+            if(retval == UA_STATUSCODE_GOOD)
+                continue;
+            if(ext->reference != 0)
+                bl->refs[ext->reference - 1].status = retval;
+            UA_LOG_NODEID_WRAP(nodeId, UA_LOG_INFO_SESSION(&bc->server->config.logger, bc->session,
+                               "BulkLoad: Adding a reference to %.*s failed "
+                               "with status code %s",
+                               (int)nodeIdStr.length, nodeIdStr.data,
+                               UA_StatusCode_name(retval)));
+        }
+        if(!node)
+            continue;
+        if(!changed) {
+            UA_Nodestore_delete(bc->server, node);
+            continue;
+        }
+        res = bc->server->config.nodestore.replaceNode(bc->server->config.nodestore.context,
+                                                       node);
+        if(res != UA_STATUSCODE_GOOD)
+            UA_LOG_NODEID_WRAP(nodeId, UA_LOG_INFO_SESSION(&bc->server->config.logger, bc->session,
+                               "BulkLoad: Replacing %.*s failed with status code %s",
+                               (int)nodeIdStr.length, nodeIdStr.data,
+                               UA_StatusCode_name(res)));
+    }
+    bc->externalsSize = 0;
+}
+
+static void
+commitBulkPhase(UA_BulkLoadCommit *bc) {
+    checkBulkPhase(bc);
+    wireBulkPhase(bc);
+
+    /* The cached nodes are released before the nodestore is changed */
+    clearBulkTypes(bc);
+
+    UA_BulkLoad *bl = bc->bl;
+    for(size_t i = 0; i < bl->nodesSize; ++i) {
+        UA_BulkLoadNode *bn = &bl->nodes[i];
+        if(bn->phase != bc->phase || bn->status != UA_STATUSCODE_GOOD)
+            continue;
+        bn->status = UA_Nodestore_insert(bc->server, bn->node, NULL);
+        bn->node = NULL; /* Deleted by the nodestore if the insert failed */
+    }
+
+    applyBulkExternals(bc);
+}
+
+static void
+constructBulkNodes(UA_BulkLoadCommit *bc) {
+    UA_BulkLoad *bl = bc->bl;
+    for(size_t i = 0; i < bl->nodesSize; ++i) {
+        UA_BulkLoadNode *bn = &bl->nodes[i];
+        if(!bn->construct || bn->status != UA_STATUSCODE_GOOD)
+            continue;
+        const UA_Node *node = UA_Nodestore_get(bc->server, &bn->nodeId);
+        if(!node) {
+            bn->status = UA_STATUSCODE_BADNODEIDUNKNOWN;
+            continue;
+        }
+        const UA_Node *type = NULL;
+        if(node->nodeClass == UA_NODECLASS_OBJECT ||
+           node->nodeClass == UA_NODECLASS_VARIABLE) {
+            type = getNodeType(bc->server, node);
+            if(!type)
+                bn->status = UA_STATUSCODE_BADTYPEDEFINITIONINVALID;
+        }
+        if(bn->status == UA_STATUSCODE_GOOD)
+            bn->status = callConstructors(bc->server, bc->session, node, type);
+        if(bn->status != UA_STATUSCODE_GOOD) {
+            UA_LOG_NODEID_WRAP(&bn->nodeId, UA_LOG_INFO_SESSION(&bc->server->config.logger, bc->session,
+                                "BulkLoad: Calling the node constructor(s) of %.*s failed "
+                                "with status code %s",
+                                (int)nodeIdStr.length, nodeIdStr.data,
+                                UA_StatusCode_name(bn->status)));
+            removeDeconstructedNode(bc->server, bc->session, node, true);
+        }
+        if(type)
+            UA_Nodestore_release(bc->server, type);
+        UA_Nodestore_release(bc->server, node);
+    }
+}
+
+UA_StatusCode
+UA_BulkLoad_commit(UA_BulkLoad *bl, size_t *resultsSize, UA_StatusCode **results) {
+    UA_BulkLoadCommit bc;
+    memset(&bc, 0, sizeof(UA_BulkLoadCommit));
+    bc.server = bl->server;
+    bc.session = &bl->server->adminSession;
+    bc.bl = bl;
+
+    UA_StatusCode retval = indexStaged(&bc);
+    if(retval != UA_STATUSCODE_GOOD)
+        goto cleanup;
+
+    /* References are added in the phase where both ends exist */
+    for(size_t i = 0; i < bl->refsSize; ++i) {
+        UA_BulkLoadReference *br = &bl->refs[i];
+        size_t source = findStaged(&bc, &br->sourceId);
+        size_t target = findStaged(&bc, &br->targetId);
+        if(source != 0)
+            br->phase = bl->nodes[source - 1].phase;
+        if(target != 0 && bl->nodes[target - 1].phase > br->phase)
+            br->phase = bl->nodes[target - 1].phase;
+    }
+
+    for(bc.phase = 0; bc.phase < UA_BULKLOAD_PHASES; ++bc.phase)
+        commitBulkPhase(&bc);
+    constructBulkNodes(&bc);
+
+    /* Report the first error */
+    for(size_t i = 0; i < bl->nodesSize && retval == UA_STATUSCODE_GOOD; ++i)
+        retval = bl->nodes[i].status;
+    for(size_t i = 0; i < bl->refsSize && retval == UA_STATUSCODE_GOOD; ++i)
+        retval = bl->refs[i].status;
+
+    if(results) {
+        *resultsSize = 0;
+        *results = (UA_StatusCode*)UA_Array_new(bl->nodesSize + bl->refsSize,
+                                                &UA_TYPES[UA_TYPES_STATUSCODE]);
+        if(!*results) {
+            retval = UA_STATUSCODE_BADOUTOFMEMORY;
+            goto cleanup;
+        }
+        *resultsSize = bl->nodesSize + bl->refsSize;
+        for(size_t i = 0; i < bl->nodesSize; ++i)
+            (*results)[i] = bl->nodes[i].status;
+        for(size_t i = 0; i < bl->refsSize; ++i)
+            (*results)[bl->nodesSize + i] = bl->refs[i].status;
+    }
+
+ cleanup:
+    clearBulkTypes(&bc);
+    UA_free(bc.types);
+    UA_free(bc.typesIndex);
+    UA_free(bc.index);
+    UA_free(bc.externals);
+    UA_Array_delete(bc.parentTypeHierarchy, bc.parentTypeHierarchySize,
+                    &UA_TYPES[UA_TYPES_NODEID]);
+    UA_BulkLoad_delete(bl);
+    return retval;
+}
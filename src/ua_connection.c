@@ -242,7 +242,8 @@ UA_Connection_receiveChunksBlocking(UA_Connection *connection, void *application
 
 UA_StatusCode
 UA_Connection_receiveChunksNonBlocking(UA_Connection *connection, void *application,
-                                    UA_Connection_processChunk processCallback) {
+                                    UA_Connection_processChunk processCallback,
+                                    UA_UInt32 timeout) {
     struct completeChunkTrampolineData data;
     data.called = false;
     data.application = application;
@@ -250,7 +251,7 @@ UA_Connection_receiveChunksNonBlocking(UA_Connection *connection, void *applicat
 
     /* Listen for messages to arrive */
     UA_ByteString packet = UA_BYTESTRING_NULL;
-    UA_StatusCode retval = connection->recv(connection, &packet, 1);
+    UA_StatusCode retval = connection->recv(connection, &packet, timeout);
 
     if((retval != UA_STATUSCODE_GOOD) && (retval != UA_STATUSCODE_GOODNONCRITICALTIMEOUT))
         return retval;
@@ -64,9 +64,13 @@ UA_Connection_receiveChunksBlocking(UA_Connection *connection, void *application
                                     UA_Connection_processChunk processCallback,
                                     UA_UInt32 timeout);
 
+/* Receive at most one packet without waiting for it to arrive. The connection
+ * is polled with a short timeout (in milliseconds). Use a timeout of zero if
+ * the connection is known to be readable, e.g. after an external poll. */
 UA_StatusCode
 UA_Connection_receiveChunksNonBlocking(UA_Connection *connection, void *application,
-                                    UA_Connection_processChunk processCallback);
+                                    UA_Connection_processChunk processCallback,
+                                    UA_UInt32 timeout);
 
 /* When a fatal error occurs the Server shall send an Error Message to the
  * Client and close the socket. When a Client encounters one of these errors, it
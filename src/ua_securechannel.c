@@ -883,6 +883,33 @@ UA_MessageContext_encode(UA_MessageContext *mc, const void *content,
     return retval;
 }
 
+UA_StatusCode
+UA_MessageContext_encodeRaw(UA_MessageContext *mc, const UA_ByteString *encoded) {
+    size_t offset = 0;
+    while(offset < encoded->length) {
+        /* The chunk is full. Send it and continue in a new buffer. */
+        if(mc->buf_pos >= mc->buf_end) {
+            UA_StatusCode retval =
+                sendSymmetricEncodingCallback(mc, &mc->buf_pos, &mc->buf_end);
+            if(retval != UA_STATUSCODE_GOOD) {
+                if(mc->messageBuffer.length > 0) {
+                    UA_Connection *connection = mc->channel->connection;
+                    connection->releaseSendBuffer(connection, &mc->messageBuffer);
+                }
+                return retval;
+            }
+        }
+
+        size_t len = (size_t)(mc->buf_end - mc->buf_pos);
+        if(len > encoded->length - offset)
+            len = encoded->length - offset;
+        memcpy(mc->buf_pos, &encoded->data[offset], len);
+        mc->buf_pos += len;
+        offset += len;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
 UA_StatusCode
 UA_MessageContext_finish(UA_MessageContext *mc) {
     mc->final = true;
@@ -17,12 +17,14 @@
 
 #ifdef UA_ENABLE_CUSTOM_LIBC
 #include "../deps/musl/floatscan.h"
-#include "../deps/musl/vfprintf.h"
 #endif
 
 #include "../deps/itoa.h"
 #include "../deps/atoi.h"
+#include "../deps/dtoa.h"
+#include "../deps/atof.h"
 #include "../deps/string_escape.h"
+#include "../deps/string_scan.h"
 #include "../deps/base64.h"
 
 #include "../deps/libc_time.h"
@@ -87,10 +89,39 @@ extern const decodeJsonSignature decodeJsonJumpTable[UA_BUILTIN_TYPES_COUNT + 1]
 UA_String UA_DateTime_toJSON(UA_DateTime t);
 ENCODE_JSON(ByteString);
 
+/* Minimum size when a growable output buffer is (re)allocated */
+#define UA_JSON_MIN_BUFFERSIZE 256
+
+status UA_FUNC_ATTR_WARN_UNUSED_RESULT
+reserveJson(CtxJson *ctx, size_t len) {
+    if(ctx->pos + len <= ctx->end)
+        return UA_STATUSCODE_GOOD;
+    if(!ctx->growBuffer || ctx->calcOnly)
+        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+
+    /* Grow geometrically so that the copying is amortized */
+    UA_ByteString *buf = ctx->growBuffer;
+    size_t used = (size_t)(ctx->pos - buf->data);
+    size_t newLength = buf->length * 2;
+    if(newLength < UA_JSON_MIN_BUFFERSIZE)
+        newLength = UA_JSON_MIN_BUFFERSIZE;
+    while(newLength < used + len)
+        newLength *= 2;
+    UA_Byte *data = (UA_Byte*)UA_realloc(buf->data, newLength);
+    if(!data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    buf->data = data;
+    buf->length = newLength;
+    ctx->pos = &data[used];
+    ctx->end = &data[newLength];
+    return UA_STATUSCODE_GOOD;
+}
+
 static status UA_FUNC_ATTR_WARN_UNUSED_RESULT
 writeChar(CtxJson *ctx, char c) {
-    if(ctx->pos >= ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status ret = reserveJson(ctx, 1);
+    if(ret != UA_STATUSCODE_GOOD)
+        return ret;
     if(!ctx->calcOnly)
         *ctx->pos = (UA_Byte)c;
     ctx->pos++;
@@ -156,8 +187,9 @@ status writeJsonObjElm(CtxJson *ctx, UA_String *key,
 }
 
 status writeJsonNull(CtxJson *ctx) {
-    if(ctx->pos + 4 > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, 4);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
     if(ctx->calcOnly) {
         ctx->pos += 4;
     } else {
@@ -231,8 +263,9 @@ static const char* UA_JSONKEY_INNERDIAGNOSTICINFO = "InnerDiagnosticInfo";
 status UA_FUNC_ATTR_WARN_UNUSED_RESULT
 writeJsonKey(CtxJson *ctx, const char* key) {
     size_t size = strlen(key);
-    if(ctx->pos + size + 4 > ctx->end) /* +4 because of " " : and , */
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, size + 4); /* +4 because of " " : and , */
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
     status ret = writeJsonCommaIfNeeded(ctx);
     ctx->commaNeeded[ctx->depth] = true;
     if(ctx->calcOnly) {
@@ -265,8 +298,9 @@ ENCODE_JSON(Boolean) {
         return UA_STATUSCODE_GOOD;
     }
 
-    if(ctx->pos + sizeOfJSONBool > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, sizeOfJSONBool);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     if(*src) {
         *(ctx->pos++) = 't';
@@ -293,8 +327,9 @@ ENCODE_JSON(Byte) {
     UA_UInt16 digits = itoaUnsigned(*src, buf, 10);
 
     /* Ensure destination can hold the data- */
-    if(ctx->pos + digits > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, digits);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     /* Copy digits to the output string/buffer. */
     if(!ctx->calcOnly)
@@ -307,8 +342,9 @@ ENCODE_JSON(Byte) {
 ENCODE_JSON(SByte) {
     char buf[5];
     UA_UInt16 digits = itoaSigned(*src, buf);
-    if(ctx->pos + digits > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, digits);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
     if(!ctx->calcOnly)
         memcpy(ctx->pos, buf, digits);
     ctx->pos += digits;
@@ -320,8 +356,9 @@ ENCODE_JSON(UInt16) {
     char buf[6];
     UA_UInt16 digits = itoaUnsigned(*src, buf, 10);
 
-    if(ctx->pos + digits > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, digits);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     if(!ctx->calcOnly)
         memcpy(ctx->pos, buf, digits);
@@ -334,8 +371,9 @@ ENCODE_JSON(Int16) {
     char buf[7];
     UA_UInt16 digits = itoaSigned(*src, buf);
 
-    if(ctx->pos + digits > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, digits);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     if(!ctx->calcOnly)
         memcpy(ctx->pos, buf, digits);
@@ -348,8 +386,9 @@ ENCODE_JSON(UInt32) {
     char buf[11];
     UA_UInt16 digits = itoaUnsigned(*src, buf, 10);
 
-    if(ctx->pos + digits > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, digits);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     if(!ctx->calcOnly)
         memcpy(ctx->pos, buf, digits);
@@ -362,8 +401,9 @@ ENCODE_JSON(Int32) {
     char buf[12];
     UA_UInt16 digits = itoaSigned(*src, buf);
 
-    if(ctx->pos + digits > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, digits);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     if(!ctx->calcOnly)
         memcpy(ctx->pos, buf, digits);
@@ -376,8 +416,9 @@ ENCODE_JSON(UInt64) {
     char buf[21];
     UA_UInt16 digits = itoaUnsigned(*src, buf, 10);
 
-    if(ctx->pos + digits > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, digits);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     if(!ctx->calcOnly)
         memcpy(ctx->pos, buf, digits);
@@ -390,8 +431,9 @@ ENCODE_JSON(Int64) {
     char buf[21];
     UA_UInt16 digits = itoaSigned(*src, buf);
 
-    if(ctx->pos + digits > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, digits);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     if(!ctx->calcOnly)
         memcpy(ctx->pos, buf, digits);
@@ -403,75 +445,33 @@ ENCODE_JSON(Int64) {
 /* Floating Point Types */
 /************************/
 
-/* Convert special numbers to string
- * - fmt_fp gives NAN, nan,-NAN, -nan, inf, INF, -inf, -INF
- * - Special floating-point numbers such as positive infinity (INF), negative
- *   infinity (-INF) and not-a-number (NaN) shall be represented by the values
- *   “Infinity”, “-Infinity” and “NaN” encoded as a JSON string. */
+/* Special floating-point numbers such as positive infinity (INF), negative
+ * infinity (-INF) and not-a-number (NaN) shall be represented by the values
+ * “Infinity”, “-Infinity” and “NaN” encoded as a JSON string. Finite numbers
+ * are printed with the shortest representation that parses back to the same
+ * value. */
 static status
-checkAndEncodeSpecialFloatingPoint(char *buffer, size_t *len) {
-    /*nan and NaN*/
-    if(*len == 3 && 
-            (buffer[0] == 'n' || buffer[0] == 'N') && 
-            (buffer[1] == 'a' || buffer[1] == 'A') && 
-            (buffer[2] == 'n' || buffer[2] == 'N')) {
-        *len = 5;
-        memcpy(buffer, "\"NaN\"", *len);
-        return UA_STATUSCODE_GOOD;
-    }
-
-    /*-nan and -NaN*/
-    if(*len == 4 && buffer[0] == '-' && 
-            (buffer[1] == 'n' || buffer[1] == 'N') && 
-            (buffer[2] == 'a' || buffer[2] == 'A') && 
-            (buffer[3] == 'n' || buffer[3] == 'N')) {
-        *len = 6;
-        memcpy(buffer, "\"-NaN\"", *len);
-        return UA_STATUSCODE_GOOD;
-    }
-
-    /*inf*/
-    if(*len == 3 && 
-            (buffer[0] == 'i' || buffer[0] == 'I') && 
-            (buffer[1] == 'n' || buffer[1] == 'N') && 
-            (buffer[2] == 'f' || buffer[2] == 'F')) {
-        *len = 10;
-        memcpy(buffer, "\"Infinity\"", *len);
-        return UA_STATUSCODE_GOOD;
-    }
-
-    /*-inf*/
-    if(*len == 4 && buffer[0] == '-' && 
-            (buffer[1] == 'i' || buffer[1] == 'I') && 
-            (buffer[2] == 'n' || buffer[2] == 'N') && 
-            (buffer[3] == 'f' || buffer[3] == 'F')) {
-        *len = 11;
-        memcpy(buffer, "\"-Infinity\"", *len);
-        return UA_STATUSCODE_GOOD;
-    }
-    return UA_STATUSCODE_GOOD;
-}
-
-ENCODE_JSON(Float) {
-    char buffer[200];
-    if(*src == *src) {
-#ifdef UA_ENABLE_CUSTOM_LIBC
-        fmt_fp(buffer, *src, 0, -1, 0, 'g');
-#else
-        UA_snprintf(buffer, 200, "%.149g", (UA_Double)*src);
-#endif
+encodeJsonFloatingPoint(CtxJson *ctx, UA_Double d, UA_Boolean isFloat) {
+    char buffer[UA_DTOA_MAXLENGTH];
+    size_t len;
+    if(d != d) {
+        len = 5;
+        memcpy(buffer, "\"NaN\"", len);
+    } else if(d > DBL_MAX) {
+        len = 10;
+        memcpy(buffer, "\"Infinity\"", len);
+    } else if(d < -DBL_MAX) {
+        len = 11;
+        memcpy(buffer, "\"-Infinity\"", len);
+    } else if(isFloat) {
+        len = ftoa((UA_Float)d, buffer);
     } else {
-        strcpy(buffer, "NaN");
+        len = dtoa(d, buffer);
     }
 
-    size_t len = strlen(buffer);
-    if(len == 0)
-        return UA_STATUSCODE_BADENCODINGERROR;
-    
-    checkAndEncodeSpecialFloatingPoint(buffer, &len);
-    
-    if(ctx->pos + len > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, len);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
 
     if(!ctx->calcOnly)
         memcpy(ctx->pos, buffer, len);
@@ -480,29 +480,12 @@ ENCODE_JSON(Float) {
     return UA_STATUSCODE_GOOD;
 }
 
-ENCODE_JSON(Double) {
-    char buffer[2000];
-    if(*src == *src) {
-#ifdef UA_ENABLE_CUSTOM_LIBC
-        fmt_fp(buffer, *src, 0, 17, 0, 'g');
-#else
-        UA_snprintf(buffer, 2000, "%.1074g", *src);
-#endif
-    } else {
-        strcpy(buffer, "NaN");
-    }
-
-    size_t len = strlen(buffer);
-    checkAndEncodeSpecialFloatingPoint(buffer, &len);    
-
-    if(ctx->pos + len > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
-
-    if(!ctx->calcOnly)
-        memcpy(ctx->pos, buffer, len);
+ENCODE_JSON(Float) {
+    return encodeJsonFloatingPoint(ctx, (UA_Double)*src, true);
+}
 
-    ctx->pos += len;
-    return UA_STATUSCODE_GOOD;
+ENCODE_JSON(Double) {
+    return encodeJsonFloatingPoint(ctx, *src, false);
 }
 
 static status
@@ -538,54 +521,37 @@ ENCODE_JSON(String) {
     if(src->length == 0)
         return writeJsonQuote(ctx) | writeJsonQuote(ctx);
 
-    UA_StatusCode ret = writeJsonQuote(ctx);
-    
-    /* Escaping adapted from https://github.com/akheron/jansson dump.c */
-
-    const char *str = (char*)src->data;
-    const char *pos = str;
-    const char *end = str;
-    const char *lim = str + src->length;
-    UA_Int32 codepoint = 0;
-    while(1) {
-        const char *text;
-        u8 seq[13];
-        size_t length;
-
-        while(end < lim) {
-            end = utf8_iterate(pos, (size_t)(lim - pos), &codepoint);
-            if(!end)
-                return UA_STATUSCODE_BADENCODINGERROR;
-
-            /* mandatory escape or control char */
-            if(codepoint == '\\' || codepoint == '"' || codepoint < 0x20)
-                break;
-
-            /* slash 
-            if((flags & JSON_ESCAPE_SLASH) && codepoint == '/')
-                break;*/
-
-            /* non-ASCII
-            if((flags & JSON_ENSURE_ASCII) && codepoint > 0x7F)
-                break;*/
+    const char *str = (const char*)src->data;
+    size_t length = src->length;
+    if(!utf8_validate(str, length))
+        return UA_STATUSCODE_BADENCODINGERROR;
 
-            pos = end;
-        }
+    UA_StatusCode ret = writeJsonQuote(ctx);
 
-        if(pos != str) {
-            if(ctx->pos + (pos - str) > ctx->end)
-                return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    /* Copy the runs between characters that need escaping in bulk. The bytes
+     * of multi-byte UTF-8 sequences are never escaped. */
+    size_t pos = 0;
+    while(pos < length) {
+        size_t run = json_scanEscape(&str[pos], length - pos);
+        if(run > 0) {
+            status res = reserveJson(ctx, run);
+            if(res != UA_STATUSCODE_GOOD)
+                return res;
             if(!ctx->calcOnly)
-                memcpy(ctx->pos, str, (size_t)(pos - str));
-            ctx->pos += pos - str;
+                memcpy(ctx->pos, &str[pos], run);
+            ctx->pos += run;
+            pos += run;
         }
 
-        if(end == pos)
+        if(pos == length)
             break;
 
-        /* handle \, /, ", and control codes */
-        length = 2;
-        switch(codepoint) {
+        /* handle \, ", and control codes */
+        const char *text;
+        u8 seq[6];
+        size_t escapeLength = 2;
+        u8 c = (u8)str[pos];
+        switch(c) {
         case '\\': text = "\\\\"; break;
         case '\"': text = "\\\""; break;
         case '\b': text = "\\b"; break;
@@ -593,56 +559,25 @@ ENCODE_JSON(String) {
         case '\n': text = "\\n"; break;
         case '\r': text = "\\r"; break;
         case '\t': text = "\\t"; break;
-        case '/':  text = "\\/"; break;
         default:
-            if(codepoint < 0x10000) {
-                /* codepoint is in BMP */
-                seq[0] = '\\';
-                seq[1] = 'u';
-                UA_Byte b1 = (UA_Byte)(codepoint >> 8);
-                UA_Byte b2 = (UA_Byte)(codepoint >> 0);
-                seq[2] = hexmapLower[(b1 & 0xF0) >> 4];
-                seq[3] = hexmapLower[b1 & 0x0F];
-                seq[4] = hexmapLower[(b2 & 0xF0) >> 4];
-                seq[5] = hexmapLower[b2 & 0x0F];
-                length = 6;
-            } else {
-                /* not in BMP -> construct a UTF-16 surrogate pair */
-                codepoint -= 0x10000;
-                UA_Int32 first = 0xD800 | ((codepoint & 0xffc00) >> 10);
-                UA_Int32 last = 0xDC00 | (codepoint & 0x003ff);
-
-                UA_Byte fb1 = (UA_Byte)(first >> 8);
-                UA_Byte fb2 = (UA_Byte)(first >> 0);
-                    
-                UA_Byte lb1 = (UA_Byte)(last >> 8);
-                UA_Byte lb2 = (UA_Byte)(last >> 0);
-                    
-                seq[0] = '\\';
-                seq[1] = 'u';
-                seq[2] = hexmapLower[(fb1 & 0xF0) >> 4];
-                seq[3] = hexmapLower[fb1 & 0x0F];
-                seq[4] = hexmapLower[(fb2 & 0xF0) >> 4];
-                seq[5] = hexmapLower[fb2 & 0x0F];
-                    
-                seq[6] = '\\';
-                seq[7] = 'u';
-                seq[8] = hexmapLower[(lb1 & 0xF0) >> 4];
-                seq[9] = hexmapLower[lb1 & 0x0F];
-                seq[10] = hexmapLower[(lb2 & 0xF0) >> 4];
-                seq[11] = hexmapLower[lb2 & 0x0F];
-                length = 12;
-            }
+            seq[0] = '\\';
+            seq[1] = 'u';
+            seq[2] = '0';
+            seq[3] = '0';
+            seq[4] = hexmapLower[(c & 0xF0) >> 4];
+            seq[5] = hexmapLower[c & 0x0F];
+            escapeLength = 6;
             text = (char*)seq;
             break;
         }
 
-        if(ctx->pos + length > ctx->end)
-            return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+        status res = reserveJson(ctx, escapeLength);
+        if(res != UA_STATUSCODE_GOOD)
+            return res;
         if(!ctx->calcOnly)
-            memcpy(ctx->pos, text, length);
-        ctx->pos += length;
-        str = pos = end;
+            memcpy(ctx->pos, text, escapeLength);
+        ctx->pos += escapeLength;
+        pos++;
     }
 
     ret |= writeJsonQuote(ctx);
@@ -656,33 +591,17 @@ ENCODE_JSON(ByteString) {
     if(src->length == 0)
         return writeJsonQuote(ctx) | writeJsonQuote(ctx);
 
+    /* Encode directly into the output buffer */
     status ret = writeJsonQuote(ctx);
-    int flen;
-    char *b64 = UA_base64(src->data, (int)src->length, &flen);
-    
-    /* Not converted, no mem */
-    if(!b64)
-        return UA_STATUSCODE_BADENCODINGERROR;
-
-    /* Check if negative... (TODO: Why is base64 3rd argument type int?) */
-    if(flen < 0) {
-        free(b64);
-        return UA_STATUSCODE_BADENCODINGERROR;
-    }
+    size_t flen = UA_base64_encodedLength(src->length);
+    ret |= reserveJson(ctx, flen);
+    if(ret != UA_STATUSCODE_GOOD)
+        return ret;
 
-    if(ctx->pos + flen > ctx->end) {
-        free(b64);
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
-    }
-    
-    /* Copy flen bytes to output stream. */
     if(!ctx->calcOnly)
-        memcpy(ctx->pos, b64, (size_t)flen);
+        UA_base64_encode(src->data, src->length, ctx->pos);
     ctx->pos += flen;
 
-    /* Base64 result no longer needed */
-    free(b64);
-    
     ret |= writeJsonQuote(ctx);
     return ret;
 }
@@ -727,8 +646,9 @@ static void UA_Guid_to_hex(const UA_Guid *guid, u8* out) {
 
 /* Guid */
 ENCODE_JSON(Guid) {
-    if(ctx->pos + 38 > ctx->end) /* 36 + 2 (") */
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, 38); /* 36 + 2 (") */
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
     status ret = writeJsonQuote(ctx);
     u8 *buf = ctx->pos;
     if(!ctx->calcOnly)
@@ -774,8 +694,9 @@ UA_DateTime_toJSON(UA_DateTime t) {
 }
 
 ENCODE_JSON(DateTime) {
-    if(ctx->pos + UA_JSON_DATETIME_LENGTH > ctx->end)
-        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    status res = reserveJson(ctx, UA_JSON_DATETIME_LENGTH);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
     
     UA_String str = UA_DateTime_toJSON(*src);
     UA_StatusCode ret = ENCODE_DIRECT_JSON(&str, String);
@@ -1486,6 +1407,33 @@ UA_encodeJson(const void *src, const UA_DataType *type,
     return ret;
 }
 
+status UA_FUNC_ATTR_WARN_UNUSED_RESULT
+UA_encodeJsonBuffer(const void *src, const UA_DataType *type,
+                    UA_ByteString *buffer, size_t *encodedLength,
+                    UA_String *namespaces, size_t namespaceSize,
+                    UA_String *serverUris, size_t serverUriSize,
+                    UA_Boolean useReversible) {
+    if(!src || !type || !buffer || !encodedLength)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    /* Set up the context */
+    CtxJson ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.pos = buffer->data;
+    ctx.end = &buffer->data[buffer->length];
+    ctx.namespaces = namespaces;
+    ctx.namespacesSize = namespaceSize;
+    ctx.serverUris = serverUris;
+    ctx.serverUrisSize = serverUriSize;
+    ctx.useReversible = useReversible;
+    ctx.growBuffer = buffer;
+
+    /* Encode */
+    status ret = encodeJsonInternal(src, type, &ctx);
+    *encodedLength = (size_t)(ctx.pos - buffer->data);
+    return ret;
+}
+
 /************/
 /* CalcSize */
 /************/
@@ -1900,12 +1848,19 @@ DECODE_JSON(Float) {
     if(tokenType != JSMN_PRIMITIVE)
         return UA_STATUSCODE_BADDECODINGERROR;
 
+    /* Fast path for plain JSON numbers with up to 19 significant digits */
+    UA_Float d = 0;
+    if(atofFloat(tokenData, tokenSize, &d)) {
+        *dst = d;
+        parseCtx->index++;
+        return UA_STATUSCODE_GOOD;
+    }
+
     /* Null-Terminate for sscanf. */
     UA_STACKARRAY(char, string, tokenSize+1);
     memcpy(string, tokenData, tokenSize);
     string[tokenSize] = 0;
     
-    UA_Float d = 0;
 #ifdef UA_ENABLE_CUSTOM_LIBC
     d = (UA_Float)__floatscan(string, 1, 0);
 #else
@@ -1967,13 +1922,20 @@ DECODE_JSON(Double) {
     if(tokenType != JSMN_PRIMITIVE)
         return UA_STATUSCODE_BADDECODINGERROR;
 
+    /* Fast path for plain JSON numbers with up to 19 significant digits */
+    UA_Double d = 0;
+    if(atofDouble(tokenData, tokenSize, &d)) {
+        *dst = d;
+        parseCtx->index++;
+        return UA_STATUSCODE_GOOD;
+    }
+
     /* Null-Terminate for sscanf. Should this better be handled on heap? Max
      * 1075 input chars allowed. Not using heap. */
     UA_STACKARRAY(char, string, tokenSize+1);
     memcpy(string, tokenData, tokenSize);
     string[tokenSize] = 0;
     
-    UA_Double d = 0;
 #ifdef UA_ENABLE_CUSTOM_LIBC
     d = (UA_Double)__floatscan(string, 2, 0);
 #else
@@ -2085,6 +2047,14 @@ DECODE_JSON(String) {
     const char *end = (char*)&tokenData[tokenSize];
     char *pos = outputBuffer;
     while(p < end) {
+        /* Copy the run up to the next backslash in bulk */
+        size_t run = json_scanStringEnd(p, (size_t)(end - p));
+        memcpy(pos, p, run);
+        pos += run;
+        p += run;
+        if(p == end)
+            break;
+
         /* No escaping */
         if(*p != '\\') {
             *(pos++) = *(p++);
@@ -2178,13 +2148,17 @@ DECODE_JSON(ByteString) {
         return UA_STATUSCODE_GOOD;
     }
 
-    int flen;
-    unsigned char* unB64 = UA_unbase64(tokenData, (int)tokenSize, &flen);
-    if(unB64 == 0)
+    /* Too short for base64 */
+    if(tokenSize < 2)
         return UA_STATUSCODE_BADDECODINGERROR;
 
-    dst->data = (u8*)unB64;
-    dst->length = (size_t)flen;
+    size_t flen = UA_base64_decodedLength((const u8*)tokenData, tokenSize);
+    if(flen == 0)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    dst->data = (u8*)UA_malloc(flen);
+    if(!dst->data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    dst->length = UA_base64_decode((const u8*)tokenData, tokenSize, dst->data);
     
     if(moveToken)
         parseCtx->index++;
@@ -2226,140 +2200,31 @@ DECODE_JSON(QualifiedName) {
 }
 
 /* Function for searching ahead of the current token. Used for retrieving the
- * OPC UA type of a token */
-static status
-searchObjectForKeyRec(const char *searchKey, CtxJson *ctx, 
-                      ParseCtx *parseCtx, size_t *resultIndex, UA_UInt16 depth) {
-    UA_StatusCode ret = UA_STATUSCODE_BADNOTFOUND;
-    
-    CHECK_TOKEN_BOUNDS;
-    
-    if(parseCtx->tokenArray[parseCtx->index].type == JSMN_OBJECT) {
-        size_t objectCount = (size_t)(parseCtx->tokenArray[parseCtx->index].size);
-        
-        parseCtx->index++; /*Object to first Key*/
-        CHECK_TOKEN_BOUNDS;
-        
-        size_t i;
-        for(i = 0; i < objectCount; i++) {
-            
-            CHECK_TOKEN_BOUNDS;
-            if(depth == 0) { /* we search only on first layer */
-                if(jsoneq((char*)ctx->pos, &parseCtx->tokenArray[parseCtx->index], searchKey) == 0) {
-                    /*found*/
-                    parseCtx->index++; /*We give back a pointer to the value of the searched key!*/
-                    *resultIndex = parseCtx->index;
-                    ret = UA_STATUSCODE_GOOD;
-                    break;
-                }
-            }
-               
-            parseCtx->index++; /* value */
-            CHECK_TOKEN_BOUNDS;
-            
-            if(parseCtx->tokenArray[parseCtx->index].type == JSMN_OBJECT) {
-               ret = searchObjectForKeyRec(searchKey, ctx, parseCtx, resultIndex,
-                                           (UA_UInt16)(depth + 1));
-            } else if(parseCtx->tokenArray[parseCtx->index].type == JSMN_ARRAY) {
-               ret = searchObjectForKeyRec(searchKey, ctx, parseCtx, resultIndex,
-                                           (UA_UInt16)(depth + 1));
-            } else {
-                /* Only Primitive or string */
-                parseCtx->index++;
-            }
-        }
-    } else if(parseCtx->tokenArray[parseCtx->index].type == JSMN_ARRAY) {
-        size_t arraySize = (size_t)(parseCtx->tokenArray[parseCtx->index].size);
-        
-        parseCtx->index++; /*Object to first element*/
-        CHECK_TOKEN_BOUNDS;
-        
-        size_t i;
-        for(i = 0; i < arraySize; i++) {
-            if(parseCtx->tokenArray[parseCtx->index].type == JSMN_OBJECT) {
-               ret = searchObjectForKeyRec(searchKey, ctx, parseCtx, resultIndex,
-                                           (UA_UInt16)(depth + 1));
-            } else if(parseCtx->tokenArray[parseCtx->index].type == JSMN_ARRAY) {
-               ret = searchObjectForKeyRec(searchKey, ctx, parseCtx, resultIndex,
-                                           (UA_UInt16)(depth + 1));
-            } else {
-                /* Only Primitive or string */
-                parseCtx->index++;
-            }
-        }
-    }
-    return ret;
-}
-
+ * OPC UA type of a token. Only the keys of the current object are compared.
+ * Their values are stepped over without walking their content. */
 UA_FUNC_ATTR_WARN_UNUSED_RESULT status
 lookAheadForKey(const char* search, CtxJson *ctx,
                 ParseCtx *parseCtx, size_t *resultIndex) {
-    UA_UInt16 oldIndex = parseCtx->index; /* Save index for later restore */
-    
-    UA_UInt16 depth = 0;
-    UA_StatusCode ret  = searchObjectForKeyRec(search, ctx, parseCtx, resultIndex, depth);
-
-    parseCtx->index = oldIndex; /* Restore index */
-    return ret;
-}
+    if(getJsmnType(parseCtx) != JSMN_OBJECT)
+        return UA_STATUSCODE_BADNOTFOUND;
 
-/* Function used to jump over an object which cannot be parsed */
-static status
-jumpOverRec(CtxJson *ctx, ParseCtx *parseCtx,
-            size_t *resultIndex, UA_UInt16 depth) {
-    UA_StatusCode ret = UA_STATUSCODE_BADDECODINGERROR;
-    CHECK_TOKEN_BOUNDS;
-    
-    if(parseCtx->tokenArray[parseCtx->index].type == JSMN_OBJECT) {
-        size_t objectCount = (size_t)(parseCtx->tokenArray[parseCtx->index].size);
-        
-        parseCtx->index++; /*Object to first Key*/
-        CHECK_TOKEN_BOUNDS;
-        
-        size_t i;
-        for(i = 0; i < objectCount; i++) {
-            CHECK_TOKEN_BOUNDS;
-             
-            parseCtx->index++; /*value*/
-            CHECK_TOKEN_BOUNDS;
-            
-            if(parseCtx->tokenArray[parseCtx->index].type == JSMN_OBJECT) {
-               jumpOverRec(ctx, parseCtx, resultIndex, (UA_UInt16)(depth + 1));
-            } else if(parseCtx->tokenArray[parseCtx->index].type == JSMN_ARRAY) {
-               jumpOverRec(ctx, parseCtx, resultIndex, (UA_UInt16)(depth + 1));
-            } else {
-                /*Only Primitive or string*/
-                parseCtx->index++;
-            }
-        }
-    } else if(parseCtx->tokenArray[parseCtx->index].type == JSMN_ARRAY) {
-        size_t arraySize = (size_t)(parseCtx->tokenArray[parseCtx->index].size);
-        
-        parseCtx->index++; /*Object to first element*/
-        CHECK_TOKEN_BOUNDS;
-        
-        size_t i;
-        for(i = 0; i < arraySize; i++) {
-            if(parseCtx->tokenArray[parseCtx->index].type == JSMN_OBJECT) {
-               jumpOverRec(ctx, parseCtx, resultIndex, (UA_UInt16)(depth + 1));
-            } else if(parseCtx->tokenArray[parseCtx->index].type == JSMN_ARRAY) {
-               jumpOverRec(ctx, parseCtx, resultIndex, (UA_UInt16)(depth + 1));
-            } else {
-                /*Only Primitive or string*/
-                parseCtx->index++;
-            }
+    size_t objectCount = (size_t)parseCtx->tokenArray[parseCtx->index].size;
+    size_t i = parseCtx->index + 1; /* First key */
+    for(size_t j = 0; j < objectCount && i + 1 < parseCtx->tokenCount; j++) {
+        if(jsoneq((char*)ctx->pos, &parseCtx->tokenArray[i], search) == 0) {
+            *resultIndex = i + 1; /* Return the index of the value */
+            return UA_STATUSCODE_GOOD;
         }
+        i = parseCtx->tokenSkip[i + 1]; /* Step over the value to the next key */
     }
-    return ret;
+    return UA_STATUSCODE_BADNOTFOUND;
 }
 
+/* Function used to jump over an object which cannot be parsed */
 static status
 jumpOverObject(CtxJson *ctx, ParseCtx *parseCtx, size_t *resultIndex) {
-    UA_UInt16 oldIndex = parseCtx->index; /* Save index for later restore */
-    UA_UInt16 depth = 0;
-    jumpOverRec(ctx, parseCtx, resultIndex, depth);
-    *resultIndex = parseCtx->index;
-    parseCtx->index = oldIndex; /* Restore index */
+    CHECK_TOKEN_BOUNDS;
+    *resultIndex = parseCtx->tokenSkip[parseCtx->index];
     return UA_STATUSCODE_GOOD;
 }
 
@@ -2808,8 +2673,8 @@ DECODE_JSON(ExtensionObject) {
 
         /* parse the nodeid */
         /*for restore*/
-        UA_UInt16 index = parseCtx->index;
-        parseCtx->index = (UA_UInt16)searchTypeIdResult;
+        size_t index = parseCtx->index;
+        parseCtx->index = searchTypeIdResult;
         ret = NodeId_decodeJson(&typeId, &UA_TYPES[UA_TYPES_NODEID], ctx, parseCtx, true);
         if(ret != UA_STATUSCODE_GOOD)
             return ret;
@@ -2873,7 +2738,7 @@ DECODE_JSON(ExtensionObject) {
                 return UA_STATUSCODE_BADDECODINGERROR;
             }
             
-            parseCtx->index = (UA_UInt16)tokenAfteExtensionObject;
+            parseCtx->index = tokenAfteExtensionObject;
             
             return UA_STATUSCODE_GOOD;
         }
@@ -2940,7 +2805,7 @@ static status
 Variant_decodeJsonUnwrapExtensionObject(UA_Variant *dst, const UA_DataType *type, 
                                         CtxJson *ctx, ParseCtx *parseCtx, UA_Boolean moveToken) {
     /*EXTENSIONOBJECT POSITION!*/
-    UA_UInt16 old_index = parseCtx->index;
+    size_t old_index = parseCtx->index;
     UA_Boolean typeIdFound = false;
     
     /* Decode the DataType */
@@ -2957,7 +2822,7 @@ Variant_decodeJsonUnwrapExtensionObject(UA_Variant *dst, const UA_DataType *type
     } else {
         typeIdFound = true;
         /* parse the nodeid */
-        parseCtx->index = (UA_UInt16)searchTypeIdResult;
+        parseCtx->index = searchTypeIdResult;
         ret = NodeId_decodeJson(&typeId, &UA_TYPES[UA_TYPES_NODEID], ctx, parseCtx, true);
         if(ret != UA_STATUSCODE_GOOD) {
             UA_NodeId_deleteMembers(&typeId);
@@ -3124,9 +2989,9 @@ decodeFields(CtxJson *ctx, ParseCtx *parseCtx, DecodeEntry *entries,
                 if(ret != UA_STATUSCODE_GOOD)
                     return ret;
             } else {
-                /*overstep single value, this will not work if object or array
-                 Only used not to double parse pre looked up type, but it has to be overstepped*/
-                parseCtx->index++;
+                /* Step over the value. Used not to double parse a pre looked
+                 * up type. */
+                parseCtx->index = parseCtx->tokenSkip[parseCtx->index];
             }
             break;
         }
@@ -3261,30 +3126,80 @@ decodeJsonInternal(void *dst, const UA_DataType *type, CtxJson *ctx,
     return ret;
 }
 
+/* Compute for every token the index of the first token behind its subtree. The
+ * tokens are in pre-order and all tokens of a subtree start before the end of
+ * its root token. The not yet finished tokens are kept as a stack that is
+ * linked through the tokenSkip entries. */
+static void
+computeTokenSkip(ParseCtx *parseCtx) {
+    jsmntok_t *tokens = parseCtx->tokenArray;
+    size_t *skip = parseCtx->tokenSkip;
+    size_t top = SIZE_MAX; /* Empty stack */
+    for(size_t i = 0; i < parseCtx->tokenCount; i++) {
+        while(top != SIZE_MAX && tokens[top].end <= tokens[i].start) {
+            size_t below = skip[top];
+            skip[top] = i;
+            top = below;
+        }
+        skip[i] = top;
+        top = i;
+    }
+    while(top != SIZE_MAX) {
+        size_t below = skip[top];
+        skip[top] = parseCtx->tokenCount;
+        top = below;
+    }
+}
+
 status
 tokenize(ParseCtx *parseCtx, CtxJson *ctx, const UA_ByteString *src) {
     /* Set up the context */
     ctx->pos = &src->data[0];
     ctx->end = &src->data[src->length];
     ctx->depth = 0;
+    parseCtx->tokenArray = NULL;
+    parseCtx->tokenSkip = NULL;
     parseCtx->tokenCount = 0;
     parseCtx->index = 0;
 
-    /*Set up tokenizer jsmn*/
+    /* Set up tokenizer jsmn. If the token array is too small, it is grown and
+     * jsmn continues where it stopped. */
     jsmn_parser p;
     jsmn_init(&p);
-    parseCtx->tokenCount = (UA_Int32)jsmn_parse(&p, (char*)src->data,
-                                                src->length, parseCtx->tokenArray, TOKENCOUNT);
-    
-    if(parseCtx->tokenCount < 0) {
-        if(parseCtx->tokenCount == JSMN_ERROR_NOMEM)
+    size_t arraySize = UA_JSON_INITIAL_TOKENCOUNT;
+    int res;
+    do {
+        jsmntok_t *tokens = (jsmntok_t*)
+            UA_realloc(parseCtx->tokenArray, sizeof(jsmntok_t) * arraySize);
+        if(!tokens)
             return UA_STATUSCODE_BADOUTOFMEMORY;
+        parseCtx->tokenArray = tokens;
+        res = jsmn_parse(&p, (char*)src->data, src->length,
+                         tokens, (unsigned int)arraySize);
+        arraySize *= 2;
+    } while(res == JSMN_ERROR_NOMEM);
+
+    if(res < 0)
         return UA_STATUSCODE_BADDECODINGERROR;
-    }
-    
+    parseCtx->tokenCount = (size_t)res;
+    if(parseCtx->tokenCount == 0)
+        return UA_STATUSCODE_GOOD;
+
+    parseCtx->tokenSkip = (size_t*)UA_malloc(sizeof(size_t) * parseCtx->tokenCount);
+    if(!parseCtx->tokenSkip)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    computeTokenSkip(parseCtx);
     return UA_STATUSCODE_GOOD;
 }
 
+void
+deleteTokens(ParseCtx *parseCtx) {
+    UA_free(parseCtx->tokenArray);
+    UA_free(parseCtx->tokenSkip);
+    parseCtx->tokenArray = NULL;
+    parseCtx->tokenSkip = NULL;
+}
+
 status UA_FUNC_ATTR_WARN_UNUSED_RESULT
 UA_decodeJson(const UA_ByteString *src, void *dst, const UA_DataType *type) {
     
@@ -3299,10 +3214,7 @@ UA_decodeJson(const UA_ByteString *src, void *dst, const UA_DataType *type) {
     /* Set up the context */
     CtxJson ctx;
     ParseCtx parseCtx;
-    parseCtx.tokenArray = (jsmntok_t*)UA_malloc(sizeof(jsmntok_t) * TOKENCOUNT);
-    if(!parseCtx.tokenArray)
-        return UA_STATUSCODE_BADOUTOFMEMORY;
-    
+    memset(&parseCtx, 0, sizeof(ParseCtx));
     status ret = tokenize(&parseCtx, &ctx, src);
     if(ret != UA_STATUSCODE_GOOD)
         goto cleanup;
@@ -3327,7 +3239,7 @@ UA_decodeJson(const UA_ByteString *src, void *dst, const UA_DataType *type) {
     ret = decodeJsonInternal(dst, type, &ctx, &parseCtx, true);
 
     cleanup:
-    free(parseCtx.tokenArray);
+    deleteTokens(&parseCtx);
     
     /* sanity check if all Tokens were processed */
     if(!(parseCtx.index == parseCtx.tokenCount ||
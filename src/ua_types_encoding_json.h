@@ -18,9 +18,10 @@ extern "C" {
 #include "ua_types_encoding_json.h"
 #include "ua_types.h"
 #include "../deps/jsmn/jsmn.h"
- 
-#define TOKENCOUNT 1000
-    
+
+/* Initial size of the token array. The array is grown as needed. */
+#define UA_JSON_INITIAL_TOKENCOUNT 64
+
 size_t
 UA_calcSizeJson(const void *src, const UA_DataType *type,
                 UA_String *namespaces, size_t namespaceSize,
@@ -34,6 +35,17 @@ UA_encodeJson(const void *src, const UA_DataType *type,
               UA_String *serverUris, size_t serverUriSize,
               UA_Boolean useReversible) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
 
+/* Encodes into a buffer that is grown while encoding. No separate pass to
+ * compute the encoding size is required. If buffer->length is zero, the buffer
+ * is allocated. Afterwards, buffer->length is the capacity of the (possibly
+ * reallocated) buffer and encodedLength the length of the encoding. */
+UA_StatusCode
+UA_encodeJsonBuffer(const void *src, const UA_DataType *type,
+                    UA_ByteString *buffer, size_t *encodedLength,
+                    UA_String *namespaces, size_t namespaceSize,
+                    UA_String *serverUris, size_t serverUriSize,
+                    UA_Boolean useReversible) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
+
 UA_StatusCode
 UA_decodeJson(const UA_ByteString *src, void *dst,
               const UA_DataType *type) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
@@ -57,8 +69,15 @@ typedef struct {
     
     size_t serverUrisSize;
     UA_String *serverUris;
+
+    /* If set, the buffer is reallocated when the encoding does not fit. pos
+     * and end then point into the new buffer. */
+    UA_ByteString *growBuffer;
 } CtxJson;
 
+/* Ensures that len bytes can be written at ctx->pos */
+UA_StatusCode reserveJson(CtxJson *ctx, size_t len);
+
 UA_StatusCode writeJsonObjStart(CtxJson *ctx);
 UA_StatusCode writeJsonObjElm(CtxJson *ctx, UA_String *key,
                               const void *value, const UA_DataType *type);
@@ -117,8 +136,12 @@ encodeJsonInternal(const void *src, const UA_DataType *type, CtxJson *ctx);
 
 typedef struct {
     jsmntok_t *tokenArray;
-    UA_Int32 tokenCount;
-    UA_UInt16 index;
+    size_t tokenCount;
+    size_t index;
+
+    /* For every token the index of the first token behind its subtree. Used to
+     * step over values without walking their content. */
+    size_t *tokenSkip;
 
     /* Additonal data for special cases such as networkmessage/datasetmessage
      * Currently only used for dataSetWriterIds */
@@ -159,6 +182,7 @@ decodeJsonSignature getDecodeSignature(u8 index);
 UA_StatusCode lookAheadForKey(const char* search, CtxJson *ctx, ParseCtx *parseCtx, size_t *resultIndex);
 jsmntype_t getJsmnType(const ParseCtx *parseCtx);
 UA_StatusCode tokenize(ParseCtx *parseCtx, CtxJson *ctx, const UA_ByteString *src);
+void deleteTokens(ParseCtx *parseCtx);
 UA_Boolean isJsonNull(const CtxJson *ctx, const ParseCtx *parseCtx);
 
 #ifdef __cplusplus
@@ -45,9 +45,6 @@ typedef UA_StatusCode status;
  * up to that point. */
 size_t UA_readNumber(u8 *buf, size_t buflen, u32 *number);
 
-/* Same as UA_ReadNumber but with a base parameter */
-size_t UA_readNumberWithBase(u8 *buf, size_t buflen, u32 *number, u8 base);
-
 #ifndef UA_MIN
 #define UA_MIN(A,B) (A > B ? B : A)
 #endif
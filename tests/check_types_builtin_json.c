@@ -235,6 +235,77 @@ START_TEST(UA_String_special_json_encode) {
 }
 END_TEST
 
+/* Characters that must be escaped at every offset of strings that are longer
+ * than the vector width of the scanner */
+START_TEST(UA_String_long_escape_json_encode) {
+    const char special[3] = {'"', '\n', 0x1f};
+    const char *escaped[3] = {"\\\"", "\\n", "\\u001f"};
+    char str[80];
+    for(size_t len = 1; len < 80; len++) {
+        for(size_t pos = 0; pos < len; pos++) {
+            for(size_t k = 0; k < 3; k++) {
+                memset(str, 'a', len);
+                str[pos] = special[k];
+                UA_String src = {len, (UA_Byte*)str};
+                const UA_DataType *type = &UA_TYPES[UA_TYPES_STRING];
+                size_t size = UA_calcSizeJson(&src, type, NULL, 0, NULL, 0, UA_TRUE);
+                size_t escLen = strlen(escaped[k]);
+                ck_assert_uint_eq(size, len + 1 + escLen);
+
+                UA_ByteString buf;
+                UA_ByteString_allocBuffer(&buf, size);
+                UA_Byte *bufPos = &buf.data[0];
+                const UA_Byte *bufEnd = &buf.data[size];
+                status s = UA_encodeJson(&src, type, &bufPos, &bufEnd, NULL, 0, NULL, 0, UA_TRUE);
+                ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+                ck_assert(memcmp(&buf.data[pos + 1], escaped[k], escLen) == 0);
+
+                UA_String out;
+                s = UA_decodeJson(&buf, &out, type);
+                ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+                ck_assert(UA_String_equal(&src, &out));
+                UA_String_deleteMembers(&out);
+                UA_ByteString_deleteMembers(&buf);
+            }
+        }
+    }
+}
+END_TEST
+
+START_TEST(UA_String_invalidUtf8_json_encode) {
+    const char *invalid[4] = {"\xff", "\xc0\x80", "\xed\xa0\x80", "\xe2\x82"};
+    char str[80];
+    for(size_t pos = 0; pos < 70; pos++) {
+        for(size_t k = 0; k < 4; k++) {
+            memset(str, 'a', 80);
+            size_t seqLen = strlen(invalid[k]);
+            memcpy(&str[pos], invalid[k], seqLen);
+            /* The truncated sequence is only invalid at the end */
+            UA_String src = {k == 3 ? pos + seqLen : 80, (UA_Byte*)str};
+            UA_ByteString buf = UA_BYTESTRING_NULL;
+            size_t encodedLength = 0;
+            status s = UA_encodeJsonBuffer(&src, &UA_TYPES[UA_TYPES_STRING], &buf,
+                                           &encodedLength, NULL, 0, NULL, 0, UA_TRUE);
+            ck_assert_int_eq(s, UA_STATUSCODE_BADENCODINGERROR);
+            UA_ByteString_deleteMembers(&buf);
+        }
+
+        /* Valid multi-byte sequence */
+        memset(str, 'a', 80);
+        memcpy(&str[pos], "\xe2\x82\xac", 3);
+        UA_String src = {80, (UA_Byte*)str};
+        UA_ByteString buf = UA_BYTESTRING_NULL;
+        size_t encodedLength = 0;
+        status s = UA_encodeJsonBuffer(&src, &UA_TYPES[UA_TYPES_STRING], &buf,
+                                       &encodedLength, NULL, 0, NULL, 0, UA_TRUE);
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(encodedLength, 82);
+        ck_assert(memcmp(&buf.data[1], str, 80) == 0);
+        UA_ByteString_deleteMembers(&buf);
+    }
+}
+END_TEST
+
 /* Byte */
 START_TEST(UA_Byte_Max_Number_json_encode) {
 
@@ -982,7 +1053,7 @@ START_TEST(UA_Double_json_encode) {
     
     // then
     ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
-    char* result = "1.1233999999999999541699935434735380113124847412109375";
+    char* result = "1.1234";
     ck_assert_str_eq(result, (char*)buf.data);
     UA_ByteString_deleteMembers(&buf);
 }
@@ -1122,7 +1193,7 @@ START_TEST(UA_Double_onesmallest_json_encode) {
     
     // then
     ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
-    char* result = "1.0000000000000002220446049250313080847263336181640625";
+    char* result = "1.0000000000000002";
     ck_assert_str_eq(result, (char*)buf.data);
     UA_ByteString_deleteMembers(&buf);
 }
@@ -1153,6 +1224,46 @@ END_TEST
 
 
 
+START_TEST(UA_Double_shortest_json_encode) {
+    const UA_Double src[9] = {0.1, 123456.0, 0.000001, 1e-7, 1e21, 5e-324,
+                              1.7976931348623157e308, -2.5, 1e100};
+    const char *result[9] = {"0.1", "123456", "0.000001", "1e-7", "1e+21", "5e-324",
+                             "1.7976931348623157e+308", "-2.5", "1e+100"};
+    for(size_t i = 0; i < 9; i++) {
+        UA_ByteString buf;
+        UA_ByteString_allocBuffer(&buf, 64);
+        UA_Byte *bufPos = &buf.data[0];
+        const UA_Byte *bufEnd = &buf.data[63];
+        status s = UA_encodeJson(&src[i], &UA_TYPES[UA_TYPES_DOUBLE], &bufPos, &bufEnd,
+                                 NULL, 0, NULL, 0, UA_TRUE);
+        *bufPos = 0;
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        ck_assert_str_eq(result[i], (char*)buf.data);
+        ck_assert_uint_eq(UA_calcSizeJson(&src[i], &UA_TYPES[UA_TYPES_DOUBLE],
+                                          NULL, 0, NULL, 0, UA_TRUE), strlen(result[i]));
+        UA_ByteString_deleteMembers(&buf);
+    }
+}
+END_TEST
+
+START_TEST(UA_Float_shortest_json_encode) {
+    const UA_Float src[4] = {0.1f, 3.1415927f, 1e-45f, 3.4028235e38f};
+    const char *result[4] = {"0.1", "3.1415927", "1e-45", "3.4028235e+38"};
+    for(size_t i = 0; i < 4; i++) {
+        UA_ByteString buf;
+        UA_ByteString_allocBuffer(&buf, 64);
+        UA_Byte *bufPos = &buf.data[0];
+        const UA_Byte *bufEnd = &buf.data[63];
+        status s = UA_encodeJson(&src[i], &UA_TYPES[UA_TYPES_FLOAT], &bufPos, &bufEnd,
+                                 NULL, 0, NULL, 0, UA_TRUE);
+        *bufPos = 0;
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        ck_assert_str_eq(result[i], (char*)buf.data);
+        UA_ByteString_deleteMembers(&buf);
+    }
+}
+END_TEST
+
 /* -------------------------LocalizedText------------------------- */
 START_TEST(UA_LocText_json_encode) {
 
@@ -4151,6 +4262,79 @@ START_TEST(UA_Double_negzero_json_decode) {
 }
 END_TEST
 
+/* Encode random bit patterns and check that decoding restores the exact
+ * value */
+START_TEST(UA_Double_roundtrip_json) {
+    UA_UInt64 x = 0x123456789abcdefULL;
+    for(size_t i = 0; i < 100000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        UA_Double src;
+        memcpy(&src, &x, sizeof(UA_Double));
+        if(src != src || src > DBL_MAX || src < -DBL_MAX)
+            continue;
+        UA_Variant v;
+        UA_Variant_setScalar(&v, &src, &UA_TYPES[UA_TYPES_DOUBLE]);
+        UA_ByteString buf = UA_BYTESTRING_NULL;
+        size_t encodedLength = 0;
+        status s = UA_encodeJsonBuffer(&v, &UA_TYPES[UA_TYPES_VARIANT], &buf, &encodedLength,
+                                       NULL, 0, NULL, 0, UA_TRUE);
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        size_t capacity = buf.length;
+        buf.length = encodedLength;
+        UA_Variant out;
+        s = UA_decodeJson(&buf, &out, &UA_TYPES[UA_TYPES_VARIANT]);
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        ck_assert(out.type == &UA_TYPES[UA_TYPES_DOUBLE]);
+        ck_assert(memcmp(&src, out.data, sizeof(UA_Double)) == 0);
+        UA_Variant_deleteMembers(&out);
+        buf.length = capacity;
+        UA_ByteString_deleteMembers(&buf);
+    }
+}
+END_TEST
+
+START_TEST(UA_Float_roundtrip_json) {
+    UA_UInt32 x = 0x12345678;
+    for(size_t i = 0; i < 100000; i++) {
+        x = x * 1664525u + 1013904223u;
+        UA_Float src;
+        memcpy(&src, &x, sizeof(UA_Float));
+        if(src != src || src > FLT_MAX || src < -FLT_MAX)
+            continue;
+        UA_Variant v;
+        UA_Variant_setScalar(&v, &src, &UA_TYPES[UA_TYPES_FLOAT]);
+        UA_ByteString buf = UA_BYTESTRING_NULL;
+        size_t encodedLength = 0;
+        status s = UA_encodeJsonBuffer(&v, &UA_TYPES[UA_TYPES_VARIANT], &buf, &encodedLength,
+                                       NULL, 0, NULL, 0, UA_TRUE);
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        size_t capacity = buf.length;
+        buf.length = encodedLength;
+        UA_Variant out;
+        s = UA_decodeJson(&buf, &out, &UA_TYPES[UA_TYPES_VARIANT]);
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        ck_assert(out.type == &UA_TYPES[UA_TYPES_FLOAT]);
+        ck_assert(memcmp(&src, out.data, sizeof(UA_Float)) == 0);
+        UA_Variant_deleteMembers(&out);
+        buf.length = capacity;
+        UA_ByteString_deleteMembers(&buf);
+    }
+}
+END_TEST
+
+/* Numbers with more significant digits than the fast path handles */
+START_TEST(UA_Double_longmantissa_json_decode) {
+    UA_Variant out;
+    UA_Variant_init(&out);
+    UA_ByteString buf =
+        UA_STRING("{\"Type\":11,\"Body\":1.12339999999999995416999354347353801131248474121093750}");
+    UA_StatusCode retval = UA_decodeJson(&buf, &out, &UA_TYPES[UA_TYPES_VARIANT]);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(*(UA_Double*)out.data == 1.1234);
+    UA_Variant_deleteMembers(&out);
+}
+END_TEST
+
 START_TEST(UA_String_json_decode) { 
     UA_Variant out;
     UA_Variant_init(&out);
@@ -4320,6 +4504,52 @@ START_TEST(UA_ByteString_bad_json_decode) {
 }
 END_TEST
 
+/* Base64 of all lengths around the block sizes of the vectorized kernels */
+START_TEST(UA_ByteString_long_json_roundtrip) {
+    const char *alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    UA_Byte data[100];
+    char expected[140];
+    for(size_t len = 1; len < 100; len++) {
+        for(size_t i = 0; i < len; i++)
+            data[i] = (UA_Byte)(i * 37 + len);
+
+        /* Reference encoding */
+        size_t e = 0;
+        for(size_t i = 0; i < len; i += 3) {
+            UA_UInt32 v = (UA_UInt32)data[i] << 16;
+            if(i + 1 < len)
+                v |= (UA_UInt32)data[i + 1] << 8;
+            if(i + 2 < len)
+                v |= data[i + 2];
+            expected[e++] = alphabet[(v >> 18) & 0x3f];
+            expected[e++] = alphabet[(v >> 12) & 0x3f];
+            expected[e++] = (i + 1 < len) ? alphabet[(v >> 6) & 0x3f] : '=';
+            expected[e++] = (i + 2 < len) ? alphabet[v & 0x3f] : '=';
+        }
+
+        UA_ByteString src = {len, data};
+        UA_ByteString buf = UA_BYTESTRING_NULL;
+        size_t encodedLength = 0;
+        status s = UA_encodeJsonBuffer(&src, &UA_TYPES[UA_TYPES_BYTESTRING], &buf,
+                                       &encodedLength, NULL, 0, NULL, 0, UA_TRUE);
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(encodedLength, e + 2);
+        ck_assert(memcmp(&buf.data[1], expected, e) == 0);
+
+        size_t capacity = buf.length;
+        buf.length = encodedLength;
+        UA_ByteString out;
+        s = UA_decodeJson(&buf, &out, &UA_TYPES[UA_TYPES_BYTESTRING]);
+        ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+        ck_assert(UA_ByteString_equal(&src, &out));
+        UA_ByteString_deleteMembers(&out);
+        buf.length = capacity;
+        UA_ByteString_deleteMembers(&buf);
+    }
+}
+END_TEST
+
 START_TEST(UA_ByteString_null_json_decode) {
     UA_Variant out;
     UA_Variant_init(&out);
@@ -5613,6 +5843,61 @@ START_TEST(UA_Variant_Malformed2_decode) {
 }
 END_TEST
 
+/* Encode into a growing buffer without computing the size first */
+START_TEST(UA_Variant_Array_growBuffer_json_encode) {
+    UA_Int32 values[2000];
+    for(UA_Int32 i = 0; i < 2000; i++)
+        values[i] = i * 1000;
+    UA_Variant src;
+    UA_Variant_setArray(&src, values, 2000, &UA_TYPES[UA_TYPES_INT32]);
+    const UA_DataType *type = &UA_TYPES[UA_TYPES_VARIANT];
+
+    size_t size = UA_calcSizeJson(&src, type, NULL, 0, NULL, 0, UA_TRUE);
+    UA_ByteString expected;
+    UA_ByteString_allocBuffer(&expected, size);
+    UA_Byte *bufPos = expected.data;
+    const UA_Byte *bufEnd = &expected.data[size];
+    status s = UA_encodeJson(&src, type, &bufPos, &bufEnd, NULL, 0, NULL, 0, UA_TRUE);
+    ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+
+    UA_ByteString buf = UA_BYTESTRING_NULL;
+    size_t encodedLength = 0;
+    s = UA_encodeJsonBuffer(&src, type, &buf, &encodedLength, NULL, 0, NULL, 0, UA_TRUE);
+    ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(encodedLength, size);
+    ck_assert_uint_ge(buf.length, size);
+    ck_assert_int_eq(memcmp(buf.data, expected.data, size), 0);
+
+    /* The token array of the decoder grows beyond its initial size */
+    UA_ByteString encoded = {encodedLength, buf.data};
+    UA_Variant out;
+    UA_Variant_init(&out);
+    s = UA_decodeJson(&encoded, &out, type);
+    ck_assert_int_eq(s, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(out.arrayLength, 2000);
+    ck_assert_int_eq(((UA_Int32*)out.data)[1999], 1999000);
+
+    UA_Variant_deleteMembers(&out);
+    UA_ByteString_deleteMembers(&buf);
+    UA_ByteString_deleteMembers(&expected);
+}
+END_TEST
+
+/* The Type key is found behind a nested Body */
+START_TEST(UA_Variant_BodyBeforeType_json_decode) {
+    UA_Variant out;
+    UA_Variant_init(&out);
+    UA_ByteString buf =
+        UA_STRING("{\"Body\":{\"Id\":5,\"Namespace\":2},\"Type\":17}");
+    UA_StatusCode retval = UA_decodeJson(&buf, &out, &UA_TYPES[UA_TYPES_VARIANT]);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(out.type == &UA_TYPES[UA_TYPES_NODEID]);
+    UA_NodeId expected = UA_NODEID_NUMERIC(2, 5);
+    ck_assert(UA_NodeId_equal((UA_NodeId*)out.data, &expected));
+    UA_Variant_deleteMembers(&out);
+}
+END_TEST
+
 START_TEST(UA_JsonHelper) {
     // given
     
@@ -5641,6 +5926,7 @@ static Suite *testSuite_builtin_json(void) {
     tcase_add_test(tc_json_encode, UA_Boolean_true_json_encode);
     tcase_add_test(tc_json_encode, UA_Boolean_false_json_encode);
     tcase_add_test(tc_json_encode, UA_Boolean_true_bufferTooSmall_json_encode);
+    tcase_add_test(tc_json_encode, UA_Variant_Array_growBuffer_json_encode);
     
     tcase_add_test(tc_json_encode, UA_String_json_encode);
     tcase_add_test(tc_json_encode, UA_String_Empty_json_encode);
@@ -5648,6 +5934,8 @@ static Suite *testSuite_builtin_json(void) {
     tcase_add_test(tc_json_encode, UA_String_escapesimple_json_encode);
     tcase_add_test(tc_json_encode, UA_String_escapeutf_json_encode);
     tcase_add_test(tc_json_encode, UA_String_special_json_encode);
+    tcase_add_test(tc_json_encode, UA_String_long_escape_json_encode);
+    tcase_add_test(tc_json_encode, UA_String_invalidUtf8_json_encode);
 
     
     tcase_add_test(tc_json_encode, UA_Byte_Max_Number_json_encode);
@@ -5698,6 +5986,8 @@ static Suite *testSuite_builtin_json(void) {
     tcase_add_test(tc_json_encode, UA_Double_minusInf_json_encode);
     tcase_add_test(tc_json_encode, UA_Double_nan_json_encode);
     tcase_add_test(tc_json_encode, UA_Float_json_encode);
+    tcase_add_test(tc_json_encode, UA_Double_shortest_json_encode);
+    tcase_add_test(tc_json_encode, UA_Float_shortest_json_encode);
     tcase_add_test(tc_json_encode, UA_Variant_Float_json_encode);
     tcase_add_test(tc_json_encode, UA_Variant_DoubleInf_json_encode);
     tcase_add_test(tc_json_encode, UA_Variant_DoubleNan_json_encode);
@@ -5871,6 +6161,9 @@ static Suite *testSuite_builtin_json(void) {
     tcase_add_test(tc_json_decode, UA_Double_nan_json_decode);
     tcase_add_test(tc_json_decode, UA_Double_negnan_json_decode);
     tcase_add_test(tc_json_decode, UA_Double_negzero_json_decode);
+    tcase_add_test(tc_json_decode, UA_Double_roundtrip_json);
+    tcase_add_test(tc_json_decode, UA_Float_roundtrip_json);
+    tcase_add_test(tc_json_decode, UA_Double_longmantissa_json_decode);
     tcase_add_test(tc_json_decode, UA_Double_zero_json_decode);
     tcase_add_test(tc_json_decode, UA_Double_inf_json_decode);
     tcase_add_test(tc_json_decode, UA_Double_neginf_json_decode);
@@ -5890,6 +6183,7 @@ static Suite *testSuite_builtin_json(void) {
     tcase_add_test(tc_json_decode, UA_ByteString_json_decode);
     tcase_add_test(tc_json_decode, UA_ByteString_bad_json_decode);
     tcase_add_test(tc_json_decode, UA_ByteString_null_json_decode);
+    tcase_add_test(tc_json_decode, UA_ByteString_long_json_roundtrip);
     
     
     //DateTime
@@ -5990,6 +6284,7 @@ static Suite *testSuite_builtin_json(void) {
 
     tcase_add_test(tc_json_decode, UA_Variant_Malformed_decode);
     tcase_add_test(tc_json_decode, UA_Variant_Malformed2_decode);
+    tcase_add_test(tc_json_decode, UA_Variant_BodyBeforeType_json_decode);
 
 
     suite_add_tcase(s, tc_json_decode);
@@ -0,0 +1,100 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information. */
+
+/* Compares the JSON encoding and decoding of doubles with the previous
+ * implementation based on snprintf and sscanf. */
+
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+
+#include "ua_types.h"
+#include "ua_types_generated.h"
+#include "ua_types_generated_handling.h"
+#include "ua_types_encoding_json.h"
+
+#define VALUES 10000
+#define ROUNDS 20
+
+static UA_Double values[VALUES];
+
+static void setup(void) {
+    /* Telemetry-like values with a varying number of digits */
+    UA_UInt64 x = 0x9e3779b97f4a7c15ULL;
+    for(size_t i = 0; i < VALUES; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        values[i] = (UA_Double)(x >> 11) / (UA_Double)(1ULL << 40) - 4096.0;
+    }
+}
+
+START_TEST(floatSpeed) {
+    /* Previous implementation */
+    char buffer[2000];
+    UA_Double sum = 0.0;
+    clock_t begin = clock();
+    for(size_t r = 0; r < ROUNDS; r++) {
+        for(size_t i = 0; i < VALUES; i++) {
+            snprintf(buffer, 2000, "%.1074g", values[i]);
+            UA_Double d = 0.0;
+            char c = 0;
+            ck_assert_int_eq(sscanf(buffer, "%lf%c", &d, &c), 1);
+            sum += d;
+        }
+    }
+    clock_t finish = clock();
+    printf("snprintf/sscanf: %f s\n", (double)(finish - begin) / CLOCKS_PER_SEC);
+
+    /* JSON codec with a Double array */
+    UA_Variant v;
+    UA_Variant_setArray(&v, values, VALUES, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_ByteString buf = UA_BYTESTRING_NULL;
+    UA_Double sum2 = 0.0;
+    begin = clock();
+    for(size_t r = 0; r < ROUNDS; r++) {
+        size_t encodedLength = 0;
+        UA_StatusCode retval =
+            UA_encodeJsonBuffer(&v, &UA_TYPES[UA_TYPES_VARIANT], &buf, &encodedLength,
+                                NULL, 0, NULL, 0, UA_TRUE);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        size_t capacity = buf.length;
+        buf.length = encodedLength;
+        UA_Variant out;
+        retval = UA_decodeJson(&buf, &out, &UA_TYPES[UA_TYPES_VARIANT]);
+        buf.length = capacity;
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(out.arrayLength, VALUES);
+        ck_assert(memcmp(out.data, values, VALUES * sizeof(UA_Double)) == 0);
+        for(size_t i = 0; i < VALUES; i++)
+            sum2 += ((UA_Double*)out.data)[i];
+        UA_Variant_deleteMembers(&out);
+    }
+    finish = clock();
+    printf("JSON codec: %f s\n", (double)(finish - begin) / CLOCKS_PER_SEC);
+
+    ck_assert(sum == sum2);
+    UA_ByteString_deleteMembers(&buf);
+}
+END_TEST
+
+static Suite * float_speed_suite (void) {
+    Suite *s = suite_create ("JSON Float Speed");
+
+    TCase* tc_float = tcase_create ("Double");
+    tcase_add_checked_fixture(tc_float, setup, NULL);
+    tcase_add_test (tc_float, floatSpeed);
+    suite_add_tcase (s, tc_float);
+
+    return s;
+}
+
+int main (void) {
+    int number_failed = 0;
+    Suite *s = float_speed_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr,CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed += srunner_ntests_failed (sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -161,6 +161,34 @@ START_TEST(Client_read) {
 }
 END_TEST
 
+START_TEST(Client_read_bufferPool) {
+    UA_Client *client = UA_Client_new(UA_ClientConfig_default);
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_NetworkBufferPoolStatistics before;
+    UA_ServerNetworkLayerTCP_getBufferPoolStatistics(&config->networkLayers[0], &before);
+    ck_assert_uint_ge(before.bufferSize, config->networkLayers[0].localConnectionConfig.sendBufferSize);
+
+    /* Every read reuses the buffers returned to the pool */
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "my.variable");
+    for(size_t i = 0; i < 10; i++) {
+        UA_Variant val;
+        retval = UA_Client_readValueAttribute(client, nodeId, &val);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        UA_Variant_deleteMembers(&val);
+    }
+
+    UA_NetworkBufferPoolStatistics after;
+    UA_ServerNetworkLayerTCP_getBufferPoolStatistics(&config->networkLayers[0], &after);
+    ck_assert_uint_ge(after.hits, before.hits + 20);
+    ck_assert_uint_eq(after.misses, before.misses);
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+}
+END_TEST
+
 START_TEST(Client_renewSecureChannel) {
     UA_Client *client = UA_Client_new(UA_ClientConfig_default);
     UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
@@ -342,6 +370,7 @@ static Suite* testSuite_Client(void) {
     tcase_add_test(tc_client, Client_endpoints);
     tcase_add_test(tc_client, Client_endpoints_empty);
     tcase_add_test(tc_client, Client_read);
+    tcase_add_test(tc_client, Client_read_bufferPool);
     suite_add_tcase(s,tc_client);
     TCase *tc_client_reconnect = tcase_create("Client Reconnect");
     tcase_add_checked_fixture(tc_client_reconnect, setup, teardown);
@@ -8,6 +8,7 @@
 #include "ua_types.h"
 #include "ua_server.h"
 #include "ua_client.h"
+#include "ua_client_highlevel.h"
 #include "ua_client_highlevel_async.h"
 #include "ua_config_default.h"
 #include "ua_network_tcp.h"
@@ -239,6 +240,124 @@ START_TEST(Client_connectivity_check)
         UA_Client_delete(client);
     }END_TEST
 
+static void
+pipelineReadCallback(UA_Client *client, void *userdata,
+                     UA_UInt32 requestId, const UA_ReadResponse *response) {
+    ck_assert_uint_eq(response->responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    (*(UA_UInt16*)userdata)++;
+}
+
+static void
+sendStateRead(UA_Client *client, UA_UInt16 *asyncCounter, UA_StatusCode expected) {
+    UA_ReadValueId rvid;
+    UA_ReadValueId_init(&rvid);
+    rvid.attributeId = UA_ATTRIBUTEID_VALUE;
+    rvid.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE);
+    UA_ReadRequest rr;
+    UA_ReadRequest_init(&rr);
+    rr.nodesToRead = &rvid;
+    rr.nodesToReadSize = 1;
+    UA_StatusCode retval =
+        __UA_Client_AsyncService(client, &rr, &UA_TYPES[UA_TYPES_READREQUEST],
+                                 (UA_ClientAsyncServiceCallback) pipelineReadCallback,
+                                 &UA_TYPES[UA_TYPES_READRESPONSE], asyncCounter, NULL);
+    ck_assert_uint_eq(retval, expected);
+}
+
+START_TEST(Client_pipeline_window)
+    {
+        UA_ClientConfig clientConfig = UA_ClientConfig_default;
+        clientConfig.maxPipelinedRequests = 4;
+        UA_Client *client = UA_Client_new(clientConfig);
+        UA_StatusCode retval = UA_Client_connect(client,
+                "opc.tcp://localhost:4840");
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+        /* The window is full after four requests */
+        UA_UInt16 asyncCounter = 0;
+        for(size_t i = 0; i < 4; i++)
+            sendStateRead(client, &asyncCounter, UA_STATUSCODE_GOOD);
+        sendStateRead(client, &asyncCounter, UA_STATUSCODE_BADTOOMANYOPERATIONS);
+
+        /* The responses free the window */
+        for(size_t i = 0; i < 100 && asyncCounter < 4; i++)
+            UA_Client_run_iterate(client, 0);
+        ck_assert_uint_eq(asyncCounter, 4);
+        sendStateRead(client, &asyncCounter, UA_STATUSCODE_GOOD);
+
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+    }
+END_TEST
+
+/* Many outstanding requests are spread over the buckets of the hash table */
+START_TEST(Client_pipeline_manyRequests)
+    {
+        UA_Client *client = UA_Client_new(UA_ClientConfig_default);
+        UA_StatusCode retval = UA_Client_connect(client,
+                "opc.tcp://localhost:4840");
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+        UA_UInt16 asyncCounter = 0;
+        for(size_t i = 0; i < 1000; i++)
+            sendStateRead(client, &asyncCounter, UA_STATUSCODE_GOOD);
+        for(size_t i = 0; i < 10000 && asyncCounter < 1000; i++)
+            UA_Client_run_iterate(client, 0);
+        ck_assert_uint_eq(asyncCounter, 1000);
+
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+    }
+END_TEST
+
+START_TEST(Client_readPipelined)
+    {
+        UA_ClientConfig clientConfig = UA_ClientConfig_default;
+        clientConfig.maxPipelinedRequests = 3;
+        UA_Client *client = UA_Client_new(clientConfig);
+        UA_StatusCode retval = UA_Client_connect(client,
+                "opc.tcp://localhost:4840");
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+        /* Every third node does not exist */
+        UA_ReadValueId rvids[100];
+        for(size_t i = 0; i < 100; i++) {
+            UA_ReadValueId_init(&rvids[i]);
+            rvids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+            if(i % 3 == 0)
+                rvids[i].nodeId = UA_NODEID_NUMERIC(1, (UA_UInt32)(10000 + i));
+            else
+                rvids[i].nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE);
+        }
+
+        UA_DataValue results[100];
+        retval = UA_Client_readPipelined(client, rvids, 100, 7,
+                                         UA_TIMESTAMPSTORETURN_NEITHER, results);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        for(size_t i = 0; i < 100; i++) {
+            if(i % 3 == 0) {
+                ck_assert_uint_eq(results[i].status, UA_STATUSCODE_BADNODEIDUNKNOWN);
+                continue;
+            }
+            ck_assert(results[i].hasValue);
+            ck_assert(UA_Variant_isScalar(&results[i].value));
+        }
+        for(size_t i = 0; i < 100; i++)
+            UA_DataValue_deleteMembers(&results[i]);
+
+        /* The window is free again */
+        ck_assert_uint_eq(client->pipelinedRequests, 0);
+
+        UA_Client_disconnect(client);
+
+        /* Not connected */
+        retval = UA_Client_readPipelined(client, rvids, 100, 7,
+                                         UA_TIMESTAMPSTORETURN_NEITHER, results);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_BADSERVERNOTCONNECTED);
+        UA_Client_delete(client);
+    }
+END_TEST
+
 static Suite* testSuite_Client(void) {
     Suite *s = suite_create("Client");
     TCase *tc_client = tcase_create("Client Basic");
@@ -247,6 +366,9 @@ static Suite* testSuite_Client(void) {
     tcase_add_test(tc_client, Client_read_async_timed);
     tcase_add_test(tc_client, Client_connectivity_check);
     tcase_add_test(tc_client, Client_highlevel_async_readValue);
+    tcase_add_test(tc_client, Client_pipeline_window);
+    tcase_add_test(tc_client, Client_pipeline_manyRequests);
+    tcase_add_test(tc_client, Client_readPipelined);
 
     suite_add_tcase(s, tc_client);
     return s;
@@ -0,0 +1,249 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ua_types.h"
+#include "ua_server.h"
+#include "ua_client.h"
+#include "ua_client_highlevel_async.h"
+#include "ua_config_default.h"
+#include "check.h"
+#include "thread_wrapper.h"
+
+#define CLIENTS 20
+
+UA_Server *server;
+UA_ServerConfig *config;
+UA_Boolean running;
+THREAD_HANDLE server_thread;
+
+UA_ClientGroup *group;
+UA_Client *clients[CLIENTS];
+size_t responses[CLIENTS];
+
+THREAD_CALLBACK(serverloop) {
+    while(running)
+        UA_Server_run_iterate(server, true);
+    return 0;
+}
+
+static void setup(void) {
+    running = true;
+    config = UA_ServerConfig_new_default();
+    server = UA_Server_new(config);
+    UA_Server_run_startup(server);
+    THREAD_CREATE(server_thread, serverloop);
+
+    group = UA_ClientGroup_new();
+    ck_assert_ptr_ne(group, NULL);
+    for(size_t i = 0; i < CLIENTS; i++) {
+        clients[i] = UA_Client_new(UA_ClientConfig_default);
+        responses[i] = 0;
+        UA_StatusCode retval = UA_ClientGroup_add(group, clients[i]);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+}
+
+static void teardown(void) {
+    for(size_t i = 0; i < CLIENTS; i++) {
+        if(!clients[i])
+            continue;
+        UA_ClientGroup_remove(group, clients[i]);
+        UA_Client_disconnect(clients[i]);
+        UA_Client_delete(clients[i]);
+    }
+    UA_ClientGroup_delete(group);
+
+    running = false;
+    THREAD_JOIN(server_thread);
+    UA_Server_run_shutdown(server);
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+}
+
+static void
+onConnect(UA_Client *client, void *userdata, UA_UInt32 requestId,
+          void *response) {}
+
+static void
+connectAll(void) {
+    for(size_t i = 0; i < CLIENTS; i++) {
+        UA_StatusCode retval =
+            UA_Client_connect_async(clients[i], "opc.tcp://localhost:4840",
+                                    onConnect, NULL);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+
+    UA_DateTime maxDate = UA_DateTime_nowMonotonic() + (5 * UA_DATETIME_SEC);
+    size_t connected = 0;
+    while(connected < CLIENTS && UA_DateTime_nowMonotonic() < maxDate) {
+        UA_StatusCode retval = UA_ClientGroup_run_iterate(group, 10);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        connected = 0;
+        for(size_t i = 0; i < CLIENTS; i++) {
+            if(UA_Client_getState(clients[i]) == UA_CLIENTSTATE_SESSION)
+                connected++;
+        }
+    }
+    ck_assert_uint_eq(connected, CLIENTS);
+}
+
+static void
+readCallback(UA_Client *client, void *userdata, UA_UInt32 requestId,
+             UA_ReadResponse *response) {
+    ck_assert_uint_eq(response->responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(response->resultsSize, 1);
+    ck_assert(response->results[0].hasValue);
+    (*(size_t*)userdata)++;
+}
+
+static void
+sendReadRequest(size_t i) {
+    UA_ReadValueId rvid;
+    UA_ReadValueId_init(&rvid);
+    rvid.attributeId = UA_ATTRIBUTEID_VALUE;
+    rvid.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE);
+    UA_ReadRequest request;
+    UA_ReadRequest_init(&request);
+    request.nodesToRead = &rvid;
+    request.nodesToReadSize = 1;
+    UA_StatusCode retval =
+        UA_Client_sendAsyncReadRequest(clients[i], &request, readCallback,
+                                       &responses[i], NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static size_t
+iterateUntilResponses(size_t expected) {
+    UA_DateTime maxDate = UA_DateTime_nowMonotonic() + (5 * UA_DATETIME_SEC);
+    size_t received = 0;
+    while(received < expected && UA_DateTime_nowMonotonic() < maxDate) {
+        UA_ClientGroup_run_iterate(group, 10);
+        received = 0;
+        for(size_t i = 0; i < CLIENTS; i++)
+            received += responses[i];
+    }
+    return received;
+}
+
+START_TEST(ClientGroup_connectAsync) {
+    connectAll();
+}
+END_TEST
+
+START_TEST(ClientGroup_readAsync) {
+    connectAll();
+    for(size_t round = 0; round < 5; round++) {
+        for(size_t i = 0; i < CLIENTS; i++)
+            sendReadRequest(i);
+    }
+    ck_assert_uint_eq(iterateUntilResponses(5 * CLIENTS), 5 * CLIENTS);
+    for(size_t i = 0; i < CLIENTS; i++)
+        ck_assert_uint_eq(responses[i], 5);
+}
+END_TEST
+
+/* The remaining clients are serviced when some clients are removed and closed
+ * between iterations */
+START_TEST(ClientGroup_removeClients) {
+    connectAll();
+    for(size_t i = 0; i < CLIENTS; i += 2) {
+        UA_StatusCode retval = UA_ClientGroup_remove(group, clients[i]);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        retval = UA_ClientGroup_remove(group, clients[i]);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_BADNOTFOUND);
+        UA_Client_disconnect(clients[i]);
+        UA_Client_delete(clients[i]);
+        clients[i] = NULL;
+    }
+
+    for(size_t i = 1; i < CLIENTS; i += 2)
+        sendReadRequest(i);
+    ck_assert_uint_eq(iterateUntilResponses(CLIENTS / 2), CLIENTS / 2);
+}
+END_TEST
+
+/* A client that reconnects between two iterations mostly gets the socket
+ * number of its closed connection back. The new socket is registered
+ * nevertheless. */
+START_TEST(ClientGroup_reconnect) {
+    connectAll();
+    for(size_t i = 0; i < CLIENTS; i++)
+        sendReadRequest(i);
+    ck_assert_uint_eq(iterateUntilResponses(CLIENTS), CLIENTS);
+
+    for(size_t i = 0; i < CLIENTS; i += 2) {
+        UA_StatusCode retval = UA_Client_disconnect(clients[i]);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        retval = UA_Client_connect(clients[i], "opc.tcp://localhost:4840");
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+
+    for(size_t i = 0; i < CLIENTS; i++)
+        sendReadRequest(i);
+    ck_assert_uint_eq(iterateUntilResponses(2 * CLIENTS), 2 * CLIENTS);
+    for(size_t i = 0; i < CLIENTS; i++)
+        ck_assert_uint_eq(responses[i], 2);
+}
+END_TEST
+
+static void
+removeCallback(UA_Client *client, void *userdata, UA_UInt32 requestId,
+               UA_ReadResponse *response) {
+    readCallback(client, userdata, requestId, response);
+    UA_StatusCode retval = UA_ClientGroup_remove(group, client);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+/* Clients remove themselves from the group in the response callback */
+START_TEST(ClientGroup_removeInCallback) {
+    connectAll();
+    UA_ReadValueId rvid;
+    UA_ReadValueId_init(&rvid);
+    rvid.attributeId = UA_ATTRIBUTEID_VALUE;
+    rvid.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE);
+    UA_ReadRequest request;
+    UA_ReadRequest_init(&request);
+    request.nodesToRead = &rvid;
+    request.nodesToReadSize = 1;
+    for(size_t i = 0; i < CLIENTS; i++) {
+        UA_StatusCode retval =
+            UA_Client_sendAsyncReadRequest(clients[i], &request, removeCallback,
+                                           &responses[i], NULL);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+    ck_assert_uint_eq(iterateUntilResponses(CLIENTS), CLIENTS);
+
+    /* All clients have left the group */
+    for(size_t i = 0; i < CLIENTS; i++) {
+        UA_StatusCode retval = UA_ClientGroup_remove(group, clients[i]);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_BADNOTFOUND);
+    }
+}
+END_TEST
+
+static Suite* testSuite_ClientGroup(void) {
+    Suite *s = suite_create("Client Group");
+    TCase *tc = tcase_create("Client Group");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, ClientGroup_connectAsync);
+    tcase_add_test(tc, ClientGroup_readAsync);
+    tcase_add_test(tc, ClientGroup_removeClients);
+    tcase_add_test(tc, ClientGroup_reconnect);
+    tcase_add_test(tc, ClientGroup_removeInCallback);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    Suite *s = testSuite_ClientGroup();
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
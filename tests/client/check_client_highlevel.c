@@ -7,6 +7,7 @@
 #include "ua_config_default.h"
 #include "ua_client_highlevel.h"
 #include "ua_network_tcp.h"
+#include "client/ua_client_internal.h"
 #include "check.h"
 #include "thread_wrapper.h"
 
@@ -1023,6 +1024,88 @@ END_TEST
 
 #endif
 
+static void setupReadPlan(void) {
+    running = true;
+    config = UA_ServerConfig_new_default();
+    config->maxNodesPerRead = 8;
+    server = UA_Server_new(config);
+    UA_Server_run_startup(server);
+    THREAD_CREATE(server_thread, serverloop);
+
+    client = UA_Client_new(UA_ClientConfig_default);
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+/* The reads are split according to the MaxNodesPerRead of the server */
+START_TEST(ReadPlan_maxNodesPerRead) {
+    UA_ClientReadPlan *plan = UA_ClientReadPlan_new(UA_TIMESTAMPSTORETURN_NEITHER);
+    ck_assert_ptr_ne(plan, NULL);
+    size_t idx[50];
+    for(size_t i = 0; i < 50; i++) {
+        UA_NodeId id = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE);
+        if(i % 5 == 0)
+            id = UA_NODEID_NUMERIC(1, (UA_UInt32)(20000 + i)); /* does not exist */
+        UA_StatusCode retval = UA_ClientReadPlan_add(plan, id, UA_ATTRIBUTEID_VALUE, &idx[i]);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(idx[i], i);
+    }
+
+    /* The plan is executed several times with the same encoded requests */
+    for(size_t round = 0; round < 3; round++) {
+        UA_StatusCode retval = UA_ClientReadPlan_execute(plan, client);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(UA_ClientReadPlan_getRequestsSize(plan), 7);
+        for(size_t i = 0; i < 50; i++) {
+            const UA_DataValue *dv = UA_ClientReadPlan_getResult(plan, idx[i]);
+            ck_assert_ptr_ne(dv, NULL);
+            if(i % 5 == 0) {
+                ck_assert_uint_eq(dv->status, UA_STATUSCODE_BADNODEIDUNKNOWN);
+            } else {
+                ck_assert(dv->hasValue);
+                ck_assert(UA_Variant_isScalar(&dv->value));
+            }
+        }
+    }
+    ck_assert_ptr_eq(UA_ClientReadPlan_getResult(plan, 50), NULL);
+    UA_ClientReadPlan_delete(plan);
+} END_TEST
+
+/* The reads are split to fit into the maximum message size */
+START_TEST(ReadPlan_maxMessageSize) {
+    client->connection.config.maxMessageSize = 8192;
+
+    char name[2001];
+    memset(name, 'x', sizeof(name) - 1);
+    name[sizeof(name) - 1] = 0;
+    UA_ClientReadPlan *plan = UA_ClientReadPlan_new(UA_TIMESTAMPSTORETURN_BOTH);
+    for(size_t i = 0; i < 100; i++) {
+        UA_StatusCode retval =
+            UA_ClientReadPlan_add(plan, UA_NODEID_STRING(1, name),
+                                  UA_ATTRIBUTEID_DISPLAYNAME, NULL);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+
+    /* Only three items of ~2kB fit into a message of 8kB. The OperationLimit
+     * of the server would allow 8 items per request. */
+    UA_StatusCode retval = UA_ClientReadPlan_prepare(plan, client);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(UA_ClientReadPlan_getRequestsSize(plan), 34);
+    retval = UA_ClientReadPlan_execute(plan, client);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    for(size_t i = 0; i < 100; i++)
+        ck_assert_uint_eq(UA_ClientReadPlan_getResult(plan, i)->status,
+                          UA_STATUSCODE_BADNODEIDUNKNOWN);
+
+    /* A limit below the message overhead leaves one item per request */
+    client->connection.config.maxMessageSize = 256;
+    retval = UA_ClientReadPlan_prepare(plan, client);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(UA_ClientReadPlan_getRequestsSize(plan), 100);
+    client->connection.config.maxMessageSize = 8192;
+    UA_ClientReadPlan_delete(plan);
+} END_TEST
+
 static Suite *testSuite_Client(void) {
     Suite *s = suite_create("Client Highlevel");
     TCase *tc_misc = tcase_create("Client Highlevel Misc");
@@ -1031,6 +1114,12 @@ static Suite *testSuite_Client(void) {
     tcase_add_test(tc_misc, Misc_NamespaceGetIndex);
     suite_add_tcase(s, tc_misc);
 
+    TCase *tc_readplan = tcase_create("Client Highlevel Read Planner");
+    tcase_add_checked_fixture(tc_readplan, setupReadPlan, teardown);
+    tcase_add_test(tc_readplan, ReadPlan_maxNodesPerRead);
+    tcase_add_test(tc_readplan, ReadPlan_maxMessageSize);
+    suite_add_tcase(s, tc_readplan);
+
     TCase *tc_nodes = tcase_create("Client Highlevel Node Management");
     tcase_add_checked_fixture(tc_nodes, setup, teardown);
 #ifdef UA_ENABLE_NODEMANAGEMENT
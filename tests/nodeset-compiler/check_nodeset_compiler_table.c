@@ -0,0 +1,227 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "check.h"
+#include "tests/ua_namespace_tests_table.h"
+#include "ua_config_default.h"
+#include "ua_server.h"
+#include "ua_types.h"
+
+UA_Server *server = NULL;
+UA_ServerConfig *config = NULL;
+static UA_UInt16 nsIndex;
+
+static void setup(void) {
+    config = UA_ServerConfig_new_default();
+    server = UA_Server_new(config);
+    /* The namespace of the table gets another index than in the nodeset */
+    UA_Server_addNamespace(server, "http://example.org/other/");
+    UA_StatusCode retval = ua_namespace_tests_table(server);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    size_t foundIndex = 0;
+    retval = UA_Server_getNamespaceByName(server, UA_STRING("http://example.org/table/"),
+                                          &foundIndex);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(foundIndex, 3);
+    nsIndex = (UA_UInt16)foundIndex;
+}
+
+static void teardown(void) {
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+}
+
+START_TEST(checkScalarValues) {
+    UA_Variant out;
+    UA_StatusCode retval = UA_Server_readValue(server, UA_NODEID_NUMERIC(nsIndex, 6001), &out);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&out, &UA_TYPES[UA_TYPES_INT32]));
+    ck_assert_int_eq(*(UA_Int32*)out.data, 42);
+    UA_Variant_clear(&out);
+
+    UA_String name = UA_STRING("Pump \"A\"");
+    retval = UA_Server_readValue(server, UA_NODEID_NUMERIC(nsIndex, 6002), &out);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&out, &UA_TYPES[UA_TYPES_STRING]));
+    ck_assert(UA_String_equal((UA_String*)out.data, &name));
+    UA_Variant_clear(&out);
+
+    UA_LocalizedText label = UA_LOCALIZEDTEXT("en", "Main pump");
+    retval = UA_Server_readValue(server, UA_NODEID_NUMERIC(nsIndex, 6003), &out);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&out, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]));
+    UA_LocalizedText *lt = (UA_LocalizedText*)out.data;
+    ck_assert(UA_String_equal(&lt->locale, &label.locale));
+    ck_assert(UA_String_equal(&lt->text, &label.text));
+    UA_Variant_clear(&out);
+
+    /* Variables without a value are default-initialized */
+    retval = UA_Server_readValue(server, UA_NODEID_NUMERIC(nsIndex, 6005), &out);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&out, &UA_TYPES[UA_TYPES_UINT32]));
+    ck_assert_uint_eq(*(UA_UInt32*)out.data, 0);
+    UA_Variant_clear(&out);
+
+    retval = UA_Server_readValue(server, UA_NODEID_NUMERIC(nsIndex, 6006), &out);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&out, &UA_TYPES[UA_TYPES_DOUBLE]));
+    ck_assert(*(UA_Double*)out.data == 2.5);
+    UA_Variant_clear(&out);
+}
+END_TEST
+
+START_TEST(checkArrayValues) {
+    UA_Variant out;
+    UA_StatusCode retval = UA_Server_readValue(server, UA_NODEID_NUMERIC(nsIndex, 6004), &out);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasArrayType(&out, &UA_TYPES[UA_TYPES_DOUBLE]));
+    ck_assert_uint_eq(out.arrayLength, 3);
+    UA_Double *d = (UA_Double*)out.data;
+    ck_assert(d[0] == 1.0);
+    ck_assert(d[1] == 2.5);
+    ck_assert(d[2] == -4.0);
+    UA_Variant_clear(&out);
+
+    retval = UA_Server_readArrayDimensions(server, UA_NODEID_NUMERIC(nsIndex, 6004), &out);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(out.arrayLength, 1);
+    ck_assert_uint_eq(*(UA_UInt32*)out.data, 3);
+    UA_Variant_clear(&out);
+}
+END_TEST
+
+START_TEST(checkStructureValues) {
+    /* The DataType of the argument is in the namespace of the table */
+    UA_Variant out;
+    UA_StatusCode retval = UA_Server_readValue(server, UA_NODEID_NUMERIC(nsIndex, 7002), &out);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasArrayType(&out, &UA_TYPES[UA_TYPES_ARGUMENT]));
+    ck_assert_uint_eq(out.arrayLength, 1);
+    UA_Argument *arg = (UA_Argument*)out.data;
+    UA_String name = UA_STRING("Level");
+    ck_assert(UA_String_equal(&arg->name, &name));
+    UA_NodeId dataType = UA_NODEID_NUMERIC(nsIndex, 3001);
+    ck_assert(UA_NodeId_equal(&arg->dataType, &dataType));
+    ck_assert_int_eq(arg->valueRank, -1);
+    ck_assert_uint_eq(arg->arrayDimensionsSize, 0);
+    UA_String text = UA_STRING("Reset level");
+    ck_assert(UA_String_equal(&arg->description.text, &text));
+    UA_Variant_clear(&out);
+}
+END_TEST
+
+START_TEST(checkNodes) {
+    UA_NodeId pump1 = UA_NODEID_STRING(nsIndex, "Pump1");
+    UA_QualifiedName browseName;
+    UA_StatusCode retval = UA_Server_readBrowseName(server, pump1, &browseName);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_QualifiedName expected = UA_QUALIFIEDNAME(nsIndex, "Pump1");
+    ck_assert(UA_QualifiedName_equal(&browseName, &expected));
+    UA_QualifiedName_clear(&browseName);
+
+    UA_Byte eventNotifier = 0;
+    retval = UA_Server_readEventNotifier(server, pump1, &eventNotifier);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(eventNotifier, 1);
+
+#ifdef UA_ENABLE_NODESET_COMPILER_DESCRIPTIONS
+    UA_LocalizedText description;
+    retval = UA_Server_readDescription(server, pump1, &description);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_String text = UA_STRING("The first pump");
+    ck_assert(UA_String_equal(&description.text, &text));
+    UA_LocalizedText_clear(&description);
+#endif
+
+    UA_Boolean isAbstract = false;
+    retval = UA_Server_readIsAbstract(server, UA_NODEID_NUMERIC(nsIndex, 1001), &isAbstract);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(isAbstract);
+
+    UA_LocalizedText inverseName;
+    retval = UA_Server_readInverseName(server, UA_NODEID_NUMERIC(nsIndex, 4001), &inverseName);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_String deviceOf = UA_STRING("DeviceOf");
+    ck_assert(UA_String_equal(&inverseName.text, &deviceOf));
+    UA_LocalizedText_clear(&inverseName);
+
+    UA_NodeClass nodeClass;
+    retval = UA_Server_readNodeClass(server, UA_NODEID_NUMERIC(nsIndex, 7001), &nodeClass);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(nodeClass, UA_NODECLASS_METHOD);
+}
+END_TEST
+
+START_TEST(checkReferences) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = UA_NODEID_STRING(nsIndex, "Pump1");
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.resultMask = UA_BROWSERESULTMASK_ALL;
+
+    /* The components of Pump1 */
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(br.referencesSize, 7);
+    UA_BrowseResult_clear(&br);
+
+    /* The type definition */
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
+    br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(br.referencesSize, 1);
+    UA_NodeId pumpType = UA_NODEID_NUMERIC(nsIndex, 1002);
+    ck_assert(UA_NodeId_equal(&br.references[0].nodeId.nodeId, &pumpType));
+    UA_BrowseResult_clear(&br);
+
+    /* The additional reference with a ReferenceType of the table */
+    bd.referenceTypeId = UA_NODEID_NUMERIC(nsIndex, 4001);
+    br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(br.referencesSize, 1);
+    UA_NodeId pump2 = UA_NODEID_STRING(nsIndex, "Pump2");
+    ck_assert(UA_NodeId_equal(&br.references[0].nodeId.nodeId, &pump2));
+    UA_BrowseResult_clear(&br);
+
+    /* The inverse direction was added as well */
+    bd.nodeId = pump2;
+    bd.browseDirection = UA_BROWSEDIRECTION_INVERSE;
+    br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(br.referencesSize, 1);
+    UA_BrowseResult_clear(&br);
+}
+END_TEST
+
+START_TEST(loadTwice) {
+    /* The nodes exist already */
+    UA_StatusCode retval = ua_namespace_tests_table(server);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADNODEIDEXISTS);
+}
+END_TEST
+
+static Suite *testSuite_Table(void) {
+    Suite *s = suite_create("Server Nodeset Compiler Table");
+    TCase *tc_server = tcase_create("Server Node Table");
+    tcase_add_checked_fixture(tc_server, setup, teardown);
+    tcase_add_test(tc_server, checkScalarValues);
+    tcase_add_test(tc_server, checkArrayValues);
+    tcase_add_test(tc_server, checkStructureValues);
+    tcase_add_test(tc_server, checkNodes);
+    tcase_add_test(tc_server, checkReferences);
+    tcase_add_test(tc_server, loadTwice);
+    suite_add_tcase(s, tc_server);
+    return s;
+}
+
+int main(void) {
+    Suite *s = testSuite_Table();
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,184 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "ua_server_pubsub.h"
+#include "ua_config_default.h"
+#include "ua_network_pubsub_ethernet.h"
+#include "ua_server_internal.h"
+
+/* The tests send and receive on the loopback interface by default. For a veth
+ * pair, the publishing end is set with the environment variable
+ * UA_PUBSUB_ETH_TEST_INTERFACE and the subscribing end with
+ * UA_PUBSUB_ETH_TEST_PEER. Packet sockets require CAP_NET_RAW. Without it the
+ * tests are skipped. */
+
+UA_Server *server = NULL;
+UA_ServerConfig *config = NULL;
+
+static void setup(void) {
+    config = UA_ServerConfig_new_default();
+    config->pubsubTransportLayers = (UA_PubSubTransportLayer *)
+        UA_malloc(sizeof(UA_PubSubTransportLayer));
+    config->pubsubTransportLayers[0] = UA_PubSubTransportLayerEthernet();
+    config->pubsubTransportLayersSize++;
+    server = UA_Server_new(config);
+}
+
+static void teardown(void) {
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+}
+
+static UA_PubSubChannel *
+addConnection(UA_Boolean packetMmap, UA_Boolean subscriber) {
+    char *interface = getenv("UA_PUBSUB_ETH_TEST_INTERFACE");
+    if(!interface)
+        interface = "lo";
+    char *peer = getenv("UA_PUBSUB_ETH_TEST_PEER");
+    if(subscriber && peer)
+        interface = peer;
+    UA_PubSubConnectionConfig connectionConfig;
+    memset(&connectionConfig, 0, sizeof(UA_PubSubConnectionConfig));
+    connectionConfig.name = UA_STRING("UADP Ethernet Connection");
+    UA_NetworkAddressUrlDataType networkAddressUrl =
+        {UA_STRING(interface), UA_STRING("opc.eth://01-00-5E-7F-00-01")};
+    UA_Variant_setScalar(&connectionConfig.address, &networkAddressUrl,
+                         &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+    connectionConfig.transportProfileUri =
+        UA_STRING("http://opcfoundation.org/UA-Profile/Transport/pubsub-eth-uadp");
+    UA_KeyValuePair property;
+    property.key = UA_QUALIFIEDNAME(0, "packetmmap");
+    UA_Variant_setScalar(&property.value, &packetMmap, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    connectionConfig.connectionProperties = &property;
+    connectionConfig.connectionPropertiesSize = 1;
+
+    UA_NodeId connectionId;
+    if(UA_Server_addPubSubConnection(server, &connectionConfig,
+                                     &connectionId) != UA_STATUSCODE_GOOD)
+        return NULL;
+    UA_PubSubConnection *connection =
+        UA_PubSubConnection_findConnectionbyId(server, connectionId);
+    ck_assert_ptr_ne(connection, NULL);
+    ck_assert_uint_eq(connection->channel->regist(connection->channel, NULL),
+                      UA_STATUSCODE_GOOD);
+    return connection->channel;
+}
+
+static void
+makeMessage(UA_Byte *data, size_t length, UA_Byte seed) {
+    for(size_t i = 0; i < length; i++)
+        data[i] = (UA_Byte)(seed + i);
+}
+
+/* Receive until the message with the given seed arrives. Frames of earlier
+ * tests or other senders on the interface are skipped. */
+static void
+receiveMessage(UA_PubSubChannel *channel, size_t length, UA_Byte seed) {
+    UA_Byte expected[64];
+    makeMessage(expected, length, seed);
+    UA_Byte data[1500];
+    for(size_t i = 0; i < 100; i++) {
+        UA_ByteString message = {sizeof(data), data};
+        UA_StatusCode retval = channel->receive(channel, &message, NULL, 100000);
+        ck_assert(retval == UA_STATUSCODE_GOOD || retval == UA_STATUSCODE_GOODNODATA ||
+                  retval == UA_STATUSCODE_GOODNONCRITICALTIMEOUT);
+        if(retval == UA_STATUSCODE_GOOD && message.length == length &&
+           memcmp(message.data, expected, length) == 0)
+            return;
+    }
+    ck_abort_msg("Message %u not received", (unsigned)seed);
+}
+
+static void
+sendMessages(UA_PubSubChannel *channel, size_t count, size_t length) {
+    UA_Byte data[16][64];
+    UA_ByteString bufs[16];
+    ck_assert_uint_le(count, 16);
+    for(size_t i = 0; i < count; i++) {
+        makeMessage(data[i], length, (UA_Byte)i);
+        bufs[i].data = data[i];
+        bufs[i].length = length;
+    }
+    UA_StatusCode retval;
+    if(channel->sendBatch) {
+        retval = channel->sendBatch(channel, NULL, bufs, count);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        return;
+    }
+    for(size_t i = 0; i < count; i++) {
+        retval = channel->send(channel, NULL, &bufs[i]);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+}
+
+START_TEST(Ring_sendReceive) {
+    UA_PubSubChannel *publisher = addConnection(true, false);
+    UA_PubSubChannel *subscriber = addConnection(true, true);
+    if(!publisher || !subscriber)
+        return;
+    ck_assert_ptr_ne(publisher->sendBatch, NULL);
+    sendMessages(publisher, 8, 32);
+    for(UA_Byte i = 0; i < 8; i++)
+        receiveMessage(subscriber, 32, i);
+} END_TEST
+
+START_TEST(Ring_plainInterop) {
+    UA_PubSubChannel *plainPublisher = addConnection(false, false);
+    UA_PubSubChannel *ringSubscriber = addConnection(true, true);
+    UA_PubSubChannel *ringPublisher = addConnection(true, false);
+    UA_PubSubChannel *plainSubscriber = addConnection(false, true);
+    if(!plainPublisher || !ringSubscriber || !ringPublisher || !plainSubscriber)
+        return;
+    ck_assert_ptr_eq(plainPublisher->sendBatch, NULL);
+    sendMessages(plainPublisher, 4, 40);
+    for(UA_Byte i = 0; i < 4; i++)
+        receiveMessage(ringSubscriber, 40, i);
+    sendMessages(ringPublisher, 4, 48);
+    for(UA_Byte i = 0; i < 4; i++)
+        receiveMessage(plainSubscriber, 48, i);
+} END_TEST
+
+/* More frames are sent than the TX ring has slots. The slots are reused after
+ * the kernel has sent the frames. */
+START_TEST(Ring_wrapAround) {
+    UA_PubSubChannel *publisher = addConnection(true, false);
+    if(!publisher)
+        return;
+    for(size_t i = 0; i < 100; i++)
+        sendMessages(publisher, 16, 64);
+} END_TEST
+
+START_TEST(Ring_messageTooLarge) {
+    UA_PubSubChannel *publisher = addConnection(true, false);
+    if(!publisher)
+        return;
+    UA_ByteString buf;
+    UA_ByteString_allocBuffer(&buf, 4000);
+    memset(buf.data, 0, buf.length);
+    UA_StatusCode retval = publisher->send(publisher, NULL, &buf);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED);
+    UA_ByteString_deleteMembers(&buf);
+} END_TEST
+
+int main(void) {
+    TCase *tc_ring = tcase_create("PubSub Ethernet packet rings");
+    tcase_add_checked_fixture(tc_ring, setup, teardown);
+    tcase_add_test(tc_ring, Ring_sendReceive);
+    tcase_add_test(tc_ring, Ring_plainInterop);
+    tcase_add_test(tc_ring, Ring_wrapAround);
+    tcase_add_test(tc_ring, Ring_messageTooLarge);
+
+    Suite *s = suite_create("PubSub Ethernet connection");
+    suite_add_tcase(s, tc_ring);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr,CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
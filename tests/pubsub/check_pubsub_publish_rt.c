@@ -0,0 +1,644 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <check.h>
+
+#include "ua_server_pubsub.h"
+#include "ua_types.h"
+#include "ua_pubsub.h"
+#include "ua_pubsub_networkmessage.h"
+#include "ua_config_default.h"
+#include "ua_network_pubsub_udp.h"
+#include "ua_server_internal.h"
+
+UA_Server *server = NULL;
+UA_ServerConfig *config = NULL;
+UA_NodeId connectionId, writerGroupId, publishedDataSetId;
+UA_PubSubConnection *connection;
+UA_StatusCode (*channelSend)(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+                             const UA_ByteString *buf);
+UA_StatusCode (*channelSendBatch)(UA_PubSubChannel *channel,
+                                  UA_ExtensionObject *transportSettings,
+                                  const UA_ByteString *bufs, size_t bufsSize);
+
+#define MAXMESSAGES 16
+UA_ByteString sent[MAXMESSAGES];
+size_t sentSize;
+size_t batchCount;
+
+static UA_StatusCode
+captureSend(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+            const UA_ByteString *buf) {
+    ck_assert_uint_lt(sentSize, MAXMESSAGES);
+    UA_ByteString_copy(buf, &sent[sentSize]);
+    sentSize++;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+captureSendBatch(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+                 const UA_ByteString *bufs, size_t bufsSize) {
+    for(size_t i = 0; i < bufsSize; i++)
+        captureSend(channel, transportSettings, &bufs[i]);
+    batchCount++;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+clearSent(void) {
+    for(size_t i = 0; i < sentSize; i++)
+        UA_ByteString_deleteMembers(&sent[i]);
+    sentSize = 0;
+}
+
+static void
+addVariable(char *name, const UA_Variant *value) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.value = *value;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", name);
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_StatusCode retval =
+        UA_Server_addVariableNode(server, UA_NODEID_STRING(1, name),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                  UA_QUALIFIEDNAME(1, name),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                  attr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static void
+writeInt32(char *name, UA_Int32 value) {
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &value, &UA_TYPES[UA_TYPES_INT32]);
+    UA_StatusCode retval = UA_Server_writeValue(server, UA_NODEID_STRING(1, name), v);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static void
+addField(char *name) {
+    UA_DataSetFieldConfig fieldConfig;
+    memset(&fieldConfig, 0, sizeof(UA_DataSetFieldConfig));
+    fieldConfig.dataSetFieldType = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    fieldConfig.field.variable.fieldNameAlias = UA_STRING(name);
+    fieldConfig.field.variable.publishParameters.publishedVariable = UA_NODEID_STRING(1, name);
+    fieldConfig.field.variable.publishParameters.attributeId = UA_ATTRIBUTEID_VALUE;
+    UA_DataSetFieldResult res =
+        UA_Server_addDataSetField(server, publishedDataSetId, &fieldConfig, NULL);
+    ck_assert_uint_eq(res.result, UA_STATUSCODE_GOOD);
+}
+
+static void
+addWriter(UA_UInt16 dataSetWriterId, UA_UInt32 keyFrameCount) {
+    UA_UadpDataSetWriterMessageDataType messageSettings;
+    memset(&messageSettings, 0, sizeof(UA_UadpDataSetWriterMessageDataType));
+    messageSettings.dataSetMessageContentMask = (UA_UadpDataSetMessageContentMask)
+        (UA_UADPDATASETMESSAGECONTENTMASK_SEQUENCENUMBER |
+         UA_UADPDATASETMESSAGECONTENTMASK_TIMESTAMP);
+
+    UA_DataSetWriterConfig writerConfig;
+    memset(&writerConfig, 0, sizeof(UA_DataSetWriterConfig));
+    writerConfig.name = UA_STRING("DataSetWriter");
+    writerConfig.dataSetWriterId = dataSetWriterId;
+    writerConfig.keyFrameCount = keyFrameCount;
+    writerConfig.messageSettings.encoding = UA_EXTENSIONOBJECT_DECODED;
+    writerConfig.messageSettings.content.decoded.type =
+        &UA_TYPES[UA_TYPES_UADPDATASETWRITERMESSAGEDATATYPE];
+    writerConfig.messageSettings.content.decoded.data = &messageSettings;
+    UA_StatusCode retval =
+        UA_Server_addDataSetWriter(server, writerGroupId, publishedDataSetId,
+                                   &writerConfig, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static void
+addWriterGroup(UA_PubSubRTLevel rtLevel) {
+    UA_WriterGroupConfig writerGroupConfig;
+    memset(&writerGroupConfig, 0, sizeof(UA_WriterGroupConfig));
+    writerGroupConfig.name = UA_STRING("WriterGroup");
+    writerGroupConfig.publishingInterval = 100000;
+    writerGroupConfig.encodingMimeType = UA_PUBSUB_ENCODING_UADP;
+    writerGroupConfig.maxEncapsulatedDataSetMessageCount = 2;
+    writerGroupConfig.rtLevel = rtLevel;
+    UA_StatusCode retval =
+        UA_Server_addWriterGroup(server, connectionId, &writerGroupConfig, &writerGroupId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static void setup(void) {
+    config = UA_ServerConfig_new_default();
+    config->pubsubTransportLayers = (UA_PubSubTransportLayer *)
+        UA_malloc(sizeof(UA_PubSubTransportLayer));
+    config->pubsubTransportLayers[0] = UA_PubSubTransportLayerUDPMP();
+    config->pubsubTransportLayersSize++;
+    server = UA_Server_new(config);
+
+    UA_PubSubConnectionConfig connectionConfig;
+    memset(&connectionConfig, 0, sizeof(UA_PubSubConnectionConfig));
+    connectionConfig.name = UA_STRING("UADP Connection");
+    UA_NetworkAddressUrlDataType networkAddressUrl =
+        {UA_STRING_NULL, UA_STRING("opc.udp://224.0.0.22:4840/")};
+    UA_Variant_setScalar(&connectionConfig.address, &networkAddressUrl,
+                         &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+    connectionConfig.transportProfileUri =
+        UA_STRING("http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp");
+    UA_StatusCode retval =
+        UA_Server_addPubSubConnection(server, &connectionConfig, &connectionId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* Capture the sent NetworkMessages */
+    connection = UA_PubSubConnection_findConnectionbyId(server, connectionId);
+    ck_assert_ptr_ne(connection, NULL);
+    channelSend = connection->channel->send;
+    connection->channel->send = captureSend;
+    channelSendBatch = connection->channel->sendBatch;
+    connection->channel->sendBatch = captureSendBatch;
+    sentSize = 0;
+    batchCount = 0;
+
+    UA_PublishedDataSetConfig pdsConfig;
+    memset(&pdsConfig, 0, sizeof(UA_PublishedDataSetConfig));
+    pdsConfig.publishedDataSetType = UA_PUBSUB_DATASET_PUBLISHEDITEMS;
+    pdsConfig.name = UA_STRING("PublishedDataSet");
+    UA_Server_addPublishedDataSet(server, &pdsConfig, &publishedDataSetId);
+
+    UA_Int32 i = 0;
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &i, &UA_TYPES[UA_TYPES_INT32]);
+    addVariable("a", &v);
+    addVariable("b", &v);
+    UA_String s = UA_STRING("short");
+    UA_Variant_setScalar(&v, &s, &UA_TYPES[UA_TYPES_STRING]);
+    addVariable("s", &v);
+}
+
+static void teardown(void) {
+    clearSent();
+    connection->channel->send = channelSend;
+    connection->channel->sendBatch = channelSendBatch;
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+}
+
+/* Decode the n-th sent NetworkMessage */
+static void
+decodeSent(size_t n, UA_NetworkMessage *nm) {
+    ck_assert_uint_gt(sentSize, n);
+    size_t offset = 0;
+    memset(nm, 0, sizeof(UA_NetworkMessage));
+    UA_StatusCode retval = UA_NetworkMessage_decodeBinary(&sent[n], &offset, nm);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(offset, sent[n].length);
+}
+
+static UA_Int32
+fieldInt32(UA_NetworkMessage *nm, size_t dsmIndex, size_t fieldIndex) {
+    UA_DataSetMessage *dsm = &nm->payload.dataSetPayload.dataSetMessages[dsmIndex];
+    ck_assert_uint_eq(dsm->header.dataSetMessageType, UA_DATASETMESSAGE_DATAKEYFRAME);
+    UA_Variant *v = &dsm->data.keyFrameData.dataSetFields[fieldIndex].value;
+    ck_assert(UA_Variant_hasScalarType(v, &UA_TYPES[UA_TYPES_INT32]));
+    return *(UA_Int32*)v->data;
+}
+
+static UA_WriterGroup *
+writerGroup(void) {
+    UA_WriterGroup *wg = UA_WriterGroup_findWGbyId(server, writerGroupId);
+    ck_assert_ptr_ne(wg, NULL);
+    return wg;
+}
+
+/* The values and sequence numbers are patched into the frozen message */
+START_TEST(FixedSize_patchValues) {
+    addWriterGroup(UA_PUBSUB_RT_FIXED_SIZE);
+    addField("a");
+    addField("b");
+    addWriter(1, 10);
+    addWriter(2, 10);
+
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 1);
+    UA_Byte *templateData = writerGroup()->templates[0].buffer.data;
+
+    for(UA_Int32 round = 1; round <= 5; round++) {
+        writeInt32("a", round);
+        writeInt32("b", -round);
+        UA_WriterGroup_publishCallback(server, writerGroup());
+    }
+
+    /* The template was not rebuilt */
+    ck_assert_uint_eq(writerGroup()->templatesSize, 1);
+    ck_assert_ptr_eq(writerGroup()->templates[0].buffer.data, templateData);
+
+    ck_assert_uint_eq(sentSize, 6);
+    for(size_t n = 0; n < sentSize; n++) {
+        UA_NetworkMessage nm;
+        decodeSent(n, &nm);
+        ck_assert_uint_eq(nm.payloadHeader.dataSetPayloadHeader.count, 2);
+        for(size_t i = 0; i < 2; i++) {
+            UA_DataSetMessage *dsm = &nm.payload.dataSetPayload.dataSetMessages[i];
+            ck_assert_uint_eq(dsm->header.dataSetMessageSequenceNr, n);
+            ck_assert(dsm->header.timestampEnabled);
+            /* The fields are inserted at the head of the PublishedDataSet */
+            ck_assert_int_eq(fieldInt32(&nm, i, 0), -(UA_Int32)n);
+            ck_assert_int_eq(fieldInt32(&nm, i, 1), (UA_Int32)n);
+        }
+        UA_NetworkMessage_deleteMembers(&nm);
+    }
+}
+END_TEST
+
+/* The template is rebuilt when the encoded size of a value changes */
+START_TEST(FixedSize_rebuildOnSizeChange) {
+    addWriterGroup(UA_PUBSUB_RT_FIXED_SIZE);
+    addField("s");
+    addWriter(1, 10);
+
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 1);
+    size_t length = writerGroup()->templates[0].buffer.length;
+
+    UA_String s = UA_STRING("a much longer string value");
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &s, &UA_TYPES[UA_TYPES_STRING]);
+    UA_StatusCode retval = UA_Server_writeValue(server, UA_NODEID_STRING(1, "s"), v);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+
+    ck_assert_uint_eq(sentSize, 2);
+    ck_assert_uint_eq(writerGroup()->templatesSize, 1);
+    ck_assert_uint_eq(writerGroup()->templates[0].buffer.length,
+                      length + s.length - strlen("short"));
+
+    UA_NetworkMessage nm;
+    decodeSent(1, &nm);
+    UA_DataSetMessage *dsm = &nm.payload.dataSetPayload.dataSetMessages[0];
+    ck_assert_uint_eq(dsm->header.dataSetMessageSequenceNr, 1);
+    UA_Variant *field = &dsm->data.keyFrameData.dataSetFields[0].value;
+    ck_assert(UA_Variant_hasScalarType(field, &UA_TYPES[UA_TYPES_STRING]));
+    ck_assert(UA_String_equal((UA_String*)field->data, &s));
+    UA_NetworkMessage_deleteMembers(&nm);
+}
+END_TEST
+
+/* Configuration changes remove the frozen messages */
+START_TEST(FixedSize_invalidateOnConfigChange) {
+    addWriterGroup(UA_PUBSUB_RT_FIXED_SIZE);
+    addField("a");
+    addWriter(1, 10);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 1);
+
+    addField("b");
+    ck_assert_uint_eq(writerGroup()->templatesSize, 0);
+    writeInt32("b", 42);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 1);
+
+    addWriter(2, 10);
+    ck_assert_uint_eq(writerGroup()->templatesSize, 0);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 1);
+
+    ck_assert_uint_eq(sentSize, 3);
+    UA_NetworkMessage nm;
+    decodeSent(2, &nm);
+    ck_assert_uint_eq(nm.payloadHeader.dataSetPayloadHeader.count, 2);
+    ck_assert_int_eq(fieldInt32(&nm, 0, 0), 42);
+    ck_assert_int_eq(fieldInt32(&nm, 1, 0), 42);
+    UA_NetworkMessage_deleteMembers(&nm);
+
+    /* Disable the fixed-size mode */
+    UA_WriterGroupConfig writerGroupConfig;
+    UA_StatusCode retval =
+        UA_Server_getWriterGroupConfig(server, writerGroupId, &writerGroupConfig);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    writerGroupConfig.rtLevel = UA_PUBSUB_RT_NONE;
+    retval = UA_Server_updateWriterGroupConfig(server, writerGroupId, &writerGroupConfig);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_WriterGroupConfig_deleteMembers(&writerGroupConfig);
+    ck_assert_uint_eq(writerGroup()->templatesSize, 0);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 0);
+    ck_assert_uint_eq(sentSize, 4);
+}
+END_TEST
+
+/* Without the fixed-size mode, no templates are created */
+START_TEST(NoRT_noTemplates) {
+    addWriterGroup(UA_PUBSUB_RT_NONE);
+    addField("a");
+    addWriter(1, 10);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 0);
+    ck_assert_uint_eq(sentSize, 2);
+}
+END_TEST
+
+/* Application-owned values published without the nodestore */
+UA_Int32 externalData[2];
+UA_DataValue externalValues[2];
+UA_UInt32 externalSequence;
+
+static void
+addExternalField(size_t i, volatile UA_UInt32 *sequenceCounter) {
+    UA_DataValue_init(&externalValues[i]);
+    UA_Variant_setScalar(&externalValues[i].value, &externalData[i],
+                         &UA_TYPES[UA_TYPES_INT32]);
+    externalValues[i].hasValue = true;
+
+    UA_DataSetFieldConfig fieldConfig;
+    memset(&fieldConfig, 0, sizeof(UA_DataSetFieldConfig));
+    fieldConfig.dataSetFieldType = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    fieldConfig.field.variable.fieldNameAlias = UA_STRING("external");
+    fieldConfig.field.variable.externalValue.enabled = true;
+    fieldConfig.field.variable.externalValue.value = &externalValues[i];
+    fieldConfig.field.variable.externalValue.sequenceCounter = sequenceCounter;
+    UA_DataSetFieldResult res =
+        UA_Server_addDataSetField(server, publishedDataSetId, &fieldConfig, NULL);
+    ck_assert_uint_eq(res.result, UA_STATUSCODE_GOOD);
+}
+
+static void
+checkExternalValues(UA_Int32 expected0, UA_Int32 expected1) {
+    UA_NetworkMessage nm;
+    decodeSent(sentSize - 1, &nm);
+    ck_assert_int_eq(fieldInt32(&nm, 0, 0), expected1);
+    ck_assert_int_eq(fieldInt32(&nm, 0, 1), expected0);
+    UA_NetworkMessage_deleteMembers(&nm);
+}
+
+/* The NetworkMessages of a cycle are sent with a single call to the channel.
+ * The send buffers are reused between cycles. */
+START_TEST(SendQueue_oneBatchPerCycle) {
+    addWriterGroup(UA_PUBSUB_RT_NONE);
+    addField("a");
+    addWriter(1, 0);
+    addWriter(2, 0);
+    addWriter(3, 0);
+
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(batchCount, 1);
+    ck_assert_uint_eq(sentSize, 2);
+    ck_assert_uint_eq(writerGroup()->sendQueueSize, 0);
+    ck_assert_uint_ge(writerGroup()->sendBuffersSize, 2);
+    UA_Byte *bufferData = writerGroup()->sendBuffers[0].data;
+
+    writeInt32("a", 42);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(batchCount, 2);
+    ck_assert_uint_eq(sentSize, 4);
+    ck_assert_ptr_eq(writerGroup()->sendBuffers[0].data, bufferData);
+
+    UA_NetworkMessage nm;
+    decodeSent(2, &nm);
+    ck_assert_uint_eq(nm.payloadHeader.dataSetPayloadHeader.count, 2);
+    ck_assert_int_eq(fieldInt32(&nm, 0, 0), 42);
+    UA_NetworkMessage_deleteMembers(&nm);
+    decodeSent(3, &nm);
+    ck_assert_uint_eq(nm.payloadHeader.dataSetPayloadHeader.count, 1);
+    ck_assert_int_eq(fieldInt32(&nm, 0, 0), 42);
+    UA_NetworkMessage_deleteMembers(&nm);
+}
+END_TEST
+
+/* The frozen NetworkMessages are sent as one batch as well */
+START_TEST(SendQueue_fixedSizeBatch) {
+    addWriterGroup(UA_PUBSUB_RT_FIXED_SIZE);
+    addField("a");
+    addWriter(1, 10);
+    addWriter(2, 10);
+    addWriter(3, 10);
+
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 2);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(batchCount, 2);
+    ck_assert_uint_eq(sentSize, 4);
+}
+END_TEST
+
+/* Without sendBatch, every NetworkMessage is sent individually */
+START_TEST(SendQueue_noBatchSupport) {
+    connection->channel->sendBatch = NULL;
+    addWriterGroup(UA_PUBSUB_RT_NONE);
+    addField("a");
+    addWriter(1, 0);
+    addWriter(2, 0);
+    addWriter(3, 0);
+
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(batchCount, 0);
+    ck_assert_uint_eq(sentSize, 2);
+}
+END_TEST
+
+/* The UDP channel sends more messages than fit into one system call */
+START_TEST(SendQueue_udpSendBatch) {
+    if(!channelSendBatch)
+        return; /* Not supported on this platform */
+    UA_Byte data[100][8];
+    UA_ByteString bufs[100];
+    for(size_t i = 0; i < 100; i++) {
+        memset(data[i], (int)i, sizeof(data[i]));
+        bufs[i].data = data[i];
+        bufs[i].length = sizeof(data[i]);
+    }
+    UA_StatusCode retval = channelSendBatch(connection->channel, NULL, bufs, 100);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+END_TEST
+
+START_TEST(ExternalValue_invalid) {
+    UA_DataSetFieldConfig fieldConfig;
+    memset(&fieldConfig, 0, sizeof(UA_DataSetFieldConfig));
+    fieldConfig.dataSetFieldType = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    fieldConfig.field.variable.externalValue.enabled = true;
+    UA_DataSetFieldResult res =
+        UA_Server_addDataSetField(server, publishedDataSetId, &fieldConfig, NULL);
+    ck_assert_uint_eq(res.result, UA_STATUSCODE_BADINVALIDARGUMENT);
+}
+END_TEST
+
+START_TEST(ExternalValue_publish) {
+    addWriterGroup(UA_PUBSUB_RT_NONE);
+    addExternalField(0, NULL);
+    addExternalField(1, NULL);
+    addWriter(1, 0); /* Only KeyFrames */
+
+    for(UA_Int32 round = 0; round < 3; round++) {
+        externalData[0] = round;
+        externalData[1] = 100 + round;
+        UA_WriterGroup_publishCallback(server, writerGroup());
+        checkExternalValues(round, 100 + round);
+    }
+}
+END_TEST
+
+/* External values are encoded directly into the frozen message */
+START_TEST(ExternalValue_fixedSize) {
+    addWriterGroup(UA_PUBSUB_RT_FIXED_SIZE);
+    externalSequence = 0;
+    addExternalField(0, &externalSequence);
+    addExternalField(1, &externalSequence);
+    addWriter(1, 10);
+
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(writerGroup()->templatesSize, 1);
+    UA_Byte *templateData = writerGroup()->templates[0].buffer.data;
+
+    for(UA_Int32 round = 1; round < 5; round++) {
+        UA_DataSetFieldExternalValue_beginUpdate(&externalSequence);
+        externalData[0] = round;
+        externalData[1] = -round;
+        UA_DataSetFieldExternalValue_endUpdate(&externalSequence);
+        UA_WriterGroup_publishCallback(server, writerGroup());
+        checkExternalValues(round, -round);
+    }
+    ck_assert_uint_eq(externalSequence, 8);
+    ck_assert_ptr_eq(writerGroup()->templates[0].buffer.data, templateData);
+
+    /* No consistent value while an update is in progress. The field is sent
+     * with a bad status instead. */
+    UA_DataSetFieldExternalValue_beginUpdate(&externalSequence);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    UA_DataSetFieldExternalValue_endUpdate(&externalSequence);
+    UA_NetworkMessage nm;
+    decodeSent(sentSize - 1, &nm);
+    UA_DataSetMessage *dsm = &nm.payload.dataSetPayload.dataSetMessages[0];
+    ck_assert(UA_Variant_isEmpty(&dsm->data.keyFrameData.dataSetFields[0].value));
+    UA_NetworkMessage_deleteMembers(&nm);
+}
+END_TEST
+
+#ifdef UA_ENABLE_PUBSUB_DELTAFRAMES
+/* Returns the number of fields in the DeltaFrame of the last message. The
+ * index of the first changed field is returned in fieldIndex. */
+static UA_UInt16
+lastDeltaFrame(UA_UInt16 *fieldIndex) {
+    UA_NetworkMessage nm;
+    decodeSent(sentSize - 1, &nm);
+    UA_DataSetMessage *dsm = &nm.payload.dataSetPayload.dataSetMessages[0];
+    ck_assert_uint_eq(dsm->header.dataSetMessageType, UA_DATASETMESSAGE_DATADELTAFRAME);
+    UA_UInt16 count = dsm->data.deltaFrameData.fieldCount;
+    if(count > 0)
+        *fieldIndex = dsm->data.deltaFrameData.deltaFrameFields[0].fieldIndex;
+    UA_NetworkMessage_deleteMembers(&nm);
+    return count;
+}
+
+START_TEST(DeltaFrame_changedFields) {
+    addWriterGroup(UA_PUBSUB_RT_NONE);
+    addField("a");
+    addField("b");
+    addField("s");
+    addWriter(1, 10);
+
+    /* KeyFrame first. The fields are in the order s, b, a. */
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    UA_NetworkMessage nm;
+    decodeSent(0, &nm);
+    UA_DataSetMessage *dsm = &nm.payload.dataSetPayload.dataSetMessages[0];
+    ck_assert_uint_eq(dsm->header.dataSetMessageType, UA_DATASETMESSAGE_DATAKEYFRAME);
+    UA_NetworkMessage_deleteMembers(&nm);
+
+    UA_UInt16 fieldIndex = 0;
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(lastDeltaFrame(&fieldIndex), 0);
+
+    writeInt32("a", 5);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(lastDeltaFrame(&fieldIndex), 1);
+    ck_assert_uint_eq(fieldIndex, 2);
+
+    /* Writing the same value is no change */
+    writeInt32("a", 5);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(lastDeltaFrame(&fieldIndex), 0);
+
+    UA_String str = UA_STRING("shorT");
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &str, &UA_TYPES[UA_TYPES_STRING]);
+    UA_StatusCode retval = UA_Server_writeValue(server, UA_NODEID_STRING(1, "s"), v);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(lastDeltaFrame(&fieldIndex), 1);
+    ck_assert_uint_eq(fieldIndex, 0);
+
+    /* A different type with the same bytes is a change */
+    UA_UInt32 u = 5;
+    UA_Variant_setScalar(&v, &u, &UA_TYPES[UA_TYPES_UINT32]);
+    retval = UA_Server_writeValue(server, UA_NODEID_STRING(1, "a"), v);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(lastDeltaFrame(&fieldIndex), 1);
+    ck_assert_uint_eq(fieldIndex, 2);
+}
+END_TEST
+
+/* Fields with a sequence counter are only sampled after an update */
+START_TEST(DeltaFrame_externalSequence) {
+    addWriterGroup(UA_PUBSUB_RT_NONE);
+    externalSequence = 0;
+    addExternalField(0, &externalSequence);
+    addExternalField(1, NULL);
+    addWriter(1, 10);
+
+    UA_WriterGroup_publishCallback(server, writerGroup());
+
+    /* Updated without the sequence counter. Not detected. */
+    externalData[0] = 7;
+    UA_UInt16 fieldIndex = 0;
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(lastDeltaFrame(&fieldIndex), 0);
+
+    UA_DataSetFieldExternalValue_beginUpdate(&externalSequence);
+    externalData[0] = 8;
+    UA_DataSetFieldExternalValue_endUpdate(&externalSequence);
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(lastDeltaFrame(&fieldIndex), 1);
+    ck_assert_uint_eq(fieldIndex, 1);
+
+    /* The value without sequence counter is compared */
+    externalData[1] = 9;
+    UA_WriterGroup_publishCallback(server, writerGroup());
+    ck_assert_uint_eq(lastDeltaFrame(&fieldIndex), 1);
+    ck_assert_uint_eq(fieldIndex, 0);
+}
+END_TEST
+#endif
+
+int main(void) {
+    TCase *tc_rt = tcase_create("PubSub fixed-size publish");
+    tcase_add_checked_fixture(tc_rt, setup, teardown);
+    tcase_add_test(tc_rt, FixedSize_patchValues);
+    tcase_add_test(tc_rt, FixedSize_rebuildOnSizeChange);
+    tcase_add_test(tc_rt, FixedSize_invalidateOnConfigChange);
+    tcase_add_test(tc_rt, NoRT_noTemplates);
+    tcase_add_test(tc_rt, SendQueue_oneBatchPerCycle);
+    tcase_add_test(tc_rt, SendQueue_fixedSizeBatch);
+    tcase_add_test(tc_rt, SendQueue_noBatchSupport);
+    tcase_add_test(tc_rt, SendQueue_udpSendBatch);
+    tcase_add_test(tc_rt, ExternalValue_invalid);
+    tcase_add_test(tc_rt, ExternalValue_publish);
+    tcase_add_test(tc_rt, ExternalValue_fixedSize);
+
+    Suite *s = suite_create("PubSub RT publish");
+    suite_add_tcase(s, tc_rt);
+
+#ifdef UA_ENABLE_PUBSUB_DELTAFRAMES
+    TCase *tc_delta = tcase_create("PubSub DeltaFrames");
+    tcase_add_checked_fixture(tc_delta, setup, teardown);
+    tcase_add_test(tc_delta, DeltaFrame_changedFields);
+    tcase_add_test(tc_delta, DeltaFrame_externalSequence);
+    suite_add_tcase(s, tc_delta);
+#endif
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr,CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,327 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef _XOPEN_SOURCE
+# define _XOPEN_SOURCE 600 /* nanosleep */
+#endif
+
+#include <check.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "ua_server_pubsub.h"
+#include "ua_config_default.h"
+#include "ua_network_pubsub_udp.h"
+#include "ua_server_internal.h"
+#include "ua_pubsub_networkmessage.h"
+
+UA_Server *server = NULL;
+UA_ServerConfig *config = NULL;
+UA_NodeId connectionId, publishedDataSetId, writerGroupId;
+
+/* The external value published by the threads */
+UA_Int32 externalInt;
+UA_DataValue externalValue;
+volatile UA_UInt32 externalSequence;
+
+/* Captured by the publisher thread */
+pthread_mutex_t sentMutex = PTHREAD_MUTEX_INITIALIZER;
+size_t sentCount;
+UA_ByteString lastSent;
+
+static UA_StatusCode
+captureSend(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+            const UA_ByteString *buf) {
+    pthread_mutex_lock(&sentMutex);
+    UA_ByteString_deleteMembers(&lastSent);
+    UA_ByteString_copy(buf, &lastSent);
+    sentCount++;
+    pthread_mutex_unlock(&sentMutex);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+captureSendBatch(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+                 const UA_ByteString *bufs, size_t bufsSize) {
+    for(size_t i = 0; i < bufsSize; i++)
+        captureSend(channel, transportSettings, &bufs[i]);
+    return UA_STATUSCODE_GOOD;
+}
+
+static size_t
+getSentCount(void) {
+    pthread_mutex_lock(&sentMutex);
+    size_t count = sentCount;
+    pthread_mutex_unlock(&sentMutex);
+    return count;
+}
+
+/* The tests wait in real time for the publisher thread */
+static void
+sleepMs(long ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000;
+    nanosleep(&ts, NULL);
+}
+
+static UA_Int64
+nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UA_Int64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* The thread may be scheduled late on a loaded machine. Wait for progress
+ * instead of asserting on the cycles of a fixed time window. */
+#define WAITTIMEOUTMS 5000
+
+static void
+waitForSent(size_t count) {
+    UA_Int64 deadline = nowMs() + WAITTIMEOUTMS;
+    while(getSentCount() < count && nowMs() < deadline)
+        sleepMs(1);
+    ck_assert_uint_ge(getSentCount(), count);
+}
+
+static void
+waitForCycles(UA_UInt64 cycles, UA_WriterGroupThreadStatistics *stats) {
+    UA_Int64 deadline = nowMs() + WAITTIMEOUTMS;
+    do {
+        UA_StatusCode retval =
+            UA_Server_getWriterGroupThreadStatistics(server, writerGroupId, stats);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        if(stats->cycles >= cycles)
+            return;
+        sleepMs(1);
+    } while(nowMs() < deadline);
+    ck_assert_uint_ge(stats->cycles, cycles);
+}
+
+static void
+addField(UA_Boolean external) {
+    UA_DataSetFieldConfig fieldConfig;
+    memset(&fieldConfig, 0, sizeof(UA_DataSetFieldConfig));
+    fieldConfig.dataSetFieldType = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    fieldConfig.field.variable.fieldNameAlias = UA_STRING("Server localtime");
+    fieldConfig.field.variable.publishParameters.publishedVariable =
+        UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_CURRENTTIME);
+    fieldConfig.field.variable.publishParameters.attributeId = UA_ATTRIBUTEID_VALUE;
+    if(external) {
+        fieldConfig.field.variable.externalValue.enabled = true;
+        fieldConfig.field.variable.externalValue.value = &externalValue;
+        fieldConfig.field.variable.externalValue.sequenceCounter = &externalSequence;
+    }
+    UA_DataSetFieldResult res =
+        UA_Server_addDataSetField(server, publishedDataSetId, &fieldConfig, NULL);
+    ck_assert_uint_eq(res.result, UA_STATUSCODE_GOOD);
+}
+
+static UA_NodeId
+addWriter(void) {
+    UA_DataSetWriterConfig writerConfig;
+    memset(&writerConfig, 0, sizeof(UA_DataSetWriterConfig));
+    writerConfig.name = UA_STRING("DataSetWriter");
+    writerConfig.dataSetWriterId = 1;
+    UA_NodeId writerId;
+    UA_StatusCode retval =
+        UA_Server_addDataSetWriter(server, writerGroupId, publishedDataSetId,
+                                   &writerConfig, &writerId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    return writerId;
+}
+
+static void setup(void) {
+    config = UA_ServerConfig_new_default();
+    config->pubsubTransportLayers = (UA_PubSubTransportLayer *)
+        UA_malloc(sizeof(UA_PubSubTransportLayer));
+    config->pubsubTransportLayers[0] = UA_PubSubTransportLayerUDPMP();
+    config->pubsubTransportLayersSize++;
+    server = UA_Server_new(config);
+
+    UA_PubSubConnectionConfig connectionConfig;
+    memset(&connectionConfig, 0, sizeof(UA_PubSubConnectionConfig));
+    connectionConfig.name = UA_STRING("UADP Connection");
+    UA_NetworkAddressUrlDataType networkAddressUrl =
+        {UA_STRING_NULL, UA_STRING("opc.udp://224.0.0.22:4840/")};
+    UA_Variant_setScalar(&connectionConfig.address, &networkAddressUrl,
+                         &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+    connectionConfig.transportProfileUri =
+        UA_STRING("http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp");
+    UA_Server_addPubSubConnection(server, &connectionConfig, &connectionId);
+
+    /* Capture the messages before the publisher thread starts */
+    UA_PubSubConnection *connection =
+        UA_PubSubConnection_findConnectionbyId(server, connectionId);
+    ck_assert_ptr_ne(connection, NULL);
+    connection->channel->send = captureSend;
+    connection->channel->sendBatch = captureSendBatch;
+    sentCount = 0;
+    UA_ByteString_init(&lastSent);
+
+    UA_PublishedDataSetConfig pdsConfig;
+    memset(&pdsConfig, 0, sizeof(UA_PublishedDataSetConfig));
+    pdsConfig.publishedDataSetType = UA_PUBSUB_DATASET_PUBLISHEDITEMS;
+    pdsConfig.name = UA_STRING("PublishedDataSet");
+    UA_Server_addPublishedDataSet(server, &pdsConfig, &publishedDataSetId);
+
+    externalInt = 0;
+    externalSequence = 0;
+    UA_DataValue_init(&externalValue);
+    UA_Variant_setScalar(&externalValue.value, &externalInt, &UA_TYPES[UA_TYPES_INT32]);
+    externalValue.hasValue = true;
+
+    UA_WriterGroupConfig writerGroupConfig;
+    memset(&writerGroupConfig, 0, sizeof(UA_WriterGroupConfig));
+    writerGroupConfig.name = UA_STRING("WriterGroup");
+    writerGroupConfig.publishingInterval = 2;
+    writerGroupConfig.encodingMimeType = UA_PUBSUB_ENCODING_UADP;
+    writerGroupConfig.publisherThread.enabled = true;
+    writerGroupConfig.publisherThread.clock = UA_PUBSUB_CLOCK_MONOTONIC;
+    UA_StatusCode retval =
+        UA_Server_addWriterGroup(server, connectionId, &writerGroupConfig, &writerGroupId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static void teardown(void) {
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+    UA_ByteString_deleteMembers(&lastSent);
+}
+
+START_TEST(Thread_publishes) {
+    addField(true);
+    addWriter();
+    waitForSent(10);
+
+    UA_WriterGroupThreadStatistics stats;
+    waitForCycles(10, &stats);
+    ck_assert_uint_eq(stats.skippedCycles, 0);
+    ck_assert_int_ge(stats.minWakeupLatency, 0);
+    ck_assert_int_le(stats.minWakeupLatency, stats.maxWakeupLatency);
+    ck_assert_int_ge(stats.maxCycleTime, stats.minWakeupLatency);
+
+    /* No more messages after the WriterGroup is removed */
+    UA_StatusCode retval = UA_Server_removeWriterGroup(server, writerGroupId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    size_t count = getSentCount();
+    sleepMs(20);
+    ck_assert_uint_eq(getSentCount(), count);
+} END_TEST
+
+/* The value is updated from the test thread with the seqlock while the
+ * publisher thread samples it */
+START_TEST(Thread_externalValue) {
+    addField(true);
+    addWriter();
+    for(UA_Int32 i = 1; i <= 50; i++) {
+        UA_DataSetFieldExternalValue_beginUpdate(&externalSequence);
+        externalInt = i;
+        UA_DataSetFieldExternalValue_endUpdate(&externalSequence);
+        sleepMs(1);
+    }
+    /* The second message after the update is sampled after the update */
+    waitForSent(getSentCount() + 2);
+
+    pthread_mutex_lock(&sentMutex);
+    UA_NetworkMessage nm;
+    size_t offset = 0;
+    UA_StatusCode retval = UA_NetworkMessage_decodeBinary(&lastSent, &offset, &nm);
+    pthread_mutex_unlock(&sentMutex);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(nm.payloadHeader.dataSetPayloadHeader.count, 1);
+    UA_DataSetMessage *dsm = &nm.payload.dataSetPayload.dataSetMessages[0];
+    ck_assert_uint_eq(dsm->header.dataSetMessageType, UA_DATASETMESSAGE_DATAKEYFRAME);
+    ck_assert_uint_eq(dsm->data.keyFrameData.fieldCount, 1);
+    UA_Variant *v = &dsm->data.keyFrameData.dataSetFields[0].value;
+    ck_assert(UA_Variant_hasScalarType(v, &UA_TYPES[UA_TYPES_INT32]));
+    ck_assert_int_eq(*(UA_Int32*)v->data, 50);
+    UA_NetworkMessage_deleteMembers(&nm);
+} END_TEST
+
+/* Fields that are read from the information model are not sampled from the
+ * publisher thread */
+START_TEST(Thread_skipsInformationModelFields) {
+    addField(false);
+    addWriter();
+
+    /* The thread already runs before the writer is added */
+    UA_WriterGroupThreadStatistics before;
+    UA_StatusCode retval =
+        UA_Server_getWriterGroupThreadStatistics(server, writerGroupId, &before);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_WriterGroupThreadStatistics stats;
+    waitForCycles(before.cycles + 10, &stats);
+    ck_assert_uint_gt(stats.skippedCycles, before.skippedCycles);
+    ck_assert_uint_eq(stats.skippedCycles - before.skippedCycles,
+                      stats.cycles - before.cycles);
+    ck_assert_uint_eq(getSentCount(), 0);
+} END_TEST
+
+/* The configuration is changed while the publisher thread runs */
+START_TEST(Thread_concurrentConfiguration) {
+    addField(true);
+    for(size_t i = 0; i < 100; i++) {
+        UA_NodeId writerId = addWriter();
+        addField(true);
+        ck_assert_uint_eq(UA_Server_removeDataSetWriter(server, writerId),
+                          UA_STATUSCODE_GOOD);
+        UA_NodeId_deleteMembers(&writerId);
+    }
+    addWriter();
+    waitForSent(1);
+} END_TEST
+
+START_TEST(Thread_updateInterval) {
+    addField(true);
+    addWriter();
+    UA_WriterGroupConfig writerGroupConfig;
+    UA_StatusCode retval = UA_Server_getWriterGroupConfig(server, writerGroupId, &writerGroupConfig);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    writerGroupConfig.publishingInterval = 50;
+    UA_Int64 start = nowMs();
+    retval = UA_Server_updateWriterGroupConfig(server, writerGroupId, &writerGroupConfig);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_WriterGroupConfig_deleteMembers(&writerGroupConfig);
+
+    /* The restarted thread publishes directly and then every 50ms. Cycles
+     * never run before their deadline. The millisecond clock may lose 1ms. */
+    UA_WriterGroupThreadStatistics stats;
+    waitForCycles(3, &stats);
+    UA_Int64 elapsed = nowMs() - start + 1;
+    ck_assert_uint_le(stats.cycles, (UA_UInt64)(elapsed / 50) + 1);
+} END_TEST
+
+START_TEST(Thread_removeConnection) {
+    addField(true);
+    addWriter();
+    sleepMs(10);
+    UA_StatusCode retval = UA_Server_removePubSubConnection(server, connectionId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    size_t count = getSentCount();
+    sleepMs(20);
+    ck_assert_uint_eq(getSentCount(), count);
+} END_TEST
+
+int main(void) {
+    TCase *tc_thread = tcase_create("PubSub publisher thread");
+    tcase_add_checked_fixture(tc_thread, setup, teardown);
+    tcase_add_test(tc_thread, Thread_publishes);
+    tcase_add_test(tc_thread, Thread_externalValue);
+    tcase_add_test(tc_thread, Thread_skipsInformationModelFields);
+    tcase_add_test(tc_thread, Thread_concurrentConfiguration);
+    tcase_add_test(tc_thread, Thread_updateInterval);
+    tcase_add_test(tc_thread, Thread_removeConnection);
+
+    Suite *s = suite_create("PubSub publisher threads");
+    suite_add_tcase(s, tc_thread);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr,CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
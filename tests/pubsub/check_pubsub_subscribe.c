@@ -0,0 +1,608 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <check.h>
+
+#include "ua_server_pubsub.h"
+#include "ua_types.h"
+#include "ua_pubsub.h"
+#include "ua_config_default.h"
+#include "ua_network_pubsub_udp.h"
+#include "ua_server_internal.h"
+#include "ua_types_generated_encoding_binary.h"
+
+UA_Server *server = NULL;
+UA_ServerConfig *config = NULL;
+UA_NodeId publisherConnectionId, subscriberConnectionId;
+UA_NodeId writerGroupId, readerGroupId, publishedDataSetId;
+UA_PubSubConnection *publisherConnection;
+UA_StatusCode (*channelSend)(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+                             const UA_ByteString *buf);
+UA_StatusCode (*channelSendBatch)(UA_PubSubChannel *channel,
+                                  UA_ExtensionObject *transportSettings,
+                                  const UA_ByteString *bufs, size_t bufsSize);
+
+#define PUBLISHERID 2234
+#define WRITERGROUPID 100
+
+#define MAXMESSAGES 16
+UA_ByteString sent[MAXMESSAGES];
+size_t sentSize;
+
+static UA_StatusCode
+captureSend(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+            const UA_ByteString *buf) {
+    ck_assert_uint_lt(sentSize, MAXMESSAGES);
+    UA_ByteString_copy(buf, &sent[sentSize]);
+    sentSize++;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+captureSendBatch(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+                 const UA_ByteString *bufs, size_t bufsSize) {
+    for(size_t i = 0; i < bufsSize; i++)
+        captureSend(channel, transportSettings, &bufs[i]);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+clearSent(void) {
+    for(size_t i = 0; i < sentSize; i++)
+        UA_ByteString_deleteMembers(&sent[i]);
+    sentSize = 0;
+}
+
+static void
+addVariable(char *name, const UA_Variant *value) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.value = *value;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", name);
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_StatusCode retval =
+        UA_Server_addVariableNode(server, UA_NODEID_STRING(1, name),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                  UA_QUALIFIEDNAME(1, name),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                  attr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static void
+writeInt32(char *name, UA_Int32 value) {
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &value, &UA_TYPES[UA_TYPES_INT32]);
+    UA_StatusCode retval = UA_Server_writeValue(server, UA_NODEID_STRING(1, name), v);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static UA_Int32
+readInt32(char *name) {
+    UA_Variant v;
+    UA_StatusCode retval = UA_Server_readValue(server, UA_NODEID_STRING(1, name), &v);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&v, &UA_TYPES[UA_TYPES_INT32]));
+    UA_Int32 value = *(UA_Int32*)v.data;
+    UA_Variant_deleteMembers(&v);
+    return value;
+}
+
+static void
+addField(char *name) {
+    UA_DataSetFieldConfig fieldConfig;
+    memset(&fieldConfig, 0, sizeof(UA_DataSetFieldConfig));
+    fieldConfig.dataSetFieldType = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    fieldConfig.field.variable.fieldNameAlias = UA_STRING(name);
+    fieldConfig.field.variable.publishParameters.publishedVariable = UA_NODEID_STRING(1, name);
+    fieldConfig.field.variable.publishParameters.attributeId = UA_ATTRIBUTEID_VALUE;
+    UA_DataSetFieldResult res =
+        UA_Server_addDataSetField(server, publishedDataSetId, &fieldConfig, NULL);
+    ck_assert_uint_eq(res.result, UA_STATUSCODE_GOOD);
+}
+
+static void
+addWriter(UA_UInt16 dataSetWriterId, UA_UInt32 keyFrameCount) {
+    UA_UadpDataSetWriterMessageDataType messageSettings;
+    memset(&messageSettings, 0, sizeof(UA_UadpDataSetWriterMessageDataType));
+    messageSettings.dataSetMessageContentMask = (UA_UadpDataSetMessageContentMask)
+        (UA_UADPDATASETMESSAGECONTENTMASK_SEQUENCENUMBER |
+         UA_UADPDATASETMESSAGECONTENTMASK_TIMESTAMP);
+
+    UA_DataSetWriterConfig writerConfig;
+    memset(&writerConfig, 0, sizeof(UA_DataSetWriterConfig));
+    writerConfig.name = UA_STRING("DataSetWriter");
+    writerConfig.dataSetWriterId = dataSetWriterId;
+    writerConfig.keyFrameCount = keyFrameCount;
+    writerConfig.messageSettings.encoding = UA_EXTENSIONOBJECT_DECODED;
+    writerConfig.messageSettings.content.decoded.type =
+        &UA_TYPES[UA_TYPES_UADPDATASETWRITERMESSAGEDATATYPE];
+    writerConfig.messageSettings.content.decoded.data = &messageSettings;
+    UA_StatusCode retval =
+        UA_Server_addDataSetWriter(server, writerGroupId, publishedDataSetId,
+                                   &writerConfig, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static UA_NodeId
+addConnection(void) {
+    UA_PubSubConnectionConfig connectionConfig;
+    memset(&connectionConfig, 0, sizeof(UA_PubSubConnectionConfig));
+    connectionConfig.name = UA_STRING("UADP Connection");
+    UA_NetworkAddressUrlDataType networkAddressUrl =
+        {UA_STRING_NULL, UA_STRING("opc.udp://224.0.0.22:4840/")};
+    UA_Variant_setScalar(&connectionConfig.address, &networkAddressUrl,
+                         &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+    connectionConfig.transportProfileUri =
+        UA_STRING("http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp");
+    connectionConfig.publisherId.numeric = PUBLISHERID;
+    UA_NodeId connectionId;
+    UA_StatusCode retval =
+        UA_Server_addPubSubConnection(server, &connectionConfig, &connectionId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    return connectionId;
+}
+
+static void setup(void) {
+    config = UA_ServerConfig_new_default();
+    config->pubsubTransportLayers = (UA_PubSubTransportLayer *)
+        UA_malloc(sizeof(UA_PubSubTransportLayer));
+    config->pubsubTransportLayers[0] = UA_PubSubTransportLayerUDPMP();
+    config->pubsubTransportLayersSize++;
+    server = UA_Server_new(config);
+
+    publisherConnectionId = addConnection();
+    subscriberConnectionId = addConnection();
+
+    /* Capture the sent NetworkMessages */
+    publisherConnection = UA_PubSubConnection_findConnectionbyId(server, publisherConnectionId);
+    ck_assert_ptr_ne(publisherConnection, NULL);
+    channelSend = publisherConnection->channel->send;
+    publisherConnection->channel->send = captureSend;
+    channelSendBatch = publisherConnection->channel->sendBatch;
+    publisherConnection->channel->sendBatch = captureSendBatch;
+    sentSize = 0;
+
+    UA_PublishedDataSetConfig pdsConfig;
+    memset(&pdsConfig, 0, sizeof(UA_PublishedDataSetConfig));
+    pdsConfig.publishedDataSetType = UA_PUBSUB_DATASET_PUBLISHEDITEMS;
+    pdsConfig.name = UA_STRING("PublishedDataSet");
+    UA_Server_addPublishedDataSet(server, &pdsConfig, &publishedDataSetId);
+
+    UA_Int32 i = 0;
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &i, &UA_TYPES[UA_TYPES_INT32]);
+    addVariable("a", &v);
+    addVariable("b", &v);
+    addVariable("ta", &v);
+    addVariable("tb", &v);
+    UA_String s = UA_STRING("short");
+    UA_Variant_setScalar(&v, &s, &UA_TYPES[UA_TYPES_STRING]);
+    addVariable("s", &v);
+    addVariable("ts", &v);
+
+    /* The fields are encoded in reverse order of their creation */
+    addField("b");
+    addField("a");
+
+    UA_WriterGroupConfig writerGroupConfig;
+    memset(&writerGroupConfig, 0, sizeof(UA_WriterGroupConfig));
+    writerGroupConfig.name = UA_STRING("WriterGroup");
+    writerGroupConfig.writerGroupId = WRITERGROUPID;
+    writerGroupConfig.publishingInterval = 100000;
+    writerGroupConfig.encodingMimeType = UA_PUBSUB_ENCODING_UADP;
+    writerGroupConfig.maxEncapsulatedDataSetMessageCount = 2;
+    UA_StatusCode retval =
+        UA_Server_addWriterGroup(server, publisherConnectionId, &writerGroupConfig,
+                                 &writerGroupId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_ReaderGroupConfig readerGroupConfig;
+    memset(&readerGroupConfig, 0, sizeof(UA_ReaderGroupConfig));
+    readerGroupConfig.name = UA_STRING("ReaderGroup");
+    readerGroupConfig.subscribingInterval = 100000;
+    retval = UA_Server_addReaderGroup(server, subscriberConnectionId, &readerGroupConfig,
+                                      &readerGroupId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static void teardown(void) {
+    clearSent();
+    publisherConnection->channel->send = channelSend;
+    publisherConnection->channel->sendBatch = channelSendBatch;
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+}
+
+static UA_ReaderGroup *
+readerGroup(void) {
+    UA_ReaderGroup *rg = UA_ReaderGroup_findRGbyId(server, readerGroupId);
+    ck_assert_ptr_ne(rg, NULL);
+    return rg;
+}
+
+static void
+addReader(UA_UInt16 dataSetWriterId, UA_PubSubRTLevel rtLevel,
+          UA_DataSetReaderTarget *targets, size_t targetsSize) {
+    UA_DataSetReaderConfig readerConfig;
+    memset(&readerConfig, 0, sizeof(UA_DataSetReaderConfig));
+    readerConfig.name = UA_STRING("DataSetReader");
+    readerConfig.dataSetWriterId = dataSetWriterId;
+    readerConfig.targetVariables = targets;
+    readerConfig.targetVariablesSize = targetsSize;
+    readerConfig.rtLevel = rtLevel;
+    UA_StatusCode retval =
+        UA_Server_addDataSetReader(server, readerGroupId, &readerConfig, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+static void
+addIntReader(UA_UInt16 dataSetWriterId, UA_PubSubRTLevel rtLevel) {
+    UA_DataSetReaderTarget targets[2];
+    memset(targets, 0, sizeof(targets));
+    targets[0].targetNodeId = UA_NODEID_STRING(1, "ta");
+    targets[1].targetNodeId = UA_NODEID_STRING(1, "tb");
+    addReader(dataSetWriterId, rtLevel, targets, 2);
+}
+
+/* Publish one cycle and hand the NetworkMessage to the ReaderGroup */
+static UA_StatusCode
+publishAndProcess(void) {
+    clearSent();
+    UA_WriterGroup_publishCallback(server, UA_WriterGroup_findWGbyId(server, writerGroupId));
+    ck_assert_uint_eq(sentSize, 1);
+    return UA_ReaderGroup_processNetworkMessage(server, readerGroup(), &sent[0]);
+}
+
+START_TEST(Subscribe_keyFrame) {
+    addWriter(1, 0);
+    addIntReader(1, UA_PUBSUB_RT_NONE);
+    writeInt32("a", 5);
+    writeInt32("b", 7);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(readInt32("ta"), 5);
+    ck_assert_int_eq(readInt32("tb"), 7);
+    ck_assert_uint_eq(readerGroup()->layoutsSize, 0);
+} END_TEST
+
+/* Messages of other DataSetWriters are dropped after the header */
+START_TEST(Subscribe_filterWriterId) {
+    addWriter(1, 0);
+    addIntReader(2, UA_PUBSUB_RT_NONE);
+    writeInt32("a", 5);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOODNODATA);
+    ck_assert_int_eq(readInt32("ta"), 0);
+} END_TEST
+
+static void
+addFilteredReader(const UA_Variant *publisherId, UA_UInt16 wgId) {
+    UA_DataSetReaderTarget target;
+    memset(&target, 0, sizeof(UA_DataSetReaderTarget));
+    target.targetNodeId = UA_NODEID_STRING(1, "ta");
+    UA_DataSetReaderConfig readerConfig;
+    memset(&readerConfig, 0, sizeof(UA_DataSetReaderConfig));
+    readerConfig.name = UA_STRING("DataSetReader");
+    readerConfig.publisherId = *publisherId;
+    readerConfig.writerGroupId = wgId;
+    readerConfig.dataSetWriterId = 1;
+    readerConfig.targetVariables = &target;
+    readerConfig.targetVariablesSize = 1;
+    UA_NodeId readerId;
+    UA_StatusCode retval =
+        UA_Server_addDataSetReader(server, readerGroupId, &readerConfig, &readerId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+}
+
+START_TEST(Subscribe_filterHeader) {
+    addWriter(1, 0);
+    writeInt32("a", 5);
+    UA_UInt32 publisherId = PUBLISHERID + 1;
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &publisherId, &UA_TYPES[UA_TYPES_UINT32]);
+    addFilteredReader(&v, 0);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOODNODATA);
+
+    UA_Variant_init(&v);
+    addFilteredReader(&v, WRITERGROUPID + 1);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOODNODATA);
+    ck_assert_int_eq(readInt32("ta"), 0);
+
+    publisherId = PUBLISHERID;
+    UA_Variant_setScalar(&v, &publisherId, &UA_TYPES[UA_TYPES_UINT32]);
+    addFilteredReader(&v, WRITERGROUPID);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(readInt32("ta"), 5);
+} END_TEST
+
+START_TEST(Subscribe_invalidPublisherId) {
+    UA_Double publisherId = 1.0;
+    UA_DataSetReaderConfig readerConfig;
+    memset(&readerConfig, 0, sizeof(UA_DataSetReaderConfig));
+    UA_Variant_setScalar(&readerConfig.publisherId, &publisherId, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_StatusCode retval =
+        UA_Server_addDataSetReader(server, readerGroupId, &readerConfig, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADINVALIDARGUMENT);
+} END_TEST
+
+/* The layout is learned from the first message. The values of later messages
+ * are read from the learned offsets. */
+START_TEST(Subscribe_fixedLayout) {
+    addWriter(1, 0);
+    addIntReader(1, UA_PUBSUB_RT_FIXED_SIZE);
+    writeInt32("a", 5);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    UA_ReaderGroup *rg = readerGroup();
+    ck_assert_uint_eq(rg->layoutsSize, 1);
+    ck_assert_uint_eq(rg->layouts[0].fieldsSize, 2);
+
+    /* The sequence number differs. The layout is reused. */
+    writeInt32("a", 6);
+    writeInt32("b", 8);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(rg->layoutsSize, 1);
+    ck_assert_int_eq(readInt32("ta"), 6);
+    ck_assert_int_eq(readInt32("tb"), 8);
+
+    /* Patch the value at the learned offset. The payload is not decoded. */
+    UA_Int32 patched = 1234;
+    UA_Byte *bufPos = &sent[0].data[rg->layouts[0].fields[0].offset];
+    const UA_Byte *bufEnd = &sent[0].data[sent[0].length];
+    ck_assert_uint_eq(UA_Int32_encodeBinary(&patched, &bufPos, bufEnd), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(UA_ReaderGroup_processNetworkMessage(server, rg, &sent[0]),
+                      UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(readInt32("ta"), 1234);
+    ck_assert_uint_eq(rg->layoutsSize, 1);
+
+    /* Adding a reader invalidates the layouts */
+    addIntReader(2, UA_PUBSUB_RT_FIXED_SIZE);
+    ck_assert_uint_eq(rg->layoutsSize, 0);
+} END_TEST
+
+/* A changed static byte leads to a regular decoding */
+START_TEST(Subscribe_fixedLayoutMismatch) {
+    addWriter(1, 0);
+    addIntReader(1, UA_PUBSUB_RT_FIXED_SIZE);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    UA_ReaderGroup *rg = readerGroup();
+    ck_assert_uint_eq(rg->layoutsSize, 1);
+
+    /* Change the DataSetWriterId in the payload header */
+    UA_NetworkMessage nm;
+    size_t offset = 0;
+    ck_assert_uint_eq(UA_NetworkMessage_decodeBinary(&sent[0], &offset, &nm),
+                      UA_STATUSCODE_GOOD);
+    nm.payloadHeader.dataSetPayloadHeader.dataSetWriterIds[0] = 2;
+    UA_ByteString other;
+    UA_ByteString_allocBuffer(&other, UA_NetworkMessage_calcSizeBinary(&nm));
+    UA_Byte *bufPos = other.data;
+    ck_assert_uint_eq(UA_NetworkMessage_encodeBinary(&nm, &bufPos, &other.data[other.length]),
+                      UA_STATUSCODE_GOOD);
+    UA_NetworkMessage_deleteMembers(&nm);
+    ck_assert_uint_eq(other.length, sent[0].length);
+    ck_assert_uint_eq(UA_ReaderGroup_processNetworkMessage(server, rg, &other),
+                      UA_STATUSCODE_GOODNODATA);
+    UA_ByteString_deleteMembers(&other);
+} END_TEST
+
+/* Fields of variable size are decoded regularly */
+START_TEST(Subscribe_variableSizeField) {
+    addField("s");
+    addWriter(1, 0);
+    UA_DataSetReaderTarget target;
+    memset(&target, 0, sizeof(UA_DataSetReaderTarget));
+    target.targetNodeId = UA_NODEID_STRING(1, "ts");
+    addReader(1, UA_PUBSUB_RT_FIXED_SIZE, &target, 1);
+
+    UA_String s = UA_STRING("longer string");
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &s, &UA_TYPES[UA_TYPES_STRING]);
+    UA_Server_writeValue(server, UA_NODEID_STRING(1, "s"), v);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(readerGroup()->layoutsSize, 0);
+
+    UA_Variant result;
+    UA_Server_readValue(server, UA_NODEID_STRING(1, "ts"), &result);
+    ck_assert(UA_Variant_hasScalarType(&result, &UA_TYPES[UA_TYPES_STRING]));
+    ck_assert(UA_String_equal((UA_String*)result.data, &s));
+    UA_Variant_deleteMembers(&result);
+} END_TEST
+
+/* The fields are written into application memory */
+START_TEST(Subscribe_externalValue) {
+    addWriter(1, 0);
+    UA_Int32 a = 0;
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    UA_Variant_setScalar(&dv.value, &a, &UA_TYPES[UA_TYPES_INT32]);
+    volatile UA_UInt32 sequenceCounter = 0;
+    UA_DataSetReaderTarget target;
+    memset(&target, 0, sizeof(UA_DataSetReaderTarget));
+    target.externalValue.enabled = true;
+    target.externalValue.value = &dv;
+    target.externalValue.sequenceCounter = &sequenceCounter;
+    addReader(1, UA_PUBSUB_RT_FIXED_SIZE, &target, 1);
+
+    writeInt32("a", 42);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(a, 42);
+    ck_assert(dv.hasValue);
+    ck_assert_uint_eq(sequenceCounter, 2);
+
+    /* Learned layout */
+    writeInt32("a", 43);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(readerGroup()->layoutsSize, 1);
+    ck_assert_int_eq(a, 43);
+    ck_assert_uint_eq(sequenceCounter, 4);
+} END_TEST
+
+#ifdef UA_ENABLE_PUBSUB_DELTAFRAMES
+/* DeltaFrames update the changed fields by index */
+START_TEST(Subscribe_deltaFrame) {
+    addWriter(1, 3);
+    addIntReader(1, UA_PUBSUB_RT_NONE);
+    writeInt32("a", 1);
+    writeInt32("b", 2);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    writeInt32("b", 3);
+    writeInt32("tb", 0);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(readInt32("ta"), 1);
+    ck_assert_int_eq(readInt32("tb"), 3);
+} END_TEST
+#endif
+
+START_TEST(Subscribe_removeReaderGroup) {
+    addWriter(1, 0);
+    addIntReader(1, UA_PUBSUB_RT_FIXED_SIZE);
+    ck_assert_uint_eq(publishAndProcess(), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(UA_Server_removeReaderGroup(server, readerGroupId), UA_STATUSCODE_GOOD);
+    ck_assert_ptr_eq(UA_ReaderGroup_findRGbyId(server, readerGroupId), NULL);
+    ck_assert_uint_eq(UA_Server_removeReaderGroup(server, readerGroupId),
+                      UA_STATUSCODE_BADNOTFOUND);
+
+    /* Another ReaderGroup on the registered connection */
+    UA_ReaderGroupConfig readerGroupConfig;
+    memset(&readerGroupConfig, 0, sizeof(UA_ReaderGroupConfig));
+    readerGroupConfig.subscribingInterval = 100000;
+    ck_assert_uint_eq(UA_Server_addReaderGroup(server, subscriberConnectionId,
+                                               &readerGroupConfig, &readerGroupId),
+                      UA_STATUSCODE_GOOD);
+} END_TEST
+
+/* The NetworkMessages of many publish cycles are received over the UDP
+ * multicast loopback in one subscribe callback */
+START_TEST(Subscribe_udp) {
+    publisherConnection->channel->send = channelSend;
+    publisherConnection->channel->sendBatch = channelSendBatch;
+    addWriter(1, 0);
+    addIntReader(1, UA_PUBSUB_RT_FIXED_SIZE);
+
+    UA_WriterGroup *wg = UA_WriterGroup_findWGbyId(server, writerGroupId);
+    for(UA_Int32 i = 1; i <= 200; i++) {
+        writeInt32("a", i);
+        UA_WriterGroup_publishCallback(server, wg);
+    }
+    /* The multicast loopback delivers the datagrams during the send call */
+    UA_ReaderGroup_subscribeCallback(server, readerGroup());
+    ck_assert_int_eq(readInt32("ta"), 200);
+    ck_assert_uint_eq(readerGroup()->layoutsSize, 1);
+} END_TEST
+
+/* The ReaderGroups of a connection receive the same messages. Every group
+ * gets the DataSetMessages of its own writer. */
+START_TEST(Subscribe_udpReaderGroups) {
+    publisherConnection->channel->send = channelSend;
+    publisherConnection->channel->sendBatch = channelSendBatch;
+    addWriter(1, 0);
+    addWriter(2, 0);
+    addIntReader(1, UA_PUBSUB_RT_NONE);
+
+    UA_Int32 i = 0;
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &i, &UA_TYPES[UA_TYPES_INT32]);
+    addVariable("ua", &v);
+    addVariable("ub", &v);
+
+    UA_ReaderGroupConfig readerGroupConfig;
+    memset(&readerGroupConfig, 0, sizeof(UA_ReaderGroupConfig));
+    readerGroupConfig.name = UA_STRING("ReaderGroup2");
+    readerGroupConfig.subscribingInterval = 100000;
+    UA_NodeId readerGroupId2;
+    UA_StatusCode retval =
+        UA_Server_addReaderGroup(server, subscriberConnectionId, &readerGroupConfig,
+                                 &readerGroupId2);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_DataSetReaderTarget targets[2];
+    memset(targets, 0, sizeof(targets));
+    targets[0].targetNodeId = UA_NODEID_STRING(1, "ua");
+    targets[1].targetNodeId = UA_NODEID_STRING(1, "ub");
+    UA_DataSetReaderConfig readerConfig;
+    memset(&readerConfig, 0, sizeof(UA_DataSetReaderConfig));
+    readerConfig.name = UA_STRING("DataSetReader2");
+    readerConfig.dataSetWriterId = 2;
+    readerConfig.targetVariables = targets;
+    readerConfig.targetVariablesSize = 2;
+    retval = UA_Server_addDataSetReader(server, readerGroupId2, &readerConfig, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    writeInt32("a", 42);
+    UA_WriterGroup_publishCallback(server, UA_WriterGroup_findWGbyId(server, writerGroupId));
+    UA_ReaderGroup_subscribeCallback(server, readerGroup());
+    UA_ReaderGroup_subscribeCallback(server, UA_ReaderGroup_findRGbyId(server, readerGroupId2));
+    ck_assert_int_eq(readInt32("ta"), 42);
+    ck_assert_int_eq(readInt32("ua"), 42);
+    UA_NodeId_deleteMembers(&readerGroupId2);
+} END_TEST
+
+/* Sends the NetworkMessage of one publish cycle over UDP. Shorter messages are
+ * padded with zeros to the given length. */
+static void
+publishPadded(UA_Int32 value, size_t length) {
+    writeInt32("a", value);
+    clearSent();
+    UA_WriterGroup_publishCallback(server, UA_WriterGroup_findWGbyId(server, writerGroupId));
+    ck_assert_uint_eq(sentSize, 1);
+    if(length < sent[0].length)
+        length = sent[0].length;
+    UA_ByteString buf;
+    UA_StatusCode retval = UA_ByteString_allocBuffer(&buf, length);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    memset(buf.data, 0, length);
+    memcpy(buf.data, sent[0].data, sent[0].length);
+    retval = channelSend(publisherConnection->channel, NULL, &buf);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_ByteString_deleteMembers(&buf);
+}
+
+/* Datagrams larger than the receive buffer are dropped and not decoded from
+ * their truncated beginning */
+START_TEST(Subscribe_udpTruncated) {
+    addWriter(1, 0);
+    addIntReader(1, UA_PUBSUB_RT_NONE);
+    publishPadded(7, 9000);
+    publishPadded(5, 0);
+    publishPadded(9, 9000);
+    UA_ReaderGroup_subscribeCallback(server, readerGroup());
+    ck_assert_int_eq(readInt32("ta"), 5);
+} END_TEST
+
+int main(void) {
+    TCase *tc_subscribe = tcase_create("PubSub subscribe");
+    tcase_add_checked_fixture(tc_subscribe, setup, teardown);
+    tcase_add_test(tc_subscribe, Subscribe_keyFrame);
+    tcase_add_test(tc_subscribe, Subscribe_filterWriterId);
+    tcase_add_test(tc_subscribe, Subscribe_filterHeader);
+    tcase_add_test(tc_subscribe, Subscribe_invalidPublisherId);
+#ifdef UA_ENABLE_PUBSUB_DELTAFRAMES
+    tcase_add_test(tc_subscribe, Subscribe_deltaFrame);
+#endif
+    tcase_add_test(tc_subscribe, Subscribe_removeReaderGroup);
+
+    TCase *tc_fixed = tcase_create("PubSub subscribe fixed layout");
+    tcase_add_checked_fixture(tc_fixed, setup, teardown);
+    tcase_add_test(tc_fixed, Subscribe_fixedLayout);
+    tcase_add_test(tc_fixed, Subscribe_fixedLayoutMismatch);
+    tcase_add_test(tc_fixed, Subscribe_variableSizeField);
+    tcase_add_test(tc_fixed, Subscribe_externalValue);
+
+    TCase *tc_udp = tcase_create("PubSub subscribe UDP");
+    tcase_add_checked_fixture(tc_udp, setup, teardown);
+    tcase_add_test(tc_udp, Subscribe_udp);
+    tcase_add_test(tc_udp, Subscribe_udpReaderGroups);
+    tcase_add_test(tc_udp, Subscribe_udpTruncated);
+
+    Suite *s = suite_create("PubSub subscribe");
+    suite_add_tcase(s, tc_subscribe);
+    suite_add_tcase(s, tc_fixed);
+    suite_add_tcase(s, tc_udp);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr,CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -272,6 +272,94 @@ START_TEST(profileGetDelete) {
 }
 END_TEST
 
+static UA_StatusCode
+addTarget(UA_Node *node, UA_UInt32 target) {
+    UA_AddReferencesItem item;
+    UA_AddReferencesItem_init(&item);
+    item.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+    item.isForward = true;
+    item.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, target);
+    return UA_Node_addReference(node, &item);
+}
+
+static UA_StatusCode
+deleteTarget(UA_Node *node, UA_UInt32 target) {
+    UA_DeleteReferencesItem item;
+    UA_DeleteReferencesItem_init(&item);
+    item.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+    item.isForward = true;
+    item.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, target);
+    return UA_Node_deleteReference(node, &item);
+}
+
+#define TARGETS 20000
+
+START_TEST(manyReferenceTargets) {
+    UA_Node *node = createNode(0, 1);
+    for(UA_UInt32 i = 0; i < TARGETS; i++)
+        ck_assert_uint_eq(addTarget(node, i), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(node->referencesSize, 1);
+    ck_assert_uint_eq(node->references[0].targetIdsSize, TARGETS);
+    ck_assert_uint_eq(addTarget(node, TARGETS / 2), UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED);
+
+    /* The copy keeps the targets searchable */
+    UA_Node *copy = UA_Node_copy_alloc(node);
+    ck_assert_ptr_ne(copy, NULL);
+
+    /* Delete every second target */
+    for(UA_UInt32 i = 0; i < TARGETS; i += 2)
+        ck_assert_uint_eq(deleteTarget(node, i), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(node->references[0].targetIdsSize, TARGETS / 2);
+    ck_assert_uint_eq(deleteTarget(node, 0), UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED);
+    for(size_t i = 0; i < node->references[0].targetIdsSize; i++)
+        ck_assert_uint_eq(node->references[0].targetIds[i].nodeId.identifier.numeric % 2, 1);
+    for(UA_UInt32 i = 0; i < TARGETS; i++) {
+        UA_StatusCode expected = (i % 2) ? UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED :
+            UA_STATUSCODE_GOOD;
+        ck_assert_uint_eq(addTarget(node, i), expected);
+    }
+    ck_assert_uint_eq(node->references[0].targetIdsSize, TARGETS);
+
+    /* Delete all targets from the copy */
+    for(UA_UInt32 i = TARGETS; i > 0; i--)
+        ck_assert_uint_eq(deleteTarget(copy, i - 1), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(copy->referencesSize, 0);
+
+    UA_Node_deleteMembers(copy);
+    UA_free(copy);
+    ns.deleteNode(ns.context, node);
+}
+END_TEST
+
+#define MANUALTARGETS 32
+
+/* Targets set directly on the node have no capacity and no index */
+START_TEST(manualReferenceTargets) {
+    UA_Node *node = createNode(0, 1);
+    node->references = (UA_NodeReferenceKind*)UA_calloc(1, sizeof(UA_NodeReferenceKind));
+    ck_assert_ptr_ne(node->references, NULL);
+    node->referencesSize = 1;
+    UA_NodeReferenceKind *refs = &node->references[0];
+    refs->referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+    refs->targetIds = (UA_ExpandedNodeId*)
+        UA_Array_new(MANUALTARGETS, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+    ck_assert_ptr_ne(refs->targetIds, NULL);
+    refs->targetIdsSize = MANUALTARGETS;
+    for(UA_UInt32 i = 0; i < MANUALTARGETS; i++)
+        refs->targetIds[i] = UA_EXPANDEDNODEID_NUMERIC(1, i);
+
+    ck_assert_uint_eq(addTarget(node, 5), UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED);
+    ck_assert_ptr_ne(node->references[0].targetIdsIndex, NULL);
+    for(UA_UInt32 i = MANUALTARGETS; i < 2 * MANUALTARGETS; i++)
+        ck_assert_uint_eq(addTarget(node, i), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(node->references[0].targetIdsSize, 2 * MANUALTARGETS);
+    for(UA_UInt32 i = 0; i < 2 * MANUALTARGETS; i++)
+        ck_assert_uint_eq(deleteTarget(node, i), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(node->referencesSize, 0);
+    ns.deleteNode(ns.context, node);
+}
+END_TEST
+
 static Suite * namespace_suite (void) {
     Suite *s = suite_create ("UA_NodeStore");
 
@@ -301,6 +389,12 @@ static Suite * namespace_suite (void) {
     tcase_add_test (tc_profile, profileGetDelete);
     suite_add_tcase (s, tc_profile);
 
+    TCase* tc_references = tcase_create ("References");
+    tcase_add_checked_fixture(tc_references, setup, teardown);
+    tcase_add_test (tc_references, manyReferenceTargets);
+    tcase_add_test (tc_references, manualReferenceTargets);
+    suite_add_tcase (s, tc_references);
+
     return s;
 }
 
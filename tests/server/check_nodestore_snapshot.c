@@ -0,0 +1,218 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ua_server.h"
+#include "ua_config_default.h"
+#include "ua_nodestore_snapshot.h"
+#include "check.h"
+
+#define SNAPSHOT_PATH "check_nodestore_snapshot.bin"
+
+static const UA_NodeId counterId = {2, UA_NODEIDTYPE_NUMERIC, {1000}};
+static const UA_NodeId folderId = {2, UA_NODEIDTYPE_NUMERIC, {1001}};
+static const UA_NodeId removedId = {2, UA_NODEIDTYPE_NUMERIC, {1002}};
+static UA_UInt16 nsIndex;
+
+/* Builds a server with a custom namespace and writes the snapshot */
+static void setup(void) {
+    UA_ServerConfig *config = UA_ServerConfig_new_default();
+    UA_Server *server = UA_Server_new(config);
+    nsIndex = UA_Server_addNamespace(server, "http://example.org/snapshot/");
+    ck_assert_uint_eq(nsIndex, 2);
+
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Devices");
+    UA_StatusCode retval =
+        UA_Server_addObjectNode(server, folderId, UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                UA_QUALIFIEDNAME(2, "Devices"),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
+                                oAttr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+    UA_Int32 counter = 42;
+    UA_Variant_setScalar(&vAttr.value, &counter, &UA_TYPES[UA_TYPES_INT32]);
+    vAttr.dataType = UA_TYPES[UA_TYPES_INT32].typeId;
+    vAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Counter");
+    retval = UA_Server_addVariableNode(server, counterId, folderId,
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                       UA_QUALIFIEDNAME(2, "Counter"),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                       vAttr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    vAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Removed");
+    retval = UA_Server_addVariableNode(server, removedId, folderId,
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                       UA_QUALIFIEDNAME(2, "Removed"),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                       vAttr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    retval = UA_Nodestore_writeSnapshot(server, SNAPSHOT_PATH, UA_STRING("1.0"));
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+}
+
+static void teardown(void) {
+    remove(SNAPSHOT_PATH);
+}
+
+static UA_Server *
+newServerFromSnapshot(UA_ServerConfig **config) {
+    *config = UA_ServerConfig_new_default();
+    UA_StatusCode retval = UA_Nodestore_Snapshot(&(*config)->nodestore, SNAPSHOT_PATH,
+                                                 UA_STRING("1.0"), NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Server *server = UA_Server_new(*config);
+    ck_assert_ptr_ne(server, NULL);
+    return server;
+}
+
+START_TEST(Snapshot_restoreNodes) {
+    UA_ServerConfig *config;
+    UA_Server *server = newServerFromSnapshot(&config);
+
+    /* The namespace was registered again */
+    size_t foundIndex = 0;
+    UA_StatusCode retval =
+        UA_Server_getNamespaceByName(server, UA_STRING("http://example.org/snapshot/"),
+                                     &foundIndex);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(foundIndex, 2);
+
+    /* The value was restored */
+    UA_Variant value;
+    retval = UA_Server_readValue(server, counterId, &value);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_INT32]));
+    ck_assert_int_eq(*(UA_Int32*)value.data, 42);
+    UA_Variant_deleteMembers(&value);
+
+    /* The references were restored */
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = folderId;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+    bd.resultMask = UA_BROWSERESULTMASK_ALL;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(br.referencesSize, 2);
+    UA_BrowseResult_deleteMembers(&br);
+
+    /* Namespace zero is complete and the data sources are set up again */
+    UA_DataValue dv1 = UA_Server_read(server, &(UA_ReadValueId){
+            UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_CURRENTTIME),
+            UA_ATTRIBUTEID_VALUE, UA_STRING_NULL, {0, UA_STRING_NULL}},
+        UA_TIMESTAMPSTORETURN_NEITHER);
+    ck_assert(dv1.hasValue);
+    ck_assert(UA_Variant_hasScalarType(&dv1.value, &UA_TYPES[UA_TYPES_DATETIME]));
+    UA_DataValue_deleteMembers(&dv1);
+
+    /* Values can be written */
+    UA_Int32 counter = 43;
+    UA_Variant_setScalar(&value, &counter, &UA_TYPES[UA_TYPES_INT32]);
+    retval = UA_Server_writeValue(server, counterId, value);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+} END_TEST
+
+START_TEST(Snapshot_addAndDeleteNodes) {
+    UA_ServerConfig *config;
+    UA_Server *server = newServerFromSnapshot(&config);
+
+    /* A node from the snapshot cannot be added again */
+    UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+    UA_StatusCode retval =
+        UA_Server_addVariableNode(server, counterId, folderId,
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                  UA_QUALIFIEDNAME(2, "Counter"),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                  vAttr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADNODEIDEXISTS);
+
+    /* Nodes with random NodeIds can be added */
+    UA_NodeId newId;
+    retval = UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(2, 0), folderId,
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                       UA_QUALIFIEDNAME(2, "New"),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                       vAttr, NULL, &newId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(!UA_NodeId_equal(&newId, &counterId));
+
+    /* Deleted nodes are not taken from the snapshot again */
+    retval = UA_Server_deleteNode(server, removedId, true);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_NodeClass nodeClass;
+    retval = UA_Server_readNodeClass(server, removedId, &nodeClass);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADNODEIDUNKNOWN);
+
+    /* A new snapshot contains the changes */
+    retval = UA_Nodestore_writeSnapshot(server, SNAPSHOT_PATH, UA_STRING("1.0"));
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+
+    server = newServerFromSnapshot(&config);
+    retval = UA_Server_readNodeClass(server, newId, &nodeClass);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(nodeClass, UA_NODECLASS_VARIABLE);
+    retval = UA_Server_readNodeClass(server, removedId, &nodeClass);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADNODEIDUNKNOWN);
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+} END_TEST
+
+START_TEST(Snapshot_versionMismatch) {
+    UA_ServerConfig *config = UA_ServerConfig_new_default();
+    UA_Nodestore orig = config->nodestore;
+    UA_StatusCode retval = UA_Nodestore_Snapshot(&config->nodestore, SNAPSHOT_PATH,
+                                                 UA_STRING("2.0"), NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADNOTSUPPORTED);
+    ck_assert_ptr_eq(config->nodestore.context, orig.context);
+
+    retval = UA_Nodestore_Snapshot(&config->nodestore, "does_not_exist.bin",
+                                   UA_STRING("1.0"), NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADNOTFOUND);
+
+    /* The server is built in the normal way */
+    UA_Server *server = UA_Server_new(config);
+    ck_assert_ptr_ne(server, NULL);
+    UA_NodeClass nodeClass;
+    retval = UA_Server_readNodeClass(server, counterId, &nodeClass);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADNODEIDUNKNOWN);
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+} END_TEST
+
+static Suite * testSuite_NodestoreSnapshot(void) {
+    Suite *s = suite_create("Nodestore Snapshot");
+    TCase *tc_snapshot = tcase_create("Snapshot");
+    tcase_add_checked_fixture(tc_snapshot, setup, teardown);
+    tcase_add_test(tc_snapshot, Snapshot_restoreNodes);
+    tcase_add_test(tc_snapshot, Snapshot_addAndDeleteNodes);
+    tcase_add_test(tc_snapshot, Snapshot_versionMismatch);
+    suite_add_tcase(s, tc_snapshot);
+    return s;
+}
+
+int main(void) {
+    Suite *s = testSuite_NodestoreSnapshot();
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -22,11 +22,24 @@
 #include "ua_historydatabase_default.h"
 #include "ua_plugin_history_data_gathering.h"
 #include "ua_historydatabackend_memory.h"
+#include "ua_historydatabackend_memoryring.h"
+#include "ua_historydatabackend_compressed.h"
+#include "ua_historydatabackend_rollup.h"
+#include "ua_historydatasummary.h"
+#ifdef UA_ENABLE_HISTORIZING_FILE
+#include "ua_historydatabackend_file.h"
+#include <dirent.h>
+#include <unistd.h>
+#endif
+#ifdef UA_ENABLE_HISTORIZING_ASYNC
+#include "ua_historydatabackend_async.h"
+#endif
 #include "ua_historydatagathering_default.h"
 #ifdef UA_ENABLE_HISTORIZING
 #include "historical_read_test_data.h"
 #endif
 #include <stddef.h>
+#include <math.h>
 
 
 static UA_Server *server;
@@ -646,9 +659,11 @@ START_TEST(Server_HistorizingStrategyValueSet)
 }
 END_TEST
 
-START_TEST(Server_HistorizingBackendMemory)
+/* Registers the backend for the test node, fills it with the test data and
+ * reads the data back with different response sizes */
+static void
+checkHistorizingBackend(UA_HistoryDataBackend backend)
 {
-    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Memory(1, 1);
     UA_HistorizingNodeIdSettings setting;
     setting.historizingBackend = backend;
     setting.maxHistoryDataResponseSize = 1000;
@@ -679,10 +694,1234 @@ START_TEST(Server_HistorizingBackendMemory)
     retval = testHistoricalDataBackend(2);
     fprintf(stderr, "%d tests failed.\n", retval);
     ck_assert_uint_eq(retval, 0);
-    UA_HistoryDataBackend_Memory_deleteMembers(&setting.historizingBackend);
+}
+
+START_TEST(Server_HistorizingBackendMemory)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Memory(1, 1);
+    checkHistorizingBackend(backend);
+    UA_HistoryDataBackend_Memory_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendMemoryRing)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_MemoryRing(1, 0, 0);
+    checkHistorizingBackend(backend);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&backend);
+}
+END_TEST
+
+static void
+backendSetValue(UA_HistoryDataBackend *backend, const UA_NodeId *nodeId,
+                UA_DateTime timestamp, UA_Int64 v)
+{
+    UA_DataValue value;
+    UA_DataValue_init(&value);
+    UA_Variant_setScalar(&value.value, &v, &UA_TYPES[UA_TYPES_INT64]);
+    value.hasValue = true;
+    value.sourceTimestamp = timestamp;
+    value.hasSourceTimestamp = true;
+    UA_StatusCode ret = backend->serverSetHistoryData(NULL, backend->context, NULL, NULL,
+                                                      nodeId, UA_FALSE, &value);
+    ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+}
+
+static UA_Int64
+backendGetValue(UA_HistoryDataBackend *backend, const UA_NodeId *nodeId, size_t index)
+{
+    const UA_DataValue *value =
+        backend->getDataValue(NULL, backend->context, NULL, NULL, nodeId, index);
+    ck_assert_ptr_ne(value, NULL);
+    ck_assert(value->hasValue);
+    ck_assert_ptr_eq(value->value.type, &UA_TYPES[UA_TYPES_INT64]);
+    return *(UA_Int64*)value->value.data;
+}
+
+START_TEST(Server_HistorizingBackendMemoryRing_maxValues)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_MemoryRing(1, 50, 0);
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(1, 1000);
+    for (UA_Int64 i = 0; i < 1000; ++i)
+        backendSetValue(&backend, &nodeId, i * UA_DATETIME_SEC, i);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 50);
+    for (size_t i = 0; i < 50; ++i)
+        ck_assert_int_eq(backendGetValue(&backend, &nodeId, i), 950 + (UA_Int64)i);
+
+    /* Older than everything in the full ring */
+    backendSetValue(&backend, &nodeId, 0, -1);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 50);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 0), 950);
+
+    /* Out of order into the full ring. The oldest sample is removed. */
+    backendSetValue(&backend, &nodeId, 975 * UA_DATETIME_SEC + 1, -2);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 0), 951);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 24), 975);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 25), -2);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 26), 976);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 49), 999);
+
+    size_t index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeId,
+                                            975 * UA_DATETIME_SEC, MATCH_AFTER);
+    ck_assert_uint_eq(index, 25);
+    index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeId,
+                                     960 * UA_DATETIME_SEC, MATCH_EQUAL);
+    ck_assert_uint_eq(index, 9);
+    index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeId,
+                                     900 * UA_DATETIME_SEC, MATCH_BEFORE);
+    ck_assert_uint_eq(index, 50);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendMemoryRing_maxAge)
+{
+    UA_HistoryDataBackend backend =
+        UA_HistoryDataBackend_MemoryRing(1, 0, 10 * UA_DATETIME_SEC);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "aged");
+    for (UA_Int64 i = 0; i < 100; ++i)
+        backendSetValue(&backend, &nodeId, i * UA_DATETIME_SEC, i);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 11);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 0), 89);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 10), 99);
+
+    /* A late sample that is already too old */
+    backendSetValue(&backend, &nodeId, 50 * UA_DATETIME_SEC, 50);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 11);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 0), 89);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendMemoryRing_manyNodes)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_MemoryRing(1, 0, 0);
+    for (UA_UInt32 n = 0; n < 500; ++n) {
+        UA_NodeId nodeId = UA_NODEID_NUMERIC(2, n);
+        for (UA_Int64 i = 0; i < 10; ++i)
+            backendSetValue(&backend, &nodeId, i * UA_DATETIME_SEC, (UA_Int64)n * 100 + i);
+    }
+    for (UA_UInt32 n = 0; n < 500; ++n) {
+        UA_NodeId nodeId = UA_NODEID_NUMERIC(2, n);
+        ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 10);
+        ck_assert_int_eq(backendGetValue(&backend, &nodeId, 9), (UA_Int64)n * 100 + 9);
+    }
+    UA_NodeId unknown = UA_NODEID_NUMERIC(3, 1);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &unknown), 0);
+    ck_assert_ptr_eq(backend.getDataValue(NULL, backend.context, NULL, NULL, &unknown, 0), NULL);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendMemoryRing_generic)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_MemoryRing(1, 4, 0);
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(1, 1);
+    backendSetValue(&backend, &nodeId, 1 * UA_DATETIME_SEC, 1);
+    backendSetValue(&backend, &nodeId, 2 * UA_DATETIME_SEC, 2);
+
+    /* A string converts the series to DataValues */
+    UA_DataValue value;
+    UA_DataValue_init(&value);
+    UA_String s = UA_STRING("three");
+    UA_Variant_setScalar(&value.value, &s, &UA_TYPES[UA_TYPES_STRING]);
+    value.hasValue = true;
+    value.sourceTimestamp = 3 * UA_DATETIME_SEC;
+    value.hasSourceTimestamp = true;
+    UA_StatusCode ret = backend.serverSetHistoryData(NULL, backend.context, NULL, NULL,
+                                                     &nodeId, UA_FALSE, &value);
+    ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+    for (UA_Int64 i = 4; i < 8; ++i)
+        backendSetValue(&backend, &nodeId, i * UA_DATETIME_SEC, i);
+
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 4);
+    for (size_t i = 0; i < 4; ++i)
+        ck_assert_int_eq(backendGetValue(&backend, &nodeId, i), 4 + (UA_Int64)i);
+
+    /* Copy out with the low level API */
+    UA_DataValue values[4];
+    size_t provided = 0;
+    UA_ByteString cp = UA_BYTESTRING_NULL;
+    UA_ByteString outCp = UA_BYTESTRING_NULL;
+    UA_NumericRange range;
+    range.dimensionsSize = 0;
+    range.dimensions = NULL;
+    ret = backend.copyDataValues(NULL, backend.context, NULL, NULL, &nodeId, 3, 0, true,
+                                 4, range, false, &cp, &outCp, &provided, values);
+    ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(provided, 4);
+    ck_assert_uint_eq(outCp.length, 0);
+    for (size_t i = 0; i < 4; ++i) {
+        ck_assert_int_eq(*(UA_Int64*)values[i].value.data, 7 - (UA_Int64)i);
+        UA_DataValue_deleteMembers(&values[i]);
+    }
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendCompressed)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Compressed(1, 0);
+    checkHistorizingBackend(backend);
+    UA_HistoryDataBackend_Compressed_deleteMembers(&backend);
+}
+END_TEST
+
+#define COMPRESSED_SAMPLES 100000
+
+START_TEST(Server_HistorizingBackendCompressed_ratio)
+{
+    /* An analog value at 1 Hz with a few ms of jitter. The value changes
+     * every few seconds. */
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Compressed(1, 0);
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(1, 42);
+    UA_DateTime start = UA_DateTime_now();
+    UA_UInt32 x = 1;
+    for (size_t i = 0; i < COMPRESSED_SAMPLES; ++i) {
+        x = x * 1103515245 + 12345;
+        UA_DataValue value;
+        UA_DataValue_init(&value);
+        UA_Double d = 20.0 + (UA_Double)(i / 7 % 50) * 0.5;
+        UA_Variant_setScalar(&value.value, &d, &UA_TYPES[UA_TYPES_DOUBLE]);
+        value.hasValue = true;
+        value.sourceTimestamp = start + (UA_DateTime)i * UA_DATETIME_SEC +
+            (UA_DateTime)(x >> 16) % (5 * UA_DATETIME_MSEC);
+        value.hasSourceTimestamp = true;
+        value.serverTimestamp = value.sourceTimestamp + UA_DATETIME_MSEC;
+        value.hasServerTimestamp = true;
+        ck_assert_uint_eq(backend.serverSetHistoryData(NULL, backend.context, NULL, NULL,
+                                                       &nodeId, UA_FALSE, &value),
+                          UA_STATUSCODE_GOOD);
+    }
+    size_t usage = UA_HistoryDataBackend_Compressed_memoryUsage(&backend);
+    fprintf(stderr, "Compressed history: %f bytes per sample\n",
+            (double)usage / COMPRESSED_SAMPLES);
+    ck_assert_uint_lt(usage, COMPRESSED_SAMPLES * 5);
+
+    /* Read everything back */
+    x = 1;
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId),
+                      COMPRESSED_SAMPLES);
+    for (size_t i = 0; i < COMPRESSED_SAMPLES; ++i) {
+        x = x * 1103515245 + 12345;
+        const UA_DataValue *value =
+            backend.getDataValue(NULL, backend.context, NULL, NULL, &nodeId, i);
+        ck_assert_ptr_ne(value, NULL);
+        UA_DateTime t = start + (UA_DateTime)i * UA_DATETIME_SEC +
+            (UA_DateTime)(x >> 16) % (5 * UA_DATETIME_MSEC);
+        ck_assert_int_eq(value->sourceTimestamp, t);
+        ck_assert_int_eq(value->serverTimestamp, t + UA_DATETIME_MSEC);
+        ck_assert(!value->hasStatus);
+        ck_assert(*(UA_Double*)value->value.data == 20.0 + (UA_Double)(i / 7 % 50) * 0.5);
+    }
+    UA_HistoryDataBackend_Compressed_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendCompressed_outOfOrder)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Compressed(1, 0);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "shuffled");
+
+    /* Insert a permutation of 0..1999 */
+    for (UA_UInt32 i = 0; i < 2000; ++i) {
+        UA_Int32 v = (UA_Int32)((i * 7919) % 2000);
+        UA_DataValue value;
+        UA_DataValue_init(&value);
+        UA_Int32 negative = -v;
+        UA_Variant_setScalar(&value.value, &negative, &UA_TYPES[UA_TYPES_INT32]);
+        value.hasValue = true;
+        value.sourceTimestamp = v * UA_DATETIME_SEC;
+        value.hasSourceTimestamp = true;
+        if (v % 3 == 0) {
+            value.status = UA_STATUSCODE_UNCERTAININITIALVALUE;
+            value.hasStatus = true;
+        }
+        ck_assert_uint_eq(backend.serverSetHistoryData(NULL, backend.context, NULL, NULL,
+                                                       &nodeId, UA_FALSE, &value),
+                          UA_STATUSCODE_GOOD);
+    }
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 2000);
+    for (size_t i = 0; i < 2000; ++i) {
+        const UA_DataValue *value =
+            backend.getDataValue(NULL, backend.context, NULL, NULL, &nodeId, i);
+        ck_assert_int_eq(value->sourceTimestamp, (UA_DateTime)i * UA_DATETIME_SEC);
+        ck_assert_ptr_eq(value->value.type, &UA_TYPES[UA_TYPES_INT32]);
+        ck_assert_int_eq(*(UA_Int32*)value->value.data, -(UA_Int32)i);
+        ck_assert_uint_eq(value->hasStatus, i % 3 == 0);
+        if (value->hasStatus)
+            ck_assert_uint_eq(value->status, UA_STATUSCODE_UNCERTAININITIALVALUE);
+    }
+    size_t index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeId,
+                                            1234 * UA_DATETIME_SEC, MATCH_EQUAL);
+    ck_assert_uint_eq(index, 1234);
+    index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeId,
+                                     1234 * UA_DATETIME_SEC, MATCH_AFTER);
+    ck_assert_uint_eq(index, 1235);
+    index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeId,
+                                     1234 * UA_DATETIME_SEC, MATCH_BEFORE);
+    ck_assert_uint_eq(index, 1233);
+    UA_HistoryDataBackend_Compressed_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendCompressed_generic)
+{
+    UA_HistoryDataBackend backend =
+        UA_HistoryDataBackend_Compressed(1, 100 * UA_DATETIME_SEC);
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(1, 1);
+    for (UA_Int64 i = 0; i < 1000; ++i)
+        backendSetValue(&backend, &nodeId, i * UA_DATETIME_SEC, i);
+
+    /* Whole blocks older than 100s are removed */
+    size_t end = backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId);
+    ck_assert_uint_ge(end, 101);
+    ck_assert_uint_le(end, 101 + 256);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, end - 1), 999);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 0), 1000 - (UA_Int64)end);
+
+    /* A string converts the series to DataValues */
+    UA_DataValue value;
+    UA_DataValue_init(&value);
+    UA_String str = UA_STRING("late");
+    UA_Variant_setScalar(&value.value, &str, &UA_TYPES[UA_TYPES_STRING]);
+    value.hasValue = true;
+    value.sourceTimestamp = 998 * UA_DATETIME_SEC + 1;
+    value.hasSourceTimestamp = true;
+    ck_assert_uint_eq(backend.serverSetHistoryData(NULL, backend.context, NULL, NULL,
+                                                   &nodeId, UA_FALSE, &value),
+                      UA_STATUSCODE_GOOD);
+
+    /* Then single samples older than 100s are removed */
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 102);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 0), 899);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 99), 998);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeId, 101), 999);
+    const UA_DataValue *dv =
+        backend.getDataValue(NULL, backend.context, NULL, NULL, &nodeId, 100);
+    ck_assert_ptr_eq(dv->value.type, &UA_TYPES[UA_TYPES_STRING]);
+
+    /* The age limit applies to the DataValues as well */
+    backendSetValue(&backend, &nodeId, 2000 * UA_DATETIME_SEC, 2000);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeId), 1);
+    UA_HistoryDataBackend_Compressed_deleteMembers(&backend);
+}
+END_TEST
+
+#define STATUS_CALCULATED (UA_STATUSCODE_INFOTYPE_DATAVALUE | 0x01)
+#define STATUS_INTERPOLATED (UA_STATUSCODE_INFOTYPE_DATAVALUE | 0x02)
+
+static void
+requestProcessed(UA_DateTime start,
+                 UA_DateTime end,
+                 UA_Double processingInterval,
+                 UA_UInt32 aggregate,
+                 UA_HistoryReadResponse * response,
+                 UA_ByteString *continuationPoint)
+{
+    UA_ReadProcessedDetails *details = UA_ReadProcessedDetails_new();
+    details->startTime = start;
+    details->endTime = end;
+    details->processingInterval = processingInterval;
+    details->aggregateType = UA_NodeId_new();
+    details->aggregateTypeSize = 1;
+    *details->aggregateType = UA_NODEID_NUMERIC(0, aggregate);
+
+    UA_HistoryReadValueId *valueId = UA_HistoryReadValueId_new();
+    UA_NodeId_copy(&outNodeId, &valueId->nodeId);
+    if (continuationPoint)
+        UA_ByteString_copy(continuationPoint, &valueId->continuationPoint);
+
+    UA_HistoryReadRequest request;
+    UA_HistoryReadRequest_init(&request);
+    request.historyReadDetails.encoding = UA_EXTENSIONOBJECT_DECODED;
+    request.historyReadDetails.content.decoded.type = &UA_TYPES[UA_TYPES_READPROCESSEDDETAILS];
+    request.historyReadDetails.content.decoded.data = details;
+    request.timestampsToReturn = UA_TIMESTAMPSTORETURN_SOURCE;
+    request.nodesToReadSize = 1;
+    request.nodesToRead = valueId;
+
+    Service_HistoryRead(server, &server->adminSession, &request, response);
+    UA_HistoryReadRequest_deleteMembers(&request);
+}
+
+/* Reads the aggregate and checks the number of results */
+static UA_HistoryData *
+readProcessed(UA_DateTime start, UA_DateTime end, UA_Double processingInterval,
+              UA_UInt32 aggregate, UA_HistoryReadResponse *response, size_t expectedSize)
+{
+    UA_HistoryReadResponse_init(response);
+    requestProcessed(start, end, processingInterval, aggregate, response, NULL);
+    ck_assert_str_eq(UA_StatusCode_name(response->responseHeader.serviceResult),
+                     UA_StatusCode_name(UA_STATUSCODE_GOOD));
+    ck_assert_uint_eq(response->resultsSize, 1);
+    ck_assert_str_eq(UA_StatusCode_name(response->results[0].statusCode),
+                     UA_StatusCode_name(UA_STATUSCODE_GOOD));
+    UA_HistoryData *data = (UA_HistoryData *)response->results[0].historyData.content.decoded.data;
+    ck_assert_uint_eq(data->dataValuesSize, expectedSize);
+    return data;
+}
+
+static UA_Double
+processedValue(const UA_DataValue *value)
+{
+    ck_assert(value->hasValue);
+    ck_assert_ptr_eq(value->value.type, &UA_TYPES[UA_TYPES_DOUBLE]);
+    return *(UA_Double*)value->value.data;
+}
+
+static void
+registerProcessedBackend(UA_HistoryDataBackend backend, size_t maxResponseSize)
+{
+    UA_HistorizingNodeIdSettings setting;
+    setting.historizingBackend = backend;
+    setting.maxHistoryDataResponseSize = maxResponseSize;
+    setting.historizingUpdateStrategy = UA_HISTORIZINGUPDATESTRATEGY_USER;
+    serverMutexLock();
+    UA_StatusCode ret = gathering->registerNodeId(server, gathering->context, &outNodeId, setting);
+    serverMutexUnlock();
+    ck_assert_str_eq(UA_StatusCode_name(ret), UA_StatusCode_name(UA_STATUSCODE_GOOD));
+}
+
+/* One sample per second with the value of the second */
+#define PROCESSED_START (1000 * UA_DATETIME_SEC)
+
+static void
+fillProcessed(UA_HistoryDataBackend *backend, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        UA_DataValue value;
+        UA_DataValue_init(&value);
+        UA_Double v = (UA_Double)i;
+        UA_Variant_setScalar(&value.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+        value.hasValue = true;
+        value.hasSourceTimestamp = true;
+        value.sourceTimestamp = PROCESSED_START + (UA_DateTime)i * UA_DATETIME_SEC;
+        UA_StatusCode ret = backend->serverSetHistoryData(server, backend->context, NULL, NULL,
+                                                          &outNodeId, UA_FALSE, &value);
+        ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+    }
+}
+
+START_TEST(Server_HistoryReadProcessed)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Memory(1, 100);
+    registerProcessedBackend(backend, 100);
+    fillProcessed(&backend, 60);
+
+    UA_DateTime start = PROCESSED_START;
+    UA_DateTime end = PROCESSED_START + 60 * UA_DATETIME_SEC;
+    UA_HistoryReadResponse response;
+    UA_HistoryData *data = readProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_AVERAGE,
+                                         &response, 6);
+    for (size_t i = 0; i < 6; ++i) {
+        ck_assert_uint_eq(data->dataValues[i].status, STATUS_CALCULATED);
+        ck_assert_int_eq(data->dataValues[i].sourceTimestamp,
+                         start + (UA_DateTime)i * 10 * UA_DATETIME_SEC);
+        ck_assert(fabs(processedValue(&data->dataValues[i]) - (4.5 + 10.0 * (UA_Double)i)) < 1e-9);
+    }
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    data = readProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_COUNT, &response, 6);
+    ck_assert_ptr_eq(data->dataValues[0].value.type, &UA_TYPES[UA_TYPES_INT32]);
+    ck_assert_int_eq(*(UA_Int32*)data->dataValues[0].value.data, 10);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    data = readProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_MAXIMUMACTUALTIME,
+                         &response, 6);
+    ck_assert(processedValue(&data->dataValues[2]) == 29.0);
+    ck_assert_int_eq(data->dataValues[2].sourceTimestamp, start + 29 * UA_DATETIME_SEC);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    data = readProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_VARIANCEPOPULATION,
+                         &response, 6);
+    ck_assert(fabs(processedValue(&data->dataValues[3]) - 8.25) < 1e-9);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    /* Linear data has the same time average. The last interval has no bound
+     * after its end. */
+    data = readProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_TIMEAVERAGE,
+                         &response, 6);
+    for (size_t i = 0; i < 5; ++i) {
+        ck_assert_uint_eq(data->dataValues[i].status, STATUS_CALCULATED);
+        ck_assert(fabs(processedValue(&data->dataValues[i]) - (5.0 + 10.0 * (UA_Double)i)) < 1e-9);
+    }
+    ck_assert_uint_eq(data->dataValues[5].status,
+                      UA_STATUSCODE_UNCERTAINDATASUBNORMAL | STATUS_CALCULATED);
+    ck_assert(fabs(processedValue(&data->dataValues[5]) - 54.5) < 1e-9);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    data = readProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_TOTAL, &response, 6);
+    ck_assert(fabs(processedValue(&data->dataValues[0]) - 50.0) < 1e-9);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    /* Interpolated between the samples */
+    data = readProcessed(start + UA_DATETIME_SEC / 2, end, 10000,
+                         UA_NS0ID_AGGREGATEFUNCTION_INTERPOLATIVE, &response, 6);
+    ck_assert_uint_eq(data->dataValues[1].status, STATUS_INTERPOLATED);
+    ck_assert(fabs(processedValue(&data->dataValues[1]) - 10.5) < 1e-9);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    /* Reverse order, the interval timestamp is the later time */
+    data = readProcessed(end, start, 20000, UA_NS0ID_AGGREGATEFUNCTION_DELTA, &response, 3);
+    ck_assert_int_eq(data->dataValues[0].sourceTimestamp, end);
+    ck_assert(processedValue(&data->dataValues[0]) == 19.0);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    /* No samples in the interval */
+    data = readProcessed(end + 100 * UA_DATETIME_SEC, end + 200 * UA_DATETIME_SEC, 0,
+                         UA_NS0ID_AGGREGATEFUNCTION_MINIMUM, &response, 1);
+    ck_assert_uint_eq(data->dataValues[0].status, UA_STATUSCODE_BADNODATA);
+    ck_assert(!data->dataValues[0].hasValue);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    UA_HistoryDataBackend_Memory_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistoryReadProcessed_continuationPoint)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Memory(1, 100);
+    registerProcessedBackend(backend, 4);
+    fillProcessed(&backend, 60);
+    UA_DateTime start = PROCESSED_START;
+    UA_DateTime end = PROCESSED_START + 60 * UA_DATETIME_SEC;
+
+    UA_HistoryReadResponse response;
+    UA_HistoryData *data = readProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_MINIMUM,
+                                         &response, 4);
+    ck_assert(processedValue(&data->dataValues[3]) == 30.0);
+    ck_assert_uint_gt(response.results[0].continuationPoint.length, 0);
+    UA_ByteString continuationPoint;
+    UA_ByteString_copy(&response.results[0].continuationPoint, &continuationPoint);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    UA_HistoryReadResponse_init(&response);
+    requestProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_MINIMUM,
+                     &response, &continuationPoint);
+    UA_ByteString_deleteMembers(&continuationPoint);
+    ck_assert_str_eq(UA_StatusCode_name(response.results[0].statusCode),
+                     UA_StatusCode_name(UA_STATUSCODE_GOOD));
+    data = (UA_HistoryData *)response.results[0].historyData.content.decoded.data;
+    ck_assert_uint_eq(data->dataValuesSize, 2);
+    ck_assert(processedValue(&data->dataValues[0]) == 40.0);
+    ck_assert_uint_eq(response.results[0].continuationPoint.length, 0);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    /* Not supported aggregate */
+    UA_HistoryReadResponse_init(&response);
+    requestProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_NUMBEROFTRANSITIONS,
+                     &response, NULL);
+    ck_assert_str_eq(UA_StatusCode_name(response.results[0].statusCode),
+                     UA_StatusCode_name(UA_STATUSCODE_BADAGGREGATENOTSUPPORTED));
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    /* Start and end must differ */
+    UA_HistoryReadResponse_init(&response);
+    requestProcessed(start, start, 10000, UA_NS0ID_AGGREGATEFUNCTION_MINIMUM, &response, NULL);
+    ck_assert_str_eq(UA_StatusCode_name(response.results[0].statusCode),
+                     UA_StatusCode_name(UA_STATUSCODE_BADINVALIDARGUMENT));
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    /* One aggregate per node */
+    UA_ReadProcessedDetails details;
+    UA_ReadProcessedDetails_init(&details);
+    details.startTime = start;
+    details.endTime = end;
+    UA_HistoryReadValueId valueId;
+    UA_HistoryReadValueId_init(&valueId);
+    valueId.nodeId = outNodeId;
+    UA_HistoryReadRequest request;
+    UA_HistoryReadRequest_init(&request);
+    request.historyReadDetails.encoding = UA_EXTENSIONOBJECT_DECODED;
+    request.historyReadDetails.content.decoded.type = &UA_TYPES[UA_TYPES_READPROCESSEDDETAILS];
+    request.historyReadDetails.content.decoded.data = &details;
+    request.nodesToReadSize = 1;
+    request.nodesToRead = &valueId;
+    UA_HistoryReadResponse_init(&response);
+    Service_HistoryRead(server, &server->adminSession, &request, &response);
+    ck_assert_str_eq(UA_StatusCode_name(response.responseHeader.serviceResult),
+                     UA_StatusCode_name(UA_STATUSCODE_BADAGGREGATELISTMISMATCH));
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    UA_HistoryDataBackend_Memory_deleteMembers(&backend);
+}
+END_TEST
+
+/* The number of intervals in a response is limited even if the setting of the
+ * node does not set a limit */
+START_TEST(Server_HistoryReadProcessed_limits)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Memory(1, 100);
+    registerProcessedBackend(backend, 0);
+    fillProcessed(&backend, 60);
+    UA_DateTime start = PROCESSED_START;
+    UA_DateTime end = PROCESSED_START + 60 * UA_DATETIME_SEC;
+
+    /* One interval per DateTime tick */
+    UA_HistoryReadResponse response;
+    readProcessed(start, end, 0.0001, UA_NS0ID_AGGREGATEFUNCTION_MINIMUM, &response, 10000);
+    ck_assert_uint_gt(response.results[0].continuationPoint.length, 0);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    /* The limit of the server configuration */
+    server->config.maxReturnDataValues = 5;
+    readProcessed(start, end, 10000, UA_NS0ID_AGGREGATEFUNCTION_MINIMUM, &response, 5);
+    ck_assert_uint_gt(response.results[0].continuationPoint.length, 0);
+    UA_HistoryReadResponse_deleteMembers(&response);
+    server->config.maxReturnDataValues = 0;
+
+    UA_HistoryDataBackend_Memory_deleteMembers(&backend);
+}
+END_TEST
+
+static void
+assertSummaryEqual(const UA_HistoryDataSummary *a, const UA_HistoryDataSummary *b)
+{
+    ck_assert_uint_eq(a->count, b->count);
+    if (a->count == 0)
+        return;
+    ck_assert(a->min == b->min);
+    ck_assert_int_eq(a->minTime, b->minTime);
+    ck_assert(a->max == b->max);
+    ck_assert_int_eq(a->maxTime, b->maxTime);
+    ck_assert(a->first == b->first);
+    ck_assert_int_eq(a->firstTime, b->firstTime);
+    ck_assert(a->last == b->last);
+    ck_assert_int_eq(a->lastTime, b->lastTime);
+    ck_assert(fabs(a->sum - b->sum) <= 1e-9 * (1.0 + fabs(b->sum)));
+    ck_assert(fabs(a->m2 - b->m2) <= 1e-9 * (1.0 + fabs(b->m2)));
+    ck_assert(fabs(a->area - b->area) <= 1e-9 * (1.0 + fabs(b->area)));
+}
+
+#define ROLLUP_SAMPLES 20000
+
+START_TEST(Server_HistorizingBackendRollup_summary)
+{
+    UA_HistoryDataBackend memory = UA_HistoryDataBackend_Memory(1, ROLLUP_SAMPLES);
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(1, 1000);
+
+    /* Samples that exist before the rollup backend is created */
+    for (UA_Int64 i = 0; i < 100; ++i)
+        backendSetValue(&memory, &nodeId, i * UA_DATETIME_SEC, i);
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Rollup(memory);
+    ck_assert_ptr_ne(backend.context, NULL);
+
+    /* One sample per second with every 7th sample out of order and some bad
+     * samples */
+    for (UA_Int64 i = 100; i < ROLLUP_SAMPLES; ++i) {
+        UA_Int64 t = (i % 7 == 0) ? i - 5 : i;
+        UA_DataValue value;
+        UA_DataValue_init(&value);
+        UA_Int64 v = (t * 7919) % 1000;
+        UA_Variant_setScalar(&value.value, &v, &UA_TYPES[UA_TYPES_INT64]);
+        value.hasValue = true;
+        value.hasSourceTimestamp = true;
+        value.sourceTimestamp = t * UA_DATETIME_SEC + 1;
+        if (i % 101 == 0) {
+            value.hasStatus = true;
+            value.status = UA_STATUSCODE_BADSENSORFAILURE;
+        }
+        UA_StatusCode ret = backend.serverSetHistoryData(NULL, backend.context, NULL, NULL,
+                                                         &nodeId, UA_FALSE, &value);
+        ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+    }
+
+    UA_UInt32 seed = 1;
+    for (size_t i = 0; i < 200; ++i) {
+        seed = seed * 1103515245 + 12345;
+        UA_DateTime start = (UA_DateTime)(seed % (ROLLUP_SAMPLES * 10)) * UA_DATETIME_SEC / 10;
+        seed = seed * 1103515245 + 12345;
+        UA_DateTime length = (UA_DateTime)(seed % (ROLLUP_SAMPLES * 10)) * UA_DATETIME_SEC / 10;
+        if (i % 4 == 0) {
+            /* Aligned to minutes and hours */
+            start -= start % (60 * UA_DATETIME_SEC);
+            length -= length % (3600 * UA_DATETIME_SEC);
+        }
+        UA_HistoryDataSummary rollup, raw;
+        UA_StatusCode ret = backend.getSummary(NULL, backend.context, NULL, NULL, &nodeId,
+                                               start, start + length, &rollup);
+        ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+        ret = UA_HistoryDataSummary_read(NULL, NULL, NULL, &memory, &nodeId,
+                                         start, start + length, &raw);
+        ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+        assertSummaryEqual(&rollup, &raw);
+    }
+
+    /* The whole series */
+    UA_HistoryDataSummary rollup, raw;
+    backend.getSummary(NULL, backend.context, NULL, NULL, &nodeId, 0,
+                       ROLLUP_SAMPLES * UA_DATETIME_SEC, &rollup);
+    UA_HistoryDataSummary_read(NULL, NULL, NULL, &memory, &nodeId, 0,
+                               ROLLUP_SAMPLES * UA_DATETIME_SEC, &raw);
+    ck_assert_uint_eq(raw.count, ROLLUP_SAMPLES - (ROLLUP_SAMPLES - 1) / 101);
+    assertSummaryEqual(&rollup, &raw);
+
+    UA_HistoryDataBackend_Rollup_deleteMembers(&backend);
+    UA_HistoryDataBackend_Memory_deleteMembers(&memory);
+}
+END_TEST
+
+START_TEST(Server_HistoryReadProcessedRollup)
+{
+    UA_HistoryDataBackend memory = UA_HistoryDataBackend_Memory(1, 8000);
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Rollup(memory);
+    registerProcessedBackend(backend, 100);
+    fillProcessed(&backend, 7200);
+
+    /* Hourly averages from the rollups and the raw samples */
+    UA_DateTime start = PROCESSED_START + 30 * UA_DATETIME_SEC;
+    UA_DateTime end = start + 7200 * UA_DATETIME_SEC;
+    UA_HistoryReadResponse response;
+    UA_HistoryData *data = readProcessed(start, end, 3600000, UA_NS0ID_AGGREGATEFUNCTION_AVERAGE,
+                                         &response, 2);
+    ck_assert(fabs(processedValue(&data->dataValues[0]) - (30.0 + 3629.0) / 2.0) < 1e-6);
+    ck_assert(fabs(processedValue(&data->dataValues[1]) - (3630.0 + 7199.0) / 2.0) < 1e-6);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    data = readProcessed(start, end, 3600000, UA_NS0ID_AGGREGATEFUNCTION_TIMEAVERAGE,
+                         &response, 2);
+    ck_assert_uint_eq(data->dataValues[0].status, STATUS_CALCULATED);
+    ck_assert(fabs(processedValue(&data->dataValues[0]) - (30.0 + 3630.0) / 2.0) < 1e-6);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    data = readProcessed(start, end, 3600000, UA_NS0ID_AGGREGATEFUNCTION_MINIMUMACTUALTIME,
+                         &response, 2);
+    ck_assert(processedValue(&data->dataValues[1]) == 3630.0);
+    ck_assert_int_eq(data->dataValues[1].sourceTimestamp, PROCESSED_START + 3630 * UA_DATETIME_SEC);
+    UA_HistoryReadResponse_deleteMembers(&response);
+
+    UA_HistoryDataBackend_Rollup_deleteMembers(&backend);
+    UA_HistoryDataBackend_Memory_deleteMembers(&memory);
+}
+END_TEST
+
+/* Sample with both timestamps at the given second */
+#define CURSOR_START 10000
+
+static void
+cursorSetValue(UA_HistoryDataBackend *backend, UA_Int64 second, const UA_ByteString *payload)
+{
+    UA_DataValue value;
+    UA_DataValue_init(&value);
+    if (payload)
+        UA_Variant_setScalar(&value.value, (void*)(uintptr_t)payload, &UA_TYPES[UA_TYPES_BYTESTRING]);
+    else
+        UA_Variant_setScalar(&value.value, &second, &UA_TYPES[UA_TYPES_INT64]);
+    value.hasValue = true;
+    value.hasSourceTimestamp = true;
+    value.sourceTimestamp = second * UA_DATETIME_SEC;
+    value.hasServerTimestamp = true;
+    value.serverTimestamp = second * UA_DATETIME_SEC;
+    UA_StatusCode ret = backend->serverSetHistoryData(server, backend->context, NULL, NULL,
+                                                      &outNodeId, UA_FALSE, &value);
+    ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+}
+
+typedef void (*cursorModify)(UA_HistoryDataBackend *backend, size_t response);
+
+/* Reads the range with continuation points and stores the seconds of the
+ * samples. modify is called between the responses. Returns the number of
+ * responses. */
+static size_t
+cursorReadAll(UA_Int64 start, UA_Int64 end, size_t maxResponseSize,
+              UA_Int64 *seconds, size_t *secondsSize,
+              UA_HistoryDataBackend *backend, cursorModify modify)
+{
+    UA_ByteString continuationPoint;
+    UA_ByteString_init(&continuationPoint);
+    size_t responses = 0;
+    *secondsSize = 0;
+    do {
+        UA_HistoryReadResponse response;
+        UA_HistoryReadResponse_init(&response);
+        requestHistory(start * UA_DATETIME_SEC, end * UA_DATETIME_SEC, &response, 0, false,
+                       &continuationPoint);
+        ++responses;
+        ck_assert_uint_eq(response.resultsSize, 1);
+        ck_assert_str_eq(UA_StatusCode_name(response.results[0].statusCode),
+                         UA_StatusCode_name(UA_STATUSCODE_GOOD));
+        UA_HistoryData *data = (UA_HistoryData*)response.results[0].historyData.content.decoded.data;
+        ck_assert_uint_gt(data->dataValuesSize, 0);
+        ck_assert_uint_le(data->dataValuesSize, maxResponseSize);
+        for (size_t i = 0; i < data->dataValuesSize; ++i)
+            seconds[(*secondsSize)++] = data->dataValues[i].sourceTimestamp / UA_DATETIME_SEC;
+        UA_ByteString_deleteMembers(&continuationPoint);
+        UA_ByteString_copy(&response.results[0].continuationPoint, &continuationPoint);
+        UA_HistoryReadResponse_deleteMembers(&response);
+        if (modify && continuationPoint.length > 0)
+            modify(backend, responses);
+    } while (continuationPoint.length > 0);
+    return responses;
+}
+
+/* An older sample moves all samples in the storage. A newer sample is
+ * outside of the requested range. */
+static void
+cursorInsertOutside(UA_HistoryDataBackend *backend, size_t response)
+{
+    cursorSetValue(backend, CURSOR_START - (UA_Int64)response, NULL);
+    cursorSetValue(backend, 2 * CURSOR_START + (UA_Int64)response, NULL);
+}
+
+START_TEST(Server_HistoryReadRaw_cursor)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Memory(1, 6000);
+    registerProcessedBackend(backend, 1000);
+    for (UA_Int64 i = 0; i < 5000; ++i)
+        cursorSetValue(&backend, CURSOR_START + i, NULL);
+
+    UA_Int64 *seconds = (UA_Int64*)UA_malloc(6000 * sizeof(UA_Int64));
+    size_t secondsSize = 0;
+    size_t responses = cursorReadAll(CURSOR_START, CURSOR_START + 5000, 1000,
+                                     seconds, &secondsSize, &backend, cursorInsertOutside);
+    ck_assert_uint_eq(responses, 5);
+    ck_assert_uint_eq(secondsSize, 5000);
+    for (size_t i = 0; i < secondsSize; ++i)
+        ck_assert_int_eq(seconds[i], CURSOR_START + (UA_Int64)i);
+
+    /* Reverse order. The end of the range is excluded. */
+    responses = cursorReadAll(CURSOR_START + 4999, CURSOR_START - 1, 1000,
+                              seconds, &secondsSize, &backend, cursorInsertOutside);
+    ck_assert_uint_eq(responses, 5);
+    ck_assert_uint_eq(secondsSize, 5000);
+    for (size_t i = 0; i < secondsSize; ++i)
+        ck_assert_int_eq(seconds[i], CURSOR_START + 4999 - (UA_Int64)i);
+
+    UA_free(seconds);
+    UA_HistoryDataBackend_Memory_deleteMembers(&backend);
+}
+END_TEST
+
+/* Newer samples replace the oldest samples in the full ring */
+static void
+cursorAppendRing(UA_HistoryDataBackend *backend, size_t response)
+{
+    for (UA_Int64 i = 0; i < 50; ++i)
+        cursorSetValue(backend, CURSOR_START + 950 + (UA_Int64)response * 50 + i, NULL);
+}
+
+START_TEST(Server_HistoryReadRaw_cursorRing)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_MemoryRing(1, 1000, 0);
+    registerProcessedBackend(backend, 100);
+    for (UA_Int64 i = 0; i < 1000; ++i)
+        cursorSetValue(&backend, CURSOR_START + i, NULL);
+
+    /* The cursor points to the same sample after the ring wrapped around */
+    UA_Int64 seconds[1000];
+    size_t secondsSize = 0;
+    size_t responses = cursorReadAll(CURSOR_START, CURSOR_START + 1000, 100,
+                                     seconds, &secondsSize, &backend, cursorAppendRing);
+    ck_assert_uint_eq(responses, 10);
+    ck_assert_uint_eq(secondsSize, 1000);
+    for (size_t i = 0; i < secondsSize; ++i)
+        ck_assert_int_eq(seconds[i], CURSOR_START + (UA_Int64)i);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&backend);
+}
+END_TEST
+
+START_TEST(Server_HistoryReadRaw_cursorMessageSize)
+{
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Memory(1, 300);
+    registerProcessedBackend(backend, 1000);
+    UA_ByteString payload;
+    ck_assert_uint_eq(UA_ByteString_allocBuffer(&payload, 1000), UA_STATUSCODE_GOOD);
+    memset(payload.data, 'x', payload.length);
+    for (UA_Int64 i = 0; i < 300; ++i)
+        cursorSetValue(&backend, CURSOR_START + i, &payload);
+    UA_ByteString_deleteMembers(&payload);
+
+    UA_Int64 seconds[300];
+    size_t secondsSize = 0;
+    size_t responses = cursorReadAll(CURSOR_START, CURSOR_START + 300, 1000,
+                                     seconds, &secondsSize, &backend, NULL);
+    ck_assert_uint_eq(responses, 1);
+
+    /* About 64 samples fit into a message */
+    UA_UInt32 maxMessageSize = config->networkLayers[0].localConnectionConfig.maxMessageSize;
+    config->networkLayers[0].localConnectionConfig.maxMessageSize = 1 << 16;
+    responses = cursorReadAll(CURSOR_START, CURSOR_START + 300, 64,
+                                     seconds, &secondsSize, &backend, NULL);
+    config->networkLayers[0].localConnectionConfig.maxMessageSize = maxMessageSize;
+    ck_assert_uint_eq(responses, 5);
+    ck_assert_uint_eq(secondsSize, 300);
+    for (size_t i = 0; i < secondsSize; ++i)
+        ck_assert_int_eq(seconds[i], CURSOR_START + (UA_Int64)i);
+    UA_HistoryDataBackend_Memory_deleteMembers(&backend);
+}
+END_TEST
+
+#ifdef UA_ENABLE_HISTORIZING_FILE
+
+static char fileBackendDir[64];
+
+static void
+makeFileBackendDir(void)
+{
+    strcpy(fileBackendDir, "/tmp/ua_historyXXXXXX");
+    ck_assert_ptr_ne(mkdtemp(fileBackendDir), NULL);
+}
+
+static void
+removeFileBackendDir(void)
+{
+    DIR *dir = opendir(fileBackendDir);
+    ck_assert_ptr_ne(dir, NULL);
+    struct dirent *entry;
+    char path[512];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", fileBackendDir, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+    rmdir(fileBackendDir);
+}
+
+START_TEST(Server_HistorizingBackendFile)
+{
+    makeFileBackendDir();
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_File(fileBackendDir, 0);
+    ck_assert_ptr_ne(backend.context, NULL);
+    checkHistorizingBackend(backend);
+    UA_HistoryDataBackend_File_deleteMembers(&backend);
+    removeFileBackendDir();
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendFile_reopen)
+{
+    makeFileBackendDir();
+    UA_NodeId nodeA = UA_NODEID_NUMERIC(1, 1000);
+    UA_NodeId nodeB = UA_NODEID_STRING(1, "the.other.node");
+
+    /* Ten segments with 100 samples each. Every tenth sample of node A
+     * arrives late. */
+    UA_HistoryDataBackend backend =
+        UA_HistoryDataBackend_File(fileBackendDir, 100 * UA_DATETIME_SEC);
+    ck_assert_ptr_ne(backend.context, NULL);
+    for (UA_Int64 i = 0; i < 1000; ++i) {
+        if (i % 10 != 5)
+            backendSetValue(&backend, &nodeA, i * UA_DATETIME_SEC, i);
+        if (i % 10 == 9)
+            backendSetValue(&backend, &nodeA, (i - 4) * UA_DATETIME_SEC, i - 4);
+        backendSetValue(&backend, &nodeB, i * UA_DATETIME_SEC, -i);
+    }
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeA), 1000);
+    UA_HistoryDataBackend_File_deleteMembers(&backend);
+
+    /* Append an incomplete record to the last segment of node A */
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%08x_%016llx.seg", fileBackendDir, 0u,
+             (unsigned long long)9);
+    FILE *f = fopen(path, "ab");
+    ck_assert_ptr_ne(f, NULL);
+    fwrite("garbage", 1, 7, f);
+    fclose(f);
+
+    backend = UA_HistoryDataBackend_File(fileBackendDir, 100 * UA_DATETIME_SEC);
+    ck_assert_ptr_ne(backend.context, NULL);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeA), 1000);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeB), 1000);
+    for (size_t i = 0; i < 1000; ++i) {
+        ck_assert_int_eq(backendGetValue(&backend, &nodeA, i), (UA_Int64)i);
+        ck_assert_int_eq(backendGetValue(&backend, &nodeB, i), -(UA_Int64)i);
+    }
+    size_t index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeA,
+                                            555 * UA_DATETIME_SEC, MATCH_EQUAL);
+    ck_assert_uint_eq(index, 555);
+    index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeA,
+                                     555 * UA_DATETIME_SEC + 1, MATCH_EQUAL);
+    ck_assert_uint_eq(index, 1000);
+    index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeA,
+                                     555 * UA_DATETIME_SEC, MATCH_AFTER);
+    ck_assert_uint_eq(index, 556);
+    index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeA,
+                                     600 * UA_DATETIME_SEC - 1, MATCH_EQUAL_OR_AFTER);
+    ck_assert_uint_eq(index, 600);
+    index = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeA,
+                                     600 * UA_DATETIME_SEC - 1, MATCH_BEFORE);
+    ck_assert_uint_eq(index, 599);
+
+    /* Continue writing after the restart */
+    backendSetValue(&backend, &nodeA, 1000 * UA_DATETIME_SEC, 1000);
+    backendSetValue(&backend, &nodeA, 999 * UA_DATETIME_SEC + 1, -1);
+    ck_assert_uint_eq(backend.getEnd(NULL, backend.context, NULL, NULL, &nodeA), 1002);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeA, 999), 999);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeA, 1000), -1);
+    ck_assert_int_eq(backendGetValue(&backend, &nodeA, 1001), 1000);
+    UA_HistoryDataBackend_File_deleteMembers(&backend);
+    removeFileBackendDir();
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendFile_copyRange)
+{
+    makeFileBackendDir();
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_File(fileBackendDir, 0);
+    ck_assert_ptr_ne(backend.context, NULL);
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(1, 1);
+    for (UA_Int64 i = 0; i < 10000; ++i)
+        backendSetValue(&backend, &nodeId, i * UA_DATETIME_MSEC, i);
+
+    size_t start = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeId,
+                                            5000 * UA_DATETIME_MSEC, MATCH_EQUAL_OR_AFTER);
+    size_t end = backend.getDateTimeMatch(NULL, backend.context, NULL, NULL, &nodeId,
+                                          5999 * UA_DATETIME_MSEC, MATCH_EQUAL_OR_BEFORE);
+    ck_assert_uint_eq(start, 5000);
+    ck_assert_uint_eq(end, 5999);
+
+    /* Read in two pages with a continuation point */
+    UA_DataValue values[600];
+    size_t provided = 0;
+    UA_ByteString cp = UA_BYTESTRING_NULL;
+    UA_ByteString outCp = UA_BYTESTRING_NULL;
+    UA_NumericRange range;
+    range.dimensionsSize = 0;
+    range.dimensions = NULL;
+    UA_StatusCode ret =
+        backend.copyDataValues(NULL, backend.context, NULL, NULL, &nodeId, start, end,
+                               false, 600, range, false, &cp, &outCp, &provided, values);
+    ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(provided, 600);
+    ck_assert_uint_eq(outCp.length, sizeof(size_t));
+    for (size_t i = 0; i < 600; ++i) {
+        ck_assert_int_eq(*(UA_Int64*)values[i].value.data, 5000 + (UA_Int64)i);
+        UA_DataValue_deleteMembers(&values[i]);
+    }
+    UA_ByteString cp2 = UA_BYTESTRING_NULL;
+    ret = backend.copyDataValues(NULL, backend.context, NULL, NULL, &nodeId, start, end,
+                                 false, 600, range, false, &outCp, &cp2, &provided, values);
+    ck_assert_uint_eq(ret, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(provided, 400);
+    ck_assert_uint_eq(cp2.length, 0);
+    for (size_t i = 0; i < 400; ++i) {
+        ck_assert_int_eq(*(UA_Int64*)values[i].value.data, 5600 + (UA_Int64)i);
+        UA_DataValue_deleteMembers(&values[i]);
+    }
+    UA_ByteString_deleteMembers(&outCp);
+    UA_HistoryDataBackend_File_deleteMembers(&backend);
+    removeFileBackendDir();
 }
 END_TEST
 
+#endif /* UA_ENABLE_HISTORIZING_FILE */
+
+#ifdef UA_ENABLE_HISTORIZING_ASYNC
+
+START_TEST(Server_HistorizingBackendAsync)
+{
+    UA_HistoryDataBackend memory = UA_HistoryDataBackend_Memory(1, 1);
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Async(memory, NULL);
+    ck_assert_ptr_ne(backend.context, NULL);
+    checkHistorizingBackend(backend);
+
+    UA_HistoryIngestionStatistics statistics;
+    ck_assert_uint_eq(UA_HistoryDataBackend_Async_getStatistics(&backend, &statistics),
+                      UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(statistics.discarded, 0);
+    ck_assert_uint_eq(statistics.failed, 0);
+    ck_assert_uint_eq(statistics.applied, statistics.enqueued);
+    UA_HistoryDataBackend_Async_deleteMembers(&backend);
+    UA_HistoryDataBackend_Memory_deleteMembers(&memory);
+}
+END_TEST
+
+START_TEST(Server_HistorizingBackendAsync_valueSet)
+{
+    UA_HistoryDataBackend ring = UA_HistoryDataBackend_MemoryRing(1, 0, 0);
+    UA_HistorizingNodeIdSettings setting;
+    setting.historizingBackend = UA_HistoryDataBackend_Async(ring, NULL);
+    ck_assert_ptr_ne(setting.historizingBackend.context, NULL);
+    setting.maxHistoryDataResponseSize = 100;
+    setting.historizingUpdateStrategy = UA_HISTORIZINGUPDATESTRATEGY_VALUESET;
+    serverMutexLock();
+    UA_StatusCode retval = gathering->registerNodeId(server, gathering->context, &outNodeId, setting);
+    serverMutexUnlock();
+    ck_assert_str_eq(UA_StatusCode_name(retval), UA_StatusCode_name(UA_STATUSCODE_GOOD));
+
+    UA_fakeSleep(100);
+    UA_DateTime start = UA_DateTime_now();
+    UA_fakeSleep(100);
+    for (UA_UInt32 i = 0; i < 10; ++i) {
+        retval = setUInt32(client, outNodeId, i);
+        ck_assert_str_eq(UA_StatusCode_name(retval), UA_StatusCode_name(UA_STATUSCODE_GOOD));
+        UA_fakeSleep(100);
+    }
+    UA_DateTime end = UA_DateTime_now();
+
+    UA_HistoryReadResponse response;
+    UA_HistoryReadResponse_init(&response);
+    requestHistory(start, end, &response, 0, false, NULL);
+    ck_assert_uint_eq(response.resultsSize, 1);
+    ck_assert_str_eq(UA_StatusCode_name(response.results[0].statusCode), UA_StatusCode_name(UA_STATUSCODE_GOOD));
+    UA_HistoryData * data = (UA_HistoryData *)response.results[0].historyData.content.decoded.data;
+    ck_assert_uint_eq(data->dataValuesSize, 10);
+    for (size_t j = 0; j < data->dataValuesSize; ++j) {
+        ck_assert(data->dataValues[j].value.type == &UA_TYPES[UA_TYPES_UINT32]);
+        ck_assert_uint_eq(*(UA_UInt32 *)data->dataValues[j].value.data, j);
+    }
+    UA_HistoryReadResponse_deleteMembers(&response);
+    UA_HistoryDataBackend_Async_deleteMembers(&setting.historizingBackend);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&ring);
+}
+END_TEST
+
+#define ASYNC_SAMPLES 5000
+#define ASYNC_WRITERS 4
+
+static void
+asyncSetValue(UA_HistoryDataBackend *backend, const UA_NodeId *nodeId,
+              UA_DateTime timestamp, UA_Int64 v, UA_StatusCode *retval)
+{
+    UA_DataValue value;
+    UA_DataValue_init(&value);
+    UA_Variant_setScalar(&value.value, &v, &UA_TYPES[UA_TYPES_INT64]);
+    value.hasValue = true;
+    value.sourceTimestamp = timestamp;
+    value.hasSourceTimestamp = true;
+    *retval = backend->serverSetHistoryData(NULL, backend->context, NULL, NULL,
+                                            nodeId, UA_FALSE, &value);
+}
+
+/* Checks that the node contains count increasing values */
+static void
+asyncCheckSeries(UA_HistoryDataBackend *backend, const UA_NodeId *nodeId, size_t count)
+{
+    ck_assert_uint_eq(backend->getEnd(NULL, backend->context, NULL, NULL, nodeId), count);
+    UA_Int64 last = -1;
+    for (size_t i = 0; i < count; ++i) {
+        UA_Int64 v = backendGetValue(backend, nodeId, i);
+        ck_assert(v > last);
+        last = v;
+    }
+}
+
+START_TEST(Server_HistorizingBackendAsync_discard)
+{
+    UA_HistoryDataBackend ring = UA_HistoryDataBackend_MemoryRing(1, 0, 0);
+    UA_HistoryIngestionConfig ingestion;
+    memset(&ingestion, 0, sizeof(UA_HistoryIngestionConfig));
+    ingestion.queueSize = 16;
+    ingestion.batchSize = 8;
+    ingestion.overflow = UA_HISTORYINGESTIONOVERFLOW_DISCARD;
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Async(ring, &ingestion);
+    ck_assert_ptr_ne(backend.context, NULL);
+
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(1, 1000);
+    size_t discarded = 0;
+    for (UA_Int64 i = 0; i < ASYNC_SAMPLES; ++i) {
+        UA_StatusCode retval;
+        asyncSetValue(&backend, &nodeId, i * UA_DATETIME_SEC, i, &retval);
+        if (retval == UA_STATUSCODE_BADRESOURCEUNAVAILABLE)
+            ++discarded;
+        else
+            ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+    UA_HistoryDataBackend_Async_flush(&backend);
+
+    UA_HistoryIngestionStatistics statistics;
+    UA_HistoryDataBackend_Async_getStatistics(&backend, &statistics);
+    ck_assert_uint_eq(statistics.discarded, discarded);
+    ck_assert_uint_eq(statistics.enqueued + statistics.discarded, ASYNC_SAMPLES);
+    ck_assert_uint_eq(statistics.applied, statistics.enqueued);
+    ck_assert_uint_eq(statistics.flushes, 0);
+    ck_assert(statistics.maxQueued <= 16);
+    asyncCheckSeries(&backend, &nodeId, statistics.applied);
+
+    UA_HistoryDataBackend_Async_deleteMembers(&backend);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&ring);
+}
+END_TEST
+
+typedef struct {
+    UA_HistoryDataBackend *backend;
+    UA_NodeId nodeId;
+    pthread_t thread;
+} AsyncWriter;
+
+static void *
+asyncWriterLoop(void *data)
+{
+    AsyncWriter *w = (AsyncWriter*)data;
+    /* The timestamps of the writers interleave */
+    for (UA_Int64 i = 0; i < ASYNC_SAMPLES; ++i) {
+        UA_StatusCode retval;
+        asyncSetValue(w->backend, &w->nodeId,
+                      (i * ASYNC_WRITERS + (UA_Int64)w->nodeId.identifier.numeric) * UA_DATETIME_SEC,
+                      i, &retval);
+        if (retval != UA_STATUSCODE_GOOD)
+            return w;
+    }
+    return NULL;
+}
+
+START_TEST(Server_HistorizingBackendAsync_writers)
+{
+    UA_HistoryDataBackend ring = UA_HistoryDataBackend_MemoryRing(ASYNC_WRITERS, 0, 0);
+    UA_HistoryIngestionConfig ingestion;
+    memset(&ingestion, 0, sizeof(UA_HistoryIngestionConfig));
+    ingestion.queueSize = 64;
+    ingestion.batchSize = 32;
+    ingestion.flushInterval = 1;
+    ingestion.overflow = UA_HISTORYINGESTIONOVERFLOW_FLUSH;
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Async(ring, &ingestion);
+    ck_assert_ptr_ne(backend.context, NULL);
+
+    AsyncWriter writers[ASYNC_WRITERS];
+    for (UA_UInt32 i = 0; i < ASYNC_WRITERS; ++i) {
+        writers[i].backend = &backend;
+        writers[i].nodeId = UA_NODEID_NUMERIC(1, i);
+        ck_assert_int_eq(pthread_create(&writers[i].thread, NULL, asyncWriterLoop, &writers[i]), 0);
+    }
+    for (size_t i = 0; i < ASYNC_WRITERS; ++i) {
+        void *result;
+        pthread_join(writers[i].thread, &result);
+        ck_assert_ptr_eq(result, NULL);
+    }
+    UA_HistoryDataBackend_Async_flush(&backend);
+
+    UA_HistoryIngestionStatistics statistics;
+    UA_HistoryDataBackend_Async_getStatistics(&backend, &statistics);
+    ck_assert_uint_eq(statistics.discarded, 0);
+    ck_assert_uint_eq(statistics.enqueued, ASYNC_SAMPLES * ASYNC_WRITERS);
+    ck_assert_uint_eq(statistics.applied, ASYNC_SAMPLES * ASYNC_WRITERS);
+    for (size_t i = 0; i < ASYNC_WRITERS; ++i)
+        asyncCheckSeries(&backend, &writers[i].nodeId, ASYNC_SAMPLES);
+
+    UA_HistoryDataBackend_Async_deleteMembers(&backend);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&ring);
+}
+END_TEST
+
+/* Samples that are still queued are applied when the backend is deleted */
+START_TEST(Server_HistorizingBackendAsync_delete)
+{
+    UA_HistoryDataBackend ring = UA_HistoryDataBackend_MemoryRing(1, 0, 0);
+    UA_HistoryIngestionConfig ingestion;
+    memset(&ingestion, 0, sizeof(UA_HistoryIngestionConfig));
+    ingestion.queueSize = 1024;
+    ingestion.batchSize = 1024;
+    ingestion.flushInterval = 60000;
+    UA_HistoryDataBackend backend = UA_HistoryDataBackend_Async(ring, &ingestion);
+    ck_assert_ptr_ne(backend.context, NULL);
+
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(1, 1000);
+    for (UA_Int64 i = 0; i < 100; ++i)
+        backendSetValue(&backend, &nodeId, (100 - i) * UA_DATETIME_SEC, 100 - i);
+    UA_HistoryDataBackend_Async_deleteMembers(&backend);
+    ck_assert_ptr_eq(backend.context, NULL);
+
+    /* The batch was sorted by timestamp */
+    asyncCheckSeries(&ring, &nodeId, 100);
+    UA_HistoryDataBackend_MemoryRing_deleteMembers(&ring);
+}
+END_TEST
+
+#endif /* UA_ENABLE_HISTORIZING_ASYNC */
+
 #endif /*UA_ENABLE_HISTORIZING*/
 
 static Suite* testSuite_Client(void)
@@ -695,8 +1934,53 @@ static Suite* testSuite_Client(void)
     tcase_add_test(tc_server, Server_HistorizingStrategyUser);
     tcase_add_test(tc_server, Server_HistorizingStrategyValueSet);
     tcase_add_test(tc_server, Server_HistorizingBackendMemory);
+    tcase_add_test(tc_server, Server_HistorizingBackendMemoryRing);
+    tcase_add_test(tc_server, Server_HistorizingBackendCompressed);
+    tcase_add_test(tc_server, Server_HistoryReadProcessed);
+    tcase_add_test(tc_server, Server_HistoryReadProcessed_continuationPoint);
+    tcase_add_test(tc_server, Server_HistoryReadProcessed_limits);
+    tcase_add_test(tc_server, Server_HistoryReadProcessedRollup);
+    tcase_add_test(tc_server, Server_HistoryReadRaw_cursor);
+    tcase_add_test(tc_server, Server_HistoryReadRaw_cursorRing);
+    tcase_add_test(tc_server, Server_HistoryReadRaw_cursorMessageSize);
+#ifdef UA_ENABLE_HISTORIZING_FILE
+    tcase_add_test(tc_server, Server_HistorizingBackendFile);
+#endif
+#ifdef UA_ENABLE_HISTORIZING_ASYNC
+    tcase_add_test(tc_server, Server_HistorizingBackendAsync);
+    tcase_add_test(tc_server, Server_HistorizingBackendAsync_valueSet);
+#endif
 #endif /* UA_ENABLE_HISTORIZING */
     suite_add_tcase(s, tc_server);
+#ifdef UA_ENABLE_HISTORIZING
+    TCase *tc_ring = tcase_create("Server Historical Data Memory Ring");
+    tcase_add_test(tc_ring, Server_HistorizingBackendMemoryRing_maxValues);
+    tcase_add_test(tc_ring, Server_HistorizingBackendMemoryRing_maxAge);
+    tcase_add_test(tc_ring, Server_HistorizingBackendMemoryRing_manyNodes);
+    tcase_add_test(tc_ring, Server_HistorizingBackendMemoryRing_generic);
+    suite_add_tcase(s, tc_ring);
+    TCase *tc_compressed = tcase_create("Server Historical Data Compressed");
+    tcase_add_test(tc_compressed, Server_HistorizingBackendCompressed_ratio);
+    tcase_add_test(tc_compressed, Server_HistorizingBackendCompressed_outOfOrder);
+    tcase_add_test(tc_compressed, Server_HistorizingBackendCompressed_generic);
+    suite_add_tcase(s, tc_compressed);
+    TCase *tc_rollup = tcase_create("Server Historical Data Rollup");
+    tcase_add_test(tc_rollup, Server_HistorizingBackendRollup_summary);
+    suite_add_tcase(s, tc_rollup);
+#ifdef UA_ENABLE_HISTORIZING_FILE
+    TCase *tc_file = tcase_create("Server Historical Data File");
+    tcase_add_test(tc_file, Server_HistorizingBackendFile_reopen);
+    tcase_add_test(tc_file, Server_HistorizingBackendFile_copyRange);
+    suite_add_tcase(s, tc_file);
+#endif
+#ifdef UA_ENABLE_HISTORIZING_ASYNC
+    TCase *tc_async = tcase_create("Server Historical Data Async");
+    tcase_add_test(tc_async, Server_HistorizingBackendAsync_discard);
+    tcase_add_test(tc_async, Server_HistorizingBackendAsync_writers);
+    tcase_add_test(tc_async, Server_HistorizingBackendAsync_delete);
+    suite_add_tcase(s, tc_async);
+#endif
+#endif /* UA_ENABLE_HISTORIZING */
 
     return s;
 }
@@ -0,0 +1,171 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ua_types.h"
+#include "ua_server.h"
+#include "ua_client.h"
+#include "ua_config_default.h"
+#include "ua_client_highlevel.h"
+#include "ua_network_tcp_iouring.h"
+#include "check.h"
+#include "thread_wrapper.h"
+
+UA_Server *server;
+UA_ServerConfig *config;
+UA_Boolean running;
+THREAD_HANDLE server_thread;
+
+#define ARRAYSIZE 100000
+
+static void
+addVariable(void) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    UA_Int32 *array = (UA_Int32*)UA_malloc(ARRAYSIZE * sizeof(UA_Int32));
+    for(UA_Int32 i = 0; i < ARRAYSIZE; i++)
+        array[i] = i;
+    UA_Variant_setArray(&attr.value, array, ARRAYSIZE, &UA_TYPES[UA_TYPES_INT32]);
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", "array");
+    attr.dataType = UA_TYPES[UA_TYPES_INT32].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_Server_addVariableNode(server, UA_NODEID_STRING(1, "array"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, "array"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                              attr, NULL, NULL);
+    UA_free(array);
+}
+
+THREAD_CALLBACK(serverloop) {
+    while(running)
+        UA_Server_run_iterate(server, true);
+    return 0;
+}
+
+static void setup(void) {
+    running = true;
+    config = UA_ServerConfig_new_default();
+
+    /* Replace the default TCP network layer */
+    UA_ConnectionConfig connectionConfig = config->networkLayers[0].localConnectionConfig;
+    config->networkLayers[0].deleteMembers(&config->networkLayers[0]);
+    config->networkLayers[0] =
+        UA_ServerNetworkLayerIOUring(connectionConfig, 4840, &config->logger);
+
+    server = UA_Server_new(config);
+    addVariable();
+    UA_StatusCode retval = UA_Server_run_startup(server);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    THREAD_CREATE(server_thread, serverloop);
+}
+
+static void teardown(void) {
+    running = false;
+    THREAD_JOIN(server_thread);
+    UA_Server_run_shutdown(server);
+    UA_Server_delete(server);
+    UA_ServerConfig_delete(config);
+}
+
+static void
+readArray(UA_Client *client) {
+    UA_Variant val;
+    UA_StatusCode retval =
+        UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, "array"), &val);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(val.arrayLength, ARRAYSIZE);
+    UA_Int32 *array = (UA_Int32*)val.data;
+    for(UA_Int32 i = 0; i < ARRAYSIZE; i++)
+        ck_assert_int_eq(array[i], i);
+    UA_Variant_deleteMembers(&val);
+}
+
+START_TEST(IOUring_connect) {
+    UA_Client *client = UA_Client_new(UA_ClientConfig_default);
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_Variant val;
+    retval = UA_Client_readValueAttribute(client,
+                 UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE), &val);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Variant_deleteMembers(&val);
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+}
+END_TEST
+
+/* The response is split into several chunks that are sent as linked operations
+ * and the request can be split across several receive completions */
+START_TEST(IOUring_chunkedMessages) {
+    UA_Client *client = UA_Client_new(UA_ClientConfig_default);
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    for(size_t i = 0; i < 5; i++)
+        readArray(client);
+
+    /* Write the array back (chunked request) */
+    UA_Variant val;
+    retval = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, "array"), &val);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    retval = UA_Client_writeValueAttribute(client, UA_NODEID_STRING(1, "array"), &val);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Variant_deleteMembers(&val);
+    readArray(client);
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+}
+END_TEST
+
+START_TEST(IOUring_multipleClients) {
+    UA_Client *clients[10];
+    for(size_t i = 0; i < 10; i++) {
+        clients[i] = UA_Client_new(UA_ClientConfig_default);
+        UA_StatusCode retval = UA_Client_connect(clients[i], "opc.tcp://localhost:4840");
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+
+    for(size_t i = 0; i < 10; i++)
+        readArray(clients[i]);
+
+    /* Close some connections without a proper disconnect */
+    for(size_t i = 0; i < 10; i += 2) {
+        UA_Client_delete(clients[i]);
+        clients[i] = NULL;
+    }
+
+    for(size_t i = 1; i < 10; i += 2) {
+        readArray(clients[i]);
+        UA_Client_disconnect(clients[i]);
+        UA_Client_delete(clients[i]);
+    }
+}
+END_TEST
+
+static Suite* testSuite_IOUring(void) {
+    Suite *s = suite_create("Server io_uring network layer");
+    TCase *tc = tcase_create("Server io_uring");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, IOUring_connect);
+    tcase_add_test(tc, IOUring_chunkedMessages);
+    tcase_add_test(tc, IOUring_multipleClients);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    Suite *s = testSuite_IOUring();
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr,CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -459,6 +459,275 @@ START_TEST(InstantiateObjectType) {
     ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
 } END_TEST
 
+#define BULKLOAD_PUMPS 100
+
+START_TEST(BulkLoadNodes) {
+    UA_BulkLoad *bl = NULL;
+    UA_StatusCode res = UA_Server_bulkLoad_begin(server, &bl);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* The instances are staged before their types and parents */
+    UA_NodeId folderId = UA_NODEID_NUMERIC(1, 1000);
+    UA_NodeId pumpTypeId = UA_NODEID_NUMERIC(1, 1001);
+    UA_NodeId speedTypeId = UA_NODEID_NUMERIC(1, 1002);
+    for(UA_UInt32 i = 0; i < BULKLOAD_PUMPS; i++) {
+        UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+        oAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Pump");
+        res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 2000 + i),
+                                  folderId, UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                  UA_QUALIFIEDNAME(1, "Pump"), pumpTypeId, &oAttr,
+                                  &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES], NULL);
+        ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+        /* The value is taken from the VariableType */
+        UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+        vAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Speed");
+        vAttr.dataType = UA_TYPES[UA_TYPES_DOUBLE].typeId;
+        vAttr.valueRank = UA_VALUERANK_SCALAR;
+        res = UA_BulkLoad_addNode(bl, UA_NODECLASS_VARIABLE, UA_NODEID_NUMERIC(1, 3000 + i),
+                                  UA_NODEID_NUMERIC(1, 2000 + i),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                  UA_QUALIFIEDNAME(1, "Speed"), speedTypeId, &vAttr,
+                                  &UA_TYPES[UA_TYPES_VARIABLEATTRIBUTES], NULL);
+        ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    }
+
+    UA_ObjectAttributes fAttr = UA_ObjectAttributes_default;
+    fAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Pumps");
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, folderId,
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, "Pumps"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE), &fAttr,
+                              &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES], NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    UA_ObjectTypeAttributes otAttr = UA_ObjectTypeAttributes_default;
+    otAttr.displayName = UA_LOCALIZEDTEXT("en-US", "PumpType");
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECTTYPE, pumpTypeId,
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                              UA_QUALIFIEDNAME(1, "PumpType"), UA_NODEID_NULL, &otAttr,
+                              &UA_TYPES[UA_TYPES_OBJECTTYPEATTRIBUTES], NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    UA_VariableTypeAttributes vtAttr = UA_VariableTypeAttributes_default;
+    vtAttr.displayName = UA_LOCALIZEDTEXT("en-US", "SpeedType");
+    vtAttr.dataType = UA_TYPES[UA_TYPES_DOUBLE].typeId;
+    vtAttr.valueRank = UA_VALUERANK_SCALAR;
+    UA_Double speed = 42.0;
+    UA_Variant_setScalar(&vtAttr.value, &speed, &UA_TYPES[UA_TYPES_DOUBLE]);
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_VARIABLETYPE, speedTypeId,
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                              UA_QUALIFIEDNAME(1, "SpeedType"), UA_NODEID_NULL, &vtAttr,
+                              &UA_TYPES[UA_TYPES_VARIABLETYPEATTRIBUTES], NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* An additional reference from an existing node */
+    res = UA_BulkLoad_addReference(bl, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER),
+                                   UA_NODEID_NUMERIC(0, UA_NS0ID_HASNOTIFIER),
+                                   UA_EXPANDEDNODEID_NUMERIC(1, 1000), true);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    handleCalled = 0;
+    size_t resultsSize = 0;
+    UA_StatusCode *results = NULL;
+    res = UA_BulkLoad_commit(bl, &resultsSize, &results);
+    ck_assert_uint_eq(resultsSize, BULKLOAD_PUMPS * 2 + 4);
+    for(size_t i = 0; i < resultsSize; i++)
+        ck_assert_uint_eq(results[i], UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_Array_delete(results, resultsSize, &UA_TYPES[UA_TYPES_STATUSCODE]);
+
+    /* The global constructor was called for every node */
+    ck_assert_int_eq(handleCalled, BULKLOAD_PUMPS * 2 + 3);
+
+    /* The value was taken from the VariableType */
+    UA_Variant value;
+    res = UA_Server_readValue(server, UA_NODEID_NUMERIC(1, 3000 + BULKLOAD_PUMPS - 1), &value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert(value.type == &UA_TYPES[UA_TYPES_DOUBLE]);
+    ck_assert(*(UA_Double*)value.data == 42.0);
+    UA_Variant_deleteMembers(&value);
+
+    /* Both directions of the references were added */
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = folderId;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(br.referencesSize, BULKLOAD_PUMPS);
+    UA_BrowseResult_deleteMembers(&br);
+
+    bd.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    br = UA_Server_browse(server, 0, &bd);
+    UA_Boolean found = false;
+    for(size_t i = 0; i < br.referencesSize; i++)
+        found |= UA_NodeId_equal(&br.references[i].nodeId.nodeId, &folderId);
+    ck_assert(found);
+    UA_BrowseResult_deleteMembers(&br);
+
+    bd.nodeId = UA_NODEID_NUMERIC(1, 3000);
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+    bd.browseDirection = UA_BROWSEDIRECTION_INVERSE;
+    br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.referencesSize, 1);
+    UA_NodeId pumpId = UA_NODEID_NUMERIC(1, 2000);
+    ck_assert(UA_NodeId_equal(&br.references[0].nodeId.nodeId, &pumpId));
+    UA_BrowseResult_deleteMembers(&br);
+
+    bd.nodeId = folderId;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASNOTIFIER);
+    br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.referencesSize, 1);
+    UA_NodeId serverId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    ck_assert(UA_NodeId_equal(&br.references[0].nodeId.nodeId, &serverId));
+    UA_BrowseResult_deleteMembers(&br);
+} END_TEST
+
+START_TEST(BulkLoadNodesWithErrors) {
+    UA_BulkLoad *bl = NULL;
+    UA_StatusCode res = UA_Server_bulkLoad_begin(server, &bl);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_NodeId objectsId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    UA_NodeId organizesId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    const UA_DataType *oType = &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES];
+
+    /* Rejected when staged */
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NULL, objectsId,
+                              organizesId, UA_QUALIFIEDNAME(1, "Null"), UA_NODEID_NULL,
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_BADNODEIDINVALID);
+
+    /* 0: Ok */
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 1), objectsId,
+                              organizesId, UA_QUALIFIEDNAME(1, "Ok"), UA_NODEID_NULL,
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 1: Unknown parent */
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 2),
+                              UA_NODEID_NUMERIC(1, 999), organizesId,
+                              UA_QUALIFIEDNAME(1, "NoParent"), UA_NODEID_NULL,
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 2: Below the node with the unknown parent */
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 3),
+                              UA_NODEID_NUMERIC(1, 2), organizesId,
+                              UA_QUALIFIEDNAME(1, "Child"), UA_NODEID_NULL,
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 3: Value does not match the DataType */
+    UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+    vAttr.dataType = UA_TYPES[UA_TYPES_DOUBLE].typeId;
+    UA_String str = UA_STRING("not a double");
+    UA_Variant_setScalar(&vAttr.value, &str, &UA_TYPES[UA_TYPES_STRING]);
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_VARIABLE, UA_NODEID_NUMERIC(1, 4), objectsId,
+                              organizesId, UA_QUALIFIEDNAME(1, "Mismatch"), UA_NODEID_NULL,
+                              &vAttr, &UA_TYPES[UA_TYPES_VARIABLEATTRIBUTES], NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 4: Object with a VariableType */
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 5), objectsId,
+                              organizesId, UA_QUALIFIEDNAME(1, "WrongType"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 5: Existing NodeId */
+    UA_NodeId serverId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, serverId, objectsId,
+                              organizesId, UA_QUALIFIEDNAME(1, "Exists"), UA_NODEID_NULL,
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 6: Staged twice */
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 1), objectsId,
+                              organizesId, UA_QUALIFIEDNAME(1, "Twice"), UA_NODEID_NULL,
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 7: Non-hierarchical reference to the parent */
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 8), objectsId,
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_HASMODELLINGRULE),
+                              UA_QUALIFIEDNAME(1, "NotHierarchical"), UA_NODEID_NULL,
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 8: Below the node with the existing NodeId. Not added to the existing
+     * node. */
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 9), serverId,
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                              UA_QUALIFIEDNAME(1, "BelowExisting"), UA_NODEID_NULL,
+                              &oAttr, oType, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 9: Reference to a missing node */
+    res = UA_BulkLoad_addReference(bl, UA_NODEID_NUMERIC(1, 1), organizesId,
+                                   UA_EXPANDEDNODEID_NUMERIC(1, 999), true);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* 10: Reference to the node that failed */
+    res = UA_BulkLoad_addReference(bl, UA_NODEID_NUMERIC(1, 1), organizesId,
+                                   UA_EXPANDEDNODEID_NUMERIC(1, 2), true);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    size_t resultsSize = 0;
+    UA_StatusCode *results = NULL;
+    res = UA_BulkLoad_commit(bl, &resultsSize, &results);
+    ck_assert_uint_eq(res, UA_STATUSCODE_BADPARENTNODEIDINVALID);
+    ck_assert_uint_eq(resultsSize, 11);
+    ck_assert_uint_eq(results[0], UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(results[1], UA_STATUSCODE_BADPARENTNODEIDINVALID);
+    ck_assert_uint_eq(results[2], UA_STATUSCODE_BADPARENTNODEIDINVALID);
+    ck_assert_uint_eq(results[3], UA_STATUSCODE_BADTYPEMISMATCH);
+    ck_assert_uint_eq(results[4], UA_STATUSCODE_BADTYPEDEFINITIONINVALID);
+    ck_assert_uint_eq(results[5], UA_STATUSCODE_BADNODEIDEXISTS);
+    ck_assert_uint_eq(results[6], UA_STATUSCODE_BADNODEIDEXISTS);
+    ck_assert_uint_eq(results[7], UA_STATUSCODE_BADREFERENCETYPEIDINVALID);
+    ck_assert_uint_eq(results[8], UA_STATUSCODE_BADPARENTNODEIDINVALID);
+    ck_assert_uint_eq(results[9], UA_STATUSCODE_BADTARGETNODEIDINVALID);
+    ck_assert_uint_eq(results[10], UA_STATUSCODE_BADTARGETNODEIDINVALID);
+    UA_Array_delete(results, resultsSize, &UA_TYPES[UA_TYPES_STATUSCODE]);
+
+    /* Only the valid node was committed */
+    UA_QualifiedName bn;
+    res = UA_Server_readBrowseName(server, UA_NODEID_NUMERIC(1, 1), &bn);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_QualifiedName expected = UA_QUALIFIEDNAME(1, "Ok");
+    ck_assert(UA_QualifiedName_equal(&bn, &expected));
+    UA_QualifiedName_deleteMembers(&bn);
+    for(UA_UInt32 i = 2; i <= 9; i++) {
+        res = UA_Server_readBrowseName(server, UA_NODEID_NUMERIC(1, i), &bn);
+        ck_assert_uint_eq(res, UA_STATUSCODE_BADNODEIDUNKNOWN);
+    }
+} END_TEST
+
+START_TEST(BulkLoadDiscard) {
+    UA_BulkLoad *bl = NULL;
+    UA_StatusCode res = UA_Server_bulkLoad_begin(server, &bl);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    res = UA_BulkLoad_addNode(bl, UA_NODECLASS_OBJECT, UA_NODEID_NUMERIC(1, 1),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, "Discarded"), UA_NODEID_NULL,
+                              &oAttr, &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES], NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_BulkLoad_delete(bl);
+
+    UA_QualifiedName bn;
+    res = UA_Server_readBrowseName(server, UA_NODEID_NUMERIC(1, 1), &bn);
+    ck_assert_uint_eq(res, UA_STATUSCODE_BADNODEIDUNKNOWN);
+} END_TEST
+
 int main(void) {
     Suite *s = suite_create("services_nodemanagement");
 
@@ -480,6 +749,13 @@ int main(void) {
     tcase_add_test(tc_deletenodes, DeleteObjectAndReferences);
     suite_add_tcase(s, tc_deletenodes);
 
+    TCase *tc_bulkload = tcase_create("bulkload");
+    tcase_add_checked_fixture(tc_bulkload, setup, teardown);
+    tcase_add_test(tc_bulkload, BulkLoadNodes);
+    tcase_add_test(tc_bulkload, BulkLoadNodesWithErrors);
+    tcase_add_test(tc_bulkload, BulkLoadDiscard);
+    suite_add_tcase(s, tc_bulkload);
+
     SRunner *sr = srunner_create(s);
     srunner_set_fork_status(sr, CK_NOFORK);
     srunner_run_all(sr, CK_NORMAL);
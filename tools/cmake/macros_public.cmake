@@ -199,6 +199,8 @@ endfunction()
 #   Options:
 #
 #   [INTERNAL]      Optional argument. If given, then the generated node set code will use internal headers.
+#   [TABLE]         Optional argument. If given, then the nodes are generated as static node tables that are
+#                   loaded in one bulk load (backend open62541_table). Cannot be used for namespace zero.
 #
 #   Arguments taking one value:
 #
@@ -219,7 +221,7 @@ endfunction()
 #
 function(ua_generate_nodeset)
 
-    set(options INTERNAL )
+    set(options INTERNAL TABLE)
     set(oneValueArgs NAME TYPES_ARRAY OUTPUT_DIR ENCODE_BINARY_SIZE IGNORE TARGET_PREFIX)
     set(multiValueArgs FILE DEPENDS_TYPES DEPENDS_NS DEPENDS_TARGET)
     cmake_parse_arguments(UA_GEN_NS "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN} )
@@ -262,6 +264,11 @@ function(ua_generate_nodeset)
         set(GEN_INTERNAL_HEADERS "--internal-headers")
     endif()
 
+    set(GEN_BACKEND "")
+    if (UA_GEN_NS_TABLE)
+        set(GEN_BACKEND "--backend=open62541_table")
+    endif()
+
     set(GEN_NS0 "")
     set(TARGET_SUFFIX "ns-${UA_GEN_NS_NAME}")
     set(FILE_SUFFIX "_${UA_GEN_NS_NAME}")
@@ -306,6 +313,7 @@ function(ua_generate_nodeset)
                        PRE_BUILD
                        COMMAND ${PYTHON_EXECUTABLE} ${open62541_TOOLS_DIR}/nodeset_compiler/nodeset_compiler.py
                        ${GEN_INTERNAL_HEADERS}
+                       ${GEN_BACKEND}
                        ${GEN_NS0}
                        ${GEN_BIN_SIZE}
                        ${GEN_IGNORE}
@@ -320,6 +328,7 @@ function(ua_generate_nodeset)
                        ${open62541_TOOLS_DIR}/nodeset_compiler/datatypes.py
                        ${open62541_TOOLS_DIR}/nodeset_compiler/backend_open62541.py
                        ${open62541_TOOLS_DIR}/nodeset_compiler/backend_open62541_nodes.py
+                       ${open62541_TOOLS_DIR}/nodeset_compiler/backend_open62541_table.py
                        ${open62541_TOOLS_DIR}/nodeset_compiler/backend_open62541_datatypes.py
                        ${UA_GEN_NS_FILE}
                        ${UA_GEN_NS_DEPENDS_NS}
@@ -130,18 +130,13 @@ def sortNodes(nodeset):
 # Generate C Code #
 ###################
 
-def generateOpen62541Code(nodeset, outfilename, generate_ns0=False, internal_headers=False, typesArray=[], encode_binary_size=32000):
+def generateOpen62541Header(outfilename, internal_headers=False, typesArray=[]):
     outfilebase = basename(outfilename)
-    # Printing functions
     outfileh = codecs.open(outfilename + ".h", r"w+", encoding='utf-8')
-    outfilec = StringIO()
 
     def writeh(line):
         print(unicode(line), end='\n', file=outfileh)
 
-    def writec(line):
-        print(unicode(line), end='\n', file=outfilec)
-
     additionalHeaders = ""
     if len(typesArray) > 0:
         for arr in set(typesArray):
@@ -211,6 +206,19 @@ _UA_END_DECLS
 
 #endif /* %s_H_ */""" % \
            (outfilebase, outfilebase.upper()))
+    outfileh.flush()
+    os.fsync(outfileh)
+    outfileh.close()
+
+def generateOpen62541Code(nodeset, outfilename, generate_ns0=False, internal_headers=False, typesArray=[], encode_binary_size=32000):
+    outfilebase = basename(outfilename)
+    generateOpen62541Header(outfilename, internal_headers, typesArray)
+
+    # Printing functions
+    outfilec = StringIO()
+
+    def writec(line):
+        print(unicode(line), end='\n', file=outfilec)
 
     writec("""/* WARNING: This is a generated file.
  * Any manual changes will be overwritten. */
@@ -299,9 +307,6 @@ UA_StatusCode retVal = UA_STATUSCODE_GOOD;""" % (outfilebase))
         writec("retVal |= function_" + outfilebase + "_" + str(i) + "_finish(server, ns);")
 
     writec("return retVal;\n}")
-    outfileh.flush()
-    os.fsync(outfileh)
-    outfileh.close()
     fullCode = outfilec.getvalue()
     outfilec.close()
 
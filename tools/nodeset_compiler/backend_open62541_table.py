@@ -0,0 +1,437 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+###
+### This program was created for educational purposes and has been
+### contributed to the open62541 project by the author. All licensing
+### terms for this source is inherited by the terms and conditions
+### specified for by the open62541 project (see the projects readme
+### file for more information on the LGPL terms and restrictions).
+###
+### This program is not meant to be used in a production environment. The
+### author is not liable for any complications arising due to the use of
+### this program.
+###
+
+# Generates the nodes of a nodeset as static const tables (UA_NodeTable) that
+# are loaded with UA_Server_loadNodeTable. Strings and values are pooled in one
+# byte array in the binary encoding of OPC UA.
+
+from __future__ import print_function
+from os.path import basename
+import logging
+import codecs
+import struct
+import re
+import os
+try:
+    from StringIO import StringIO
+except ImportError:
+    from io import StringIO
+
+import sys
+if sys.version_info[0] >= 3:
+    # strings are already parsed to unicode
+    def unicode(s):
+        return s
+
+logger = logging.getLogger(__name__)
+
+from datatypes import *
+from nodes import *
+from nodeset import *
+from backend_open62541 import sortNodes, generateOpen62541Header
+from backend_open62541_datatypes import makeCIdentifier
+from backend_open62541_nodes import getTypeBrowseName, getTypesArrayForValue, isArrayVariableNode
+# after the star imports, datatypes exports the datetime class
+import datetime
+
+NONE = "UA_NODETABLE_NONE"
+NODETABLE_NONE = 0xffffffff
+
+class Pool(object):
+    """ Byte pool of the table. Equal entries are stored only once. """
+    def __init__(self):
+        self.data = bytearray()
+        self.positions = {}
+
+    def add(self, blob):
+        blob = bytes(blob)
+        if blob in self.positions:
+            return self.positions[blob]
+        pos = len(self.data)
+        self.data.extend(blob)
+        self.positions[blob] = pos
+        return pos
+
+    def addString(self, value):
+        if value is None or len(value) == 0:
+            return NODETABLE_NONE
+        return self.add(encodeString(value))
+
+def encodeString(value):
+    if value is None:
+        return struct.pack("<i", -1)
+    data = unicode(value).encode("utf-8")
+    return struct.pack("<i", len(data)) + data
+
+def encodeNodeId(value):
+    if value.i is not None:
+        if value.ns == 0 and value.i <= 0xff:
+            return struct.pack("<BB", 0, value.i)
+        if value.ns <= 0xff and value.i <= 0xffff:
+            return struct.pack("<BBH", 1, value.ns, value.i)
+        return struct.pack("<BHI", 2, value.ns, value.i)
+    if value.s is not None:
+        return struct.pack("<BH", 3, value.ns) + encodeString(value.s)
+    if value.g is not None and len(value.g) == 5:
+        return struct.pack("<BH", 4, value.ns) + encodeGuid(value.g)
+    return None
+
+def encodeGuid(g):
+    return struct.pack("<IHH", g[0], g[1], g[2]) + struct.pack(">H", g[3]) + \
+        struct.pack(">Q", g[4])[2:]
+
+numberFormats = {SByte: "<b", Byte: "<B", Int16: "<h", UInt16: "<H",
+                 Int32: "<i", UInt32: "<I", StatusCode: "<I",
+                 Int64: "<q", UInt64: "<Q", Float: "<f", Double: "<d"}
+
+def encodeValue(value):
+    """ Returns the binary encoding of the value or None if the value cannot
+        be encoded. ExtensionObjects are encoded as their body. """
+    t = type(value)
+    if t == Boolean:
+        return struct.pack("<B", 1 if value.value == "true" else 0)
+    if t in numberFormats:
+        try:
+            return struct.pack(numberFormats[t], value.value)
+        except struct.error:
+            return None
+    if t == String or t == XmlElement:
+        return encodeString(value.value)
+    if t == ByteString:
+        if not value.value:
+            return struct.pack("<i", 0)
+        data = re.sub(r">\s*<", "><", re.sub(r"[\r\n]+", "", value.value))
+        data = data.encode("utf-8")
+        return struct.pack("<i", len(data)) + data
+    if t == LocalizedText:
+        mask = (0x01 if value.locale else 0) | (0x02 if value.text else 0)
+        blob = struct.pack("<B", mask)
+        if value.locale:
+            blob += encodeString(value.locale)
+        if value.text:
+            blob += encodeString(value.text)
+        return blob
+    if t == QualifiedName:
+        return struct.pack("<H", value.ns) + encodeString(value.name)
+    if t == NodeId:
+        return encodeNodeId(value)
+    if t == Guid:
+        if len(value.value) != 5:
+            return None
+        return encodeGuid(value.value)
+    if t == DateTime:
+        epoch = datetime.datetime.utcfromtimestamp(0)
+        mSecsSinceEpoch = int((value.value - epoch).total_seconds() * 1000.0)
+        return struct.pack("<q", mSecsSinceEpoch * 10000 + 116444736000000000)
+    if t == ExtensionObject:
+        if not isinstance(value.value, list) or len(value.value) != len(value.encodingRule):
+            return None
+        blob = b""
+        for field in value.value:
+            if field is None:
+                return None
+            if field.valueRank is not None and field.valueRank != 0:
+                # Array fields are not parsed. Encode an empty array.
+                blob += struct.pack("<i", -1)
+                continue
+            fieldBlob = encodeValue(field)
+            if fieldBlob is None:
+                return None
+            blob += fieldBlob
+        return blob
+    return None
+
+def typeArrayCode(dataTypeNode):
+    typeArr = dataTypeNode.typesArray
+    return "&" + typeArr + "[" + typeArr + "_" + getTypeBrowseName(dataTypeNode).upper() + "]"
+
+class NodeTable(object):
+    def __init__(self, nodeset):
+        self.nodeset = nodeset
+        self.pool = Pool()
+        self.nodes = []
+        self.variables = []
+        self.references = []
+        self.descriptions = []
+
+    def tableId(self, nodeid):
+        if not nodeid:
+            return "{0, UA_NODEIDTYPE_NUMERIC, 0}"
+        if nodeid.i is not None:
+            return "{%d, UA_NODEIDTYPE_NUMERIC, %d}" % (nodeid.ns, nodeid.i)
+        if nodeid.s is not None:
+            return "{%d, UA_NODEIDTYPE_STRING, %d}" % (nodeid.ns, self.pool.addString(nodeid.s))
+        raise Exception(str(nodeid) + " no NodeID generation for bytestring and guid..")
+
+    def position(self, pos):
+        if pos == NODETABLE_NONE:
+            return NONE
+        return str(pos)
+
+    def encodeVariableValue(self, node):
+        """ Returns (type, size, position) for the value of the variable or
+            None if the value cannot be encoded """
+        value = node.value
+        if len(value.value) == 0 or not isinstance(value.value[0], Value):
+            return None
+        values = value.value
+        if isArrayVariableNode(value, node):
+            typeCode = typeArrayCode(self.nodeset.getDataTypeNode(node.dataType))
+            size = len(values)
+        else:
+            if isinstance(value.value[0], ExtensionObject):
+                typeCode = typeArrayCode(self.nodeset.getDataTypeNode(node.dataType))
+            else:
+                typeCode = getTypesArrayForValue(self.nodeset, value.value[0])
+            size = -1
+            values = values[:1]
+        blob = b""
+        for v in values:
+            vblob = encodeValue(v)
+            if vblob is None:
+                logger.warn("Don't know how to encode the value of type " + v.__class__.__name__ +
+                            " in node " + str(node.id))
+                return None
+            blob += vblob
+        return (typeCode, size, self.pool.add(blob))
+
+    def addVariable(self, node):
+        isType = isinstance(node, VariableTypeNode)
+        if not isType and node.valueRank == -2:
+            # in order to be compatible with mostly OPC UA client
+            # force valueRank = -1 for scalar VariableNode
+            node.valueRank = -1
+
+        dataTypeId = NodeId("i=24")
+        dataTypeNode = None
+        if node.dataType is not None:
+            if isinstance(node.dataType, NodeId) and node.dataType.ns == 0 and node.dataType.i == 0:
+                # BaseDataType
+                dataTypeNode = self.nodeset.nodes[NodeId("i=24")]
+                dataTypeId = dataTypeNode.id
+            else:
+                dataTypeNode = self.nodeset.getBaseDataType(self.nodeset.getDataTypeNode(node.dataType))
+                if dataTypeNode is not None:
+                    # VariableTypes use the builtin DataType
+                    dataTypeId = dataTypeNode.id if isType else \
+                                 self.nodeset.getDataTypeNode(node.dataType).id
+
+        value = None
+        if dataTypeNode is not None and dataTypeNode.isEncodable():
+            if node.value is not None:
+                value = self.encodeVariableValue(node)
+            elif node.valueRank > 0:
+                value = (typeArrayCode(dataTypeNode), 0, NODETABLE_NONE)
+            elif not dataTypeNode.isAbstract:
+                value = (typeArrayCode(dataTypeNode), -1, NODETABLE_NONE)
+        if value is None:
+            value = ("NULL", -1, NODETABLE_NONE)
+
+        arrayDimensions = NODETABLE_NONE
+        if node.valueRank > 0:
+            dims = [0] * node.valueRank
+            if len(node.arrayDimensions) == node.valueRank:
+                dims = [int(str(v)) for v in node.arrayDimensions]
+            arrayDimensions = self.pool.add(struct.pack("<%dI" % len(dims), *dims))
+
+        self.variables.append("{%s, %s, %d, %s, %d, %s, %f, %d, %d}, /* %s */" % \
+                              (value[0], self.tableId(dataTypeId), node.valueRank,
+                               self.position(arrayDimensions), value[1],
+                               self.position(value[2]), node.minimumSamplingInterval,
+                               node.accessLevel, node.userAccessLevel, str(node.id)))
+        return len(self.variables) - 1
+
+    def addNode(self, node, parentref):
+        flags = []
+        eventNotifier = 0
+        variable = NODETABLE_NONE
+        inverseName = NODETABLE_NONE
+        typeDefinition = NodeId()
+
+        if isinstance(node, VariableNode) or isinstance(node, ObjectNode):
+            typeDefinition = node.popTypeDef().target
+        if getattr(node, "isAbstract", False):
+            flags.append("UA_NODETABLE_ISABSTRACT")
+        if isinstance(node, ReferenceTypeNode):
+            if node.symmetric:
+                flags.append("UA_NODETABLE_SYMMETRIC")
+            inverseName = self.pool.addString(node.inverseName)
+        elif isinstance(node, ObjectNode):
+            eventNotifier = 1 if node.eventNotifier else 0
+        elif isinstance(node, VariableNode):
+            if node.historizing and not isinstance(node, VariableTypeNode):
+                flags.append("UA_NODETABLE_HISTORIZING")
+            variable = self.addVariable(node)
+        elif isinstance(node, MethodNode):
+            if node.executable:
+                flags.append("UA_NODETABLE_EXECUTABLE")
+            if node.userExecutable:
+                flags.append("UA_NODETABLE_USEREXECUTABLE")
+        elif isinstance(node, ViewNode):
+            if node.containsNoLoops:
+                flags.append("UA_NODETABLE_CONTAINSNOLOOPS")
+            eventNotifier = int(node.eventNotifier)
+
+        nodeClass = "UA_NODECLASS_" + makeCIdentifier(node.__class__.__name__.upper().replace("NODE", ""))
+        self.nodes.append({"comment": "%s - %s" % (str(node.displayName), str(node.id)),
+                           "nodeClass": nodeClass,
+                           "flags": " | ".join(flags) if flags else "0",
+                           "eventNotifier": eventNotifier,
+                           "nodeId": self.tableId(node.id),
+                           "parentNodeId": self.tableId(parentref.target),
+                           "referenceTypeId": self.tableId(parentref.referenceType),
+                           "typeDefinition": self.tableId(typeDefinition),
+                           "browseNameNamespace": node.browseName.ns,
+                           "browseName": self.pool.addString(node.browseName.name),
+                           "displayNameLocale": self.pool.addString(node.displayName.locale),
+                           "displayNameText": self.pool.addString(node.displayName.text),
+                           "inverseName": inverseName,
+                           "writeMask": node.writeMask,
+                           "userWriteMask": node.userWriteMask,
+                           "variable": variable})
+        self.descriptions.append(node.description)
+
+    def addReference(self, ref):
+        self.references.append("{%s, %s, %s, %s}," % \
+                               (self.tableId(ref.source), self.tableId(ref.referenceType),
+                                self.tableId(ref.target), "true" if ref.isForward else "false"))
+
+def writeArray(writec, ctype, name, entries):
+    if len(entries) == 0:
+        return
+    writec("\nstatic const %s %s[%d] = {" % (ctype, name, len(entries)))
+    for e in entries:
+        writec(e)
+    writec("};")
+
+def writePoolBytes(writec, data):
+    for i in range(0, len(data), 32):
+        writec(",".join(str(b) for b in bytearray(data[i:i+32])) + ",")
+
+###################
+# Generate C Code #
+###################
+
+def generateOpen62541TableCode(nodeset, outfilename, internal_headers=False, typesArray=[]):
+    outfilebase = basename(outfilename)
+    generateOpen62541Header(outfilename, internal_headers, typesArray)
+
+    outfilec = StringIO()
+
+    def writec(line):
+        print(unicode(line), end='\n', file=outfilec)
+
+    writec("""/* WARNING: This is a generated file.
+ * Any manual changes will be overwritten. */
+
+#include "%s.h\"""" % (outfilebase))
+
+    # Loop over the sorted nodes
+    logger.info("Reordering nodes for minimal dependencies during printing")
+    sorted_nodes = sortNodes(nodeset)
+    logger.info("Writing tables for nodes and references")
+
+    parentreftypes = getSubTypesOf(nodeset, nodeset.getNodeByBrowseName("HierarchicalReferences"))
+    parentreftypes = list(map(lambda x: x.id, parentreftypes))
+
+    table = NodeTable(nodeset)
+    namespaces = [table.pool.addString(nsid) for nsid in nodeset.namespaces]
+
+    printed_ids = set()
+    for node in sorted_nodes:
+        printed_ids.add(node.id)
+
+        parentref = node.popParentRef(parentreftypes)
+        if not node.hidden:
+            table.addNode(node, parentref)
+
+        # References leading to nodes that were added before
+        for ref in node.references:
+            if ref.target not in printed_ids:
+                continue
+            if node.hidden and nodeset.nodes[ref.target].hidden:
+                continue
+            table.addReference(ref)
+
+    # The descriptions are appended to the end of the pool. They are left out
+    # when the descriptions are not compiled in.
+    poolSize = len(table.pool.data)
+    for tn, description in zip(table.nodes, table.descriptions):
+        tn["descriptionLocale"] = table.pool.addString(description.locale)
+        tn["descriptionText"] = table.pool.addString(description.text)
+
+    writec("\nstatic const UA_Byte %s_pool[] = {" % outfilebase)
+    writePoolBytes(writec, table.pool.data[:poolSize])
+    if len(table.pool.data) > poolSize:
+        writec("#ifdef UA_ENABLE_NODESET_COMPILER_DESCRIPTIONS")
+        writePoolBytes(writec, table.pool.data[poolSize:])
+        writec("#endif")
+    writec("};")
+
+    writeArray(writec, "UA_UInt32", outfilebase + "_namespaces",
+               [str(pos) + "," for pos in namespaces])
+    writeArray(writec, "UA_NodeTableVariable", outfilebase + "_variables", table.variables)
+
+    nodeEntries = []
+    for tn in table.nodes:
+        nodeEntries.append("/* %s */" % tn["comment"].replace("*/", "* /"))
+        nodeEntries.append("{%s, %s, %d, %s, %s, %s, %s, %d, %s, %s, %s, %s, %s, %s, %d, %d, %s}," % \
+                           (tn["nodeClass"], tn["flags"], tn["eventNotifier"], tn["nodeId"],
+                            tn["parentNodeId"], tn["referenceTypeId"], tn["typeDefinition"],
+                            tn["browseNameNamespace"], table.position(tn["browseName"]),
+                            table.position(tn["displayNameLocale"]),
+                            table.position(tn["displayNameText"]),
+                            table.position(tn["descriptionLocale"]),
+                            table.position(tn["descriptionText"]),
+                            table.position(tn["inverseName"]),
+                            tn["writeMask"], tn["userWriteMask"],
+                            table.position(tn["variable"])))
+    if len(table.nodes) > 0:
+        writec("\nstatic const UA_NodeTableNode %s_nodes[%d] = {" % (outfilebase, len(table.nodes)))
+        for e in nodeEntries:
+            writec(e)
+        writec("};")
+    writeArray(writec, "UA_NodeTableReference", outfilebase + "_references", table.references)
+
+    def arrayRef(name, size):
+        if size == 0:
+            return "0, NULL"
+        return "%d, %s_%s" % (size, outfilebase, name)
+
+    writec("""
+static const UA_NodeTable %s_table = {
+    %s,
+    %s,
+    %s,
+    %s,
+    sizeof(%s_pool), %s_pool
+};
+
+UA_StatusCode %s(UA_Server *server) {
+    return UA_Server_loadNodeTable(server, &%s_table);
+}""" % (outfilebase, arrayRef("namespaces", len(namespaces)),
+        arrayRef("nodes", len(table.nodes)),
+        arrayRef("variables", len(table.variables)),
+        arrayRef("references", len(table.references)),
+        outfilebase, outfilebase, outfilebase, outfilebase))
+
+    fullCode = outfilec.getvalue()
+    outfilec.close()
+
+    outfilec = codecs.open(outfilename + ".c", r"w+", encoding='utf-8')
+    outfilec.write(fullCode)
+    outfilec.flush()
+    os.fsync(outfilec)
+    outfilec.close()
@@ -23,6 +23,7 @@
 ###
 
 import logging
+import sys
 import argparse
 from datatypes import NodeId
 from nodeset import *
@@ -96,7 +97,7 @@ parser.add_argument('--backend',
                     default='open62541',
                     const='open62541',
                     nargs='?',
-                    choices=['open62541', 'graphviz'],
+                    choices=['open62541', 'open62541_table', 'graphviz'],
                     help='Backend for the output files (default: %(default)s)')
 
 args = parser.parse_args()
@@ -203,6 +204,13 @@ if args.backend == "open62541":
     # Create the C code with the open62541 backend of the compiler
     from backend_open62541 import generateOpen62541Code
     generateOpen62541Code(ns, args.outputFile, args.generate_ns0, args.internal_headers, args.typesArray, args.encode_binary_size)
+elif args.backend == "open62541_table":
+    # Create static node tables that are loaded in one bulk load
+    if args.generate_ns0:
+        logger.error("Namespace zero cannot be generated with the open62541_table backend")
+        sys.exit(1)
+    from backend_open62541_table import generateOpen62541TableCode
+    generateOpen62541TableCode(ns, args.outputFile, args.internal_headers, args.typesArray)
 elif args.backend == "graphviz":
     from backend_graphviz import generateGraphvizCode
     generateGraphvizCode(ns, filename=args.outputFile)